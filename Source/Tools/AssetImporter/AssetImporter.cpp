@@ -172,6 +172,14 @@ std::unordered_set<aiAnimation*> allAnimations_;
 PODVector<aiAnimation*> sceneAnimations_;
 
 float defaultTicksPerSecond_ = 4800.0f;
+float keyFrameTolerance_ = 0.0f;
+float keyFrameAngleTolerance_ = 0.0f;
+float animationCompressionRate_ = 0.0f;
+unsigned lodLevels_ = 0;
+float lodReduction_ = 0.5f;
+float lodPixelError_ = 1.0f;
+bool optimizeVertexOrder_ = false;
+String quantizeElements_;
 // For subset animation import usage
 float importStartTime_ = 0.0f;
 float importEndTime_ = 0.0f;
@@ -309,6 +317,19 @@ void Run(const std::vector<String>& arguments)
             "-split <start> <end> (animation model only)\n"
             "            Split animation, will only import from start frame to end frame\n"
             "-np         Do not suppress $fbx pivot nodes (FBX files only)\n"
+            "-kr <tol> [angle]\n"
+            "            Remove animation keyframes reproducible by interpolation within\n"
+            "            tolerance. Angle tolerance in degrees, default 0.1\n"
+            "-ac <rate>  Save animations compressed, resampled at rate frames per second\n"
+            "-lod <levels> [reduction] [pixels]\n"
+            "            Generate LOD levels for models by mesh simplification. Each level\n"
+            "            keeps reduction times the triangles of the previous, default 0.5.\n"
+            "            LOD distances are chosen for an error of pixels, default 1\n"
+            "-oc         Optimize index and vertex order for the vertex cache, overdraw and\n"
+            "            vertex fetch\n"
+            "-q <elements>\n"
+            "            Quantize vertex elements, any of p (16-bit positions), n (packed\n"
+            "            normals), t (packed tangents) and u (half float texcoords)\n"
         );
     }
 
@@ -459,6 +480,47 @@ void Run(const std::vector<String>& arguments)
                 checkUniqueModel_ = false;
             else if (argument == "bp")
                 moveToBindPose_ = true;
+            else if (argument == "kr" && !value.Empty())
+            {
+                keyFrameTolerance_ = ToFloat(value);
+                keyFrameAngleTolerance_ = 0.1f;
+                ++i;
+                String value2 = i + 1 < arguments.size() ? arguments[i + 1] : String::EMPTY;
+                if (value2.Length() && value2[0] != '-')
+                {
+                    keyFrameAngleTolerance_ = ToFloat(value2);
+                    ++i;
+                }
+            }
+            else if (argument == "ac" && !value.Empty())
+            {
+                animationCompressionRate_ = ToFloat(value);
+                ++i;
+            }
+            else if (argument == "lod" && !value.Empty())
+            {
+                lodLevels_ = ToUInt(value);
+                ++i;
+                String value2 = i + 1 < arguments.size() ? arguments[i + 1] : String::EMPTY;
+                if (value2.Length() && value2[0] != '-')
+                {
+                    lodReduction_ = ToFloat(value2);
+                    ++i;
+                    String value3 = i + 1 < arguments.size() ? arguments[i + 1] : String::EMPTY;
+                    if (value3.Length() && value3[0] != '-')
+                    {
+                        lodPixelError_ = ToFloat(value3);
+                        ++i;
+                    }
+                }
+            }
+            else if (argument == "oc")
+                optimizeVertexOrder_ = true;
+            else if (argument == "q" && !value.Empty())
+            {
+                quantizeElements_ = value;
+                ++i;
+            }
             else if (argument == "split")
             {
                 String value2 = i + 2 < arguments.size() ? arguments[i + 2] : String::EMPTY;
@@ -1225,6 +1287,28 @@ void BuildAndSaveModel(OutModel& model)
             outModel->SetGeometryBoneMappings(allBoneMappings);
     }
 
+    if (lodLevels_)
+    {
+        PrintLine("Generating " + String(lodLevels_) + " LOD levels");
+        if (!outModel->GenerateLods(lodLevels_, lodReduction_, lodPixelError_))
+            PrintLine("Warning: could not generate LOD levels");
+    }
+
+    if (optimizeVertexOrder_)
+    {
+        PrintLine("Optimizing vertex and index order");
+        outModel->OptimizeGeometries();
+    }
+
+    if (quantizeElements_.Contains('p') && !outModel->ConvertVertexElements(SEM_POSITION, TYPE_SHORT4_NORM))
+        PrintLine("Warning: could not quantize vertex positions");
+    if (quantizeElements_.Contains('n') && !outModel->ConvertVertexElements(SEM_NORMAL, TYPE_BYTE4_NORM))
+        PrintLine("Warning: could not quantize vertex normals");
+    if (quantizeElements_.Contains('t') && !outModel->ConvertVertexElements(SEM_TANGENT, TYPE_BYTE4_NORM))
+        PrintLine("Warning: could not quantize vertex tangents");
+    if (quantizeElements_.Contains('u') && !outModel->ConvertVertexElements(SEM_TEXCOORD, TYPE_HALF2))
+        PrintLine("Warning: could not quantize vertex texture coordinates");
+
     File outFile(context_);
     if (!outFile.Open(model.outName_, FILE_WRITE))
         ErrorExit("Could not open output file " + model.outName_);
@@ -1486,6 +1570,11 @@ void BuildAndSaveAnimations(OutModel* model)
             }
         }
 
+        if (keyFrameTolerance_ > 0.0f || keyFrameAngleTolerance_ > 0.0f)
+            outAnim->ReduceKeyFrames(keyFrameTolerance_, keyFrameAngleTolerance_);
+        if (animationCompressionRate_ > 0.0f && !outAnim->Compress(animationCompressionRate_))
+            ErrorExit("Could not compress animation " + animName);
+
         File outFile(context_);
         if (!outFile.Open(animOutName, FILE_WRITE))
             ErrorExit("Could not open output file " + animOutName);
@@ -98,6 +98,7 @@ void Urho3DPlayer::Setup()
             "-ap <paths>  Resource autoload path(s), separated by semicolons, default to 'AutoLoad'\n"
             "-log <level> Change the log level, valid 'level' values: 'debug', 'info', 'warning', 'error'\n"
             "-ds <file>   Dump used shader variations to a file for precaching\n"
+            "-ps <file>   Precache shader variations from a file dumped with -ds\n"
             "-mq <level>  Material quality level, default 2 (high)\n"
             "-tq <level>  Texture quality level, default 2 (high)\n"
             "-tf <level>  Texture filter mode, default 2 (trilinear)\n"
@@ -63,6 +63,10 @@ namespace Urho3D
         virtual void Get(const Serializable* ptr, Variant& dest) const = 0;
         /// Set the attribute.
         virtual void Set(Serializable* ptr, const Variant& src) = 0;
+        /// Return address of the attribute's plain data member, or null if it can only be accessed through Get() and Set().
+        virtual const void* GetMemberAddress(const Serializable* ptr) const { return nullptr; }
+        /// Return size of the plain data member in bytes, or zero if it can only be accessed through Get() and Set().
+        virtual unsigned GetMemberSize() const { return 0; }
     };
 
     /// Description of an automatically serializable variable.
@@ -78,7 +82,8 @@ namespace Urho3D
             enumNames_(enumNames),
             accessor_(accessor),
             defaultValue_(defaultValue),
-            mode_(mode)
+            mode_(mode),
+            memberSize_(accessor ? accessor->GetMemberSize() : 0)
         {
         }
 
@@ -111,6 +116,8 @@ namespace Urho3D
         VariantMap metadata_;
         /// Attribute data pointer if elsewhere than in the Serializable.
         void* ptr_ = nullptr;
+        /// Size of the plain data member if the accessor allows copying, comparing and serializing it without a Variant, otherwise zero.
+        unsigned memberSize_ = 0;
     };
 
     /// Attribute handle returned by Context::RegisterAttribute and used to chain attribute setup calls.
@@ -36,6 +36,7 @@
 #include "../Graphics/Graphics.h"
 #include "../Graphics/Renderer.h"
 #include "../Input/Input.h"
+#include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/PackageFile.h"
@@ -260,6 +261,12 @@ bool Engine::Initialize(const VariantMap& parameters)
 
         graphics->SetShaderCacheDir(GetParameter(parameters, EP_SHADER_CACHE_DIR, fileSystem->GetAppPreferencesDir("urho3d", "shadercache")).GetString());
 
+        if (HasParameter(parameters, EP_PRECACHE_SHADERS))
+        {
+            SharedPtr<File> file = cache->GetFile(GetParameter(parameters, EP_PRECACHE_SHADERS).GetString());
+            if (file)
+                graphics->PrecacheShaders(*file);
+        }
         if (HasParameter(parameters, EP_DUMP_SHADERS))
             graphics->BeginDumpShaders(GetParameter(parameters, EP_DUMP_SHADERS, String::EMPTY).GetString());
         if (HasParameter(parameters, EP_RENDER_PATH))
@@ -922,6 +929,11 @@ VariantMap Engine::ParseParameters(const std::vector<String>& arguments)
                 ret[EP_DUMP_SHADERS] = value;
                 ++i;
             }
+            else if (argument == "ps" && !value.Empty())
+            {
+                ret[EP_PRECACHE_SHADERS] = value;
+                ++i;
+            }
             else if (argument == "mq" && !value.Empty())
             {
                 ret[EP_MATERIAL_QUALITY] = ToInt(value);
@@ -44,6 +44,7 @@ static const String EP_MATERIAL_QUALITY = "MaterialQuality";
 static const String EP_MONITOR = "Monitor";
 static const String EP_MULTI_SAMPLE = "MultiSample";
 static const String EP_ORIENTATIONS = "Orientations";
+static const String EP_PRECACHE_SHADERS = "PrecacheShaders";
 static const String EP_PACKAGE_CACHE_DIR = "PackageCacheDir";
 static const String EP_RENDER_PATH = "RenderPath";
 static const String EP_REFRESH_RATE = "RefreshRate";
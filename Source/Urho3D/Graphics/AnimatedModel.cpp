@@ -24,8 +24,11 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/AnimatedModel.h"
 #include "../Graphics/Animation.h"
+#include "../Graphics/AnimationPoseCache.h"
 #include "../Graphics/AnimationState.h"
 #include "../Graphics/Batch.h"
 #include "../Graphics/Camera.h"
@@ -65,6 +68,135 @@ namespace Urho3D
     }
 
     static const unsigned MAX_ANIMATION_STATES = 256;
+    /// Number of vertices accumulated at a time when applying vertex morphs. Must be a multiple of 4.
+    static const unsigned MORPH_CHUNK_VERTICES = 512;
+    /// Smallest number of morphed vertices in a frame for splitting the work across worker threads.
+    static const unsigned MIN_THREADED_MORPH_VERTICES = 4 * MORPH_CHUNK_VERTICES;
+    /// Number of accumulated delta components: X, Y and Z of position, normal and tangent.
+    static const unsigned NUM_MORPH_COMPONENTS = 9;
+
+    /// Deltas of an active vertex morph within a morph vertex buffer.
+    struct MorphDeltaSource
+    {
+        /// Delta arrays per accumulated component, or null if the morph does not move the component.
+        const float* deltas_[NUM_MORPH_COMPONENTS];
+        /// First vertex of the delta span relative to the morph range.
+        unsigned start_;
+        /// Number of vertices in the delta span.
+        unsigned count_;
+        /// Morph weight.
+        float weight_;
+    };
+
+    /// Morph application of one morph vertex buffer.
+    struct MorphBufferTask
+    {
+        /// Locked morph range of the morph vertex buffer.
+        unsigned char* dest_;
+        /// Morph range in the original vertex buffer's shadow data.
+        const unsigned char* src_;
+        /// Vertex size of the morph vertex buffer.
+        unsigned destVertexSize_;
+        /// Vertex size of the original vertex buffer.
+        unsigned srcVertexSize_;
+        /// Position, normal and tangent offsets in the morph vertex buffer, M_MAX_UNSIGNED if not morphed.
+        unsigned destOffsets_[3];
+        /// Position, normal and tangent offsets in the original vertex buffer.
+        unsigned srcOffsets_[3];
+        /// Active morphs with deltas.
+        PODVector<MorphDeltaSource> morphs_;
+    };
+
+    /// Range of vertices of a morph vertex buffer to apply morphs on.
+    struct MorphChunk
+    {
+        /// Buffer task.
+        const MorphBufferTask* task_;
+        /// First vertex relative to the morph range. Aligned to 4 vertices.
+        unsigned start_;
+        /// End vertex relative to the morph range.
+        unsigned end_;
+    };
+
+    /// Accumulate weighted deltas. The count must be a multiple of 4.
+    static void AccumulateMorphDeltas(float* dest, const float* deltas, float weight, unsigned count)
+    {
+#if ALIMER_SSE2
+        const __m128 w = _mm_set1_ps(weight);
+        for (unsigned i = 0; i < count; i += 4)
+            _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), _mm_mul_ps(_mm_loadu_ps(deltas + i), w)));
+#elif ALIMER_NEON
+        const float32x4_t w = vdupq_n_f32(weight);
+        for (unsigned i = 0; i < count; i += 4)
+            vst1q_f32(dest + i, vmlaq_f32(vld1q_f32(dest + i), vld1q_f32(deltas + i), w));
+#else
+        for (unsigned i = 0; i < count; ++i)
+            dest[i] += deltas[i] * weight;
+#endif
+    }
+
+    /// Reset a range of morphed vertices to the original vertex data and add the deltas of all active morphs.
+    static void ApplyMorphChunk(const MorphChunk& chunk)
+    {
+        const MorphBufferTask& task = *chunk.task_;
+        const unsigned count = chunk.end_ - chunk.start_;
+        const unsigned paddedCount = (count + 3) & ~3u;
+        float accumulators[NUM_MORPH_COMPONENTS * MORPH_CHUNK_VERTICES];
+
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            if (task.destOffsets_[i] != M_MAX_UNSIGNED)
+                memset(accumulators + i * 3 * MORPH_CHUNK_VERTICES, 0, 3 * MORPH_CHUNK_VERTICES * sizeof(float));
+        }
+
+        // Accumulate all morphs overlapping the chunk. The spans and the chunk are aligned to 4 vertices
+        for (unsigned i = 0; i < task.morphs_.Size(); ++i)
+        {
+            const MorphDeltaSource& morph = task.morphs_[i];
+            unsigned start = Max(morph.start_, chunk.start_);
+            unsigned end = Min(morph.start_ + morph.count_, chunk.start_ + paddedCount);
+            if (start >= end)
+                continue;
+
+            for (unsigned j = 0; j < NUM_MORPH_COMPONENTS; ++j)
+            {
+                if (morph.deltas_[j])
+                {
+                    AccumulateMorphDeltas(accumulators + j * MORPH_CHUNK_VERTICES + start - chunk.start_,
+                        morph.deltas_[j] + start - morph.start_, morph.weight_, end - start);
+                }
+            }
+        }
+
+        // Write the morphed vertices
+        for (unsigned i = 0; i < count; ++i)
+        {
+            unsigned char* dest = task.dest_ + (chunk.start_ + i) * task.destVertexSize_;
+            const unsigned char* src = task.src_ + (chunk.start_ + i) * task.srcVertexSize_;
+
+            for (unsigned j = 0; j < 3; ++j)
+            {
+                if (task.destOffsets_[j] == M_MAX_UNSIGNED)
+                    continue;
+
+                auto* destElement = reinterpret_cast<float*>(dest + task.destOffsets_[j]);
+                const auto* srcElement = reinterpret_cast<const float*>(src + task.srcOffsets_[j]);
+                const float* accumulator = accumulators + j * 3 * MORPH_CHUNK_VERTICES + i;
+                destElement[0] = srcElement[0] + accumulator[0];
+                destElement[1] = srcElement[1] + accumulator[MORPH_CHUNK_VERTICES];
+                destElement[2] = srcElement[2] + accumulator[2 * MORPH_CHUNK_VERTICES];
+                // Tangent W is not morphed
+                if (j == 2)
+                    destElement[3] = srcElement[3];
+            }
+        }
+    }
+
+    /// Apply morphs on a range of vertices in a worker thread.
+    static void ApplyMorphChunkWork(const WorkItem* item, unsigned threadIndex)
+    {
+        ApplyMorphChunk(*reinterpret_cast<const MorphChunk*>(item->start_));
+    }
 
     AnimatedModel::AnimatedModel(Context* context) :
         StaticModel(context),
@@ -82,7 +214,8 @@ namespace Urho3D
         isMaster_(true),
         loading_(false),
         assignBonesPending_(false),
-        forceAnimationUpdate_(false)
+        forceAnimationUpdate_(false),
+        poseSharing_(false)
     {
     }
 
@@ -114,6 +247,7 @@ namespace Urho3D
         URHO3D_ACCESSOR_ATTRIBUTE("Shadow Distance", GetShadowDistance, SetShadowDistance, float, 0.0f, AM_DEFAULT);
         URHO3D_ACCESSOR_ATTRIBUTE("LOD Bias", GetLodBias, SetLodBias, float, 1.0f, AM_DEFAULT);
         URHO3D_ACCESSOR_ATTRIBUTE("Animation LOD Bias", GetAnimationLodBias, SetAnimationLodBias, float, 1.0f, AM_DEFAULT);
+        URHO3D_ACCESSOR_ATTRIBUTE("Pose Sharing", GetPoseSharing, SetPoseSharing, bool, false, AM_DEFAULT);
         URHO3D_COPY_BASE_ATTRIBUTES(Drawable);
         URHO3D_MIXED_ACCESSOR_ATTRIBUTE("Bone Animation Enabled", GetBonesEnabledAttr, SetBonesEnabledAttr, VariantVector,
             Variant::emptyVariantVector, AM_FILE | AM_NOEDIT);
@@ -344,6 +478,7 @@ namespace Urho3D
             UnsubscribeFromEvent(model_, E_RELOADFINISHED);
 
         model_ = model;
+        sharedPose_.Reset();
 
         if (model)
         {
@@ -421,7 +556,7 @@ namespace Urho3D
                 else
                 {
                     batches_[i].geometryType_ = GEOM_STATIC;
-                    batches_[i].worldTransform_ = &node_->GetWorldTransform();
+                    batches_[i].worldTransform_ = model->HasQuantizedPositions() ? &quantizedWorldTransform_ : &node_->GetWorldTransform();
                     batches_[i].numWorldTransforms_ = 1;
                 }
             }
@@ -544,6 +679,17 @@ namespace Urho3D
         MarkNetworkUpdate();
     }
 
+    void AnimatedModel::SetPoseSharing(bool enable)
+    {
+        // The cache is created on first use, as models are updated in worker threads
+        if (enable && !GetSubsystem<AnimationPoseCache>())
+            context_->RegisterSubsystem(new AnimationPoseCache(context_));
+
+        poseSharing_ = enable;
+        MarkAnimationDirty();
+        MarkNetworkUpdate();
+    }
+
     void AnimatedModel::SetUpdateInvisible(bool enable)
     {
         updateInvisible_ = enable;
@@ -964,6 +1110,8 @@ namespace Urho3D
         {
             // Note: do not update bone bounding box here, instead do it in either of the threaded updates
             worldBoundingBox_ = boneBoundingBox_.Transformed(node_->GetWorldTransform());
+            if (model_ && model_->HasQuantizedPositions())
+                quantizedWorldTransform_ = node_->GetWorldTransform() * model_->GetPositionTransform();
         }
         else
         {
@@ -1177,6 +1325,7 @@ namespace Urho3D
 
         // Make sure the rendering batches use the new cloned geometries
         ResetLodLevels();
+        appliedMorphWeights_.Clear();
         MarkMorphsDirty();
     }
 
@@ -1292,8 +1441,16 @@ namespace Urho3D
             animationOrderDirty_ = false;
         }
 
+        sharedPose_.Reset();
+
         // Reset skeleton, apply all animations, calculate bones' bounding box. Make sure this is only done for the master model
         // (first AnimatedModel in a node)
+        if (isMaster_ && poseSharing_ && ApplySharedPose())
+        {
+            animationDirty_ = false;
+            return;
+        }
+
         if (isMaster_)
         {
             skeleton_.ResetSilent();
@@ -1310,12 +1467,122 @@ namespace Urho3D
         animationDirty_ = false;
     }
 
+    bool AnimatedModel::ApplySharedPose()
+    {
+        auto* cache = GetSubsystem<AnimationPoseCache>();
+        if (!cache || !model_)
+            return false;
+
+        // Manually controlled bones would make the pose differ from other models
+        const vector<Bone>& bones = skeleton_.GetBones();
+        for (vector<Bone>::const_iterator i = bones.begin(); i != bones.end(); ++i)
+        {
+            if (!i->node_ || !i->animated_)
+                return false;
+        }
+
+        // Models updated less often by animation LOD use a coarser time quantization
+        float lodInterval = 0.0f;
+        if (animationLodBias_ > 0.0f && animationLodDistance_ > 0.0f)
+            lodInterval = animationLodDistance_ / (animationLodBias_ * ANIMATION_LOD_BASESCALE);
+        float quantum = cache->GetTimeQuantum(lodInterval);
+
+        // Build the key from the model, the bone count, the resource version, the quantum and the quantized parameters of the enabled animation states
+        auto pointerLow = [](const void* ptr) { return (unsigned)(size_t)ptr; };
+        auto pointerHigh = [](const void* ptr) { return (unsigned)((unsigned long long)(size_t)ptr >> 32u); };
+        poseKey_.Clear();
+        poseKey_.Push(pointerLow(model_));
+        poseKey_.Push(pointerHigh(model_));
+        poseKey_.Push((unsigned)bones.size());
+        poseKey_.Push(cache->GetResourceVersion());
+        poseKey_.Push((unsigned)RoundToInt(quantum * 1000000.0f));
+        for (std::vector<SharedPtr<AnimationState> >::const_iterator i = animationStates_.begin(); i != animationStates_.end(); ++i)
+        {
+            AnimationState* state = *i;
+            if (!state->IsEnabled())
+                continue;
+
+            Animation* animation = state->GetAnimation();
+            poseKey_.Push(pointerLow(animation));
+            poseKey_.Push(pointerHigh(animation));
+            poseKey_.Push(state->GetStartBone() ? state->GetStartBone()->nameHash_.Value() : 0);
+            poseKey_.Push((unsigned)RoundToInt(state->GetTime() / quantum));
+            poseKey_.Push((unsigned)RoundToInt(state->GetWeight() * 1023.0f));
+            poseKey_.Push(state->GetLayer() | (unsigned)state->GetBlendMode() << 8u);
+            for (unsigned j = 0; j < state->GetNumTracks(); ++j)
+                poseKey_.Push((unsigned)RoundToInt(state->GetBoneWeight(j) * 1023.0f));
+        }
+
+        unsigned hash = AnimationPoseCache::HashKey(poseKey_);
+        SharedPtr<AnimationPoseCacheEntry> entry = cache->Find(hash, poseKey_);
+
+        if (entry && entry->positions_.Size() == bones.size())
+        {
+            for (unsigned i = 0; i < bones.size(); ++i)
+                bones[i].node_->SetTransformSilent(entry->positions_[i], entry->rotations_[i], entry->scales_[i]);
+            node_->MarkDirty();
+
+            boneBoundingBox_ = entry->boneBoundingBox_;
+            boneBoundingBoxDirty_ = false;
+            worldBoundingBoxDirty_ = true;
+        }
+        else
+        {
+            // Evaluate at the quantized time positions and weights so that every model sharing the pose would evaluate it the same
+            skeleton_.ResetSilent();
+            for (std::vector<SharedPtr<AnimationState> >::iterator i = animationStates_.begin(); i != animationStates_.end(); ++i)
+            {
+                AnimationState* state = *i;
+                if (state->IsEnabled())
+                {
+                    float time = Min(RoundToInt(state->GetTime() / quantum) * quantum, state->GetLength());
+                    float weight = RoundToInt(state->GetWeight() * 1023.0f) / 1023.0f;
+                    state->Apply(time, weight);
+                }
+            }
+
+            node_->MarkDirty();
+            UpdateBoneBoundingBox();
+
+            entry = new AnimationPoseCacheEntry();
+            entry->key_ = poseKey_;
+            entry->resources_.Push(WeakPtr<Resource>(model_.Get()));
+            for (std::vector<SharedPtr<AnimationState> >::const_iterator i = animationStates_.begin(); i != animationStates_.end(); ++i)
+            {
+                if ((*i)->IsEnabled() && (*i)->GetAnimation())
+                    entry->resources_.Push(WeakPtr<Resource>((*i)->GetAnimation()));
+            }
+            entry->positions_.Resize(bones.size());
+            entry->rotations_.Resize(bones.size());
+            entry->scales_.Resize(bones.size());
+            entry->skinMatrices_.Resize(bones.size());
+            entry->boneBoundingBox_ = boneBoundingBox_;
+
+            Matrix3x4 inverseNodeTransform = node_->GetWorldTransform().Inverse();
+            for (unsigned i = 0; i < bones.size(); ++i)
+            {
+                const Bone& bone = bones[i];
+                entry->positions_[i] = bone.node_->GetPosition();
+                entry->rotations_[i] = bone.node_->GetRotation();
+                entry->scales_[i] = bone.node_->GetScale();
+                entry->skinMatrices_[i] = inverseNodeTransform * bone.node_->GetWorldTransform() * bone.offsetMatrix_;
+            }
+
+            cache->Store(hash, entry);
+        }
+
+        sharedPose_ = entry;
+        return true;
+    }
+
     void AnimatedModel::UpdateSkinning()
     {
         // Note: the model's world transform will be baked in the skin matrices
         const vector<Bone>& bones = skeleton_.GetBones();
         // Use model's world transform in case a bone is missing
         const Matrix3x4& worldTransform = node_->GetWorldTransform();
+        // A shared pose has the skin matrices relative to the model's scene node, which avoids updating the bone node transforms
+        const Matrix3x4* sharedSkinMatrices = sharedPose_ ? sharedPose_->skinMatrices_.Buffer() : nullptr;
 
         // Skinning with global matrices only
         if (!geometrySkinMatrices_.size())
@@ -1323,7 +1590,9 @@ namespace Urho3D
             for (size_t i = 0; i < bones.size(); ++i)
             {
                 const Bone& bone = bones[i];
-                if (bone.node_)
+                if (sharedSkinMatrices)
+                    skinMatrices_[i] = worldTransform * sharedSkinMatrices[i];
+                else if (bone.node_)
                     skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
                 else
                     skinMatrices_[i] = worldTransform;
@@ -1335,7 +1604,9 @@ namespace Urho3D
             for (size_t i = 0; i < bones.size(); ++i)
             {
                 const Bone& bone = bones[i];
-                if (bone.node_)
+                if (sharedSkinMatrices)
+                    skinMatrices_[i] = worldTransform * sharedSkinMatrices[i];
+                else if (bone.node_)
                     skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
                 else
                     skinMatrices_[i] = worldTransform;
@@ -1359,37 +1630,146 @@ namespace Urho3D
 
         if (morphs_.size())
         {
-            // Reset the morph data range from all morphable vertex buffers, then apply morphs
+            // Skip if the weights have not changed since last applied
+            bool weightsChanged = appliedMorphWeights_.Size() != morphs_.size();
+            for (unsigned i = 0; i < morphs_.size() && !weightsChanged; ++i)
+                weightsChanged = appliedMorphWeights_[i] != morphs_[i].weight_;
+            if (!weightsChanged)
+            {
+                morphsDirty_ = false;
+                return;
+            }
+
+            URHO3D_PROFILE(UpdateMorphs);
+
+            std::vector<MorphBufferTask> tasks(morphVertexBuffers_.size());
+            PODVector<MorphChunk> chunks;
+            PODVector<unsigned> lockedBuffers;
+            unsigned totalVertices = 0;
+
+            // Lock the morph ranges and collect the active morphs of each morphable vertex buffer
             for (unsigned i = 0; i < morphVertexBuffers_.size(); ++i)
             {
                 VertexBuffer* buffer = morphVertexBuffers_[i];
-                if (buffer)
+                if (!buffer)
+                    continue;
+
+                VertexBuffer* originalBuffer = model_->GetVertexBuffers()[i];
+                unsigned morphStart = model_->GetMorphRangeStart(i);
+                unsigned morphCount = model_->GetMorphRangeCount(i);
+
+                void* dest = buffer->Lock(morphStart, morphCount);
+                if (!dest)
+                    continue;
+
+                MorphBufferTask& task = tasks[i];
+                task.dest_ = static_cast<unsigned char*>(dest);
+                task.src_ = originalBuffer->GetShadowData() + morphStart * originalBuffer->GetVertexSize();
+                task.destVertexSize_ = buffer->GetVertexSize();
+                task.srcVertexSize_ = originalBuffer->GetVertexSize();
+
+                const VertexElementSemantic semantics[] = { SEM_POSITION, SEM_NORMAL, SEM_TANGENT };
+                for (unsigned j = 0; j < 3; ++j)
                 {
-                    VertexBuffer* originalBuffer = model_->GetVertexBuffers()[i];
-                    unsigned morphStart = model_->GetMorphRangeStart(i);
-                    unsigned morphCount = model_->GetMorphRangeCount(i);
+                    task.destOffsets_[j] = buffer->GetElementOffset(semantics[j]);
+                    task.srcOffsets_[j] = originalBuffer->GetElementOffset(semantics[j]);
+                    if (task.srcOffsets_[j] == M_MAX_UNSIGNED)
+                        task.destOffsets_[j] = M_MAX_UNSIGNED;
+                }
 
-                    void* dest = buffer->Lock(morphStart, morphCount);
-                    if (dest)
-                    {
-                        // Reset morph range by copying data from the original vertex buffer
-                        CopyMorphVertices(dest, originalBuffer->GetShadowData() + morphStart * originalBuffer->GetVertexSize(),
-                            morphCount, buffer, originalBuffer);
+                for (unsigned j = 0; j < morphs_.size(); ++j)
+                {
+                    if (morphs_[j].weight_ == 0.0f)
+                        continue;
 
-                        for (unsigned j = 0; j < morphs_.size(); ++j)
+                    HashMap<unsigned, VertexBufferMorph>::ConstIterator k = morphs_[j].buffers_.Find(i);
+                    if (k == morphs_[j].buffers_.End() || !k->second_.deltas_)
+                        continue;
+
+                    const VertexBufferMorph& vbMorph = k->second_;
+                    MorphDeltaSource source;
+                    source.start_ = vbMorph.deltaStart_;
+                    source.count_ = vbMorph.deltaCount_;
+                    source.weight_ = morphs_[j].weight_;
+
+                    // The deltas are stored for the elements in the morph's mask, in position, normal, tangent order
+                    const VertexMaskFlags elementMasks[] = { MASK_POSITION, MASK_NORMAL, MASK_TANGENT };
+                    unsigned deltaIndex = 0;
+                    for (unsigned l = 0; l < 3; ++l)
+                    {
+                        bool hasDeltas = (vbMorph.elementMask_ & elementMasks[l]) != MASK_NONE;
+                        bool morphed = hasDeltas && task.destOffsets_[l] != M_MAX_UNSIGNED;
+                        for (unsigned m = 0; m < 3; ++m)
                         {
-                            if (morphs_[j].weight_ != 0.0f)
-                            {
-                                HashMap<unsigned, VertexBufferMorph>::Iterator k = morphs_[j].buffers_.Find(i);
-                                if (k != morphs_[j].buffers_.End())
-                                    ApplyMorph(buffer, dest, morphStart, k->second_, morphs_[j].weight_);
-                            }
+                            source.deltas_[l * 3 + m] = morphed ? vbMorph.deltas_.Get() + (deltaIndex + m) * vbMorph.deltaCount_ :
+                                nullptr;
                         }
-
-                        buffer->Unlock();
+                        if (hasDeltas)
+                            deltaIndex += 3;
                     }
+
+                    task.morphs_.Push(source);
+                }
+
+                for (unsigned j = 0; j < morphCount; j += MORPH_CHUNK_VERTICES)
+                {
+                    MorphChunk chunk;
+                    chunk.task_ = &task;
+                    chunk.start_ = j;
+                    chunk.end_ = Min(j + MORPH_CHUNK_VERTICES, morphCount);
+                    chunks.Push(chunk);
                 }
+
+                lockedBuffers.Push(i);
+                totalVertices += morphCount;
             }
+
+            // Split large morph ranges across the worker threads. This runs on the main thread during the geometry update,
+            // where the rendering waits for the queued geometry updates to complete anyway
+            auto* queue = GetSubsystem<WorkQueue>();
+            if (queue && queue->GetNumThreads() && chunks.Size() > 1 && totalVertices >= MIN_THREADED_MORPH_VERTICES &&
+                Thread::IsMainThread())
+            {
+                for (unsigned i = 1; i < chunks.Size(); ++i)
+                {
+                    SharedPtr<WorkItem> item = queue->GetFreeItem();
+                    item->priority_ = M_MAX_UNSIGNED;
+                    item->workFunction_ = ApplyMorphChunkWork;
+                    item->start_ = &chunks[i];
+                    queue->AddWorkItem(item);
+                }
+
+                ApplyMorphChunk(chunks[0]);
+                queue->Complete(M_MAX_UNSIGNED);
+            }
+            else
+            {
+                for (unsigned i = 0; i < chunks.Size(); ++i)
+                    ApplyMorphChunk(chunks[i]);
+            }
+
+            for (unsigned i = 0; i < lockedBuffers.Size(); ++i)
+            {
+                unsigned index = lockedBuffers[i];
+                VertexBuffer* buffer = morphVertexBuffers_[index];
+
+                // Morphs without deltas are applied from their packed data
+                for (unsigned j = 0; j < morphs_.size(); ++j)
+                {
+                    if (morphs_[j].weight_ == 0.0f)
+                        continue;
+
+                    HashMap<unsigned, VertexBufferMorph>::ConstIterator k = morphs_[j].buffers_.Find(index);
+                    if (k != morphs_[j].buffers_.End() && !k->second_.deltas_)
+                        ApplyMorph(buffer, tasks[index].dest_, model_->GetMorphRangeStart(index), k->second_, morphs_[j].weight_);
+                }
+
+                buffer->Unlock();
+            }
+
+            appliedMorphWeights_.Resize(morphs_.size());
+            for (unsigned i = 0; i < morphs_.size(); ++i)
+                appliedMorphWeights_[i] = morphs_[i].weight_;
         }
 
         morphsDirty_ = false;
@@ -31,6 +31,7 @@ namespace Urho3D
 
     class Animation;
     class AnimationState;
+    struct AnimationPoseCacheEntry;
 
     /// Animated model component.
     class URHO3D_API AnimatedModel : public StaticModel
@@ -54,6 +55,10 @@ namespace Urho3D
         bool LoadXML(const XMLElement& source) override;
         /// Load from JSON data. Return true if successful.
         bool LoadJSON(const JSONValue& source) override;
+        /// Handle start of a bulk attribute load that bypasses Load().
+        void OnBeginBulkLoad() override { loading_ = true; }
+        /// Handle end of a bulk attribute load.
+        void OnEndBulkLoad() override { loading_ = false; }
         /// Apply attribute changes that can not be applied immediately. Called after scene load or a network update.
         void ApplyAttributes() override;
         /// Process octree raycast. May be called from a worker thread.
@@ -91,6 +96,9 @@ namespace Urho3D
         /// Set whether to update animation and the bounding box when not visible. Recommended to enable for physically controlled models like ragdolls.
         /// @property
         void SetUpdateInvisible(bool enable);
+        /// Set whether to share evaluated poses with other models playing the same animations at nearly the same time positions, using the AnimationPoseCache subsystem. Time positions and weights are quantized, and the bones should not be moved after the animations are applied. Bypassed while any bone has animation disabled.
+        /// @property
+        void SetPoseSharing(bool enable);
         /// Set vertex morph weight by index.
         void SetMorphWeight(unsigned index, float weight);
         /// Set vertex morph weight by name.
@@ -107,6 +115,10 @@ namespace Urho3D
         /// @property
         Skeleton& GetSkeleton() { return skeleton_; }
 
+        /// Return whether shares evaluated poses with other models.
+        /// @property
+        bool GetPoseSharing() const { return poseSharing_; }
+
         /// Return all animation states.
         const std::vector<SharedPtr<AnimationState> >& GetAnimationStates() const { return animationStates_; }
 
@@ -210,11 +222,13 @@ namespace Urho3D
         void CopyMorphVertices(void* destVertexData, void* srcVertexData, unsigned vertexCount, VertexBuffer* destBuffer, VertexBuffer* srcBuffer);
         /// Recalculate animations. Called from Update().
         void UpdateAnimation(const FrameInfo& frame);
+        /// Apply a pose shared through the pose cache, evaluating and storing it if not cached. Return false if the pose can not be shared.
+        bool ApplySharedPose();
         /// Recalculate skinning.
         void UpdateSkinning();
-        /// Reapply all vertex morphs.
+        /// Reapply all vertex morphs. Accumulates all active morphs in one pass over the morph ranges and splits large ranges across worker threads. Skipped if the morph weights have not changed since last applied.
         void UpdateMorphs();
-        /// Apply a vertex morph.
+        /// Apply a vertex morph from its packed data. Used for morphs that have no deltas.
         void ApplyMorph
         (VertexBuffer* buffer, void* destVertexData, unsigned morphRangeStart, const VertexBufferMorph& morph, float weight);
         /// Handle model reload finished.
@@ -226,10 +240,16 @@ namespace Urho3D
         std::vector<SharedPtr<VertexBuffer> > morphVertexBuffers_;
         /// Vertex morphs.
         std::vector<ModelMorph> morphs_;
+        /// Morph weights last applied to the morph vertex buffers. Empty if not applied since the buffers were cloned.
+        PODVector<float> appliedMorphWeights_;
         /// Animation states.
         std::vector<SharedPtr<AnimationState> > animationStates_;
         /// Skinning matrices.
         std::vector<Matrix3x4> skinMatrices_;
+        /// Shared pose applied by the last animation update, or null if evaluated by this model.
+        SharedPtr<AnimationPoseCacheEntry> sharedPose_;
+        /// Pose cache key of the last animation update.
+        PODVector<unsigned> poseKey_;
         /// Mapping of subgeometry bone indices, used if more bones than skinning shader can manage.
         std::vector<std::vector<uint32_t> > geometryBoneMappings_;
         /// Subgeometry skinning matrices, used if more bones than skinning shader can manage.
@@ -270,5 +290,7 @@ namespace Urho3D
         bool assignBonesPending_;
         /// Force animation update after becoming visible flag.
         bool forceAnimationUpdate_;
+        /// Pose sharing flag.
+        bool poseSharing_;
     };
 }
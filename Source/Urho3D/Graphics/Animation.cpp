@@ -34,10 +34,28 @@
 #include "../Resource/XMLFile.h"
 #include "../Resource/JSONFile.h"
 
+#if ALIMER_SSE2
+#include <emmintrin.h>
+#elif ALIMER_NEON
+#include <arm_neon.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
 {
+    /// Largest range of a component across frames for a compressed lane to be stored as a constant.
+    static const float COMPRESSED_CONSTANT_EPSILON = 1e-5f;
+    /// Largest quantized sample value.
+    static const float COMPRESSED_SAMPLE_MAX = 65535.0f;
+
+    static const AnimationChannelFlags compressedChannelFlags[] =
+    {
+        AnimationChannelFlags::Position,
+        AnimationChannelFlags::Rotation,
+        AnimationChannelFlags::Scale
+    };
+
     inline bool CompareTriggers(AnimationTriggerPoint& lhs, AnimationTriggerPoint& rhs)
     {
         return lhs.time_ < rhs.time_;
@@ -110,6 +128,388 @@ namespace Urho3D
         return true;
     }
 
+    /// Return whether a keyframe is reproduced within tolerance by interpolating between two other keyframes.
+    static bool IsKeyFrameReproduced(const AnimationKeyFrame& from, const AnimationKeyFrame& to, const AnimationKeyFrame& keyFrame,
+        AnimationChannelFlags channelMask, float tolerance, float cosHalfAngleTolerance)
+    {
+        float timeInterval = to.time_ - from.time_;
+        float t = timeInterval > 0.0f ? (keyFrame.time_ - from.time_) / timeInterval : 1.0f;
+
+        if ((channelMask & AnimationChannelFlags::Position) != AnimationChannelFlags::None &&
+            (from.position_.Lerp(to.position_, t) - keyFrame.position_).Length() > tolerance)
+            return false;
+        if ((channelMask & AnimationChannelFlags::Rotation) != AnimationChannelFlags::None &&
+            Abs(from.rotation_.Slerp(to.rotation_, t).Normalized().DotProduct(keyFrame.rotation_.Normalized())) < cosHalfAngleTolerance)
+            return false;
+        if ((channelMask & AnimationChannelFlags::Scale) != AnimationChannelFlags::None &&
+            (from.scale_.Lerp(to.scale_, t) - keyFrame.scale_).Length() > tolerance)
+            return false;
+
+        return true;
+    }
+
+    void AnimationTrack::ReduceKeyFrames(float tolerance, float angleTolerance)
+    {
+        if (keyFrames_.Size() < 2)
+            return;
+
+        float cosHalfAngleTolerance = Cos(angleTolerance * 0.5f);
+        Vector<AnimationKeyFrame> reduced;
+        reduced.Push(keyFrames_.Front());
+
+        // Keep a keyframe only if the keyframes skipped since the last kept one can not be reproduced by interpolating to the next
+        unsigned last = 0;
+        for (unsigned i = 1; i < keyFrames_.Size() - 1; ++i)
+        {
+            const AnimationKeyFrame& from = keyFrames_[last];
+            const AnimationKeyFrame& to = keyFrames_[i + 1];
+            for (unsigned j = last + 1; j <= i; ++j)
+            {
+                if (!IsKeyFrameReproduced(from, to, keyFrames_[j], channelMask_, tolerance, cosHalfAngleTolerance))
+                {
+                    reduced.Push(keyFrames_[i]);
+                    last = i;
+                    break;
+                }
+            }
+        }
+
+        // A track that does not change at all needs only one keyframe
+        if (reduced.Size() > 1 || !IsKeyFrameReproduced(keyFrames_.Front(), keyFrames_.Front(), keyFrames_.Back(), channelMask_,
+            tolerance, cosHalfAngleTolerance))
+            reduced.Push(keyFrames_.Back());
+
+        keyFrames_ = reduced;
+    }
+
+    /// Sample a track at time position without looping. The keyframe index is used as a hint and updated.
+    static AnimationKeyFrame SampleTrack(const AnimationTrack& track, float time, unsigned& frame)
+    {
+        track.GetKeyFrameIndex(time, frame);
+        const AnimationKeyFrame& keyFrame = track.keyFrames_[frame];
+        if (frame + 1 >= track.keyFrames_.Size() || time <= keyFrame.time_)
+        {
+            AnimationKeyFrame ret = keyFrame;
+            ret.time_ = time;
+            return ret;
+        }
+
+        const AnimationKeyFrame& nextKeyFrame = track.keyFrames_[frame + 1];
+        float timeInterval = nextKeyFrame.time_ - keyFrame.time_;
+        float t = timeInterval > 0.0f ? (time - keyFrame.time_) / timeInterval : 1.0f;
+
+        AnimationKeyFrame ret;
+        ret.time_ = time;
+        ret.position_ = keyFrame.position_.Lerp(nextKeyFrame.position_, t);
+        ret.rotation_ = keyFrame.rotation_.Slerp(nextKeyFrame.rotation_, t);
+        ret.scale_ = keyFrame.scale_.Lerp(nextKeyFrame.scale_, t);
+        return ret;
+    }
+
+    /// Return the components of a channel of a keyframe.
+    static void GetChannelComponents(const AnimationKeyFrame& keyFrame, unsigned channel, float* dest)
+    {
+        switch (channel)
+        {
+        case 0:
+            dest[0] = keyFrame.position_.x_;
+            dest[1] = keyFrame.position_.y_;
+            dest[2] = keyFrame.position_.z_;
+            break;
+
+        case 1:
+            dest[0] = keyFrame.rotation_.x_;
+            dest[1] = keyFrame.rotation_.y_;
+            dest[2] = keyFrame.rotation_.z_;
+            dest[3] = keyFrame.rotation_.w_;
+            break;
+
+        default:
+            dest[0] = keyFrame.scale_.x_;
+            dest[1] = keyFrame.scale_.y_;
+            dest[2] = keyFrame.scale_.z_;
+            break;
+        }
+    }
+
+    /// Dequantize and interpolate one component of a block of animated lanes between two frames.
+    static void SampleLanes(float* dest, const unsigned short* from, const unsigned short* to, const float* offsets, const float* scales,
+        float t, unsigned numLanes)
+    {
+#if ALIMER_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 tv = _mm_set1_ps(t);
+        for (unsigned i = 0; i < numLanes; i += COMPRESSED_ANIMATION_LANES)
+        {
+            __m128 a = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(from + i)), zero));
+            __m128 b = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(to + i)), zero));
+            __m128 q = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), tv));
+            _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(offsets + i), _mm_mul_ps(q, _mm_loadu_ps(scales + i))));
+        }
+#elif ALIMER_NEON
+        const float32x4_t tv = vdupq_n_f32(t);
+        for (unsigned i = 0; i < numLanes; i += COMPRESSED_ANIMATION_LANES)
+        {
+            float32x4_t a = vcvtq_f32_u32(vmovl_u16(vld1_u16(from + i)));
+            float32x4_t b = vcvtq_f32_u32(vmovl_u16(vld1_u16(to + i)));
+            float32x4_t q = vmlaq_f32(a, vsubq_f32(b, a), tv);
+            vst1q_f32(dest + i, vmlaq_f32(vld1q_f32(offsets + i), q, vld1q_f32(scales + i)));
+        }
+#else
+        for (unsigned i = 0; i < numLanes; ++i)
+        {
+            float a = (float)from[i];
+            float q = a + ((float)to[i] - a) * t;
+            dest[i] = offsets[i] + q * scales[i];
+        }
+#endif
+    }
+
+    /// Normalize the rotations of a block of lanes.
+    static void NormalizeRotationLanes(float* x, float* y, float* z, float* w, unsigned numLanes)
+    {
+#if ALIMER_SSE2
+        const __m128 one = _mm_set1_ps(1.0f);
+        for (unsigned i = 0; i < numLanes; i += COMPRESSED_ANIMATION_LANES)
+        {
+            __m128 vx = _mm_loadu_ps(x + i);
+            __m128 vy = _mm_loadu_ps(y + i);
+            __m128 vz = _mm_loadu_ps(z + i);
+            __m128 vw = _mm_loadu_ps(w + i);
+            __m128 lenSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)),
+                _mm_add_ps(_mm_mul_ps(vz, vz), _mm_mul_ps(vw, vw)));
+            __m128 invLen = _mm_div_ps(one, _mm_sqrt_ps(lenSquared));
+            _mm_storeu_ps(x + i, _mm_mul_ps(vx, invLen));
+            _mm_storeu_ps(y + i, _mm_mul_ps(vy, invLen));
+            _mm_storeu_ps(z + i, _mm_mul_ps(vz, invLen));
+            _mm_storeu_ps(w + i, _mm_mul_ps(vw, invLen));
+        }
+#elif ALIMER_NEON
+        for (unsigned i = 0; i < numLanes; i += COMPRESSED_ANIMATION_LANES)
+        {
+            float32x4_t vx = vld1q_f32(x + i);
+            float32x4_t vy = vld1q_f32(y + i);
+            float32x4_t vz = vld1q_f32(z + i);
+            float32x4_t vw = vld1q_f32(w + i);
+            float32x4_t lenSquared = vmlaq_f32(vmlaq_f32(vmlaq_f32(vmulq_f32(vx, vx), vy, vy), vz, vz), vw, vw);
+            // Reciprocal square root estimate refined with two Newton-Raphson steps
+            float32x4_t invLen = vrsqrteq_f32(lenSquared);
+            invLen = vmulq_f32(invLen, vrsqrtsq_f32(vmulq_f32(lenSquared, invLen), invLen));
+            invLen = vmulq_f32(invLen, vrsqrtsq_f32(vmulq_f32(lenSquared, invLen), invLen));
+            vst1q_f32(x + i, vmulq_f32(vx, invLen));
+            vst1q_f32(y + i, vmulq_f32(vy, invLen));
+            vst1q_f32(z + i, vmulq_f32(vz, invLen));
+            vst1q_f32(w + i, vmulq_f32(vw, invLen));
+        }
+#else
+        for (unsigned i = 0; i < numLanes; ++i)
+        {
+            float invLen = 1.0f / sqrtf(x[i] * x[i] + y[i] * y[i] + z[i] * z[i] + w[i] * w[i]);
+            x[i] *= invLen;
+            y[i] *= invLen;
+            z[i] *= invLen;
+            w[i] *= invLen;
+        }
+#endif
+    }
+
+    void CompressedAnimation::Sample(float time, AnimationPose& dest) const
+    {
+        if (!numFrames_)
+            return;
+
+        float frame = Clamp(time * frameRate_, 0.0f, (float)(numFrames_ - 1));
+        auto frame0 = (unsigned)frame;
+        unsigned frame1 = Min(frame0 + 1, numFrames_ - 1);
+        float t = frame - (float)frame0;
+
+        for (unsigned c = 0; c < NUM_COMPRESSED_ANIMATION_CHANNELS; ++c)
+        {
+            const CompressedAnimationChannel& channel = channels_[c];
+            unsigned numComponents = channel.numComponents_;
+            unsigned numPaddedLanes = channel.GetNumPaddedLanes();
+            unsigned numPaddedAnimated = channel.GetNumPaddedAnimatedLanes();
+
+            PODVector<float>& values = dest.channels_[c];
+            values.Resize(numComponents * numPaddedLanes);
+            if (values.Empty())
+                continue;
+
+            // Constant lanes are copied as is, animated lanes are then sampled over the zeroes stored for them
+            memcpy(values.Buffer(), channel.constants_.Buffer(), values.Size() * sizeof(float));
+            if (!numPaddedAnimated)
+                continue;
+
+            const unsigned short* samples0 = &channel.samples_[frame0 * numComponents * numPaddedAnimated];
+            const unsigned short* samples1 = &channel.samples_[frame1 * numComponents * numPaddedAnimated];
+            for (unsigned k = 0; k < numComponents; ++k)
+            {
+                unsigned offset = k * numPaddedAnimated;
+                SampleLanes(&values[k * numPaddedLanes], samples0 + offset, samples1 + offset, &channel.offsets_[offset],
+                    &channel.scales_[offset], t, numPaddedAnimated);
+            }
+
+            if (numComponents == 4)
+            {
+                float* x = values.Buffer();
+                NormalizeRotationLanes(x, x + numPaddedLanes, x + 2 * numPaddedLanes, x + 3 * numPaddedLanes, numPaddedAnimated);
+            }
+        }
+    }
+
+    void CompressedAnimation::Blend(float* dest, const float* src, const float* weights, unsigned numComponents, unsigned numPaddedLanes)
+    {
+        if (numComponents == 4)
+        {
+            float* x = dest;
+            float* y = dest + numPaddedLanes;
+            float* z = dest + 2 * numPaddedLanes;
+            float* w = dest + 3 * numPaddedLanes;
+            const float* sx = src;
+            const float* sy = src + numPaddedLanes;
+            const float* sz = src + 2 * numPaddedLanes;
+            const float* sw = src + 3 * numPaddedLanes;
+
+#if ALIMER_SSE2
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 signBit = _mm_set1_ps(-0.0f);
+            for (unsigned i = 0; i < numPaddedLanes; i += COMPRESSED_ANIMATION_LANES)
+            {
+                __m128 vx = _mm_loadu_ps(x + i);
+                __m128 vy = _mm_loadu_ps(y + i);
+                __m128 vz = _mm_loadu_ps(z + i);
+                __m128 vw = _mm_loadu_ps(w + i);
+                __m128 svx = _mm_loadu_ps(sx + i);
+                __m128 svy = _mm_loadu_ps(sy + i);
+                __m128 svz = _mm_loadu_ps(sz + i);
+                __m128 svw = _mm_loadu_ps(sw + i);
+                __m128 weight = _mm_loadu_ps(weights + i);
+
+                // Negate the source rotations in the opposite hemisphere to blend along the shorter path
+                __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, svx), _mm_mul_ps(vy, svy)),
+                    _mm_add_ps(_mm_mul_ps(vz, svz), _mm_mul_ps(vw, svw)));
+                __m128 sign = _mm_and_ps(_mm_cmplt_ps(dot, zero), signBit);
+                svx = _mm_xor_ps(svx, sign);
+                svy = _mm_xor_ps(svy, sign);
+                svz = _mm_xor_ps(svz, sign);
+                svw = _mm_xor_ps(svw, sign);
+
+                _mm_storeu_ps(x + i, _mm_add_ps(vx, _mm_mul_ps(_mm_sub_ps(svx, vx), weight)));
+                _mm_storeu_ps(y + i, _mm_add_ps(vy, _mm_mul_ps(_mm_sub_ps(svy, vy), weight)));
+                _mm_storeu_ps(z + i, _mm_add_ps(vz, _mm_mul_ps(_mm_sub_ps(svz, vz), weight)));
+                _mm_storeu_ps(w + i, _mm_add_ps(vw, _mm_mul_ps(_mm_sub_ps(svw, vw), weight)));
+            }
+#elif ALIMER_NEON
+            for (unsigned i = 0; i < numPaddedLanes; i += COMPRESSED_ANIMATION_LANES)
+            {
+                float32x4_t vx = vld1q_f32(x + i);
+                float32x4_t vy = vld1q_f32(y + i);
+                float32x4_t vz = vld1q_f32(z + i);
+                float32x4_t vw = vld1q_f32(w + i);
+                float32x4_t svx = vld1q_f32(sx + i);
+                float32x4_t svy = vld1q_f32(sy + i);
+                float32x4_t svz = vld1q_f32(sz + i);
+                float32x4_t svw = vld1q_f32(sw + i);
+                float32x4_t weight = vld1q_f32(weights + i);
+
+                // Negate the source rotations in the opposite hemisphere to blend along the shorter path
+                float32x4_t dot = vmlaq_f32(vmlaq_f32(vmlaq_f32(vmulq_f32(vx, svx), vy, svy), vz, svz), vw, svw);
+                float32x4_t sign = vbslq_f32(vcltq_f32(dot, vdupq_n_f32(0.0f)), vdupq_n_f32(-1.0f), vdupq_n_f32(1.0f));
+                svx = vmulq_f32(svx, sign);
+                svy = vmulq_f32(svy, sign);
+                svz = vmulq_f32(svz, sign);
+                svw = vmulq_f32(svw, sign);
+
+                vst1q_f32(x + i, vmlaq_f32(vx, vsubq_f32(svx, vx), weight));
+                vst1q_f32(y + i, vmlaq_f32(vy, vsubq_f32(svy, vy), weight));
+                vst1q_f32(z + i, vmlaq_f32(vz, vsubq_f32(svz, vz), weight));
+                vst1q_f32(w + i, vmlaq_f32(vw, vsubq_f32(svw, vw), weight));
+            }
+#else
+            for (unsigned i = 0; i < numPaddedLanes; ++i)
+            {
+                // Negate the source rotations in the opposite hemisphere to blend along the shorter path
+                float dot = x[i] * sx[i] + y[i] * sy[i] + z[i] * sz[i] + w[i] * sw[i];
+                float sign = dot < 0.0f ? -1.0f : 1.0f;
+                x[i] += (sx[i] * sign - x[i]) * weights[i];
+                y[i] += (sy[i] * sign - y[i]) * weights[i];
+                z[i] += (sz[i] * sign - z[i]) * weights[i];
+                w[i] += (sw[i] * sign - w[i]) * weights[i];
+            }
+#endif
+
+            NormalizeRotationLanes(x, y, z, w, numPaddedLanes);
+            return;
+        }
+
+        for (unsigned k = 0; k < numComponents; ++k)
+        {
+            float* d = dest + k * numPaddedLanes;
+            const float* s = src + k * numPaddedLanes;
+
+#if ALIMER_SSE2
+            for (unsigned i = 0; i < numPaddedLanes; i += COMPRESSED_ANIMATION_LANES)
+            {
+                __m128 v = _mm_loadu_ps(d + i);
+                _mm_storeu_ps(d + i, _mm_add_ps(v, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(s + i), v), _mm_loadu_ps(weights + i))));
+            }
+#elif ALIMER_NEON
+            for (unsigned i = 0; i < numPaddedLanes; i += COMPRESSED_ANIMATION_LANES)
+            {
+                float32x4_t v = vld1q_f32(d + i);
+                vst1q_f32(d + i, vmlaq_f32(v, vsubq_f32(vld1q_f32(s + i), v), vld1q_f32(weights + i)));
+            }
+#else
+            for (unsigned i = 0; i < numPaddedLanes; ++i)
+                d[i] += (s[i] - d[i]) * weights[i];
+#endif
+        }
+    }
+
+    void CompressedAnimation::GetTransform(const AnimationPose& pose, unsigned track, Vector3& position, Quaternion& rotation,
+        Vector3& scale) const
+    {
+        for (unsigned c = 0; c < NUM_COMPRESSED_ANIMATION_CHANNELS; ++c)
+        {
+            const CompressedAnimationChannel& channel = channels_[c];
+            if (track >= channel.lanes_.Size() || channel.lanes_[track] == M_MAX_UNSIGNED)
+                continue;
+
+            unsigned lane = channel.lanes_[track];
+            unsigned numPaddedLanes = channel.GetNumPaddedLanes();
+            const float* values = &pose.channels_[c][lane];
+
+            switch (c)
+            {
+            case 0:
+                position = Vector3(values[0], values[numPaddedLanes], values[2 * numPaddedLanes]);
+                break;
+
+            case 1:
+                rotation = Quaternion(values[3 * numPaddedLanes], values[0], values[numPaddedLanes], values[2 * numPaddedLanes]);
+                break;
+
+            default:
+                scale = Vector3(values[0], values[numPaddedLanes], values[2 * numPaddedLanes]);
+                break;
+            }
+        }
+    }
+
+    unsigned CompressedAnimation::GetMemoryUse() const
+    {
+        unsigned memoryUse = sizeof(CompressedAnimation);
+        for (unsigned c = 0; c < NUM_COMPRESSED_ANIMATION_CHANNELS; ++c)
+        {
+            const CompressedAnimationChannel& channel = channels_[c];
+            memoryUse += (channel.tracks_.Size() + channel.lanes_.Size()) * sizeof(unsigned);
+            memoryUse += (channel.offsets_.Size() + channel.scales_.Size() + channel.constants_.Size()) * sizeof(float);
+            memoryUse += channel.samples_.Size() * sizeof(unsigned short);
+        }
+
+        return memoryUse;
+    }
+
     Animation::Animation(Context* context) :
         ResourceWithMetadata(context),
         length_(0.f)
@@ -125,10 +525,9 @@ namespace Urho3D
 
     bool Animation::BeginLoad(Deserializer& source)
     {
-        unsigned memoryUse = sizeof(Animation);
-
-        // Check ID
-        if (source.ReadFileID() != "UANI")
+        // Check ID. Compressed animations store the compressed data after the tracks
+        String fileID = source.ReadFileID();
+        if (fileID != "UANI" && fileID != "UCAN")
         {
             URHO3D_LOGERROR(source.GetName() + " is not a valid animation file");
             return false;
@@ -139,9 +538,9 @@ namespace Urho3D
         animationNameHash_ = animationName_;
         length_ = source.ReadFloat();
         tracks_.Clear();
+        compressed_.Reset();
 
         unsigned tracks = source.ReadUInt();
-        memoryUse += tracks * sizeof(AnimationTrack);
 
         // Read tracks
         for (unsigned i = 0; i < tracks; ++i)
@@ -151,7 +550,6 @@ namespace Urho3D
 
             unsigned keyFrames = source.ReadUInt();
             newTrack->keyFrames_.Resize(keyFrames);
-            memoryUse += keyFrames * sizeof(AnimationKeyFrame);
 
             // Read keyframes of the track
             for (unsigned j = 0; j < keyFrames; ++j)
@@ -167,6 +565,12 @@ namespace Urho3D
             }
         }
 
+        if (fileID == "UCAN" && !LoadCompressed(source))
+        {
+            URHO3D_LOGERROR(source.GetName() + " has invalid compressed animation data");
+            return false;
+        }
+
         // Optionally read triggers from an XML file
         auto* cache = GetSubsystem<ResourceCache>();
         String xmlName = ReplaceExtension(GetName(), ".xml");
@@ -185,8 +589,7 @@ namespace Urho3D
 
             LoadMetadataFromXML(rootElem);
 
-            memoryUse += triggers_.Size() * sizeof(AnimationTriggerPoint);
-            SetMemoryUse(memoryUse);
+            RefreshMemoryUse();
             return true;
         }
 
@@ -216,19 +619,18 @@ namespace Urho3D
             const JSONArray& metadataArray = rootVal.Get("metadata").GetArray();
             LoadMetadataFromJSON(metadataArray);
 
-            memoryUse += triggers_.Size() * sizeof(AnimationTriggerPoint);
-            SetMemoryUse(memoryUse);
+            RefreshMemoryUse();
             return true;
         }
 
-        SetMemoryUse(memoryUse);
+        RefreshMemoryUse();
         return true;
     }
 
     bool Animation::Save(Serializer& dest) const
     {
         // Write ID, name and length
-        dest.WriteFileID("UANI");
+        dest.WriteFileID(compressed_ ? "UCAN" : "UANI");
         dest.WriteString(animationName_);
         dest.WriteFloat(length_);
 
@@ -255,6 +657,9 @@ namespace Urho3D
             }
         }
 
+        if (compressed_)
+            SaveCompressed(dest);
+
         // If triggers have been defined, write an XML file for them
         if (!triggers_.Empty() || HasMetadata())
         {
@@ -315,7 +720,9 @@ namespace Urho3D
         HashMap<StringHash, AnimationTrack>::Iterator i = tracks_.Find(StringHash(name));
         if (i != tracks_.End())
         {
+            // The compressed data refers to the tracks by index
             tracks_.Erase(i);
+            RemoveCompressed();
             return true;
         }
         else
@@ -325,6 +732,7 @@ namespace Urho3D
     void Animation::RemoveAllTracks()
     {
         tracks_.Clear();
+        RemoveCompressed();
     }
 
     void Animation::SetTrigger(unsigned index, const AnimationTriggerPoint& trigger)
@@ -379,12 +787,212 @@ namespace Urho3D
         ret->length_ = length_;
         ret->tracks_ = tracks_;
         ret->triggers_ = triggers_;
+        if (compressed_)
+            ret->compressed_ = new CompressedAnimation(*compressed_);
         ret->CopyMetadata(*this);
         ret->SetMemoryUse(GetMemoryUse());
 
         return ret;
     }
 
+    void Animation::ReduceKeyFrames(float tolerance, float angleTolerance)
+    {
+        for (HashMap<StringHash, AnimationTrack>::Iterator i = tracks_.Begin(); i != tracks_.End(); ++i)
+            i->second_.ReduceKeyFrames(tolerance, angleTolerance);
+
+        RefreshMemoryUse();
+    }
+
+    bool Animation::Compress(float frameRate, bool keepKeyFrames)
+    {
+        if (frameRate <= 0.0f)
+        {
+            URHO3D_LOGERROR("Animation compression frame rate must be positive");
+            return false;
+        }
+
+        if (compressed_)
+        {
+            bool hasKeyFrames = tracks_.Empty();
+            for (HashMap<StringHash, AnimationTrack>::ConstIterator i = tracks_.Begin(); i != tracks_.End() && !hasKeyFrames; ++i)
+                hasKeyFrames = !i->second_.keyFrames_.Empty();
+            if (!hasKeyFrames)
+            {
+                URHO3D_LOGERROR("Can not compress animation " + animationName_ + " again, as its keyframes were not kept");
+                return false;
+            }
+        }
+
+        URHO3D_PROFILE(CompressAnimation);
+
+        unsigned numTracks = tracks_.Size();
+        unsigned numFrames = (unsigned)CeilToInt(length_ * frameRate) + 1;
+
+        // Resample the tracks at the frame rate. Rotations are kept in the hemisphere of the previous frame so that interpolating
+        // between frames takes the shorter path
+        Vector<AnimationKeyFrame> frames(numTracks * numFrames);
+        unsigned index = 0;
+        for (HashMap<StringHash, AnimationTrack>::ConstIterator i = tracks_.Begin(); i != tracks_.End(); ++i, ++index)
+        {
+            const AnimationTrack& track = i->second_;
+            if (track.keyFrames_.Empty())
+                continue;
+
+            AnimationKeyFrame* trackFrames = &frames[index * numFrames];
+            unsigned keyFrame = 0;
+            for (unsigned j = 0; j < numFrames; ++j)
+            {
+                trackFrames[j] = SampleTrack(track, Min((float)j / frameRate, length_), keyFrame);
+                trackFrames[j].rotation_.Normalize();
+                if (j && trackFrames[j].rotation_.DotProduct(trackFrames[j - 1].rotation_) < 0.0f)
+                    trackFrames[j].rotation_ = -trackFrames[j].rotation_;
+            }
+        }
+
+        auto* compressed = new CompressedAnimation();
+        compressed->frameRate_ = frameRate;
+        compressed->numFrames_ = numFrames;
+
+        for (unsigned c = 0; c < NUM_COMPRESSED_ANIMATION_CHANNELS; ++c)
+        {
+            CompressedAnimationChannel& channel = compressed->channels_[c];
+            unsigned numComponents = c == 1 ? 4 : 3;
+            channel.numComponents_ = numComponents;
+
+            // Find the range of each component of each track. Tracks whose components do not change become constant lanes
+            PODVector<unsigned> animated;
+            PODVector<unsigned> constant;
+            PODVector<float> minimums(numTracks * 4);
+            PODVector<float> ranges(numTracks * 4);
+            index = 0;
+            for (HashMap<StringHash, AnimationTrack>::ConstIterator i = tracks_.Begin(); i != tracks_.End(); ++i, ++index)
+            {
+                const AnimationTrack& track = i->second_;
+                if ((track.channelMask_ & compressedChannelFlags[c]) == AnimationChannelFlags::None || track.keyFrames_.Empty())
+                    continue;
+
+                float minimum[4];
+                float maximum[4];
+                GetChannelComponents(frames[index * numFrames], c, minimum);
+                GetChannelComponents(frames[index * numFrames], c, maximum);
+                for (unsigned j = 1; j < numFrames; ++j)
+                {
+                    float values[4];
+                    GetChannelComponents(frames[index * numFrames + j], c, values);
+                    for (unsigned k = 0; k < numComponents; ++k)
+                    {
+                        minimum[k] = Min(minimum[k], values[k]);
+                        maximum[k] = Max(maximum[k], values[k]);
+                    }
+                }
+
+                bool isConstant = true;
+                for (unsigned k = 0; k < numComponents; ++k)
+                {
+                    minimums[index * 4 + k] = minimum[k];
+                    ranges[index * 4 + k] = maximum[k] - minimum[k];
+                    if (maximum[k] - minimum[k] > COMPRESSED_CONSTANT_EPSILON)
+                        isConstant = false;
+                }
+
+                if (isConstant)
+                    constant.Push(index);
+                else
+                    animated.Push(index);
+            }
+
+            channel.numAnimated_ = animated.Size();
+            unsigned numPaddedAnimated = channel.GetNumPaddedAnimatedLanes();
+            channel.tracks_.Resize(numPaddedAnimated + constant.Size());
+            for (unsigned j = 0; j < channel.tracks_.Size(); ++j)
+                channel.tracks_[j] = M_MAX_UNSIGNED;
+            for (unsigned j = 0; j < animated.Size(); ++j)
+                channel.tracks_[j] = animated[j];
+            for (unsigned j = 0; j < constant.Size(); ++j)
+                channel.tracks_[numPaddedAnimated + j] = constant[j];
+
+            unsigned numPaddedLanes = channel.GetNumPaddedLanes();
+            channel.offsets_.Resize(numComponents * numPaddedAnimated);
+            channel.scales_.Resize(numComponents * numPaddedAnimated);
+            channel.constants_.Resize(numComponents * numPaddedLanes);
+            channel.samples_.Resize(numFrames * numComponents * numPaddedAnimated);
+            memset(channel.offsets_.Buffer(), 0, channel.offsets_.Size() * sizeof(float));
+            memset(channel.scales_.Buffer(), 0, channel.scales_.Size() * sizeof(float));
+            memset(channel.constants_.Buffer(), 0, channel.constants_.Size() * sizeof(float));
+            memset(channel.samples_.Buffer(), 0, channel.samples_.Size() * sizeof(unsigned short));
+
+            // Quantize the animated lanes relative to the range of each component
+            for (unsigned j = 0; j < animated.Size(); ++j)
+            {
+                unsigned track = animated[j];
+                for (unsigned k = 0; k < numComponents; ++k)
+                {
+                    float minimum = minimums[track * 4 + k];
+                    float range = ranges[track * 4 + k];
+                    channel.offsets_[k * numPaddedAnimated + j] = minimum;
+                    channel.scales_[k * numPaddedAnimated + j] = range / COMPRESSED_SAMPLE_MAX;
+                    if (range <= 0.0f)
+                        continue;
+
+                    for (unsigned f = 0; f < numFrames; ++f)
+                    {
+                        float values[4];
+                        GetChannelComponents(frames[track * numFrames + f], c, values);
+                        channel.samples_[(f * numComponents + k) * numPaddedAnimated + j] =
+                            (unsigned short)Clamp(RoundToInt((values[k] - minimum) / range * COMPRESSED_SAMPLE_MAX), 0, 65535);
+                    }
+                }
+            }
+
+            for (unsigned j = 0; j < constant.Size(); ++j)
+            {
+                float values[4];
+                GetChannelComponents(frames[constant[j] * numFrames], c, values);
+                for (unsigned k = 0; k < numComponents; ++k)
+                    channel.constants_[k * numPaddedLanes + numPaddedAnimated + j] = values[k];
+            }
+
+            // Padding lanes hold identity rotations so that normalizing them is well-defined
+            if (numComponents == 4)
+            {
+                for (unsigned j = 0; j < numPaddedLanes; ++j)
+                {
+                    if (j < channel.tracks_.Size() && channel.tracks_[j] != M_MAX_UNSIGNED)
+                        continue;
+                    if (j < numPaddedAnimated)
+                        channel.offsets_[3 * numPaddedAnimated + j] = 1.0f;
+                    else
+                        channel.constants_[3 * numPaddedLanes + j] = 1.0f;
+                }
+            }
+        }
+
+        compressed_ = compressed;
+        RefreshCompressedIndices();
+
+        if (!keepKeyFrames)
+        {
+            for (HashMap<StringHash, AnimationTrack>::Iterator i = tracks_.Begin(); i != tracks_.End(); ++i)
+            {
+                i->second_.keyFrames_.Clear();
+                i->second_.keyFrames_.Compact();
+            }
+        }
+
+        RefreshMemoryUse();
+        return true;
+    }
+
+    void Animation::RemoveCompressed()
+    {
+        if (!compressed_)
+            return;
+
+        compressed_.Reset();
+        RefreshCompressedIndices();
+        RefreshMemoryUse();
+    }
+
     AnimationTrack* Animation::GetTrack(unsigned index)
     {
         if (index >= GetNumTracks())
@@ -419,4 +1027,101 @@ namespace Urho3D
         return index < triggers_.Size() ? &triggers_[index] : nullptr;
     }
 
+    bool Animation::LoadCompressed(Deserializer& source)
+    {
+        UniquePtr<CompressedAnimation> compressed(new CompressedAnimation());
+        compressed->frameRate_ = source.ReadFloat();
+        compressed->numFrames_ = source.ReadUInt();
+        if (compressed->frameRate_ <= 0.0f || !compressed->numFrames_)
+            return false;
+
+        unsigned numTracks = tracks_.Size();
+        for (unsigned c = 0; c < NUM_COMPRESSED_ANIMATION_CHANNELS; ++c)
+        {
+            CompressedAnimationChannel& channel = compressed->channels_[c];
+            channel.numComponents_ = c == 1 ? 4 : 3;
+            channel.numAnimated_ = source.ReadUInt();
+            channel.tracks_.Resize(source.ReadUInt());
+            source.Read(channel.tracks_.Buffer(), channel.tracks_.Size() * sizeof(unsigned));
+
+            unsigned numComponents = channel.numComponents_;
+            unsigned numPaddedAnimated = channel.GetNumPaddedAnimatedLanes();
+            if (numPaddedAnimated > channel.tracks_.Size())
+                return false;
+            for (unsigned j = 0; j < channel.tracks_.Size(); ++j)
+            {
+                if (channel.tracks_[j] >= numTracks && channel.tracks_[j] != M_MAX_UNSIGNED)
+                    return false;
+            }
+
+            channel.offsets_.Resize(numComponents * numPaddedAnimated);
+            channel.scales_.Resize(numComponents * numPaddedAnimated);
+            channel.constants_.Resize(numComponents * channel.GetNumPaddedLanes());
+            channel.samples_.Resize(compressed->numFrames_ * numComponents * numPaddedAnimated);
+            source.Read(channel.offsets_.Buffer(), channel.offsets_.Size() * sizeof(float));
+            source.Read(channel.scales_.Buffer(), channel.scales_.Size() * sizeof(float));
+            source.Read(channel.constants_.Buffer(), channel.constants_.Size() * sizeof(float));
+            if (source.Read(channel.samples_.Buffer(), channel.samples_.Size() * sizeof(unsigned short)) !=
+                channel.samples_.Size() * sizeof(unsigned short))
+                return false;
+        }
+
+        compressed_ = compressed.Detach();
+        RefreshCompressedIndices();
+        return true;
+    }
+
+    void Animation::SaveCompressed(Serializer& dest) const
+    {
+        dest.WriteFloat(compressed_->frameRate_);
+        dest.WriteUInt(compressed_->numFrames_);
+
+        for (unsigned c = 0; c < NUM_COMPRESSED_ANIMATION_CHANNELS; ++c)
+        {
+            const CompressedAnimationChannel& channel = compressed_->channels_[c];
+            dest.WriteUInt(channel.numAnimated_);
+            dest.WriteUInt(channel.tracks_.Size());
+            dest.Write(channel.tracks_.Buffer(), channel.tracks_.Size() * sizeof(unsigned));
+            dest.Write(channel.offsets_.Buffer(), channel.offsets_.Size() * sizeof(float));
+            dest.Write(channel.scales_.Buffer(), channel.scales_.Size() * sizeof(float));
+            dest.Write(channel.constants_.Buffer(), channel.constants_.Size() * sizeof(float));
+            dest.Write(channel.samples_.Buffer(), channel.samples_.Size() * sizeof(unsigned short));
+        }
+    }
+
+    void Animation::RefreshCompressedIndices()
+    {
+        unsigned numTracks = tracks_.Size();
+        unsigned index = 0;
+        for (HashMap<StringHash, AnimationTrack>::Iterator i = tracks_.Begin(); i != tracks_.End(); ++i, ++index)
+            i->second_.compressedIndex_ = compressed_ ? index : M_MAX_UNSIGNED;
+
+        if (!compressed_)
+            return;
+
+        for (unsigned c = 0; c < NUM_COMPRESSED_ANIMATION_CHANNELS; ++c)
+        {
+            CompressedAnimationChannel& channel = compressed_->channels_[c];
+            channel.lanes_.Resize(numTracks);
+            for (unsigned j = 0; j < numTracks; ++j)
+                channel.lanes_[j] = M_MAX_UNSIGNED;
+            for (unsigned j = 0; j < channel.tracks_.Size(); ++j)
+            {
+                if (channel.tracks_[j] < numTracks)
+                    channel.lanes_[channel.tracks_[j]] = j;
+            }
+        }
+    }
+
+    void Animation::RefreshMemoryUse()
+    {
+        unsigned memoryUse = sizeof(Animation) + tracks_.Size() * sizeof(AnimationTrack) + triggers_.Size() * sizeof(AnimationTriggerPoint);
+        for (HashMap<StringHash, AnimationTrack>::ConstIterator i = tracks_.Begin(); i != tracks_.End(); ++i)
+            memoryUse += i->second_.keyFrames_.Size() * sizeof(AnimationKeyFrame);
+        if (compressed_)
+            memoryUse += compressed_->GetMemoryUse();
+
+        SetMemoryUse(memoryUse);
+    }
+
 }
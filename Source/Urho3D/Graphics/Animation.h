@@ -88,6 +88,8 @@ namespace Urho3D
         unsigned GetNumKeyFrames() const { return keyFrames_.Size(); }
         /// Return keyframe index based on time and previous index. Return false if animation is empty.
         bool GetKeyFrameIndex(float time, unsigned& index) const;
+        /// Remove keyframes that can be reproduced by interpolating their neighbours within tolerance. Position and scale errors are compared to the tolerance, and rotation errors to the angle tolerance in degrees.
+        void ReduceKeyFrames(float tolerance, float angleTolerance);
 
         /// Bone or scene node name.
         String name_;
@@ -95,8 +97,68 @@ namespace Urho3D
         StringHash nameHash_;
         /// Bitmask of included data (position, rotation, scale).
         AnimationChannelFlags channelMask_{};
-        /// Keyframes.
+        /// Keyframes. Empty if the animation has been compressed without keeping the keyframes.
         Vector<AnimationKeyFrame> keyFrames_;
+        /// Index in the compressed animation data, or M_MAX_UNSIGNED if not compressed.
+        unsigned compressedIndex_{M_MAX_UNSIGNED};
+    };
+
+    /// Number of channels in compressed animation data: position, rotation and scale.
+    static const unsigned NUM_COMPRESSED_ANIMATION_CHANNELS = 3;
+    /// Number of lanes sampled together in compressed animation data. Lane counts are padded to a multiple of this.
+    static const unsigned COMPRESSED_ANIMATION_LANES = 4;
+
+    /// Compressed samples of one channel (position, rotation or scale) of all the tracks containing it. Each track occupies a lane. The lanes with per-frame samples come first, padded to a multiple of COMPRESSED_ANIMATION_LANES, followed by the lanes whose value is constant.
+    struct CompressedAnimationChannel
+    {
+        /// Return number of lanes padded to a multiple of COMPRESSED_ANIMATION_LANES.
+        unsigned GetNumPaddedLanes() const { return (tracks_.Size() + COMPRESSED_ANIMATION_LANES - 1) & ~(COMPRESSED_ANIMATION_LANES - 1); }
+        /// Return number of lanes with per-frame samples padded to a multiple of COMPRESSED_ANIMATION_LANES.
+        unsigned GetNumPaddedAnimatedLanes() const { return (numAnimated_ + COMPRESSED_ANIMATION_LANES - 1) & ~(COMPRESSED_ANIMATION_LANES - 1); }
+
+        /// Number of components: 3 for position and scale, 4 for rotation.
+        unsigned numComponents_{};
+        /// Number of lanes with per-frame samples.
+        unsigned numAnimated_{};
+        /// Track index of each lane, or M_MAX_UNSIGNED for padding lanes.
+        PODVector<unsigned> tracks_;
+        /// Lane of each track, or M_MAX_UNSIGNED if the track does not contain the channel.
+        PODVector<unsigned> lanes_;
+        /// Dequantization offsets of the animated lanes. The components of all lanes are stored consecutively: first the X components of the lanes, then the Y components and so on.
+        PODVector<float> offsets_;
+        /// Dequantization scales of the animated lanes, in the same layout as the offsets.
+        PODVector<float> scales_;
+        /// Values of the constant lanes in the same layout as the sampled pose. Zero for the animated lanes.
+        PODVector<float> constants_;
+        /// Quantized 16-bit samples of the animated lanes. Each frame stores the samples in the same layout as the offsets.
+        PODVector<unsigned short> samples_;
+    };
+
+    /// Pose of all tracks of a compressed animation. Each channel stores the components of all its lanes consecutively, padded like CompressedAnimationChannel.
+    struct AnimationPose
+    {
+        /// Position, rotation and scale components.
+        PODVector<float> channels_[NUM_COMPRESSED_ANIMATION_CHANNELS];
+    };
+
+    /// Compressed skeletal animation data. Tracks are resampled at a fixed frame rate, and the samples of all tracks of a frame are stored together in structure-of-arrays layout, so that whole poses are sampled and blended with SIMD.
+    struct URHO3D_API CompressedAnimation
+    {
+        /// Sample all tracks at time position into a pose.
+        void Sample(float time, AnimationPose& dest) const;
+        /// Blend the components of a channel of a source pose into a destination pose with per-lane weights. Rotations are blended with normalized linear interpolation.
+        static void Blend(float* dest, const float* src, const float* weights, unsigned numComponents, unsigned numPaddedLanes);
+        /// Return the transform of a track from a sampled pose. Channels the track does not contain are left unchanged.
+        void GetTransform(const AnimationPose& pose, unsigned track, Vector3& position, Quaternion& rotation, Vector3& scale) const;
+        /// Return memory use in bytes.
+        unsigned GetMemoryUse() const;
+
+        /// Sampling frame rate.
+        float frameRate_{};
+        /// Number of frames.
+        unsigned numFrames_{};
+        /// Position, rotation and scale channels.
+        CompressedAnimationChannel channels_[NUM_COMPRESSED_ANIMATION_CHANNELS];
     };
 
     /// %Animation trigger point.
@@ -161,6 +223,12 @@ namespace Urho3D
         void SetNumTriggers(unsigned num);
         /// Clone the animation.
         SharedPtr<Animation> Clone(const String& cloneName = String::EMPTY) const;
+        /// Remove redundant keyframes of all tracks. See AnimationTrack::ReduceKeyFrames().
+        void ReduceKeyFrames(float tolerance, float angleTolerance);
+        /// Compress the keyframes of all tracks by resampling at a frame rate and quantizing. Optionally keep the keyframes, otherwise the compressed data is the only copy and is also what Save() writes. Compress again after modifying the tracks. Return true if successful.
+        bool Compress(float frameRate, bool keepKeyFrames = false);
+        /// Remove the compressed data. The keyframes are lost if they were not kept.
+        void RemoveCompressed();
 
         /// Return animation name.
         /// @property
@@ -199,7 +267,22 @@ namespace Urho3D
         /// Return a trigger point by index.
         AnimationTriggerPoint* GetTrigger(unsigned index);
 
+        /// Return compressed data, or null if not compressed.
+        const CompressedAnimation* GetCompressed() const { return compressed_.Get(); }
+
+        /// Return whether has compressed data.
+        bool IsCompressed() const { return compressed_.NotNull(); }
+
     private:
+        /// Load compressed data after the tracks. Return true if successful.
+        bool LoadCompressed(Deserializer& source);
+        /// Save compressed data after the tracks.
+        void SaveCompressed(Serializer& dest) const;
+        /// Build the lane of each track for the compressed channels.
+        void RefreshCompressedIndices();
+        /// Recalculate the memory used by the animation.
+        void RefreshMemoryUse();
+
         /// Animation name.
         String animationName_;
         /// Animation name hash.
@@ -210,6 +293,8 @@ namespace Urho3D
         HashMap<StringHash, AnimationTrack> tracks_;
         /// Animation trigger points.
         Vector<AnimationTriggerPoint> triggers_;
+        /// Compressed data.
+        UniquePtr<CompressedAnimation> compressed_;
     };
 
 }
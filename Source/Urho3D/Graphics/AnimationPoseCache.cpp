@@ -0,0 +1,195 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/CoreEvents.h"
+#include "../Graphics/Animation.h"
+#include "../Graphics/AnimationPoseCache.h"
+#include "../Graphics/Model.h"
+#include "../Resource/ResourceEvents.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+    /// Maximum number of times the time quantization is doubled for animation LOD.
+    static const unsigned MAX_QUANTUM_DOUBLINGS = 8;
+
+    AnimationPoseCache::AnimationPoseCache(Context* context) :
+        Object(context),
+        timeQuantization_(1.0f / 60.0f),
+        maxEntries_(1024),
+        maxAge_(600),
+        resourceVersion_(0),
+        frameNumber_(0),
+        hits_(0),
+        misses_(0),
+        lastFrameHits_(0),
+        lastFrameMisses_(0)
+    {
+        SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(AnimationPoseCache, HandleBeginFrame));
+        SubscribeToEvent(E_RELOADFINISHED, URHO3D_HANDLER(AnimationPoseCache, HandleReloadFinished));
+    }
+
+    AnimationPoseCache::~AnimationPoseCache() = default;
+
+    void AnimationPoseCache::SetTimeQuantization(float quantization)
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        timeQuantization_ = Max(quantization, M_EPSILON);
+        entries_.Clear();
+    }
+
+    void AnimationPoseCache::SetMaxEntries(unsigned maxEntries)
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        maxEntries_ = maxEntries;
+        if (entries_.Size() > maxEntries_)
+            entries_.Clear();
+    }
+
+    void AnimationPoseCache::SetMaxAge(unsigned maxAge)
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        maxAge_ = maxAge;
+    }
+
+    void AnimationPoseCache::Clear()
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        entries_.Clear();
+    }
+
+    unsigned AnimationPoseCache::GetNumEntries() const
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        return entries_.Size();
+    }
+
+    float AnimationPoseCache::GetTimeQuantum(float lodInterval) const
+    {
+        float quantum = timeQuantization_;
+        for (unsigned i = 0; i < MAX_QUANTUM_DOUBLINGS && quantum * 2.0f <= lodInterval; ++i)
+            quantum *= 2.0f;
+
+        return quantum;
+    }
+
+    SharedPtr<AnimationPoseCacheEntry> AnimationPoseCache::Find(unsigned hash, const PODVector<unsigned>& key)
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+
+        HashMap<unsigned, SharedPtr<AnimationPoseCacheEntry> >::Iterator i = entries_.Find(hash);
+        if (i == entries_.End() || i->second_->key_ != key)
+        {
+            ++misses_;
+            return SharedPtr<AnimationPoseCacheEntry>();
+        }
+
+        // Remove a stale pose, so that it is evaluated and stored again
+        if (IsStale(i->second_))
+        {
+            entries_.Erase(i);
+            ++misses_;
+            return SharedPtr<AnimationPoseCacheEntry>();
+        }
+
+        ++hits_;
+        i->second_->lastUsedFrame_ = frameNumber_;
+        return i->second_;
+    }
+
+    bool AnimationPoseCache::Store(unsigned hash, AnimationPoseCacheEntry* entry)
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+
+        // If full, evict the poses not used during the current frame and the stale poses
+        if (entries_.Size() >= maxEntries_ && !entries_.Contains(hash))
+        {
+            for (HashMap<unsigned, SharedPtr<AnimationPoseCacheEntry> >::Iterator i = entries_.Begin(); i != entries_.End();)
+            {
+                if (i->second_->lastUsedFrame_ != frameNumber_ || IsStale(i->second_))
+                    i = entries_.Erase(i);
+                else
+                    ++i;
+            }
+
+            if (entries_.Size() >= maxEntries_)
+                return false;
+        }
+
+        // A pose with a colliding hash is replaced
+        entry->storedFrame_ = frameNumber_;
+        entry->lastUsedFrame_ = frameNumber_;
+        entries_[hash] = entry;
+        return true;
+    }
+
+    unsigned AnimationPoseCache::HashKey(const PODVector<unsigned>& key)
+    {
+        unsigned hash = 0;
+        for (unsigned i = 0; i < key.Size(); ++i)
+            hash = key[i] + (hash << 6u) + (hash << 16u) - hash;
+
+        return hash;
+    }
+
+    void AnimationPoseCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+    {
+        using namespace BeginFrame;
+
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        frameNumber_ = eventData[P_FRAMENUMBER].GetUInt();
+        lastFrameHits_ = hits_;
+        lastFrameMisses_ = misses_;
+        hits_ = 0;
+        misses_ = 0;
+    }
+
+    void AnimationPoseCache::HandleReloadFinished(StringHash eventType, VariantMap& eventData)
+    {
+        // The reloaded resource keeps its address, so the poses evaluated from it can no longer be told apart by the key
+        Object* sender = GetEventSender();
+        if (!sender || (!sender->IsInstanceOf<Model>() && !sender->IsInstanceOf<Animation>()))
+            return;
+
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        ++resourceVersion_;
+        entries_.Clear();
+    }
+
+    bool AnimationPoseCache::IsStale(const AnimationPoseCacheEntry* entry) const
+    {
+        if (maxAge_ && frameNumber_ - entry->storedFrame_ > maxAge_)
+            return true;
+
+        // A resource destroyed and another allocated at the same address would match the key
+        for (unsigned i = 0; i < entry->resources_.Size(); ++i)
+        {
+            if (entry->resources_[i].Expired())
+                return true;
+        }
+
+        return false;
+    }
+}
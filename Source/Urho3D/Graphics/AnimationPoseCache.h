@@ -0,0 +1,135 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Core/Object.h"
+#include "../Math/BoundingBox.h"
+#include "../Math/Matrix3x4.h"
+#include "../Resource/Resource.h"
+#include <mutex>
+
+namespace Urho3D
+{
+    /// Evaluated pose of a skeleton shared by animated models with matching animation states. Not modified after being stored in the cache.
+    struct AnimationPoseCacheEntry : public RefCounted
+    {
+        /// Key the pose was evaluated for.
+        PODVector<unsigned> key_;
+        /// Model and animation resources the pose was evaluated from. The key identifies them by address, so the pose is stale if any of them has been destroyed.
+        Vector<WeakPtr<Resource> > resources_;
+        /// Local bone positions.
+        PODVector<Vector3> positions_;
+        /// Local bone rotations.
+        PODVector<Quaternion> rotations_;
+        /// Local bone scales.
+        PODVector<Vector3> scales_;
+        /// Skin matrices relative to the model's scene node.
+        PODVector<Matrix3x4> skinMatrices_;
+        /// Bone bounding box relative to the model's scene node.
+        BoundingBox boneBoundingBox_;
+        /// Frame number the pose was stored on.
+        unsigned storedFrame_{};
+        /// Frame number the pose was last used on.
+        unsigned lastUsedFrame_{};
+    };
+
+    /// %Animation pose cache subsystem. Lets animated models that play the same animations at nearly the same time positions share the evaluated bone poses and skin matrices instead of each evaluating their own. Time positions and weights are quantized to form the cache key, and models updated less often by animation LOD use a coarser time quantization. Safe to use from worker threads.
+    class URHO3D_API AnimationPoseCache : public Object
+    {
+        URHO3D_OBJECT(AnimationPoseCache, Object);
+
+    public:
+        /// Construct.
+        explicit AnimationPoseCache(Context* context);
+        /// Destruct.
+        ~AnimationPoseCache() override;
+
+        /// Set time quantization in seconds for models at full animation LOD. Default 1/60.
+        void SetTimeQuantization(float quantization);
+        /// Set maximum number of cached poses. Default 1024.
+        void SetMaxEntries(unsigned maxEntries);
+        /// Set maximum age of a cached pose in frames, after which it is evaluated again even if used on every frame. Zero disables. Default 600.
+        void SetMaxAge(unsigned maxAge);
+        /// Remove all cached poses. Models keep using the poses they already have until their next animation update.
+        void Clear();
+
+        /// Return time quantization for models at full animation LOD.
+        float GetTimeQuantization() const { return timeQuantization_; }
+        /// Return maximum number of cached poses.
+        unsigned GetMaxEntries() const { return maxEntries_; }
+        /// Return maximum age of a cached pose in frames.
+        unsigned GetMaxAge() const { return maxAge_; }
+        /// Return the resource version, which is advanced whenever a model or an animation is reloaded. Part of the cache key.
+        unsigned GetResourceVersion() const { return resourceVersion_; }
+        /// Return number of cached poses.
+        unsigned GetNumEntries() const;
+        /// Return number of poses shared from the cache during the last frame.
+        unsigned GetNumHits() const { return lastFrameHits_; }
+        /// Return number of poses evaluated because they were not in the cache during the last frame.
+        unsigned GetNumMisses() const { return lastFrameMisses_; }
+        /// Return the time quantum for a model that animation LOD updates at an interval in seconds, or zero if updated every frame. The time quantization is doubled while it does not exceed the interval, so that models at similar distances share poses.
+        float GetTimeQuantum(float lodInterval) const;
+
+        /// Return a cached pose matching a key, or null if not found or stale.
+        SharedPtr<AnimationPoseCacheEntry> Find(unsigned hash, const PODVector<unsigned>& key);
+        /// Store an evaluated pose. Poses not used during the current frame are evicted if the cache is full. Return false if the cache is full of poses used during the current frame.
+        bool Store(unsigned hash, AnimationPoseCacheEntry* entry);
+
+        /// Return hash of a key.
+        static unsigned HashKey(const PODVector<unsigned>& key);
+
+    private:
+        /// Handle the frame begin event. Reset the statistics and advance the frame number.
+        void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+        /// Handle a resource reload. Remove all cached poses if a model or an animation was reloaded in place.
+        void HandleReloadFinished(StringHash eventType, VariantMap& eventData);
+        /// Return whether a cached pose should be evaluated again.
+        bool IsStale(const AnimationPoseCacheEntry* entry) const;
+
+        /// Cached poses by key hash.
+        HashMap<unsigned, SharedPtr<AnimationPoseCacheEntry> > entries_;
+        /// Mutex for accessing the cached poses from several threads.
+        mutable std::mutex cacheMutex_;
+        /// Time quantization for models at full animation LOD.
+        float timeQuantization_;
+        /// Maximum number of cached poses.
+        unsigned maxEntries_;
+        /// Maximum age of a cached pose in frames.
+        unsigned maxAge_;
+        /// Resource version.
+        unsigned resourceVersion_;
+        /// Current frame number.
+        unsigned frameNumber_;
+        /// Cache hits during the current frame.
+        unsigned hits_;
+        /// Cache misses during the current frame.
+        unsigned misses_;
+        /// Cache hits during the last frame.
+        unsigned lastFrameHits_;
+        /// Cache misses during the last frame.
+        unsigned lastFrameMisses_;
+    };
+}
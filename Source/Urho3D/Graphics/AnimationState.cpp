@@ -447,12 +447,30 @@ namespace Urho3D
         if (!animation_ || !IsEnabled())
             return;
 
-        if (model_)
+        if (animation_->IsCompressed())
+        {
+            if (model_)
+                ApplyCompressedToModel();
+            else
+                ApplyCompressedToNodes();
+        }
+        else if (model_)
             ApplyToModel();
         else
             ApplyToNodes();
     }
 
+    void AnimationState::Apply(float time, float weight)
+    {
+        float oldTime = time_;
+        float oldWeight = weight_;
+        time_ = time;
+        weight_ = weight;
+        Apply();
+        time_ = oldTime;
+        weight_ = oldWeight;
+    }
+
     void AnimationState::ApplyToModel()
     {
         for (Vector<AnimationStateTrack>::Iterator i = stateTracks_.Begin(); i != stateTracks_.End(); ++i)
@@ -475,6 +493,135 @@ namespace Urho3D
             ApplyTrack(*i, 1.0f, false);
     }
 
+    void AnimationState::ApplyCompressedToModel()
+    {
+        const CompressedAnimation* compressed = animation_->GetCompressed();
+        compressed->Sample(time_, pose_);
+
+        unsigned numTracks = animation_->GetNumTracks();
+        trackWeights_.Resize(numTracks);
+        trackNodes_.Resize(numTracks);
+        for (unsigned i = 0; i < numTracks; ++i)
+        {
+            trackWeights_[i] = 0.0f;
+            trackNodes_[i] = nullptr;
+        }
+
+        for (Vector<AnimationStateTrack>::Iterator i = stateTracks_.Begin(); i != stateTracks_.End(); ++i)
+        {
+            AnimationStateTrack& stateTrack = *i;
+            unsigned index = stateTrack.track_->compressedIndex_;
+            float finalWeight = weight_ * stateTrack.weight_;
+
+            // Do not apply if zero effective weight or the bone has animation disabled
+            if (index >= numTracks || !stateTrack.node_ || Equals(finalWeight, 0.0f) || !stateTrack.bone_->animated_)
+                continue;
+
+            // Additive blending is relative to the bone's initial transform, so it is applied per track
+            if (blendingMode_ == ABM_ADDITIVE)
+            {
+                Vector3 newPosition;
+                Quaternion newRotation;
+                Vector3 newScale;
+                compressed->GetTransform(pose_, index, newPosition, newRotation, newScale);
+                ApplyTransform(stateTrack, stateTrack.track_->channelMask_, newPosition, newRotation, newScale, finalWeight, true);
+                continue;
+            }
+
+            trackWeights_[index] = finalWeight;
+            trackNodes_[index] = stateTrack.node_;
+        }
+
+        if (blendingMode_ == ABM_ADDITIVE)
+            return;
+
+        // Gather the current transforms of the nodes into pose layout, blend the whole pose and scatter the result
+        for (unsigned c = 0; c < NUM_COMPRESSED_ANIMATION_CHANNELS; ++c)
+        {
+            const CompressedAnimationChannel& channel = compressed->channels_[c];
+            unsigned numPaddedLanes = channel.GetNumPaddedLanes();
+            unsigned numComponents = channel.numComponents_;
+            if (!numPaddedLanes)
+                continue;
+
+            const PODVector<float>& sampled = pose_.channels_[c];
+            PODVector<float>& current = blendPose_.channels_[c];
+            current.Resize(numComponents * numPaddedLanes);
+            laneWeights_.Resize(numPaddedLanes);
+
+            for (unsigned j = 0; j < numPaddedLanes; ++j)
+            {
+                unsigned track = j < channel.tracks_.Size() ? channel.tracks_[j] : M_MAX_UNSIGNED;
+                Node* node = track < numTracks ? trackNodes_[track] : nullptr;
+                if (!node)
+                {
+                    laneWeights_[j] = 0.0f;
+                    for (unsigned k = 0; k < numComponents; ++k)
+                        current[k * numPaddedLanes + j] = sampled[k * numPaddedLanes + j];
+                    continue;
+                }
+
+                laneWeights_[j] = trackWeights_[track];
+                if (c == 1)
+                {
+                    const Quaternion& rotation = node->GetRotation();
+                    current[j] = rotation.x_;
+                    current[numPaddedLanes + j] = rotation.y_;
+                    current[2 * numPaddedLanes + j] = rotation.z_;
+                    current[3 * numPaddedLanes + j] = rotation.w_;
+                }
+                else
+                {
+                    const Vector3& value = c == 0 ? node->GetPosition() : node->GetScale();
+                    current[j] = value.x_;
+                    current[numPaddedLanes + j] = value.y_;
+                    current[2 * numPaddedLanes + j] = value.z_;
+                }
+            }
+
+            CompressedAnimation::Blend(current.Buffer(), sampled.Buffer(), laneWeights_.Buffer(), numComponents, numPaddedLanes);
+
+            for (unsigned j = 0; j < channel.tracks_.Size(); ++j)
+            {
+                unsigned track = channel.tracks_[j];
+                Node* node = track < numTracks ? trackNodes_[track] : nullptr;
+                if (!node)
+                    continue;
+
+                if (c == 0)
+                    node->SetPositionSilent(Vector3(current[j], current[numPaddedLanes + j], current[2 * numPaddedLanes + j]));
+                else if (c == 1)
+                {
+                    node->SetRotationSilent(Quaternion(current[3 * numPaddedLanes + j], current[j], current[numPaddedLanes + j],
+                        current[2 * numPaddedLanes + j]));
+                }
+                else
+                    node->SetScaleSilent(Vector3(current[j], current[numPaddedLanes + j], current[2 * numPaddedLanes + j]));
+            }
+        }
+    }
+
+    void AnimationState::ApplyCompressedToNodes()
+    {
+        const CompressedAnimation* compressed = animation_->GetCompressed();
+        compressed->Sample(time_, pose_);
+
+        // When applying to a node hierarchy, can only use full weight (nothing to blend to)
+        for (Vector<AnimationStateTrack>::Iterator i = stateTracks_.Begin(); i != stateTracks_.End(); ++i)
+        {
+            AnimationStateTrack& stateTrack = *i;
+            unsigned index = stateTrack.track_->compressedIndex_;
+            if (index == M_MAX_UNSIGNED || !stateTrack.node_)
+                continue;
+
+            Vector3 newPosition;
+            Quaternion newRotation;
+            Vector3 newScale;
+            compressed->GetTransform(pose_, index, newPosition, newRotation, newScale);
+            ApplyTransform(stateTrack, stateTrack.track_->channelMask_, newPosition, newRotation, newScale, 1.0f, false);
+        }
+    }
+
     void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent)
     {
         const AnimationTrack* track = stateTrack.track_;
@@ -532,6 +679,14 @@ namespace Urho3D
                 newScale = keyFrame->scale_;
         }
 
+        ApplyTransform(stateTrack, channelMask, newPosition, newRotation, newScale, weight, silent);
+    }
+
+    void AnimationState::ApplyTransform(AnimationStateTrack& stateTrack, AnimationChannelFlags channelMask, Vector3 newPosition,
+        Quaternion newRotation, Vector3 newScale, float weight, bool silent)
+    {
+        Node* node = stateTrack.node_;
+
         if (blendingMode_ == ABM_ADDITIVE) // not ABM_LERP
         {
             if ((channelMask & AnimationChannelFlags::Position) != AnimationChannelFlags::None)
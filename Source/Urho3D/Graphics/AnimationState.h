@@ -26,11 +26,11 @@
 
 #include "../Container/HashMap.h"
 #include "../Container/Ptr.h"
+#include "../Graphics/Animation.h"
 
 namespace Urho3D
 {
 
-class Animation;
 class AnimatedModel;
 class Deserializer;
 class Serializer;
@@ -127,6 +127,8 @@ public:
     float GetBoneWeight(const String& name) const;
     /// Return per-bone blending weight by name.
     float GetBoneWeight(StringHash nameHash) const;
+    /// Return number of tracks applied to the model or node hierarchy.
+    unsigned GetNumTracks() const { return stateTracks_.Size(); }
     /// Return track index with matching bone node, or M_MAX_UNSIGNED if not found.
     unsigned GetTrackIndex(Node* node) const;
     /// Return track index by bone name, or M_MAX_UNSIGNED if not found.
@@ -164,14 +166,23 @@ public:
 
     /// Apply the animation at the current time position.
     void Apply();
+    /// Apply the animation at a time position and blending weight without changing the current ones. Used for evaluating shared poses at quantized time positions and weights.
+    void Apply(float time, float weight);
 
 private:
     /// Apply animation to a skeleton. Transform changes are applied silently, so the model needs to dirty its root model afterward.
     void ApplyToModel();
     /// Apply animation to a scene node hierarchy.
     void ApplyToNodes();
+    /// Apply compressed animation to a skeleton. With lerp blending the whole pose is blended with SIMD.
+    void ApplyCompressedToModel();
+    /// Apply compressed animation to a scene node hierarchy.
+    void ApplyCompressedToNodes();
     /// Apply track.
     void ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent);
+    /// Blend a sampled transform of a track with the node's current transform and apply it.
+    void ApplyTransform(AnimationStateTrack& stateTrack, AnimationChannelFlags channelMask, Vector3 newPosition, Quaternion newRotation,
+        Vector3 newScale, float weight, bool silent);
 
     /// Animated model (model mode).
     WeakPtr<AnimatedModel> model_;
@@ -193,6 +204,16 @@ private:
     unsigned char layer_;
     /// Blending mode.
     AnimationBlendMode blendingMode_;
+    /// Sampled pose of a compressed animation.
+    AnimationPose pose_;
+    /// Current transforms of the animated nodes in pose layout, blended towards the sampled pose.
+    AnimationPose blendPose_;
+    /// Blending weight of each lane of a compressed channel.
+    PODVector<float> laneWeights_;
+    /// Blending weight of each track by compressed index.
+    PODVector<float> trackWeights_;
+    /// Node of each track by compressed index.
+    PODVector<Node*> trackNodes_;
 };
 
 }
@@ -23,6 +23,7 @@
 #include "../Precompiled.h"
 
 #include "../Graphics/Camera.h"
+#include "../Graphics/CommandList.h"
 #include "../Graphics/Geometry.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/GraphicsImpl.h"
@@ -174,19 +175,18 @@ void Batch::CalculateSortKey()
                (((unsigned long long)materialID) << 16u) | geometryID;
 }
 
-void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool allowDepthWrite) const
+void Batch::Prepare(CommandList& commands, View* view, Camera* camera, bool setModelTransform) const
 {
     if (!vertexShader_ || !pixelShader_)
         return;
 
-    Graphics* graphics = view->GetGraphics();
     Renderer* renderer = view->GetRenderer();
     Node* cameraNode = camera ? camera->GetNode() : nullptr;
     Light* light = lightQueue_ ? lightQueue_->light_ : nullptr;
     Texture2D* shadowMap = lightQueue_ ? lightQueue_->shadowMap_ : nullptr;
 
     // Set shaders first. The available shader parameters and their register/uniform positions depend on the currently set shaders
-    graphics->SetShaders(vertexShader_, pixelShader_);
+    commands.SetShaders(vertexShader_, pixelShader_);
 
     // Set pass / material-specific renderstates
     if (pass_ && material_)
@@ -200,8 +200,8 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
             else if (blend == BLEND_ADDALPHA)
                 blend = BLEND_SUBTRACTALPHA;
         }
-        graphics->SetBlendMode(blend, pass_->GetAlphaToCoverage() || material_->GetAlphaToCoverage());
-        graphics->SetLineAntiAlias(material_->GetLineAntiAlias());
+        commands.SetBlendMode(blend, pass_->GetAlphaToCoverage() || material_->GetAlphaToCoverage());
+        commands.SetLineAntiAlias(material_->GetLineAntiAlias());
 
         bool isShadowPass = pass_->GetIndex() == Technique::shadowPassIndex;
         CullMode effectiveCullMode = pass_->GetCullMode();
@@ -209,67 +209,57 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
         if (effectiveCullMode == CullMode::Count)
             effectiveCullMode = isShadowPass ? material_->GetShadowCullMode() : material_->GetCullMode();
 
-        renderer->SetCullMode(effectiveCullMode, camera);
+        commands.SetCullMode(effectiveCullMode);
         if (!isShadowPass)
         {
             const BiasParameters& depthBias = material_->GetDepthBias();
-            graphics->SetDepthBias(depthBias.constantBias_, depthBias.slopeScaledBias_);
+            commands.SetDepthBias(depthBias.constantBias_, depthBias.slopeScaledBias_);
         }
 
         // Use the "least filled" fill mode combined from camera & material
-        graphics->SetFillMode((FillMode)(Max(camera->GetFillMode(), material_->GetFillMode())));
-        graphics->SetDepthTest(pass_->GetDepthTestMode());
-        graphics->SetDepthWrite(pass_->GetDepthWrite() && allowDepthWrite);
+        commands.SetFillMode((FillMode)(Max(camera->GetFillMode(), material_->GetFillMode())));
+        commands.SetDepthTest(pass_->GetDepthTestMode());
+        commands.SetDepthWrite(pass_->GetDepthWrite());
     }
 
     // Set global (per-frame) shader parameters
-    if (graphics->NeedParameterUpdate(SP_FRAME, nullptr))
-        view->SetGlobalShaderParameters();
-
-    // Set camera & viewport shader parameters
-    auto cameraHash = (unsigned)(size_t)camera;
-    IntRect viewport = graphics->GetViewport();
-    IntVector2 viewSize = IntVector2(viewport.Width(), viewport.Height());
-    auto viewportHash = (unsigned)viewSize.x | (unsigned)viewSize.y << 16u;
-    if (graphics->NeedParameterUpdate(SP_CAMERA, reinterpret_cast<const void*>(cameraHash + viewportHash)))
-    {
-        view->SetCameraShaderParameters(camera);
-        // During renderpath commands the G-Buffer or viewport texture is assumed to always be viewport-sized
-        view->SetGBufferShaderParameters(viewSize, IntRect(0, 0, viewSize.x, viewSize.y));
-    }
+    commands.SetGlobalShaderParameters();
+
+    // Set camera & viewport shader parameters. The viewport is only known when the commands are executed
+    commands.SetCameraShaderParameters();
 
     // Set model or skinning transforms
-    if (setModelTransform && graphics->NeedParameterUpdate(SP_OBJECT, worldTransform_))
+    if (setModelTransform && commands.NeedParameterUpdate(SP_OBJECT, worldTransform_))
     {
         if (geometryType_ == GEOM_SKINNED)
         {
-            graphics->SetShaderParameter(VSP_SKINMATRICES, reinterpret_cast<const float*>(worldTransform_),
+            commands.SetShaderParameter(VSP_SKINMATRICES, reinterpret_cast<const float*>(worldTransform_),
                 12 * numWorldTransforms_);
         }
         else
-            graphics->SetShaderParameter(VSP_MODEL, *worldTransform_);
+            commands.SetShaderParameter(VSP_MODEL, *worldTransform_);
 
         // Set the orientation for billboards, either from the object itself or from the camera
         if (geometryType_ == GEOM_BILLBOARD)
         {
             if (numWorldTransforms_ > 1)
-                graphics->SetShaderParameter(VSP_BILLBOARDROT, worldTransform_[1].RotationMatrix());
+                commands.SetShaderParameter(VSP_BILLBOARDROT, worldTransform_[1].RotationMatrix());
             else
-                graphics->SetShaderParameter(VSP_BILLBOARDROT, cameraNode->GetWorldRotation().RotationMatrix());
+                commands.SetShaderParameter(VSP_BILLBOARDROT, cameraNode->GetWorldRotation().RotationMatrix());
         }
     }
 
     // Set zone-related shader parameters
-    BlendMode blend = graphics->GetBlendMode();
+    BlendMode blend = commands.GetBlendMode();
     // If the pass is additive, override fog color to black so that shaders do not need a separate additive path
     bool overrideFogColorToBlack = blend == BLEND_ADD || blend == BLEND_ADDALPHA;
     auto zoneHash = (unsigned)(size_t)zone_;
     if (overrideFogColorToBlack)
         zoneHash += 0x80000000;
-    if (zone_ && graphics->NeedParameterUpdate(SP_ZONE, reinterpret_cast<const void*>(zoneHash)))
+    if (zone_ && commands.NeedParameterUpdate(SP_ZONE, reinterpret_cast<const void*>(zoneHash)))
     {
-        graphics->SetShaderParameter(VSP_AMBIENTSTARTCOLOR, zone_->GetAmbientStartColor());
-        graphics->SetShaderParameter(VSP_AMBIENTENDCOLOR,
+        commands.SetShaderParameter(VSP_AMBIENTSTARTCOLOR, zone_->GetAmbientStartColor());
+        commands.SetShaderParameter(VSP_AMBIENTENDCOLOR,
             zone_->GetAmbientEndColor().ToVector4() - zone_->GetAmbientStartColor().ToVector4());
 
         const BoundingBox& box = zone_->GetBoundingBox();
@@ -278,12 +268,12 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
         adjust.SetScale(Vector3(1.0f / boxSize.x_, 1.0f / boxSize.y_, 1.0f / boxSize.z_));
         adjust.SetTranslation(Vector3(0.5f, 0.5f, 0.5f));
         Matrix3x4 zoneTransform = adjust * zone_->GetInverseWorldTransform();
-        graphics->SetShaderParameter(VSP_ZONE, zoneTransform);
+        commands.SetShaderParameter(VSP_ZONE, zoneTransform);
 
-        graphics->SetShaderParameter(PSP_AMBIENTCOLOR, zone_->GetAmbientColor());
-        graphics->SetShaderParameter(PSP_FOGCOLOR, overrideFogColorToBlack ? Color::BLACK : zone_->GetFogColor());
-        graphics->SetShaderParameter(PSP_ZONEMIN, zone_->GetBoundingBox().min_);
-        graphics->SetShaderParameter(PSP_ZONEMAX, zone_->GetBoundingBox().max_);
+        commands.SetShaderParameter(PSP_AMBIENTCOLOR, zone_->GetAmbientColor());
+        commands.SetShaderParameter(PSP_FOGCOLOR, overrideFogColorToBlack ? Color::BLACK : zone_->GetFogColor());
+        commands.SetShaderParameter(PSP_ZONEMIN, zone_->GetBoundingBox().min_);
+        commands.SetShaderParameter(PSP_ZONEMAX, zone_->GetBoundingBox().max_);
 
         float farClip = camera->GetFarClip();
         float fogStart = Min(zone_->GetFogStart(), farClip);
@@ -301,23 +291,23 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
             fogParams.w_ = zone_->GetFogHeightScale() / Max(zoneNode->GetWorldScale().y_, M_EPSILON);
         }
 
-        graphics->SetShaderParameter(PSP_FOGPARAMS, fogParams);
+        commands.SetShaderParameter(PSP_FOGPARAMS, fogParams);
     }
 
     // Set light-related shader parameters
     if (lightQueue_)
     {
-        if (light && graphics->NeedParameterUpdate(SP_LIGHT, lightQueue_))
+        if (light && commands.NeedParameterUpdate(SP_LIGHT, lightQueue_))
         {
             Node* lightNode = light->GetNode();
             float atten = 1.0f / Max(light->GetRange(), M_EPSILON);
             Vector3 lightDir(lightNode->GetWorldRotation() * Vector3::BACK);
             Vector4 lightPos(lightNode->GetWorldPosition(), atten);
 
-            graphics->SetShaderParameter(VSP_LIGHTDIR, lightDir);
-            graphics->SetShaderParameter(VSP_LIGHTPOS, lightPos);
+            commands.SetShaderParameter(VSP_LIGHTDIR, lightDir);
+            commands.SetShaderParameter(VSP_LIGHTPOS, lightPos);
 
-            if (graphics->HasShaderParameter(VSP_LIGHTMATRICES))
+            if (commands.HasShaderParameter(VSP_LIGHTMATRICES))
             {
                 switch (light->GetLightType())
                 {
@@ -329,7 +319,7 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
                         for (unsigned i = 0; i < numSplits; ++i)
                             CalculateShadowMatrix(shadowMatrices[i], lightQueue_, i, renderer);
 
-                        graphics->SetShaderParameter(VSP_LIGHTMATRICES, shadowMatrices[0].Data(), 16 * numSplits);
+                        commands.SetShaderParameter(VSP_LIGHTMATRICES, shadowMatrices[0].Data(), 16 * numSplits);
                     }
                     break;
 
@@ -338,11 +328,11 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
                         Matrix4 shadowMatrices[2];
 
                         CalculateSpotMatrix(shadowMatrices[0], light);
-                        bool isShadowed = shadowMap && graphics->HasTextureUnit(TU_SHADOWMAP);
+                        bool isShadowed = shadowMap && commands.HasTextureUnit(TU_SHADOWMAP);
                         if (isShadowed)
                             CalculateShadowMatrix(shadowMatrices[1], lightQueue_, 0, renderer);
 
-                        graphics->SetShaderParameter(VSP_LIGHTMATRICES, shadowMatrices[0].Data(), isShadowed ? 32 : 16);
+                        commands.SetShaderParameter(VSP_LIGHTMATRICES, shadowMatrices[0].Data(), isShadowed ? 32 : 16);
                     }
                     break;
 
@@ -352,9 +342,9 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
                         // HLSL compiler will pack the parameters as if the matrix is only 3x4, so must be careful to not overwrite
                         // the next parameter
 #ifdef URHO3D_OPENGL
-                        graphics->SetShaderParameter(VSP_LIGHTMATRICES, lightVecRot.Data(), 16);
+                        commands.SetShaderParameter(VSP_LIGHTMATRICES, lightVecRot.Data(), 16);
 #else
-                        graphics->SetShaderParameter(VSP_LIGHTMATRICES, lightVecRot.Data(), 12);
+                        commands.SetShaderParameter(VSP_LIGHTMATRICES, lightVecRot.Data(), 12);
 #endif
                     }
                     break;
@@ -370,14 +360,14 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
                 fade = Min(1.0f - (light->GetDistance() - fadeStart) / (fadeEnd - fadeStart), 1.0f);
 
             // Negative lights will use subtract blending, so write absolute RGB values to the shader parameter
-            graphics->SetShaderParameter(PSP_LIGHTCOLOR, Color(light->GetEffectiveColor().Abs(),
+            commands.SetShaderParameter(PSP_LIGHTCOLOR, Color(light->GetEffectiveColor().Abs(),
                 light->GetEffectiveSpecularIntensity()) * fade);
-            graphics->SetShaderParameter(PSP_LIGHTDIR, lightDir);
-            graphics->SetShaderParameter(PSP_LIGHTPOS, lightPos);
-            graphics->SetShaderParameter(PSP_LIGHTRAD, light->GetRadius());
-            graphics->SetShaderParameter(PSP_LIGHTLENGTH, light->GetLength());
+            commands.SetShaderParameter(PSP_LIGHTDIR, lightDir);
+            commands.SetShaderParameter(PSP_LIGHTPOS, lightPos);
+            commands.SetShaderParameter(PSP_LIGHTRAD, light->GetRadius());
+            commands.SetShaderParameter(PSP_LIGHTLENGTH, light->GetLength());
 
-            if (graphics->HasShaderParameter(PSP_LIGHTMATRICES))
+            if (commands.HasShaderParameter(PSP_LIGHTMATRICES))
             {
                 switch (light->GetLightType())
                 {
@@ -389,7 +379,7 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
                         for (unsigned i = 0; i < numSplits; ++i)
                             CalculateShadowMatrix(shadowMatrices[i], lightQueue_, i, renderer);
 
-                        graphics->SetShaderParameter(PSP_LIGHTMATRICES, shadowMatrices[0].Data(), 16 * numSplits);
+                        commands.SetShaderParameter(PSP_LIGHTMATRICES, shadowMatrices[0].Data(), 16 * numSplits);
                     }
                     break;
 
@@ -402,7 +392,7 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
                         if (isShadowed)
                             CalculateShadowMatrix(shadowMatrices[1], lightQueue_, 0, renderer);
 
-                        graphics->SetShaderParameter(PSP_LIGHTMATRICES, shadowMatrices[0].Data(), isShadowed ? 32 : 16);
+                        commands.SetShaderParameter(PSP_LIGHTMATRICES, shadowMatrices[0].Data(), isShadowed ? 32 : 16);
                     }
                     break;
 
@@ -412,9 +402,9 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
                         // HLSL compiler will pack the parameters as if the matrix is only 3x4, so must be careful to not overwrite
                         // the next parameter
 #ifdef URHO3D_OPENGL
-                        graphics->SetShaderParameter(PSP_LIGHTMATRICES, lightVecRot.Data(), 16);
+                        commands.SetShaderParameter(PSP_LIGHTMATRICES, lightVecRot.Data(), 16);
 #else
-                        graphics->SetShaderParameter(PSP_LIGHTMATRICES, lightVecRot.Data(), 12);
+                        commands.SetShaderParameter(PSP_LIGHTMATRICES, lightVecRot.Data(), 12);
 #endif
                     }
                     break;
@@ -447,7 +437,7 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
                         addX -= 0.5f / width;
                         addY -= 0.5f / height;
                     }
-                    graphics->SetShaderParameter(PSP_SHADOWCUBEADJUST, Vector4(mulX, mulY, addX, addY));
+                    commands.SetShaderParameter(PSP_SHADOWCUBEADJUST, Vector4(mulX, mulY, addX, addY));
                 }
 
                 {
@@ -466,7 +456,7 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
                     float fadeEnd = shadowRange / viewFarClip;
                     float fadeRange = fadeEnd - fadeStart;
 
-                    graphics->SetShaderParameter(PSP_SHADOWDEPTHFADE, Vector4(q, r, fadeStart, 1.0f / fadeRange));
+                    commands.SetShaderParameter(PSP_SHADOWDEPTHFADE, Vector4(q, r, fadeStart, 1.0f / fadeRange));
                 }
 
                 {
@@ -480,12 +470,12 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
                     float samples = 1.0f;
                     if (renderer->GetShadowQuality() == SHADOWQUALITY_PCF_16BIT || renderer->GetShadowQuality() == SHADOWQUALITY_PCF_24BIT)
                         samples = 4.0f;
-                    graphics->SetShaderParameter(PSP_SHADOWINTENSITY, Vector4(pcfValues / samples, intensity, 0.0f, 0.0f));
+                    commands.SetShaderParameter(PSP_SHADOWINTENSITY, Vector4(pcfValues / samples, intensity, 0.0f, 0.0f));
                 }
 
                 float sizeX = 1.0f / (float)shadowMap->GetWidth();
                 float sizeY = 1.0f / (float)shadowMap->GetHeight();
-                graphics->SetShaderParameter(PSP_SHADOWMAPINVSIZE, Vector2(sizeX, sizeY));
+                commands.SetShaderParameter(PSP_SHADOWMAPINVSIZE, Vector2(sizeX, sizeY));
 
                 Vector4 lightSplits(M_LARGE_VALUE, M_LARGE_VALUE, M_LARGE_VALUE, M_LARGE_VALUE);
                 if (lightQueue_->shadowSplits_.Size() > 1)
@@ -495,10 +485,10 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
                 if (lightQueue_->shadowSplits_.Size() > 3)
                     lightSplits.z_ = lightQueue_->shadowSplits_[2].farSplit_ / camera->GetFarClip();
 
-                graphics->SetShaderParameter(PSP_SHADOWSPLITS, lightSplits);
+                commands.SetShaderParameter(PSP_SHADOWSPLITS, lightSplits);
 
-                if (graphics->HasShaderParameter(PSP_VSMSHADOWPARAMS))
-                    graphics->SetShaderParameter(PSP_VSMSHADOWPARAMS, renderer->GetVSMShadowParameters());
+                if (commands.HasShaderParameter(PSP_VSMSHADOWPARAMS))
+                    commands.SetShaderParameter(PSP_VSMSHADOWPARAMS, renderer->GetVSMShadowParameters());
 
                 if (light->GetShadowBias().normalOffset_ > 0.0f)
                 {
@@ -525,13 +515,13 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
 #if ALIMER_OPENGLES
                     normalOffsetScale *= renderer->GetMobileNormalOffsetMul();
 #endif
-                    graphics->SetShaderParameter(VSP_NORMALOFFSETSCALE, normalOffsetScale);
-                    graphics->SetShaderParameter(PSP_NORMALOFFSETSCALE, normalOffsetScale);
+                    commands.SetShaderParameter(VSP_NORMALOFFSETSCALE, normalOffsetScale);
+                    commands.SetShaderParameter(PSP_NORMALOFFSETSCALE, normalOffsetScale);
                 }
             }
         }
-        else if (lightQueue_->vertexLights_.Size() && graphics->HasShaderParameter(VSP_VERTEXLIGHTS) &&
-                 graphics->NeedParameterUpdate(SP_LIGHT, lightQueue_))
+        else if (lightQueue_->vertexLights_.Size() && commands.HasShaderParameter(VSP_VERTEXLIGHTS) &&
+                 commands.NeedParameterUpdate(SP_LIGHT, lightQueue_))
         {
             Vector4 vertexLights[MAX_VERTEX_LIGHTS * 3];
             const PODVector<Light*>& lights = lightQueue_->vertexLights_;
@@ -578,66 +568,69 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
                 vertexLights[i * 3 + 2] = Vector4(vertexLightNode->GetWorldPosition(), invCutoff);
             }
 
-            graphics->SetShaderParameter(VSP_VERTEXLIGHTS, vertexLights[0].Data(), lights.Size() * 3 * 4);
+            commands.SetShaderParameter(VSP_VERTEXLIGHTS, vertexLights[0].Data(), lights.Size() * 3 * 4);
         }
     }
 
     // Set zone texture if necessary
 #if !ALIMER_OPENGLES
-    if (zone_ && graphics->HasTextureUnit(TU_ZONE))
-        graphics->SetTexture(TU_ZONE, zone_->GetZoneTexture());
+    if (zone_ && commands.HasTextureUnit(TU_ZONE))
+        commands.SetTexture(TU_ZONE, zone_->GetZoneTexture());
 #else
     // On OpenGL ES set the zone texture to the environment unit instead
-    if (zone_ && zone_->GetZoneTexture() && graphics->HasTextureUnit(TU_ENVIRONMENT))
-        graphics->SetTexture(TU_ENVIRONMENT, zone_->GetZoneTexture());
+    if (zone_ && zone_->GetZoneTexture() && commands.HasTextureUnit(TU_ENVIRONMENT))
+        commands.SetTexture(TU_ENVIRONMENT, zone_->GetZoneTexture());
 #endif
 
+    // Set clustered light textures if necessary
+    commands.SetClusteredLightTextures();
+
     // Set material-specific shader parameters and textures
     if (material_)
     {
-        if (graphics->NeedParameterUpdate(SP_MATERIAL, reinterpret_cast<const void*>(material_->GetShaderParameterHash())))
+        if (commands.NeedParameterUpdate(SP_MATERIAL, reinterpret_cast<const void*>(material_->GetShaderParameterHash())))
         {
             const HashMap<StringHash, MaterialShaderParameter>& parameters = material_->GetShaderParameters();
             for (HashMap<StringHash, MaterialShaderParameter>::ConstIterator i = parameters.Begin(); i != parameters.End(); ++i)
-                graphics->SetShaderParameter(i->first_, i->second_.value_);
+                commands.SetShaderParameter(i->first_, i->second_.value_);
         }
 
         const HashMap<TextureUnit, SharedPtr<Texture> >& textures = material_->GetTextures();
         for (HashMap<TextureUnit, SharedPtr<Texture> >::ConstIterator i = textures.Begin(); i != textures.End(); ++i)
         {
-            if (graphics->HasTextureUnit(i->first_))
-                graphics->SetTexture(i->first_, i->second_.Get());
+            if (commands.HasTextureUnit(i->first_))
+                commands.SetTexture(i->first_, i->second_.Get());
         }
     }
 
     // Set light-related textures
     if (light)
     {
-        if (shadowMap && graphics->HasTextureUnit(TU_SHADOWMAP))
-            graphics->SetTexture(TU_SHADOWMAP, shadowMap);
-        if (graphics->HasTextureUnit(TU_LIGHTRAMP))
+        if (shadowMap && commands.HasTextureUnit(TU_SHADOWMAP))
+            commands.SetTexture(TU_SHADOWMAP, shadowMap);
+        if (commands.HasTextureUnit(TU_LIGHTRAMP))
         {
             Texture* rampTexture = light->GetRampTexture();
             if (!rampTexture)
                 rampTexture = renderer->GetDefaultLightRamp();
-            graphics->SetTexture(TU_LIGHTRAMP, rampTexture);
+            commands.SetTexture(TU_LIGHTRAMP, rampTexture);
         }
-        if (graphics->HasTextureUnit(TU_LIGHTSHAPE))
+        if (commands.HasTextureUnit(TU_LIGHTSHAPE))
         {
             Texture* shapeTexture = light->GetShapeTexture();
             if (!shapeTexture && light->GetLightType() == LightType::Spot)
                 shapeTexture = renderer->GetDefaultLightSpot();
-            graphics->SetTexture(TU_LIGHTSHAPE, shapeTexture);
+            commands.SetTexture(TU_LIGHTSHAPE, shapeTexture);
         }
     }
 }
 
-void Batch::Draw(View* view, Camera* camera, bool allowDepthWrite) const
+void Batch::Draw(CommandList& commands, View* view, Camera* camera) const
 {
     if (!geometry_->IsEmpty())
     {
-        Prepare(view, camera, true, allowDepthWrite);
-        geometry_->Draw(view->GetGraphics());
+        Prepare(commands, view, camera, true);
+        commands.DrawGeometry(geometry_);
     }
 }
 
@@ -664,9 +657,8 @@ void BatchGroup::SetInstancingData(void* lockedData, unsigned stride, unsigned&
     freeIndex += instances_.Size();
 }
 
-void BatchGroup::Draw(View* view, Camera* camera, bool allowDepthWrite) const
+void BatchGroup::Draw(CommandList& commands, View* view, Camera* camera) const
 {
-    Graphics* graphics = view->GetGraphics();
     Renderer* renderer = view->GetRenderer();
 
     if (instances_.Size() && !geometry_->IsEmpty())
@@ -675,44 +667,23 @@ void BatchGroup::Draw(View* view, Camera* camera, bool allowDepthWrite) const
         VertexBuffer* instanceBuffer = renderer->GetInstancingBuffer();
         if (!instanceBuffer || geometryType_ != GEOM_INSTANCED || startIndex_ == M_MAX_UNSIGNED)
         {
-            Batch::Prepare(view, camera, false, allowDepthWrite);
+            Batch::Prepare(commands, view, camera, false);
 
-            graphics->SetIndexBuffer(geometry_->GetIndexBuffer());
-            graphics->SetVertexBuffers(geometry_->GetVertexBuffers());
+            commands.SetGeometryBuffers(geometry_);
 
             for (unsigned i = 0; i < instances_.Size(); ++i)
             {
-                if (graphics->NeedParameterUpdate(SP_OBJECT, instances_[i].worldTransform_))
-                    graphics->SetShaderParameter(VSP_MODEL, *instances_[i].worldTransform_);
-
-                graphics->DrawIndexed(
-                    geometry_->GetPrimitiveType(),
-                    geometry_->GetIndexCount(),
-                    1,
-                    geometry_->GetIndexStart()
-                );
+                if (commands.NeedParameterUpdate(SP_OBJECT, instances_[i].worldTransform_))
+                    commands.SetShaderParameter(VSP_MODEL, *instances_[i].worldTransform_);
+
+                commands.DrawIndexed(geometry_);
             }
         }
         else
         {
-            Batch::Prepare(view, camera, false, allowDepthWrite);
-
-            // Get the geometry vertex buffers, then add the instancing stream buffer
-            // Hack: use a const_cast to avoid dynamic allocation of new temp vectors
-            auto& vertexBuffers = const_cast<Vector<SharedPtr<VertexBuffer> >&>(
-                geometry_->GetVertexBuffers());
-            vertexBuffers.Push(SharedPtr<VertexBuffer>(instanceBuffer));
-
-            graphics->SetIndexBuffer(geometry_->GetIndexBuffer());
-            graphics->SetVertexBuffers(vertexBuffers, startIndex_);
-            graphics->DrawIndexed(geometry_->GetPrimitiveType(),
-                geometry_->GetIndexCount(),
-                static_cast<uint32_t>(instances_.Size()),
-                geometry_->GetIndexStart()
-            );
-
-            // Remove the instancing buffer & element mask now
-            vertexBuffers.Pop();
+            Batch::Prepare(commands, view, camera, false);
+
+            commands.DrawInstanced(geometry_, instanceBuffer, startIndex_, instances_.Size());
         }
     }
 }
@@ -728,6 +699,7 @@ void BatchQueue::Clear(int maxSortedInstances)
     batches_.Clear();
     sortedBatches_.Clear();
     batchGroups_.Clear();
+    commands_.Clear();
     maxSortedInstances_ = (unsigned)maxSortedInstances;
 }
 
@@ -851,19 +823,18 @@ void BatchQueue::SetInstancingData(void* lockedData, unsigned stride, unsigned&
         i->second_.SetInstancingData(lockedData, stride, freeIndex);
 }
 
-void BatchQueue::Draw(View* view, Camera* camera, bool markToStencil, bool usingLightOptimization, bool allowDepthWrite) const
+void BatchQueue::Record(View* view, Camera* camera, bool markToStencil, bool usingLightOptimization) const
 {
-    Graphics* graphics = view->GetGraphics();
-    Renderer* renderer = view->GetRenderer();
+    commands_.Begin(camera, markToStencil, usingLightOptimization);
 
     // If View has set up its own light optimizations, do not disturb the stencil/scissor test settings
     if (!usingLightOptimization)
     {
-        graphics->SetScissorTest(false);
+        commands_.DisableScissorTest();
 
         // During G-buffer rendering, mark opaque pixels' lightmask to stencil buffer if requested
         if (!markToStencil)
-            graphics->SetStencilTest(false);
+            commands_.SetStencilTest(false);
     }
 
     // Instanced
@@ -871,27 +842,38 @@ void BatchQueue::Draw(View* view, Camera* camera, bool markToStencil, bool using
     {
         BatchGroup* group = *i;
         if (markToStencil)
-            graphics->SetStencilTest(true, CMP_ALWAYS, OP_REF, OP_KEEP, OP_KEEP, group->lightMask_);
+            commands_.SetStencilTest(true, group->lightMask_);
 
-        group->Draw(view, camera, allowDepthWrite);
+        group->Draw(commands_, view, camera);
     }
     // Non-instanced
     for (PODVector<Batch*>::ConstIterator i = sortedBatches_.Begin(); i != sortedBatches_.End(); ++i)
     {
         Batch* batch = *i;
         if (markToStencil)
-            graphics->SetStencilTest(true, CMP_ALWAYS, OP_REF, OP_KEEP, OP_KEEP, batch->lightMask_);
+            commands_.SetStencilTest(true, batch->lightMask_);
         if (!usingLightOptimization)
         {
             // If drawing an alpha batch, we can optimize fillrate by scissor test
             if (!batch->isBase_ && batch->lightQueue_)
-                renderer->OptimizeLightByScissor(batch->lightQueue_->light_, camera);
+                commands_.SetLightScissor(batch->lightQueue_->light_);
             else
-                graphics->SetScissorTest(false);
+                commands_.DisableScissorTest();
         }
 
-        batch->Draw(view, camera, allowDepthWrite);
+        batch->Draw(commands_, view, camera);
     }
+
+    commands_.End();
+}
+
+void BatchQueue::Draw(View* view, Camera* camera, bool markToStencil, bool usingLightOptimization, bool allowDepthWrite) const
+{
+    // Record now if the commands were not recorded in advance for the same settings
+    if (!commands_.IsRecorded(camera, markToStencil, usingLightOptimization))
+        Record(view, camera, markToStencil, usingLightOptimization);
+
+    commands_.Execute(view, allowDepthWrite);
 }
 
 unsigned BatchQueue::GetNumInstances() const
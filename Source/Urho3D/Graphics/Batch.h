@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Container/Ptr.h"
+#include "../Graphics/CommandList.h"
 #include "../Graphics/Drawable.h"
 #include "../Graphics/Material.h"
 #include "../Math/MathDefs.h"
@@ -44,6 +45,7 @@ class Texture2D;
 class VertexBuffer;
 class View;
 class Zone;
+struct CachedShadowMap;
 struct LightBatchQueue;
 
 /// Queued 3D geometry draw call.
@@ -69,10 +71,10 @@ struct Batch
 
     /// Calculate state sorting key, which consists of base pass flag, light, pass and geometry.
     void CalculateSortKey();
-    /// Prepare for rendering.
-    void Prepare(View* view, Camera* camera, bool setModelTransform, bool allowDepthWrite) const;
-    /// Prepare and draw.
-    void Draw(View* view, Camera* camera, bool allowDepthWrite) const;
+    /// Record the state and shader parameters for rendering.
+    void Prepare(CommandList& commands, View* view, Camera* camera, bool setModelTransform) const;
+    /// Record the state and the draw call.
+    void Draw(CommandList& commands, View* view, Camera* camera) const;
 
     /// State sorting key.
     unsigned long long sortKey_{};
@@ -165,8 +167,8 @@ struct BatchGroup : public Batch
 
     /// Pre-set the instance data. Buffer must be big enough to hold all data.
     void SetInstancingData(void* lockedData, unsigned stride, unsigned& freeIndex);
-    /// Prepare and draw.
-    void Draw(View* view, Camera* camera, bool allowDepthWrite) const;
+    /// Record the state and the draw calls.
+    void Draw(CommandList& commands, View* view, Camera* camera) const;
 
     /// Instance data.
     PODVector<InstanceData> instances_;
@@ -236,7 +238,9 @@ public:
     void SortFrontToBack2Pass(PODVector<Batch*>& batches);
     /// Pre-set instance data of all groups. The vertex buffer must be big enough to hold all data.
     void SetInstancingData(void* lockedData, unsigned stride, unsigned& freeIndex);
-    /// Draw.
+    /// Record the draw calls into the command list. Does not access Graphics, so may be called from worker threads.
+    void Record(View* view, Camera* camera, bool markToStencil, bool usingLightOptimization) const;
+    /// Draw by executing the command list. Records it first if not recorded for the same settings.
     void Draw(View* view, Camera* camera, bool markToStencil, bool usingLightOptimization, bool allowDepthWrite) const;
     /// Return the combined amount of instances.
     unsigned GetNumInstances() const;
@@ -271,6 +275,8 @@ public:
     StringHash vsExtraDefinesHash_;
     /// Hash for pixel shader extra defines.
     StringHash psExtraDefinesHash_;
+    /// Recorded draw commands. Mutable so that queues which are otherwise only read when drawing can record them.
+    mutable CommandList commands_;
 };
 
 /// Queue for shadow map draw calls.
@@ -295,8 +301,12 @@ struct LightBatchQueue
     Light* light_;
     /// Light negative flag.
     bool negative_;
+    /// Light is applied through the light clusters flag. Only batches of passes that do not use the clusters are queued.
+    bool clustered_;
     /// Shadow map depth texture.
     Texture2D* shadowMap_;
+    /// Cached shadow map the shadow map texture belongs to, or null if allocated for this frame only.
+    CachedShadowMap* cachedShadowMap_;
     /// Lit geometry draw calls, base (replace blend mode).
     BatchQueue litBaseBatches_;
     /// Lit geometry draw calls, non-base (additive).
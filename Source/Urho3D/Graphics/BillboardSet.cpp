@@ -24,6 +24,8 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/Batch.h"
 #include "../Graphics/BillboardSet.h"
 #include "../Graphics/Camera.h"
@@ -71,6 +73,163 @@ namespace Urho3D
         return lhs->sortDistance_ > rhs->sortDistance_;
     }
 
+    /// Number of billboards written at a time when splitting the vertex buffer update across worker threads.
+    static const unsigned BILLBOARD_CHUNK_SIZE = 1024;
+    /// Smallest number of enabled billboards for splitting the vertex buffer update across worker threads.
+    static const unsigned MIN_THREADED_BILLBOARDS = 4 * BILLBOARD_CHUNK_SIZE;
+
+    /// Range of billboards to write into the vertex buffer.
+    struct BillboardVertexChunk
+    {
+        /// Billboards in drawing order.
+        Billboard* const* billboards_;
+        /// Number of billboards.
+        unsigned count_;
+        /// Destination vertex data.
+        float* dest_;
+        /// Scaling applied to the billboard sizes.
+        Vector3 scale_;
+        /// Fixed screen size flag.
+        bool fixedScreenSize_;
+        /// Direction vertex format flag.
+        bool direction_;
+    };
+
+    /// Write the vertices of a range of billboards.
+    static void WriteBillboardVertices(const BillboardVertexChunk& chunk)
+    {
+        float* dest = chunk.dest_;
+
+        if (!chunk.direction_)
+        {
+            for (unsigned i = 0; i < chunk.count_; ++i)
+            {
+                Billboard& billboard = *chunk.billboards_[i];
+
+                Vector2 size(billboard.size_.x_ * chunk.scale_.x_, billboard.size_.y_ * chunk.scale_.y_);
+                unsigned color = billboard.color_.ToUInt();
+                if (chunk.fixedScreenSize_)
+                    size *= billboard.screenScaleFactor_;
+
+                float rotationMatrix[2][2];
+                SinCos(billboard.rotation_, rotationMatrix[0][1], rotationMatrix[0][0]);
+                rotationMatrix[1][0] = -rotationMatrix[0][1];
+                rotationMatrix[1][1] = rotationMatrix[0][0];
+
+                dest[0] = billboard.position_.x_;
+                dest[1] = billboard.position_.y_;
+                dest[2] = billboard.position_.z_;
+                ((unsigned&)dest[3]) = color;
+                dest[4] = billboard.uv_.min_.x_;
+                dest[5] = billboard.uv_.min_.y_;
+                dest[6] = -size.x_ * rotationMatrix[0][0] + size.y_ * rotationMatrix[0][1];
+                dest[7] = -size.x_ * rotationMatrix[1][0] + size.y_ * rotationMatrix[1][1];
+
+                dest[8] = billboard.position_.x_;
+                dest[9] = billboard.position_.y_;
+                dest[10] = billboard.position_.z_;
+                ((unsigned&)dest[11]) = color;
+                dest[12] = billboard.uv_.max_.x_;
+                dest[13] = billboard.uv_.min_.y_;
+                dest[14] = size.x_ * rotationMatrix[0][0] + size.y_ * rotationMatrix[0][1];
+                dest[15] = size.x_ * rotationMatrix[1][0] + size.y_ * rotationMatrix[1][1];
+
+                dest[16] = billboard.position_.x_;
+                dest[17] = billboard.position_.y_;
+                dest[18] = billboard.position_.z_;
+                ((unsigned&)dest[19]) = color;
+                dest[20] = billboard.uv_.max_.x_;
+                dest[21] = billboard.uv_.max_.y_;
+                dest[22] = size.x_ * rotationMatrix[0][0] - size.y_ * rotationMatrix[0][1];
+                dest[23] = size.x_ * rotationMatrix[1][0] - size.y_ * rotationMatrix[1][1];
+
+                dest[24] = billboard.position_.x_;
+                dest[25] = billboard.position_.y_;
+                dest[26] = billboard.position_.z_;
+                ((unsigned&)dest[27]) = color;
+                dest[28] = billboard.uv_.min_.x_;
+                dest[29] = billboard.uv_.max_.y_;
+                dest[30] = -size.x_ * rotationMatrix[0][0] - size.y_ * rotationMatrix[0][1];
+                dest[31] = -size.x_ * rotationMatrix[1][0] - size.y_ * rotationMatrix[1][1];
+
+                dest += 32;
+            }
+        }
+        else
+        {
+            for (unsigned i = 0; i < chunk.count_; ++i)
+            {
+                Billboard& billboard = *chunk.billboards_[i];
+
+                Vector2 size(billboard.size_.x_ * chunk.scale_.x_, billboard.size_.y_ * chunk.scale_.y_);
+                unsigned color = billboard.color_.ToUInt();
+                if (chunk.fixedScreenSize_)
+                    size *= billboard.screenScaleFactor_;
+
+                float rot2D[2][2];
+                SinCos(billboard.rotation_, rot2D[0][1], rot2D[0][0]);
+                rot2D[1][0] = -rot2D[0][1];
+                rot2D[1][1] = rot2D[0][0];
+
+                dest[0] = billboard.position_.x_;
+                dest[1] = billboard.position_.y_;
+                dest[2] = billboard.position_.z_;
+                dest[3] = billboard.direction_.x_;
+                dest[4] = billboard.direction_.y_;
+                dest[5] = billboard.direction_.z_;
+                ((unsigned&)dest[6]) = color;
+                dest[7] = billboard.uv_.min_.x_;
+                dest[8] = billboard.uv_.min_.y_;
+                dest[9] = -size.x_ * rot2D[0][0] + size.y_ * rot2D[0][1];
+                dest[10] = -size.x_ * rot2D[1][0] + size.y_ * rot2D[1][1];
+
+                dest[11] = billboard.position_.x_;
+                dest[12] = billboard.position_.y_;
+                dest[13] = billboard.position_.z_;
+                dest[14] = billboard.direction_.x_;
+                dest[15] = billboard.direction_.y_;
+                dest[16] = billboard.direction_.z_;
+                ((unsigned&)dest[17]) = color;
+                dest[18] = billboard.uv_.max_.x_;
+                dest[19] = billboard.uv_.min_.y_;
+                dest[20] = size.x_ * rot2D[0][0] + size.y_ * rot2D[0][1];
+                dest[21] = size.x_ * rot2D[1][0] + size.y_ * rot2D[1][1];
+
+                dest[22] = billboard.position_.x_;
+                dest[23] = billboard.position_.y_;
+                dest[24] = billboard.position_.z_;
+                dest[25] = billboard.direction_.x_;
+                dest[26] = billboard.direction_.y_;
+                dest[27] = billboard.direction_.z_;
+                ((unsigned&)dest[28]) = color;
+                dest[29] = billboard.uv_.max_.x_;
+                dest[30] = billboard.uv_.max_.y_;
+                dest[31] = size.x_ * rot2D[0][0] - size.y_ * rot2D[0][1];
+                dest[32] = size.x_ * rot2D[1][0] - size.y_ * rot2D[1][1];
+
+                dest[33] = billboard.position_.x_;
+                dest[34] = billboard.position_.y_;
+                dest[35] = billboard.position_.z_;
+                dest[36] = billboard.direction_.x_;
+                dest[37] = billboard.direction_.y_;
+                dest[38] = billboard.direction_.z_;
+                ((unsigned&)dest[39]) = color;
+                dest[40] = billboard.uv_.min_.x_;
+                dest[41] = billboard.uv_.max_.y_;
+                dest[42] = -size.x_ * rot2D[0][0] - size.y_ * rot2D[0][1];
+                dest[43] = -size.x_ * rot2D[1][0] - size.y_ * rot2D[1][1];
+
+                dest += 44;
+            }
+        }
+    }
+
+    /// Write the vertices of a range of billboards in a worker thread.
+    static void WriteBillboardVerticesWork(const WorkItem* item, unsigned threadIndex)
+    {
+        WriteBillboardVertices(*reinterpret_cast<const BillboardVertexChunk*>(item->start_));
+    }
+
     BillboardSet::BillboardSet(Context* context) :
         Drawable(context, DRAWABLE_GEOMETRY),
         animationLodBias_(1.0f),
@@ -632,127 +791,41 @@ namespace Urho3D
         if (!dest)
             return;
 
-        if (faceCameraMode_ != FC_DIRECTION)
+        // Split large billboard sets into chunks written by the worker threads. This runs on the main thread during the geometry
+        // update, where the rendering waits for the queued geometry updates to complete anyway
+        const unsigned floatsPerBillboard = faceCameraMode_ == FC_DIRECTION ? 44 : 32;
+        PODVector<BillboardVertexChunk> chunks;
+        for (unsigned i = 0; i < enabledBillboards; i += BILLBOARD_CHUNK_SIZE)
         {
-            for (unsigned i = 0; i < enabledBillboards; ++i)
-            {
-                Billboard& billboard = *sortedBillboards_[i];
-
-                Vector2 size(billboard.size_.x_ * billboardScale.x_, billboard.size_.y_ * billboardScale.y_);
-                unsigned color = billboard.color_.ToUInt();
-                if (fixedScreenSize_)
-                    size *= billboard.screenScaleFactor_;
-
-                float rotationMatrix[2][2];
-                SinCos(billboard.rotation_, rotationMatrix[0][1], rotationMatrix[0][0]);
-                rotationMatrix[1][0] = -rotationMatrix[0][1];
-                rotationMatrix[1][1] = rotationMatrix[0][0];
-
-                dest[0] = billboard.position_.x_;
-                dest[1] = billboard.position_.y_;
-                dest[2] = billboard.position_.z_;
-                ((unsigned&)dest[3]) = color;
-                dest[4] = billboard.uv_.min_.x_;
-                dest[5] = billboard.uv_.min_.y_;
-                dest[6] = -size.x_ * rotationMatrix[0][0] + size.y_ * rotationMatrix[0][1];
-                dest[7] = -size.x_ * rotationMatrix[1][0] + size.y_ * rotationMatrix[1][1];
-
-                dest[8] = billboard.position_.x_;
-                dest[9] = billboard.position_.y_;
-                dest[10] = billboard.position_.z_;
-                ((unsigned&)dest[11]) = color;
-                dest[12] = billboard.uv_.max_.x_;
-                dest[13] = billboard.uv_.min_.y_;
-                dest[14] = size.x_ * rotationMatrix[0][0] + size.y_ * rotationMatrix[0][1];
-                dest[15] = size.x_ * rotationMatrix[1][0] + size.y_ * rotationMatrix[1][1];
-
-                dest[16] = billboard.position_.x_;
-                dest[17] = billboard.position_.y_;
-                dest[18] = billboard.position_.z_;
-                ((unsigned&)dest[19]) = color;
-                dest[20] = billboard.uv_.max_.x_;
-                dest[21] = billboard.uv_.max_.y_;
-                dest[22] = size.x_ * rotationMatrix[0][0] - size.y_ * rotationMatrix[0][1];
-                dest[23] = size.x_ * rotationMatrix[1][0] - size.y_ * rotationMatrix[1][1];
-
-                dest[24] = billboard.position_.x_;
-                dest[25] = billboard.position_.y_;
-                dest[26] = billboard.position_.z_;
-                ((unsigned&)dest[27]) = color;
-                dest[28] = billboard.uv_.min_.x_;
-                dest[29] = billboard.uv_.max_.y_;
-                dest[30] = -size.x_ * rotationMatrix[0][0] - size.y_ * rotationMatrix[0][1];
-                dest[31] = -size.x_ * rotationMatrix[1][0] - size.y_ * rotationMatrix[1][1];
+            BillboardVertexChunk chunk;
+            chunk.billboards_ = sortedBillboards_.data() + i;
+            chunk.count_ = Min(enabledBillboards - i, BILLBOARD_CHUNK_SIZE);
+            chunk.dest_ = dest + i * floatsPerBillboard;
+            chunk.scale_ = billboardScale;
+            chunk.fixedScreenSize_ = fixedScreenSize_;
+            chunk.direction_ = faceCameraMode_ == FC_DIRECTION;
+            chunks.Push(chunk);
+        }
 
-                dest += 32;
+        auto* queue = GetSubsystem<WorkQueue>();
+        if (queue && queue->GetNumThreads() && enabledBillboards >= MIN_THREADED_BILLBOARDS && Thread::IsMainThread())
+        {
+            for (unsigned i = 1; i < chunks.Size(); ++i)
+            {
+                SharedPtr<WorkItem> item = queue->GetFreeItem();
+                item->priority_ = M_MAX_UNSIGNED;
+                item->workFunction_ = WriteBillboardVerticesWork;
+                item->start_ = &chunks[i];
+                queue->AddWorkItem(item);
             }
+
+            WriteBillboardVertices(chunks[0]);
+            queue->Complete(M_MAX_UNSIGNED);
         }
         else
         {
-            for (unsigned i = 0; i < enabledBillboards; ++i)
-            {
-                Billboard& billboard = *sortedBillboards_[i];
-
-                Vector2 size(billboard.size_.x_ * billboardScale.x_, billboard.size_.y_ * billboardScale.y_);
-                unsigned color = billboard.color_.ToUInt();
-                if (fixedScreenSize_)
-                    size *= billboard.screenScaleFactor_;
-
-                float rot2D[2][2];
-                SinCos(billboard.rotation_, rot2D[0][1], rot2D[0][0]);
-                rot2D[1][0] = -rot2D[0][1];
-                rot2D[1][1] = rot2D[0][0];
-
-                dest[0] = billboard.position_.x_;
-                dest[1] = billboard.position_.y_;
-                dest[2] = billboard.position_.z_;
-                dest[3] = billboard.direction_.x_;
-                dest[4] = billboard.direction_.y_;
-                dest[5] = billboard.direction_.z_;
-                ((unsigned&)dest[6]) = color;
-                dest[7] = billboard.uv_.min_.x_;
-                dest[8] = billboard.uv_.min_.y_;
-                dest[9] = -size.x_ * rot2D[0][0] + size.y_ * rot2D[0][1];
-                dest[10] = -size.x_ * rot2D[1][0] + size.y_ * rot2D[1][1];
-
-                dest[11] = billboard.position_.x_;
-                dest[12] = billboard.position_.y_;
-                dest[13] = billboard.position_.z_;
-                dest[14] = billboard.direction_.x_;
-                dest[15] = billboard.direction_.y_;
-                dest[16] = billboard.direction_.z_;
-                ((unsigned&)dest[17]) = color;
-                dest[18] = billboard.uv_.max_.x_;
-                dest[19] = billboard.uv_.min_.y_;
-                dest[20] = size.x_ * rot2D[0][0] + size.y_ * rot2D[0][1];
-                dest[21] = size.x_ * rot2D[1][0] + size.y_ * rot2D[1][1];
-
-                dest[22] = billboard.position_.x_;
-                dest[23] = billboard.position_.y_;
-                dest[24] = billboard.position_.z_;
-                dest[25] = billboard.direction_.x_;
-                dest[26] = billboard.direction_.y_;
-                dest[27] = billboard.direction_.z_;
-                ((unsigned&)dest[28]) = color;
-                dest[29] = billboard.uv_.max_.x_;
-                dest[30] = billboard.uv_.max_.y_;
-                dest[31] = size.x_ * rot2D[0][0] - size.y_ * rot2D[0][1];
-                dest[32] = size.x_ * rot2D[1][0] - size.y_ * rot2D[1][1];
-
-                dest[33] = billboard.position_.x_;
-                dest[34] = billboard.position_.y_;
-                dest[35] = billboard.position_.z_;
-                dest[36] = billboard.direction_.x_;
-                dest[37] = billboard.direction_.y_;
-                dest[38] = billboard.direction_.z_;
-                ((unsigned&)dest[39]) = color;
-                dest[40] = billboard.uv_.min_.x_;
-                dest[41] = billboard.uv_.max_.y_;
-                dest[42] = -size.x_ * rot2D[0][0] - size.y_ * rot2D[0][1];
-                dest[43] = -size.x_ * rot2D[1][0] - size.y_ * rot2D[1][1];
-
-                dest += 44;
-            }
+            for (unsigned i = 0; i < chunks.Size(); ++i)
+                WriteBillboardVertices(chunks[i]);
         }
 
         vertexBuffer_->Unlock();
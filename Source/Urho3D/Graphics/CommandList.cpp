@@ -0,0 +1,725 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/Variant.h"
+#include "../Graphics/Camera.h"
+#include "../Graphics/CommandList.h"
+#include "../Graphics/Geometry.h"
+#include "../Graphics/Graphics.h"
+#include "../Graphics/Renderer.h"
+#include "../Graphics/ShaderVariation.h"
+#include "../Graphics/VertexBuffer.h"
+#include "../Graphics/View.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static const unsigned STATE_BLENDMODE = 0x1;
+static const unsigned STATE_LINEANTIALIAS = 0x2;
+static const unsigned STATE_CULLMODE = 0x4;
+static const unsigned STATE_DEPTHBIAS = 0x8;
+static const unsigned STATE_FILLMODE = 0x10;
+static const unsigned STATE_DEPTHTEST = 0x20;
+static const unsigned STATE_DEPTHWRITE = 0x40;
+static const unsigned STATE_SCISSOR = 0x80;
+static const unsigned STATE_STENCIL = 0x100;
+
+/// Unknown shader parameter source.
+static const void* const UNKNOWN_SOURCE = (const void*)M_MAX_UNSIGNED;
+
+template <class T> T* GetCommandObject(const void* object)
+{
+    return static_cast<T*>(const_cast<void*>(object));
+}
+
+CommandList::CommandList() :
+    camera_(nullptr),
+    reverseCulling_(false),
+    markToStencil_(false),
+    usingLightOptimization_(false),
+    recorded_(false)
+{
+    ResetState();
+}
+
+void CommandList::Begin(Camera* camera, bool markToStencil, bool usingLightOptimization)
+{
+    commands_.Clear();
+    parameterData_.Clear();
+    camera_ = camera;
+    reverseCulling_ = camera && camera->GetReverseCulling();
+    markToStencil_ = markToStencil;
+    usingLightOptimization_ = usingLightOptimization;
+    recorded_ = false;
+    ResetState();
+}
+
+void CommandList::End()
+{
+    CloseParameterGroup();
+    recorded_ = true;
+}
+
+void CommandList::Clear()
+{
+    commands_.Clear();
+    parameterData_.Clear();
+    camera_ = nullptr;
+    recorded_ = false;
+    ResetState();
+}
+
+void CommandList::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
+{
+    if (vs == vertexShader_ && ps == pixelShader_)
+        return;
+
+    DrawCommand& command = AddCommand(DrawCommandType::SetShaders);
+    command.object_ = vs;
+    command.object2_ = ps;
+
+    vertexShader_ = vs;
+    pixelShader_ = ps;
+
+    // Parameter sources and texture units are per shader program, so forget what was recorded for the previous shaders
+    for (auto& parameterSource : parameterSources_)
+        parameterSource = UNKNOWN_SOURCE;
+    for (auto& texture : textures_)
+        texture = nullptr;
+}
+
+void CommandList::SetBlendMode(BlendMode mode, bool alphaToCoverage)
+{
+    if ((knownStates_ & STATE_BLENDMODE) && mode == blendMode_ && alphaToCoverage == alphaToCoverage_)
+        return;
+
+    DrawCommand& command = AddCommand(DrawCommandType::SetBlendMode);
+    command.value_ = mode;
+    command.count_ = alphaToCoverage ? 1 : 0;
+
+    blendMode_ = mode;
+    alphaToCoverage_ = alphaToCoverage;
+    knownStates_ |= STATE_BLENDMODE;
+}
+
+void CommandList::SetLineAntiAlias(bool enable)
+{
+    if ((knownStates_ & STATE_LINEANTIALIAS) && enable == lineAntiAlias_)
+        return;
+
+    DrawCommand& command = AddCommand(DrawCommandType::SetLineAntiAlias);
+    command.value_ = enable ? 1 : 0;
+
+    lineAntiAlias_ = enable;
+    knownStates_ |= STATE_LINEANTIALIAS;
+}
+
+void CommandList::SetCullMode(CullMode mode)
+{
+    // Check whether the camera reverses culling due to vertical flipping or reflection, like Renderer::SetCullMode()
+    if (reverseCulling_)
+    {
+        if (mode == CullMode::Clockwise)
+            mode = CullMode::CounterClockwise;
+        else if (mode == CullMode::CounterClockwise)
+            mode = CullMode::Clockwise;
+    }
+
+    if ((knownStates_ & STATE_CULLMODE) && mode == cullMode_)
+        return;
+
+    DrawCommand& command = AddCommand(DrawCommandType::SetCullMode);
+    command.value_ = (unsigned)mode;
+
+    cullMode_ = mode;
+    knownStates_ |= STATE_CULLMODE;
+}
+
+void CommandList::SetDepthBias(float constantBias, float slopeScaledBias)
+{
+    if ((knownStates_ & STATE_DEPTHBIAS) && constantBias == constantDepthBias_ && slopeScaledBias == slopeScaledDepthBias_)
+        return;
+
+    DrawCommand& command = AddCommand(DrawCommandType::SetDepthBias);
+    command.offset_ = parameterData_.Size();
+    parameterData_.Push(constantBias);
+    parameterData_.Push(slopeScaledBias);
+
+    constantDepthBias_ = constantBias;
+    slopeScaledDepthBias_ = slopeScaledBias;
+    knownStates_ |= STATE_DEPTHBIAS;
+}
+
+void CommandList::SetFillMode(FillMode mode)
+{
+    if ((knownStates_ & STATE_FILLMODE) && mode == fillMode_)
+        return;
+
+    DrawCommand& command = AddCommand(DrawCommandType::SetFillMode);
+    command.value_ = (unsigned)mode;
+
+    fillMode_ = mode;
+    knownStates_ |= STATE_FILLMODE;
+}
+
+void CommandList::SetDepthTest(CompareMode mode)
+{
+    if ((knownStates_ & STATE_DEPTHTEST) && mode == depthTestMode_)
+        return;
+
+    DrawCommand& command = AddCommand(DrawCommandType::SetDepthTest);
+    command.value_ = mode;
+
+    depthTestMode_ = mode;
+    knownStates_ |= STATE_DEPTHTEST;
+}
+
+void CommandList::SetDepthWrite(bool enable)
+{
+    if ((knownStates_ & STATE_DEPTHWRITE) && enable == depthWrite_)
+        return;
+
+    DrawCommand& command = AddCommand(DrawCommandType::SetDepthWrite);
+    command.value_ = enable ? 1 : 0;
+
+    depthWrite_ = enable;
+    knownStates_ |= STATE_DEPTHWRITE;
+}
+
+void CommandList::DisableScissorTest()
+{
+    if ((knownStates_ & STATE_SCISSOR) && !scissorLight_)
+        return;
+
+    AddCommand(DrawCommandType::SetScissorTest);
+
+    scissorLight_ = nullptr;
+    knownStates_ |= STATE_SCISSOR;
+}
+
+void CommandList::SetLightScissor(Light* light)
+{
+    if ((knownStates_ & STATE_SCISSOR) && light == scissorLight_)
+        return;
+
+    DrawCommand& command = AddCommand(DrawCommandType::SetLightScissor);
+    command.object_ = light;
+
+    scissorLight_ = light;
+    knownStates_ |= STATE_SCISSOR;
+}
+
+void CommandList::SetStencilTest(bool enable, unsigned lightMask)
+{
+    unsigned stencilRef = enable ? lightMask : M_MAX_UNSIGNED;
+    if ((knownStates_ & STATE_STENCIL) && stencilRef == stencilRef_)
+        return;
+
+    DrawCommand& command = AddCommand(DrawCommandType::SetStencilTest);
+    command.value_ = enable ? 1 : 0;
+    command.offset_ = lightMask;
+
+    stencilRef_ = stencilRef;
+    knownStates_ |= STATE_STENCIL;
+}
+
+bool CommandList::NeedParameterUpdate(ShaderParameterGroup group, const void* source)
+{
+    // Only consecutive parameter groups of the same shaders are filtered. Graphics filters the rest on replay
+    if (parameterSources_[group] == source)
+        return false;
+
+    DrawCommand& command = AddCommand(DrawCommandType::SetParameterGroup);
+    command.value_ = group;
+    command.object_ = source;
+
+    parameterSources_[group] = source;
+    openGroup_ = commands_.Size() - 1;
+    return true;
+}
+
+void CommandList::SetGlobalShaderParameters()
+{
+    if (parameterSources_[SP_FRAME] == nullptr)
+        return;
+
+    AddCommand(DrawCommandType::SetGlobalParameters);
+    parameterSources_[SP_FRAME] = nullptr;
+}
+
+void CommandList::SetCameraShaderParameters()
+{
+    // The viewport is not known until replay, but stays the same while a list is replayed
+    if (parameterSources_[SP_CAMERA] == camera_)
+        return;
+
+    AddCommand(DrawCommandType::SetCameraParameters);
+    parameterSources_[SP_CAMERA] = camera_;
+}
+
+void CommandList::SetShaderParameter(StringHash param, const float* data, unsigned count)
+{
+    AddShaderParameter(param, DrawParameterType::FloatArray, data, count);
+}
+
+void CommandList::SetShaderParameter(StringHash param, float value)
+{
+    AddShaderParameter(param, DrawParameterType::Float, &value, 1);
+}
+
+void CommandList::SetShaderParameter(StringHash param, int value)
+{
+    float data;
+    memcpy(&data, &value, sizeof(float));
+    AddShaderParameter(param, DrawParameterType::Int, &data, 1);
+}
+
+void CommandList::SetShaderParameter(StringHash param, bool value)
+{
+    int intValue = value ? 1 : 0;
+    float data;
+    memcpy(&data, &intValue, sizeof(float));
+    AddShaderParameter(param, DrawParameterType::Bool, &data, 1);
+}
+
+void CommandList::SetShaderParameter(StringHash param, const Color& color)
+{
+    AddShaderParameter(param, DrawParameterType::Vector4, color.Data(), 4);
+}
+
+void CommandList::SetShaderParameter(StringHash param, const Vector2& vector)
+{
+    AddShaderParameter(param, DrawParameterType::Vector2, vector.Data(), 2);
+}
+
+void CommandList::SetShaderParameter(StringHash param, const Matrix3& matrix)
+{
+    AddShaderParameter(param, DrawParameterType::Matrix3, matrix.Data(), 9);
+}
+
+void CommandList::SetShaderParameter(StringHash param, const Vector3& vector)
+{
+    AddShaderParameter(param, DrawParameterType::Vector3, vector.Data(), 3);
+}
+
+void CommandList::SetShaderParameter(StringHash param, const Matrix4& matrix)
+{
+    AddShaderParameter(param, DrawParameterType::Matrix4, matrix.Data(), 16);
+}
+
+void CommandList::SetShaderParameter(StringHash param, const Vector4& vector)
+{
+    AddShaderParameter(param, DrawParameterType::Vector4, vector.Data(), 4);
+}
+
+void CommandList::SetShaderParameter(StringHash param, const Matrix3x4& matrix)
+{
+    AddShaderParameter(param, DrawParameterType::Matrix3x4, matrix.Data(), 12);
+}
+
+void CommandList::SetShaderParameter(StringHash param, const Variant& value)
+{
+    switch (value.GetType())
+    {
+    case VAR_BOOL:
+        SetShaderParameter(param, value.GetBool());
+        break;
+
+    case VAR_INT:
+        SetShaderParameter(param, value.GetInt());
+        break;
+
+    case VAR_FLOAT:
+    case VAR_DOUBLE:
+        SetShaderParameter(param, value.GetFloat());
+        break;
+
+    case VAR_VECTOR2:
+        SetShaderParameter(param, value.GetVector2());
+        break;
+
+    case VAR_VECTOR3:
+        SetShaderParameter(param, value.GetVector3());
+        break;
+
+    case VAR_VECTOR4:
+        SetShaderParameter(param, value.GetVector4());
+        break;
+
+    case VAR_COLOR:
+        SetShaderParameter(param, value.GetColor());
+        break;
+
+    case VAR_MATRIX3:
+        SetShaderParameter(param, value.GetMatrix3());
+        break;
+
+    case VAR_MATRIX3X4:
+        SetShaderParameter(param, value.GetMatrix3x4());
+        break;
+
+    case VAR_MATRIX4:
+        SetShaderParameter(param, value.GetMatrix4());
+        break;
+
+    case VAR_BUFFER:
+        {
+            const PODVector<unsigned char>& buffer = value.GetBuffer();
+            if (buffer.Size() >= sizeof(float))
+                SetShaderParameter(param, reinterpret_cast<const float*>(&buffer[0]), buffer.Size() / sizeof(float));
+        }
+        break;
+
+    default:
+        // Unsupported parameter type, do nothing
+        break;
+    }
+}
+
+void CommandList::SetTexture(TextureUnit unit, Texture* texture)
+{
+    if (!HasTextureUnit(unit) || textures_[unit] == texture)
+        return;
+
+    DrawCommand& command = AddCommand(DrawCommandType::SetTexture);
+    command.value_ = unit;
+    command.object_ = texture;
+
+    textures_[unit] = texture;
+}
+
+void CommandList::SetClusteredLightTextures()
+{
+    if (HasShaderParameter(PSP_CLUSTERMATRIX))
+        AddCommand(DrawCommandType::SetClusteredLightTextures);
+}
+
+void CommandList::SetGeometryBuffers(Geometry* geometry)
+{
+    DrawCommand& command = AddCommand(DrawCommandType::SetGeometryBuffers);
+    command.object_ = geometry;
+}
+
+void CommandList::DrawGeometry(Geometry* geometry)
+{
+    DrawCommand& command = AddCommand(DrawCommandType::DrawGeometry);
+    command.object_ = geometry;
+}
+
+void CommandList::DrawIndexed(Geometry* geometry)
+{
+    DrawCommand& command = AddCommand(DrawCommandType::DrawIndexed);
+    command.object_ = geometry;
+}
+
+void CommandList::DrawInstanced(Geometry* geometry, VertexBuffer* instanceBuffer, unsigned startIndex, unsigned numInstances)
+{
+    DrawCommand& command = AddCommand(DrawCommandType::DrawInstanced);
+    command.object_ = geometry;
+    command.object2_ = instanceBuffer;
+    command.offset_ = startIndex;
+    command.count_ = numInstances;
+}
+
+void CommandList::Execute(View* view, bool allowDepthWrite) const
+{
+    Graphics* graphics = view->GetGraphics();
+    Renderer* renderer = view->GetRenderer();
+
+    for (unsigned i = 0; i < commands_.Size(); ++i)
+    {
+        const DrawCommand& command = commands_[i];
+
+        switch (command.type_)
+        {
+        case DrawCommandType::SetShaders:
+            graphics->SetShaders(GetCommandObject<ShaderVariation>(command.object_), GetCommandObject<ShaderVariation>(command.object2_));
+            break;
+
+        case DrawCommandType::SetBlendMode:
+            graphics->SetBlendMode((BlendMode)command.value_, command.count_ != 0);
+            break;
+
+        case DrawCommandType::SetLineAntiAlias:
+            graphics->SetLineAntiAlias(command.value_ != 0);
+            break;
+
+        case DrawCommandType::SetCullMode:
+            graphics->SetCullMode((CullMode)command.value_);
+            break;
+
+        case DrawCommandType::SetDepthBias:
+            graphics->SetDepthBias(parameterData_[command.offset_], parameterData_[command.offset_ + 1]);
+            break;
+
+        case DrawCommandType::SetFillMode:
+            graphics->SetFillMode((FillMode)command.value_);
+            break;
+
+        case DrawCommandType::SetDepthTest:
+            graphics->SetDepthTest((CompareMode)command.value_);
+            break;
+
+        case DrawCommandType::SetDepthWrite:
+            graphics->SetDepthWrite(command.value_ != 0 && allowDepthWrite);
+            break;
+
+        case DrawCommandType::SetScissorTest:
+            graphics->SetScissorTest(false);
+            break;
+
+        case DrawCommandType::SetLightScissor:
+            renderer->OptimizeLightByScissor(GetCommandObject<Light>(command.object_), camera_);
+            break;
+
+        case DrawCommandType::SetStencilTest:
+            if (command.value_)
+                graphics->SetStencilTest(true, CMP_ALWAYS, OP_REF, OP_KEEP, OP_KEEP, command.offset_);
+            else
+                graphics->SetStencilTest(false);
+            break;
+
+        case DrawCommandType::SetParameterGroup:
+            // Skip the group's parameters if the shader program already has them from the same source
+            if (!graphics->NeedParameterUpdate((ShaderParameterGroup)command.value_, command.object_))
+                i += command.count_;
+            break;
+
+        case DrawCommandType::SetGlobalParameters:
+            if (graphics->NeedParameterUpdate(SP_FRAME, nullptr))
+                view->SetGlobalShaderParameters();
+            break;
+
+        case DrawCommandType::SetCameraParameters:
+            {
+                auto cameraHash = (unsigned)(size_t)camera_;
+                IntRect viewport = graphics->GetViewport();
+                IntVector2 viewSize = IntVector2(viewport.Width(), viewport.Height());
+                auto viewportHash = (unsigned)viewSize.x | (unsigned)viewSize.y << 16u;
+                if (graphics->NeedParameterUpdate(SP_CAMERA, reinterpret_cast<const void*>(cameraHash + viewportHash)))
+                {
+                    view->SetCameraShaderParameters(camera_);
+                    // During renderpath commands the G-Buffer or viewport texture is assumed to always be viewport-sized
+                    view->SetGBufferShaderParameters(viewSize, IntRect(0, 0, viewSize.x, viewSize.y));
+                }
+            }
+            break;
+
+        case DrawCommandType::SetShaderParameter:
+            {
+                const float* data = &parameterData_[command.offset_];
+                switch (command.parameterType_)
+                {
+                case DrawParameterType::Float:
+                    graphics->SetShaderParameter(command.name_, *data);
+                    break;
+
+                case DrawParameterType::Int:
+                case DrawParameterType::Bool:
+                    {
+                        int value;
+                        memcpy(&value, data, sizeof(int));
+                        if (command.parameterType_ == DrawParameterType::Int)
+                            graphics->SetShaderParameter(command.name_, value);
+                        else
+                            graphics->SetShaderParameter(command.name_, value != 0);
+                    }
+                    break;
+
+                case DrawParameterType::Vector2:
+                    graphics->SetShaderParameter(command.name_, *reinterpret_cast<const Vector2*>(data));
+                    break;
+
+                case DrawParameterType::Vector3:
+                    graphics->SetShaderParameter(command.name_, *reinterpret_cast<const Vector3*>(data));
+                    break;
+
+                case DrawParameterType::Vector4:
+                    graphics->SetShaderParameter(command.name_, *reinterpret_cast<const Vector4*>(data));
+                    break;
+
+                case DrawParameterType::Matrix3:
+                    graphics->SetShaderParameter(command.name_, *reinterpret_cast<const Matrix3*>(data));
+                    break;
+
+                case DrawParameterType::Matrix3x4:
+                    graphics->SetShaderParameter(command.name_, *reinterpret_cast<const Matrix3x4*>(data));
+                    break;
+
+                case DrawParameterType::Matrix4:
+                    graphics->SetShaderParameter(command.name_, *reinterpret_cast<const Matrix4*>(data));
+                    break;
+
+                case DrawParameterType::FloatArray:
+                    graphics->SetShaderParameter(command.name_, data, command.count_);
+                    break;
+                }
+            }
+            break;
+
+        case DrawCommandType::SetTexture:
+            if (graphics->HasTextureUnit((TextureUnit)command.value_))
+                graphics->SetTexture(command.value_, GetCommandObject<Texture>(command.object_));
+            break;
+
+        case DrawCommandType::SetClusteredLightTextures:
+            if (graphics->HasShaderParameter(PSP_CLUSTERMATRIX))
+                view->SetClusteredLightTextures();
+            break;
+
+        case DrawCommandType::SetGeometryBuffers:
+            {
+                Geometry* geometry = GetCommandObject<Geometry>(command.object_);
+                graphics->SetIndexBuffer(geometry->GetIndexBuffer());
+                graphics->SetVertexBuffers(geometry->GetVertexBuffers());
+            }
+            break;
+
+        case DrawCommandType::DrawGeometry:
+            GetCommandObject<Geometry>(command.object_)->Draw(graphics);
+            break;
+
+        case DrawCommandType::DrawIndexed:
+            {
+                Geometry* geometry = GetCommandObject<Geometry>(command.object_);
+                graphics->DrawIndexed(geometry->GetPrimitiveType(), geometry->GetIndexCount(), 1, geometry->GetIndexStart());
+            }
+            break;
+
+        case DrawCommandType::DrawInstanced:
+            {
+                Geometry* geometry = GetCommandObject<Geometry>(command.object_);
+
+                // Get the geometry vertex buffers, then add the instancing stream buffer
+                // Hack: use a const_cast to avoid dynamic allocation of new temp vectors
+                auto& vertexBuffers = const_cast<Vector<SharedPtr<VertexBuffer> >&>(geometry->GetVertexBuffers());
+                vertexBuffers.Push(SharedPtr<VertexBuffer>(GetCommandObject<VertexBuffer>(command.object2_)));
+
+                graphics->SetIndexBuffer(geometry->GetIndexBuffer());
+                graphics->SetVertexBuffers(vertexBuffers, command.offset_);
+                graphics->DrawIndexed(geometry->GetPrimitiveType(), geometry->GetIndexCount(), command.count_, geometry->GetIndexStart());
+
+                // Remove the instancing buffer now
+                vertexBuffers.Pop();
+            }
+            break;
+        }
+    }
+}
+
+bool CommandList::HasShaderParameter(StringHash param) const
+{
+#if defined(URHO3D_OPENGL) || defined(URHO3D_NULLGRAPHICS)
+    // Parameters are only known once the shader program has been linked
+    return true;
+#else
+    if (!vertexShader_ || !pixelShader_ || !vertexShader_->GetGPUObject() || !pixelShader_->GetGPUObject())
+        return true;
+    return vertexShader_->HasParameter(param) || pixelShader_->HasParameter(param);
+#endif
+}
+
+bool CommandList::HasTextureUnit(TextureUnit unit) const
+{
+#if defined(URHO3D_OPENGL) || defined(URHO3D_NULLGRAPHICS)
+    // Texture units are only known once the shader program has been linked
+    return true;
+#else
+    if (!vertexShader_ || !pixelShader_ || !vertexShader_->GetGPUObject() || !pixelShader_->GetGPUObject())
+        return true;
+    return vertexShader_->HasTextureUnit(unit) || pixelShader_->HasTextureUnit(unit);
+#endif
+}
+
+bool CommandList::IsRecorded(Camera* camera, bool markToStencil, bool usingLightOptimization) const
+{
+    return recorded_ && camera == camera_ && (camera && camera->GetReverseCulling()) == reverseCulling_ &&
+        markToStencil == markToStencil_ && usingLightOptimization == usingLightOptimization_;
+}
+
+DrawCommand& CommandList::AddCommand(DrawCommandType type)
+{
+    if (type != DrawCommandType::SetShaderParameter)
+        CloseParameterGroup();
+
+    commands_.Resize(commands_.Size() + 1);
+    DrawCommand& command = commands_.Back();
+    command.type_ = type;
+    command.parameterType_ = DrawParameterType::Float;
+    command.name_ = StringHash::ZERO;
+    command.object_ = nullptr;
+    command.object2_ = nullptr;
+    command.value_ = 0;
+    command.offset_ = 0;
+    command.count_ = 0;
+    return command;
+}
+
+void CommandList::AddShaderParameter(StringHash param, DrawParameterType type, const float* data, unsigned count)
+{
+    DrawCommand& command = AddCommand(DrawCommandType::SetShaderParameter);
+    command.parameterType_ = type;
+    command.name_ = param;
+    command.offset_ = parameterData_.Size();
+    command.count_ = count;
+
+    parameterData_.Resize(parameterData_.Size() + count);
+    memcpy(&parameterData_[command.offset_], data, count * sizeof(float));
+}
+
+void CommandList::CloseParameterGroup()
+{
+    if (openGroup_ == M_MAX_UNSIGNED)
+        return;
+
+    commands_[openGroup_].count_ = commands_.Size() - openGroup_ - 1;
+    openGroup_ = M_MAX_UNSIGNED;
+}
+
+void CommandList::ResetState()
+{
+    openGroup_ = M_MAX_UNSIGNED;
+    vertexShader_ = nullptr;
+    pixelShader_ = nullptr;
+    for (auto& parameterSource : parameterSources_)
+        parameterSource = UNKNOWN_SOURCE;
+    for (auto& texture : textures_)
+        texture = nullptr;
+    blendMode_ = BLEND_REPLACE;
+    alphaToCoverage_ = false;
+    lineAntiAlias_ = false;
+    cullMode_ = CullMode::None;
+    constantDepthBias_ = 0.0f;
+    slopeScaledDepthBias_ = 0.0f;
+    fillMode_ = FillMode::Solid;
+    depthTestMode_ = CMP_ALWAYS;
+    depthWrite_ = false;
+    scissorLight_ = nullptr;
+    stencilRef_ = M_MAX_UNSIGNED;
+    knownStates_ = 0;
+}
+
+}
@@ -0,0 +1,267 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Container/Vector.h"
+#include "../Graphics/GraphicsDefs.h"
+#include "../Math/StringHash.h"
+
+namespace Urho3D
+{
+
+class Camera;
+class Color;
+class Geometry;
+class Light;
+class Matrix3;
+class Matrix3x4;
+class Matrix4;
+class ShaderVariation;
+class Texture;
+class Variant;
+class Vector2;
+class Vector3;
+class Vector4;
+class VertexBuffer;
+class View;
+
+/// Recorded draw command type.
+enum class DrawCommandType : unsigned char
+{
+    SetShaders = 0,
+    SetBlendMode,
+    SetLineAntiAlias,
+    SetCullMode,
+    SetDepthBias,
+    SetFillMode,
+    SetDepthTest,
+    SetDepthWrite,
+    SetScissorTest,
+    SetLightScissor,
+    SetStencilTest,
+    SetParameterGroup,
+    SetGlobalParameters,
+    SetCameraParameters,
+    SetShaderParameter,
+    SetTexture,
+    SetClusteredLightTextures,
+    SetGeometryBuffers,
+    DrawGeometry,
+    DrawIndexed,
+    DrawInstanced
+};
+
+/// Recorded shader parameter data type.
+enum class DrawParameterType : unsigned char
+{
+    Float = 0,
+    Int,
+    Bool,
+    Vector2,
+    Vector3,
+    Vector4,
+    Matrix3,
+    Matrix3x4,
+    Matrix4,
+    FloatArray
+};
+
+/// Recorded draw command. The meaning of the generic fields depends on the type.
+struct DrawCommand
+{
+    /// Command type.
+    DrawCommandType type_;
+    /// Shader parameter data type.
+    DrawParameterType parameterType_;
+    /// Shader parameter name.
+    StringHash name_;
+    /// First object: shader, texture, geometry, light, camera or parameter source.
+    const void* object_;
+    /// Second object: pixel shader, camera or instancing buffer.
+    const void* object2_;
+    /// Mode, flag, texture unit or parameter group.
+    unsigned value_;
+    /// Offset into the parameter data, stencil reference or instancing buffer start index.
+    unsigned offset_;
+    /// Number of floats of parameter data, number of commands in a parameter group, or number of instances.
+    unsigned count_;
+};
+
+/// Backend-agnostic list of draw commands. Batches record into it without touching Graphics, so that the lists of several batch queues can be recorded in worker threads. The main thread replays the lists in order. State that is already known to be set is filtered while recording, and the remaining redundant state is filtered by Graphics during replay.
+class URHO3D_API CommandList
+{
+public:
+    /// Construct.
+    CommandList();
+
+    /// Clear the commands and begin recording for a camera.
+    void Begin(Camera* camera, bool markToStencil, bool usingLightOptimization);
+    /// Finish recording.
+    void End();
+    /// Clear the commands and mark as not recorded.
+    void Clear();
+
+    /// Record shaders. Parameter groups of the previous shaders are forgotten if the shaders change.
+    void SetShaders(ShaderVariation* vs, ShaderVariation* ps);
+    /// Record blending mode.
+    void SetBlendMode(BlendMode mode, bool alphaToCoverage = false);
+    /// Record line antialiasing on/off.
+    void SetLineAntiAlias(bool enable);
+    /// Record hardware culling mode. The mode is reversed if the camera being recorded for reverses culling.
+    void SetCullMode(CullMode mode);
+    /// Record depth bias.
+    void SetDepthBias(float constantBias, float slopeScaledBias);
+    /// Record polygon fill mode.
+    void SetFillMode(FillMode mode);
+    /// Record depth compare.
+    void SetDepthTest(CompareMode mode);
+    /// Record depth write on/off. On replay depth write is also disabled if the depth-stencil is bound as a texture.
+    void SetDepthWrite(bool enable);
+    /// Record scissor test off.
+    void DisableScissorTest();
+    /// Record scissor test optimized for a light. Resolved by Renderer on replay.
+    void SetLightScissor(Light* light);
+    /// Record stencil test on for marking a light mask, or off.
+    void SetStencilTest(bool enable, unsigned lightMask = 0);
+    /// Begin recording a shader parameter group. Return false if the source is already known to be set for the current shaders, in which case the parameters should not be recorded. On replay the parameters are skipped if Graphics does not need them.
+    bool NeedParameterUpdate(ShaderParameterGroup group, const void* source);
+    /// Record global (per-frame) shader parameters. Set by View on replay if needed.
+    void SetGlobalShaderParameters();
+    /// Record camera and viewport shader parameters. Set by View on replay if needed.
+    void SetCameraShaderParameters();
+    /// Record a shader parameter as a float array.
+    void SetShaderParameter(StringHash param, const float* data, unsigned count);
+    /// Record a float shader parameter.
+    void SetShaderParameter(StringHash param, float value);
+    /// Record an integer shader parameter.
+    void SetShaderParameter(StringHash param, int value);
+    /// Record a boolean shader parameter.
+    void SetShaderParameter(StringHash param, bool value);
+    /// Record a color shader parameter.
+    void SetShaderParameter(StringHash param, const Color& color);
+    /// Record a Vector2 shader parameter.
+    void SetShaderParameter(StringHash param, const Vector2& vector);
+    /// Record a Matrix3 shader parameter.
+    void SetShaderParameter(StringHash param, const Matrix3& matrix);
+    /// Record a Vector3 shader parameter.
+    void SetShaderParameter(StringHash param, const Vector3& vector);
+    /// Record a Matrix4 shader parameter.
+    void SetShaderParameter(StringHash param, const Matrix4& matrix);
+    /// Record a Vector4 shader parameter.
+    void SetShaderParameter(StringHash param, const Vector4& vector);
+    /// Record a Matrix3x4 shader parameter.
+    void SetShaderParameter(StringHash param, const Matrix3x4& matrix);
+    /// Record a shader parameter from a variant. Unsupported variant types are ignored.
+    void SetShaderParameter(StringHash param, const Variant& value);
+    /// Record a texture. On replay the texture is only set if the shaders use the texture unit.
+    void SetTexture(TextureUnit unit, Texture* texture);
+    /// Record clustered light textures. Set by View on replay if the shaders use clustered lights.
+    void SetClusteredLightTextures();
+    /// Record index and vertex buffers of a geometry.
+    void SetGeometryBuffers(Geometry* geometry);
+    /// Record drawing of a geometry with its own buffers.
+    void DrawGeometry(Geometry* geometry);
+    /// Record indexed drawing of a geometry whose buffers have been set.
+    void DrawIndexed(Geometry* geometry);
+    /// Record instanced drawing of a geometry with an instancing buffer appended to its vertex buffers.
+    void DrawInstanced(Geometry* geometry, VertexBuffer* instanceBuffer, unsigned startIndex, unsigned numInstances);
+
+    /// Replay the commands through Graphics. Depth write is only enabled if allowed.
+    void Execute(View* view, bool allowDepthWrite) const;
+
+    /// Return whether the recorded shaders may use a shader parameter. Conservatively true if the shaders have not been reflected yet or reflection is only available for linked shader programs.
+    bool HasShaderParameter(StringHash param) const;
+    /// Return whether the recorded shaders may use a texture unit. Conservatively true if the shaders have not been reflected yet or reflection is only available for linked shader programs.
+    bool HasTextureUnit(TextureUnit unit) const;
+    /// Return the last recorded blend mode.
+    BlendMode GetBlendMode() const { return blendMode_; }
+    /// Return whether has been recorded for a camera with the given settings in the current frame.
+    bool IsRecorded(Camera* camera, bool markToStencil, bool usingLightOptimization) const;
+    /// Return commands.
+    const PODVector<DrawCommand>& GetCommands() const { return commands_; }
+    /// Return number of commands.
+    unsigned GetNumCommands() const { return commands_.Size(); }
+
+private:
+    /// Add a command and close the open parameter group unless the command is a shader parameter.
+    DrawCommand& AddCommand(DrawCommandType type);
+    /// Add shader parameter data and a command referring to it.
+    void AddShaderParameter(StringHash param, DrawParameterType type, const float* data, unsigned count);
+    /// Close the open parameter group.
+    void CloseParameterGroup();
+    /// Forget the recorded state.
+    void ResetState();
+
+    /// Commands.
+    PODVector<DrawCommand> commands_;
+    /// Shader parameter data.
+    PODVector<float> parameterData_;
+    /// Camera recorded for.
+    Camera* camera_;
+    /// Camera reverse culling flag at the time of recording.
+    bool reverseCulling_;
+    /// Stencil marking flag.
+    bool markToStencil_;
+    /// View light optimization flag.
+    bool usingLightOptimization_;
+    /// Recorded flag.
+    bool recorded_;
+    /// Index of the open parameter group command, or M_MAX_UNSIGNED if none.
+    unsigned openGroup_;
+    /// Last recorded vertex shader.
+    ShaderVariation* vertexShader_;
+    /// Last recorded pixel shader.
+    ShaderVariation* pixelShader_;
+    /// Last recorded source of each parameter group for the current shaders.
+    const void* parameterSources_[MAX_SHADER_PARAMETER_GROUPS];
+    /// Last recorded blend mode.
+    BlendMode blendMode_;
+    /// Last recorded alpha to coverage flag.
+    bool alphaToCoverage_;
+    /// Last recorded line antialiasing flag.
+    bool lineAntiAlias_;
+    /// Last recorded cull mode.
+    CullMode cullMode_;
+    /// Last recorded constant depth bias.
+    float constantDepthBias_;
+    /// Last recorded slope-scaled depth bias.
+    float slopeScaledDepthBias_;
+    /// Last recorded fill mode.
+    FillMode fillMode_;
+    /// Last recorded depth compare.
+    CompareMode depthTestMode_;
+    /// Last recorded depth write flag.
+    bool depthWrite_;
+    /// Last recorded light of the scissor test, or null if disabled.
+    Light* scissorLight_;
+    /// Last recorded stencil reference for light mask marking, or M_MAX_UNSIGNED if the stencil test is disabled.
+    unsigned stencilRef_;
+    /// Last recorded textures for the current shaders.
+    Texture* textures_[MAX_TEXTURE_UNITS];
+    /// Bitmask of the render states recorded since the list began.
+    unsigned knownStates_;
+};
+
+}
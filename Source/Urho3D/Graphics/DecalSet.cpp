@@ -22,6 +22,7 @@
 
 #include "../Precompiled.h"
 
+#include "../Container/Sort.h"
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
 #include "../Graphics/AnimatedModel.h"
@@ -33,6 +34,7 @@
 #include "../Graphics/IndexBuffer.h"
 #include "../Graphics/Material.h"
 #include "../Graphics/Tangent.h"
+#include "../Graphics/TriangleTree.h"
 #include "../Graphics/VertexBuffer.h"
 #include "../IO/Log.h"
 #include "../IO/MemoryBuffer.h"
@@ -759,7 +761,60 @@ namespace Urho3D
             }
         }
 
-        if (indexData)
+        // If the positions are the ones the geometry's triangle tree was built from, only test the triangles near the decal
+        const TriangleTree* tree = geometry->GetTriangleTree();
+        if (tree)
+        {
+            const unsigned char* rawVertexData;
+            const unsigned char* rawIndexData;
+            unsigned rawVertexSize;
+            unsigned rawIndexSize;
+            const PODVector<VertexElement>* elements;
+            geometry->GetRawData(rawVertexData, rawVertexSize, rawIndexData, rawIndexSize, elements);
+            if (rawVertexData != positionData || rawIndexData != indexData)
+                tree = nullptr;
+        }
+
+        if (tree)
+        {
+            PODVector<unsigned> triangles;
+            tree->GetTriangles(triangles, frustum);
+            // Keep the faces in source order
+            Sort(triangles.Begin(), triangles.End());
+
+            for (unsigned triangle : triangles)
+            {
+                unsigned i0, i1, i2;
+                if (indexData)
+                {
+                    unsigned index = geometry->GetIndexStart() + triangle * 3;
+                    if (indexStride == sizeof(unsigned short))
+                    {
+                        const unsigned short* indices = ((const unsigned short*)indexData) + index;
+                        i0 = indices[0];
+                        i1 = indices[1];
+                        i2 = indices[2];
+                    }
+                    else
+                    {
+                        const unsigned* indices = ((const unsigned*)indexData) + index;
+                        i0 = indices[0];
+                        i1 = indices[1];
+                        i2 = indices[2];
+                    }
+                }
+                else
+                {
+                    i0 = geometry->GetVertexStart() + triangle * 3;
+                    i1 = i0 + 1;
+                    i2 = i0 + 2;
+                }
+
+                GetFace(faces, target, batchIndex, i0, i1, i2, positionData, normalData, skinningData, positionStride, normalStride,
+                    skinningStride, frustum, decalNormal, normalCutoff);
+            }
+        }
+        else if (indexData)
         {
             unsigned indexStart = geometry->GetIndexStart();
             unsigned indexCount = geometry->GetIndexCount();
@@ -1712,6 +1712,16 @@ namespace Urho3D
         // No-op on Direct3D11
     }
 
+    void Graphics::LoadShaderProgramCache()
+    {
+        // No-op on Direct3D11, which caches the bytecode of each shader variation instead
+    }
+
+    void Graphics::SaveShaderProgramCache()
+    {
+        // No-op on Direct3D11
+    }
+
     ConstantBuffer* Graphics::GetOrCreateConstantBuffer(ShaderType type, unsigned index, unsigned size)
     {
         // Ensure that different shader types and index slots get unique buffers, even if the size is same
@@ -2567,6 +2577,8 @@ namespace Urho3D
         textureUnits_["ShadowMap"] = TU_SHADOWMAP;
         textureUnits_["FaceSelectCubeMap"] = TU_FACESELECT;
         textureUnits_["IndirectionCubeMap"] = TU_INDIRECTION;
+        textureUnits_["LightClusterMap"] = TU_LIGHTCLUSTERS;
+        textureUnits_["LightDataMap"] = TU_LIGHTDATA;
         textureUnits_["VolumeMap"] = TU_VOLUMEMAP;
         textureUnits_["ZoneCubeMap"] = TU_ZONE;
         textureUnits_["ZoneVolumeMap"] = TU_ZONE;
@@ -58,32 +58,13 @@ void ShaderVariation::OnDeviceLost()
 
 bool ShaderVariation::Create()
 {
-    Release();
-
-    if (!graphics_)
-        return false;
-
-    if (!owner_)
+    // Use the bytecode prepared in a worker thread if available, else load or compile it now
+    if (!CompletePrepare())
     {
-        compilerOutput_ = "Owner shader has expired";
-        return false;
-    }
-
-    // Check for up-to-date bytecode on disk
-    String path, name, extension;
-    SplitPath(owner_->GetName(), path, name, extension);
-    extension = type_ == VS ? ".vs4" : ".ps4";
+        Release();
 
-    String binaryShaderName = graphics_->GetShaderCacheDir() + name + "_" + StringHash(defines_).ToString() + extension;
-
-    if (!LoadByteCode(binaryShaderName))
-    {
-        // Compile shader if don't have valid bytecode
-        if (!Compile())
+        if (!Prepare())
             return false;
-        // Save the bytecode after successful compile, but not if the source is from a package
-        if (owner_->GetTimeStamp())
-            SaveByteCode(binaryShaderName);
     }
 
     // Then create shader from the bytecode
@@ -120,8 +101,42 @@ bool ShaderVariation::Create()
     return object_.ptr_ != nullptr;
 }
 
+bool ShaderVariation::Prepare()
+{
+    if (!graphics_)
+        return false;
+
+    if (!owner_)
+    {
+        compilerOutput_ = "Owner shader has expired";
+        return false;
+    }
+
+    // Check for up-to-date bytecode on disk
+    String path, name, extension;
+    SplitPath(owner_->GetName(), path, name, extension);
+    extension = type_ == VS ? ".vs4" : ".ps4";
+
+    String binaryShaderName = graphics_->GetShaderCacheDir() + name + "_" + StringHash(defines_).ToString() + extension;
+
+    if (!LoadByteCode(binaryShaderName))
+    {
+        // Compile shader if don't have valid bytecode
+        if (!Compile())
+            return false;
+        // Save the bytecode after successful compile, but not if the source is from a package
+        if (owner_->GetTimeStamp())
+            SaveByteCode(binaryShaderName);
+    }
+
+    return true;
+}
+
 void ShaderVariation::Release()
 {
+    // Discard a preparation in a worker thread, as the data is cleared below
+    ReleasePrepared();
+
     if (object_.ptr_)
     {
         if (!graphics_)
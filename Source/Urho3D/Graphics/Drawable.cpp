@@ -55,6 +55,7 @@ namespace Urho3D
         updateQueued_(false),
         zoneDirty_(false),
         octant_(nullptr),
+        treeProxy_(M_MAX_UNSIGNED),
         zone_(nullptr),
         viewMask_(DEFAULT_VIEWMASK),
         lightMask_(DEFAULT_LIGHTMASK),
@@ -210,6 +211,9 @@ namespace Urho3D
 
     void Drawable::SetCastShadows(bool enable)
     {
+        if (enable != castShadows_ && octant_)
+            octant_->GetRoot()->MarkShadowCasterChanged(GetWorldBoundingBox());
+
         castShadows_ = enable;
         MarkNetworkUpdate();
     }
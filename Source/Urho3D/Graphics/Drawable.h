@@ -113,6 +113,7 @@ namespace Urho3D
     {
         URHO3D_OBJECT(Drawable, Component);
 
+        friend class DrawableTree;
         friend class Octant;
         friend class Octree;
         friend void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex);
@@ -376,6 +377,8 @@ namespace Urho3D
         bool zoneDirty_;
         /// Octree octant.
         Octant* octant_;
+        /// Node or position in the octree's bounding volume hierarchy, or M_MAX_UNSIGNED if not in it.
+        unsigned treeProxy_;
         /// Current zone.
         Zone* zone_;
         /// View mask.
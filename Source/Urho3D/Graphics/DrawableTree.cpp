@@ -0,0 +1,1018 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Graphics/DebugRenderer.h"
+#include "../Graphics/Drawable.h"
+#include "../Graphics/DrawableTree.h"
+#include "../Graphics/OctreeQuery.h"
+#include "../Graphics/RayPacket.h"
+
+#include <algorithm>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+    /// Proxy bit marking a drawable as stored in the static tree; the remaining bits are its position.
+    static constexpr unsigned STATIC_PROXY_FLAG = 0x80000000;
+    /// Initial dynamic leaf bounds margin as a fraction of the drawable size.
+    static constexpr float LEAF_MARGIN_SCALE = 0.125f;
+    /// Minimum dynamic leaf bounds margin.
+    static constexpr float LEAF_MARGIN_MIN = 0.05f;
+    /// Initial dynamic leaf bounds margin for a drawable that moved out of the static tree.
+    static constexpr float LEAF_MOVED_MARGIN_SCALE = 1.0f;
+    /// Maximum dynamic leaf bounds margin as a multiple of the drawable size. The margin doubles each time the drawable escapes its leaf bounds.
+    static constexpr float LEAF_MARGIN_MAX_SCALE = 8.0f;
+    /// Minimum dynamic leaf bounds margin after an escape as a multiple of the distance moved since the leaf bounds were set.
+    static constexpr float LEAF_DISPLACEMENT_SCALE = 4.0f;
+    /// Number of frames a drawable must stay still before it can be migrated to the static tree.
+    static constexpr unsigned SETTLE_FRAMES = 30;
+    /// Minimum number of settled drawables to trigger a static tree rebuild.
+    static constexpr unsigned MIN_STATIC_REBUILD = 256;
+    /// Minimum number of leaves inserted in one batch to rebuild the dynamic tree instead of inserting them one by one.
+    static constexpr unsigned MIN_BULK_INSERT = 1024;
+    /// Maximum number of drawables in a static tree leaf.
+    static constexpr unsigned STATIC_LEAF_SIZE = 8;
+    /// Traversal stack size. The dynamic tree is height balanced and the static tree is split at the median, so neither gets close.
+    static constexpr unsigned MAX_TRAVERSAL_DEPTH = 128;
+    /// Number of dynamic leaves batched per query drawable test.
+    static constexpr unsigned QUERY_BATCH_SIZE = 64;
+    /// Number of tree levels drawn as debug geometry.
+    static constexpr unsigned DEBUG_DRAW_LEVELS = 6;
+
+    /// Traversal stack entry.
+    struct TraversalEntry
+    {
+        /// Node index.
+        unsigned node_;
+        /// Whether the parent was fully inside the query.
+        bool inside_;
+    };
+
+    /// Traversal stack entry of a multi-frustum query.
+    struct MaskedTraversalEntry
+    {
+        /// Node index.
+        unsigned node_;
+        /// Frustums the parent was not outside of.
+        unsigned activeMask_;
+        /// Frustums the parent was fully inside of.
+        unsigned insideMask_;
+    };
+
+    /// Return half the surface area of a bounding box, used as the insertion cost.
+    static inline float HalfArea(const BoundingBox& box)
+    {
+        Vector3 size = box.max_ - box.min_;
+        return size.x_ * size.y_ + size.y_ * size.z_ + size.z_ * size.x_;
+    }
+
+    /// Return the union of two bounding boxes.
+    static inline BoundingBox Union(const BoundingBox& lhs, const BoundingBox& rhs)
+    {
+        BoundingBox ret(lhs);
+        ret.Merge(rhs);
+        return ret;
+    }
+
+    /// Return loose bounds for a dynamic leaf.
+    static inline BoundingBox Fatten(const BoundingBox& box, float margin)
+    {
+        Vector3 offset(margin, margin, margin);
+        return BoundingBox(box.min_ - offset, box.max_ + offset);
+    }
+
+    /// Partition a range of build items at the median of their centers along the longest axis. Return the size of the first half.
+    static unsigned PartitionAtMedian(std::vector<DrawableTreeBuildItem>& items, unsigned first, unsigned count)
+    {
+        BoundingBox centerBox;
+        for (unsigned i = first; i < first + count; ++i)
+            centerBox.Merge(items[i].center_);
+
+        Vector3 size = centerBox.Size();
+        unsigned axis = size.x_ >= size.y_ && size.x_ >= size.z_ ? 0 : (size.y_ >= size.z_ ? 1 : 2);
+        unsigned half = count / 2;
+        std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count,
+            [axis](const DrawableTreeBuildItem& lhs, const DrawableTreeBuildItem& rhs)
+            {
+                return lhs.center_.Data()[axis] < rhs.center_.Data()[axis];
+            });
+        return half;
+    }
+
+    DrawableTree::DrawableTree() :
+        root_(M_MAX_UNSIGNED),
+        freeList_(M_MAX_UNSIGNED),
+        numDynamic_(0),
+        settleQueueHead_(0),
+        numStatic_(0),
+        batching_(false)
+    {
+    }
+
+    DrawableTree::~DrawableTree() = default;
+
+    void DrawableTree::Insert(Drawable* drawable, unsigned frameNumber)
+    {
+        assert(drawable->treeProxy_ == M_MAX_UNSIGNED);
+        InsertDynamic(drawable, frameNumber, LEAF_MARGIN_SCALE);
+    }
+
+    void DrawableTree::Move(Drawable* drawable, unsigned frameNumber)
+    {
+        unsigned proxy = drawable->treeProxy_;
+        if (proxy == M_MAX_UNSIGNED)
+            return;
+
+        // A static drawable that moves becomes dynamic again. It is likely to keep moving, so start with a larger margin
+        if (proxy & STATIC_PROXY_FLAG)
+        {
+            RemoveStatic(proxy & ~STATIC_PROXY_FLAG);
+            InsertDynamic(drawable, frameNumber, LEAF_MOVED_MARGIN_SCALE);
+            return;
+        }
+
+        DrawableTreeNode& node = nodes_[proxy];
+        node.lastMoveFrame_ = frameNumber;
+        QueueSettle(proxy, frameNumber);
+
+        // Nothing to do while the drawable stays within its loose bounds
+        const BoundingBox& box = drawable->GetWorldBoundingBox();
+        if (bounds_[proxy].IsInside(box) == INSIDE)
+            return;
+
+        // Fast movers get larger margins so that they escape less often. Refit in place if the parent still encloses the
+        // new loose bounds, otherwise reinsert the leaf
+        float displacement = (box.Center() - bounds_[proxy].Center()).Length();
+        node.margin_ = Min(Max(node.margin_ * 2.0f, displacement * LEAF_DISPLACEMENT_SCALE),
+            Max(box.Size().Length() * LEAF_MARGIN_MAX_SCALE, LEAF_MARGIN_MIN));
+        BoundingBox fatBox = Fatten(box, node.margin_);
+        if (!IsLinked(proxy) || (node.parent_ != M_MAX_UNSIGNED && bounds_[node.parent_].IsInside(fatBox) == INSIDE))
+        {
+            bounds_[proxy] = fatBox;
+            return;
+        }
+
+        RemoveLeaf(proxy);
+        bounds_[proxy] = fatBox;
+        LinkLeaf(proxy);
+    }
+
+    void DrawableTree::Remove(Drawable* drawable)
+    {
+        unsigned proxy = drawable->treeProxy_;
+        if (proxy == M_MAX_UNSIGNED)
+            return;
+
+        if (proxy & STATIC_PROXY_FLAG)
+            RemoveStatic(proxy & ~STATIC_PROXY_FLAG);
+        else
+            RemoveDynamic(proxy);
+    }
+
+    void DrawableTree::BeginBatch()
+    {
+        batching_ = true;
+    }
+
+    void DrawableTree::EndBatch()
+    {
+        batching_ = false;
+        if (pendingLeaves_.empty())
+            return;
+
+        // When a large part of the tree changes at once, for example when many static drawables start to move, a top-down
+        // rebuild is much cheaper than inserting the leaves one by one
+        if (pendingLeaves_.size() >= MIN_BULK_INSERT && pendingLeaves_.size() >= numDynamic_ / 4)
+            RebuildDynamic();
+        else
+        {
+            for (unsigned leaf : pendingLeaves_)
+                InsertLeaf(leaf);
+        }
+
+        pendingLeaves_.clear();
+    }
+
+    void DrawableTree::Update(unsigned frameNumber)
+    {
+        // Check the leaves that are due; leaves that moved in the meantime are queued again
+        while (settleQueueHead_ < settleQueue_.size() && settleQueue_[settleQueueHead_].second <= frameNumber)
+        {
+            unsigned nodeIndex = settleQueue_[settleQueueHead_++].first;
+            DrawableTreeNode& node = nodes_[nodeIndex];
+            if (node.height_ != 0 || !node.settleQueued_)
+                continue;
+
+            if (frameNumber - node.lastMoveFrame_ >= SETTLE_FRAMES)
+            {
+                node.settleQueued_ = false;
+                settled_.push_back(nodeIndex);
+            }
+            else
+                settleQueue_.emplace_back(nodeIndex, node.lastMoveFrame_ + SETTLE_FRAMES);
+        }
+
+        if (settleQueueHead_ >= settleQueue_.size())
+        {
+            settleQueue_.clear();
+            settleQueueHead_ = 0;
+        }
+        else if (settleQueueHead_ > settleQueue_.size() / 2)
+        {
+            settleQueue_.erase(settleQueue_.begin(), settleQueue_.begin() + settleQueueHead_);
+            settleQueueHead_ = 0;
+        }
+
+        // Rebuilding is O(n log n) in the static drawable count, so wait until the change is large enough relative to it.
+        // Removed static drawables leave holes in the leaf ranges, which are compacted only once they outnumber the drawables
+        unsigned numHoles = staticDrawables_.Size() - numStatic_;
+        if (settled_.size() >= Max(MIN_STATIC_REBUILD, numStatic_ / 4) || (numHoles >= MIN_STATIC_REBUILD && numHoles >= numStatic_))
+            RebuildStatic(frameNumber);
+    }
+
+    void DrawableTree::Clear()
+    {
+        for (const DrawableTreeNode& node : nodes_)
+        {
+            if (node.height_ == 0)
+                node.drawable_->treeProxy_ = M_MAX_UNSIGNED;
+        }
+        for (const StaticDrawableTreeNode& node : staticNodes_)
+        {
+            for (unsigned i = node.first_; i < node.first_ + node.count_; ++i)
+                staticDrawables_[i]->treeProxy_ = M_MAX_UNSIGNED;
+        }
+
+        nodes_.clear();
+        bounds_.clear();
+        root_ = M_MAX_UNSIGNED;
+        freeList_ = M_MAX_UNSIGNED;
+        numDynamic_ = 0;
+        settleQueue_.clear();
+        settleQueueHead_ = 0;
+        settled_.clear();
+        pendingLeaves_.clear();
+        staticNodes_.clear();
+        staticBounds_.clear();
+        staticDrawables_.Clear();
+        staticLeaves_.clear();
+        numStatic_ = 0;
+    }
+
+    template <class NodeTest, class LeafVisitor> void DrawableTree::TraverseStatic(NodeTest test, LeafVisitor visit) const
+    {
+        if (staticNodes_.empty())
+            return;
+
+        TraversalEntry stack[MAX_TRAVERSAL_DEPTH];
+        unsigned stackSize = 0;
+        stack[stackSize++] = { 0, false };
+
+        while (stackSize)
+        {
+            TraversalEntry entry = stack[--stackSize];
+            bool inside = entry.inside_;
+            if (!test(staticBounds_[entry.node_], inside))
+                continue;
+
+            const StaticDrawableTreeNode& node = staticNodes_[entry.node_];
+            if (node.right_ == M_MAX_UNSIGNED)
+            {
+                if (node.count_)
+                {
+                    auto** start = const_cast<Drawable**>(&staticDrawables_[node.first_]);
+                    visit(start, start + node.count_, inside);
+                }
+            }
+            else
+            {
+                assert(stackSize + 2 <= MAX_TRAVERSAL_DEPTH);
+                stack[stackSize++] = { node.right_, inside };
+                stack[stackSize++] = { entry.node_ + 1, inside };
+            }
+        }
+    }
+
+    template <class NodeTest, class LeafVisitor> void DrawableTree::TraverseDynamic(NodeTest test, LeafVisitor visit) const
+    {
+        if (root_ == M_MAX_UNSIGNED)
+            return;
+
+        TraversalEntry stack[MAX_TRAVERSAL_DEPTH];
+        unsigned stackSize = 0;
+        stack[stackSize++] = { root_, false };
+
+        while (stackSize)
+        {
+            TraversalEntry entry = stack[--stackSize];
+            const DrawableTreeNode& node = nodes_[entry.node_];
+
+            // Leaf bounds are loose, so leave the exact test to the query
+            if (node.height_ == 0)
+            {
+                visit(node.drawable_, entry.inside_);
+                continue;
+            }
+
+            bool inside = entry.inside_;
+            if (!test(bounds_[entry.node_], inside))
+                continue;
+
+            assert(stackSize + 2 <= MAX_TRAVERSAL_DEPTH);
+            stack[stackSize++] = { node.child2_, inside };
+            stack[stackSize++] = { node.child1_, inside };
+        }
+    }
+
+    void DrawableTree::GetDrawables(OctreeQuery& query) const
+    {
+        auto test = [&query](const BoundingBox& box, bool& inside)
+        {
+            Intersection res = query.TestOctant(box, inside);
+            if (res == OUTSIDE)
+                return false;
+            if (res == INSIDE)
+                inside = true;
+            return true;
+        };
+
+        TraverseStatic(test, [&query](Drawable** start, Drawable** end, bool inside)
+        {
+            query.TestDrawables(start, end, inside);
+        });
+
+        // Dynamic leaves hold one drawable each, so batch them to the query
+        Drawable* batches[2][QUERY_BATCH_SIZE];
+        unsigned batchSizes[2] = { 0, 0 };
+
+        TraverseDynamic(test, [&](Drawable* drawable, bool inside)
+        {
+            unsigned batch = inside ? 1 : 0;
+            batches[batch][batchSizes[batch]++] = drawable;
+            if (batchSizes[batch] == QUERY_BATCH_SIZE)
+            {
+                query.TestDrawables(batches[batch], batches[batch] + QUERY_BATCH_SIZE, inside);
+                batchSizes[batch] = 0;
+            }
+        });
+
+        for (unsigned i = 0; i < 2; ++i)
+        {
+            if (batchSizes[i])
+                query.TestDrawables(batches[i], batches[i] + batchSizes[i], i == 1);
+        }
+    }
+
+    void DrawableTree::GetDrawables(MultiFrustumOctreeQuery& query) const
+    {
+        // Carry the active and inside frustum masks down the trees instead of a single inside flag
+        MaskedTraversalEntry stack[MAX_TRAVERSAL_DEPTH];
+        unsigned stackSize = 0;
+        unsigned allMask = query.GetFrustumsMask();
+
+        if (!staticNodes_.empty())
+            stack[stackSize++] = { 0, allMask, 0 };
+        while (stackSize)
+        {
+            MaskedTraversalEntry entry = stack[--stackSize];
+            query.TestOctant(staticBounds_[entry.node_], entry.activeMask_, entry.insideMask_);
+            if (!entry.activeMask_)
+                continue;
+
+            const StaticDrawableTreeNode& node = staticNodes_[entry.node_];
+            if (node.right_ == M_MAX_UNSIGNED)
+            {
+                if (node.count_)
+                {
+                    auto** start = const_cast<Drawable**>(&staticDrawables_[node.first_]);
+                    query.TestDrawables(start, start + node.count_, entry.activeMask_, entry.insideMask_);
+                }
+            }
+            else
+            {
+                assert(stackSize + 2 <= MAX_TRAVERSAL_DEPTH);
+                stack[stackSize++] = { node.right_, entry.activeMask_, entry.insideMask_ };
+                stack[stackSize++] = { entry.node_ + 1, entry.activeMask_, entry.insideMask_ };
+            }
+        }
+
+        if (root_ != M_MAX_UNSIGNED)
+            stack[stackSize++] = { root_, allMask, 0 };
+        while (stackSize)
+        {
+            MaskedTraversalEntry entry = stack[--stackSize];
+            const DrawableTreeNode& node = nodes_[entry.node_];
+
+            // Leaf bounds are loose, so leave the exact test to the query
+            if (node.height_ == 0)
+            {
+                Drawable* drawable = node.drawable_;
+                query.TestDrawables(&drawable, &drawable + 1, entry.activeMask_, entry.insideMask_);
+                continue;
+            }
+
+            query.TestOctant(bounds_[entry.node_], entry.activeMask_, entry.insideMask_);
+            if (!entry.activeMask_)
+                continue;
+
+            assert(stackSize + 2 <= MAX_TRAVERSAL_DEPTH);
+            stack[stackSize++] = { node.child2_, entry.activeMask_, entry.insideMask_ };
+            stack[stackSize++] = { node.child1_, entry.activeMask_, entry.insideMask_ };
+        }
+    }
+
+    void DrawableTree::GetDrawables(RayOctreeQuery& query) const
+    {
+        auto test = [&query](const BoundingBox& box, bool& /*inside*/)
+        {
+            return query.ray_.HitDistance(box) < query.maxDistance_;
+        };
+
+        auto process = [&query](Drawable* drawable)
+        {
+            if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+                drawable->ProcessRayQuery(query, query.result_);
+        };
+
+        TraverseStatic(test, [&process](Drawable** start, Drawable** end, bool /*inside*/)
+        {
+            while (start != end)
+                process(*start++);
+        });
+
+        TraverseDynamic(test, [&process](Drawable* drawable, bool /*inside*/)
+        {
+            process(drawable);
+        });
+    }
+
+    void DrawableTree::GetDrawables(RayPacket& packet) const
+    {
+        auto test = [&packet](const BoundingBox& box, bool& /*inside*/)
+        {
+            return packet.HitMask(box) != 0;
+        };
+
+        TraverseStatic(test, [&packet](Drawable** start, Drawable** end, bool /*inside*/)
+        {
+            packet.ProcessDrawables(start, end);
+        });
+
+        TraverseDynamic(test, [&packet](Drawable* drawable, bool /*inside*/)
+        {
+            packet.ProcessDrawables(&drawable, &drawable + 1);
+        });
+    }
+
+    void DrawableTree::GetDrawablesOnly(RayOctreeQuery& query, PODVector<Drawable*>& dest) const
+    {
+        auto test = [&query](const BoundingBox& box, bool& /*inside*/)
+        {
+            return query.ray_.HitDistance(box) < query.maxDistance_;
+        };
+
+        auto process = [&query, &dest](Drawable* drawable)
+        {
+            if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+                dest.Push(drawable);
+        };
+
+        TraverseStatic(test, [&process](Drawable** start, Drawable** end, bool /*inside*/)
+        {
+            while (start != end)
+                process(*start++);
+        });
+
+        TraverseDynamic(test, [&process](Drawable* drawable, bool /*inside*/)
+        {
+            process(drawable);
+        });
+    }
+
+    void DrawableTree::GetAllDrawables(PODVector<Drawable*>& dest) const
+    {
+        for (const StaticDrawableTreeNode& node : staticNodes_)
+        {
+            for (unsigned i = node.first_; i < node.first_ + node.count_; ++i)
+                dest.Push(staticDrawables_[i]);
+        }
+        for (const DrawableTreeNode& node : nodes_)
+        {
+            if (node.height_ == 0)
+                dest.Push(node.drawable_);
+        }
+    }
+
+    void DrawableTree::DrawDebugGeometry(DebugRenderer* debug, bool depthTest) const
+    {
+        if (!debug)
+            return;
+
+        // Node index and level
+        std::vector<std::pair<unsigned, unsigned> > stack;
+
+        if (!staticNodes_.empty())
+            stack.emplace_back(0, 0);
+        while (!stack.empty())
+        {
+            std::pair<unsigned, unsigned> entry = stack.back();
+            stack.pop_back();
+            const BoundingBox& box = staticBounds_[entry.first];
+            if (!debug->IsInside(box))
+                continue;
+
+            debug->AddBoundingBox(box, Color(0.25f, 0.25f, 0.5f), depthTest);
+            const StaticDrawableTreeNode& node = staticNodes_[entry.first];
+            if (node.right_ != M_MAX_UNSIGNED && entry.second + 1 < DEBUG_DRAW_LEVELS)
+            {
+                stack.emplace_back(entry.first + 1, entry.second + 1);
+                stack.emplace_back(node.right_, entry.second + 1);
+            }
+        }
+
+        if (root_ != M_MAX_UNSIGNED)
+            stack.emplace_back(root_, 0);
+        while (!stack.empty())
+        {
+            std::pair<unsigned, unsigned> entry = stack.back();
+            stack.pop_back();
+            const BoundingBox& box = bounds_[entry.first];
+            if (!debug->IsInside(box))
+                continue;
+
+            debug->AddBoundingBox(box, Color(0.25f, 0.5f, 0.25f), depthTest);
+            const DrawableTreeNode& node = nodes_[entry.first];
+            if (node.height_ > 0 && entry.second + 1 < DEBUG_DRAW_LEVELS)
+            {
+                stack.emplace_back(node.child1_, entry.second + 1);
+                stack.emplace_back(node.child2_, entry.second + 1);
+            }
+        }
+    }
+
+    bool DrawableTree::Contains(const Drawable* drawable)
+    {
+        return drawable->treeProxy_ != M_MAX_UNSIGNED;
+    }
+
+    void DrawableTree::InsertDynamic(Drawable* drawable, unsigned frameNumber, float marginScale)
+    {
+        unsigned leaf = AllocateNode();
+        DrawableTreeNode& node = nodes_[leaf];
+        node.height_ = 0;
+        node.drawable_ = drawable;
+        node.lastMoveFrame_ = frameNumber;
+        node.settleQueued_ = false;
+        const BoundingBox& box = drawable->GetWorldBoundingBox();
+        node.margin_ = Max(box.Size().Length() * marginScale, LEAF_MARGIN_MIN);
+        bounds_[leaf] = Fatten(box, node.margin_);
+        drawable->treeProxy_ = leaf;
+
+        LinkLeaf(leaf);
+        QueueSettle(leaf, frameNumber);
+        ++numDynamic_;
+    }
+
+    void DrawableTree::RemoveDynamic(unsigned nodeIndex)
+    {
+        nodes_[nodeIndex].drawable_->treeProxy_ = M_MAX_UNSIGNED;
+        if (IsLinked(nodeIndex))
+            RemoveLeaf(nodeIndex);
+        else
+            pendingLeaves_.erase(std::find(pendingLeaves_.begin(), pendingLeaves_.end(), nodeIndex));
+        FreeNode(nodeIndex);
+        --numDynamic_;
+    }
+
+    void DrawableTree::RemoveStatic(unsigned position)
+    {
+        // Keep the leaf's drawable range contiguous by moving its last drawable into the hole. The leaf bounds stay
+        // conservative until the next rebuild
+        StaticDrawableTreeNode& node = staticNodes_[staticLeaves_[position]];
+        unsigned last = node.first_ + node.count_ - 1;
+        staticDrawables_[position]->treeProxy_ = M_MAX_UNSIGNED;
+        if (position != last)
+        {
+            Drawable* moved = staticDrawables_[last];
+            staticDrawables_[position] = moved;
+            moved->treeProxy_ = STATIC_PROXY_FLAG | position;
+        }
+        --node.count_;
+        --numStatic_;
+    }
+
+    unsigned DrawableTree::AllocateNode()
+    {
+        if (freeList_ != M_MAX_UNSIGNED)
+        {
+            unsigned nodeIndex = freeList_;
+            freeList_ = nodes_[nodeIndex].parent_;
+            nodes_[nodeIndex].parent_ = M_MAX_UNSIGNED;
+            nodes_[nodeIndex].child1_ = M_MAX_UNSIGNED;
+            nodes_[nodeIndex].child2_ = M_MAX_UNSIGNED;
+            nodes_[nodeIndex].drawable_ = nullptr;
+            nodes_[nodeIndex].settleQueued_ = false;
+            return nodeIndex;
+        }
+
+        nodes_.push_back({ M_MAX_UNSIGNED, M_MAX_UNSIGNED, M_MAX_UNSIGNED, 0, nullptr, 0.0f, 0, false });
+        bounds_.emplace_back();
+        return (unsigned)nodes_.size() - 1;
+    }
+
+    void DrawableTree::FreeNode(unsigned nodeIndex)
+    {
+        DrawableTreeNode& node = nodes_[nodeIndex];
+        node.parent_ = freeList_;
+        node.height_ = -1;
+        node.drawable_ = nullptr;
+        node.settleQueued_ = false;
+        freeList_ = nodeIndex;
+    }
+
+    bool DrawableTree::IsLinked(unsigned leaf) const
+    {
+        return nodes_[leaf].parent_ != M_MAX_UNSIGNED || root_ == leaf;
+    }
+
+    void DrawableTree::LinkLeaf(unsigned leaf)
+    {
+        if (batching_)
+            pendingLeaves_.push_back(leaf);
+        else
+            InsertLeaf(leaf);
+    }
+
+    void DrawableTree::InsertLeaf(unsigned leaf)
+    {
+        if (root_ == M_MAX_UNSIGNED)
+        {
+            root_ = leaf;
+            nodes_[leaf].parent_ = M_MAX_UNSIGNED;
+            return;
+        }
+
+        // Descend to the sibling that minimizes the surface area increase
+        const BoundingBox leafBox = bounds_[leaf];
+        unsigned index = root_;
+        while (nodes_[index].height_ > 0)
+        {
+            const DrawableTreeNode& node = nodes_[index];
+            float area = HalfArea(bounds_[index]);
+            float combinedArea = HalfArea(Union(bounds_[index], leafBox));
+
+            // Cost of making a new parent for this node and the leaf, and minimum cost of pushing the leaf further down
+            float cost = 2.0f * combinedArea;
+            float inheritanceCost = 2.0f * (combinedArea - area);
+
+            float cost1 = HalfArea(Union(leafBox, bounds_[node.child1_])) + inheritanceCost;
+            if (nodes_[node.child1_].height_ > 0)
+                cost1 -= HalfArea(bounds_[node.child1_]);
+            float cost2 = HalfArea(Union(leafBox, bounds_[node.child2_])) + inheritanceCost;
+            if (nodes_[node.child2_].height_ > 0)
+                cost2 -= HalfArea(bounds_[node.child2_]);
+
+            if (cost < cost1 && cost < cost2)
+                break;
+
+            index = cost1 < cost2 ? node.child1_ : node.child2_;
+        }
+
+        unsigned sibling = index;
+        unsigned oldParent = nodes_[sibling].parent_;
+        unsigned newParent = AllocateNode();
+        nodes_[newParent].parent_ = oldParent;
+        nodes_[newParent].height_ = nodes_[sibling].height_ + 1;
+        nodes_[newParent].child1_ = sibling;
+        nodes_[newParent].child2_ = leaf;
+        bounds_[newParent] = Union(leafBox, bounds_[sibling]);
+        nodes_[sibling].parent_ = newParent;
+        nodes_[leaf].parent_ = newParent;
+
+        if (oldParent != M_MAX_UNSIGNED)
+        {
+            if (nodes_[oldParent].child1_ == sibling)
+                nodes_[oldParent].child1_ = newParent;
+            else
+                nodes_[oldParent].child2_ = newParent;
+        }
+        else
+            root_ = newParent;
+
+        FixUpwards(oldParent);
+    }
+
+    void DrawableTree::RemoveLeaf(unsigned leaf)
+    {
+        if (leaf == root_)
+        {
+            root_ = M_MAX_UNSIGNED;
+            return;
+        }
+
+        unsigned parent = nodes_[leaf].parent_;
+        unsigned grandParent = nodes_[parent].parent_;
+        unsigned sibling = nodes_[parent].child1_ == leaf ? nodes_[parent].child2_ : nodes_[parent].child1_;
+
+        // The parent is replaced by the sibling
+        if (grandParent != M_MAX_UNSIGNED)
+        {
+            if (nodes_[grandParent].child1_ == parent)
+                nodes_[grandParent].child1_ = sibling;
+            else
+                nodes_[grandParent].child2_ = sibling;
+            nodes_[sibling].parent_ = grandParent;
+        }
+        else
+        {
+            root_ = sibling;
+            nodes_[sibling].parent_ = M_MAX_UNSIGNED;
+        }
+
+        FreeNode(parent);
+        nodes_[leaf].parent_ = M_MAX_UNSIGNED;
+        FixUpwards(grandParent);
+    }
+
+    void DrawableTree::FixUpwards(unsigned nodeIndex)
+    {
+        while (nodeIndex != M_MAX_UNSIGNED)
+        {
+            nodeIndex = Balance(nodeIndex);
+
+            DrawableTreeNode& node = nodes_[nodeIndex];
+            node.height_ = 1 + Max(nodes_[node.child1_].height_, nodes_[node.child2_].height_);
+            bounds_[nodeIndex] = Union(bounds_[node.child1_], bounds_[node.child2_]);
+            nodeIndex = node.parent_;
+        }
+    }
+
+    unsigned DrawableTree::Balance(unsigned iA)
+    {
+        DrawableTreeNode& a = nodes_[iA];
+        if (a.height_ < 2)
+            return iA;
+
+        unsigned iB = a.child1_;
+        unsigned iC = a.child2_;
+        DrawableTreeNode& b = nodes_[iB];
+        DrawableTreeNode& c = nodes_[iC];
+        int balance = c.height_ - b.height_;
+
+        // Rotate C up
+        if (balance > 1)
+        {
+            unsigned iF = c.child1_;
+            unsigned iG = c.child2_;
+            DrawableTreeNode& f = nodes_[iF];
+            DrawableTreeNode& g = nodes_[iG];
+
+            c.child1_ = iA;
+            c.parent_ = a.parent_;
+            a.parent_ = iC;
+
+            if (c.parent_ != M_MAX_UNSIGNED)
+            {
+                if (nodes_[c.parent_].child1_ == iA)
+                    nodes_[c.parent_].child1_ = iC;
+                else
+                    nodes_[c.parent_].child2_ = iC;
+            }
+            else
+                root_ = iC;
+
+            if (f.height_ > g.height_)
+            {
+                c.child2_ = iF;
+                a.child2_ = iG;
+                g.parent_ = iA;
+                bounds_[iA] = Union(bounds_[iB], bounds_[iG]);
+                bounds_[iC] = Union(bounds_[iA], bounds_[iF]);
+                a.height_ = 1 + Max(b.height_, g.height_);
+                c.height_ = 1 + Max(a.height_, f.height_);
+            }
+            else
+            {
+                c.child2_ = iG;
+                a.child2_ = iF;
+                f.parent_ = iA;
+                bounds_[iA] = Union(bounds_[iB], bounds_[iF]);
+                bounds_[iC] = Union(bounds_[iA], bounds_[iG]);
+                a.height_ = 1 + Max(b.height_, f.height_);
+                c.height_ = 1 + Max(a.height_, g.height_);
+            }
+
+            return iC;
+        }
+
+        // Rotate B up
+        if (balance < -1)
+        {
+            unsigned iD = b.child1_;
+            unsigned iE = b.child2_;
+            DrawableTreeNode& d = nodes_[iD];
+            DrawableTreeNode& e = nodes_[iE];
+
+            b.child1_ = iA;
+            b.parent_ = a.parent_;
+            a.parent_ = iB;
+
+            if (b.parent_ != M_MAX_UNSIGNED)
+            {
+                if (nodes_[b.parent_].child1_ == iA)
+                    nodes_[b.parent_].child1_ = iB;
+                else
+                    nodes_[b.parent_].child2_ = iB;
+            }
+            else
+                root_ = iB;
+
+            if (d.height_ > e.height_)
+            {
+                b.child2_ = iD;
+                a.child1_ = iE;
+                e.parent_ = iA;
+                bounds_[iA] = Union(bounds_[iC], bounds_[iE]);
+                bounds_[iB] = Union(bounds_[iA], bounds_[iD]);
+                a.height_ = 1 + Max(c.height_, e.height_);
+                b.height_ = 1 + Max(a.height_, d.height_);
+            }
+            else
+            {
+                b.child2_ = iE;
+                a.child1_ = iD;
+                d.parent_ = iA;
+                bounds_[iA] = Union(bounds_[iC], bounds_[iD]);
+                bounds_[iB] = Union(bounds_[iA], bounds_[iE]);
+                a.height_ = 1 + Max(c.height_, d.height_);
+                b.height_ = 1 + Max(a.height_, e.height_);
+            }
+
+            return iB;
+        }
+
+        return iA;
+    }
+
+    void DrawableTree::RebuildDynamic()
+    {
+        // Free the interior nodes and collect all leaves, including the pending ones
+        buildItems_.clear();
+        for (unsigned i = 0; i < nodes_.size(); ++i)
+        {
+            if (nodes_[i].height_ == 0)
+                buildItems_.push_back({ bounds_[i].Center(), i });
+            else if (nodes_[i].height_ > 0)
+                FreeNode(i);
+        }
+
+        root_ = M_MAX_UNSIGNED;
+        if (!buildItems_.empty())
+        {
+            root_ = BuildDynamicNode(0, (unsigned)buildItems_.size());
+            nodes_[root_].parent_ = M_MAX_UNSIGNED;
+        }
+    }
+
+    unsigned DrawableTree::BuildDynamicNode(unsigned first, unsigned count)
+    {
+        if (count == 1)
+            return buildItems_[first].index_;
+
+        // Median splits keep the subtree heights within one of each other, so the result is balanced
+        unsigned half = PartitionAtMedian(buildItems_, first, count);
+        unsigned child1 = BuildDynamicNode(first, half);
+        unsigned child2 = BuildDynamicNode(first + half, count - half);
+
+        unsigned nodeIndex = AllocateNode();
+        DrawableTreeNode& node = nodes_[nodeIndex];
+        node.child1_ = child1;
+        node.child2_ = child2;
+        node.height_ = 1 + Max(nodes_[child1].height_, nodes_[child2].height_);
+        nodes_[child1].parent_ = nodeIndex;
+        nodes_[child2].parent_ = nodeIndex;
+        bounds_[nodeIndex] = Union(bounds_[child1], bounds_[child2]);
+        return nodeIndex;
+    }
+
+    void DrawableTree::QueueSettle(unsigned nodeIndex, unsigned frameNumber)
+    {
+        DrawableTreeNode& node = nodes_[nodeIndex];
+        if (node.settleQueued_)
+            return;
+
+        node.settleQueued_ = true;
+        settleQueue_.emplace_back(nodeIndex, frameNumber + SETTLE_FRAMES);
+    }
+
+    void DrawableTree::RebuildStatic(unsigned frameNumber)
+    {
+        buildDrawables_.Clear();
+
+        // Keep the remaining static drawables
+        for (const StaticDrawableTreeNode& node : staticNodes_)
+        {
+            for (unsigned i = node.first_; i < node.first_ + node.count_; ++i)
+                buildDrawables_.Push(staticDrawables_[i]);
+        }
+
+        // Move the settled dynamic drawables that have not moved since. If they are a large part of the dynamic tree, unlink
+        // them all at once and rebuild the rest
+        bool bulkRemove = settled_.size() >= numDynamic_ / 4;
+        for (unsigned nodeIndex : settled_)
+        {
+            const DrawableTreeNode& node = nodes_[nodeIndex];
+            if (node.height_ != 0 || node.settleQueued_ || frameNumber - node.lastMoveFrame_ < SETTLE_FRAMES)
+                continue;
+
+            Drawable* drawable = node.drawable_;
+            if (bulkRemove)
+            {
+                drawable->treeProxy_ = M_MAX_UNSIGNED;
+                FreeNode(nodeIndex);
+                --numDynamic_;
+            }
+            else
+                RemoveDynamic(nodeIndex);
+            buildDrawables_.Push(drawable);
+        }
+        settled_.clear();
+        if (bulkRemove)
+            RebuildDynamic();
+
+        unsigned count = buildDrawables_.Size();
+        buildItems_.resize(count);
+        buildBounds_.resize(count);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            buildBounds_[i] = buildDrawables_[i]->GetWorldBoundingBox();
+            buildItems_[i] = { buildBounds_[i].Center(), i };
+        }
+
+        staticNodes_.clear();
+        staticBounds_.clear();
+        staticDrawables_.Resize(count);
+        staticLeaves_.resize(count);
+        numStatic_ = count;
+
+        if (count)
+        {
+            staticNodes_.reserve(2 * (count / STATIC_LEAF_SIZE + 1));
+            staticBounds_.reserve(2 * (count / STATIC_LEAF_SIZE + 1));
+            BuildStaticNode(0, count);
+        }
+    }
+
+    unsigned DrawableTree::BuildStaticNode(unsigned first, unsigned count)
+    {
+        unsigned nodeIndex = (unsigned)staticNodes_.size();
+        staticNodes_.push_back({ M_MAX_UNSIGNED, first, count });
+        staticBounds_.emplace_back();
+
+        if (count <= STATIC_LEAF_SIZE)
+        {
+            BoundingBox box;
+            for (unsigned i = first; i < first + count; ++i)
+            {
+                unsigned index = buildItems_[i].index_;
+                Drawable* drawable = buildDrawables_[index];
+                box.Merge(buildBounds_[index]);
+                staticDrawables_[i] = drawable;
+                staticLeaves_[i] = nodeIndex;
+                drawable->treeProxy_ = STATIC_PROXY_FLAG | i;
+            }
+            staticBounds_[nodeIndex] = box;
+            return nodeIndex;
+        }
+
+        unsigned half = PartitionAtMedian(buildItems_, first, count);
+        BuildStaticNode(first, half);
+        unsigned right = BuildStaticNode(first + half, count - half);
+        staticNodes_[nodeIndex].right_ = right;
+        staticNodes_[nodeIndex].count_ = 0;
+        staticBounds_[nodeIndex] = Union(staticBounds_[nodeIndex + 1], staticBounds_[right]);
+        return nodeIndex;
+    }
+}
@@ -0,0 +1,204 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Vector.h"
+#include "../Math/BoundingBox.h"
+
+#include <vector>
+
+namespace Urho3D
+{
+    class DebugRenderer;
+    class Drawable;
+    class MultiFrustumOctreeQuery;
+    class OctreeQuery;
+    class RayPacket;
+    class RayOctreeQuery;
+
+    /// Node of the dynamic drawable tree.
+    struct DrawableTreeNode
+    {
+        /// Parent node, or next free node if the node is unused.
+        unsigned parent_;
+        /// First child node, or M_MAX_UNSIGNED for a leaf.
+        unsigned child1_;
+        /// Second child node, or M_MAX_UNSIGNED for a leaf.
+        unsigned child2_;
+        /// Height of the subtree. Zero for a leaf, negative for an unused node.
+        int height_;
+        /// Drawable of a leaf.
+        Drawable* drawable_;
+        /// Loose bounds margin of a leaf.
+        float margin_;
+        /// Frame number of the last move of a leaf.
+        unsigned lastMoveFrame_;
+        /// Whether a leaf is queued for migration to the static tree.
+        bool settleQueued_;
+    };
+
+    /// Node of the static drawable tree. Children of an interior node are stored at the next index and at right_.
+    struct StaticDrawableTreeNode
+    {
+        /// Second child node, or M_MAX_UNSIGNED for a leaf.
+        unsigned right_;
+        /// Index of the first drawable of a leaf.
+        unsigned first_;
+        /// Number of drawables in a leaf.
+        unsigned count_;
+    };
+
+    /// Drawable tree build entry.
+    struct DrawableTreeBuildItem
+    {
+        /// Bounding box center.
+        Vector3 center_;
+        /// Node or drawable index.
+        unsigned index_;
+    };
+
+    /// Bounding volume hierarchy of drawables, used by the octree component as an alternative spatial index. Moving drawables are kept in a dynamic AABB tree with loose leaf bounds that is refit incrementally, and drawables that have not moved for a while are migrated in bulk to a compact static tree whose leaves reference contiguous drawable ranges. Node bounds are stored contiguously apart from the node links.
+    /// @nobind
+    class URHO3D_API DrawableTree
+    {
+    public:
+        /// Construct.
+        DrawableTree();
+        /// Destruct. Does not detach the drawables.
+        ~DrawableTree();
+
+        /// Insert a drawable using its current world bounding box.
+        void Insert(Drawable* drawable, unsigned frameNumber);
+        /// Update a drawable after its world bounding box has changed.
+        void Move(Drawable* drawable, unsigned frameNumber);
+        /// Remove a drawable.
+        void Remove(Drawable* drawable);
+        /// Begin a batch of insertions and moves. Structural changes are deferred until EndBatch(), and queries must not be made in between.
+        void BeginBatch();
+        /// End a batch of insertions and moves, rebuilding the dynamic tree if a large part of it changed.
+        void EndBatch();
+        /// Migrate drawables that have not moved for a while to the static tree when enough of them have accumulated.
+        void Update(unsigned frameNumber);
+        /// Remove all drawables. Their octant pointers are not touched.
+        void Clear();
+
+        /// Return drawable objects by a query.
+        void GetDrawables(OctreeQuery& query) const;
+        /// Return drawable objects by a multi-frustum query.
+        void GetDrawables(MultiFrustumOctreeQuery& query) const;
+        /// Process a ray query on the drawable objects.
+        void GetDrawables(RayOctreeQuery& query) const;
+        /// Process a ray packet of a batched raycast on the drawable objects.
+        void GetDrawables(RayPacket& packet) const;
+        /// Return drawable objects hit by a ray query's bounding boxes, without processing the query.
+        void GetDrawablesOnly(RayOctreeQuery& query, PODVector<Drawable*>& dest) const;
+        /// Return all drawable objects.
+        void GetAllDrawables(PODVector<Drawable*>& dest) const;
+        /// Draw the upper levels of both trees to the debug graphics.
+        void DrawDebugGeometry(DebugRenderer* debug, bool depthTest) const;
+
+        /// Return whether a drawable is in the tree.
+        static bool Contains(const Drawable* drawable);
+        /// Return number of drawables in the dynamic tree.
+        unsigned GetNumDynamicDrawables() const { return numDynamic_; }
+        /// Return number of drawables in the static tree.
+        unsigned GetNumStaticDrawables() const { return numStatic_; }
+        /// Return number of drawables.
+        unsigned GetNumDrawables() const { return numDynamic_ + numStatic_; }
+
+    private:
+        /// Insert a drawable into the dynamic tree with an initial margin relative to its size.
+        void InsertDynamic(Drawable* drawable, unsigned frameNumber, float marginScale);
+        /// Remove a drawable from the dynamic tree.
+        void RemoveDynamic(unsigned nodeIndex);
+        /// Remove a drawable from the static tree.
+        void RemoveStatic(unsigned position);
+        /// Return whether a dynamic leaf is linked into the tree structure, as opposed to pending in a batch.
+        bool IsLinked(unsigned leaf) const;
+        /// Link a leaf into the dynamic tree structure, or defer it if a batch is in progress.
+        void LinkLeaf(unsigned leaf);
+        /// Allocate a dynamic tree node.
+        unsigned AllocateNode();
+        /// Return a dynamic tree node to the free list.
+        void FreeNode(unsigned nodeIndex);
+        /// Insert a leaf into the dynamic tree structure.
+        void InsertLeaf(unsigned leaf);
+        /// Remove a leaf from the dynamic tree structure.
+        void RemoveLeaf(unsigned leaf);
+        /// Recompute bounds and heights from a node up to the root, rebalancing on the way.
+        void FixUpwards(unsigned nodeIndex);
+        /// Rotate a dynamic tree node if it is unbalanced. Return the index of the node now at its place.
+        unsigned Balance(unsigned nodeIndex);
+        /// Rebuild the dynamic tree structure top-down from all leaves.
+        void RebuildDynamic();
+        /// Build a dynamic tree node over a range of the build order. Return the node index.
+        unsigned BuildDynamicNode(unsigned first, unsigned count);
+        /// Queue a dynamic leaf for migration to the static tree.
+        void QueueSettle(unsigned nodeIndex, unsigned frameNumber);
+        /// Rebuild the static tree from its remaining drawables and the settled dynamic drawables.
+        void RebuildStatic(unsigned frameNumber);
+        /// Build a static tree node over a range of the build order. Return the node index.
+        unsigned BuildStaticNode(unsigned first, unsigned count);
+        /// Traverse the static tree, calling a node test and a leaf visitor.
+        template <class NodeTest, class LeafVisitor> void TraverseStatic(NodeTest test, LeafVisitor visit) const;
+        /// Traverse the dynamic tree, calling a node test and a leaf visitor.
+        template <class NodeTest, class LeafVisitor> void TraverseDynamic(NodeTest test, LeafVisitor visit) const;
+
+        /// Dynamic tree nodes.
+        std::vector<DrawableTreeNode> nodes_;
+        /// Dynamic tree node bounds, loose for leaves.
+        std::vector<BoundingBox> bounds_;
+        /// Dynamic tree root node.
+        unsigned root_;
+        /// First free dynamic tree node.
+        unsigned freeList_;
+        /// Number of drawables in the dynamic tree.
+        unsigned numDynamic_;
+        /// Dynamic leaves with the frame number when they are due to be checked for migration, in increasing order.
+        std::vector<std::pair<unsigned, unsigned> > settleQueue_;
+        /// Index of the first unprocessed entry of the settle queue.
+        unsigned settleQueueHead_;
+        /// Dynamic leaves that have not moved for long enough to be migrated.
+        std::vector<unsigned> settled_;
+        /// Dynamic leaves waiting to be linked at the end of a batch.
+        std::vector<unsigned> pendingLeaves_;
+        /// Static tree nodes in depth-first order.
+        std::vector<StaticDrawableTreeNode> staticNodes_;
+        /// Static tree node bounds.
+        std::vector<BoundingBox> staticBounds_;
+        /// Static tree drawables, grouped by leaf.
+        PODVector<Drawable*> staticDrawables_;
+        /// Leaf node of each static tree drawable position.
+        std::vector<unsigned> staticLeaves_;
+        /// Number of drawables in the static tree.
+        unsigned numStatic_;
+        /// Batch in progress flag.
+        bool batching_;
+        /// Static and dynamic tree build entries, used during rebuild.
+        std::vector<DrawableTreeBuildItem> buildItems_;
+        /// Static tree build bounds, used during rebuild.
+        std::vector<BoundingBox> buildBounds_;
+        /// Static tree build drawables, used during rebuild.
+        PODVector<Drawable*> buildDrawables_;
+    };
+}
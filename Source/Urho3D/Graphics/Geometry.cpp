@@ -24,6 +24,7 @@
 
 #include "../Graphics/Geometry.h"
 #include "../Graphics/Graphics.h"
+#include "../Graphics/TriangleTree.h"
 #include "../IO/Log.h"
 #include "../Math/Ray.h"
 
@@ -31,6 +32,9 @@
 
 using namespace Urho3D;
 
+/// Minimum number of triangles for building a triangle tree.
+static const unsigned MIN_TRIANGLE_TREE_TRIANGLES = 64;
+
 Geometry::Geometry(Context* context)
     : Object(context)
 {
@@ -49,6 +53,8 @@ bool Geometry::SetNumVertexBuffers(unsigned num)
 
     unsigned oldSize = vertexBuffers_.Size();
     vertexBuffers_.Resize(num);
+    if (!num)
+        ResetTriangleTree();
 
     return true;
 }
@@ -62,12 +68,15 @@ bool Geometry::SetVertexBuffer(unsigned index, VertexBuffer * buffer)
     }
 
     vertexBuffers_[index] = buffer;
+    if (!index)
+        ResetTriangleTree();
     return true;
 }
 
 void Geometry::SetIndexBuffer(IndexBuffer* buffer)
 {
     indexBuffer_ = buffer;
+    ResetTriangleTree();
 }
 
 bool Geometry::SetDrawRange(PrimitiveType type, unsigned indexStart, unsigned indexCount, bool getUsedVertexRange)
@@ -87,6 +96,7 @@ bool Geometry::SetDrawRange(PrimitiveType type, unsigned indexStart, unsigned in
     primitiveType_ = type;
     indexStart_ = indexStart;
     indexCount_ = indexCount;
+    ResetTriangleTree();
 
     // Get min.vertex index and num of vertices from index buffer. If it fails, use full range as fallback
     if (indexCount)
@@ -128,6 +138,7 @@ bool Geometry::SetDrawRange(PrimitiveType type, unsigned indexStart, unsigned in
     primitiveType_ = type;
     indexStart_ = indexStart;
     indexCount_ = indexCount;
+    ResetTriangleTree();
     vertexStart_ = vertexStart;
     vertexCount_ = vertexCount;
 
@@ -147,6 +158,7 @@ void Geometry::SetRawVertexData(const SharedArrayPtr<unsigned char>&data, const
     rawVertexData_ = data;
     rawVertexSize_ = VertexBuffer::GetVertexSize(elements);
     rawElements_ = elements;
+    ResetTriangleTree();
 }
 
 void Geometry::SetRawVertexData(const SharedArrayPtr<unsigned char>&data, unsigned elementMask)
@@ -154,12 +166,30 @@ void Geometry::SetRawVertexData(const SharedArrayPtr<unsigned char>&data, unsign
     rawVertexData_ = data;
     rawVertexSize_ = VertexBuffer::GetVertexSize(elementMask);
     rawElements_ = VertexBuffer::GetElements(elementMask);
+    ResetTriangleTree();
 }
 
 void Geometry::SetRawIndexData(const SharedArrayPtr<unsigned char>&data, unsigned indexSize)
 {
     rawIndexData_ = data;
     rawIndexSize_ = indexSize;
+    ResetTriangleTree();
+}
+
+void Geometry::SetUseTriangleTree(bool enable)
+{
+    useTriangleTree_ = enable;
+    ResetTriangleTree();
+}
+
+void Geometry::ResetTriangleTree()
+{
+    if (!triangleTreeBuilt_.load(std::memory_order_acquire))
+        return;
+
+    std::lock_guard<std::mutex> lock(triangleTreeMutex_);
+    triangleTree_.reset();
+    triangleTreeBuilt_.store(false, std::memory_order_release);
 }
 
 void Geometry::Draw(Graphics * graphics)
@@ -311,6 +341,56 @@ float Geometry::GetHitDistance(const Ray & ray, Vector3 * outNormal, Vector2 * o
         outUV = nullptr;
     }
 
+    if (const TriangleTree* tree = GetTriangleTree())
+    {
+        Vector3 barycentric;
+        unsigned triangle;
+        float distance = tree->HitDistance(ray, M_INFINITY, outNormal, outUV ? &barycentric : nullptr, &triangle);
+
+        if (outUV)
+        {
+            if (triangle == M_MAX_UNSIGNED)
+                *outUV = Vector2::ZERO;
+            else
+            {
+                // Interpolate the UV coordinate using barycentric coordinate
+                unsigned i0, i1, i2;
+                if (indexData)
+                {
+                    unsigned index = indexStart_ + triangle * 3;
+                    if (indexSize == sizeof(unsigned short))
+                    {
+                        const unsigned short* indices = ((const unsigned short*)indexData) + index;
+                        i0 = indices[0];
+                        i1 = indices[1];
+                        i2 = indices[2];
+                    }
+                    else
+                    {
+                        const unsigned* indices = ((const unsigned*)indexData) + index;
+                        i0 = indices[0];
+                        i1 = indices[1];
+                        i2 = indices[2];
+                    }
+                }
+                else
+                {
+                    i0 = vertexStart_ + triangle * 3;
+                    i1 = i0 + 1;
+                    i2 = i0 + 2;
+                }
+
+                const Vector2& uv0 = *((const Vector2*)(&vertexData[uvOffset + i0 * vertexSize]));
+                const Vector2& uv1 = *((const Vector2*)(&vertexData[uvOffset + i1 * vertexSize]));
+                const Vector2& uv2 = *((const Vector2*)(&vertexData[uvOffset + i2 * vertexSize]));
+                *outUV = Vector2(uv0.x_ * barycentric.x_ + uv1.x_ * barycentric.y_ + uv2.x_ * barycentric.z_,
+                    uv0.y_ * barycentric.x_ + uv1.y_ * barycentric.y_ + uv2.y_ * barycentric.z_);
+            }
+        }
+
+        return distance;
+    }
+
     return indexData ? ray.HitDistance(vertexData, vertexSize, indexData, indexSize, indexStart_, indexCount_, outNormal, outUV,
         uvOffset) : ray.HitDistance(vertexData, vertexSize, vertexStart_, vertexCount_, outNormal, outUV, uvOffset);
 }
@@ -325,6 +405,53 @@ bool Geometry::IsInside(const Ray & ray) const
 
     GetRawData(vertexData, vertexSize, indexData, indexSize, elements);
 
+    if (const TriangleTree* tree = GetTriangleTree())
+        return tree->IsInside(ray);
+
     return vertexData ? (indexData ? ray.InsideGeometry(vertexData, vertexSize, indexData, indexSize, indexStart_, indexCount_) :
         ray.InsideGeometry(vertexData, vertexSize, vertexStart_, vertexCount_)) : false;
 }
+
+const TriangleTree* Geometry::GetTriangleTree() const
+{
+    if (triangleTreeBuilt_.load(std::memory_order_acquire))
+        return triangleTree_.get();
+
+    std::lock_guard<std::mutex> lock(triangleTreeMutex_);
+    if (!triangleTreeBuilt_.load(std::memory_order_relaxed))
+    {
+        triangleTree_ = CreateTriangleTree();
+        triangleTreeBuilt_.store(true, std::memory_order_release);
+    }
+
+    return triangleTree_.get();
+}
+
+std::unique_ptr<TriangleTree> Geometry::CreateTriangleTree() const
+{
+    if (!useTriangleTree_ || primitiveType_ != PrimitiveType::TriangleList)
+        return nullptr;
+
+    const unsigned char* vertexData;
+    const unsigned char* indexData;
+    unsigned vertexSize;
+    unsigned indexSize;
+    const PODVector<VertexElement>* elements;
+
+    GetRawData(vertexData, vertexSize, indexData, indexSize, elements);
+    if (!vertexData || !elements || VertexBuffer::GetElementOffset(*elements, TYPE_VECTOR3, SEM_POSITION) != 0)
+        return nullptr;
+
+    // Contents of dynamic buffers are expected to change without notice, so do not cache them
+    if ((!rawVertexData_ && vertexBuffers_[0]->IsDynamic()) || (indexData && !rawIndexData_ && indexBuffer_->IsDynamic()))
+        return nullptr;
+
+    unsigned numTriangles = (indexData ? indexCount_ : vertexCount_) / 3;
+    if (numTriangles < MIN_TRIANGLE_TREE_TRIANGLES)
+        return nullptr;
+
+    std::unique_ptr<TriangleTree> tree(new TriangleTree());
+    bool success = indexData ? tree->Build(vertexData, vertexSize, indexData, indexSize, indexStart_, indexCount_) :
+        tree->Build(vertexData, vertexSize, vertexStart_, vertexCount_);
+    return success ? std::move(tree) : nullptr;
+}
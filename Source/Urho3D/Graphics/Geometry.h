@@ -27,10 +27,15 @@
 #include "../Graphics/VertexBuffer.h"
 #include "../Graphics/IndexBuffer.h"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+
 namespace Urho3D
 {
     class Ray;
     class Graphics;
+    class TriangleTree;
 
     /// Defines one or more vertex buffers, an index buffer and a draw range.
     class URHO3D_API Geometry : public Object
@@ -65,6 +70,10 @@ namespace Urho3D
         void SetRawVertexData(const SharedArrayPtr<unsigned char>& data, unsigned elementMask);
         /// Override raw index data to be returned for CPU-side operations.
         void SetRawIndexData(const SharedArrayPtr<unsigned char>& data, unsigned indexSize);
+        /// Set whether to build a triangle tree on demand to accelerate CPU-side raycasts and triangle queries. Default true.
+        void SetUseTriangleTree(bool enable);
+        /// Discard the triangle tree so that it is rebuilt on next use. Needs to be called after modifying vertex or index data in place.
+        void ResetTriangleTree();
         /// Draw.
         void Draw(Graphics* graphics);
 
@@ -118,12 +127,19 @@ namespace Urho3D
         float GetHitDistance(const Ray& ray, Vector3* outNormal = nullptr, Vector2* outUV = nullptr) const;
         /// Return whether or not the ray is inside geometry.
         bool IsInside(const Ray& ray) const;
+        /// Return triangle tree, building it on first use. Return null if disabled, or if the geometry is not a triangle list, has too few triangles or no static CPU-side data. Safe to call from worker threads.
+        const TriangleTree* GetTriangleTree() const;
+        /// Return whether to build a triangle tree on demand.
+        bool GetUseTriangleTree() const { return useTriangleTree_; }
 
         /// Return whether has empty draw range.
         /// @property
         bool IsEmpty() const { return indexCount_ == 0 && vertexCount_ == 0; }
 
     private:
+        /// Build the triangle tree if applicable.
+        std::unique_ptr<TriangleTree> CreateTriangleTree() const;
+
         /// Vertex buffers.
         Vector<SharedPtr<VertexBuffer> > vertexBuffers_;
         /// Index buffer.
@@ -150,5 +166,13 @@ namespace Urho3D
         uint32_t rawVertexSize_{ 0u };
         /// Raw index data override size.
         uint32_t rawIndexSize_{ 0u };
+        /// Build triangle tree on demand flag.
+        bool useTriangleTree_{ true };
+        /// Triangle tree build attempted flag.
+        mutable std::atomic<bool> triangleTreeBuilt_{ false };
+        /// Triangle tree, or null if not built or not applicable.
+        mutable std::unique_ptr<TriangleTree> triangleTree_;
+        /// Triangle tree build mutex.
+        mutable std::mutex triangleTreeMutex_;
     };
 }
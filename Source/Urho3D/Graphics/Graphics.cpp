@@ -33,6 +33,8 @@
 #include "../Graphics/Graphics.h"
 #include "../Graphics/GraphicsEvents.h"
 #include "../Graphics/GraphicsImpl.h"
+#include "../Graphics/ImpostorAtlas.h"
+#include "../Graphics/ImpostorSet.h"
 #include "../Graphics/Material.h"
 #include "../Graphics/Octree.h"
 #include "../Graphics/ParticleEffect.h"
@@ -41,6 +43,7 @@
 #include "../Graphics/Shader.h"
 #include "../Graphics/ShaderPrecache.h"
 #include "../Graphics/Skybox.h"
+#include "../Graphics/StaticBatcher.h"
 #include "../Graphics/StaticModelGroup.h"
 #include "../Graphics/Technique.h"
 #include "../Graphics/Terrain.h"
@@ -376,11 +379,29 @@ void Graphics::PrecacheShaders(Deserializer& source)
     ShaderPrecache::LoadShaders(this, source);
 }
 
+void Graphics::PrecacheShadersAsync(Deserializer& source)
+{
+    shaderPrecacheLoader_ = new ShaderPrecacheLoader(context_, source, shaderPath_, shaderExtension_);
+}
+
+bool Graphics::IsPrecachingShaders() const
+{
+    return shaderPrecacheLoader_ && !shaderPrecacheLoader_->IsFinished();
+}
+
+float Graphics::GetShaderPrecacheProgress() const
+{
+    return shaderPrecacheLoader_ ? shaderPrecacheLoader_->GetProgress() : 1.0f;
+}
+
 void Graphics::SetShaderCacheDir(const String& path)
 {
     String trimmedPath = path.Trimmed();
     if (trimmedPath.Length())
+    {
         shaderCacheDir_ = AddTrailingSlash(trimmedPath);
+        LoadShaderProgramCache();
+    }
 }
 
 void Graphics::AddGPUObject(GPUObject* object)
@@ -618,11 +639,14 @@ void Urho3D::RegisterGraphicsLibrary(Context* context)
     Light::RegisterObject(context);
     StaticModel::RegisterObject(context);
     StaticModelGroup::RegisterObject(context);
+    StaticBatcher::RegisterObject(context);
     Skybox::RegisterObject(context);
     AnimatedModel::RegisterObject(context);
     AnimationController::RegisterObject(context);
     BillboardSet::RegisterObject(context);
+    ImpostorSet::RegisterObject(context);
     ParticleEffect::RegisterObject(context);
+    ImpostorAtlas::RegisterObject(context);
     ParticleEmitter::RegisterObject(context);
     RibbonTrail::RegisterObject(context);
     CustomGeometry::RegisterObject(context);
@@ -45,6 +45,7 @@ namespace Urho3D
     class RenderSurface;
     class Shader;
     class ShaderPrecache;
+    class ShaderPrecacheLoader;
     class ShaderProgram;
     class ShaderVariation;
     class Texture;
@@ -310,9 +311,11 @@ namespace Urho3D
         void BeginDumpShaders(const String& fileName);
         /// End dumping shader variations names.
         void EndDumpShaders();
-        /// Precache shader variations from an XML file generated with BeginDumpShaders().
+        /// Precache shader variations from an XML file generated with BeginDumpShaders(). The variations are prepared in worker threads before the shaders are created.
         void PrecacheShaders(Deserializer& source);
-        /// Set shader cache directory, Direct3D only. This can either be an absolute path or a path within the resource system.
+        /// Precache shader variations from an XML file generated with BeginDumpShaders() over the following frames without blocking. The shader source files are loaded in the background, the variations prepared in worker threads and the shaders created in the main thread within a time budget per frame. Progress is reported with the ShaderPrecacheProgress event. Replaces an asynchronous precache in progress.
+        void PrecacheShadersAsync(Deserializer& source);
+        /// Set shader cache directory for Direct3D shader bytecode and OpenGL shader program binaries. This can either be an absolute path or a path within the resource system. On OpenGL the program binaries in the directory are loaded immediately.
         /// @property
         void SetShaderCacheDir(const String& path);
 
@@ -584,6 +587,11 @@ namespace Urho3D
         /// @property
         const String& GetShaderCacheDir() const { return shaderCacheDir_; }
 
+        /// Return whether an asynchronous shader precache is in progress.
+        bool IsPrecachingShaders() const;
+        /// Return approximate progress of the asynchronous shader precache from 0 to 1. Return 1 if none is in progress.
+        float GetShaderPrecacheProgress() const;
+
         /// Return current rendertarget width and height.
         IntVector2 GetRenderTargetDimensions() const;
 
@@ -694,6 +702,10 @@ namespace Urho3D
         
         /// Release/clear GPU objects and optionally close the window. Used only on OpenGL.
         void Release(bool clearGPUObjects, bool closeWindow);
+        /// Load shader program binaries from the shader cache directory. Used only on OpenGL.
+        void LoadShaderProgramCache();
+        /// Save shader program binaries to the shader cache directory if new programs were linked. Used only on OpenGL.
+        void SaveShaderProgramCache();
 
         /// Mutex for accessing the GPU objects vector from several threads.
         std::mutex gpuObjectMutex_;
@@ -834,7 +846,7 @@ namespace Urho3D
         const void* shaderParameterSources_[MAX_SHADER_PARAMETER_GROUPS]{};
         /// Base directory for shaders.
         String shaderPath_;
-        /// Cache directory for Direct3D binary shaders.
+        /// Cache directory for Direct3D binary shaders and OpenGL shader program binaries.
         String shaderCacheDir_;
         /// File extension for shaders.
         String shaderExtension_;
@@ -844,6 +856,8 @@ namespace Urho3D
         mutable String lastShaderName_;
         /// Shader precache utility.
         SharedPtr<ShaderPrecache> shaderPrecache_;
+        /// Asynchronous shader precache loader.
+        SharedPtr<ShaderPrecacheLoader> shaderPrecacheLoader_;
         /// Allowed screen orientations.
         String orientations_;
         /// Graphics API name.
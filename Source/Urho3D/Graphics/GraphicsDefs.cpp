@@ -89,6 +89,10 @@ extern URHO3D_API const StringHash PSP_LIGHTRAD("LightRad");
 extern URHO3D_API const StringHash PSP_LIGHTLENGTH("LightLength");
 extern URHO3D_API const StringHash PSP_ZONEMIN("ZoneMin");
 extern URHO3D_API const StringHash PSP_ZONEMAX("ZoneMax");
+extern URHO3D_API const StringHash PSP_CLUSTERMATRIX("ClusterMatrix");
+extern URHO3D_API const StringHash PSP_CLUSTERGRID("ClusterGrid");
+extern URHO3D_API const StringHash PSP_CLUSTERDEPTH("ClusterDepth");
+extern URHO3D_API const StringHash PSP_CLUSTERMAPSIZE("ClusterMapSize");
 
 extern URHO3D_API const Vector3 DOT_SCALE(1 / 3.0f, 1 / 3.0f, 1 / 3.0f);
 
@@ -118,7 +122,11 @@ extern URHO3D_API const unsigned ELEMENT_TYPESIZES[] =
     3 * sizeof(float),
     4 * sizeof(float),
     sizeof(unsigned),
-    sizeof(unsigned)
+    sizeof(unsigned),
+    2 * sizeof(unsigned short),
+    4 * sizeof(unsigned short),
+    sizeof(unsigned),
+    4 * sizeof(short)
 };
 
 
@@ -160,6 +160,10 @@ namespace Urho3D
         TYPE_VECTOR4,
         TYPE_UBYTE4,
         TYPE_UBYTE4_NORM,
+        TYPE_HALF2,
+        TYPE_HALF4,
+        TYPE_BYTE4_NORM,
+        TYPE_SHORT4_NORM,
         MAX_VERTEX_ELEMENT_TYPES
     };
 
@@ -333,7 +337,9 @@ namespace Urho3D
         TU_LIGHTSHAPE = 9,
         TU_SHADOWMAP = 10,
         TU_FACESELECT = 11,
+        TU_LIGHTCLUSTERS = 11,
         TU_INDIRECTION = 12,
+        TU_LIGHTDATA = 12,
         TU_DEPTHBUFFER = 13,
         TU_LIGHTBUFFER = 14,
         TU_ZONE = 15,
@@ -421,6 +427,10 @@ namespace Urho3D
     extern URHO3D_API const StringHash PSP_LIGHTLENGTH;
     extern URHO3D_API const StringHash PSP_ZONEMIN;
     extern URHO3D_API const StringHash PSP_ZONEMAX;
+    extern URHO3D_API const StringHash PSP_CLUSTERMATRIX;
+    extern URHO3D_API const StringHash PSP_CLUSTERGRID;
+    extern URHO3D_API const StringHash PSP_CLUSTERDEPTH;
+    extern URHO3D_API const StringHash PSP_CLUSTERMAPSIZE;
 
     // Scale calculation from bounding box diagonal.
     extern URHO3D_API const Vector3 DOT_SCALE;
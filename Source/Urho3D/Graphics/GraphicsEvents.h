@@ -133,6 +133,15 @@ URHO3D_EVENT(E_RENDERPATHEVENT, RenderPathEvent)
     URHO3D_PARAM(P_NAME, Name);                    // String
 }
 
+/// Asynchronous shader precaching has advanced. Sent once per frame until finished.
+URHO3D_EVENT(E_SHADERPRECACHEPROGRESS, ShaderPrecacheProgress)
+{
+    URHO3D_PARAM(P_PROGRESS, Progress);            // float
+    URHO3D_PARAM(P_NUMCREATED, NumCreated);        // unsigned
+    URHO3D_PARAM(P_NUMCOMBINATIONS, NumCombinations); // unsigned
+    URHO3D_PARAM(P_FINISHED, Finished);            // bool
+}
+
 /// Graphics context has been lost. Some or all (depending on the API) GPU objects have lost their contents.
 URHO3D_EVENT(E_DEVICELOST, DeviceLost)
 {
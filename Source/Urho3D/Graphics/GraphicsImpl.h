@@ -27,6 +27,8 @@
 
 #if defined(URHO3D_OPENGL)
 #include "OpenGL/OGLGraphicsImpl.h"
+#elif defined(URHO3D_NULLGRAPHICS)
+#include "Null/NullGraphicsImpl.h"
 #else
 #include "Direct3D11/D3D11GraphicsImpl.h"
 #endif
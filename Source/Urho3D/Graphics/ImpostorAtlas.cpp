@@ -0,0 +1,436 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../Core/Timer.h"
+#include "../Graphics/Camera.h"
+#include "../Graphics/Graphics.h"
+#include "../Graphics/ImpostorAtlas.h"
+#include "../Graphics/Material.h"
+#include "../Graphics/Model.h"
+#include "../Graphics/Octree.h"
+#include "../Graphics/RenderSurface.h"
+#include "../Graphics/StaticModel.h"
+#include "../Graphics/Technique.h"
+#include "../Graphics/Texture2D.h"
+#include "../Graphics/View.h"
+#include "../Graphics/Viewport.h"
+#include "../Graphics/Zone.h"
+#include "../IO/Log.h"
+#include "../Resource/Image.h"
+#include "../Resource/ResourceCache.h"
+#include "../Resource/XMLFile.h"
+#include "../Scene/Scene.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+    /// Maximum number of frames per side of the atlas grid.
+    static const unsigned MAX_FRAMES_PER_SIDE = 32;
+    /// Number of pixels the frame colors are spread into the uncovered background.
+    static const unsigned DILATE_ITERATIONS = 8;
+
+    /// Return sign of a value, treating zero as positive.
+    static inline float SignNotZero(float value)
+    {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    /// Map a direction to the octahedral square from -1 to 1. The hemisphere mapping covers only directions above the horizon, rotated to fill the whole square.
+    static Vector2 EncodeOctahedral(const Vector3& direction, bool hemisphere)
+    {
+        Vector3 d(direction.x_, hemisphere ? Max(direction.y_, 0.0f) : direction.y_, direction.z_);
+        float sum = Abs(d.x_) + Abs(d.y_) + Abs(d.z_);
+        if (sum < M_EPSILON)
+            return Vector2::ZERO;
+
+        float x = d.x_ / sum;
+        float z = d.z_ / sum;
+        if (hemisphere)
+            return Vector2(x + z, x - z);
+        else if (d.y_ < 0.0f)
+            return Vector2((1.0f - Abs(z)) * SignNotZero(x), (1.0f - Abs(x)) * SignNotZero(z));
+        else
+            return Vector2(x, z);
+    }
+
+    /// Map a point on the octahedral square from -1 to 1 to a direction.
+    static Vector3 DecodeOctahedral(const Vector2& point, bool hemisphere)
+    {
+        float x = point.x_;
+        float z = point.y_;
+        if (hemisphere)
+        {
+            x = (point.x_ + point.y_) * 0.5f;
+            z = (point.x_ - point.y_) * 0.5f;
+        }
+
+        float y = 1.0f - Abs(x) - Abs(z);
+        if (y < 0.0f)
+        {
+            float foldedX = (1.0f - Abs(z)) * SignNotZero(x);
+            z = (1.0f - Abs(x)) * SignNotZero(z);
+            x = foldedX;
+        }
+
+        return Vector3(x, y, z).Normalized();
+    }
+
+    /// Spread the colors of covered pixels into the uncovered pixels around them within each frame, so that texture filtering and mipmapping do not blend the frame edges with the background color.
+    static void DilateFrames(Image* image, unsigned frameSize)
+    {
+        if (image->GetComponents() != 4)
+            return;
+
+        const int width = image->GetWidth();
+        const int height = image->GetHeight();
+        const int size = (int)frameSize;
+        unsigned char* data = image->GetData();
+
+        PODVector<unsigned char> covered((unsigned)(width * height));
+        for (int i = 0; i < width * height; ++i)
+            covered[i] = data[i * 4 + 3] ? 1 : 0;
+
+        PODVector<unsigned char> nextCovered;
+        for (unsigned iteration = 0; iteration < DILATE_ITERATIONS; ++iteration)
+        {
+            nextCovered = covered;
+            bool changed = false;
+
+            for (int y = 0; y < height; ++y)
+            {
+                const int frameTop = y / size * size;
+                const int frameBottom = Min(frameTop + size, height);
+
+                for (int x = 0; x < width; ++x)
+                {
+                    if (covered[y * width + x])
+                        continue;
+
+                    const int frameLeft = x / size * size;
+                    const int frameRight = Min(frameLeft + size, width);
+                    unsigned sum[3] = { 0, 0, 0 };
+                    unsigned count = 0;
+
+                    for (int ny = Max(y - 1, frameTop); ny < Min(y + 2, frameBottom); ++ny)
+                    {
+                        for (int nx = Max(x - 1, frameLeft); nx < Min(x + 2, frameRight); ++nx)
+                        {
+                            if (!covered[ny * width + nx])
+                                continue;
+
+                            const unsigned char* color = &data[(ny * width + nx) * 4];
+                            sum[0] += color[0];
+                            sum[1] += color[1];
+                            sum[2] += color[2];
+                            ++count;
+                        }
+                    }
+
+                    if (count)
+                    {
+                        unsigned char* color = &data[(y * width + x) * 4];
+                        color[0] = (unsigned char)(sum[0] / count);
+                        color[1] = (unsigned char)(sum[1] / count);
+                        color[2] = (unsigned char)(sum[2] / count);
+                        nextCovered[y * width + x] = 1;
+                        changed = true;
+                    }
+                }
+            }
+
+            covered = nextCovered;
+            if (!changed)
+                break;
+        }
+    }
+
+    ImpostorAtlas::ImpostorAtlas(Context* context) :
+        Resource(context),
+        center_(Vector3::ZERO),
+        radius_(0.0f),
+        framesPerSide_(1),
+        hemisphere_(true)
+    {
+    }
+
+    ImpostorAtlas::~ImpostorAtlas() = default;
+
+    void ImpostorAtlas::RegisterObject(Context* context)
+    {
+        context->RegisterFactory<ImpostorAtlas>();
+    }
+
+    bool ImpostorAtlas::BeginLoad(Deserializer& source)
+    {
+        loadModelName_.Clear();
+        loadTextureName_.Clear();
+
+        XMLFile file(context_);
+        if (!file.Load(source))
+        {
+            URHO3D_LOGERROR("Load impostor atlas file failed");
+            return false;
+        }
+
+        XMLElement rootElem = file.GetRoot("impostor");
+        if (!rootElem)
+        {
+            URHO3D_LOGERROR("Impostor atlas file has no impostor root element");
+            return false;
+        }
+
+        loadModelName_ = rootElem.GetChild("model").GetAttribute("name");
+        loadTextureName_ = rootElem.GetChild("texture").GetAttribute("name");
+
+        XMLElement framesElem = rootElem.GetChild("frames");
+        framesPerSide_ = Clamp(framesElem.GetUInt("perside"), 1u, MAX_FRAMES_PER_SIDE);
+        hemisphere_ = framesElem.GetBool("hemisphere");
+
+        XMLElement boundsElem = rootElem.GetChild("bounds");
+        center_ = boundsElem.GetVector3("center");
+        radius_ = boundsElem.GetFloat("radius");
+
+        SetMemoryUse(source.GetSize());
+        return true;
+    }
+
+    bool ImpostorAtlas::EndLoad()
+    {
+        auto* cache = GetSubsystem<ResourceCache>();
+        model_ = cache->GetResource<Model>(loadModelName_);
+        texture_ = cache->GetResource<Texture2D>(loadTextureName_);
+        image_.Reset();
+        loadModelName_.Clear();
+        loadTextureName_.Clear();
+
+        CreateMaterial();
+        return true;
+    }
+
+    bool ImpostorAtlas::Save(Serializer& dest) const
+    {
+        SharedPtr<XMLFile> xml(new XMLFile(context_));
+        XMLElement rootElem = xml->CreateRoot("impostor");
+
+        rootElem.CreateChild("model").SetAttribute("name", GetResourceName(model_));
+        rootElem.CreateChild("texture").SetAttribute("name", GetResourceName(texture_));
+
+        XMLElement framesElem = rootElem.CreateChild("frames");
+        framesElem.SetUInt("perside", framesPerSide_);
+        framesElem.SetBool("hemisphere", hemisphere_);
+
+        XMLElement boundsElem = rootElem.CreateChild("bounds");
+        boundsElem.SetVector3("center", center_);
+        boundsElem.SetFloat("radius", radius_);
+
+        return xml->Save(dest);
+    }
+
+    bool ImpostorAtlas::Bake(StaticModel* source, unsigned framesPerSide, unsigned frameSize, bool hemisphere)
+    {
+        Model* model = source ? source->GetModel() : nullptr;
+        if (!model)
+        {
+            URHO3D_LOGERROR("No model to bake impostor atlas from");
+            return false;
+        }
+
+        auto* graphics = GetSubsystem<Graphics>();
+        if (!graphics || !graphics->IsInitialized() || graphics->IsDeviceLost())
+        {
+            URHO3D_LOGERROR("Can not bake impostor atlas without graphics");
+            return false;
+        }
+
+        URHO3D_PROFILE(BakeImpostorAtlas);
+
+        framesPerSide = Clamp(framesPerSide, 1u, MAX_FRAMES_PER_SIDE);
+        frameSize = Max(frameSize, 1u);
+        const int atlasSize = (int)(framesPerSide * frameSize);
+
+        SharedPtr<Texture2D> renderTexture(new Texture2D(context_));
+        SharedPtr<Texture2D> depthTexture(new Texture2D(context_));
+        renderTexture->SetNumLevels(1);
+        if (!renderTexture->SetSize(atlasSize, atlasSize, Graphics::GetRGBAFormat(), TEXTURE_RENDERTARGET) ||
+            !depthTexture->SetSize(atlasSize, atlasSize, Graphics::GetDepthStencilFormat(), TEXTURE_DEPTHSTENCIL))
+        {
+            URHO3D_LOGERROR("Failed to create impostor atlas render target");
+            return false;
+        }
+
+        RenderSurface* surface = renderTexture->GetRenderSurface();
+        surface->SetLinkedDepthStencil(depthTexture->GetRenderSurface());
+
+        model_ = model;
+        center_ = model->GetBoundingBox().Center();
+        radius_ = Max(model->GetBoundingBox().HalfSize().Length(), M_EPSILON);
+        framesPerSide_ = framesPerSide;
+        hemisphere_ = hemisphere;
+
+        // Render the model alone, lit only by full ambient light and without fog, so that the diffuse color is rendered as is
+        // over a transparent background
+        SharedPtr<Scene> scene(new Scene(context_));
+        auto* octree = scene->CreateComponent<Octree>();
+        auto* zone = scene->CreateComponent<Zone>();
+        zone->SetBoundingBox(BoundingBox(center_ - Vector3::ONE * radius_ * 4.0f, center_ + Vector3::ONE * radius_ * 4.0f));
+        zone->SetAmbientColor(Color::WHITE);
+        zone->SetFogColor(Color::TRANSPARENT_BLACK);
+        zone->SetFogStart(radius_ * 100.0f);
+        zone->SetFogEnd(radius_ * 200.0f);
+
+        auto* staticModel = scene->CreateChild()->CreateComponent<StaticModel>();
+        staticModel->SetModel(model);
+        for (unsigned i = 0; i < model->GetNumGeometries(); ++i)
+            staticModel->SetMaterial(i, source->GetMaterial(i));
+
+        Node* cameraNode = scene->CreateChild();
+        auto* camera = cameraNode->CreateComponent<Camera>();
+        camera->SetOrthographic(true);
+        camera->SetOrthoSize(radius_ * 2.0f);
+        camera->SetAspectRatio(1.0f);
+        camera->SetNearClip(radius_ * 0.5f);
+        camera->SetFarClip(radius_ * 3.5f);
+
+        SharedPtr<Viewport> viewport(new Viewport(context_, scene, camera));
+        SharedPtr<View> view(new View(context_));
+
+        FrameInfo frame;
+        frame.frameNumber_ = GetSubsystem<Time>()->GetFrameNumber();
+        frame.timeStep_ = 0.0f;
+        frame.camera_ = camera;
+        frame.viewSize_ = IntVector2((int)frameSize, (int)frameSize);
+        octree->Update(frame);
+
+        for (unsigned i = 0; i < GetNumFrames(); ++i)
+        {
+            const int x = (int)(i % framesPerSide_);
+            const int y = (int)(i / framesPerSide_);
+            const int size = (int)frameSize;
+
+            cameraNode->SetPosition(center_ + GetFrameDirection(i) * radius_ * 2.0f);
+            cameraNode->LookAt(center_, GetFrameUp(i));
+            viewport->SetRect(IntRect(x * size, y * size, (x + 1) * size, (y + 1) * size));
+
+            if (!view->Define(surface, viewport))
+            {
+                URHO3D_LOGERROR("Failed to set up impostor atlas view");
+                graphics->ResetRenderTargets();
+                return false;
+            }
+
+            view->Update(frame);
+            view->Render();
+        }
+
+        graphics->ResetRenderTargets();
+
+        SharedPtr<Image> image = renderTexture->GetImage();
+        if (!image)
+        {
+            URHO3D_LOGERROR("Failed to read back impostor atlas");
+            return false;
+        }
+
+        DilateFrames(image, frameSize);
+
+        texture_ = new Texture2D(context_);
+        if (!texture_->SetData(image, true))
+        {
+            URHO3D_LOGERROR("Failed to create impostor atlas texture");
+            texture_.Reset();
+            return false;
+        }
+
+        image_ = image;
+        CreateMaterial();
+        SetMemoryUse((unsigned)(atlasSize * atlasSize * 4));
+        return true;
+    }
+
+    bool ImpostorAtlas::SaveImage(const String& fileName, const String& resourceName)
+    {
+        if (!image_ || !texture_)
+        {
+            URHO3D_LOGERROR("No baked impostor atlas image to save");
+            return false;
+        }
+
+        if (!image_->SavePNG(fileName))
+            return false;
+
+        texture_->SetName(resourceName);
+        return true;
+    }
+
+    unsigned ImpostorAtlas::GetFrame(const Vector3& direction) const
+    {
+        Vector2 point = EncodeOctahedral(direction, hemisphere_);
+        const int last = (int)framesPerSide_ - 1;
+        int x = Clamp((int)((point.x_ * 0.5f + 0.5f) * framesPerSide_), 0, last);
+        int y = Clamp((int)((point.y_ * 0.5f + 0.5f) * framesPerSide_), 0, last);
+        return (unsigned)y * framesPerSide_ + (unsigned)x;
+    }
+
+    Rect ImpostorAtlas::GetFrameUV(unsigned index) const
+    {
+        const float frameUV = 1.0f / framesPerSide_;
+        const float x = (float)(index % framesPerSide_);
+        const float y = (float)(index / framesPerSide_);
+        return Rect(Vector2(x * frameUV, y * frameUV), Vector2((x + 1.0f) * frameUV, (y + 1.0f) * frameUV));
+    }
+
+    Vector3 ImpostorAtlas::GetFrameDirection(unsigned index) const
+    {
+        const float x = (float)(index % framesPerSide_) + 0.5f;
+        const float y = (float)(index / framesPerSide_) + 0.5f;
+        return DecodeOctahedral(Vector2(x / framesPerSide_ * 2.0f - 1.0f, y / framesPerSide_ * 2.0f - 1.0f), hemisphere_);
+    }
+
+    Vector3 ImpostorAtlas::GetFrameUp(unsigned index) const
+    {
+        // Keep the world up direction upward in the image, except when looking straight down or up
+        Vector3 direction = GetFrameDirection(index);
+        Vector3 up = Vector3::UP - direction * direction.y_;
+        if (up.LengthSquared() < 0.0001f)
+            up = Vector3::FORWARD - direction * direction.z_;
+
+        return up.Normalized();
+    }
+
+    void ImpostorAtlas::CreateMaterial()
+    {
+        material_.Reset();
+        if (!texture_)
+            return;
+
+        material_ = new Material(context_);
+        material_->SetTechnique(0, GetSubsystem<ResourceCache>()->GetResource<Technique>("Techniques/Diff.xml"));
+        material_->SetPixelShaderDefines("ALPHAMASK");
+        material_->SetTexture(TU_DIFFUSE, texture_);
+        material_->SetCullMode(CullMode::None);
+    }
+}
@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Math/Rect.h"
+#include "../Math/Vector3.h"
+#include "../Resource/Resource.h"
+
+namespace Urho3D
+{
+    class Image;
+    class Material;
+    class Model;
+    class StaticModel;
+    class Texture2D;
+
+    /// Impostor atlas resource. Holds views of a model rendered from directions spread over a sphere or the upper hemisphere, laid out in a square grid of frames by octahedral mapping of the view direction, for drawing the model as camera facing billboards at a distance. Baked at runtime from a static model and saved as an XML file that refers to the model and to the atlas image.
+    class URHO3D_API ImpostorAtlas : public Resource
+    {
+        URHO3D_OBJECT(ImpostorAtlas, Resource);
+
+    public:
+        /// Construct.
+        explicit ImpostorAtlas(Context* context);
+        /// Destruct.
+        ~ImpostorAtlas() override;
+        /// Register object factory.
+        /// @nobind
+        static void RegisterObject(Context* context);
+
+        /// Load resource from stream. May be called from a worker thread. Return true if successful.
+        bool BeginLoad(Deserializer& source) override;
+        /// Finish resource loading. Always called from the main thread. Return true if successful.
+        bool EndLoad() override;
+        /// Save resource. Return true if successful.
+        bool Save(Serializer& dest) const override;
+
+        /// Render the atlas from a static model's model and materials, with the given number of frames per side of the grid and frame size in pixels. Hemisphere frames only cover views from above the horizon, which suits objects standing on the ground. The model is rendered unlit without fog, so that the atlas holds the diffuse color and coverage in the alpha channel. Requires an initialized Graphics subsystem and must not be called during rendering. Return true on success.
+        bool Bake(StaticModel* source, unsigned framesPerSide = 8, unsigned frameSize = 128, bool hemisphere = true);
+        /// Save the baked atlas image as a PNG file into the file system and refer to it by a resource name, for example "Textures/TreeImpostor.png", when the atlas itself is saved. Return true on success.
+        bool SaveImage(const String& fileName, const String& resourceName);
+
+        /// Return the model the atlas was rendered from.
+        Model* GetModel() const { return model_; }
+        /// Return the atlas texture.
+        Texture2D* GetTexture() const { return texture_; }
+        /// Return the baked atlas image, or null if the atlas was loaded instead of baked.
+        Image* GetImage() const { return image_; }
+        /// Return the default material for drawing the impostors. Uses the atlas texture with alpha masking.
+        Material* GetMaterial() const { return material_; }
+        /// Return number of frames per side of the grid.
+        unsigned GetFramesPerSide() const { return framesPerSide_; }
+        /// Return number of frames.
+        unsigned GetNumFrames() const { return framesPerSide_ * framesPerSide_; }
+        /// Return whether the frames only cover the upper hemisphere.
+        bool IsHemisphere() const { return hemisphere_; }
+        /// Return the center of the model's bounding box, which the frames are centered on.
+        const Vector3& GetCenter() const { return center_; }
+        /// Return the radius of the model's bounding sphere around the center. Each frame covers a square twice the radius wide.
+        float GetRadius() const { return radius_; }
+
+        /// Return the frame nearest to a direction toward the viewer in the model's space.
+        unsigned GetFrame(const Vector3& direction) const;
+        /// Return the texture coordinates of a frame.
+        Rect GetFrameUV(unsigned index) const;
+        /// Return the direction toward the viewer of a frame in the model's space.
+        Vector3 GetFrameDirection(unsigned index) const;
+        /// Return the up direction of a frame's image in the model's space.
+        Vector3 GetFrameUp(unsigned index) const;
+
+    private:
+        /// Create the default material for the atlas texture.
+        void CreateMaterial();
+
+        /// Model the atlas was rendered from.
+        SharedPtr<Model> model_;
+        /// Atlas texture.
+        SharedPtr<Texture2D> texture_;
+        /// Baked atlas image.
+        SharedPtr<Image> image_;
+        /// Default material.
+        SharedPtr<Material> material_;
+        /// Model bounding box center.
+        Vector3 center_;
+        /// Model bounding sphere radius.
+        float radius_;
+        /// Number of frames per side of the grid.
+        unsigned framesPerSide_;
+        /// Upper hemisphere frames flag.
+        bool hemisphere_;
+        /// Model name to load on EndLoad().
+        String loadModelName_;
+        /// Texture name to load on EndLoad().
+        String loadTextureName_;
+    };
+}
@@ -0,0 +1,503 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../Graphics/Batch.h"
+#include "../Graphics/Camera.h"
+#include "../Graphics/Geometry.h"
+#include "../Graphics/ImpostorAtlas.h"
+#include "../Graphics/ImpostorSet.h"
+#include "../Graphics/IndexBuffer.h"
+#include "../Graphics/Material.h"
+#include "../Graphics/Model.h"
+#include "../Graphics/OctreeQuery.h"
+#include "../Graphics/StaticModelGroup.h"
+#include "../Graphics/VertexBuffer.h"
+#include "../IO/Log.h"
+#include "../Resource/ResourceCache.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneEvents.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+    static const float DEFAULT_IMPOSTOR_DISTANCE = 100.0f;
+
+    /// Write an impostor billboard vertex in the billboard vertex format.
+    static inline void WriteVertex(float*& dest, const Vector3& position, unsigned color, float u, float v, float x, float y)
+    {
+        dest[0] = position.x_;
+        dest[1] = position.y_;
+        dest[2] = position.z_;
+        ((unsigned&)dest[3]) = color;
+        dest[4] = u;
+        dest[5] = v;
+        dest[6] = x;
+        dest[7] = y;
+        dest += 8;
+    }
+
+    ImpostorSet::ImpostorSet(Context* context) :
+        Drawable(context, DRAWABLE_GEOMETRY),
+        geometry_(new Geometry(context)),
+        vertexBuffer_(new VertexBuffer(context)),
+        indexBuffer_(new IndexBuffer(context)),
+        cullCamera_(nullptr),
+        impostorDistance_(DEFAULT_IMPOSTOR_DISTANCE),
+        built_(false),
+        bufferSizeDirty_(true)
+    {
+        geometry_->SetVertexBuffer(0, vertexBuffer_);
+        geometry_->SetIndexBuffer(indexBuffer_);
+
+        batches_.Resize(1);
+        batches_[0].geometry_ = geometry_;
+        batches_[0].geometryType_ = GEOM_BILLBOARD;
+        batches_[0].worldTransform_ = &Matrix3x4::IDENTITY;
+    }
+
+    ImpostorSet::~ImpostorSet() = default;
+
+    void ImpostorSet::RegisterObject(Context* context)
+    {
+        context->RegisterFactory<ImpostorSet>(GEOMETRY_CATEGORY);
+
+        URHO3D_ACCESSOR_ATTRIBUTE("Is Enabled", IsEnabled, SetEnabled, bool, true, AM_DEFAULT);
+        URHO3D_MIXED_ACCESSOR_ATTRIBUTE("Atlas", GetAtlasAttr, SetAtlasAttr, ResourceRef, ResourceRef(ImpostorAtlas::GetTypeStatic()),
+            AM_DEFAULT);
+        URHO3D_MIXED_ACCESSOR_ATTRIBUTE("Material", GetMaterialAttr, SetMaterialAttr, ResourceRef, ResourceRef(Material::GetTypeStatic()),
+            AM_DEFAULT);
+        URHO3D_ACCESSOR_ATTRIBUTE("Impostor Distance", GetImpostorDistance, SetImpostorDistance, float, DEFAULT_IMPOSTOR_DISTANCE,
+            AM_DEFAULT);
+        URHO3D_ACCESSOR_ATTRIBUTE("Can Be Occluded", IsOccludee, SetOccludee, bool, true, AM_DEFAULT);
+        URHO3D_ACCESSOR_ATTRIBUTE("Draw Distance", GetDrawDistance, SetDrawDistance, float, 0.0f, AM_DEFAULT);
+        URHO3D_COPY_BASE_ATTRIBUTES(Drawable);
+    }
+
+    void ImpostorSet::ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQueryResult>& results)
+    {
+        if (visibleInstances_.Empty() || query.ray_.HitDistance(GetWorldBoundingBox()) >= query.maxDistance_)
+            return;
+
+        for (unsigned i = 0; i < visibleInstances_.Size(); ++i)
+        {
+            const unsigned index = visibleInstances_[i];
+            const Vector3& position = positions_[index];
+            const float radius = radii_[index];
+
+            float distance;
+            if (query.level_ == RAY_AABB)
+                distance = query.ray_.HitDistance(BoundingBox(position - Vector3::ONE * radius, position + Vector3::ONE * radius));
+            else
+            {
+                // The billboard faces the camera, so test it as facing the ray: a disc through the center, perpendicular to the ray
+                distance = (position - query.ray_.origin_).DotProduct(query.ray_.direction_);
+                if (distance < 0.0f || (query.ray_.origin_ + distance * query.ray_.direction_ - position).LengthSquared() > radius * radius)
+                    distance = M_INFINITY;
+            }
+
+            if (distance < query.maxDistance_)
+            {
+                RayQueryResult result;
+                result.position_ = query.ray_.origin_ + distance * query.ray_.direction_;
+                result.normal_ = -query.ray_.direction_;
+                result.distance_ = distance;
+                result.drawable_ = this;
+                result.node_ = node_;
+                result.subObject_ = index;
+                results.Push(result);
+            }
+        }
+    }
+
+    void ImpostorSet::UpdateBatches(const FrameInfo& frame)
+    {
+        CullInstances(frame.camera_);
+
+        // Use the distance to the nearest impostor, so that the draw distance applies to each instance
+        if (visibleInstances_.Empty())
+            distance_ = frame.camera_->GetDistance(GetWorldBoundingBox().Center());
+        else
+        {
+            distance_ = M_INFINITY;
+            for (unsigned i = 0; i < visibleInstances_.Size(); ++i)
+                distance_ = Min(distance_, frame.camera_->GetDistance(positions_[visibleInstances_[i]]));
+        }
+
+        batches_[0].distance_ = distance_;
+        batches_[0].numWorldTransforms_ = 1;
+    }
+
+    void ImpostorSet::UpdateGeometry(const FrameInfo& frame)
+    {
+        if (bufferSizeDirty_ || indexBuffer_->IsDataLost())
+            UpdateBufferSize();
+
+        // The billboards face the camera, so they are rewritten for each view. Cull again if the view is not the one culled for
+        if (frame.camera_ != cullCamera_)
+            CullInstances(frame.camera_);
+
+        UpdateVertexBuffer(frame.camera_);
+    }
+
+    UpdateGeometryType ImpostorSet::GetUpdateGeometryType()
+    {
+        return positions_.Empty() ? UPDATE_NONE : UPDATE_MAIN_THREAD;
+    }
+
+    void ImpostorSet::SetAtlas(ImpostorAtlas* atlas)
+    {
+        atlas_ = atlas;
+        batches_[0].material_ = GetMaterial();
+
+        if (built_)
+            Build();
+        MarkNetworkUpdate();
+    }
+
+    void ImpostorSet::SetMaterial(Material* material)
+    {
+        material_ = material;
+        batches_[0].material_ = GetMaterial();
+        MarkNetworkUpdate();
+    }
+
+    void ImpostorSet::SetImpostorDistance(float distance)
+    {
+        impostorDistance_ = Max(distance, 0.0f);
+
+        if (built_)
+            Build();
+        MarkNetworkUpdate();
+    }
+
+    bool ImpostorSet::Build()
+    {
+        if (!node_)
+        {
+            URHO3D_LOGERROR("Can not build impostors without a scene node");
+            return false;
+        }
+
+        Model* model = atlas_ ? atlas_->GetModel() : nullptr;
+        if (!model)
+        {
+            URHO3D_LOGERROR("No impostor atlas model to build impostors for");
+            return false;
+        }
+
+        URHO3D_PROFILE(BuildImpostors);
+
+        Clear();
+
+        const Vector3& center = atlas_->GetCenter();
+        const float radius = atlas_->GetRadius();
+        PODVector<Node*> instanceNodes;
+
+        // Static models draw up to the impostor distance, measured to their bounding box centers, which are also the impostor centers
+        PODVector<StaticModel*> staticModels;
+        node_->GetComponents<StaticModel>(staticModels, true);
+        for (unsigned i = 0; i < staticModels.Size(); ++i)
+        {
+            StaticModel* staticModel = staticModels[i];
+            if (!staticModel->IsEnabledEffective() || staticModel->GetModel() != model)
+                continue;
+
+            staticModels_.push_back(WeakPtr<StaticModel>(staticModel));
+            staticModel->SetDrawDistanceOverride(impostorDistance_);
+            instanceNodes.Push(staticModel->GetNode());
+        }
+
+        PODVector<StaticModelGroup*> groups;
+        node_->GetComponents<StaticModelGroup>(groups, true);
+        for (unsigned i = 0; i < groups.Size(); ++i)
+        {
+            StaticModelGroup* group = groups[i];
+            if (!group->IsEnabledEffective() || group->GetModel() != model)
+                continue;
+
+            groups_.push_back(WeakPtr<StaticModelGroup>(group));
+            group->SetInstanceDrawDistanceOverride(impostorDistance_);
+            for (unsigned j = 0; j < group->GetNumInstanceNodes(); ++j)
+            {
+                Node* instanceNode = group->GetInstanceNode(j);
+                if (instanceNode && instanceNode->IsEnabled())
+                    instanceNodes.Push(instanceNode);
+            }
+        }
+
+        positions_.Resize(instanceNodes.Size());
+        rotations_.Resize(instanceNodes.Size());
+        radii_.Resize(instanceNodes.Size());
+        visibleInstances_.Reserve(instanceNodes.Size());
+
+        for (unsigned i = 0; i < instanceNodes.Size(); ++i)
+        {
+            Node* instanceNode = instanceNodes[i];
+            const Vector3 scale = instanceNode->GetWorldScale();
+            positions_[i] = instanceNode->GetWorldTransform() * center;
+            rotations_[i] = instanceNode->GetWorldRotation();
+            radii_[i] = radius * Max(Abs(scale.x_), Max(Abs(scale.y_), Abs(scale.z_)));
+        }
+
+        built_ = true;
+        bufferSizeDirty_ = true;
+        OnMarkedDirty(node_);
+
+        URHO3D_LOGDEBUG("Gathered " + String(positions_.Size()) + " impostor instances from " + String((unsigned)staticModels_.size()) +
+            " static models and " + String((unsigned)groups_.size()) + " static model groups");
+        return true;
+    }
+
+    void ImpostorSet::Clear()
+    {
+        for (unsigned i = 0; i < staticModels_.size(); ++i)
+        {
+            if (staticModels_[i])
+                staticModels_[i]->SetDrawDistanceOverride(-1.0f);
+        }
+        for (unsigned i = 0; i < groups_.size(); ++i)
+        {
+            if (groups_[i])
+                groups_[i]->SetInstanceDrawDistanceOverride(-1.0f);
+        }
+
+        staticModels_.clear();
+        groups_.clear();
+        positions_.Clear();
+        rotations_.Clear();
+        radii_.Clear();
+        visibleInstances_.Clear();
+        cullCamera_ = nullptr;
+        built_ = false;
+
+        if (node_)
+            OnMarkedDirty(node_);
+    }
+
+    Material* ImpostorSet::GetMaterial() const
+    {
+        if (material_)
+            return material_;
+        return atlas_ ? atlas_->GetMaterial() : nullptr;
+    }
+
+    void ImpostorSet::SetAtlasAttr(const ResourceRef& value)
+    {
+        auto* cache = GetSubsystem<ResourceCache>();
+        SetAtlas(cache->GetResource<ImpostorAtlas>(value.name_));
+    }
+
+    ResourceRef ImpostorSet::GetAtlasAttr() const
+    {
+        return GetResourceRef(atlas_, ImpostorAtlas::GetTypeStatic());
+    }
+
+    void ImpostorSet::SetMaterialAttr(const ResourceRef& value)
+    {
+        auto* cache = GetSubsystem<ResourceCache>();
+        SetMaterial(cache->GetResource<Material>(value.name_));
+    }
+
+    ResourceRef ImpostorSet::GetMaterialAttr() const
+    {
+        return GetResourceRef(material_, Material::GetTypeStatic());
+    }
+
+    void ImpostorSet::OnSceneSet(Scene* scene)
+    {
+        Drawable::OnSceneSet(scene);
+
+        if (scene)
+            ScheduleBuild();
+        else
+        {
+            UnsubscribeFromEvent(E_SCENEUPDATE);
+            Clear();
+        }
+    }
+
+    void ImpostorSet::OnWorldBoundingBoxUpdate()
+    {
+        BoundingBox worldBox;
+        for (unsigned i = 0; i < positions_.Size(); ++i)
+        {
+            const Vector3 edge = Vector3::ONE * radii_[i];
+            worldBox.Merge(BoundingBox(positions_[i] - edge, positions_[i] + edge));
+        }
+
+        // Always include the node's own position so that the bounding box is valid without instances
+        worldBox.Merge(node_->GetWorldPosition());
+
+        worldBoundingBox_ = worldBox;
+    }
+
+    void ImpostorSet::CullInstances(Camera* camera)
+    {
+        const Frustum& frustum = camera->GetFrustum();
+        const float drawDistance = drawDistance_;
+
+        visibleInstances_.Clear();
+        for (unsigned i = 0; i < positions_.Size(); ++i)
+        {
+            const float distance = camera->GetDistance(positions_[i]);
+            if (distance <= impostorDistance_ || (drawDistance > 0.0f && distance > drawDistance))
+                continue;
+            if (frustum.IsInsideFast(Sphere(positions_[i], radii_[i])) == OUTSIDE)
+                continue;
+
+            visibleInstances_.Push(i);
+        }
+
+        cullCamera_ = camera;
+    }
+
+    void ImpostorSet::UpdateBufferSize()
+    {
+        unsigned numInstances = positions_.Size();
+
+        if (vertexBuffer_->GetVertexCount() != numInstances * 4)
+            vertexBuffer_->SetSize(numInstances * 4, MASK_POSITION | MASK_COLOR | MASK_TEXCOORD1 | MASK_TEXCOORD2, true);
+
+        bool largeIndices = (numInstances * 4) >= 65536;
+
+        if (indexBuffer_->GetIndexCount() != numInstances * 6)
+            indexBuffer_->SetSize(numInstances * 6, largeIndices);
+
+        bufferSizeDirty_ = false;
+
+        if (!numInstances)
+            return;
+
+        // Indices do not change for a given number of instances
+        void* destPtr = indexBuffer_->Lock(0, numInstances * 6, true);
+        if (!destPtr)
+            return;
+
+        if (!largeIndices)
+        {
+            auto* dest = (unsigned short*)destPtr;
+            unsigned short vertexIndex = 0;
+            while (numInstances--)
+            {
+                dest[0] = vertexIndex;
+                dest[1] = vertexIndex + 1;
+                dest[2] = vertexIndex + 2;
+                dest[3] = vertexIndex + 2;
+                dest[4] = vertexIndex + 3;
+                dest[5] = vertexIndex;
+
+                dest += 6;
+                vertexIndex += 4;
+            }
+        }
+        else
+        {
+            auto* dest = (unsigned*)destPtr;
+            unsigned vertexIndex = 0;
+            while (numInstances--)
+            {
+                dest[0] = vertexIndex;
+                dest[1] = vertexIndex + 1;
+                dest[2] = vertexIndex + 2;
+                dest[3] = vertexIndex + 2;
+                dest[4] = vertexIndex + 3;
+                dest[5] = vertexIndex;
+
+                dest += 6;
+                vertexIndex += 4;
+            }
+        }
+
+        indexBuffer_->Unlock();
+        indexBuffer_->ClearDataLost();
+    }
+
+    void ImpostorSet::UpdateVertexBuffer(Camera* camera)
+    {
+        const unsigned numVisible = atlas_ ? visibleInstances_.Size() : 0;
+        geometry_->SetDrawRange(PrimitiveType::TriangleList, 0, numVisible * 6, false);
+        if (!numVisible)
+            return;
+
+        auto* dest = (float*)vertexBuffer_->Lock(0, numVisible * 4, true);
+        if (!dest)
+            return;
+
+        const Vector3 cameraPosition = camera->GetNode()->GetWorldPosition();
+        const Quaternion cameraRotation = camera->GetNode()->GetWorldRotation();
+        const Vector3 cameraRight = cameraRotation * Vector3::RIGHT;
+        const Vector3 cameraUp = cameraRotation * Vector3::UP;
+        const Vector3 cameraBack = cameraRotation * Vector3::BACK;
+        const bool orthographic = camera->IsOrthographic();
+        const unsigned color = Color::WHITE.ToUInt();
+
+        for (unsigned i = 0; i < numVisible; ++i)
+        {
+            const unsigned index = visibleInstances_[i];
+            const Vector3& position = positions_[index];
+            const Quaternion& rotation = rotations_[index];
+
+            // Choose the frame by the direction toward the camera in the instance's space
+            const Vector3 direction = orthographic ? cameraBack : cameraPosition - position;
+            const unsigned frame = atlas_->GetFrame(rotation.Conjugate() * direction);
+            const Rect uv = atlas_->GetFrameUV(frame);
+
+            // Roll the billboard so that the frame's up direction matches the instance's rotation on the screen
+            const Vector3 frameUp = rotation * atlas_->GetFrameUp(frame);
+            Vector2 up(frameUp.DotProduct(cameraRight), frameUp.DotProduct(cameraUp));
+            const float length = up.Length();
+            up = length > M_EPSILON ? up / length : Vector2(0.0f, 1.0f);
+
+            const float size = radii_[index];
+            const Vector2 right(up.y_ * size, -up.x_ * size);
+            up *= size;
+
+            WriteVertex(dest, position, color, uv.min_.x_, uv.min_.y_, up.x_ - right.x_, up.y_ - right.y_);
+            WriteVertex(dest, position, color, uv.max_.x_, uv.min_.y_, up.x_ + right.x_, up.y_ + right.y_);
+            WriteVertex(dest, position, color, uv.max_.x_, uv.max_.y_, right.x_ - up.x_, right.y_ - up.y_);
+            WriteVertex(dest, position, color, uv.min_.x_, uv.max_.y_, -right.x_ - up.x_, -right.y_ - up.y_);
+        }
+
+        vertexBuffer_->Unlock();
+        vertexBuffer_->ClearDataLost();
+    }
+
+    void ImpostorSet::ScheduleBuild()
+    {
+        Scene* scene = GetScene();
+        if (scene)
+            SubscribeToEvent(scene, E_SCENEUPDATE, URHO3D_HANDLER(ImpostorSet, HandleSceneUpdate));
+    }
+
+    void ImpostorSet::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+    {
+        UnsubscribeFromEvent(E_SCENEUPDATE);
+
+        if (!built_ && atlas_)
+            Build();
+    }
+}
@@ -0,0 +1,151 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Graphics/Drawable.h"
+#include "../Math/Quaternion.h"
+
+namespace Urho3D
+{
+    class Camera;
+    class ImpostorAtlas;
+    class IndexBuffer;
+    class StaticModel;
+    class StaticModelGroup;
+    class VertexBuffer;
+
+    /// Impostor drawable component. Draws the static models and static model group instances in the scene node's subtree that use the atlas's model as camera facing billboards beyond the impostor distance, in one batch. The static models and groups themselves stop drawing the instances beyond the impostor distance through runtime overrides of their draw distance and instance draw distance, which are not saved. The instances are gathered into compact arrays of world space positions, rotations and sizes on build, which are culled against the view frustum each frame, so moved instances require a rebuild.
+    class URHO3D_API ImpostorSet : public Drawable
+    {
+        URHO3D_OBJECT(ImpostorSet, Drawable);
+
+    public:
+        /// Construct.
+        explicit ImpostorSet(Context* context);
+        /// Destruct.
+        ~ImpostorSet() override;
+        /// Register object factory. Drawable must be registered first.
+        /// @nobind
+        static void RegisterObject(Context* context);
+
+        /// Process octree raycast. Tests the instances drawn as impostors from the last culling camera against their camera facing billboards, reporting the instance index as the sub-object. The static models also remain in the scene for raycasts. May be called from a worker thread.
+        void ProcessRayQuery(const RayOctreeQuery& query, PODVector<RayQueryResult>& results) override;
+        /// Calculate distance and cull the instances for rendering. May be called from worker thread(s), possibly re-entrantly.
+        void UpdateBatches(const FrameInfo& frame) override;
+        /// Prepare geometry for rendering.
+        void UpdateGeometry(const FrameInfo& frame) override;
+        /// Return whether a geometry update is necessary, and if it can happen in a worker thread.
+        UpdateGeometryType GetUpdateGeometryType() override;
+
+        /// Set impostor atlas. Rebuilds if already built.
+        /// @property
+        void SetAtlas(ImpostorAtlas* atlas);
+        /// Set material to use instead of the atlas's default material.
+        /// @property
+        void SetMaterial(Material* material);
+        /// Set distance beyond which the instances are drawn as impostors. Rebuilds if already built.
+        /// @property
+        void SetImpostorDistance(float distance);
+        /// Gather the static models and group instances that use the atlas's model in the node's subtree, replacing a previous build. Return true on success.
+        bool Build();
+        /// Remove the instances and the draw distance overrides of the static models and groups.
+        void Clear();
+
+        /// Return impostor atlas.
+        /// @property
+        ImpostorAtlas* GetAtlas() const { return atlas_; }
+        /// Return material.
+        /// @property
+        Material* GetMaterial() const;
+        /// Return impostor distance.
+        /// @property
+        float GetImpostorDistance() const { return impostorDistance_; }
+        /// Return whether a build exists.
+        bool IsBuilt() const { return built_; }
+        /// Return number of instances.
+        /// @property
+        unsigned GetNumInstances() const { return positions_.Size(); }
+        /// Return number of instances drawn as impostors in the last updated view.
+        unsigned GetNumVisibleInstances() const { return visibleInstances_.Size(); }
+
+        /// Set impostor atlas attribute.
+        void SetAtlasAttr(const ResourceRef& value);
+        /// Return impostor atlas attribute.
+        ResourceRef GetAtlasAttr() const;
+        /// Set material attribute.
+        void SetMaterialAttr(const ResourceRef& value);
+        /// Return material attribute.
+        ResourceRef GetMaterialAttr() const;
+
+    protected:
+        /// Handle scene being assigned.
+        void OnSceneSet(Scene* scene) override;
+        /// Recalculate the world-space bounding box.
+        void OnWorldBoundingBoxUpdate() override;
+
+    private:
+        /// Cull the instances for a camera.
+        void CullInstances(Camera* camera);
+        /// Resize the vertex and index buffers for the number of instances.
+        void UpdateBufferSize();
+        /// Rewrite the vertex buffer for the visible instances.
+        void UpdateVertexBuffer(Camera* camera);
+        /// Subscribe to the scene update for building automatically.
+        void ScheduleBuild();
+        /// Handle the scene update for building automatically.
+        void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
+
+        /// Impostor atlas.
+        SharedPtr<ImpostorAtlas> atlas_;
+        /// Material set to use instead of the atlas's default material.
+        SharedPtr<Material> material_;
+        /// Geometry.
+        SharedPtr<Geometry> geometry_;
+        /// Vertex buffer.
+        SharedPtr<VertexBuffer> vertexBuffer_;
+        /// Index buffer.
+        SharedPtr<IndexBuffer> indexBuffer_;
+        /// World space instance centers.
+        PODVector<Vector3> positions_;
+        /// World space instance rotations.
+        PODVector<Quaternion> rotations_;
+        /// Instance bounding sphere radii, scaled to world space.
+        PODVector<float> radii_;
+        /// Indices of the instances visible as impostors from the culling camera.
+        PODVector<unsigned> visibleInstances_;
+        /// Static models whose draw distance is overridden.
+        std::vector<WeakPtr<StaticModel> > staticModels_;
+        /// Static model groups whose instance draw distance is overridden.
+        std::vector<WeakPtr<StaticModelGroup> > groups_;
+        /// Camera the visible instances were culled for.
+        Camera* cullCamera_;
+        /// Impostor distance.
+        float impostorDistance_;
+        /// Build exists flag.
+        bool built_;
+        /// Buffers need resize flag.
+        bool bufferSizeDirty_;
+    };
+}
@@ -0,0 +1,304 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
+#include "../Graphics/Camera.h"
+#include "../Graphics/Light.h"
+#include "../Graphics/LightClusters.h"
+#include "../Scene/Node.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Minimum view depth of the first slice boundary.
+static const float MIN_CLUSTER_DEPTH = 0.1f;
+
+static void BuildClusterSlicesWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto* clusters = reinterpret_cast<LightClusters*>(item->aux_);
+    clusters->BuildSlices((unsigned)(size_t)item->start_, (unsigned)(size_t)item->end_);
+}
+
+/// Return squared distance from a point to a bounding box.
+static inline float DistanceSquared(const Vector3& point, const BoundingBox& box)
+{
+    Vector3 closest(Clamp(point.x_, box.min_.x_, box.max_.x_), Clamp(point.y_, box.min_.y_, box.max_.y_),
+        Clamp(point.z_, box.min_.z_, box.max_.z_));
+    return (point - closest).LengthSquared();
+}
+
+LightClusters::LightClusters(Context* context) :
+    Object(context),
+    gridSize_(DEFAULT_CLUSTER_GRID),
+    depthParams_(Vector2::ZERO),
+    farClip_(0.0f)
+{
+}
+
+LightClusters::~LightClusters() = default;
+
+void LightClusters::SetGridSize(const IntVector3& size)
+{
+    gridSize_ = IntVector3(Max(size.x_, 1), Max(size.y_, 1), Max(size.z_, 1));
+}
+
+void LightClusters::Build(Camera* camera, float minZ, float maxZ, const PODVector<Light*>& lights)
+{
+    URHO3D_PROFILE(BuildLightClusters);
+
+    unsigned numClusters = GetNumClusters();
+    clusters_.Resize(numClusters * 2);
+    lights_.Clear();
+    lightBounds_.Clear();
+    lightData_.Clear();
+
+    const Matrix3x4& view = camera->GetView();
+    projection_ = camera->GetProjection();
+    farClip_ = camera->GetFarClip();
+
+    // Exponential depth slices between the visible geometry depth range
+    float nearDepth = Clamp(minZ, Max(camera->GetNearClip(), MIN_CLUSTER_DEPTH), farClip_);
+    float farDepth = Max(Clamp(maxZ, nearDepth, farClip_), nearDepth * 2.0f);
+    float depthRatio = farDepth / nearDepth;
+    sliceDepths_.Resize((unsigned)gridSize_.z_ + 1);
+    for (unsigned i = 0; i <= (unsigned)gridSize_.z_; ++i)
+        sliceDepths_[i] = nearDepth * powf(depthRatio, (float)i / (float)gridSize_.z_);
+    // The first and last slice extend to the clip planes
+    sliceDepths_[0] = camera->GetNearClip();
+    sliceDepths_.Back() = Max(farClip_, sliceDepths_.Back());
+
+    depthParams_.x_ = (float)gridSize_.z_ / log2f(depthRatio);
+    depthParams_.y_ = -depthParams_.x_ * log2f(nearDepth);
+
+    // Transform to cluster X & Y (multiplied by W), view depth and W
+    Matrix4 viewProj = projection_ * view;
+    Matrix4 viewMatrix = view.ToMatrix4();
+    float halfX = 0.5f * (float)gridSize_.x_;
+    float halfY = 0.5f * (float)gridSize_.y_;
+    clusterMatrix_ = Matrix4(
+        halfX * (viewProj.m00_ + viewProj.m30_), halfX * (viewProj.m01_ + viewProj.m31_),
+        halfX * (viewProj.m02_ + viewProj.m32_), halfX * (viewProj.m03_ + viewProj.m33_),
+        halfY * (viewProj.m10_ + viewProj.m30_), halfY * (viewProj.m11_ + viewProj.m31_),
+        halfY * (viewProj.m12_ + viewProj.m32_), halfY * (viewProj.m13_ + viewProj.m33_),
+        viewMatrix.m20_, viewMatrix.m21_, viewMatrix.m22_, viewMatrix.m23_,
+        viewProj.m30_, viewProj.m31_, viewProj.m32_, viewProj.m33_);
+
+    // Get view space bounds and GPU data of the lights
+    for (PODVector<Light*>::ConstIterator i = lights.Begin(); i != lights.End() && lights_.Size() < MAX_CLUSTERED_LIGHTS; ++i)
+    {
+        Light* light = *i;
+        Node* lightNode = light->GetNode();
+        LightType type = light->GetLightType();
+
+        ClusterLightBounds bounds;
+        bounds.directional_ = type == LightType::Directional;
+        if (type == LightType::Spot)
+        {
+            bounds.box_ = BoundingBox(light->GetViewSpaceFrustum(view));
+            bounds.sphere_ = Sphere(view * lightNode->GetWorldPosition(), light->GetRange());
+        }
+        else if (type == LightType::Point)
+        {
+            bounds.sphere_ = Sphere(view * lightNode->GetWorldPosition(), light->GetRange());
+            bounds.box_ = BoundingBox(bounds.sphere_);
+        }
+
+        // Skip lights that are entirely behind the camera or beyond the far clip
+        if (!bounds.directional_ && (bounds.box_.max_.z_ < sliceDepths_[0] || bounds.box_.min_.z_ > sliceDepths_.Back()))
+            continue;
+
+        lights_.Push(light);
+        lightBounds_.Push(bounds);
+
+        // Same layout as vertex lights, with specular intensity appended
+        float invRange = bounds.directional_ ? 0.0f : 1.0f / Max(light->GetRange(), M_EPSILON);
+        float cutoff = -2.0f;
+        float invCutoff = 1.0f;
+        if (type == LightType::Spot)
+        {
+            cutoff = Cos(light->GetFov() * 0.5f);
+            invCutoff = 1.0f / Max(1.0f - cutoff, M_EPSILON);
+        }
+
+        float fade = 1.0f;
+        float fadeEnd = light->GetDrawDistance();
+        float fadeStart = light->GetFadeDistance();
+        if (!bounds.directional_ && fadeEnd > 0.0f && fadeStart > 0.0f && fadeStart < fadeEnd)
+            fade = Min(1.0f - (light->GetDistance() - fadeStart) / (fadeEnd - fadeStart), 1.0f);
+
+        Color color = light->GetEffectiveColor() * fade;
+        lightData_.Push(Vector4(color.r_, color.g_, color.b_, invRange));
+        lightData_.Push(Vector4(-lightNode->GetWorldDirection(), cutoff));
+        lightData_.Push(Vector4(lightNode->GetWorldPosition(), invCutoff));
+        lightData_.Push(Vector4(light->GetEffectiveSpecularIntensity(), 0.0f, 0.0f, 0.0f));
+    }
+
+    // Assign lights to the clusters of each depth slice in worker threads
+    auto numSlices = (unsigned)gridSize_.z_;
+    sliceIndices_.Resize(numSlices);
+
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (queue && queue->GetNumThreads() && !lights_.Empty())
+    {
+        unsigned numWorkItems = Min(queue->GetNumThreads() + 1, numSlices);
+        unsigned slicesPerItem = (numSlices + numWorkItems - 1) / numWorkItems;
+        for (unsigned start = 0; start < numSlices; start += slicesPerItem)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = BuildClusterSlicesWork;
+            item->aux_ = this;
+            item->start_ = (void*)(size_t)start;
+            item->end_ = (void*)(size_t)Min(start + slicesPerItem, numSlices);
+            queue->AddWorkItem(item);
+        }
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+    else
+        BuildSlices(0, numSlices);
+
+    // Concatenate the slices' light indices
+    unsigned clustersPerSlice = (unsigned)(gridSize_.x_ * gridSize_.y_);
+    lightIndices_.Clear();
+    for (unsigned i = 0; i < numSlices; ++i)
+    {
+        unsigned offset = lightIndices_.Size();
+        for (unsigned j = i * clustersPerSlice; j < (i + 1) * clustersPerSlice; ++j)
+            clusters_[j * 2] += offset;
+        lightIndices_.Push(sliceIndices_[i]);
+    }
+
+    // Pack the cluster headers and light indices into texels
+    unsigned numIndexTexels = lightIndices_.Size() / 4;
+    unsigned numTexels = numClusters + numIndexTexels;
+    clusterData_.Resize((numTexels + CLUSTER_DATA_WIDTH - 1) / CLUSTER_DATA_WIDTH * CLUSTER_DATA_WIDTH);
+    for (unsigned i = 0; i < numClusters; ++i)
+        clusterData_[i] = Vector4((float)(numClusters + clusters_[i * 2] / 4), (float)clusters_[i * 2 + 1], 0.0f, 0.0f);
+    for (unsigned i = 0; i < numIndexTexels; ++i)
+    {
+        const unsigned* indices = &lightIndices_[i * 4];
+        clusterData_[numClusters + i] = Vector4((float)indices[0], (float)indices[1], (float)indices[2], (float)indices[3]);
+    }
+}
+
+void LightClusters::BuildSlices(unsigned start, unsigned end)
+{
+    auto numX = (unsigned)gridSize_.x_;
+    auto numY = (unsigned)gridSize_.y_;
+    PODVector<float> tileX((numX + 1) * 2);
+    PODVector<float> tileY((numY + 1) * 2);
+
+    for (unsigned z = start; z < end; ++z)
+    {
+        PODVector<unsigned>& indices = sliceIndices_[z];
+        indices.Clear();
+        unsigned* clusters = &clusters_[z * numX * numY * 2];
+        for (unsigned i = 0; i < numX * numY; ++i)
+            clusters[i * 2 + 1] = 0;
+
+        float sliceNear = sliceDepths_[z];
+        float sliceFar = sliceDepths_[z + 1];
+
+        // View space X & Y of the tile boundaries at the slice's near and far depth
+        for (unsigned x = 0; x <= numX; ++x)
+        {
+            float ndc = (float)x / (float)numX * 2.0f - 1.0f;
+            tileX[x * 2] = Unproject(ndc, sliceNear, 0);
+            tileX[x * 2 + 1] = Unproject(ndc, sliceFar, 0);
+        }
+        for (unsigned y = 0; y <= numY; ++y)
+        {
+            float ndc = (float)y / (float)numY * 2.0f - 1.0f;
+            tileY[y * 2] = Unproject(ndc, sliceNear, 1);
+            tileY[y * 2 + 1] = Unproject(ndc, sliceFar, 1);
+        }
+
+        // Gather the light indices of each cluster in turn, so that they are contiguous
+        for (unsigned y = 0; y < numY; ++y)
+        {
+            float minY = Min(Min(tileY[y * 2], tileY[y * 2 + 1]), Min(tileY[y * 2 + 2], tileY[y * 2 + 3]));
+            float maxY = Max(Max(tileY[y * 2], tileY[y * 2 + 1]), Max(tileY[y * 2 + 2], tileY[y * 2 + 3]));
+
+            for (unsigned x = 0; x < numX; ++x)
+            {
+                float minX = Min(Min(tileX[x * 2], tileX[x * 2 + 1]), Min(tileX[x * 2 + 2], tileX[x * 2 + 3]));
+                float maxX = Max(Max(tileX[x * 2], tileX[x * 2 + 1]), Max(tileX[x * 2 + 2], tileX[x * 2 + 3]));
+                BoundingBox clusterBox(Vector3(minX, minY, sliceNear), Vector3(maxX, maxY, sliceFar));
+
+                unsigned* cluster = &clusters[(y * numX + x) * 2];
+                cluster[0] = indices.Size();
+                for (unsigned i = 0; i < lightBounds_.Size(); ++i)
+                {
+                    const ClusterLightBounds& bounds = lightBounds_[i];
+                    if (!bounds.directional_)
+                    {
+                        if (bounds.box_.IsInsideFast(clusterBox) == OUTSIDE)
+                            continue;
+                        if (DistanceSquared(bounds.sphere_.center_, clusterBox) > bounds.sphere_.radius_ * bounds.sphere_.radius_)
+                            continue;
+                    }
+                    indices.Push(i);
+                }
+
+                // Pad to a multiple of 4 so that each cluster's indices start at a texel boundary
+                cluster[1] = indices.Size() - cluster[0];
+                while (indices.Size() & 3u)
+                    indices.Push(0);
+            }
+        }
+    }
+}
+
+unsigned LightClusters::GetClusterIndex(const Vector3& viewPos) const
+{
+    Vector4 clipPos = projection_ * Vector4(viewPos, 1.0f);
+    if (clipPos.w_ <= 0.0f)
+        return M_MAX_UNSIGNED;
+
+    float ndcX = clipPos.x_ / clipPos.w_;
+    float ndcY = clipPos.y_ / clipPos.w_;
+    if (ndcX < -1.0f || ndcX > 1.0f || ndcY < -1.0f || ndcY > 1.0f)
+        return M_MAX_UNSIGNED;
+
+    // Same mapping as in the shaders
+    int x = Clamp((int)((ndcX * 0.5f + 0.5f) * (float)gridSize_.x_), 0, gridSize_.x_ - 1);
+    int y = Clamp((int)((ndcY * 0.5f + 0.5f) * (float)gridSize_.y_), 0, gridSize_.y_ - 1);
+    int z = Clamp((int)floorf(log2f(Max(viewPos.z_, M_EPSILON)) * depthParams_.x_ + depthParams_.y_), 0, gridSize_.z_ - 1);
+    return (unsigned)((z * gridSize_.y_ + y) * gridSize_.x_ + x);
+}
+
+float LightClusters::Unproject(float ndc, float z, unsigned axis) const
+{
+    // Invert ndc = (m_a0 * v + m_a2 * z + m_a3) / (m_32 * z + m_33), where v is the view space X or Y
+    float w = projection_.m32_ * z + projection_.m33_;
+    if (axis == 0)
+        return (ndc * w - projection_.m02_ * z - projection_.m03_) / projection_.m00_;
+    else
+        return (ndc * w - projection_.m12_ * z - projection_.m13_) / projection_.m11_;
+}
+
+}
@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Core/Object.h"
+#include "../Math/BoundingBox.h"
+#include "../Math/Matrix4.h"
+#include "../Math/Sphere.h"
+#include "../Math/Vector4.h"
+
+namespace Urho3D
+{
+
+class Camera;
+class Light;
+
+/// Maximum number of lights assigned to clusters.
+static constexpr unsigned MAX_CLUSTERED_LIGHTS = 256;
+/// Number of 4-vectors of light data per clustered light.
+static constexpr unsigned CLUSTERED_LIGHT_DATA_SIZE = 4;
+/// Width of the cluster data texture in texels.
+static constexpr unsigned CLUSTER_DATA_WIDTH = 1024;
+/// Default cluster grid size.
+static const IntVector3 DEFAULT_CLUSTER_GRID(16, 9, 24);
+
+/// Light bounds in view space used during cluster assignment.
+struct ClusterLightBounds
+{
+    /// View space bounding box.
+    BoundingBox box_;
+    /// View space bounding sphere.
+    Sphere sphere_;
+    /// Directional light flag. Directional lights affect all clusters.
+    bool directional_;
+};
+
+/// Clustered light assignment. Divides a camera's view frustum into a grid of screen tiles and exponential depth slices, and bins lights into the clusters they overlap, in worker threads. The results are stored in flat arrays ready to be uploaded to the GPU.
+class URHO3D_API LightClusters : public Object
+{
+    URHO3D_OBJECT(LightClusters, Object);
+
+public:
+    /// Construct.
+    explicit LightClusters(Context* context);
+    /// Destruct.
+    ~LightClusters() override;
+
+    /// Set number of clusters along the screen X and Y axes and the depth axis.
+    void SetGridSize(const IntVector3& size);
+    /// Assign lights to clusters of a camera's view. Depth slices span from minZ to maxZ view depth, and points outside go to the first or last slice. At most MAX_CLUSTERED_LIGHTS lights are assigned.
+    void Build(Camera* camera, float minZ, float maxZ, const PODVector<Light*>& lights);
+    /// Assign lights to the clusters of a depth slice range. Called internally.
+    void BuildSlices(unsigned start, unsigned end);
+
+    /// Return grid size.
+    const IntVector3& GetGridSize() const { return gridSize_; }
+    /// Return number of clusters.
+    unsigned GetNumClusters() const { return (unsigned)(gridSize_.x_ * gridSize_.y_ * gridSize_.z_); }
+    /// Return assigned lights.
+    const PODVector<Light*>& GetLights() const { return lights_; }
+    /// Return cluster index of a view space position, or M_MAX_UNSIGNED if outside the view frustum sides.
+    unsigned GetClusterIndex(const Vector3& viewPos) const;
+    /// Return number of lights in a cluster.
+    unsigned GetNumClusterLights(unsigned cluster) const { return clusters_[cluster * 2 + 1]; }
+    /// Return light index of a cluster's light.
+    unsigned GetClusterLight(unsigned cluster, unsigned index) const { return lightIndices_[clusters_[cluster * 2] + index]; }
+    /// Return index of the first light index and light count of each cluster. Each cluster's light indices start at a multiple of 4.
+    const PODVector<unsigned>& GetClusters() const { return clusters_; }
+    /// Return light indices of all clusters.
+    const PODVector<unsigned>& GetLightIndices() const { return lightIndices_; }
+    /// Return light data: color and inverse range, direction and spot cutoff, position and inverse cutoff, and specular intensity for each light.
+    const PODVector<Vector4>& GetLightData() const { return lightData_; }
+    /// Return packed cluster data: a (first texel, light count) texel for each cluster followed by the light indices, 4 per texel, in rows of CLUSTER_DATA_WIDTH texels.
+    const PODVector<Vector4>& GetClusterData() const { return clusterData_; }
+    /// Return matrix that transforms a world position into cluster X and Y coordinates before perspective division.
+    const Matrix4& GetClusterMatrix() const { return clusterMatrix_; }
+    /// Return scale and bias that map the base 2 logarithm of the camera's normalized linear depth to a depth slice.
+    const Vector2& GetDepthParams() const { return depthParams_; }
+
+private:
+    /// Return view space X or Y of a normalized device coordinate at a view depth.
+    float Unproject(float ndc, float z, unsigned axis) const;
+
+    /// Grid size.
+    IntVector3 gridSize_;
+    /// Assigned lights.
+    PODVector<Light*> lights_;
+    /// View space bounds of assigned lights.
+    PODVector<ClusterLightBounds> lightBounds_;
+    /// Light index offset and count of each cluster.
+    PODVector<unsigned> clusters_;
+    /// Light indices of all clusters.
+    PODVector<unsigned> lightIndices_;
+    /// Light indices of each depth slice, written by the worker threads.
+    Vector<PODVector<unsigned> > sliceIndices_;
+    /// Light data for the GPU.
+    PODVector<Vector4> lightData_;
+    /// Cluster data for the GPU.
+    PODVector<Vector4> clusterData_;
+    /// View depth of each slice boundary.
+    PODVector<float> sliceDepths_;
+    /// Camera projection.
+    Matrix4 projection_;
+    /// World to cluster coordinates matrix.
+    Matrix4 clusterMatrix_;
+    /// Depth slice scale and bias.
+    Vector2 depthParams_;
+    /// Camera far clip distance.
+    float farClip_;
+};
+
+}
@@ -0,0 +1,439 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Graphics/MeshOptimization.h"
+#include "../Graphics/VertexBuffer.h"
+#include "../Math/Vector3.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Largest vertex cache size the optimization simulates.
+static const unsigned MAX_CACHE_SIZE = 64;
+/// Vertex score for the vertices of the last added triangle.
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+/// Power of the vertex score decay by cache position.
+static const float CACHE_DECAY_POWER = 1.5f;
+/// Scale of the vertex score boost for vertices with few remaining triangles.
+static const float VALENCE_BOOST_SCALE = 2.0f;
+/// Power of the vertex score boost by remaining triangles.
+static const float VALENCE_BOOST_POWER = -0.5f;
+
+/// Return an index from index data.
+static inline unsigned GetIndex(const void* indexData, unsigned indexSize, unsigned index)
+{
+    return indexSize == sizeof(unsigned) ? static_cast<const unsigned*>(indexData)[index] :
+        static_cast<const unsigned short*>(indexData)[index];
+}
+
+/// Set an index in index data.
+static inline void SetIndex(void* indexData, unsigned indexSize, unsigned index, unsigned value)
+{
+    if (indexSize == sizeof(unsigned))
+        static_cast<unsigned*>(indexData)[index] = value;
+    else
+        static_cast<unsigned short*>(indexData)[index] = (unsigned short)value;
+}
+
+/// Read an index range and return the number of vertices it spans.
+static unsigned ReadIndices(PODVector<unsigned>& dest, const void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount)
+{
+    dest.Resize(indexCount);
+    unsigned numVertices = 0;
+    for (unsigned i = 0; i < indexCount; ++i)
+    {
+        dest[i] = GetIndex(indexData, indexSize, indexStart + i);
+        numVertices = Max(numVertices, dest[i] + 1);
+    }
+
+    return numVertices;
+}
+
+/// Return the Forsyth score of a vertex by its LRU cache position, or -1 if not in the cache, and its number of remaining triangles.
+static float GetVertexScore(int cachePosition, unsigned valence, unsigned cacheSize)
+{
+    if (!valence)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+            score = LAST_TRIANGLE_SCORE;
+        else
+            score = powf(1.0f - (float)(cachePosition - 3) / (float)(cacheSize - 3), CACHE_DECAY_POWER);
+    }
+
+    return score + VALENCE_BOOST_SCALE * powf((float)valence, VALENCE_BOOST_POWER);
+}
+
+/// Simulate a FIFO vertex cache access and return whether it missed. The cache is emptied by advancing the miss count by the cache size.
+static inline bool CacheMiss(PODVector<unsigned>& timestamps, unsigned& misses, unsigned vertex, unsigned cacheSize)
+{
+    if (timestamps[vertex] && misses - timestamps[vertex] < cacheSize)
+        return false;
+
+    timestamps[vertex] = ++misses;
+    return true;
+}
+
+void OptimizeVertexCache(void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount, unsigned cacheSize)
+{
+    const unsigned numTriangles = indexCount / 3;
+    if (!indexData || numTriangles < 2)
+        return;
+
+    cacheSize = Clamp(cacheSize, 4u, MAX_CACHE_SIZE);
+
+    PODVector<unsigned> indices;
+    const unsigned numVertices = ReadIndices(indices, indexData, indexSize, indexStart, numTriangles * 3);
+
+    // Build the lists of triangles using each vertex. The used part of a list shrinks as triangles are added
+    PODVector<unsigned> remainingTriangles(numVertices, 0);
+    for (unsigned i = 0; i < indices.Size(); ++i)
+        ++remainingTriangles[indices[i]];
+
+    PODVector<unsigned> triangleListStarts(numVertices + 1);
+    triangleListStarts[0] = 0;
+    for (unsigned i = 0; i < numVertices; ++i)
+        triangleListStarts[i + 1] = triangleListStarts[i] + remainingTriangles[i];
+
+    PODVector<unsigned> triangleLists(indices.Size());
+    PODVector<unsigned> fill(triangleListStarts.Buffer(), numVertices);
+    for (unsigned i = 0; i < indices.Size(); ++i)
+        triangleLists[fill[indices[i]]++] = i / 3;
+
+    PODVector<int> cachePositions(numVertices, -1);
+    PODVector<float> vertexScores(numVertices);
+    for (unsigned i = 0; i < numVertices; ++i)
+        vertexScores[i] = GetVertexScore(-1, remainingTriangles[i], cacheSize);
+
+    PODVector<float> triangleScores(numTriangles);
+    PODVector<unsigned char> triangleAdded(numTriangles, 0);
+    unsigned bestTriangle = 0;
+    for (unsigned i = 0; i < numTriangles; ++i)
+    {
+        triangleScores[i] = vertexScores[indices[i * 3]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+        if (triangleScores[i] > triangleScores[bestTriangle])
+            bestTriangle = i;
+    }
+
+    PODVector<unsigned> cache;
+    PODVector<unsigned> newCache;
+    cache.Reserve(cacheSize + 3);
+    newCache.Reserve(cacheSize + 3);
+    unsigned nextUnadded = 0;
+
+    for (unsigned added = 0; added < numTriangles; ++added)
+    {
+        // If no triangle in the cache has remaining triangles, continue from the next one in the original order
+        if (bestTriangle == M_MAX_UNSIGNED)
+        {
+            while (triangleAdded[nextUnadded])
+                ++nextUnadded;
+            bestTriangle = nextUnadded;
+        }
+
+        const unsigned triangle = bestTriangle;
+        const unsigned* triangleIndices = &indices[triangle * 3];
+        for (unsigned i = 0; i < 3; ++i)
+            SetIndex(indexData, indexSize, indexStart + added * 3 + i, triangleIndices[i]);
+        triangleAdded[triangle] = 1;
+
+        // Remove the triangle from the lists of its vertices, and move the vertices to the front of the cache
+        newCache.Clear();
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            const unsigned vertex = triangleIndices[i];
+            unsigned* list = &triangleLists[triangleListStarts[vertex]];
+            unsigned& remaining = remainingTriangles[vertex];
+            for (unsigned j = 0; j < remaining; ++j)
+            {
+                if (list[j] == triangle)
+                {
+                    list[j] = list[--remaining];
+                    break;
+                }
+            }
+
+            if (!newCache.Contains(vertex))
+                newCache.Push(vertex);
+        }
+        for (unsigned i = 0; i < cache.Size(); ++i)
+        {
+            if (!newCache.Contains(cache[i]))
+                newCache.Push(cache[i]);
+        }
+
+        // Update the scores of the vertices in the cache and of those pushed out of it
+        for (unsigned i = 0; i < newCache.Size(); ++i)
+        {
+            const unsigned vertex = newCache[i];
+            cachePositions[vertex] = i < cacheSize ? (int)i : -1;
+            vertexScores[vertex] = GetVertexScore(cachePositions[vertex], remainingTriangles[vertex], cacheSize);
+        }
+
+        // Rescore the remaining triangles of those vertices and choose the best to add next
+        bestTriangle = M_MAX_UNSIGNED;
+        float bestScore = -M_INFINITY;
+        for (unsigned i = 0; i < newCache.Size(); ++i)
+        {
+            const unsigned vertex = newCache[i];
+            const unsigned* list = &triangleLists[triangleListStarts[vertex]];
+            for (unsigned j = 0; j < remainingTriangles[vertex]; ++j)
+            {
+                const unsigned candidate = list[j];
+                const unsigned* candidateIndices = &indices[candidate * 3];
+                const float score = vertexScores[candidateIndices[0]] + vertexScores[candidateIndices[1]] +
+                    vertexScores[candidateIndices[2]];
+                triangleScores[candidate] = score;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = candidate;
+                }
+            }
+        }
+
+        if (newCache.Size() > cacheSize)
+            newCache.Resize(cacheSize);
+        cache.Swap(newCache);
+    }
+}
+
+void OptimizeOverdraw(void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount, const void* vertexData,
+    unsigned vertexSize, const PODVector<VertexElement>& elements, float threshold, unsigned cacheSize)
+{
+    const unsigned numTriangles = indexCount / 3;
+    if (!indexData || !vertexData || numTriangles < 2)
+        return;
+
+    const VertexElement* positionElement = nullptr;
+    for (unsigned i = 0; i < elements.Size(); ++i)
+    {
+        if (elements[i].semantic_ == SEM_POSITION && elements[i].index_ == 0 && !elements[i].perInstance_)
+        {
+            positionElement = &elements[i];
+            break;
+        }
+    }
+    if (!positionElement)
+        return;
+
+    cacheSize = Clamp(cacheSize, 4u, MAX_CACHE_SIZE);
+
+    PODVector<unsigned> indices;
+    const unsigned numVertices = ReadIndices(indices, indexData, indexSize, indexStart, numTriangles * 3);
+    PODVector<unsigned> timestamps(numVertices, 0);
+    unsigned misses = 0;
+
+    // Split into clusters where all vertices of a triangle miss the cache, as the cache effectively restarts there
+    PODVector<unsigned> hardStarts;
+    for (unsigned i = 0; i < numTriangles; ++i)
+    {
+        unsigned triangleMisses = 0;
+        for (unsigned j = 0; j < 3; ++j)
+            triangleMisses += CacheMiss(timestamps, misses, indices[i * 3 + j], cacheSize) ? 1 : 0;
+        if (i == 0 || triangleMisses == 3)
+            hardStarts.Push(i);
+    }
+    hardStarts.Push(numTriangles);
+
+    // Split the clusters further wherever the miss ratio from the cluster start does not exceed the threshold
+    PODVector<unsigned> clusterStarts;
+    for (unsigned i = 0; i + 1 < hardStarts.Size(); ++i)
+    {
+        const unsigned start = hardStarts[i];
+        const unsigned end = hardStarts[i + 1];
+
+        misses += cacheSize;
+        const unsigned clusterMissesStart = misses;
+        for (unsigned j = start * 3; j < end * 3; ++j)
+            CacheMiss(timestamps, misses, indices[j], cacheSize);
+        const float maxRatio = threshold * (float)(misses - clusterMissesStart) / (float)(end - start);
+
+        clusterStarts.Push(start);
+        misses += cacheSize;
+        unsigned splitMissesStart = misses;
+        unsigned splitStart = start;
+        for (unsigned j = start; j < end; ++j)
+        {
+            for (unsigned k = 0; k < 3; ++k)
+                CacheMiss(timestamps, misses, indices[j * 3 + k], cacheSize);
+
+            if (j + 1 < end && (float)(misses - splitMissesStart) <= maxRatio * (float)(j + 1 - splitStart))
+            {
+                clusterStarts.Push(j + 1);
+                misses += cacheSize;
+                splitMissesStart = misses;
+                splitStart = j + 1;
+            }
+        }
+
+        // Join a remainder over the threshold to the previous cluster
+        if (splitStart != start && (float)(misses - splitMissesStart) > maxRatio * (float)(end - splitStart))
+            clusterStarts.Pop();
+    }
+    clusterStarts.Push(numTriangles);
+
+    // Compute the area-weighted centroid and normal direction of each cluster
+    const unsigned numClusters = clusterStarts.Size() - 1;
+    PODVector<Vector3> clusterCentroids(numClusters);
+    PODVector<Vector3> clusterNormals(numClusters);
+    Vector3 meshCentroid = Vector3::ZERO;
+    float meshArea = 0.0f;
+
+    auto* vertices = static_cast<const unsigned char*>(vertexData) + positionElement->offset_;
+    for (unsigned i = 0; i < numClusters; ++i)
+    {
+        Vector3 centroid = Vector3::ZERO;
+        Vector3 normal = Vector3::ZERO;
+        float area = 0.0f;
+
+        for (unsigned j = clusterStarts[i]; j < clusterStarts[i + 1]; ++j)
+        {
+            const Vector3 v0(VertexBuffer::ReadElement(vertices + indices[j * 3] * vertexSize, positionElement->type_));
+            const Vector3 v1(VertexBuffer::ReadElement(vertices + indices[j * 3 + 1] * vertexSize, positionElement->type_));
+            const Vector3 v2(VertexBuffer::ReadElement(vertices + indices[j * 3 + 2] * vertexSize, positionElement->type_));
+            const Vector3 cross = (v1 - v0).CrossProduct(v2 - v0);
+            const float triangleArea = cross.Length();
+
+            centroid += (v0 + v1 + v2) * (triangleArea / 3.0f);
+            normal += cross;
+            area += triangleArea;
+        }
+
+        meshCentroid += centroid;
+        meshArea += area;
+        clusterCentroids[i] = area > 0.0f ? centroid / area : Vector3::ZERO;
+        clusterNormals[i] = normal.Normalized();
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Draw first the clusters whose surface faces away from the mesh center, as they are likely to occlude the rest
+    PODVector<float> sortKeys(numClusters);
+    PODVector<unsigned> order(numClusters);
+    for (unsigned i = 0; i < numClusters; ++i)
+    {
+        sortKeys[i] = (clusterCentroids[i] - meshCentroid).DotProduct(clusterNormals[i]);
+        order[i] = i;
+    }
+    std::stable_sort(order.Buffer(), order.Buffer() + order.Size(), [&sortKeys](unsigned lhs, unsigned rhs)
+    {
+        return sortKeys[lhs] > sortKeys[rhs];
+    });
+
+    unsigned dest = indexStart;
+    for (unsigned i = 0; i < numClusters; ++i)
+    {
+        const unsigned cluster = order[i];
+        for (unsigned j = clusterStarts[cluster] * 3; j < clusterStarts[cluster + 1] * 3; ++j)
+            SetIndex(indexData, indexSize, dest++, indices[j]);
+    }
+}
+
+float GetVertexCacheMissRatio(const void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount, unsigned cacheSize)
+{
+    const unsigned numTriangles = indexCount / 3;
+    if (!indexData || !numTriangles)
+        return 0.0f;
+
+    PODVector<unsigned> indices;
+    const unsigned numVertices = ReadIndices(indices, indexData, indexSize, indexStart, numTriangles * 3);
+    PODVector<unsigned> timestamps(numVertices, 0);
+    unsigned misses = 0;
+    for (unsigned i = 0; i < indices.Size(); ++i)
+        CacheMiss(timestamps, misses, indices[i], Max(cacheSize, 1u));
+
+    return (float)misses / (float)numTriangles;
+}
+
+unsigned AddVertexFetchRemap(PODVector<unsigned>& remap, unsigned vertexCount, const void* indexData, unsigned indexSize,
+    unsigned indexStart, unsigned indexCount)
+{
+    unsigned assigned = 0;
+    if (remap.Size() != vertexCount)
+        remap.Resize(vertexCount, M_MAX_UNSIGNED);
+    for (unsigned i = 0; i < vertexCount; ++i)
+    {
+        if (remap[i] != M_MAX_UNSIGNED)
+            ++assigned;
+    }
+
+    if (!indexData)
+        return assigned;
+
+    for (unsigned i = 0; i < indexCount; ++i)
+    {
+        const unsigned vertex = GetIndex(indexData, indexSize, indexStart + i);
+        if (vertex < vertexCount && remap[vertex] == M_MAX_UNSIGNED)
+            remap[vertex] = assigned++;
+    }
+
+    return assigned;
+}
+
+void RemapVertexData(void* vertexData, unsigned vertexSize, unsigned vertexCount, PODVector<unsigned>& remap)
+{
+    if (!vertexData || remap.Size() != vertexCount)
+        return;
+
+    unsigned assigned = 0;
+    for (unsigned i = 0; i < vertexCount; ++i)
+    {
+        if (remap[i] != M_MAX_UNSIGNED)
+            ++assigned;
+    }
+    for (unsigned i = 0; i < vertexCount; ++i)
+    {
+        if (remap[i] == M_MAX_UNSIGNED)
+            remap[i] = assigned++;
+    }
+
+    PODVector<unsigned char> source(static_cast<const unsigned char*>(vertexData), vertexCount * vertexSize);
+    auto* dest = static_cast<unsigned char*>(vertexData);
+    for (unsigned i = 0; i < vertexCount; ++i)
+        memcpy(dest + remap[i] * vertexSize, &source[i * vertexSize], vertexSize);
+}
+
+void RemapIndexData(void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount, const PODVector<unsigned>& remap)
+{
+    if (!indexData)
+        return;
+
+    for (unsigned i = indexStart; i < indexStart + indexCount; ++i)
+    {
+        const unsigned vertex = GetIndex(indexData, indexSize, i);
+        if (vertex < remap.Size())
+            SetIndex(indexData, indexSize, i, remap[vertex]);
+    }
+}
+
+}
@@ -0,0 +1,51 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Vector.h"
+#include "../Graphics/GraphicsDefs.h"
+
+namespace Urho3D
+{
+
+/// Reorder the triangles of an indexed triangle list in place to improve post-transform vertex cache hits, using Forsyth's linear-speed algorithm with an LRU cache of the given size.
+URHO3D_API void OptimizeVertexCache(void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount, unsigned cacheSize = 16);
+
+/// Reorder the triangles of an indexed triangle list in place to reduce overdraw. The triangles, best already optimized for the vertex cache, are split into clusters where the cache restarts, and the clusters facing outwards from the mesh center are drawn first. Clusters are split further only where the vertex cache miss ratio stays within threshold times the original.
+URHO3D_API void OptimizeOverdraw(void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount, const void* vertexData,
+    unsigned vertexSize, const PODVector<VertexElement>& elements, float threshold = 1.05f, unsigned cacheSize = 16);
+
+/// Return the average number of vertex cache misses per triangle of an indexed triangle list, simulating a FIFO cache of the given size.
+URHO3D_API float GetVertexCacheMissRatio(const void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount, unsigned cacheSize = 16);
+
+/// Assign new vertex indices in the order an index range first references the vertices, to improve vertex fetch locality. The remap is resized to the vertex count, with M_MAX_UNSIGNED for unassigned vertices. Assigned entries are kept, so several index ranges sharing the vertices can be processed in drawing order. Return the number of vertices assigned so far.
+URHO3D_API unsigned AddVertexFetchRemap(PODVector<unsigned>& remap, unsigned vertexCount, const void* indexData, unsigned indexSize,
+    unsigned indexStart, unsigned indexCount);
+
+/// Reorder vertex data in place by a remap from AddVertexFetchRemap(). Vertices no index range referenced are moved after the referenced ones and assigned their new indices in the remap.
+URHO3D_API void RemapVertexData(void* vertexData, unsigned vertexSize, unsigned vertexCount, PODVector<unsigned>& remap);
+
+/// Rewrite an index range in place to use remapped vertex indices.
+URHO3D_API void RemapIndexData(void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount, const PODVector<unsigned>& remap);
+
+}
@@ -0,0 +1,415 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Graphics/MeshSimplification.h"
+#include "../Math/Vector2.h"
+#include "../Math/Vector4.h"
+
+#include <algorithm>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Weight of the normal difference of an edge collapse relative to the squared edge length.
+static const float NORMAL_WEIGHT = 0.5f;
+/// Weight of the texture coordinate difference of an edge collapse relative to the squared edge length.
+static const float TEXCOORD_WEIGHT = 1.0f;
+/// Weight of the skinning weight difference of an edge collapse relative to the squared edge length.
+static const float SKINNING_WEIGHT = 4.0f;
+/// Smallest dot product of a triangle's normal before and after a collapse, relative to the normal lengths.
+static const float MIN_FLIP_DOT = 0.25f;
+/// Largest error of a collapse in a simplification pass relative to the error of the collapse that would reach the target.
+static const float PASS_ERROR_FACTOR = 1.5f;
+
+/// Symmetric 4x4 error quadric of planes, weighted by triangle area.
+struct Quadric
+{
+    /// Add the quadric of a plane.
+    void AddPlane(const Vector3& normal, float d, float weight)
+    {
+        const double a = normal.x_, b = normal.y_, c = normal.z_;
+        a2_ += weight * a * a;
+        ab_ += weight * a * b;
+        ac_ += weight * a * c;
+        ad_ += weight * a * d;
+        b2_ += weight * b * b;
+        bc_ += weight * b * c;
+        bd_ += weight * b * d;
+        c2_ += weight * c * c;
+        cd_ += weight * c * d;
+        d2_ += weight * (double)d * d;
+        weight_ += weight;
+    }
+
+    /// Add another quadric.
+    void Add(const Quadric& rhs)
+    {
+        a2_ += rhs.a2_;
+        ab_ += rhs.ab_;
+        ac_ += rhs.ac_;
+        ad_ += rhs.ad_;
+        b2_ += rhs.b2_;
+        bc_ += rhs.bc_;
+        bd_ += rhs.bd_;
+        c2_ += rhs.c2_;
+        cd_ += rhs.cd_;
+        d2_ += rhs.d2_;
+        weight_ += rhs.weight_;
+    }
+
+    /// Return the mean squared distance of a point to the planes.
+    float Evaluate(const Vector3& v) const
+    {
+        const double x = v.x_, y = v.y_, z = v.z_;
+        double error = a2_ * x * x + 2.0 * ab_ * x * y + 2.0 * ac_ * x * z + 2.0 * ad_ * x + b2_ * y * y + 2.0 * bc_ * y * z +
+            2.0 * bd_ * y + c2_ * z * z + 2.0 * cd_ * z + d2_;
+        return weight_ > 0.0 ? (float)Max(error / weight_, 0.0) : 0.0f;
+    }
+
+    double a2_{}, ab_{}, ac_{}, ad_{}, b2_{}, bc_{}, bd_{}, c2_{}, cd_{}, d2_{};
+    double weight_{};
+};
+
+/// Candidate edge collapse.
+struct Collapse
+{
+    /// Vertex to remove.
+    unsigned from_;
+    /// Vertex to keep.
+    unsigned to_;
+    /// Error of the collapse.
+    float error_;
+};
+
+/// Vertex attributes used for the collapse penalty.
+struct SimplifyVertex
+{
+    /// Position.
+    Vector3 position_;
+    /// Normal.
+    Vector3 normal_;
+    /// First texture coordinates.
+    Vector2 texCoord_;
+    /// Blend indices.
+    unsigned char blendIndices_[4];
+    /// Skinning weights.
+    Vector4 blendWeights_;
+};
+
+/// Return the difference of the skinning of two vertices, 0 to 2.
+static float GetSkinningDifference(const SimplifyVertex& a, const SimplifyVertex& b)
+{
+    float difference = 0.0f;
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        float weight = a.blendWeights_.Data()[i];
+        for (unsigned j = 0; j < 4; ++j)
+        {
+            if (b.blendIndices_[j] == a.blendIndices_[i])
+                weight -= b.blendWeights_.Data()[j];
+        }
+        difference += Abs(weight);
+    }
+
+    // Weights of b's bones not in a
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        bool found = false;
+        for (unsigned j = 0; j < 4 && !found; ++j)
+            found = a.blendIndices_[j] == b.blendIndices_[i] && a.blendWeights_.Data()[j] > 0.0f;
+        if (!found)
+            difference += b.blendWeights_.Data()[i];
+    }
+
+    return difference;
+}
+
+float SimplifyMesh(PODVector<unsigned>& dest, const void* vertexData, unsigned vertexSize, const PODVector<VertexElement>& elements,
+    const void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount, unsigned targetIndexCount, float maxError)
+{
+    indexCount = indexCount / 3 * 3;
+    dest.Resize(indexCount);
+    for (unsigned i = 0; i < indexCount; ++i)
+    {
+        dest[i] = indexSize == sizeof(unsigned) ? static_cast<const unsigned*>(indexData)[indexStart + i] :
+            static_cast<const unsigned short*>(indexData)[indexStart + i];
+    }
+
+    unsigned positionOffset = M_MAX_UNSIGNED;
+    unsigned normalOffset = M_MAX_UNSIGNED;
+    unsigned texCoordOffset = M_MAX_UNSIGNED;
+    unsigned blendWeightsOffset = M_MAX_UNSIGNED;
+    unsigned blendIndicesOffset = M_MAX_UNSIGNED;
+    for (unsigned i = 0; i < elements.Size(); ++i)
+    {
+        const VertexElement& element = elements[i];
+        if (element.index_ != 0)
+            continue;
+        if (element.semantic_ == SEM_POSITION && element.type_ == TYPE_VECTOR3)
+            positionOffset = element.offset_;
+        else if (element.semantic_ == SEM_NORMAL && element.type_ == TYPE_VECTOR3)
+            normalOffset = element.offset_;
+        else if (element.semantic_ == SEM_TEXCOORD && element.type_ == TYPE_VECTOR2)
+            texCoordOffset = element.offset_;
+        else if (element.semantic_ == SEM_BLENDWEIGHTS && element.type_ == TYPE_VECTOR4)
+            blendWeightsOffset = element.offset_;
+        else if (element.semantic_ == SEM_BLENDINDICES && element.type_ == TYPE_UBYTE4)
+            blendIndicesOffset = element.offset_;
+    }
+    if (positionOffset == M_MAX_UNSIGNED || !indexCount)
+        return 0.0f;
+
+    // Read the attributes of the referenced vertices
+    unsigned vertexCount = 0;
+    for (unsigned i = 0; i < indexCount; ++i)
+        vertexCount = Max(vertexCount, dest[i] + 1);
+
+    const auto* vertexBytes = static_cast<const unsigned char*>(vertexData);
+    PODVector<SimplifyVertex> vertices(vertexCount);
+    for (unsigned i = 0; i < vertexCount; ++i)
+    {
+        const unsigned char* src = vertexBytes + i * vertexSize;
+        SimplifyVertex& vertex = vertices[i];
+        vertex.position_ = Vector3(reinterpret_cast<const float*>(src + positionOffset));
+        vertex.normal_ = normalOffset != M_MAX_UNSIGNED ? Vector3(reinterpret_cast<const float*>(src + normalOffset)) : Vector3::ZERO;
+        vertex.texCoord_ = texCoordOffset != M_MAX_UNSIGNED ? Vector2(reinterpret_cast<const float*>(src + texCoordOffset)) : Vector2::ZERO;
+        vertex.blendWeights_ = blendWeightsOffset != M_MAX_UNSIGNED ? Vector4(reinterpret_cast<const float*>(src + blendWeightsOffset)) :
+            Vector4::ZERO;
+        for (unsigned j = 0; j < 4; ++j)
+            vertex.blendIndices_[j] = blendIndicesOffset != M_MAX_UNSIGNED ? src[blendIndicesOffset + j] : 0;
+    }
+
+    // Vertices at the same position are wedges of an attribute seam. Give each position an id
+    PODVector<unsigned> order(vertexCount);
+    for (unsigned i = 0; i < vertexCount; ++i)
+        order[i] = i;
+    std::sort(order.Buffer(), order.Buffer() + order.Size(), [&vertices](unsigned lhs, unsigned rhs)
+    {
+        const Vector3& a = vertices[lhs].position_;
+        const Vector3& b = vertices[rhs].position_;
+        return a.x_ != b.x_ ? a.x_ < b.x_ : a.y_ != b.y_ ? a.y_ < b.y_ : a.z_ < b.z_;
+    });
+
+    PODVector<unsigned> positionIds(vertexCount);
+    PODVector<unsigned> wedgeCounts;
+    for (unsigned i = 0; i < vertexCount; ++i)
+    {
+        if (!i || vertices[order[i]].position_ != vertices[order[i - 1]].position_)
+            wedgeCounts.Push(0);
+        positionIds[order[i]] = wedgeCounts.Size() - 1;
+        ++wedgeCounts.Back();
+    }
+
+    // Find open border edges between positions. Vertices on borders and seams are locked
+    PODVector<unsigned long long> edges;
+    edges.Reserve(indexCount);
+    for (unsigned i = 0; i < indexCount; i += 3)
+    {
+        for (unsigned j = 0; j < 3; ++j)
+        {
+            unsigned long long a = positionIds[dest[i + j]];
+            unsigned long long b = positionIds[dest[i + (j + 1) % 3]];
+            edges.Push(a < b ? (a << 32u) | b : (b << 32u) | a);
+        }
+    }
+    std::sort(edges.Buffer(), edges.Buffer() + edges.Size());
+
+    PODVector<bool> locked(wedgeCounts.Size());
+    for (unsigned i = 0; i < wedgeCounts.Size(); ++i)
+        locked[i] = wedgeCounts[i] > 1;
+    for (unsigned i = 0; i < edges.Size();)
+    {
+        unsigned j = i + 1;
+        while (j < edges.Size() && edges[j] == edges[i])
+            ++j;
+        if (j - i == 1)
+        {
+            locked[(unsigned)(edges[i] >> 32u)] = true;
+            locked[(unsigned)(edges[i] & M_MAX_UNSIGNED)] = true;
+        }
+        i = j;
+    }
+
+    // Accumulate the plane quadrics of the triangles
+    std::vector<Quadric> quadrics(vertexCount);
+    for (unsigned i = 0; i < indexCount; i += 3)
+    {
+        const Vector3& v0 = vertices[dest[i]].position_;
+        const Vector3& v1 = vertices[dest[i + 1]].position_;
+        const Vector3& v2 = vertices[dest[i + 2]].position_;
+        Vector3 normal = (v1 - v0).CrossProduct(v2 - v0);
+        float area = normal.Length();
+        if (area < M_EPSILON)
+            continue;
+
+        normal /= area;
+        for (unsigned j = 0; j < 3; ++j)
+            quadrics[dest[i + j]].AddPlane(normal, -normal.DotProduct(v0), area);
+    }
+
+    PODVector<unsigned> remap(vertexCount);
+    PODVector<bool> modified(vertexCount);
+    PODVector<unsigned> triangleOffsets(vertexCount + 1);
+    PODVector<unsigned> vertexTriangles;
+    PODVector<Collapse> collapses;
+    const float maxErrorSquared = maxError < M_INFINITY ? maxError * maxError : M_INFINITY;
+    float resultError = 0.0f;
+
+    while (dest.Size() > targetIndexCount)
+    {
+        // Build vertex to triangle adjacency
+        const unsigned triangleCount = dest.Size() / 3;
+        for (unsigned i = 0; i <= vertexCount; ++i)
+            triangleOffsets[i] = 0;
+        for (unsigned i = 0; i < dest.Size(); ++i)
+            ++triangleOffsets[dest[i] + 1];
+        for (unsigned i = 0; i < vertexCount; ++i)
+            triangleOffsets[i + 1] += triangleOffsets[i];
+        vertexTriangles.Resize(dest.Size());
+        for (unsigned i = 0; i < vertexCount; ++i)
+            remap[i] = triangleOffsets[i];
+        for (unsigned i = 0; i < dest.Size(); ++i)
+            vertexTriangles[remap[dest[i]]++] = i / 3;
+
+        // Find the cheapest collapse of each unlocked vertex to one of its neighbours
+        collapses.Clear();
+        for (unsigned i = 0; i < vertexCount; ++i)
+        {
+            if (locked[positionIds[i]] || triangleOffsets[i] == triangleOffsets[i + 1])
+                continue;
+
+            const SimplifyVertex& a = vertices[i];
+            Collapse best{ i, i, M_INFINITY };
+            for (unsigned j = triangleOffsets[i]; j < triangleOffsets[i + 1]; ++j)
+            {
+                const unsigned* triangle = &dest[vertexTriangles[j] * 3];
+                for (unsigned k = 0; k < 3; ++k)
+                {
+                    unsigned to = triangle[k];
+                    if (to == i)
+                        continue;
+
+                    const SimplifyVertex& b = vertices[to];
+                    float edgeLengthSquared = (a.position_ - b.position_).LengthSquared();
+                    float penalty = NORMAL_WEIGHT * (a.normal_ - b.normal_).LengthSquared() +
+                        TEXCOORD_WEIGHT * (a.texCoord_ - b.texCoord_).LengthSquared() +
+                        SKINNING_WEIGHT * GetSkinningDifference(a, b);
+                    float error = quadrics[i].Evaluate(b.position_) + penalty * edgeLengthSquared;
+                    if (error < best.error_)
+                        best = { i, to, error };
+                }
+            }
+            if (best.to_ != i)
+                collapses.Push(best);
+        }
+        if (collapses.Empty())
+            break;
+
+        std::sort(collapses.Buffer(), collapses.Buffer() + collapses.Size(),
+            [](const Collapse& lhs, const Collapse& rhs) { return lhs.error_ < rhs.error_; });
+
+        // Apply the cheapest non-conflicting collapses. Each removes about two triangles
+        for (unsigned i = 0; i < vertexCount; ++i)
+        {
+            remap[i] = i;
+            modified[i] = false;
+        }
+
+        // Collapses that conflict with cheaper ones are left to the next pass instead of going far beyond the cost of the goal
+        const unsigned maxCollapses = (dest.Size() - targetIndexCount) / 6 + 1;
+        const float passErrorLimit = Min(collapses[Min(maxCollapses, collapses.Size() - 1)].error_ * PASS_ERROR_FACTOR, maxErrorSquared);
+        unsigned numCollapses = 0;
+        for (unsigned i = 0; i < collapses.Size() && numCollapses < maxCollapses; ++i)
+        {
+            const Collapse& collapse = collapses[i];
+            if (collapse.error_ > passErrorLimit)
+                break;
+            if (modified[collapse.from_] || modified[collapse.to_])
+                continue;
+
+            // Reject collapses that would flip or degenerate the remaining triangles around the removed vertex
+            const Vector3& newPosition = vertices[collapse.to_].position_;
+            bool valid = true;
+            for (unsigned j = triangleOffsets[collapse.from_]; j < triangleOffsets[collapse.from_ + 1] && valid; ++j)
+            {
+                const unsigned* triangle = &dest[vertexTriangles[j] * 3];
+                if (triangle[0] == collapse.to_ || triangle[1] == collapse.to_ || triangle[2] == collapse.to_)
+                    continue;
+
+                Vector3 positions[3];
+                for (unsigned k = 0; k < 3; ++k)
+                    positions[k] = vertices[triangle[k]].position_;
+                Vector3 oldNormal = (positions[1] - positions[0]).CrossProduct(positions[2] - positions[0]);
+                for (unsigned k = 0; k < 3; ++k)
+                {
+                    if (triangle[k] == collapse.from_)
+                        positions[k] = newPosition;
+                }
+                Vector3 newNormal = (positions[1] - positions[0]).CrossProduct(positions[2] - positions[0]);
+                valid = oldNormal.DotProduct(newNormal) > MIN_FLIP_DOT * oldNormal.Length() * newNormal.Length();
+            }
+            if (!valid)
+                continue;
+
+            remap[collapse.from_] = collapse.to_;
+            quadrics[collapse.to_].Add(quadrics[collapse.from_]);
+            resultError = Max(resultError, collapse.error_);
+            ++numCollapses;
+
+            // Keep the neighbourhood unchanged for the rest of the pass so that the flip tests stay valid
+            for (unsigned j = triangleOffsets[collapse.from_]; j < triangleOffsets[collapse.from_ + 1]; ++j)
+            {
+                const unsigned* triangle = &dest[vertexTriangles[j] * 3];
+                for (unsigned k = 0; k < 3; ++k)
+                    modified[triangle[k]] = true;
+            }
+        }
+        if (!numCollapses)
+            break;
+
+        // Rewrite the indices and remove the collapsed triangles
+        unsigned writeIndex = 0;
+        for (unsigned i = 0; i < dest.Size(); i += 3)
+        {
+            unsigned a = remap[dest[i]];
+            unsigned b = remap[dest[i + 1]];
+            unsigned c = remap[dest[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+
+            dest[writeIndex++] = a;
+            dest[writeIndex++] = b;
+            dest[writeIndex++] = c;
+        }
+        dest.Resize(writeIndex);
+        if (writeIndex / 3 == triangleCount)
+            break;
+    }
+
+    return sqrtf(resultError);
+}
+
+}
@@ -0,0 +1,36 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Vector.h"
+#include "../Graphics/GraphicsDefs.h"
+#include "../Math/MathDefs.h"
+
+namespace Urho3D
+{
+
+/// Simplify an indexed triangle list by collapsing edges in order of their quadric error. Vertices are kept and only indices are rewritten, so the result can share the vertex data with the source. Collapses are also penalized by the difference of the normals, the first texture coordinates and the skinning weights of the vertices, and vertices on open borders or attribute seams are not moved. Write the simplified indices to dest and return the largest error introduced, as a distance in the units of the vertex positions. Simplification stops at the target index count or before exceeding the maximum error, whichever comes first.
+URHO3D_API float SimplifyMesh(PODVector<unsigned>& dest, const void* vertexData, unsigned vertexSize, const PODVector<VertexElement>& elements,
+    const void* indexData, unsigned indexSize, unsigned indexStart, unsigned indexCount, unsigned targetIndexCount, float maxError = M_INFINITY);
+
+}
@@ -26,6 +26,8 @@
 #include "../Core/Profiler.h"
 #include "../Graphics/Geometry.h"
 #include "../Graphics/IndexBuffer.h"
+#include "../Graphics/MeshOptimization.h"
+#include "../Graphics/MeshSimplification.h"
 #include "../Graphics/Model.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/VertexBuffer.h"
@@ -41,6 +43,11 @@ using namespace std;
 
 namespace Urho3D
 {
+    /// Screen height in pixels that generated LOD distances are calculated for.
+    static const float LOD_REFERENCE_SCREEN_HEIGHT = 1080.0f;
+    /// Vertical field of view in degrees that generated LOD distances are calculated for.
+    static const float LOD_REFERENCE_FOV = 45.0f;
+
     unsigned LookupVertexBuffer(VertexBuffer* buffer, const std::vector<SharedPtr<VertexBuffer> >& buffers)
     {
         for (unsigned i = 0; i < buffers.size(); ++i)
@@ -91,6 +98,8 @@ namespace Urho3D
         morphs_.clear();
         vertexBuffers_.clear();
         indexBuffers_.clear();
+        positionOffset_ = Vector3::ZERO;
+        positionScale_ = 1.0f;
 
         size_t memoryUse = sizeof(Model);
         bool async = GetAsyncLoadState() == ASYNC_LOADING;
@@ -293,6 +302,7 @@ namespace Urho3D
             morphs_.push_back(newMorph);
             memoryUse += sizeof(ModelMorph);
         }
+        memoryUse += BuildMorphDeltas();
 
         // Read skeleton
         skeleton_.Load(source);
@@ -308,6 +318,13 @@ namespace Urho3D
             geometryCenters_.Push(Vector3::ZERO);
         memoryUse += sizeof(Vector3) * geometries_.size();
 
+        // Read quantized position transform, written only when the positions are quantized
+        if (!source.IsEof())
+        {
+            positionOffset_ = source.ReadVector3();
+            positionScale_ = source.ReadFloat();
+        }
+
         // Read metadata
         auto* cache = GetSubsystem<ResourceCache>();
         String xmlName = ReplaceExtension(GetName(), ".xml");
@@ -363,6 +380,8 @@ namespace Urho3D
         loadVBData_.clear();
         loadIBData_.clear();
         loadGeometries_.clear();
+
+        SetMemoryUse(GetMemoryUse() + UpdateQuantization());
         return true;
     }
 
@@ -464,6 +483,13 @@ namespace Urho3D
         for (unsigned i = 0; i < geometryCenters_.Size(); ++i)
             dest.WriteVector3(geometryCenters_[i]);
 
+        // Write quantized position transform
+        if (quantizedPositions_)
+        {
+            dest.WriteVector3(positionOffset_);
+            dest.WriteFloat(positionScale_);
+        }
+
         // Write metadata
         if (HasMetadata())
         {
@@ -519,6 +545,9 @@ namespace Urho3D
             morphRangeCounts_[i] = i < morphRangeCounts.Size() ? morphRangeCounts[i] : 0;
         }
 
+        // The deltas are relative to the morph ranges
+        BuildMorphDeltas();
+        UpdateQuantization();
         return true;
     }
 
@@ -615,6 +644,404 @@ namespace Urho3D
     void Model::SetMorphs(const std::vector<ModelMorph>& morphs)
     {
         morphs_ = morphs;
+        BuildMorphDeltas();
+    }
+
+    bool Model::GenerateLods(unsigned numLevels, float reduction, float pixelError)
+    {
+        if (reduction <= 0.0f || reduction >= 1.0f || pixelError <= 0.0f)
+        {
+            URHO3D_LOGERROR("Invalid LOD generation parameters");
+            return false;
+        }
+
+        URHO3D_PROFILE(GenerateModelLods);
+
+        // LOD distances are divided by the average bounding box size of the drawable, see Camera::GetLodDistance()
+        const float distanceScale = LOD_REFERENCE_SCREEN_HEIGHT / (2.0f * tanf(LOD_REFERENCE_FOV * 0.5f * M_DEGTORAD) * pixelError *
+            Max(boundingBox_.Size().DotProduct(DOT_SCALE), M_EPSILON));
+        unsigned memoryUse = GetMemoryUse();
+        PODVector<IndexBuffer*> replacedIndexBuffers;
+
+        for (unsigned i = 0; i < geometries_.size(); ++i)
+        {
+            if (geometries_[i].empty() || !geometries_[i][0])
+                continue;
+
+            Geometry* original = geometries_[i][0];
+            const unsigned char* vertexData;
+            const unsigned char* indexData;
+            unsigned vertexSize;
+            unsigned indexSize;
+            const PODVector<VertexElement>* elements;
+            original->GetRawData(vertexData, vertexSize, indexData, indexSize, elements);
+            if (original->GetPrimitiveType() != PrimitiveType::TriangleList || !vertexData || !indexData || !elements)
+                continue;
+
+            // Simplify from the original level each time, so that the errors are measured against it
+            std::vector<PODVector<unsigned> > levelIndices;
+            PODVector<float> lodDistances;
+            unsigned lastIndexCount = original->GetIndexCount();
+            float lastDistance = 0.0f;
+            for (unsigned j = 1; j <= numLevels; ++j)
+            {
+                unsigned targetIndexCount = (unsigned)(original->GetIndexCount() * powf(reduction, (float)j)) / 3 * 3;
+                PODVector<unsigned> indices;
+                float error = SimplifyMesh(indices, vertexData, vertexSize, *elements, indexData, indexSize, original->GetIndexStart(),
+                    original->GetIndexCount(), targetIndexCount);
+                if (indices.Empty() || indices.Size() > lastIndexCount * (1.0f + reduction) * 0.5f)
+                    break;
+
+                lastIndexCount = indices.Size();
+                lastDistance = Max(error * distanceScale, lastDistance + M_EPSILON);
+                levelIndices.push_back(indices);
+                lodDistances.Push(lastDistance);
+            }
+            if (levelIndices.empty())
+                continue;
+
+            // Store the indices of all new levels in one index buffer
+            unsigned totalIndexCount = 0;
+            for (unsigned j = 0; j < levelIndices.size(); ++j)
+                totalIndexCount += levelIndices[j].Size();
+
+            SharedPtr<IndexBuffer> indexBuffer(new IndexBuffer(context_));
+            indexBuffer->SetShadowed(true);
+            indexBuffer->SetSize(totalIndexCount, indexSize == sizeof(unsigned));
+            unsigned char* dest = indexBuffer->GetShadowData();
+            for (unsigned j = 0; j < levelIndices.size(); ++j)
+            {
+                for (unsigned k = 0; k < levelIndices[j].Size(); ++k)
+                {
+                    if (indexSize == sizeof(unsigned))
+                        reinterpret_cast<unsigned*>(dest)[k] = levelIndices[j][k];
+                    else
+                        reinterpret_cast<unsigned short*>(dest)[k] = (unsigned short)levelIndices[j][k];
+                }
+                dest += levelIndices[j].Size() * indexSize;
+            }
+            indexBuffer->SetData(indexBuffer->GetShadowData());
+            indexBuffers_.push_back(indexBuffer);
+            memoryUse += totalIndexCount * indexSize;
+
+            std::vector<SharedPtr<Geometry> > lodLevels(1, geometries_[i][0]);
+            unsigned indexStart = 0;
+            for (unsigned j = 0; j < levelIndices.size(); ++j)
+            {
+                SharedPtr<Geometry> geometry(new Geometry(context_));
+                const Vector<SharedPtr<VertexBuffer> >& vertexBuffers = original->GetVertexBuffers();
+                geometry->SetNumVertexBuffers(vertexBuffers.Size());
+                for (unsigned k = 0; k < vertexBuffers.Size(); ++k)
+                    geometry->SetVertexBuffer(k, vertexBuffers[k]);
+                geometry->SetIndexBuffer(indexBuffer);
+                geometry->SetDrawRange(PrimitiveType::TriangleList, indexStart, levelIndices[j].Size(), original->GetVertexStart(),
+                    original->GetVertexCount(), false);
+                geometry->SetLodDistance(lodDistances[j]);
+                lodLevels.push_back(geometry);
+                indexStart += levelIndices[j].Size();
+            }
+
+            for (unsigned j = 1; j < geometries_[i].size(); ++j)
+            {
+                IndexBuffer* replaced = geometries_[i][j] ? geometries_[i][j]->GetIndexBuffer() : nullptr;
+                if (replaced && !replacedIndexBuffers.Contains(replaced))
+                    replacedIndexBuffers.Push(replaced);
+            }
+            geometries_[i] = lodLevels;
+        }
+
+        // Remove the index buffers of the replaced LOD levels that no geometry uses anymore, so that they are not saved
+        for (unsigned i = 0; i < replacedIndexBuffers.Size(); ++i)
+        {
+            IndexBuffer* buffer = replacedIndexBuffers[i];
+            bool used = false;
+            for (unsigned j = 0; j < geometries_.size() && !used; ++j)
+            {
+                for (unsigned k = 0; k < geometries_[j].size() && !used; ++k)
+                    used = geometries_[j][k] && geometries_[j][k]->GetIndexBuffer() == buffer;
+            }
+            if (used)
+                continue;
+
+            for (std::vector<SharedPtr<IndexBuffer> >::iterator j = indexBuffers_.begin(); j != indexBuffers_.end(); ++j)
+            {
+                if (*j == buffer)
+                {
+                    memoryUse -= Min(memoryUse, buffer->GetIndexCount() * buffer->GetIndexSize());
+                    indexBuffers_.erase(j);
+                    break;
+                }
+            }
+        }
+
+        SetMemoryUse(memoryUse);
+        return true;
+    }
+
+    bool Model::OptimizeGeometries(unsigned cacheSize, float overdrawThreshold)
+    {
+        URHO3D_PROFILE(OptimizeModelGeometries);
+
+        // Reorder the triangles of each distinct index range. Ranges overlapping others are left as they are
+        PODVector<IndexBuffer*> changedIndexBuffers;
+        PODVector<Geometry*> optimizedGeometries;
+        for (unsigned i = 0; i < geometries_.size(); ++i)
+        {
+            for (unsigned j = 0; j < geometries_[i].size(); ++j)
+            {
+                Geometry* geometry = geometries_[i][j];
+                IndexBuffer* indexBuffer = geometry ? geometry->GetIndexBuffer() : nullptr;
+                if (!indexBuffer || !indexBuffer->GetShadowData() || geometry->GetPrimitiveType() != PrimitiveType::TriangleList ||
+                    !geometry->GetIndexCount())
+                    continue;
+
+                const unsigned indexStart = geometry->GetIndexStart();
+                const unsigned indexEnd = indexStart + geometry->GetIndexCount();
+                bool overlaps = false;
+                for (unsigned k = 0; k < optimizedGeometries.Size() && !overlaps; ++k)
+                {
+                    const Geometry* other = optimizedGeometries[k];
+                    overlaps = other->GetIndexBuffer() == indexBuffer && other->GetIndexStart() < indexEnd &&
+                        indexStart < other->GetIndexStart() + other->GetIndexCount();
+                }
+                if (overlaps)
+                    continue;
+
+                OptimizeVertexCache(indexBuffer->GetShadowData(), indexBuffer->GetIndexSize(), indexStart, geometry->GetIndexCount(),
+                    cacheSize);
+
+                if (overdrawThreshold >= 1.0f)
+                {
+                    for (unsigned k = 0; k < geometry->GetNumVertexBuffers(); ++k)
+                    {
+                        VertexBuffer* vertexBuffer = geometry->GetVertexBuffer(k);
+                        if (vertexBuffer && vertexBuffer->GetShadowData() && vertexBuffer->HasElement(SEM_POSITION))
+                        {
+                            OptimizeOverdraw(indexBuffer->GetShadowData(), indexBuffer->GetIndexSize(), indexStart,
+                                geometry->GetIndexCount(), vertexBuffer->GetShadowData(), vertexBuffer->GetVertexSize(),
+                                vertexBuffer->GetElements(), overdrawThreshold, cacheSize);
+                            break;
+                        }
+                    }
+                }
+
+                if (!changedIndexBuffers.Contains(indexBuffer))
+                    changedIndexBuffers.Push(indexBuffer);
+                optimizedGeometries.Push(geometry);
+            }
+        }
+
+        // Find the vertex buffer each index buffer refers to, or null if several
+        HashMap<IndexBuffer*, VertexBuffer*> indexBufferUsers;
+        unsigned maxLodLevels = 0;
+        for (unsigned i = 0; i < geometries_.size(); ++i)
+        {
+            maxLodLevels = Max(maxLodLevels, (unsigned)geometries_[i].size());
+            for (unsigned j = 0; j < geometries_[i].size(); ++j)
+            {
+                Geometry* geometry = geometries_[i][j];
+                if (!geometry || !geometry->GetIndexBuffer())
+                    continue;
+
+                VertexBuffer* vertexBuffer = geometry->GetNumVertexBuffers() == 1 ? geometry->GetVertexBuffer(0) : nullptr;
+                HashMap<IndexBuffer*, VertexBuffer*>::Iterator k = indexBufferUsers.Find(geometry->GetIndexBuffer());
+                if (k == indexBufferUsers.End())
+                    indexBufferUsers[geometry->GetIndexBuffer()] = vertexBuffer;
+                else if (k->second_ != vertexBuffer)
+                    k->second_ = nullptr;
+            }
+        }
+
+        // Reorder the vertices of each buffer in the order its geometries use them, drawing order being LOD level first
+        for (unsigned i = 0; i < vertexBuffers_.size(); ++i)
+        {
+            VertexBuffer* vertexBuffer = vertexBuffers_[i];
+            if (!vertexBuffer || !vertexBuffer->GetShadowData() || morphRangeCounts_[i])
+                continue;
+
+            bool morphed = false;
+            for (unsigned j = 0; j < morphs_.size() && !morphed; ++j)
+                morphed = morphs_[j].buffers_.Contains(i);
+            if (morphed)
+                continue;
+
+            PODVector<Geometry*> users;
+            bool canRemap = true;
+            for (unsigned j = 0; j < maxLodLevels && canRemap; ++j)
+            {
+                for (unsigned k = 0; k < geometries_.size() && canRemap; ++k)
+                {
+                    Geometry* geometry = j < geometries_[k].size() ? geometries_[k][j].Get() : nullptr;
+                    bool usesBuffer = false;
+                    for (unsigned l = 0; geometry && l < geometry->GetNumVertexBuffers(); ++l)
+                        usesBuffer |= geometry->GetVertexBuffer(l) == vertexBuffer;
+                    if (!usesBuffer)
+                        continue;
+
+                    IndexBuffer* indexBuffer = geometry->GetIndexBuffer();
+                    canRemap = indexBuffer && indexBuffer->GetShadowData() && indexBufferUsers[indexBuffer] == vertexBuffer;
+                    users.Push(geometry);
+                }
+            }
+            if (!canRemap || users.Empty())
+                continue;
+
+            const unsigned vertexCount = vertexBuffer->GetVertexCount();
+            PODVector<unsigned> remap;
+            for (unsigned j = 0; j < users.Size(); ++j)
+            {
+                IndexBuffer* indexBuffer = users[j]->GetIndexBuffer();
+                AddVertexFetchRemap(remap, vertexCount, indexBuffer->GetShadowData(), indexBuffer->GetIndexSize(),
+                    users[j]->GetIndexStart(), users[j]->GetIndexCount());
+            }
+            RemapVertexData(vertexBuffer->GetShadowData(), vertexBuffer->GetVertexSize(), vertexCount, remap);
+            vertexBuffer->SetData(vertexBuffer->GetShadowData());
+
+            PODVector<IndexBuffer*> remappedIndexBuffers;
+            for (unsigned j = 0; j < users.Size(); ++j)
+            {
+                IndexBuffer* indexBuffer = users[j]->GetIndexBuffer();
+                if (!remappedIndexBuffers.Contains(indexBuffer))
+                {
+                    RemapIndexData(indexBuffer->GetShadowData(), indexBuffer->GetIndexSize(), 0, indexBuffer->GetIndexCount(), remap);
+                    remappedIndexBuffers.Push(indexBuffer);
+                    if (!changedIndexBuffers.Contains(indexBuffer))
+                        changedIndexBuffers.Push(indexBuffer);
+                }
+            }
+            for (unsigned j = 0; j < users.Size(); ++j)
+                users[j]->SetDrawRange(users[j]->GetPrimitiveType(), users[j]->GetIndexStart(), users[j]->GetIndexCount());
+        }
+
+        for (unsigned i = 0; i < changedIndexBuffers.Size(); ++i)
+            changedIndexBuffers[i]->SetData(changedIndexBuffers[i]->GetShadowData());
+
+        // Refresh the decoded vertex data and the triangle trees for the new order
+        UpdateQuantization();
+        return true;
+    }
+
+    bool Model::ConvertVertexElements(VertexElementSemantic semantic, VertexElementType type)
+    {
+        if (type >= MAX_VERTEX_ELEMENT_TYPES)
+        {
+            URHO3D_LOGERROR("Invalid vertex element type");
+            return false;
+        }
+        if (semantic == SEM_POSITION && type != TYPE_VECTOR3 && type != TYPE_SHORT4_NORM)
+        {
+            URHO3D_LOGERROR("Vertex positions can only be converted to TYPE_VECTOR3 or TYPE_SHORT4_NORM");
+            return false;
+        }
+        if (!morphs_.empty() && (semantic == SEM_POSITION || semantic == SEM_NORMAL || semantic == SEM_TANGENT))
+        {
+            URHO3D_LOGERROR("Can not convert vertex positions, normals or tangents of a morphed model");
+            return false;
+        }
+        if (semantic == SEM_POSITION && type == TYPE_SHORT4_NORM && skeleton_.GetNumBones())
+        {
+            URHO3D_LOGERROR("Can not quantize vertex positions of a skinned model");
+            return false;
+        }
+
+        URHO3D_PROFILE(ConvertVertexElements);
+
+        // Quantize positions relative to a cube enclosing all vertices, so that the scale is uniform and does not skew normals
+        Vector3 newPositionOffset = positionOffset_;
+        float newPositionScale = positionScale_;
+        if (semantic == SEM_POSITION)
+        {
+            BoundingBox box;
+            for (unsigned i = 0; i < vertexBuffers_.size(); ++i)
+            {
+                VertexBuffer* buffer = vertexBuffers_[i];
+                const VertexElement* element = buffer ? buffer->GetElement(SEM_POSITION) : nullptr;
+                if (!element || !buffer->GetShadowData())
+                    continue;
+
+                for (unsigned j = 0; j < buffer->GetVertexCount(); ++j)
+                {
+                    Vector3 position(VertexBuffer::ReadElement(buffer->GetShadowData() + j * buffer->GetVertexSize() + element->offset_,
+                        element->type_));
+                    if (element->type_ == TYPE_SHORT4_NORM)
+                        position = positionOffset_ + position * positionScale_;
+                    box.Merge(position);
+                }
+            }
+
+            if (type == TYPE_SHORT4_NORM && box.Defined())
+            {
+                const Vector3 halfSize = box.HalfSize();
+                newPositionOffset = box.Center();
+                newPositionScale = Max(Max(halfSize.x_, halfSize.y_), Max(halfSize.z_, M_EPSILON));
+            }
+        }
+
+        int memoryChange = 0;
+        for (unsigned i = 0; i < vertexBuffers_.size(); ++i)
+        {
+            VertexBuffer* buffer = vertexBuffers_[i];
+            if (!buffer || !buffer->GetShadowData())
+                continue;
+
+            const PODVector<VertexElement>& elements = buffer->GetElements();
+            PODVector<VertexElement> newElements = elements;
+            bool changed = false;
+            for (unsigned j = 0; j < newElements.Size(); ++j)
+            {
+                if (newElements[j].semantic_ == semantic && !newElements[j].perInstance_ && newElements[j].type_ != type)
+                {
+                    newElements[j].type_ = type;
+                    changed = true;
+                }
+            }
+            if (!changed)
+                continue;
+
+            VertexBuffer::UpdateOffsets(newElements);
+            const unsigned vertexCount = buffer->GetVertexCount();
+            const unsigned vertexSize = buffer->GetVertexSize();
+            const unsigned newVertexSize = VertexBuffer::GetVertexSize(newElements);
+            SharedArrayPtr<unsigned char> newData(new unsigned char[vertexCount * newVertexSize]);
+
+            for (unsigned j = 0; j < vertexCount; ++j)
+            {
+                const unsigned char* src = buffer->GetShadowData() + j * vertexSize;
+                unsigned char* dest = newData.Get() + j * newVertexSize;
+                for (unsigned k = 0; k < elements.Size(); ++k)
+                {
+                    Vector4 value = VertexBuffer::ReadElement(src + elements[k].offset_, elements[k].type_);
+                    if (elements[k].semantic_ == SEM_POSITION && semantic == SEM_POSITION)
+                    {
+                        Vector3 position(value);
+                        if (elements[k].type_ == TYPE_SHORT4_NORM)
+                            position = positionOffset_ + position * positionScale_;
+                        if (newElements[k].type_ == TYPE_SHORT4_NORM)
+                            position = (position - newPositionOffset) / newPositionScale;
+                        value = Vector4(position, 1.0f);
+                    }
+                    VertexBuffer::WriteElement(dest + newElements[k].offset_, newElements[k].type_, value);
+                }
+            }
+
+            buffer->SetSize(vertexCount, newElements, buffer->IsDynamic());
+            buffer->SetData(newData.Get());
+            memoryChange += (int)(vertexCount * newVertexSize) - (int)(vertexCount * vertexSize);
+        }
+
+        positionOffset_ = newPositionOffset;
+        positionScale_ = newPositionScale;
+        memoryChange += (int)UpdateQuantization();
+
+        SetMemoryUse((unsigned)Max((int)GetMemoryUse() + memoryChange, 0));
+        return true;
+    }
+
+    void Model::SetPositionQuantization(const Vector3& offset, float scale)
+    {
+        positionOffset_ = offset;
+        positionScale_ = scale;
+        UpdateQuantization();
     }
 
     SharedPtr<Model> Model::Clone(const String& cloneName) const
@@ -629,6 +1056,8 @@ namespace Urho3D
         ret->morphs_ = morphs_;
         ret->morphRangeStarts_ = morphRangeStarts_;
         ret->morphRangeCounts_ = morphRangeCounts_;
+        ret->positionOffset_ = positionOffset_;
+        ret->positionScale_ = positionScale_;
 
         // Deep copy vertex/index buffers
         HashMap<VertexBuffer*, VertexBuffer*> vbMapping;
@@ -640,7 +1069,7 @@ namespace Urho3D
             if (origBuffer)
             {
                 cloneBuffer = new VertexBuffer(context_);
-                cloneBuffer->SetSize(origBuffer->GetVertexCount(), origBuffer->GetElementMask(), origBuffer->IsDynamic());
+                cloneBuffer->SetSize(origBuffer->GetVertexCount(), origBuffer->GetElements(), origBuffer->IsDynamic());
                 cloneBuffer->SetShadowed(origBuffer->IsShadowed());
                 if (origBuffer->IsShadowed())
                     cloneBuffer->SetData(origBuffer->GetShadowData());
@@ -730,6 +1159,8 @@ namespace Urho3D
                 }
             }
         }
+        ret->BuildMorphDeltas();
+        ret->UpdateQuantization();
 
         ret->SetMemoryUse(GetMemoryUse());
 
@@ -783,4 +1214,142 @@ namespace Urho3D
         return bufferIndex < vertexBuffers_.size() ? morphRangeCounts_[bufferIndex] : 0;
     }
 
+
+    unsigned Model::BuildMorphDeltas()
+    {
+        unsigned memoryUse = 0;
+
+        for (std::vector<ModelMorph>::iterator i = morphs_.begin(); i != morphs_.end(); ++i)
+        {
+            for (HashMap<unsigned, VertexBufferMorph>::Iterator j = i->buffers_.Begin(); j != i->buffers_.End(); ++j)
+            {
+                VertexBufferMorph& vbMorph = j->second_;
+                vbMorph.deltaStart_ = 0;
+                vbMorph.deltaCount_ = 0;
+                vbMorph.deltas_.Reset();
+
+                if (!vbMorph.vertexCount_ || !vbMorph.morphData_ || j->first_ >= morphRangeStarts_.Size())
+                    continue;
+
+                unsigned numComponents = 0;
+                if (vbMorph.elementMask_ & MASK_POSITION)
+                    numComponents += 3;
+                if (vbMorph.elementMask_ & MASK_NORMAL)
+                    numComponents += 3;
+                if (vbMorph.elementMask_ & MASK_TANGENT)
+                    numComponents += 3;
+                if (!numComponents)
+                    continue;
+
+                // Find the span of vertices the morph moves relative to the morph range
+                const unsigned morphRangeStart = morphRangeStarts_[j->first_];
+                const unsigned morphRangeCount = morphRangeCounts_[j->first_];
+                const unsigned vertexSize = sizeof(unsigned) + numComponents * sizeof(float);
+                unsigned minIndex = M_MAX_UNSIGNED;
+                unsigned maxIndex = 0;
+                bool valid = true;
+                for (unsigned k = 0; k < vbMorph.vertexCount_; ++k)
+                {
+                    unsigned index = *reinterpret_cast<const unsigned*>(&vbMorph.morphData_[k * vertexSize]);
+                    if (index < morphRangeStart || index - morphRangeStart >= morphRangeCount)
+                    {
+                        valid = false;
+                        break;
+                    }
+                    minIndex = Min(minIndex, index - morphRangeStart);
+                    maxIndex = Max(maxIndex, index - morphRangeStart);
+                }
+                // Vertices outside the morph range are left to the packed data path
+                if (!valid)
+                {
+                    URHO3D_LOGWARNING("Morph " + i->name_ + " moves vertices outside the morph range of vertex buffer " +
+                        String(j->first_));
+                    continue;
+                }
+
+                vbMorph.deltaStart_ = minIndex & ~3u;
+                vbMorph.deltaCount_ = (maxIndex + 1 - vbMorph.deltaStart_ + 3) & ~3u;
+                vbMorph.deltas_ = new float[numComponents * vbMorph.deltaCount_];
+                memset(vbMorph.deltas_.Get(), 0, numComponents * vbMorph.deltaCount_ * sizeof(float));
+
+                for (unsigned k = 0; k < vbMorph.vertexCount_; ++k)
+                {
+                    const unsigned char* src = &vbMorph.morphData_[k * vertexSize];
+                    unsigned vertex = *reinterpret_cast<const unsigned*>(src) - morphRangeStart - vbMorph.deltaStart_;
+                    const auto* data = reinterpret_cast<const float*>(src + sizeof(unsigned));
+                    for (unsigned l = 0; l < numComponents; ++l)
+                        vbMorph.deltas_[l * vbMorph.deltaCount_ + vertex] = data[l];
+                }
+
+                memoryUse += numComponents * vbMorph.deltaCount_ * sizeof(float);
+            }
+        }
+
+        return memoryUse;
+    }
+
+    unsigned Model::UpdateQuantization()
+    {
+        quantizedPositions_ = false;
+        unsigned memoryUse = 0;
+
+        for (unsigned i = 0; i < vertexBuffers_.size(); ++i)
+        {
+            VertexBuffer* buffer = vertexBuffers_[i];
+            if (!buffer)
+                continue;
+
+            const VertexElement* position = buffer->GetElement(SEM_POSITION);
+            const VertexElement* texCoord = buffer->GetElement(SEM_TEXCOORD);
+            if (position && position->type_ == TYPE_SHORT4_NORM)
+                quantizedPositions_ = true;
+
+            // CPU-side operations such as raycasts expect float positions and texture coordinates
+            SharedArrayPtr<unsigned char> rawData;
+            PODVector<VertexElement> rawElements;
+            if (position && buffer->GetShadowData() && (position->type_ != TYPE_VECTOR3 || (texCoord && texCoord->type_ != TYPE_VECTOR2)))
+            {
+                rawElements.Push(VertexElement(TYPE_VECTOR3, SEM_POSITION));
+                if (texCoord)
+                    rawElements.Push(VertexElement(TYPE_VECTOR2, SEM_TEXCOORD));
+                VertexBuffer::UpdateOffsets(rawElements);
+
+                const unsigned vertexCount = buffer->GetVertexCount();
+                const unsigned rawVertexSize = VertexBuffer::GetVertexSize(rawElements);
+                rawData = new unsigned char[vertexCount * rawVertexSize];
+                for (unsigned j = 0; j < vertexCount; ++j)
+                {
+                    const unsigned char* src = buffer->GetShadowData() + j * buffer->GetVertexSize();
+                    auto* dest = reinterpret_cast<float*>(rawData.Get() + j * rawVertexSize);
+                    Vector3 decoded(VertexBuffer::ReadElement(src + position->offset_, position->type_));
+                    if (position->type_ == TYPE_SHORT4_NORM)
+                        decoded = positionOffset_ + decoded * positionScale_;
+                    memcpy(dest, decoded.Data(), sizeof(Vector3));
+                    if (texCoord)
+                    {
+                        Vector4 uv = VertexBuffer::ReadElement(src + texCoord->offset_, texCoord->type_);
+                        dest[3] = uv.x_;
+                        dest[4] = uv.y_;
+                    }
+                }
+                memoryUse += vertexCount * rawVertexSize;
+            }
+
+            // Leave the raw data of the geometries using a buffer that needs no conversion as it was
+            if (!rawData)
+                continue;
+
+            for (unsigned j = 0; j < geometries_.size(); ++j)
+            {
+                for (unsigned k = 0; k < geometries_[j].size(); ++k)
+                {
+                    Geometry* geometry = geometries_[j][k];
+                    if (geometry && geometry->GetNumVertexBuffers() && geometry->GetVertexBuffer(0) == buffer)
+                        geometry->SetRawVertexData(rawData, rawElements);
+                }
+            }
+        }
+
+        return memoryUse;
+    }
 }
@@ -27,6 +27,7 @@
 #include "../Graphics/GraphicsDefs.h"
 #include "../Graphics/Skeleton.h"
 #include "../Math/BoundingBox.h"
+#include "../Math/Matrix3x4.h"
 #include "../Resource/Resource.h"
 
 namespace Urho3D
@@ -48,6 +49,12 @@ struct VertexBufferMorph
     unsigned dataSize_;
     /// Morphed vertices. Stored packed as <index, data> pairs.
     SharedArrayPtr<unsigned char> morphData_;
+    /// First vertex of the delta span relative to the buffer's morph range start. Aligned to 4 vertices.
+    unsigned deltaStart_{};
+    /// Number of vertices in the delta span. Padded to a multiple of 4 vertices.
+    unsigned deltaCount_{};
+    /// Morph deltas as structure of arrays for SIMD accumulation: one array of deltaCount_ floats for each X, Y and Z component of the position, normal and tangent elements in the element mask, in that order. Zero for vertices in the span that the morph does not move.
+    SharedArrayPtr<float> deltas_;
 };
 
 /// Definition of a model's vertex morph.
@@ -148,8 +155,16 @@ public:
     void SetSkeleton(const Skeleton& skeleton);
     /// Set bone mappings when model has more bones than the skinning shader can handle.
     void SetGeometryBoneMappings(const std::vector<std::vector<u32> >& geometryBoneMappings);
-    /// Set vertex morphs.
+    /// Set vertex morphs. Call again after modifying the morph data to refresh the deltas used for applying the morphs.
     void SetMorphs(const std::vector<ModelMorph>& morphs);
+    /// Generate LOD levels for the indexed triangle list geometries by mesh simplification, replacing their existing LOD levels. Each level has about the reduction times the triangles of the previous one, and its LOD distance is where its simplification error projects to the given number of pixels on a 1080 pixel high screen with a 45 degree field of view. Geometries that do not simplify further get fewer levels. The vertex buffers are shared with the original level, and the indices of the new levels are added as a new index buffer per geometry. Return true on success.
+    bool GenerateLods(unsigned numLevels, float reduction = 0.5f, float pixelError = 1.0f);
+    /// Optimize the indexed triangle list geometries for rendering. The triangles are reordered for the post-transform vertex cache, and if the overdraw threshold is at least 1, so that clusters facing outwards are drawn first while the vertex cache miss ratio stays within the threshold times the optimized one. Then the vertices of buffers without morphs are reordered in the order the geometries use them. Return true on success.
+    bool OptimizeGeometries(unsigned cacheSize = 16, float overdrawThreshold = 1.05f);
+    /// Convert the vertex elements of a semantic in all vertex buffers to another type, for example to quantize them to a more compact type. Positions can be converted to TYPE_SHORT4_NORM relative to a cube enclosing the vertices, which the model drawables transform back to model space. Positions, normals and tangents of morphed models and positions of skinned models can not be converted. Return true on success.
+    bool ConvertVertexElements(VertexElementSemantic semantic, VertexElementType type);
+    /// Set the offset and uniform scale from TYPE_SHORT4_NORM vertex positions to model space. Only needs to be called when setting up vertex buffers with quantized positions manually, after the geometries.
+    void SetPositionQuantization(const Vector3& offset, float scale);
     /// Clone the model. The geometry data is deep-copied and can be modified in the clone without affecting the original.
     SharedPtr<Model> Clone(const String& cloneName = String::EMPTY) const;
 
@@ -212,7 +227,24 @@ public:
     /// Return vertex buffer morph range vertex count.
     unsigned GetMorphRangeCount(unsigned bufferIndex) const;
 
+    /// Return whether vertex positions are quantized, in which case the drawables apply the position transform.
+    bool HasQuantizedPositions() const { return quantizedPositions_; }
+
+    /// Return offset of quantized vertex positions.
+    const Vector3& GetPositionOffset() const { return positionOffset_; }
+
+    /// Return uniform scale of quantized vertex positions.
+    float GetPositionScale() const { return positionScale_; }
+
+    /// Return transform from quantized vertex positions to model space.
+    Matrix3x4 GetPositionTransform() const { return Matrix3x4(positionOffset_, Quaternion::IDENTITY, positionScale_); }
+
 private:
+    /// Build the structure of arrays deltas of all vertex morphs from the packed morph data. Return memory use of the deltas.
+    unsigned BuildMorphDeltas();
+    /// Check whether vertex positions are quantized, and give the geometries of vertex buffers with quantized positions or texture coordinates decoded raw vertex data for CPU-side operations. Return memory use of the decoded data.
+    unsigned UpdateQuantization();
+
     /// Bounding box.
     BoundingBox boundingBox_;
     /// Skeleton.
@@ -233,6 +265,12 @@ private:
     PODVector<unsigned> morphRangeStarts_;
     /// Vertex buffer morph range vertex count.
     PODVector<unsigned> morphRangeCounts_;
+    /// Offset of quantized vertex positions.
+    Vector3 positionOffset_{Vector3::ZERO};
+    /// Uniform scale of quantized vertex positions.
+    float positionScale_{1.0f};
+    /// Quantized vertex positions flag.
+    bool quantizedPositions_{};
     /// Vertex buffer data for asynchronous loading.
     std::vector<VertexBufferDesc> loadVBData_;
     /// Index buffer data for asynchronous loading.
@@ -0,0 +1,1572 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../../Precompiled.h"
+
+#include "../../Core/Context.h"
+#include "../../Core/Profiler.h"
+#include "../../Graphics/ConstantBuffer.h"
+#include "../../Graphics/Geometry.h"
+#include "../../Graphics/Graphics.h"
+#include "../../Graphics/GraphicsEvents.h"
+#include "../../Graphics/GraphicsImpl.h"
+#include "../../Graphics/IndexBuffer.h"
+#include "../../Graphics/Renderer.h"
+#include "../../Graphics/Shader.h"
+#include "../../Graphics/ShaderPrecache.h"
+#include "../../Graphics/ShaderProgram.h"
+#include "../../Graphics/Texture2D.h"
+#include "../../Graphics/TextureCube.h"
+#include "../../Graphics/VertexBuffer.h"
+#include "../../IO/Log.h"
+#include "../../Resource/Image.h"
+#include "../../Resource/ResourceCache.h"
+
+#include "../../DebugNew.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable:4355)
+#endif
+
+namespace Urho3D
+{
+    static unsigned GetPrimitiveCount(uint32_t elementCount, PrimitiveType type)
+    {
+        switch (type)
+        {
+            case PrimitiveType::TriangleList:
+                return elementCount / 3;
+
+            case PrimitiveType::LineList:
+                return elementCount / 2;
+
+            case PrimitiveType::PointList:
+                return elementCount;
+
+            case PrimitiveType::TriangleStrip:
+                return elementCount - 2;
+
+            case PrimitiveType::LineStrip:
+                return elementCount - 1;
+
+            default:
+                return 0;
+        }
+    }
+
+    Graphics::Graphics(Context* context)
+        : Object(context)
+        , impl_(new GraphicsImpl())
+        , shaderPath_("Shaders/HLSL/")
+        , shaderExtension_(".hlsl")
+        , orientations_("LandscapeLeft LandscapeRight")
+        , apiName_("Null")
+    {
+        SetTextureUnitMappings();
+        ResetCachedState();
+
+        // The null backend never opens a window, so SDL video is not required
+
+        // Register Graphics library object factories
+        RegisterGraphicsLibrary(context_);
+    }
+
+    Graphics::~Graphics()
+    {
+        {
+            std::lock_guard<std::mutex> lock(gpuObjectMutex_);
+
+            // Release all GPU objects that still exist
+            for (GPUObject* object : gpuObjects)
+                object->Release();
+            gpuObjects.clear();
+        }
+
+        impl_->allConstantBuffers_.clear();
+        impl_->shaderPrograms_.clear();
+
+        delete impl_;
+        impl_ = nullptr;
+    }
+
+    bool Graphics::SetScreenMode(int width, int height, const ScreenModeParams& params, bool maximize)
+    {
+        URHO3D_PROFILE(SetScreenMode);
+
+        // There is no display to query, so only sanitize the parameters instead of calling AdjustScreenMode()
+        ScreenModeParams newParams = params;
+        newParams.highDPI_ = false;
+        newParams.monitor_ = 0;
+        newParams.multiSample_ = NextPowerOfTwo(Clamp(newParams.multiSample_, 1, 16));
+        if (newParams.borderless_)
+            newParams.fullscreen_ = false;
+
+        if (!width || !height)
+        {
+            width = 1024;
+            height = 768;
+        }
+
+        // If nothing changes, do not reset the device
+        if (width == width_ && height == height_ && newParams == screenParams_)
+            return true;
+
+        screenParams_ = newParams;
+
+        if (!impl_->deviceCreated_)
+            CreateDevice(width, height);
+        UpdateSwapChain(width, height);
+
+        Clear(ClearTargetFlags::Color);
+
+        OnScreenModeChanged();
+        return true;
+    }
+
+    void Graphics::SetSRGB(bool enable)
+    {
+        sRGB_ = enable && sRGBWriteSupport_;
+    }
+
+    void Graphics::SetFlushGPU(bool enable)
+    {
+        flushGPU_ = enable;
+    }
+
+    void Graphics::Close()
+    {
+        // There is no window to close. Mark the device uninitialized so that frames are no longer rendered
+        impl_->deviceCreated_ = false;
+    }
+
+    bool Graphics::TakeScreenShot(Image& destImage)
+    {
+        URHO3D_PROFILE(TakeScreenShot);
+
+        if (!impl_->deviceCreated_)
+            return false;
+
+        // Nothing is rasterized, so the backbuffer contents are always black
+        destImage.SetSize(width_, height_, 3);
+        memset(destImage.GetData(), 0, (size_t)(width_ * height_ * 3));
+        return true;
+    }
+
+    bool Graphics::BeginFrame()
+    {
+        if (!IsInitialized())
+            return false;
+
+        // Set default rendertarget and depth buffer
+        ResetRenderTargets();
+
+        // Cleanup textures from previous frame
+        for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
+            SetTexture(i, nullptr);
+
+        numPrimitives_ = 0;
+        numBatches_ = 0;
+
+        SendEvent(E_BEGINRENDERING);
+        return true;
+    }
+
+    void Graphics::EndFrame()
+    {
+        if (!IsInitialized())
+            return;
+
+        {
+            URHO3D_PROFILE(Present);
+
+            SendEvent(E_ENDRENDERING);
+        }
+
+        // Clean up too large scratch buffers
+        CleanupScratchBuffers();
+    }
+
+    void Graphics::Clear(ClearTargetFlags flags, const Color& color, float depth, unsigned stencil)
+    {
+        IntVector2 rtSize = GetRenderTargetDimensions();
+
+        bool oldColorWrite = colorWrite_;
+        bool oldDepthWrite = depthWrite_;
+
+        // Emulate partial clear by rendering a quad like Direct3D11 does, so that the same amount of work is submitted
+        if (!viewport_.left_ && !viewport_.top_ && viewport_.right_ == rtSize.x && viewport_.bottom_ == rtSize.y)
+        {
+            SetDepthWrite(true);
+            PrepareDraw();
+        }
+        else
+        {
+            Renderer* renderer = GetSubsystem<Renderer>();
+            if (!renderer)
+                return;
+
+            Geometry* geometry = renderer->GetQuadGeometry();
+
+            Matrix3x4 model = Matrix3x4::IDENTITY;
+            Matrix4 projection = Matrix4::IDENTITY;
+            model.m23_ = Clamp(depth, 0.0f, 1.0f);
+
+            SetBlendMode(BLEND_REPLACE);
+            SetColorWrite((flags & ClearTargetFlags::Color) != 0);
+            SetCullMode(CullMode::None);
+            SetDepthTest(CMP_ALWAYS);
+            SetDepthWrite((flags & ClearTargetFlags::Depth) != 0);
+            SetFillMode(FillMode::Solid);
+            SetScissorTest(false);
+            SetStencilTest((flags & ClearTargetFlags::Stencil) != 0, CMP_ALWAYS, OP_REF, OP_KEEP, OP_KEEP, stencil);
+            SetShaders(GetShader(VS, "ClearFramebuffer"), GetShader(PS, "ClearFramebuffer"));
+            SetShaderParameter(VSP_MODEL, model);
+            SetShaderParameter(VSP_VIEWPROJ, projection);
+            SetShaderParameter(PSP_MATDIFFCOLOR, color);
+
+            geometry->Draw(this);
+
+            SetStencilTest(false);
+            ClearParameterSources();
+        }
+
+        // Restore color & depth write state now
+        SetColorWrite(oldColorWrite);
+        SetDepthWrite(oldDepthWrite);
+    }
+
+    bool Graphics::ResolveToTexture(Texture2D* destination, const IntRect& viewport)
+    {
+        if (!destination || !destination->GetRenderSurface())
+            return false;
+
+        return true;
+    }
+
+    bool Graphics::ResolveToTexture(Texture2D* texture)
+    {
+        if (!texture)
+            return false;
+        RenderSurface* surface = texture->GetRenderSurface();
+        if (!surface)
+            return false;
+
+        texture->SetResolveDirty(false);
+        surface->SetResolveDirty(false);
+        return true;
+    }
+
+    bool Graphics::ResolveToTexture(TextureCube* texture)
+    {
+        if (!texture)
+            return false;
+
+        texture->SetResolveDirty(false);
+        for (unsigned i = 0; i < MAX_CUBEMAP_FACES; ++i)
+        {
+            RenderSurface* surface = texture->GetRenderSurface((CubeMapFace)i);
+            if (surface)
+                surface->SetResolveDirty(false);
+        }
+
+        return true;
+    }
+
+    void Graphics::Draw(PrimitiveType type, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex)
+    {
+        if (!vertexCount || !impl_->shaderProgram_)
+            return;
+
+        PrepareDraw();
+
+        if ((unsigned)type != primitiveType_)
+        {
+            primitiveType_ = (unsigned)type;
+            ++impl_->numStateChanges_;
+        }
+
+        unsigned primitiveCount = GetPrimitiveCount(vertexCount, type) * Max(instanceCount, 1U);
+        ++impl_->numDraws_;
+        impl_->numPrimitives_ += primitiveCount;
+
+        numPrimitives_ += GetPrimitiveCount(vertexCount, type);
+        ++numBatches_;
+    }
+
+    void Graphics::DrawIndexed(PrimitiveType type, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex)
+    {
+        if (!indexCount || !indexBuffer_ || !impl_->shaderProgram_)
+            return;
+
+        PrepareDraw();
+
+        if ((unsigned)type != primitiveType_)
+        {
+            primitiveType_ = (unsigned)type;
+            ++impl_->numStateChanges_;
+        }
+
+        unsigned primitiveCount = GetPrimitiveCount(indexCount, type) * Max(instanceCount, 1U);
+        ++impl_->numDraws_;
+        impl_->numPrimitives_ += primitiveCount;
+
+        numPrimitives_ += GetPrimitiveCount(indexCount, type);
+        ++numBatches_;
+    }
+
+    void Graphics::SetVertexBuffer(VertexBuffer* buffer)
+    {
+        // Note: this is not multi-instance safe
+        static PODVector<VertexBuffer*> vertexBuffers(1);
+        vertexBuffers[0] = buffer;
+        SetVertexBuffers(vertexBuffers);
+    }
+
+    bool Graphics::SetVertexBuffers(const PODVector<VertexBuffer*>& buffers, unsigned instanceOffset)
+    {
+        if (buffers.Size() > kMaxVertexBufferBindings)
+        {
+            URHO3D_LOGERROR("Too many vertex buffers");
+            return false;
+        }
+
+        for (uint32_t i = 0; i < kMaxVertexBufferBindings; ++i)
+        {
+            VertexBuffer* buffer = i < buffers.Size() ? buffers[i] : nullptr;
+            if (buffer)
+            {
+                const PODVector<VertexElement>& elements = buffer->GetElements();
+                // Check if buffer has per-instance data
+                bool hasInstanceData = elements.Size() && elements[0].perInstance_;
+                unsigned offset = hasInstanceData ? instanceOffset * buffer->GetVertexSize() : 0;
+
+                if (buffer != vertexBuffers_[i] || offset != impl_->vertexOffsets_[i])
+                {
+                    vertexBuffers_[i] = buffer;
+                    impl_->vertexOffsets_[i] = offset;
+                    impl_->vertexDeclarationDirty_ = true;
+                    ++impl_->numStateChanges_;
+                }
+            }
+            else if (vertexBuffers_[i])
+            {
+                vertexBuffers_[i] = nullptr;
+                impl_->vertexOffsets_[i] = 0;
+                impl_->vertexDeclarationDirty_ = true;
+                ++impl_->numStateChanges_;
+            }
+        }
+
+        return true;
+    }
+
+    bool Graphics::SetVertexBuffers(const Vector<SharedPtr<VertexBuffer> >& buffers, unsigned instanceOffset)
+    {
+        return SetVertexBuffers(reinterpret_cast<const PODVector<VertexBuffer*>&>(buffers), instanceOffset);
+    }
+
+    void Graphics::SetIndexBuffer(IndexBuffer* buffer)
+    {
+        if (buffer != indexBuffer_)
+        {
+            indexBuffer_ = buffer;
+            ++impl_->numStateChanges_;
+        }
+    }
+
+    void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
+    {
+        // Switch to the clip plane variations if necessary
+        if (useClipPlane_)
+        {
+            if (vs)
+                vs = vs->GetOwner()->GetVariation(VS, vs->GetDefinesClipPlane());
+            if (ps)
+                ps = ps->GetOwner()->GetVariation(PS, ps->GetDefinesClipPlane());
+        }
+
+        if (vs == vertexShader_ && ps == pixelShader_)
+            return;
+
+        if (vs != vertexShader_)
+        {
+            // Create the shader now if not yet created. If already attempted, do not retry
+            if (vs && !vs->GetGPUObject())
+            {
+                if (vs->GetCompilerOutput().Empty())
+                {
+                    URHO3D_PROFILE(CompileVertexShader);
+
+                    bool success = vs->Create();
+                    if (!success)
+                    {
+                        URHO3D_LOGERROR("Failed to compile vertex shader " + vs->GetFullName() + ":\n" + vs->GetCompilerOutput());
+                        vs = nullptr;
+                    }
+                }
+                else
+                    vs = nullptr;
+            }
+
+            vertexShader_ = vs;
+            impl_->vertexDeclarationDirty_ = true;
+            ++impl_->numStateChanges_;
+        }
+
+        if (ps != pixelShader_)
+        {
+            if (ps && !ps->GetGPUObject())
+            {
+                if (ps->GetCompilerOutput().Empty())
+                {
+                    URHO3D_PROFILE(CompilePixelShader);
+
+                    bool success = ps->Create();
+                    if (!success)
+                    {
+                        URHO3D_LOGERROR("Failed to compile pixel shader " + ps->GetFullName() + ":\n" + ps->GetCompilerOutput());
+                        ps = nullptr;
+                    }
+                }
+                else
+                    ps = nullptr;
+            }
+
+            pixelShader_ = ps;
+            ++impl_->numStateChanges_;
+        }
+
+        if (vertexShader_ && pixelShader_)
+        {
+            std::pair<ShaderVariation*, ShaderVariation*> key = std::make_pair(vertexShader_, pixelShader_);
+            ShaderProgramMap::iterator i = impl_->shaderPrograms_.find(key);
+            if (i != impl_->shaderPrograms_.end())
+                impl_->shaderProgram_ = i->second.Get();
+            else
+            {
+                ShaderProgram* newProgram = impl_->shaderPrograms_[key] = new ShaderProgram(this, vertexShader_, pixelShader_);
+                impl_->shaderProgram_ = newProgram;
+            }
+
+            // A program switch rebinds the constant buffers, so all parameter groups need to be set again
+            ClearParameterSources();
+        }
+        else
+            impl_->shaderProgram_ = nullptr;
+
+        // Store shader combination if shader dumping in progress
+        if (shaderPrecache_)
+            shaderPrecache_->StoreShaders(vertexShader_, pixelShader_);
+
+        // Update clip plane parameter if necessary
+        if (useClipPlane_)
+            SetShaderParameter(VSP_CLIPPLANE, clipPlane_);
+    }
+
+    void Graphics::SetShaderParameter(StringHash param, const float* data, unsigned count)
+    {
+        if (!impl_->shaderProgram_)
+            return;
+
+        ++impl_->numShaderParameterUpdates_;
+        impl_->bytesUploaded_ += count * sizeof(float);
+    }
+
+    void Graphics::SetShaderParameter(StringHash param, float value)
+    {
+        if (!impl_->shaderProgram_)
+            return;
+
+        ++impl_->numShaderParameterUpdates_;
+        impl_->bytesUploaded_ += sizeof(float);
+    }
+
+    void Graphics::SetShaderParameter(StringHash param, int value)
+    {
+        if (!impl_->shaderProgram_)
+            return;
+
+        ++impl_->numShaderParameterUpdates_;
+        impl_->bytesUploaded_ += sizeof(int);
+    }
+
+    void Graphics::SetShaderParameter(StringHash param, bool value)
+    {
+        if (!impl_->shaderProgram_)
+            return;
+
+        ++impl_->numShaderParameterUpdates_;
+        impl_->bytesUploaded_ += sizeof(bool);
+    }
+
+    void Graphics::SetShaderParameter(StringHash param, const Color& color)
+    {
+        if (!impl_->shaderProgram_)
+            return;
+
+        ++impl_->numShaderParameterUpdates_;
+        impl_->bytesUploaded_ += sizeof(Color);
+    }
+
+    void Graphics::SetShaderParameter(StringHash param, const Vector2& vector)
+    {
+        if (!impl_->shaderProgram_)
+            return;
+
+        ++impl_->numShaderParameterUpdates_;
+        impl_->bytesUploaded_ += sizeof(Vector2);
+    }
+
+    void Graphics::SetShaderParameter(StringHash param, const Matrix3& matrix)
+    {
+        if (!impl_->shaderProgram_)
+            return;
+
+        // Uploaded as three padded rows, like a Vector3 array parameter
+        ++impl_->numShaderParameterUpdates_;
+        impl_->bytesUploaded_ += 3 * sizeof(Vector4);
+    }
+
+    void Graphics::SetShaderParameter(StringHash param, const Vector3& vector)
+    {
+        if (!impl_->shaderProgram_)
+            return;
+
+        ++impl_->numShaderParameterUpdates_;
+        impl_->bytesUploaded_ += sizeof(Vector3);
+    }
+
+    void Graphics::SetShaderParameter(StringHash param, const Matrix4& matrix)
+    {
+        if (!impl_->shaderProgram_)
+            return;
+
+        ++impl_->numShaderParameterUpdates_;
+        impl_->bytesUploaded_ += sizeof(Matrix4);
+    }
+
+    void Graphics::SetShaderParameter(StringHash param, const Vector4& vector)
+    {
+        if (!impl_->shaderProgram_)
+            return;
+
+        ++impl_->numShaderParameterUpdates_;
+        impl_->bytesUploaded_ += sizeof(Vector4);
+    }
+
+    void Graphics::SetShaderParameter(StringHash param, const Matrix3x4& matrix)
+    {
+        if (!impl_->shaderProgram_)
+            return;
+
+        ++impl_->numShaderParameterUpdates_;
+        impl_->bytesUploaded_ += sizeof(Matrix3x4);
+    }
+
+    bool Graphics::NeedParameterUpdate(ShaderParameterGroup group, const void* source)
+    {
+        if ((unsigned)(size_t)shaderParameterSources_[group] == M_MAX_UNSIGNED || shaderParameterSources_[group] != source)
+        {
+            shaderParameterSources_[group] = source;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool Graphics::HasShaderParameter(StringHash param)
+    {
+        // Shaders are not reflected, so assume that every parameter is used
+        return impl_->shaderProgram_ != nullptr;
+    }
+
+    bool Graphics::HasTextureUnit(TextureUnit unit)
+    {
+        return (vertexShader_ && vertexShader_->HasTextureUnit(unit)) || (pixelShader_ && pixelShader_->HasTextureUnit(unit));
+    }
+
+    void Graphics::ClearParameterSource(ShaderParameterGroup group)
+    {
+        shaderParameterSources_[group] = (const void*)M_MAX_UNSIGNED;
+    }
+
+    void Graphics::ClearParameterSources()
+    {
+        for (unsigned i = 0; i < MAX_SHADER_PARAMETER_GROUPS; ++i)
+            shaderParameterSources_[i] = (const void*)M_MAX_UNSIGNED;
+    }
+
+    void Graphics::ClearTransformSources()
+    {
+        shaderParameterSources_[SP_CAMERA] = (const void*)M_MAX_UNSIGNED;
+        shaderParameterSources_[SP_OBJECT] = (const void*)M_MAX_UNSIGNED;
+    }
+
+    void Graphics::SetTexture(unsigned index, Texture* texture)
+    {
+        if (index >= MAX_TEXTURE_UNITS)
+            return;
+
+        // Check if texture is currently bound as a rendertarget. In that case, use its backup texture, or blank if not defined
+        if (texture)
+        {
+            if (renderTargets_[0] && renderTargets_[0]->GetParentTexture() == texture)
+                texture = texture->GetBackupTexture();
+            else
+            {
+                // Resolve multisampled texture now as necessary
+                if (texture->GetMultiSample() > 1 && texture->GetAutoResolve() && texture->IsResolveDirty())
+                {
+                    if (texture->GetType() == Texture2D::GetTypeStatic())
+                        ResolveToTexture(static_cast<Texture2D*>(texture));
+                    if (texture->GetType() == TextureCube::GetTypeStatic())
+                        ResolveToTexture(static_cast<TextureCube*>(texture));
+                }
+            }
+
+            if (texture && texture->GetLevelsDirty())
+                texture->RegenerateLevels();
+        }
+
+        if (texture && texture->GetParametersDirty())
+        {
+            texture->UpdateParameters();
+            textures_[index] = nullptr; // Force reassign
+        }
+
+        if (texture != textures_[index])
+        {
+            if (impl_->firstDirtyTexture_ == M_MAX_UNSIGNED)
+                impl_->firstDirtyTexture_ = impl_->lastDirtyTexture_ = index;
+            else
+            {
+                if (index < impl_->firstDirtyTexture_)
+                    impl_->firstDirtyTexture_ = index;
+                if (index > impl_->lastDirtyTexture_)
+                    impl_->lastDirtyTexture_ = index;
+            }
+
+            textures_[index] = texture;
+            impl_->texturesDirty_ = true;
+        }
+    }
+
+    void Graphics::SetDefaultTextureFilterMode(TextureFilterMode mode)
+    {
+        if (mode != defaultTextureFilterMode_)
+        {
+            defaultTextureFilterMode_ = mode;
+            SetTextureParametersDirty();
+        }
+    }
+
+    void Graphics::SetDefaultTextureAnisotropy(unsigned level)
+    {
+        level = Max(level, 1U);
+
+        if (level != defaultTextureAnisotropy_)
+        {
+            defaultTextureAnisotropy_ = level;
+            SetTextureParametersDirty();
+        }
+    }
+
+    void Graphics::Restore()
+    {
+        // No-op on the null backend
+    }
+
+    void Graphics::SetTextureParametersDirty()
+    {
+        std::lock_guard<std::mutex> lock(gpuObjectMutex_);
+
+        for (GPUObject* object : gpuObjects)
+        {
+            Texture* texture = dynamic_cast<Texture*>(object);
+            if (texture)
+                texture->SetParametersDirty();
+        }
+    }
+
+    void Graphics::ResetRenderTargets()
+    {
+        for (unsigned i = 0; i < kMaxColorAttachments; ++i)
+            SetRenderTarget(i, (RenderSurface*)nullptr);
+        SetDepthStencil((RenderSurface*)nullptr);
+        SetViewport(IntRect(0, 0, width_, height_));
+    }
+
+    void Graphics::ResetRenderTarget(unsigned index)
+    {
+        SetRenderTarget(index, (RenderSurface*)nullptr);
+    }
+
+    void Graphics::ResetDepthStencil()
+    {
+        SetDepthStencil((RenderSurface*)nullptr);
+    }
+
+    void Graphics::SetRenderTarget(unsigned index, RenderSurface* renderTarget)
+    {
+        if (index >= kMaxColorAttachments)
+            return;
+
+        if (renderTarget != renderTargets_[index])
+        {
+            renderTargets_[index] = renderTarget;
+            impl_->renderTargetsDirty_ = true;
+
+            // If the rendertarget is also bound as a texture, replace with backup texture or null
+            if (renderTarget)
+            {
+                Texture* parentTexture = renderTarget->GetParentTexture();
+
+                for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
+                {
+                    if (textures_[i] == parentTexture)
+                        SetTexture(i, textures_[i]->GetBackupTexture());
+                }
+
+                // If multisampled, mark the texture & surface needing resolve
+                if (parentTexture->GetMultiSample() > 1 && parentTexture->GetAutoResolve())
+                {
+                    parentTexture->SetResolveDirty(true);
+                    renderTarget->SetResolveDirty(true);
+                }
+
+                // If mipmapped, mark the levels needing regeneration
+                if (parentTexture->GetLevels() > 1)
+                    parentTexture->SetLevelsDirty();
+            }
+        }
+    }
+
+    void Graphics::SetRenderTarget(unsigned index, Texture2D* texture)
+    {
+        RenderSurface* renderTarget = nullptr;
+        if (texture)
+            renderTarget = texture->GetRenderSurface();
+
+        SetRenderTarget(index, renderTarget);
+    }
+
+    void Graphics::SetDepthStencil(RenderSurface* depthStencil)
+    {
+        if (depthStencil != depthStencil_)
+        {
+            depthStencil_ = depthStencil;
+            impl_->renderTargetsDirty_ = true;
+        }
+    }
+
+    void Graphics::SetDepthStencil(Texture2D* texture)
+    {
+        RenderSurface* depthStencil = nullptr;
+        if (texture)
+            depthStencil = texture->GetRenderSurface();
+
+        SetDepthStencil(depthStencil);
+        // Constant depth bias depends on the bitdepth
+        impl_->rasterizerStateDirty_ = true;
+    }
+
+    void Graphics::SetViewport(const IntRect& rect)
+    {
+        IntVector2 size = GetRenderTargetDimensions();
+
+        IntRect rectCopy = rect;
+
+        if (rectCopy.right_ <= rectCopy.left_)
+            rectCopy.right_ = rectCopy.left_ + 1;
+        if (rectCopy.bottom_ <= rectCopy.top_)
+            rectCopy.bottom_ = rectCopy.top_ + 1;
+        rectCopy.left_ = Clamp(rectCopy.left_, 0, size.x);
+        rectCopy.top_ = Clamp(rectCopy.top_, 0, size.y);
+        rectCopy.right_ = Clamp(rectCopy.right_, 0, size.x);
+        rectCopy.bottom_ = Clamp(rectCopy.bottom_, 0, size.y);
+
+        // Direct3D11 sets the viewport unconditionally, so count every call
+        ++impl_->numStateChanges_;
+
+        viewport_ = rectCopy;
+
+        // Disable scissor test, needs to be re-enabled by the user
+        SetScissorTest(false);
+    }
+
+    void Graphics::SetBlendMode(BlendMode mode, bool alphaToCoverage)
+    {
+        if (mode != blendMode_ || alphaToCoverage != alphaToCoverage_)
+        {
+            blendMode_ = mode;
+            alphaToCoverage_ = alphaToCoverage;
+            impl_->blendStateDirty_ = true;
+        }
+    }
+
+    void Graphics::SetColorWrite(bool enable)
+    {
+        if (enable != colorWrite_)
+        {
+            colorWrite_ = enable;
+            impl_->blendStateDirty_ = true;
+        }
+    }
+
+    void Graphics::SetCullMode(CullMode mode)
+    {
+        if (mode != cullMode_)
+        {
+            cullMode_ = mode;
+            impl_->rasterizerStateDirty_ = true;
+        }
+    }
+
+    void Graphics::SetDepthBias(float constantBias, float slopeScaledBias)
+    {
+        if (constantBias != constantDepthBias_ || slopeScaledBias != slopeScaledDepthBias_)
+        {
+            constantDepthBias_ = constantBias;
+            slopeScaledDepthBias_ = slopeScaledBias;
+            impl_->rasterizerStateDirty_ = true;
+        }
+    }
+
+    void Graphics::SetDepthTest(CompareMode mode)
+    {
+        if (mode != depthTestMode_)
+        {
+            depthTestMode_ = mode;
+            impl_->depthStateDirty_ = true;
+        }
+    }
+
+    void Graphics::SetDepthWrite(bool enable)
+    {
+        if (enable != depthWrite_)
+        {
+            depthWrite_ = enable;
+            impl_->depthStateDirty_ = true;
+            // Also affects whether a read-only version of depth-stencil should be bound, to allow sampling
+            impl_->renderTargetsDirty_ = true;
+        }
+    }
+
+    void Graphics::SetFillMode(FillMode mode)
+    {
+        if (mode != fillMode_)
+        {
+            fillMode_ = mode;
+            impl_->rasterizerStateDirty_ = true;
+        }
+    }
+
+    void Graphics::SetLineAntiAlias(bool enable)
+    {
+        if (enable != lineAntiAlias_)
+        {
+            lineAntiAlias_ = enable;
+            impl_->rasterizerStateDirty_ = true;
+        }
+    }
+
+    void Graphics::SetScissorTest(bool enable, const Rect& rect, bool borderInclusive)
+    {
+        // During some light rendering loops, a full rect is toggled on/off repeatedly.
+        // Disable scissor in that case to reduce state changes
+        if (rect.min_.x_ <= 0.0f && rect.min_.y_ <= 0.0f && rect.max_.x_ >= 1.0f && rect.max_.y_ >= 1.0f)
+            enable = false;
+
+        if (enable)
+        {
+            IntVector2 rtSize(GetRenderTargetDimensions());
+            IntVector2 viewSize(viewport_.Size());
+            IntVector2 viewPos(viewport_.left_, viewport_.top_);
+            IntRect intRect;
+            int expand = borderInclusive ? 1 : 0;
+
+            intRect.left_ = Clamp((int)((rect.min_.x_ + 1.0f) * 0.5f * viewSize.x) + viewPos.x, 0, rtSize.x - 1);
+            intRect.top_ = Clamp((int)((-rect.max_.y_ + 1.0f) * 0.5f * viewSize.y) + viewPos.y, 0, rtSize.y - 1);
+            intRect.right_ = Clamp((int)((rect.max_.x_ + 1.0f) * 0.5f * viewSize.x) + viewPos.x + expand, 0, rtSize.x);
+            intRect.bottom_ = Clamp((int)((-rect.min_.y_ + 1.0f) * 0.5f * viewSize.y) + viewPos.y + expand, 0, rtSize.y);
+
+            if (intRect.right_ == intRect.left_)
+                intRect.right_++;
+            if (intRect.bottom_ == intRect.top_)
+                intRect.bottom_++;
+
+            if (intRect.right_ < intRect.left_ || intRect.bottom_ < intRect.top_)
+                enable = false;
+
+            if (enable && intRect != scissorRect_)
+            {
+                scissorRect_ = intRect;
+                impl_->scissorRectDirty_ = true;
+            }
+        }
+
+        if (enable != scissorTest_)
+        {
+            scissorTest_ = enable;
+            impl_->rasterizerStateDirty_ = true;
+        }
+    }
+
+    void Graphics::SetScissorTest(bool enable, const IntRect& rect)
+    {
+        IntVector2 rtSize(GetRenderTargetDimensions());
+        IntVector2 viewPos(viewport_.left_, viewport_.top_);
+
+        if (enable)
+        {
+            IntRect intRect;
+            intRect.left_ = Clamp(rect.left_ + viewPos.x, 0, rtSize.x - 1);
+            intRect.top_ = Clamp(rect.top_ + viewPos.y, 0, rtSize.y - 1);
+            intRect.right_ = Clamp(rect.right_ + viewPos.x, 0, rtSize.x);
+            intRect.bottom_ = Clamp(rect.bottom_ + viewPos.y, 0, rtSize.y);
+
+            if (intRect.right_ == intRect.left_)
+                intRect.right_++;
+            if (intRect.bottom_ == intRect.top_)
+                intRect.bottom_++;
+
+            if (intRect.right_ < intRect.left_ || intRect.bottom_ < intRect.top_)
+                enable = false;
+
+            if (enable && intRect != scissorRect_)
+            {
+                scissorRect_ = intRect;
+                impl_->scissorRectDirty_ = true;
+            }
+        }
+
+        if (enable != scissorTest_)
+        {
+            scissorTest_ = enable;
+            impl_->rasterizerStateDirty_ = true;
+        }
+    }
+
+    void Graphics::SetStencilTest(bool enable, CompareMode mode, StencilOp pass, StencilOp fail, StencilOp zFail, unsigned stencilRef,
+        unsigned compareMask, unsigned writeMask)
+    {
+        if (enable != stencilTest_)
+        {
+            stencilTest_ = enable;
+            impl_->depthStateDirty_ = true;
+        }
+
+        if (enable)
+        {
+            if (mode != stencilTestMode_)
+            {
+                stencilTestMode_ = mode;
+                impl_->depthStateDirty_ = true;
+            }
+            if (pass != stencilPass_)
+            {
+                stencilPass_ = pass;
+                impl_->depthStateDirty_ = true;
+            }
+            if (fail != stencilFail_)
+            {
+                stencilFail_ = fail;
+                impl_->depthStateDirty_ = true;
+            }
+            if (zFail != stencilZFail_)
+            {
+                stencilZFail_ = zFail;
+                impl_->depthStateDirty_ = true;
+            }
+            if (compareMask != stencilCompareMask_)
+            {
+                stencilCompareMask_ = compareMask;
+                impl_->depthStateDirty_ = true;
+            }
+            if (writeMask != stencilWriteMask_)
+            {
+                stencilWriteMask_ = writeMask;
+                impl_->depthStateDirty_ = true;
+            }
+            if (stencilRef != stencilRef_)
+            {
+                stencilRef_ = stencilRef;
+                impl_->stencilRefDirty_ = true;
+                impl_->depthStateDirty_ = true;
+            }
+        }
+    }
+
+    void Graphics::SetClipPlane(bool enable, const Plane& clipPlane, const Matrix3x4& view, const Matrix4& projection)
+    {
+        useClipPlane_ = enable;
+
+        if (enable)
+        {
+            Matrix4 viewProj = projection * view;
+            clipPlane_ = clipPlane.Transformed(viewProj).ToVector4();
+            SetShaderParameter(VSP_CLIPPLANE, clipPlane_);
+        }
+    }
+
+    bool Graphics::IsInitialized() const
+    {
+        return impl_->deviceCreated_;
+    }
+
+    PODVector<int> Graphics::GetMultiSampleLevels() const
+    {
+        PODVector<int> ret;
+        for (int i = 1; i <= 16; i *= 2)
+            ret.Push(i);
+
+        return ret;
+    }
+
+    unsigned Graphics::GetFormat(CompressedFormat format) const
+    {
+        switch (format)
+        {
+            case CF_RGBA:
+                return NULLFMT_RGBA8;
+
+            case CF_DXT1:
+                return NULLFMT_BC1;
+
+            case CF_DXT3:
+                return NULLFMT_BC2;
+
+            case CF_DXT5:
+                return NULLFMT_BC3;
+
+            default:
+                return 0;
+        }
+    }
+
+    ShaderVariation* Graphics::GetShader(ShaderType type, const String& name, const String& defines) const
+    {
+        return GetShader(type, name.CString(), defines.CString());
+    }
+
+    ShaderVariation* Graphics::GetShader(ShaderType type, const char* name, const char* defines) const
+    {
+        if (lastShaderName_ != name || !lastShader_)
+        {
+            ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+            String fullShaderName = shaderPath_ + name + shaderExtension_;
+            // Try to reduce repeated error log prints because of missing shaders
+            if (lastShaderName_ == name && !cache->Exists(fullShaderName))
+                return nullptr;
+
+            lastShader_ = cache->GetResource<Shader>(fullShaderName);
+            lastShaderName_ = name;
+        }
+
+        return lastShader_ ? lastShader_->GetVariation(type, defines) : nullptr;
+    }
+
+    VertexBuffer* Graphics::GetVertexBuffer(unsigned index) const
+    {
+        return index < kMaxVertexBufferBindings ? vertexBuffers_[index] : nullptr;
+    }
+
+    ShaderProgram* Graphics::GetShaderProgram() const
+    {
+        return impl_->shaderProgram_;
+    }
+
+    TextureUnit Graphics::GetTextureUnit(const String& name)
+    {
+        auto it = textureUnits_.find(name);
+        if (it != textureUnits_.end())
+            return it->second;
+
+        return MAX_TEXTURE_UNITS;
+    }
+
+    const String& Graphics::GetTextureUnitName(TextureUnit unit)
+    {
+        for (auto i = textureUnits_.begin(); i != textureUnits_.end(); ++i)
+        {
+            if (i->second == unit)
+                return i->first;
+        }
+
+        return String::EMPTY;
+    }
+
+    Texture* Graphics::GetTexture(unsigned index) const
+    {
+        return index < MAX_TEXTURE_UNITS ? textures_[index] : nullptr;
+    }
+
+    RenderSurface* Graphics::GetRenderTarget(unsigned index) const
+    {
+        return index < kMaxColorAttachments ? renderTargets_[index] : nullptr;
+    }
+
+    IntVector2 Graphics::GetRenderTargetDimensions() const
+    {
+        int width, height;
+
+        if (renderTargets_[0])
+        {
+            width = renderTargets_[0]->GetWidth();
+            height = renderTargets_[0]->GetHeight();
+        }
+        else if (depthStencil_) // Depth-only rendering
+        {
+            width = depthStencil_->GetWidth();
+            height = depthStencil_->GetHeight();
+        }
+        else
+        {
+            width = width_;
+            height = height_;
+        }
+
+        return IntVector2(width, height);
+    }
+
+    bool Graphics::IsDeviceLost() const
+    {
+        return false;
+    }
+
+    void Graphics::OnWindowResized()
+    {
+        // No-op on the null backend, as there is no window
+    }
+
+    void Graphics::OnWindowMoved()
+    {
+        // No-op on the null backend, as there is no window
+    }
+
+    void Graphics::CleanupShaderPrograms(ShaderVariation* variation)
+    {
+        for (ShaderProgramMap::iterator i = impl_->shaderPrograms_.begin(); i != impl_->shaderPrograms_.end();)
+        {
+            if (i->first.first == variation || i->first.second == variation)
+                i = impl_->shaderPrograms_.erase(i);
+            else
+                ++i;
+        }
+
+        if (vertexShader_ == variation || pixelShader_ == variation)
+            impl_->shaderProgram_ = nullptr;
+    }
+
+    void Graphics::CleanupRenderSurface(RenderSurface* surface)
+    {
+        // No-op on the null backend
+    }
+
+    void Graphics::LoadShaderProgramCache()
+    {
+        // No-op on the null backend
+    }
+
+    void Graphics::SaveShaderProgramCache()
+    {
+        // No-op on the null backend
+    }
+
+    ConstantBuffer* Graphics::GetOrCreateConstantBuffer(ShaderType type, unsigned index, unsigned size)
+    {
+        // Ensure that different shader types and index slots get unique buffers, even if the size is same
+        size_t key = type;
+        HashCombine(key, index);
+        HashCombine(key, size);
+        ConstantBufferMap::iterator i = impl_->allConstantBuffers_.find(key);
+        if (i != impl_->allConstantBuffers_.end())
+            return i->second.Get();
+        else
+        {
+            SharedPtr<ConstantBuffer> newConstantBuffer(new ConstantBuffer(context_));
+            newConstantBuffer->SetSize(size);
+            impl_->allConstantBuffers_[key] = newConstantBuffer;
+            return newConstantBuffer.Get();
+        }
+    }
+
+    unsigned Graphics::GetAlphaFormat()
+    {
+        return NULLFMT_A8;
+    }
+
+    unsigned Graphics::GetLuminanceFormat()
+    {
+        return NULLFMT_R8;
+    }
+
+    unsigned Graphics::GetLuminanceAlphaFormat()
+    {
+        return NULLFMT_RG8;
+    }
+
+    unsigned Graphics::GetRGBFormat()
+    {
+        return NULLFMT_RGBA8;
+    }
+
+    unsigned Graphics::GetRGBAFormat()
+    {
+        return NULLFMT_RGBA8;
+    }
+
+    unsigned Graphics::GetRGBA16Format()
+    {
+        return NULLFMT_RGBA16;
+    }
+
+    unsigned Graphics::GetRGBAFloat16Format()
+    {
+        return NULLFMT_RGBA16F;
+    }
+
+    unsigned Graphics::GetRGBAFloat32Format()
+    {
+        return NULLFMT_RGBA32F;
+    }
+
+    unsigned Graphics::GetRG16Format()
+    {
+        return NULLFMT_RG16;
+    }
+
+    unsigned Graphics::GetRGFloat16Format()
+    {
+        return NULLFMT_RG16F;
+    }
+
+    unsigned Graphics::GetRGFloat32Format()
+    {
+        return NULLFMT_RG32F;
+    }
+
+    unsigned Graphics::GetFloat16Format()
+    {
+        return NULLFMT_R16F;
+    }
+
+    unsigned Graphics::GetFloat32Format()
+    {
+        return NULLFMT_R32F;
+    }
+
+    unsigned Graphics::GetLinearDepthFormat()
+    {
+        return NULLFMT_R32F;
+    }
+
+    unsigned Graphics::GetDepthStencilFormat()
+    {
+        return NULLFMT_D24S8;
+    }
+
+    unsigned Graphics::GetReadableDepthFormat()
+    {
+        return NULLFMT_D24S8;
+    }
+
+    unsigned Graphics::GetFormat(const String& formatName)
+    {
+        String nameLower = formatName.ToLower().Trimmed();
+
+        if (nameLower == "a")
+            return GetAlphaFormat();
+        if (nameLower == "l")
+            return GetLuminanceFormat();
+        if (nameLower == "la")
+            return GetLuminanceAlphaFormat();
+        if (nameLower == "rgb")
+            return GetRGBFormat();
+        if (nameLower == "rgba")
+            return GetRGBAFormat();
+        if (nameLower == "rgba16")
+            return GetRGBA16Format();
+        if (nameLower == "rgba16f")
+            return GetRGBAFloat16Format();
+        if (nameLower == "rgba32f")
+            return GetRGBAFloat32Format();
+        if (nameLower == "rg16")
+            return GetRG16Format();
+        if (nameLower == "rg16f")
+            return GetRGFloat16Format();
+        if (nameLower == "rg32f")
+            return GetRGFloat32Format();
+        if (nameLower == "r16f")
+            return GetFloat16Format();
+        if (nameLower == "r32f" || nameLower == "float")
+            return GetFloat32Format();
+        if (nameLower == "lineardepth" || nameLower == "depth")
+            return GetLinearDepthFormat();
+        if (nameLower == "d24s8")
+            return GetDepthStencilFormat();
+        if (nameLower == "readabledepth" || nameLower == "hwdepth")
+            return GetReadableDepthFormat();
+
+        return GetRGBFormat();
+    }
+
+    uint32_t Graphics::GetMaxBones()
+    {
+        return 128;
+    }
+
+    bool Graphics::OpenWindow(int width, int height, bool resizable, bool borderless)
+    {
+        // No window on the null backend
+        return true;
+    }
+
+    void Graphics::AdjustWindow(int& newWidth, int& newHeight, bool& newFullscreen, bool& newBorderless, int& monitor)
+    {
+        // No window on the null backend
+    }
+
+    bool Graphics::CreateDevice(int width, int height)
+    {
+        if (!impl_->deviceCreated_)
+        {
+            impl_->deviceCreated_ = true;
+            CheckFeatureSupport();
+            URHO3D_LOGINFO("Created null graphics device");
+        }
+
+        return true;
+    }
+
+    bool Graphics::UpdateSwapChain(int width, int height)
+    {
+        impl_->renderTargetsDirty_ = true;
+
+        // Update internally held backbuffer size
+        width_ = width;
+        height_ = height;
+
+        ResetRenderTargets();
+        return true;
+    }
+
+    void Graphics::CheckFeatureSupport()
+    {
+        anisotropySupport_ = true;
+        dxtTextureSupport_ = true;
+        lightPrepassSupport_ = true;
+        deferredSupport_ = true;
+        hardwareShadowSupport_ = true;
+        shadowMapFormat_ = NULLFMT_D16;
+        hiresShadowMapFormat_ = NULLFMT_D32;
+        dummyColorFormat_ = NULLFMT_UNKNOWN;
+        sRGBSupport_ = true;
+        sRGBWriteSupport_ = true;
+    }
+
+    void Graphics::ResetCachedState()
+    {
+        for (uint32_t i = 0; i < kMaxVertexBufferBindings; ++i)
+        {
+            vertexBuffers_[i] = nullptr;
+            impl_->vertexOffsets_[i] = 0;
+        }
+
+        for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
+            textures_[i] = nullptr;
+
+        for (unsigned i = 0; i < kMaxColorAttachments; ++i)
+            renderTargets_[i] = nullptr;
+
+        depthStencil_ = nullptr;
+        viewport_ = IntRect(0, 0, width_, height_);
+
+        indexBuffer_ = nullptr;
+        vertexDeclarationHash_ = 0;
+        primitiveType_ = 0;
+        vertexShader_ = nullptr;
+        pixelShader_ = nullptr;
+        blendMode_ = BLEND_REPLACE;
+        alphaToCoverage_ = false;
+        colorWrite_ = true;
+        cullMode_ = CullMode::CounterClockwise;
+        constantDepthBias_ = 0.0f;
+        slopeScaledDepthBias_ = 0.0f;
+        depthTestMode_ = CMP_LESSEQUAL;
+        depthWrite_ = true;
+        fillMode_ = FillMode::Solid;
+        lineAntiAlias_ = false;
+        scissorTest_ = false;
+        scissorRect_ = IntRect::ZERO;
+        stencilTest_ = false;
+        stencilTestMode_ = CMP_ALWAYS;
+        stencilPass_ = OP_KEEP;
+        stencilFail_ = OP_KEEP;
+        stencilZFail_ = OP_KEEP;
+        stencilRef_ = 0;
+        stencilCompareMask_ = M_MAX_UNSIGNED;
+        stencilWriteMask_ = M_MAX_UNSIGNED;
+        useClipPlane_ = false;
+        impl_->shaderProgram_ = nullptr;
+        impl_->renderTargetsDirty_ = true;
+        impl_->texturesDirty_ = true;
+        impl_->vertexDeclarationDirty_ = true;
+        impl_->blendStateDirty_ = true;
+        impl_->depthStateDirty_ = true;
+        impl_->rasterizerStateDirty_ = true;
+        impl_->scissorRectDirty_ = true;
+        impl_->stencilRefDirty_ = true;
+        impl_->blendStateHash_ = M_MAX_UNSIGNED;
+        impl_->depthStateHash_ = M_MAX_UNSIGNED;
+        impl_->rasterizerStateHash_ = M_MAX_UNSIGNED;
+        impl_->firstDirtyTexture_ = impl_->lastDirtyTexture_ = M_MAX_UNSIGNED;
+    }
+
+    void Graphics::PrepareDraw()
+    {
+        // Resolve dirty state the same way as the Direct3D11 backend, and count the device calls it would make
+        if (impl_->renderTargetsDirty_)
+        {
+            ++impl_->numStateChanges_;
+            impl_->renderTargetsDirty_ = false;
+        }
+
+        if (impl_->texturesDirty_ && impl_->firstDirtyTexture_ < M_MAX_UNSIGNED)
+        {
+            ++impl_->numStateChanges_;
+            impl_->firstDirtyTexture_ = impl_->lastDirtyTexture_ = M_MAX_UNSIGNED;
+            impl_->texturesDirty_ = false;
+        }
+
+        if (impl_->vertexDeclarationDirty_ && vertexShader_)
+        {
+            size_t newVertexDeclarationHash = 0;
+            for (uint32_t i = 0; i < kMaxVertexBufferBindings; ++i)
+            {
+                if (vertexBuffers_[i])
+                    HashCombine(newVertexDeclarationHash, vertexBuffers_[i]->GetBufferHash(i));
+            }
+
+            if (newVertexDeclarationHash)
+            {
+                HashCombine(newVertexDeclarationHash, vertexShader_);
+                if (newVertexDeclarationHash != vertexDeclarationHash_)
+                {
+                    vertexDeclarationHash_ = newVertexDeclarationHash;
+                    ++impl_->numStateChanges_;
+                }
+            }
+
+            impl_->vertexDeclarationDirty_ = false;
+        }
+
+        if (impl_->blendStateDirty_)
+        {
+            size_t newBlendStateHash = 0;
+            HashCombine(newBlendStateHash, colorWrite_);
+            HashCombine(newBlendStateHash, alphaToCoverage_);
+            HashCombine(newBlendStateHash, static_cast<uint32_t>(blendMode_));
+            if (newBlendStateHash != impl_->blendStateHash_)
+            {
+                impl_->blendStateHash_ = newBlendStateHash;
+                ++impl_->numStateChanges_;
+            }
+
+            impl_->blendStateDirty_ = false;
+        }
+
+        if (impl_->depthStateDirty_)
+        {
+            size_t newDepthStateHash = 0;
+            HashCombine(newDepthStateHash, depthWrite_);
+            HashCombine(newDepthStateHash, stencilTest_);
+            HashCombine(newDepthStateHash, depthTestMode_);
+            HashCombine(newDepthStateHash, stencilCompareMask_ & 0xff);
+            HashCombine(newDepthStateHash, stencilWriteMask_ & 0xff);
+            HashCombine(newDepthStateHash, stencilTestMode_);
+            HashCombine(newDepthStateHash, stencilFail_);
+            HashCombine(newDepthStateHash, stencilZFail_);
+            HashCombine(newDepthStateHash, stencilPass_);
+            if (newDepthStateHash != impl_->depthStateHash_ || impl_->stencilRefDirty_)
+            {
+                impl_->depthStateHash_ = newDepthStateHash;
+                ++impl_->numStateChanges_;
+            }
+
+            impl_->depthStateDirty_ = false;
+            impl_->stencilRefDirty_ = false;
+        }
+
+        if (impl_->rasterizerStateDirty_)
+        {
+            unsigned depthBits = 24;
+            if (depthStencil_ && depthStencil_->GetParentTexture()->GetFormat() == NULLFMT_D16)
+                depthBits = 16;
+            int scaledDepthBias = (int)(constantDepthBias_ * (1 << depthBits));
+
+            size_t newRasterizerStateHash = 0;
+            HashCombine(newRasterizerStateHash, scissorTest_);
+            HashCombine(newRasterizerStateHash, lineAntiAlias_);
+            HashCombine(newRasterizerStateHash, (uint32_t)fillMode_);
+            HashCombine(newRasterizerStateHash, (uint32_t)cullMode_);
+            HashCombine(newRasterizerStateHash, scaledDepthBias & 0x1fff);
+            HashCombine(newRasterizerStateHash, ((int)(slopeScaledDepthBias_ * 100.0f) & 0x1fff));
+            if (newRasterizerStateHash != impl_->rasterizerStateHash_)
+            {
+                impl_->rasterizerStateHash_ = newRasterizerStateHash;
+                ++impl_->numStateChanges_;
+            }
+
+            impl_->rasterizerStateDirty_ = false;
+        }
+
+        if (impl_->scissorRectDirty_)
+        {
+            ++impl_->numStateChanges_;
+            impl_->scissorRectDirty_ = false;
+        }
+    }
+
+    void Graphics::SetTextureUnitMappings()
+    {
+        textureUnits_["DiffMap"] = TU_DIFFUSE;
+        textureUnits_["DiffCubeMap"] = TU_DIFFUSE;
+        textureUnits_["NormalMap"] = TU_NORMAL;
+        textureUnits_["SpecMap"] = TU_SPECULAR;
+        textureUnits_["EmissiveMap"] = TU_EMISSIVE;
+        textureUnits_["EnvMap"] = TU_ENVIRONMENT;
+        textureUnits_["EnvCubeMap"] = TU_ENVIRONMENT;
+        textureUnits_["LightRampMap"] = TU_LIGHTRAMP;
+        textureUnits_["LightSpotMap"] = TU_LIGHTSHAPE;
+        textureUnits_["LightCubeMap"] = TU_LIGHTSHAPE;
+        textureUnits_["ShadowMap"] = TU_SHADOWMAP;
+        textureUnits_["FaceSelectCubeMap"] = TU_FACESELECT;
+        textureUnits_["IndirectionCubeMap"] = TU_INDIRECTION;
+        textureUnits_["LightClusterMap"] = TU_LIGHTCLUSTERS;
+        textureUnits_["LightDataMap"] = TU_LIGHTDATA;
+        textureUnits_["VolumeMap"] = TU_VOLUMEMAP;
+        textureUnits_["ZoneCubeMap"] = TU_ZONE;
+        textureUnits_["ZoneVolumeMap"] = TU_ZONE;
+    }
+}
@@ -0,0 +1,139 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../../Graphics/ConstantBuffer.h"
+#include "../../Graphics/GraphicsDefs.h"
+#include "../../Graphics/ShaderProgram.h"
+
+#include <unordered_map>
+
+namespace Urho3D
+{
+
+using ShaderProgramMap = std::unordered_map<std::pair<ShaderVariation*, ShaderVariation*>, SharedPtr<ShaderProgram> >;
+using ConstantBufferMap = std::unordered_map<size_t, SharedPtr<ConstantBuffer> >;
+
+/// Texture formats of the null graphics backend. Only used to calculate data sizes.
+enum NullTextureFormat : unsigned
+{
+    NULLFMT_UNKNOWN = 0,
+    NULLFMT_A8,
+    NULLFMT_R8,
+    NULLFMT_RG8,
+    NULLFMT_RGBA8,
+    NULLFMT_RGBA8_SRGB,
+    NULLFMT_RGBA16,
+    NULLFMT_RGBA16F,
+    NULLFMT_RGBA32F,
+    NULLFMT_RG16,
+    NULLFMT_RG16F,
+    NULLFMT_RG32F,
+    NULLFMT_R16F,
+    NULLFMT_R32F,
+    NULLFMT_D16,
+    NULLFMT_D24S8,
+    NULLFMT_D32,
+    NULLFMT_BC1,
+    NULLFMT_BC1_SRGB,
+    NULLFMT_BC2,
+    NULLFMT_BC2_SRGB,
+    NULLFMT_BC3,
+    NULLFMT_BC3_SRGB
+};
+
+/// %Graphics implementation for the null backend. Accepts all resources and draw calls without a GPU and counts the work the renderer submits.
+class URHO3D_API GraphicsImpl
+{
+    friend class Graphics;
+
+public:
+    /// Construct.
+    GraphicsImpl();
+
+    /// Return number of draw calls since the counters were reset.
+    unsigned GetNumDraws() const { return numDraws_; }
+    /// Return number of primitives drawn since the counters were reset.
+    unsigned GetNumPrimitives() const { return numPrimitives_; }
+    /// Return number of state changes a real device would have received since the counters were reset.
+    unsigned GetNumStateChanges() const { return numStateChanges_; }
+    /// Return number of shader parameter updates since the counters were reset.
+    unsigned GetNumShaderParameterUpdates() const { return numShaderParameterUpdates_; }
+    /// Return bytes of buffer, texture and shader parameter data uploaded since the counters were reset.
+    unsigned long long GetBytesUploaded() const { return bytesUploaded_; }
+    /// Reset the counters.
+    void ResetCounters();
+
+    /// Add uploaded data size to the counters. Called internally by the GPU objects.
+    void AddBytesUploaded(unsigned bytes) { bytesUploaded_ += bytes; }
+
+private:
+    /// Device created flag.
+    bool deviceCreated_;
+    /// Rendertargets dirty flag.
+    bool renderTargetsDirty_;
+    /// Textures dirty flag.
+    bool texturesDirty_;
+    /// Vertex declaration dirty flag.
+    bool vertexDeclarationDirty_;
+    /// Blend state dirty flag.
+    bool blendStateDirty_;
+    /// Depth state dirty flag.
+    bool depthStateDirty_;
+    /// Rasterizer state dirty flag.
+    bool rasterizerStateDirty_;
+    /// Scissor rect dirty flag.
+    bool scissorRectDirty_;
+    /// Stencil ref dirty flag.
+    bool stencilRefDirty_;
+    /// Hash of current blend state.
+    size_t blendStateHash_;
+    /// Hash of current depth state.
+    size_t depthStateHash_;
+    /// Hash of current rasterizer state.
+    size_t rasterizerStateHash_;
+    /// First dirtied texture unit.
+    unsigned firstDirtyTexture_;
+    /// Last dirtied texture unit.
+    unsigned lastDirtyTexture_;
+    /// Vertex buffer offsets per buffer.
+    unsigned vertexOffsets_[kMaxVertexBufferBindings];
+    /// Constant buffer search map.
+    ConstantBufferMap allConstantBuffers_;
+    /// Shader programs.
+    ShaderProgramMap shaderPrograms_;
+    /// Shader program in use.
+    ShaderProgram* shaderProgram_;
+    /// Draw call counter.
+    unsigned numDraws_;
+    /// Primitive counter.
+    unsigned numPrimitives_;
+    /// State change counter.
+    unsigned numStateChanges_;
+    /// Shader parameter update counter.
+    unsigned numShaderParameterUpdates_;
+    /// Uploaded bytes counter.
+    unsigned long long bytesUploaded_;
+};
+
+}
@@ -0,0 +1,228 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../../Precompiled.h"
+
+#include "../../Graphics/Graphics.h"
+#include "../../Graphics/GraphicsImpl.h"
+#include "../../Graphics/IndexBuffer.h"
+#include "../../IO/Log.h"
+
+#include "../../DebugNew.h"
+
+using namespace Urho3D;
+
+void IndexBuffer::OnDeviceLost()
+{
+    // No-op on the null backend
+}
+
+void IndexBuffer::OnDeviceReset()
+{
+    // No-op on the null backend
+}
+
+void IndexBuffer::Release()
+{
+    Unlock();
+
+    if (graphics_ && graphics_->GetIndexBuffer() == this)
+        graphics_->SetIndexBuffer(nullptr);
+
+    delete[] (unsigned char*)object_.ptr_;
+    object_.ptr_ = nullptr;
+}
+
+bool IndexBuffer::SetData(const void* data)
+{
+    if (!data)
+    {
+        URHO3D_LOGERROR("Null pointer for index buffer data");
+        return false;
+    }
+
+    if (!indexSize_)
+    {
+        URHO3D_LOGERROR("Index size not defined, can not set index buffer data");
+        return false;
+    }
+
+    if (shadowData_ && data != shadowData_.Get())
+        memcpy(shadowData_.Get(), data, indexCount_ * indexSize_);
+
+    if (object_.ptr_)
+    {
+        memcpy(object_.ptr_, data, indexCount_ * indexSize_);
+        graphics_->GetImpl()->AddBytesUploaded(indexCount_ * indexSize_);
+    }
+
+    return true;
+}
+
+bool IndexBuffer::SetDataRange(const void* data, unsigned start, unsigned count, bool discard)
+{
+    if (start == 0 && count == indexCount_)
+        return SetData(data);
+
+    if (!data)
+    {
+        URHO3D_LOGERROR("Null pointer for index buffer data");
+        return false;
+    }
+
+    if (!indexSize_)
+    {
+        URHO3D_LOGERROR("Index size not defined, can not set index buffer data");
+        return false;
+    }
+
+    if (start + count > indexCount_)
+    {
+        URHO3D_LOGERROR("Illegal range for setting new index buffer data");
+        return false;
+    }
+
+    if (!count)
+        return true;
+
+    if (shadowData_ && shadowData_.Get() + start * indexSize_ != data)
+        memcpy(shadowData_.Get() + start * indexSize_, data, count * indexSize_);
+
+    if (object_.ptr_)
+    {
+        memcpy((unsigned char*)object_.ptr_ + start * indexSize_, data, count * indexSize_);
+        graphics_->GetImpl()->AddBytesUploaded(count * indexSize_);
+    }
+
+    return true;
+}
+
+void* IndexBuffer::Lock(unsigned start, unsigned count, bool discard)
+{
+    if (lockState_ != LOCK_NONE)
+    {
+        URHO3D_LOGERROR("Index buffer already locked");
+        return nullptr;
+    }
+
+    if (!indexSize_)
+    {
+        URHO3D_LOGERROR("Index size not defined, can not lock index buffer");
+        return nullptr;
+    }
+
+    if (start + count > indexCount_)
+    {
+        URHO3D_LOGERROR("Illegal range for locking index buffer");
+        return nullptr;
+    }
+
+    if (!count)
+        return nullptr;
+
+    lockStart_ = start;
+    lockCount_ = count;
+
+    // Because shadow data must be kept in sync, can only lock hardware buffer if not shadowed
+    if (object_.ptr_ && !shadowData_ && dynamic_)
+        return MapBuffer(start, count, discard);
+    else if (shadowData_)
+    {
+        lockState_ = LOCK_SHADOW;
+        return shadowData_.Get() + start * indexSize_;
+    }
+    else if (graphics_)
+    {
+        lockState_ = LOCK_SCRATCH;
+        lockScratchData_ = graphics_->ReserveScratchBuffer(count * indexSize_);
+        return lockScratchData_;
+    }
+    else
+        return nullptr;
+}
+
+void IndexBuffer::Unlock()
+{
+    switch (lockState_)
+    {
+    case LOCK_HARDWARE:
+        UnmapBuffer();
+        break;
+
+    case LOCK_SHADOW:
+        SetDataRange(shadowData_.Get() + lockStart_ * indexSize_, lockStart_, lockCount_);
+        lockState_ = LOCK_NONE;
+        break;
+
+    case LOCK_SCRATCH:
+        SetDataRange(lockScratchData_, lockStart_, lockCount_);
+        if (graphics_)
+            graphics_->FreeScratchBuffer(lockScratchData_);
+        lockScratchData_ = nullptr;
+        lockState_ = LOCK_NONE;
+        break;
+
+    default: break;
+    }
+}
+
+bool IndexBuffer::Create()
+{
+    Release();
+
+    if (!indexCount_)
+        return true;
+
+    // Host memory stands in for the GPU buffer, so that mapping and uploads perform real copies
+    if (graphics_)
+        object_.ptr_ = new unsigned char[indexCount_ * indexSize_];
+
+    return true;
+}
+
+bool IndexBuffer::UpdateToGPU()
+{
+    if (object_.ptr_ && shadowData_)
+        return SetData(shadowData_.Get());
+
+    return false;
+}
+
+void* IndexBuffer::MapBuffer(unsigned start, unsigned count, bool discard)
+{
+    void* hwData = nullptr;
+
+    if (object_.ptr_)
+    {
+        hwData = (unsigned char*)object_.ptr_ + start * indexSize_;
+        graphics_->GetImpl()->AddBytesUploaded(count * indexSize_);
+        lockState_ = LOCK_HARDWARE;
+    }
+
+    return hwData;
+}
+
+void IndexBuffer::UnmapBuffer()
+{
+    if (object_.ptr_ && lockState_ == LOCK_HARDWARE)
+        lockState_ = LOCK_NONE;
+}
@@ -0,0 +1,117 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../../Precompiled.h"
+
+#include "../../Graphics/Graphics.h"
+#include "../../Graphics/GraphicsImpl.h"
+#include "../../Graphics/Shader.h"
+#include "../../IO/Log.h"
+
+#include "../../DebugNew.h"
+
+namespace Urho3D
+{
+
+void ShaderVariation::OnDeviceLost()
+{
+    // No-op on the null backend
+}
+
+bool ShaderVariation::Create()
+{
+    Release();
+
+    if (!Prepare())
+        return false;
+
+    // Shaders are neither compiled nor reflected. Use the variation itself as a placeholder handle, and assume that
+    // all texture units are sampled so that the renderer binds every texture it would bind on a real device
+    object_.ptr_ = this;
+    for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
+        useTextureUnits_[i] = true;
+
+    return true;
+}
+
+bool ShaderVariation::Prepare()
+{
+    // Nothing to prepare, as shaders are not compiled
+    if (!graphics_)
+        return false;
+
+    if (!owner_)
+    {
+        compilerOutput_ = "Owner shader has expired";
+        return false;
+    }
+
+    return true;
+}
+
+void ShaderVariation::Release()
+{
+    ReleasePrepared();
+
+    if (object_.ptr_)
+    {
+        if (!graphics_)
+            return;
+
+        graphics_->CleanupShaderPrograms(this);
+
+        if (type_ == VS)
+        {
+            if (graphics_->GetVertexShader() == this)
+                graphics_->SetShaders(nullptr, nullptr);
+        }
+        else
+        {
+            if (graphics_->GetPixelShader() == this)
+                graphics_->SetShaders(nullptr, nullptr);
+        }
+
+        object_.ptr_ = nullptr;
+    }
+
+    compilerOutput_.Clear();
+
+    for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
+        useTextureUnits_[i] = false;
+    for (unsigned i = 0; i < MAX_SHADER_PARAMETER_GROUPS; ++i)
+        constantBufferSizes_[i] = 0;
+    parameters_.Clear();
+    byteCode_.Clear();
+    elementHash_ = 0;
+}
+
+void ShaderVariation::SetDefines(const String& defines)
+{
+    defines_ = defines;
+
+    // Internal mechanism for appending the CLIPPLANE define, prevents runtime (every frame) string manipulation
+    definesClipPlane_ = defines;
+    if (!definesClipPlane_.EndsWith(" CLIPPLANE"))
+        definesClipPlane_ += " CLIPPLANE";
+}
+
+}
@@ -0,0 +1,146 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../../Precompiled.h"
+
+#include "../../Graphics/Graphics.h"
+#include "../../Graphics/GraphicsImpl.h"
+#include "../../Graphics/Material.h"
+#include "../../IO/Log.h"
+
+#include "../../DebugNew.h"
+
+namespace Urho3D
+{
+
+void Texture::SetSRGB(bool enable)
+{
+    if (graphics_)
+        enable &= graphics_->GetSRGBSupport();
+
+    if (enable != sRGB_)
+    {
+        sRGB_ = enable;
+        // If texture had already been created, must recreate it to set the sRGB texture format
+        if (object_.ptr_)
+            Create();
+    }
+}
+
+bool Texture::GetParametersDirty() const
+{
+    return parametersDirty_ || !sampler_;
+}
+
+bool Texture::IsCompressed() const
+{
+    return format_ == NULLFMT_BC1 || format_ == NULLFMT_BC2 || format_ == NULLFMT_BC3;
+}
+
+unsigned Texture::GetRowDataSize(int width) const
+{
+    switch (format_)
+    {
+    case NULLFMT_A8:
+    case NULLFMT_R8:
+        return (unsigned)width;
+
+    case NULLFMT_RG8:
+    case NULLFMT_R16F:
+    case NULLFMT_D16:
+        return (unsigned)(width * 2);
+
+    case NULLFMT_RGBA8:
+    case NULLFMT_RGBA8_SRGB:
+    case NULLFMT_RG16:
+    case NULLFMT_RG16F:
+    case NULLFMT_R32F:
+    case NULLFMT_D24S8:
+    case NULLFMT_D32:
+        return (unsigned)(width * 4);
+
+    case NULLFMT_RGBA16:
+    case NULLFMT_RGBA16F:
+    case NULLFMT_RG32F:
+        return (unsigned)(width * 8);
+
+    case NULLFMT_RGBA32F:
+        return (unsigned)(width * 16);
+
+    case NULLFMT_BC1:
+    case NULLFMT_BC1_SRGB:
+        return (unsigned)(((width + 3) >> 2) * 8);
+
+    case NULLFMT_BC2:
+    case NULLFMT_BC2_SRGB:
+    case NULLFMT_BC3:
+    case NULLFMT_BC3_SRGB:
+        return (unsigned)(((width + 3) >> 2) * 16);
+
+    default:
+        return 0;
+    }
+}
+
+void Texture::UpdateParameters()
+{
+    if ((!parametersDirty_ && sampler_) || !object_.ptr_)
+        return;
+
+    // Sampler state is not stored, the texture itself acts as the placeholder handle
+    sampler_ = this;
+    parametersDirty_ = false;
+}
+
+unsigned Texture::GetSRVFormat(unsigned format)
+{
+    return format;
+}
+
+unsigned Texture::GetDSVFormat(unsigned format)
+{
+    return format;
+}
+
+unsigned Texture::GetSRGBFormat(unsigned format)
+{
+    if (format == NULLFMT_RGBA8)
+        return NULLFMT_RGBA8_SRGB;
+    else if (format == NULLFMT_BC1)
+        return NULLFMT_BC1_SRGB;
+    else if (format == NULLFMT_BC2)
+        return NULLFMT_BC2_SRGB;
+    else if (format == NULLFMT_BC3)
+        return NULLFMT_BC3_SRGB;
+    else
+        return format;
+}
+
+void Texture::RegenerateLevels()
+{
+    if (!shaderResourceView_)
+        return;
+
+    levelsDirty_ = false;
+}
+
+}
@@ -0,0 +1,301 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../../Precompiled.h"
+
+#include "../../Core/Context.h"
+#include "../../Core/Profiler.h"
+#include "../../Graphics/Graphics.h"
+#include "../../Graphics/GraphicsEvents.h"
+#include "../../Graphics/GraphicsImpl.h"
+#include "../../Graphics/Renderer.h"
+#include "../../Graphics/Texture2D.h"
+#include "../../IO/FileSystem.h"
+#include "../../IO/Log.h"
+#include "../../Resource/ResourceCache.h"
+#include "../../Resource/XMLFile.h"
+
+#include "../../DebugNew.h"
+
+namespace Urho3D
+{
+
+void Texture2D::OnDeviceLost()
+{
+    // No-op on the null backend
+}
+
+void Texture2D::OnDeviceReset()
+{
+    // No-op on the null backend
+}
+
+void Texture2D::Release()
+{
+    if (graphics_ && object_.ptr_)
+    {
+        for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
+        {
+            if (graphics_->GetTexture(i) == this)
+                graphics_->SetTexture(i, nullptr);
+        }
+    }
+
+    if (renderSurface_)
+        renderSurface_->Release();
+
+    object_.ptr_ = nullptr;
+    resolveTexture_ = nullptr;
+    shaderResourceView_ = nullptr;
+    sampler_ = nullptr;
+}
+
+bool Texture2D::SetData(unsigned level, int x, int y, int width, int height, const void* data)
+{
+    URHO3D_PROFILE(SetTextureData);
+
+    if (!object_.ptr_)
+    {
+        URHO3D_LOGERROR("No texture created, can not set data");
+        return false;
+    }
+
+    if (!data)
+    {
+        URHO3D_LOGERROR("Null source for setting data");
+        return false;
+    }
+
+    if (level >= levels_)
+    {
+        URHO3D_LOGERROR("Illegal mip level for setting data");
+        return false;
+    }
+
+    int levelWidth = GetLevelWidth(level);
+    int levelHeight = GetLevelHeight(level);
+    if (x < 0 || x + width > levelWidth || y < 0 || y + height > levelHeight || width <= 0 || height <= 0)
+    {
+        URHO3D_LOGERROR("Illegal dimensions for setting data");
+        return false;
+    }
+
+    // If compressed, align the update region on a block
+    if (IsCompressed())
+    {
+        x &= ~3;
+        y &= ~3;
+        width += 3;
+        width &= 0xfffffffc;
+        height += 3;
+        height &= 0xfffffffc;
+    }
+
+    unsigned rowSize = GetRowDataSize(width);
+    unsigned numRows = (unsigned)(IsCompressed() ? (height + 3) >> 2 : height);
+    graphics_->GetImpl()->AddBytesUploaded(rowSize * numRows);
+
+    return true;
+}
+
+bool Texture2D::SetData(Image* image, bool useAlpha)
+{
+    if (!image)
+    {
+        URHO3D_LOGERROR("Null image, can not load texture");
+        return false;
+    }
+
+    // Use a shared ptr for managing the temporary mip images created during this function
+    SharedPtr<Image> mipImage;
+    unsigned memoryUse = sizeof(Texture2D);
+    MaterialQuality quality = QUALITY_HIGH;
+    Renderer* renderer = GetSubsystem<Renderer>();
+    if (renderer)
+        quality = renderer->GetTextureQuality();
+
+    if (!image->IsCompressed())
+    {
+        // Convert unsuitable formats to RGBA
+        unsigned components = image->GetComponents();
+        if ((components == 1 && !useAlpha) || components == 2 || components == 3)
+        {
+            mipImage = image->ConvertToRGBA(); image = mipImage;
+            if (!image)
+                return false;
+            components = image->GetComponents();
+        }
+
+        unsigned char* levelData = image->GetData();
+        int levelWidth = image->GetWidth();
+        int levelHeight = image->GetHeight();
+        unsigned format = 0;
+
+        // Discard unnecessary mip levels
+        for (unsigned i = 0; i < mipsToSkip_[quality]; ++i)
+        {
+            mipImage = image->GetNextLevel(); image = mipImage;
+            levelData = image->GetData();
+            levelWidth = image->GetWidth();
+            levelHeight = image->GetHeight();
+        }
+
+        switch (components)
+        {
+        case 1:
+            format = Graphics::GetAlphaFormat();
+            break;
+
+        case 4:
+            format = Graphics::GetRGBAFormat();
+            break;
+
+        default: break;
+        }
+
+        // If image was previously compressed, reset number of requested levels to avoid error if level count is too high for new size
+        if (IsCompressed() && requestedLevels_ > 1)
+            requestedLevels_ = 0;
+        SetSize(levelWidth, levelHeight, format);
+
+        for (unsigned i = 0; i < levels_; ++i)
+        {
+            SetData(i, 0, 0, levelWidth, levelHeight, levelData);
+            memoryUse += levelWidth * levelHeight * components;
+
+            if (i < levels_ - 1)
+            {
+                mipImage = image->GetNextLevel(); image = mipImage;
+                levelData = image->GetData();
+                levelWidth = image->GetWidth();
+                levelHeight = image->GetHeight();
+            }
+        }
+    }
+    else
+    {
+        int width = image->GetWidth();
+        int height = image->GetHeight();
+        unsigned levels = image->GetNumCompressedLevels();
+        unsigned format = graphics_->GetFormat(image->GetCompressedFormat());
+        bool needDecompress = false;
+
+        if (!format)
+        {
+            format = Graphics::GetRGBAFormat();
+            needDecompress = true;
+        }
+
+        unsigned mipsToSkip = mipsToSkip_[quality];
+        if (mipsToSkip >= levels)
+            mipsToSkip = levels - 1;
+        while (mipsToSkip && (width / (1 << mipsToSkip) < 4 || height / (1 << mipsToSkip) < 4))
+            --mipsToSkip;
+        width /= (1 << mipsToSkip);
+        height /= (1 << mipsToSkip);
+
+        SetNumLevels(Max((levels - mipsToSkip), 1U));
+        SetSize(width, height, format);
+
+        for (unsigned i = 0; i < levels_ && i < levels - mipsToSkip; ++i)
+        {
+            CompressedLevel level = image->GetCompressedLevel(i + mipsToSkip);
+            if (!needDecompress)
+            {
+                SetData(i, 0, 0, level.width_, level.height_, level.data_);
+                memoryUse += level.rows_ * level.rowSize_;
+            }
+            else
+            {
+                unsigned char* rgbaData = new unsigned char[level.width_ * level.height_ * 4];
+                level.Decompress(rgbaData);
+                SetData(i, 0, 0, level.width_, level.height_, rgbaData);
+                memoryUse += level.width_ * level.height_ * 4;
+                delete[] rgbaData;
+            }
+        }
+    }
+
+    SetMemoryUse(memoryUse);
+    return true;
+}
+
+bool Texture2D::GetData(unsigned level, void* dest) const
+{
+    if (!object_.ptr_)
+    {
+        URHO3D_LOGERROR("No texture created, can not get data");
+        return false;
+    }
+
+    if (!dest)
+    {
+        URHO3D_LOGERROR("Null destination for getting data");
+        return false;
+    }
+
+    if (level >= levels_)
+    {
+        URHO3D_LOGERROR("Illegal mip level for getting data");
+        return false;
+    }
+
+    if (multiSample_ > 1 && !autoResolve_)
+    {
+        URHO3D_LOGERROR("Can not get data from multisampled texture without autoresolve");
+        return false;
+    }
+
+    // Nothing is rasterized or stored, so there is no data to read back
+    URHO3D_LOGERROR("Getting texture data is not supported on the null graphics backend");
+    return false;
+}
+
+bool Texture2D::Create()
+{
+    Release();
+
+    if (!graphics_ || !width_ || !height_)
+        return false;
+
+    levels_ = CheckMaxLevels(width_, height_, requestedLevels_);
+    if (usage_ == TEXTURE_DEPTHSTENCIL)
+        levels_ = 1;
+
+    // No storage is allocated. The texture itself acts as the placeholder handle of the resource and its views
+    object_.ptr_ = this;
+    shaderResourceView_ = this;
+    if (multiSample_ > 1 && autoResolve_)
+        resolveTexture_ = this;
+
+    if (usage_ == TEXTURE_RENDERTARGET)
+        renderSurface_->renderTargetView_ = renderSurface_.Get();
+    else if (usage_ == TEXTURE_DEPTHSTENCIL)
+    {
+        renderSurface_->renderTargetView_ = renderSurface_.Get();
+        renderSurface_->readOnlyView_ = renderSurface_.Get();
+    }
+
+    return true;
+}
+
+}
@@ -28,6 +28,12 @@
 #include "../Graphics/OcclusionBuffer.h"
 #include "../IO/Log.h"
 
+#if ALIMER_SSE2
+#include <emmintrin.h>
+#elif ALIMER_NEON
+#include <arm_neon.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -43,6 +49,137 @@ namespace Urho3D
     };
     URHO3D_FLAGSET(ClipMask, ClipMaskFlags);
 
+    // 4-wide float and integer operations used by the rasterizer and box projection
+#if ALIMER_SSE2
+    typedef __m128 OcclusionFloat4;
+    typedef __m128i OcclusionInt4;
+
+    static inline OcclusionFloat4 SplatFloat4(float value) { return _mm_set1_ps(value); }
+    static inline OcclusionFloat4 SetFloat4(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+    static inline OcclusionFloat4 AddFloat4(OcclusionFloat4 a, OcclusionFloat4 b) { return _mm_add_ps(a, b); }
+    static inline OcclusionFloat4 MulFloat4(OcclusionFloat4 a, OcclusionFloat4 b) { return _mm_mul_ps(a, b); }
+    static inline OcclusionFloat4 DivFloat4(OcclusionFloat4 a, OcclusionFloat4 b) { return _mm_div_ps(a, b); }
+    static inline OcclusionFloat4 MinFloat4(OcclusionFloat4 a, OcclusionFloat4 b) { return _mm_min_ps(a, b); }
+    static inline OcclusionFloat4 MaxFloat4(OcclusionFloat4 a, OcclusionFloat4 b) { return _mm_max_ps(a, b); }
+    static inline void StoreFloat4(float* dest, OcclusionFloat4 a) { _mm_storeu_ps(dest, a); }
+    static inline OcclusionInt4 GreaterEqualMask(OcclusionFloat4 a, OcclusionFloat4 b) { return _mm_castps_si128(_mm_cmpge_ps(a, b)); }
+    static inline OcclusionInt4 AndMask(OcclusionInt4 a, OcclusionInt4 b) { return _mm_and_si128(a, b); }
+    static inline bool AnyMask(OcclusionInt4 mask) { return _mm_movemask_epi8(mask) != 0; }
+    static inline OcclusionInt4 TruncateInt4(OcclusionFloat4 a) { return _mm_cvttps_epi32(a); }
+    static inline OcclusionInt4 LoadInt4(const int* src) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)); }
+    static inline void StoreInt4(int* dest, OcclusionInt4 a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), a); }
+    static inline OcclusionInt4 MinMaskedInt4(OcclusionInt4 dest, OcclusionInt4 src, OcclusionInt4 mask)
+    {
+        OcclusionInt4 select = _mm_and_si128(_mm_cmplt_epi32(src, dest), mask);
+        return _mm_or_si128(_mm_and_si128(select, src), _mm_andnot_si128(select, dest));
+    }
+#elif ALIMER_NEON
+    typedef float32x4_t OcclusionFloat4;
+    typedef uint32x4_t OcclusionInt4;
+
+    static inline OcclusionFloat4 SplatFloat4(float value) { return vdupq_n_f32(value); }
+    static inline OcclusionFloat4 SetFloat4(float x, float y, float z, float w)
+    {
+        const float values[4] = { x, y, z, w };
+        return vld1q_f32(values);
+    }
+    static inline OcclusionFloat4 AddFloat4(OcclusionFloat4 a, OcclusionFloat4 b) { return vaddq_f32(a, b); }
+    static inline OcclusionFloat4 MulFloat4(OcclusionFloat4 a, OcclusionFloat4 b) { return vmulq_f32(a, b); }
+    static inline OcclusionFloat4 DivFloat4(OcclusionFloat4 a, OcclusionFloat4 b)
+    {
+        // Reciprocal estimate refined with two Newton-Raphson steps
+        float32x4_t reciprocal = vrecpeq_f32(b);
+        reciprocal = vmulq_f32(vrecpsq_f32(b, reciprocal), reciprocal);
+        reciprocal = vmulq_f32(vrecpsq_f32(b, reciprocal), reciprocal);
+        return vmulq_f32(a, reciprocal);
+    }
+    static inline OcclusionFloat4 MinFloat4(OcclusionFloat4 a, OcclusionFloat4 b) { return vminq_f32(a, b); }
+    static inline OcclusionFloat4 MaxFloat4(OcclusionFloat4 a, OcclusionFloat4 b) { return vmaxq_f32(a, b); }
+    static inline void StoreFloat4(float* dest, OcclusionFloat4 a) { vst1q_f32(dest, a); }
+    static inline OcclusionInt4 GreaterEqualMask(OcclusionFloat4 a, OcclusionFloat4 b) { return vcgeq_f32(a, b); }
+    static inline OcclusionInt4 AndMask(OcclusionInt4 a, OcclusionInt4 b) { return vandq_u32(a, b); }
+    static inline bool AnyMask(OcclusionInt4 mask)
+    {
+        uint32x2_t half = vorr_u32(vget_low_u32(mask), vget_high_u32(mask));
+        return vget_lane_u32(vpmax_u32(half, half), 0) != 0;
+    }
+    static inline int32x4_t TruncateInt4(OcclusionFloat4 a) { return vcvtq_s32_f32(a); }
+    static inline int32x4_t LoadInt4(const int* src) { return vld1q_s32(src); }
+    static inline void StoreInt4(int* dest, int32x4_t a) { vst1q_s32(dest, a); }
+    static inline int32x4_t MinMaskedInt4(int32x4_t dest, int32x4_t src, OcclusionInt4 mask)
+    {
+        return vbslq_s32(mask, vminq_s32(dest, src), dest);
+    }
+#else
+    /// Portable 4-wide float value.
+    struct OcclusionFloat4
+    {
+        /// Lanes.
+        float v_[4];
+    };
+
+    /// Portable 4-wide integer value or lane mask.
+    struct OcclusionInt4
+    {
+        /// Lanes.
+        int v_[4];
+    };
+
+    static inline OcclusionFloat4 SplatFloat4(float value) { return OcclusionFloat4{ { value, value, value, value } }; }
+    static inline OcclusionFloat4 SetFloat4(float x, float y, float z, float w) { return OcclusionFloat4{ { x, y, z, w } }; }
+    static inline OcclusionFloat4 AddFloat4(const OcclusionFloat4& a, const OcclusionFloat4& b)
+    {
+        return OcclusionFloat4{ { a.v_[0] + b.v_[0], a.v_[1] + b.v_[1], a.v_[2] + b.v_[2], a.v_[3] + b.v_[3] } };
+    }
+    static inline OcclusionFloat4 MulFloat4(const OcclusionFloat4& a, const OcclusionFloat4& b)
+    {
+        return OcclusionFloat4{ { a.v_[0] * b.v_[0], a.v_[1] * b.v_[1], a.v_[2] * b.v_[2], a.v_[3] * b.v_[3] } };
+    }
+    static inline OcclusionFloat4 DivFloat4(const OcclusionFloat4& a, const OcclusionFloat4& b)
+    {
+        return OcclusionFloat4{ { a.v_[0] / b.v_[0], a.v_[1] / b.v_[1], a.v_[2] / b.v_[2], a.v_[3] / b.v_[3] } };
+    }
+    static inline OcclusionFloat4 MinFloat4(const OcclusionFloat4& a, const OcclusionFloat4& b)
+    {
+        return OcclusionFloat4{ { Min(a.v_[0], b.v_[0]), Min(a.v_[1], b.v_[1]), Min(a.v_[2], b.v_[2]), Min(a.v_[3], b.v_[3]) } };
+    }
+    static inline OcclusionFloat4 MaxFloat4(const OcclusionFloat4& a, const OcclusionFloat4& b)
+    {
+        return OcclusionFloat4{ { Max(a.v_[0], b.v_[0]), Max(a.v_[1], b.v_[1]), Max(a.v_[2], b.v_[2]), Max(a.v_[3], b.v_[3]) } };
+    }
+    static inline void StoreFloat4(float* dest, const OcclusionFloat4& a)
+    {
+        for (unsigned i = 0; i < 4; ++i)
+            dest[i] = a.v_[i];
+    }
+    static inline OcclusionInt4 GreaterEqualMask(const OcclusionFloat4& a, const OcclusionFloat4& b)
+    {
+        return OcclusionInt4{ { a.v_[0] >= b.v_[0] ? -1 : 0, a.v_[1] >= b.v_[1] ? -1 : 0, a.v_[2] >= b.v_[2] ? -1 : 0, a.v_[3] >= b.v_[3] ? -1 : 0 } };
+    }
+    static inline OcclusionInt4 AndMask(const OcclusionInt4& a, const OcclusionInt4& b)
+    {
+        return OcclusionInt4{ { a.v_[0] & b.v_[0], a.v_[1] & b.v_[1], a.v_[2] & b.v_[2], a.v_[3] & b.v_[3] } };
+    }
+    static inline bool AnyMask(const OcclusionInt4& mask) { return (mask.v_[0] | mask.v_[1] | mask.v_[2] | mask.v_[3]) != 0; }
+    static inline OcclusionInt4 TruncateInt4(const OcclusionFloat4& a)
+    {
+        return OcclusionInt4{ { (int)a.v_[0], (int)a.v_[1], (int)a.v_[2], (int)a.v_[3] } };
+    }
+    static inline OcclusionInt4 LoadInt4(const int* src) { return OcclusionInt4{ { src[0], src[1], src[2], src[3] } }; }
+    static inline void StoreInt4(int* dest, const OcclusionInt4& a)
+    {
+        for (unsigned i = 0; i < 4; ++i)
+            dest[i] = a.v_[i];
+    }
+    static inline OcclusionInt4 MinMaskedInt4(const OcclusionInt4& dest, const OcclusionInt4& src, const OcclusionInt4& mask)
+    {
+        OcclusionInt4 ret;
+        for (unsigned i = 0; i < 4; ++i)
+            ret.v_[i] = (mask.v_[i] && src.v_[i] < dest.v_[i]) ? src.v_[i] : dest.v_[i];
+        return ret;
+    }
+#endif
+
     void DrawOcclusionBatchWork(const WorkItem* item, unsigned threadIndex)
     {
         auto* buffer = reinterpret_cast<OcclusionBuffer*>(item->aux_);
@@ -50,6 +187,12 @@ namespace Urho3D
         buffer->DrawBatch(batch, threadIndex);
     }
 
+    void RasterizeOcclusionTileWork(const WorkItem* item, unsigned threadIndex)
+    {
+        auto* buffer = reinterpret_cast<OcclusionBuffer*>(item->aux_);
+        buffer->RasterizeTile((unsigned)reinterpret_cast<size_t>(item->start_));
+    }
+
     OcclusionBuffer::OcclusionBuffer(Context* context) :
         Object(context)
     {
@@ -62,6 +205,9 @@ namespace Urho3D
         // Force the height to an even amount of pixels for better mip generation
         if (height & 1u)
             ++height;
+        // The rasterizer writes 4 pixels at a time
+        if (width > 0 && width < 4)
+            width = 4;
 
         if (width == width_ && height == height_)
             return true;
@@ -78,17 +224,20 @@ namespace Urho3D
         width_ = width;
         height_ = height;
 
-        // Build work buffers for threading
+        // Reserve extra memory in case 3D clipping is not exact
+        dataWithSafety_ = new int[width * (height + 2) + 2];
+        data_ = dataWithSafety_.Get() + width + 1;
+        reprojectData_.Reset();
+        hasContent_ = false;
+
+        // Build triangle setup data and tile bins for each thread
+        numTilesX_ = (width + OCCLUSION_TILE_WIDTH - 1) / OCCLUSION_TILE_WIDTH;
+        numTilesY_ = (height + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT;
         unsigned numThreadBuffers = threaded ? GetSubsystem<WorkQueue>()->GetNumThreads() + 1 : 1;
-        buffers_.Resize(numThreadBuffers);
+        threadData_.Clear();
+        threadData_.Resize(numThreadBuffers);
         for (unsigned i = 0; i < numThreadBuffers; ++i)
-        {
-            // Reserve extra memory in case 3D clipping is not exact
-            OcclusionBufferData& buffer = buffers_[i];
-            buffer.dataWithSafety_ = new int[width * (height + 2) + 2];
-            buffer.data_ = buffer.dataWithSafety_.Get() + width + 1;
-            buffer.used_ = false;
-        }
+            threadData_[i].bins_.Resize((unsigned)(numTilesX_ * numTilesY_));
 
         mipBuffers_.Clear();
 
@@ -152,12 +301,74 @@ namespace Urho3D
     {
         Reset();
 
-        // Only clear the main thread buffer. Rest are cleared on-demand when drawing the first batch
-        ClearBuffer(0);
-        for (unsigned i = 1; i < buffers_.Size(); ++i)
-            buffers_[i].used_ = false;
+        ClearBuffer();
+        depthHierarchyDirty_ = true;
+        contentViewProj_ = viewProj_;
+        hasContent_ = true;
+    }
+
+    bool OcclusionBuffer::Reproject()
+    {
+        if (!data_ || !hasContent_)
+        {
+            Clear();
+            return false;
+        }
+
+        URHO3D_PROFILE(ReprojectOcclusion);
+
+        Reset();
+
+        int count = width_ * height_;
+        if (!reprojectData_)
+            reprojectData_ = new int[count];
+
+        // Mark every pixel unwritten
+        int* dest = reprojectData_.Get();
+        for (int i = 0; i < count; ++i)
+            dest[i] = -1;
+
+        // Unproject each pixel with the matrix it was rendered with, and project it into the current view. Where several pixels land on the
+        // same pixel, keep the farthest, and bias the depth farther so that the result never occludes more than the original geometry
+        const Matrix4 transform = viewProj_ * contentViewProj_.Inverse();
+        const int farDepth = (int)OCCLUSION_Z_SCALE;
+        const float invScaleX = 1.0f / scaleX_;
+        const float invScaleY = 1.0f / scaleY_;
+        const float invZScale = 1.0f / OCCLUSION_Z_SCALE;
+
+        for (int y = 0; y < height_; ++y)
+        {
+            const int* src = data_ + y * width_;
+            float ndcY = ((float)y + 0.5f - offsetY_) * invScaleY;
+
+            for (int x = 0; x < width_; ++x)
+            {
+                int depth = src[x];
+                if (depth >= farDepth)
+                    continue;
+
+                Vector4 clip = transform * Vector4(((float)x + 0.5f - offsetX_) * invScaleX, ndcY, depth * invZScale, 1.0f);
+                if (clip.w_ <= 0.0f || clip.z_ < 0.0f || clip.z_ > clip.w_)
+                    continue;
+
+                Vector3 projected = ViewportTransform(clip);
+                int destX = FloorToInt(projected.x_);
+                int destY = FloorToInt(projected.y_);
+                if (destX < 0 || destY < 0 || destX >= width_ || destY >= height_)
+                    continue;
+
+                int newDepth = Min(CeilToInt(projected.z_) + (int)OCCLUSION_FIXED_BIAS, farDepth);
+                int& destDepth = dest[destY * width_ + destX];
+                destDepth = Max(destDepth, newDepth);
+            }
+        }
+
+        for (int i = 0; i < count; ++i)
+            data_[i] = dest[i] >= 0 ? dest[i] : farDepth;
 
         depthHierarchyDirty_ = true;
+        contentViewProj_ = viewProj_;
+        return true;
     }
 
     bool OcclusionBuffer::AddTriangles(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, unsigned vertexStart,
@@ -198,17 +409,22 @@ namespace Urho3D
 
     void OcclusionBuffer::DrawTriangles()
     {
-        if (buffers_.Size() == 1)
+        if (!data_)
+            return;
+
+        unsigned numTiles = (unsigned)(numTilesX_ * numTilesY_);
+
+        if (threadData_.Size() == 1)
         {
             // Not threaded
             for (Vector<OcclusionBatch>::Iterator i = batches_.Begin(); i != batches_.End(); ++i)
                 DrawBatch(*i, 0);
-
-            depthHierarchyDirty_ = true;
+            for (unsigned i = 0; i < numTiles; ++i)
+                RasterizeTile(i);
         }
-        else if (buffers_.Size() > 1)
+        else if (threadData_.Size() > 1)
         {
-            // Threaded
+            // Threaded: first set up and bin the triangles of each batch, then rasterize each tile
             auto* queue = GetSubsystem<WorkQueue>();
 
             for (Vector<OcclusionBatch>::Iterator i = batches_.Begin(); i != batches_.End(); ++i)
@@ -223,16 +439,41 @@ namespace Urho3D
 
             queue->Complete(M_MAX_UNSIGNED);
 
-            MergeBuffers();
-            depthHierarchyDirty_ = true;
+            // Tiles do not overlap, so they can write to the buffer concurrently
+            for (unsigned i = 0; i < numTiles; ++i)
+            {
+                bool hasTriangles = false;
+                for (unsigned j = 0; j < threadData_.Size() && !hasTriangles; ++j)
+                    hasTriangles = !threadData_[j].bins_[i].Empty();
+                if (!hasTriangles)
+                    continue;
+
+                SharedPtr<WorkItem> item = queue->GetFreeItem();
+                item->priority_ = M_MAX_UNSIGNED;
+                item->workFunction_ = RasterizeOcclusionTileWork;
+                item->aux_ = this;
+                item->start_ = reinterpret_cast<void*>((size_t)i);
+                queue->AddWorkItem(item);
+            }
+
+            queue->Complete(M_MAX_UNSIGNED);
+        }
+
+        for (unsigned i = 0; i < threadData_.Size(); ++i)
+        {
+            OcclusionThreadData& data = threadData_[i];
+            data.triangles_.Clear();
+            for (unsigned j = 0; j < data.bins_.Size(); ++j)
+                data.bins_[j].Clear();
         }
 
+        depthHierarchyDirty_ = true;
         batches_.Clear();
     }
 
     void OcclusionBuffer::BuildDepthHierarchy()
     {
-        if (buffers_.Empty() || !depthHierarchyDirty_)
+        if (!data_ || !depthHierarchyDirty_)
             return;
 
         URHO3D_PROFILE(BuildDepthHierarchy);
@@ -244,7 +485,7 @@ namespace Urho3D
         {
             for (int y = 0; y < height; ++y)
             {
-                int* src = buffers_[0].data_ + (y * 2) * width_;
+                int* src = data_ + (y * 2) * width_;
                 DepthValue* dest = mipBuffers_[0].Get() + y * width;
                 DepthValue* end = dest + width;
 
@@ -334,58 +575,71 @@ namespace Urho3D
 
     bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
     {
-        if (buffers_.Empty())
+        if (!data_)
             return true;
 
-        // Transform corners to projection space
-        Vector4 vertices[8];
-        vertices[0] = ModelTransform(viewProj_, worldSpaceBox.min_);
-        vertices[1] = ModelTransform(viewProj_, Vector3(worldSpaceBox.max_.x_, worldSpaceBox.min_.y_, worldSpaceBox.min_.z_));
-        vertices[2] = ModelTransform(viewProj_, Vector3(worldSpaceBox.min_.x_, worldSpaceBox.max_.y_, worldSpaceBox.min_.z_));
-        vertices[3] = ModelTransform(viewProj_, Vector3(worldSpaceBox.max_.x_, worldSpaceBox.max_.y_, worldSpaceBox.min_.z_));
-        vertices[4] = ModelTransform(viewProj_, Vector3(worldSpaceBox.min_.x_, worldSpaceBox.min_.y_, worldSpaceBox.max_.z_));
-        vertices[5] = ModelTransform(viewProj_, Vector3(worldSpaceBox.max_.x_, worldSpaceBox.min_.y_, worldSpaceBox.max_.z_));
-        vertices[6] = ModelTransform(viewProj_, Vector3(worldSpaceBox.min_.x_, worldSpaceBox.max_.y_, worldSpaceBox.max_.z_));
-        vertices[7] = ModelTransform(viewProj_, worldSpaceBox.max_);
-
-        // Apply a far clip relative bias
-        for (auto& vertice : vertices)
-            vertice.z_ -= OCCLUSION_RELATIVE_BIAS;
-
-        // Transform to screen space. If any of the corners cross the near plane, assume visible
-        float minX, maxX, minY, maxY, minZ;
-
-        if (vertices[0].z_ <= 0.0f)
+        IntRect rect;
+        int z;
+        if (!ProjectBox(worldSpaceBox, rect, z))
             return true;
 
-        Vector3 projected = ViewportTransform(vertices[0]);
-        minX = maxX = projected.x_;
-        minY = maxY = projected.y_;
-        minZ = projected.z_;
+        return IsVisible(rect, z);
+    }
 
-        // Project the rest
-        for (unsigned i = 1; i < 8; ++i)
-        {
-            if (vertices[i].z_ <= 0.0f)
-                return true;
+    bool OcclusionBuffer::ProjectBox(const BoundingBox& worldSpaceBox, IntRect& rect, int& z) const
+    {
+        const Vector3& min = worldSpaceBox.min_;
+        const Vector3& max = worldSpaceBox.max_;
+        const Matrix4& m = viewProj_;
 
-            projected = ViewportTransform(vertices[i]);
+        // Transform the corners to projection space in two groups of four: X and Y vary within a group, Z is constant
+        OcclusionFloat4 x = SetFloat4(min.x_, max.x_, min.x_, max.x_);
+        OcclusionFloat4 y = SetFloat4(min.y_, min.y_, max.y_, max.y_);
+        OcclusionFloat4 zero = SplatFloat4(0.0f);
+        float minX = M_INFINITY, maxX = -M_INFINITY, minY = M_INFINITY, maxY = -M_INFINITY, minZ = M_INFINITY;
 
-            if (projected.x_ < minX) minX = projected.x_;
-            if (projected.x_ > maxX) maxX = projected.x_;
-            if (projected.y_ < minY) minY = projected.y_;
-            if (projected.y_ > maxY) maxY = projected.y_;
-            if (projected.z_ < minZ) minZ = projected.z_;
+        for (unsigned i = 0; i < 2; ++i)
+        {
+            float cornerZ = i ? max.z_ : min.z_;
+            OcclusionFloat4 clipX = AddFloat4(AddFloat4(MulFloat4(SplatFloat4(m.m00_), x), MulFloat4(SplatFloat4(m.m01_), y)),
+                SplatFloat4(m.m02_ * cornerZ + m.m03_));
+            OcclusionFloat4 clipY = AddFloat4(AddFloat4(MulFloat4(SplatFloat4(m.m10_), x), MulFloat4(SplatFloat4(m.m11_), y)),
+                SplatFloat4(m.m12_ * cornerZ + m.m13_));
+            // Apply a far clip relative bias
+            OcclusionFloat4 clipZ = AddFloat4(AddFloat4(MulFloat4(SplatFloat4(m.m20_), x), MulFloat4(SplatFloat4(m.m21_), y)),
+                SplatFloat4(m.m22_ * cornerZ + m.m23_ - OCCLUSION_RELATIVE_BIAS));
+            OcclusionFloat4 clipW = AddFloat4(AddFloat4(MulFloat4(SplatFloat4(m.m30_), x), MulFloat4(SplatFloat4(m.m31_), y)),
+                SplatFloat4(m.m32_ * cornerZ + m.m33_));
+
+            // If any of the corners cross the near plane, assume visible
+            if (AnyMask(GreaterEqualMask(zero, clipZ)))
+                return false;
+
+            // Transform to screen space
+            OcclusionFloat4 invW = DivFloat4(SplatFloat4(1.0f), clipW);
+            float projectedX[4], projectedY[4], projectedZ[4];
+            StoreFloat4(projectedX, AddFloat4(MulFloat4(MulFloat4(clipX, invW), SplatFloat4(scaleX_)), SplatFloat4(offsetX_)));
+            StoreFloat4(projectedY, AddFloat4(MulFloat4(MulFloat4(clipY, invW), SplatFloat4(scaleY_)), SplatFloat4(offsetY_)));
+            StoreFloat4(projectedZ, MulFloat4(MulFloat4(clipZ, invW), SplatFloat4(OCCLUSION_Z_SCALE)));
+
+            for (unsigned j = 0; j < 4; ++j)
+            {
+                minX = Min(minX, projectedX[j]);
+                maxX = Max(maxX, projectedX[j]);
+                minY = Min(minY, projectedY[j]);
+                maxY = Max(maxY, projectedY[j]);
+                minZ = Min(minZ, projectedZ[j]);
+            }
         }
 
         // Expand the bounding box 1 pixel in each direction to be conservative and correct rasterization offset
-        IntRect rect((int)(minX - 1.5f), (int)(minY - 1.5f), RoundToInt(maxX), RoundToInt(maxY));
+        rect = IntRect((int)(minX - 1.5f), (int)(minY - 1.5f), RoundToInt(maxX), RoundToInt(maxY));
 
         // If the rect is outside, let frustum culling handle
         if (rect.right_ < 0 || rect.bottom_ < 0)
-            return true;
+            return false;
         if (rect.left_ >= width_ || rect.top_ >= height_)
-            return true;
+            return false;
 
         // Clipping of rect
         if (rect.left_ < 0)
@@ -398,8 +652,12 @@ namespace Urho3D
             rect.bottom_ = height_ - 1;
 
         // Convert depth to integer and apply final bias
-        int z = RoundToInt(minZ) - OCCLUSION_FIXED_BIAS;
+        z = RoundToInt(minZ) - OCCLUSION_FIXED_BIAS;
+        return true;
+    }
 
+    bool OcclusionBuffer::IsVisible(const IntRect& rect, int z) const
+    {
         if (!depthHierarchyDirty_)
         {
             // Start from lowest mip level and check if a conclusive result can be found
@@ -436,8 +694,8 @@ namespace Urho3D
         }
 
         // If no conclusive result, finally check the pixel-level data
-        int* row = buffers_[0].data_ + rect.top_ * width_;
-        int* endRow = buffers_[0].data_ + rect.bottom_ * width_;
+        int* row = data_ + rect.top_ * width_;
+        int* endRow = data_ + rect.bottom_ * width_;
         while (row <= endRow)
         {
             int* src = row + rect.left_;
@@ -462,13 +720,6 @@ namespace Urho3D
 
     void OcclusionBuffer::DrawBatch(const OcclusionBatch& batch, unsigned threadIndex)
     {
-        // If buffer not yet used, clear it
-        if (threadIndex > 0 && !buffers_[threadIndex].used_)
-        {
-            ClearBuffer(threadIndex);
-            buffers_[threadIndex].used_ = true;
-        }
-
         Matrix4 modelViewProj = viewProj_ * batch.model_;
 
         // Theoretical max. amount of vertices if each of the 6 clipping planes doubles the triangle count
@@ -632,7 +883,7 @@ namespace Urho3D
             bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
             if (cullMode_ == CullMode::None || (cullMode_ == CullMode::CounterClockwise && clockwise) || (cullMode_ == CullMode::Clockwise && !clockwise))
             {
-                DrawTriangle2D(projected, clockwise, threadIndex);
+                SetupTriangle(projected, threadIndex);
                 drawOk = true;
             }
         }
@@ -670,7 +921,7 @@ namespace Urho3D
                     bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
                     if (cullMode_ == CullMode::None || (cullMode_ == CullMode::CounterClockwise && clockwise) || (cullMode_ == CullMode::Clockwise && !clockwise))
                     {
-                        DrawTriangle2D(projected, clockwise, threadIndex);
+                        SetupTriangle(projected, threadIndex);
                         drawOk = true;
                     }
                 }
@@ -751,285 +1002,149 @@ namespace Urho3D
         }
     }
 
-    // Code based on Chris Hecker's Perspective Texture Mapping series in the Game Developer magazine
-    // Also available online at http://chrishecker.com/Miscellaneous_Technical_Articles
-
-    /// %Gradients of a software rasterized triangle.
-    struct Gradients
+    void OcclusionBuffer::SetupTriangle(const Vector3* vertices, unsigned threadIndex)
     {
-        /// Construct from vertices.
-        explicit Gradients(const Vector3* vertices)
-        {
-            float invdX = 1.0f / (((vertices[1].x_ - vertices[2].x_) *
-                (vertices[0].y_ - vertices[2].y_)) -
-                ((vertices[0].x_ - vertices[2].x_) *
-                    (vertices[1].y_ - vertices[2].y_)));
+        const float x0 = vertices[0].x_, y0 = vertices[0].y_, z0 = vertices[0].z_;
+        const float x1 = vertices[1].x_, y1 = vertices[1].y_, z1 = vertices[1].z_;
+        const float x2 = vertices[2].x_, y2 = vertices[2].y_, z2 = vertices[2].z_;
 
-            float invdY = -invdX;
+        float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+        if (area == 0.0f)
+            return;
 
-            dInvZdX_ = invdX * (((vertices[1].z_ - vertices[2].z_) * (vertices[0].y_ - vertices[2].y_)) -
-                ((vertices[0].z_ - vertices[2].z_) * (vertices[1].y_ - vertices[2].y_)));
+        IntRect rect(
+            Max(FloorToInt(Min(Min(x0, x1), x2)), 0),
+            Max(FloorToInt(Min(Min(y0, y1), y2)), 0),
+            Min(FloorToInt(Max(Max(x0, x1), x2)), width_ - 1),
+            Min(FloorToInt(Max(Max(y0, y1), y2)), height_ - 1)
+        );
+        if (rect.left_ > rect.right_ || rect.top_ > rect.bottom_)
+            return;
 
-            dInvZdY_ = invdY * (((vertices[1].z_ - vertices[2].z_) * (vertices[0].x_ - vertices[2].x_)) -
-                ((vertices[0].z_ - vertices[2].z_) * (vertices[1].x_ - vertices[2].x_)));
+        OcclusionThreadData& data = threadData_[threadIndex];
+        unsigned index = data.triangles_.Size();
+        data.triangles_.Resize(index + 1);
+        OcclusionTriangle& triangle = data.triangles_.Back();
 
-            dInvZdXInt_ = (int)dInvZdX_;
+        // Orient the edge functions so that the inside is non-negative for either winding
+        const float sign = area > 0.0f ? 1.0f : -1.0f;
+        const float xs[3] = { x0, x1, x2 };
+        const float ys[3] = { y0, y1, y2 };
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            unsigned j = i < 2 ? i + 1 : 0;
+            triangle.edgeA_[i] = sign * (ys[i] - ys[j]);
+            triangle.edgeB_[i] = sign * (xs[j] - xs[i]);
+            triangle.edgeC_[i] = sign * (xs[i] * ys[j] - xs[j] * ys[i]);
         }
 
-        /// Integer horizontal gradient.
-        int dInvZdXInt_;
-        /// Horizontal gradient.
-        float dInvZdX_;
-        /// Vertical gradient.
-        float dInvZdY_;
-    };
-
-    /// %Edge of a software rasterized triangle.
-    struct Edge
-    {
-        /// Construct from gradients and top & bottom vertices.
-        Edge(const Gradients& gradients, const Vector3& top, const Vector3& bottom, int topY)
+        // Depth is linear in screen space
+        float invArea = 1.0f / area;
+        triangle.depthA_ = ((z1 - z0) * (y2 - y0) - (z2 - z0) * (y1 - y0)) * invArea;
+        triangle.depthB_ = ((z2 - z0) * (x1 - x0) - (z1 - z0) * (x2 - x0)) * invArea;
+        triangle.depthC_ = z0 - triangle.depthA_ * x0 - triangle.depthB_ * y0;
+        triangle.minDepth_ = Min(Min(z0, z1), z2);
+        triangle.maxDepth_ = Max(Max(z0, z1), z2);
+        triangle.rect_ = rect;
+
+        // Add to the bins of the overlapped tiles
+        int firstTileX = rect.left_ / OCCLUSION_TILE_WIDTH;
+        int lastTileX = rect.right_ / OCCLUSION_TILE_WIDTH;
+        int firstTileY = rect.top_ / OCCLUSION_TILE_HEIGHT;
+        int lastTileY = rect.bottom_ / OCCLUSION_TILE_HEIGHT;
+        for (int tileY = firstTileY; tileY <= lastTileY; ++tileY)
         {
-            float height = (bottom.y_ - top.y_);
-            float slope = (height != 0.0f) ? (bottom.x_ - top.x_) / height : 0.0f;
-            float yPreStep = (float)(topY + 1) - top.y_;
-            float xPreStep = slope * yPreStep;
-
-            x_ = RoundToInt((xPreStep + top.x_) * OCCLUSION_X_SCALE);
-            xStep_ = RoundToInt(slope * OCCLUSION_X_SCALE);
-            invZ_ = RoundToInt(top.z_ + xPreStep * gradients.dInvZdX_ + yPreStep * gradients.dInvZdY_);
-            invZStep_ = RoundToInt(slope * gradients.dInvZdX_ + gradients.dInvZdY_);
+            for (int tileX = firstTileX; tileX <= lastTileX; ++tileX)
+                data.bins_[tileY * numTilesX_ + tileX].Push(index);
         }
+    }
 
-        /// X coordinate.
-        int x_;
-        /// X coordinate step.
-        int xStep_;
-        /// Inverse Z.
-        int invZ_;
-        /// Inverse Z step.
-        int invZStep_;
-    };
-
-    void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise, unsigned threadIndex)
+    void OcclusionBuffer::RasterizeTile(unsigned tileIndex)
     {
-        int top, middle, bottom;
-        bool middleIsRight;
+        int tileX = (int)tileIndex % numTilesX_;
+        int tileY = (int)tileIndex / numTilesX_;
+        IntRect tileRect(tileX * OCCLUSION_TILE_WIDTH, tileY * OCCLUSION_TILE_HEIGHT,
+            Min((tileX + 1) * OCCLUSION_TILE_WIDTH, width_) - 1, Min((tileY + 1) * OCCLUSION_TILE_HEIGHT, height_) - 1);
 
-        // Sort vertices in Y-direction
-        if (vertices[0].y_ < vertices[1].y_)
+        for (unsigned i = 0; i < threadData_.Size(); ++i)
         {
-            if (vertices[2].y_ < vertices[0].y_)
-            {
-                top = 2;
-                middle = 0;
-                bottom = 1;
-                middleIsRight = true;
-            }
-            else
-            {
-                top = 0;
-                if (vertices[1].y_ < vertices[2].y_)
-                {
-                    middle = 1;
-                    bottom = 2;
-                    middleIsRight = true;
-                }
-                else
-                {
-                    middle = 2;
-                    bottom = 1;
-                    middleIsRight = false;
-                }
-            }
-        }
-        else
-        {
-            if (vertices[2].y_ < vertices[1].y_)
-            {
-                top = 2;
-                middle = 1;
-                bottom = 0;
-                middleIsRight = false;
-            }
-            else
-            {
-                top = 1;
-                if (vertices[0].y_ < vertices[2].y_)
-                {
-                    middle = 0;
-                    bottom = 2;
-                    middleIsRight = false;
-                }
-                else
-                {
-                    middle = 2;
-                    bottom = 0;
-                    middleIsRight = true;
-                }
-            }
+            const OcclusionThreadData& data = threadData_[i];
+            const PODVector<unsigned>& bin = data.bins_[tileIndex];
+            for (unsigned j = 0; j < bin.Size(); ++j)
+                RasterizeTriangle(data.triangles_[bin[j]], tileRect);
         }
+    }
 
-        auto topY = (int)vertices[top].y_;
-        auto middleY = (int)vertices[middle].y_;
-        auto bottomY = (int)vertices[bottom].y_;
-
-        // Check for degenerate triangle
-        if (topY == bottomY)
+    void OcclusionBuffer::RasterizeTriangle(const OcclusionTriangle& triangle, const IntRect& tileRect)
+    {
+        // Tiles and rows start on 4-pixel boundaries, so aligning the left edge down stays inside the tile
+        int left = Max(triangle.rect_.left_, tileRect.left_) & ~3;
+        int right = Min(triangle.rect_.right_, tileRect.right_);
+        int top = Max(triangle.rect_.top_, tileRect.top_);
+        int bottom = Min(triangle.rect_.bottom_, tileRect.bottom_);
+        if (left > right || top > bottom)
             return;
 
-        // Reverse middleIsRight test if triangle is counterclockwise
-        if (!clockwise)
-            middleIsRight = !middleIsRight;
-
-        const bool topDegenerate = topY == middleY;
-        const bool bottomDegenerate = middleY == bottomY;
+        // Sample at pixel centers
+        const OcclusionFloat4 sampleX = AddFloat4(SplatFloat4((float)left), SetFloat4(0.5f, 1.5f, 2.5f, 3.5f));
+        const float sampleY = (float)top + 0.5f;
+        const OcclusionFloat4 zero = SplatFloat4(0.0f);
+        const OcclusionFloat4 minDepth = SplatFloat4(triangle.minDepth_);
+        const OcclusionFloat4 maxDepth = SplatFloat4(triangle.maxDepth_);
 
-        Gradients gradients(vertices);
-        Edge topToBottom(gradients, vertices[top], vertices[bottom], topY);
-
-        int* bufferData = buffers_[threadIndex].data_;
-
-        if (middleIsRight)
+        OcclusionFloat4 rowEdges[3];
+        OcclusionFloat4 edgeStepsX[3];
+        OcclusionFloat4 edgeStepsY[3];
+        for (unsigned i = 0; i < 3; ++i)
         {
-            // Top half
-            if (!topDegenerate)
-            {
-                Edge topToMiddle(gradients, vertices[top], vertices[middle], topY);
-                int* row = bufferData + topY * width_;
-                int* endRow = bufferData + middleY * width_;
-                while (row < endRow)
-                {
-                    int invZ = topToBottom.invZ_;
-                    int* dest = row + (topToBottom.x_ >> 16u);
-                    int* end = row + (topToMiddle.x_ >> 16u);
-                    while (dest < end)
-                    {
-                        if (invZ < *dest)
-                            *dest = invZ;
-                        invZ += gradients.dInvZdXInt_;
-                        ++dest;
-                    }
-
-                    topToBottom.x_ += topToBottom.xStep_;
-                    topToBottom.invZ_ += topToBottom.invZStep_;
-                    topToMiddle.x_ += topToMiddle.xStep_;
-                    row += width_;
-                }
-            }
-
-            // Bottom half
-            if (!bottomDegenerate)
-            {
-                Edge middleToBottom(gradients, vertices[middle], vertices[bottom], middleY);
-                int* row = bufferData + middleY * width_;
-                int* endRow = bufferData + bottomY * width_;
-                while (row < endRow)
-                {
-                    int invZ = topToBottom.invZ_;
-                    int* dest = row + (topToBottom.x_ >> 16u);
-                    int* end = row + (middleToBottom.x_ >> 16u);
-                    while (dest < end)
-                    {
-                        if (invZ < *dest)
-                            *dest = invZ;
-                        invZ += gradients.dInvZdXInt_;
-                        ++dest;
-                    }
-
-                    topToBottom.x_ += topToBottom.xStep_;
-                    topToBottom.invZ_ += topToBottom.invZStep_;
-                    middleToBottom.x_ += middleToBottom.xStep_;
-                    row += width_;
-                }
-            }
+            rowEdges[i] = AddFloat4(MulFloat4(SplatFloat4(triangle.edgeA_[i]), sampleX),
+                SplatFloat4(triangle.edgeB_[i] * sampleY + triangle.edgeC_[i]));
+            edgeStepsX[i] = SplatFloat4(4.0f * triangle.edgeA_[i]);
+            edgeStepsY[i] = SplatFloat4(triangle.edgeB_[i]);
         }
-        else
-        {
-            // Top half
-            if (!topDegenerate)
-            {
-                Edge topToMiddle(gradients, vertices[top], vertices[middle], topY);
-                int* row = bufferData + topY * width_;
-                int* endRow = bufferData + middleY * width_;
-                while (row < endRow)
-                {
-                    int invZ = topToMiddle.invZ_;
-                    int* dest = row + (topToMiddle.x_ >> 16u);
-                    int* end = row + (topToBottom.x_ >> 16u);
-                    while (dest < end)
-                    {
-                        if (invZ < *dest)
-                            *dest = invZ;
-                        invZ += gradients.dInvZdXInt_;
-                        ++dest;
-                    }
+        OcclusionFloat4 rowDepth = AddFloat4(MulFloat4(SplatFloat4(triangle.depthA_), sampleX),
+            SplatFloat4(triangle.depthB_ * sampleY + triangle.depthC_));
+        const OcclusionFloat4 depthStepX = SplatFloat4(4.0f * triangle.depthA_);
+        const OcclusionFloat4 depthStepY = SplatFloat4(triangle.depthB_);
 
-                    topToMiddle.x_ += topToMiddle.xStep_;
-                    topToMiddle.invZ_ += topToMiddle.invZStep_;
-                    topToBottom.x_ += topToBottom.xStep_;
-                    row += width_;
-                }
-            }
+        for (int y = top; y <= bottom; ++y)
+        {
+            OcclusionFloat4 edge0 = rowEdges[0];
+            OcclusionFloat4 edge1 = rowEdges[1];
+            OcclusionFloat4 edge2 = rowEdges[2];
+            OcclusionFloat4 depth = rowDepth;
+            int* dest = data_ + y * width_ + left;
 
-            // Bottom half
-            if (!bottomDegenerate)
+            for (int x = left; x <= right; x += 4)
             {
-                Edge middleToBottom(gradients, vertices[middle], vertices[bottom], middleY);
-                int* row = bufferData + middleY * width_;
-                int* endRow = bufferData + bottomY * width_;
-                while (row < endRow)
+                OcclusionInt4 coverage = AndMask(AndMask(GreaterEqualMask(edge0, zero), GreaterEqualMask(edge1, zero)),
+                    GreaterEqualMask(edge2, zero));
+                if (AnyMask(coverage))
                 {
-                    int invZ = middleToBottom.invZ_;
-                    int* dest = row + (middleToBottom.x_ >> 16u);
-                    int* end = row + (topToBottom.x_ >> 16u);
-                    while (dest < end)
-                    {
-                        if (invZ < *dest)
-                            *dest = invZ;
-                        invZ += gradients.dInvZdXInt_;
-                        ++dest;
-                    }
-
-                    middleToBottom.x_ += middleToBottom.xStep_;
-                    middleToBottom.invZ_ += middleToBottom.invZStep_;
-                    topToBottom.x_ += topToBottom.xStep_;
-                    row += width_;
+                    // Clamp to the vertex depth range so that extrapolation near the edges cannot bring the occluder closer
+                    auto newDepth = TruncateInt4(MinFloat4(MaxFloat4(depth, minDepth), maxDepth));
+                    StoreInt4(dest, MinMaskedInt4(LoadInt4(dest), newDepth, coverage));
                 }
-            }
-        }
-    }
-
-    void OcclusionBuffer::MergeBuffers()
-    {
-        URHO3D_PROFILE(MergeBuffers);
 
-        for (unsigned i = 1; i < buffers_.Size(); ++i)
-        {
-            if (!buffers_[i].used_)
-                continue;
-
-            int* src = buffers_[i].data_;
-            int* dest = buffers_[0].data_;
-            int count = width_ * height_;
-
-            while (count--)
-            {
-                // If thread buffer's depth value is closer, overwrite the original
-                if (*src < *dest)
-                    *dest = *src;
-                ++src;
-                ++dest;
+                edge0 = AddFloat4(edge0, edgeStepsX[0]);
+                edge1 = AddFloat4(edge1, edgeStepsX[1]);
+                edge2 = AddFloat4(edge2, edgeStepsX[2]);
+                depth = AddFloat4(depth, depthStepX);
+                dest += 4;
             }
+
+            for (unsigned i = 0; i < 3; ++i)
+                rowEdges[i] = AddFloat4(rowEdges[i], edgeStepsY[i]);
+            rowDepth = AddFloat4(rowDepth, depthStepY);
         }
     }
 
-    void OcclusionBuffer::ClearBuffer(unsigned threadIndex)
+    void OcclusionBuffer::ClearBuffer()
     {
-        if (threadIndex >= buffers_.Size())
+        if (!data_)
             return;
 
-        int* dest = buffers_[threadIndex].data_;
+        int* dest = data_;
         int count = width_ * height_;
         auto fillValue = (int)OCCLUSION_Z_SCALE;
 
@@ -29,6 +29,7 @@
 #include "../Container/ArrayPtr.h"
 #include "../Graphics/GraphicsDefs.h"
 #include "../Math/Frustum.h"
+#include "../Math/Rect.h"
 
 namespace Urho3D
 {
@@ -36,10 +37,7 @@ namespace Urho3D
 class BoundingBox;
 class Camera;
 class IndexBuffer;
-class IntRect;
 class VertexBuffer;
-struct Edge;
-struct Gradients;
 
 /// Occlusion hierarchy depth value.
 struct DepthValue
@@ -50,15 +48,36 @@ struct DepthValue
     int max_;
 };
 
-/// Per-thread occlusion buffer data.
-struct OcclusionBufferData
+/// Screen-space occluder triangle set up for tiled rasterization. Edge functions and depth are plane equations of the form a * x + b * y + c.
+struct OcclusionTriangle
 {
-    /// Full buffer data with safety padding.
-    SharedArrayPtr<int> dataWithSafety_;
-    /// Buffer data.
-    int* data_;
-    /// Use flag.
-    bool used_;
+    /// Edge function X coefficients. A pixel is inside when all edge functions are non-negative.
+    float edgeA_[3];
+    /// Edge function Y coefficients.
+    float edgeB_[3];
+    /// Edge function constants.
+    float edgeC_[3];
+    /// Depth X gradient.
+    float depthA_;
+    /// Depth Y gradient.
+    float depthB_;
+    /// Depth constant.
+    float depthC_;
+    /// Minimum depth of the vertices.
+    float minDepth_;
+    /// Maximum depth of the vertices.
+    float maxDepth_;
+    /// Pixel bounds, inclusive.
+    IntRect rect_;
+};
+
+/// Per-thread triangle setup data.
+struct OcclusionThreadData
+{
+    /// Triangles set up by this thread.
+    PODVector<OcclusionTriangle> triangles_;
+    /// Triangle indices overlapping each tile.
+    Vector<PODVector<unsigned> > bins_;
 };
 
 /// Stored occlusion render job.
@@ -86,8 +105,10 @@ static constexpr float OCCLUSION_RELATIVE_BIAS = 0.00001f;
 static constexpr uint32_t OCCLUSION_FIXED_BIAS = 16;
 static constexpr float OCCLUSION_X_SCALE = 65536.0f;
 static constexpr float OCCLUSION_Z_SCALE = 16777216.0f;
+static constexpr int OCCLUSION_TILE_WIDTH = 64;
+static constexpr int OCCLUSION_TILE_HEIGHT = 32;
 
-/// Software renderer for occlusion.
+/// Software renderer for occlusion. Triangles are set up and binned into screen tiles, then each tile is rasterized with 4-wide edge functions, in worker threads if enabled.
 class URHO3D_API OcclusionBuffer : public Object
 {
     URHO3D_OBJECT(OcclusionBuffer, Object);
@@ -98,7 +119,7 @@ public:
     /// Destruct.
     ~OcclusionBuffer() override;
 
-    /// Set occlusion buffer size and whether to reserve multiple buffers for threading optimization.
+    /// Set occlusion buffer size and whether to use worker threads for triangle setup and tile rasterization.
     bool SetSize(int width, int height, bool threaded);
     /// Set camera view to render from.
     void SetView(Camera* camera);
@@ -110,6 +131,8 @@ public:
     void Reset();
     /// Clear the buffer.
     void Clear();
+    /// Replace the buffer contents with the previous contents reprojected into the current view. Pixels that no previous pixel lands on are cleared. Return false and clear the buffer if there are no previous contents.
+    bool Reproject();
     /// Submit a triangle mesh to the buffer using non-indexed geometry. Return true if did not overflow the allowed triangle count.
     bool AddTriangles(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, unsigned vertexStart, unsigned vertexCount);
     /// Submit a triangle mesh to the buffer using indexed geometry. Return true if did not overflow the allowed triangle count.
@@ -123,7 +146,7 @@ public:
     void ResetUseTimer();
 
     /// Return highest level depth values.
-    int* GetBuffer() const { return buffers_.Size() ? buffers_[0].data_ : nullptr; }
+    int* GetBuffer() const { return data_; }
 
     /// Return view transform matrix.
     const Matrix3x4& GetView() const { return view_; }
@@ -147,15 +170,17 @@ public:
     CullMode GetCullMode() const { return cullMode_; }
 
     /// Return whether is using threads to speed up rendering.
-    bool IsThreaded() const { return buffers_.Size() > 1; }
+    bool IsThreaded() const { return threadData_.Size() > 1; }
 
     /// Test a bounding box for visibility. For best performance, build depth hierarchy first.
     bool IsVisible(const BoundingBox& worldSpaceBox) const;
     /// Return time since last use in milliseconds.
     unsigned GetUseTimer();
 
-    /// Draw a batch. Called internally.
+    /// Transform, clip and bin the triangles of a batch. Called internally.
     void DrawBatch(const OcclusionBatch& batch, unsigned threadIndex);
+    /// Rasterize the binned triangles of a tile. Called internally.
+    void RasterizeTile(unsigned tileIndex);
 
 private:
     /// Apply modelview transform to vertex.
@@ -172,15 +197,25 @@ private:
     void DrawTriangle(Vector4* vertices, unsigned threadIndex);
     /// Clip vertices against a plane.
     void ClipVertices(const Vector4& plane, Vector4* vertices, bool* triangles, unsigned& numTriangles);
-    /// Draw a clipped triangle.
-    void DrawTriangle2D(const Vector3* vertices, bool clockwise, unsigned threadIndex);
-    /// Clear a thread work buffer.
-    void ClearBuffer(unsigned threadIndex);
-    /// Merge thread work buffers into the first buffer.
-    void MergeBuffers();
-
-    /// Highest-level buffer data per thread.
-    Vector<OcclusionBufferData> buffers_;
+    /// Set up a clipped triangle and add it to the bins of the tiles it overlaps.
+    void SetupTriangle(const Vector3* vertices, unsigned threadIndex);
+    /// Rasterize a triangle within a tile.
+    void RasterizeTriangle(const OcclusionTriangle& triangle, const IntRect& tileRect);
+    /// Project a bounding box to a conservative screen rectangle and nearest depth. Return false if the box should be considered visible without testing.
+    bool ProjectBox(const BoundingBox& worldSpaceBox, IntRect& rect, int& z) const;
+    /// Test a projected rectangle against the buffer.
+    bool IsVisible(const IntRect& rect, int z) const;
+    /// Clear the depth buffer.
+    void ClearBuffer();
+
+    /// Full buffer data with safety padding.
+    SharedArrayPtr<int> dataWithSafety_;
+    /// Work buffer for reprojection.
+    SharedArrayPtr<int> reprojectData_;
+    /// Highest-level buffer data.
+    int* data_{};
+    /// Triangle setup data per thread.
+    Vector<OcclusionThreadData> threadData_;
     /// Reduced size depth buffers.
     Vector<SharedArrayPtr<DepthValue> > mipBuffers_;
     /// Submitted render jobs.
@@ -189,6 +224,10 @@ private:
     int width_{};
     /// Buffer height.
     int height_{};
+    /// Number of tiles horizontally.
+    int numTilesX_{};
+    /// Number of tiles vertically.
+    int numTilesY_{};
     /// Number of rendered triangles.
     uint32_t numTriangles_{};
     /// Maximum number of triangles.
@@ -199,12 +238,16 @@ private:
     bool depthHierarchyDirty_{true};
     /// Culling reverse flag.
     bool reverseCulling_{};
+    /// Buffer has contents that can be reprojected flag.
+    bool hasContent_{};
     /// View transform matrix.
     Matrix3x4 view_;
     /// Projection matrix.
     Matrix4 projection_;
     /// Combined view and projection matrix.
     Matrix4 viewProj_;
+    /// Combined view and projection matrix the buffer contents were rendered with.
+    Matrix4 contentViewProj_;
     /// Last used timer.
     Timer useTimer_;
     /// Near clip distance.
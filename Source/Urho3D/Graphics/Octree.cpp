@@ -31,6 +31,7 @@
 #include "../Graphics/Material.h"
 #include "../Graphics/Graphics.h"
 #include "../Graphics/Octree.h"
+#include "../Graphics/RayPacket.h"
 #include "../IO/Log.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
@@ -48,6 +49,13 @@ namespace Urho3D
     static constexpr float DEFAULT_OCTREE_SIZE = 1000.0f;
     static constexpr int DEFAULT_OCTREE_LEVELS = 8;
 
+    static const char* spatialIndexNames[] =
+    {
+        "Octree",
+        "Bounding Volume Hierarchy",
+        nullptr
+    };
+
     extern const char* SUBSYSTEM_CATEGORY;
 
     void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
@@ -65,6 +73,41 @@ namespace Urho3D
         }
     }
 
+    /// Number of rays below which a batched raycast is processed without the work queue.
+    static const unsigned MIN_THREADED_RAYS = 64;
+    /// Number of rays per batched raycast work item.
+    static const unsigned RAYS_PER_WORK_ITEM = 64;
+    /// Bits per axis of the ray origin sort key.
+    static const unsigned RAY_ORIGIN_KEY_BITS = 9;
+
+    /// Batched raycast shared by its work items.
+    struct RayBatchWorkData
+    {
+        /// Octree.
+        const Octree* octree_;
+        /// Query.
+        RayBatchOctreeQuery* query_;
+        /// Per-thread temporary results.
+        Vector<PODVector<RayQueryResult> >* results_;
+    };
+
+    void RaycastBatchWork(const WorkItem* item, unsigned threadIndex)
+    {
+        auto* data = reinterpret_cast<RayBatchWorkData*>(item->aux_);
+        auto* start = reinterpret_cast<const unsigned*>(item->start_);
+        auto* end = reinterpret_cast<const unsigned*>(item->end_);
+        data->octree_->ProcessRayPackets(*data->query_, start, end, (*data->results_)[threadIndex]);
+    }
+
+    /// Spread the low bits of a value so that there are two zero bits between each, for interleaving three values.
+    static inline unsigned long long SpreadBits(unsigned value)
+    {
+        unsigned long long result = 0;
+        for (unsigned i = 0; i < RAY_ORIGIN_KEY_BITS; ++i)
+            result |= (unsigned long long)((value >> i) & 1u) << (i * 3);
+        return result;
+    }
+
     inline bool CompareRayQueryResults(const RayQueryResult& lhs, const RayQueryResult& rhs)
     {
         return lhs.distance_ < rhs.distance_;
@@ -135,6 +178,18 @@ namespace Urho3D
 
     void Octant::InsertDrawable(Drawable* drawable)
     {
+        ++root_->contentVersion_;
+        // Newly added shadow casters invalidate the cached shadow maps they overlap
+        if (this == root_ && !drawable->octant_ && drawable->GetCastShadows())
+            root_->MarkShadowCasterChanged(drawable->GetWorldBoundingBox());
+
+        // When using the bounding volume hierarchy, the root is the only octant
+        if (this == root_ && root_->spatialIndex_ == SPATIAL_INDEX_BVH)
+        {
+            root_->InsertTreeDrawable(drawable);
+            return;
+        }
+
         const BoundingBox& box = drawable->GetWorldBoundingBox();
 
         // If root octant, insert all non-occludees here, so that octant occlusion does not hide the drawable.
@@ -167,6 +222,22 @@ namespace Urho3D
         }
     }
 
+    void Octant::RemoveDrawable(Drawable* drawable, bool resetOctant)
+    {
+        ++root_->contentVersion_;
+        if (resetOctant && drawable->GetCastShadows())
+            root_->MarkShadowCasterChanged(drawable->worldBoundingBox_);
+
+        if (DrawableTree::Contains(drawable))
+            root_->tree_.Remove(drawable);
+        else if (!drawables_.Remove(drawable))
+            return;
+
+        if (resetOctant)
+            drawable->SetOctant(nullptr);
+        DecDrawableCount();
+    }
+
     bool Octant::CheckDrawableFit(const BoundingBox& box) const
     {
         Vector3 boxSize = box.Size();
@@ -256,6 +327,30 @@ namespace Urho3D
         }
     }
 
+    void Octant::GetDrawablesInternal(MultiFrustumOctreeQuery& query, unsigned activeMask, unsigned insideMask) const
+    {
+        if (this != root_)
+        {
+            query.TestOctant(cullingBox_, activeMask, insideMask);
+            // Cull this octant, its children & drawables once it is outside all frustums
+            if (!activeMask)
+                return;
+        }
+
+        if (drawables_.Size())
+        {
+            auto** start = const_cast<Drawable**>(&drawables_[0]);
+            Drawable** end = start + drawables_.Size();
+            query.TestDrawables(start, end, activeMask, insideMask);
+        }
+
+        for (auto child : children_)
+        {
+            if (child)
+                child->GetDrawablesInternal(query, activeMask, insideMask);
+        }
+    }
+
     void Octant::GetDrawablesInternal(RayOctreeQuery& query) const
     {
         float octantDist = query.ray_.HitDistance(cullingBox_);
@@ -310,10 +405,34 @@ namespace Urho3D
         }
     }
 
+    void Octant::GetDrawablesInternal(RayPacket& packet, unsigned directionSigns) const
+    {
+        if (!packet.HitMask(cullingBox_))
+            return;
+
+        if (drawables_.Size())
+        {
+            auto** start = const_cast<Drawable**>(&drawables_[0]);
+            packet.ProcessDrawables(start, start + drawables_.Size());
+        }
+
+        // Visit the children nearest to the ray origins first, so that close hits cull the rest early
+        for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+        {
+            Octant* child = children_[i ^ directionSigns];
+            if (child)
+                child->GetDrawablesInternal(packet, directionSigns);
+        }
+    }
+
     Octree::Octree(Context* context) :
         Component(context),
         Octant(BoundingBox(-DEFAULT_OCTREE_SIZE, DEFAULT_OCTREE_SIZE), 0, nullptr, this),
-        numLevels_(DEFAULT_OCTREE_LEVELS)
+        numLevels_(DEFAULT_OCTREE_LEVELS),
+        spatialIndex_(SPATIAL_INDEX_OCTREE),
+        frameNumber_(0),
+        contentVersion_(0),
+        numUpdates_(0)
     {
         // If the engine is running headless, subscribe to RenderUpdate events for manually updating the octree
         // to allow raycasts and animation update
@@ -326,6 +445,12 @@ namespace Urho3D
         // Reset root pointer from all child octants now so that they do not move their drawables to root
         drawableUpdates_.Clear();
         ResetRoot();
+
+        PODVector<Drawable*> treeDrawables;
+        tree_.GetAllDrawables(treeDrawables);
+        for (PODVector<Drawable*>::Iterator i = treeDrawables.Begin(); i != treeDrawables.End(); ++i)
+            (*i)->SetOctant(nullptr);
+        tree_.Clear();
     }
 
     void Octree::RegisterObject(Context* context)
@@ -338,6 +463,7 @@ namespace Urho3D
         URHO3D_ATTRIBUTE_EX("Bounding Box Min", Vector3, worldBoundingBox_.min_, UpdateOctreeSize, defaultBoundsMin, AM_DEFAULT);
         URHO3D_ATTRIBUTE_EX("Bounding Box Max", Vector3, worldBoundingBox_.max_, UpdateOctreeSize, defaultBoundsMax, AM_DEFAULT);
         URHO3D_ATTRIBUTE_EX("Number of Levels", int, numLevels_, UpdateOctreeSize, DEFAULT_OCTREE_LEVELS, AM_DEFAULT);
+        URHO3D_ENUM_ACCESSOR_ATTRIBUTE("Spatial Index", GetSpatialIndex, SetSpatialIndex, SpatialIndexType, spatialIndexNames, SPATIAL_INDEX_OCTREE, AM_DEFAULT);
     }
 
     void Octree::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
@@ -347,6 +473,7 @@ namespace Urho3D
             URHO3D_PROFILE(OctreeDrawDebug);
 
             Octant::DrawDebugGeometry(debug, depthTest);
+            tree_.DrawDebugGeometry(debug, depthTest);
         }
     }
 
@@ -359,8 +486,45 @@ namespace Urho3D
             DeleteChild(i);
 
         Initialize(box);
-        numDrawables_ = drawables_.Size();
+        numDrawables_ = drawables_.Size() + tree_.GetNumDrawables();
         numLevels_ = Max(numLevels, 1U);
+        ++contentVersion_;
+    }
+
+    void Octree::SetSpatialIndex(SpatialIndexType type)
+    {
+        if (type == spatialIndex_)
+            return;
+
+        URHO3D_PROFILE(ChangeSpatialIndex);
+        ++contentVersion_;
+
+        // Gather all drawables to the root. Deleting the child octants queues their drawables for reinsertion
+        for (unsigned i = 0; i < NUM_OCTANTS; ++i)
+            DeleteChild(i);
+
+        PODVector<Drawable*> drawables;
+        drawables.Swap(drawables_);
+        tree_.GetAllDrawables(drawables);
+        tree_.Clear();
+
+        spatialIndex_ = type;
+
+        // The drawable count does not change, as all drawables already belong to the root
+        tree_.BeginBatch();
+        for (PODVector<Drawable*>::Iterator i = drawables.Begin(); i != drawables.End(); ++i)
+        {
+            Drawable* drawable = *i;
+            if (spatialIndex_ == SPATIAL_INDEX_BVH && drawable->IsOccludee() && drawable->GetWorldBoundingBox().Defined())
+                tree_.Insert(drawable, frameNumber_);
+            else
+            {
+                drawables_.Push(drawable);
+                if (spatialIndex_ == SPATIAL_INDEX_OCTREE && !drawable->updateQueued_)
+                    QueueUpdate(drawable);
+            }
+        }
+        tree_.EndBatch();
     }
 
     void Octree::Update(const FrameInfo& frame)
@@ -371,6 +535,8 @@ namespace Urho3D
             return;
         }
 
+        frameNumber_ = frame.frameNumber_;
+
         // Let drawables update themselves before reinsertion. This can be used for animation
         if (!drawableUpdates_.Empty())
         {
@@ -445,6 +611,7 @@ namespace Urho3D
         {
             URHO3D_PROFILE(ReinsertToOctree);
 
+            tree_.BeginBatch();
             for (PODVector<Drawable*>::Iterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
             {
                 Drawable* drawable = *i;
@@ -455,6 +622,13 @@ namespace Urho3D
                 // Skip if no octant or does not belong to this octree anymore
                 if (!octant || octant->GetRoot() != this)
                     continue;
+                if (drawable->GetCastShadows())
+                    MarkShadowCasterChanged(box);
+                if (spatialIndex_ == SPATIAL_INDEX_BVH)
+                {
+                    InsertTreeDrawable(drawable);
+                    continue;
+                }
                 // Skip if still fits the current octant
                 if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
                     continue;
@@ -471,9 +645,20 @@ namespace Urho3D
                 }
 #endif
             }
+            tree_.EndBatch();
         }
 
         drawableUpdates_.Clear();
+
+        if (spatialIndex_ == SPATIAL_INDEX_BVH)
+        {
+            URHO3D_PROFILE(UpdateDrawableTree);
+            tree_.Update(frameNumber_);
+        }
+
+        changedShadowCasters_.Swap(pendingShadowCasterChanges_);
+        pendingShadowCasterChanges_.Clear();
+        ++numUpdates_;
     }
 
     void Octree::AddManualDrawable(Drawable* drawable)
@@ -482,6 +667,9 @@ namespace Urho3D
             return;
 
         AddDrawable(drawable);
+        ++contentVersion_;
+        if (drawable->GetCastShadows())
+            MarkShadowCasterChanged(drawable->GetWorldBoundingBox());
     }
 
     void Octree::RemoveManualDrawable(Drawable* drawable)
@@ -498,6 +686,18 @@ namespace Urho3D
     {
         query.result_.Clear();
         GetDrawablesInternal(query, false);
+        tree_.GetDrawables(query);
+    }
+
+    void Octree::GetDrawables(MultiFrustumOctreeQuery& query) const
+    {
+        query.result_.Clear();
+        query.resultMasks_.Clear();
+        if (!query.numFrustums_)
+            return;
+
+        GetDrawablesInternal(query, query.GetFrustumsMask(), 0);
+        tree_.GetDrawables(query);
     }
 
     void Octree::Raycast(RayOctreeQuery& query) const
@@ -506,6 +706,7 @@ namespace Urho3D
 
         query.result_.Clear();
         GetDrawablesInternal(query);
+        tree_.GetDrawables(query);
         Sort(query.result_.Begin(), query.result_.End(), CompareRayQueryResults);
     }
 
@@ -516,6 +717,7 @@ namespace Urho3D
         query.result_.Clear();
         rayQueryDrawables_.Clear();
         GetDrawablesOnlyInternal(query, rayQueryDrawables_);
+        tree_.GetDrawablesOnly(query, rayQueryDrawables_);
 
         // Sort by increasing hit distance to AABB
         for (PODVector<Drawable*>::Iterator i = rayQueryDrawables_.Begin(); i != rayQueryDrawables_.End(); ++i)
@@ -549,6 +751,85 @@ namespace Urho3D
         }
     }
 
+    void Octree::RaycastBatch(RayBatchOctreeQuery& query) const
+    {
+        URHO3D_PROFILE(RaycastBatch);
+
+        unsigned numRays = query.numRays_;
+        RayQueryResult noHit;
+        noHit.distance_ = M_INFINITY;
+        query.result_.Resize(numRays);
+        for (unsigned i = 0; i < numRays; ++i)
+            query.result_[i] = noHit;
+
+        if (!numRays)
+            return;
+
+        // Sort the rays by direction signs and then by origin along a Morton curve, so that the rays of each packet are coherent
+        const unsigned maxCoord = (1u << RAY_ORIGIN_KEY_BITS) - 1;
+        const BoundingBox& bounds = worldBoundingBox_;
+        Vector3 scale = Vector3::ONE * (float)maxCoord / VectorMax(bounds.Size(), Vector3(M_EPSILON, M_EPSILON, M_EPSILON));
+
+        // The scratch buffers are local so that batches may be raycast from several threads at once
+        PODVector<unsigned long long> keys(numRays);
+        for (unsigned i = 0; i < numRays; ++i)
+        {
+            const Ray& ray = query.rays_[i];
+            Vector3 position = (ray.origin_ - bounds.min_) * scale;
+            auto x = (unsigned)Clamp(position.x_, 0.0f, (float)maxCoord);
+            auto y = (unsigned)Clamp(position.y_, 0.0f, (float)maxCoord);
+            auto z = (unsigned)Clamp(position.z_, 0.0f, (float)maxCoord);
+            unsigned signs = (ray.direction_.x_ < 0.0f ? 1u : 0u) | (ray.direction_.y_ < 0.0f ? 2u : 0u) |
+                (ray.direction_.z_ < 0.0f ? 4u : 0u);
+            unsigned long long key = ((unsigned long long)signs << (3 * RAY_ORIGIN_KEY_BITS)) | SpreadBits(x) | (SpreadBits(y) << 1) |
+                (SpreadBits(z) << 2);
+            keys[i] = (key << 32) | i;
+        }
+
+        Sort(keys.Begin(), keys.End());
+        PODVector<unsigned> order(numRays);
+        for (unsigned i = 0; i < numRays; ++i)
+            order[i] = (unsigned)(keys[i] & M_MAX_UNSIGNED);
+
+        // The work queue can only be completed from the main thread
+        auto* queue = GetSubsystem<WorkQueue>();
+        unsigned numThreads = queue && Thread::IsMainThread() ? queue->GetNumThreads() + 1 : 1;
+        Vector<PODVector<RayQueryResult> > results(numThreads);
+
+        if (numThreads == 1 || numRays < MIN_THREADED_RAYS)
+        {
+            ProcessRayPackets(query, &order[0], &order[0] + numRays, results[0]);
+            return;
+        }
+
+        RayBatchWorkData data{ this, &query, &results };
+        for (unsigned first = 0; first < numRays; first += RAYS_PER_WORK_ITEM)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = RaycastBatchWork;
+            item->aux_ = &data;
+            item->start_ = &order[first];
+            item->end_ = &order[0] + Min(first + RAYS_PER_WORK_ITEM, numRays);
+            queue->AddWorkItem(item);
+        }
+
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+
+    void Octree::ProcessRayPackets(RayBatchOctreeQuery& query, const unsigned* start, const unsigned* end,
+        PODVector<RayQueryResult>& scratch) const
+    {
+        while (start != end)
+        {
+            unsigned count = Min((unsigned)(end - start), RAY_PACKET_SIZE);
+            RayPacket packet(query, start, count, scratch);
+            GetDrawablesInternal(packet, packet.GetDirectionSigns());
+            tree_.GetDrawables(packet);
+            start += count;
+        }
+    }
+
     void Octree::QueueUpdate(Drawable* drawable)
     {
         Scene* scene = GetScene();
@@ -556,9 +837,16 @@ namespace Urho3D
         {
             lock_guard<mutex> lock(octreeMutex_);
             threadedDrawableUpdates_.Push(drawable);
+            // The world bounding box is not recalculated yet, so it is the shadow caster's old position
+            if (drawable->GetCastShadows() && drawable->worldBoundingBox_.Defined())
+                pendingShadowCasterChanges_.Push(drawable->worldBoundingBox_);
         }
         else
+        {
             drawableUpdates_.Push(drawable);
+            if (drawable->GetCastShadows())
+                MarkShadowCasterChanged(drawable->worldBoundingBox_);
+        }
 
         drawable->updateQueued_ = true;
     }
@@ -571,6 +859,37 @@ namespace Urho3D
         drawable->updateQueued_ = false;
     }
 
+    void Octree::MarkShadowCasterChanged(const BoundingBox& box)
+    {
+        if (box.Defined())
+            pendingShadowCasterChanges_.Push(box);
+    }
+
+    void Octree::InsertTreeDrawable(Drawable* drawable)
+    {
+        if (drawable->IsOccludee() && drawable->GetWorldBoundingBox().Defined())
+        {
+            if (DrawableTree::Contains(drawable))
+                tree_.Move(drawable, frameNumber_);
+            else
+            {
+                // Remove first, as the removal checks whether the drawable is in the tree
+                if (drawable->octant_)
+                    drawable->octant_->RemoveDrawable(drawable, false);
+                tree_.Insert(drawable, frameNumber_);
+                drawable->SetOctant(this);
+                IncDrawableCount();
+                ++contentVersion_;
+            }
+        }
+        else if (drawable->octant_ != this || DrawableTree::Contains(drawable))
+        {
+            if (drawable->octant_)
+                drawable->octant_->RemoveDrawable(drawable, false);
+            AddDrawable(drawable);
+        }
+    }
+
     void Octree::DrawDebugGeometry(bool depthTest)
     {
         auto* debug = GetComponent<DebugRenderer>();
@@ -23,16 +23,26 @@
 #pragma once
 
 #include "../Graphics/Drawable.h"
+#include "../Graphics/DrawableTree.h"
 #include "../Graphics/OctreeQuery.h"
 #include <mutex>
 
 namespace Urho3D
 {
     class Octree;
+    class RayPacket;
+    struct WorkItem;
 
     static const int NUM_OCTANTS = 8;
     static const unsigned ROOT_INDEX = M_MAX_UNSIGNED;
 
+    /// Spatial index used by the octree component.
+    enum SpatialIndexType
+    {
+        SPATIAL_INDEX_OCTREE = 0,
+        SPATIAL_INDEX_BVH
+    };
+
     /// %Octree octant.
     /// @nobind
     class URHO3D_API Octant
@@ -61,15 +71,7 @@ namespace Urho3D
         }
 
         /// Remove a drawable object from this octant.
-        void RemoveDrawable(Drawable* drawable, bool resetOctant = true)
-        {
-            if (drawables_.Remove(drawable))
-            {
-                if (resetOctant)
-                    drawable->SetOctant(nullptr);
-                DecDrawableCount();
-            }
-        }
+        void RemoveDrawable(Drawable* drawable, bool resetOctant = true);
 
         /// Return world-space bounding box.
         /// @property
@@ -104,10 +106,14 @@ namespace Urho3D
         void Initialize(const BoundingBox& box);
         /// Return drawable objects by a query, called internally.
         void GetDrawablesInternal(OctreeQuery& query, bool inside) const;
+        /// Return drawable objects by a multi-frustum query, called internally.
+        void GetDrawablesInternal(MultiFrustumOctreeQuery& query, unsigned activeMask, unsigned insideMask) const;
         /// Return drawable objects by a ray query, called internally.
         void GetDrawablesInternal(RayOctreeQuery& query) const;
         /// Return drawable objects only for a threaded ray query, called internally.
         void GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*>& drawables) const;
+        /// Process a ray packet of a batched raycast, visiting child octants front to back, called internally.
+        void GetDrawablesInternal(RayPacket& packet, unsigned directionSigns) const;
 
         /// Increase drawable object count recursively.
         void IncDrawableCount()
@@ -162,6 +168,9 @@ namespace Urho3D
     {
         URHO3D_OBJECT(Octree, Component);
 
+        friend class Octant;
+        friend void RaycastBatchWork(const WorkItem* item, unsigned threadIndex);
+
     public:
         /// Construct.
         explicit Octree(Context* context);
@@ -176,6 +185,9 @@ namespace Urho3D
 
         /// Set size and maximum subdivision levels. If octree is not empty, drawable objects will be temporarily moved to the root.
         void SetSize(const BoundingBox& box, unsigned numLevels);
+        /// Set spatial index. The bounding volume hierarchy ignores the size and subdivision levels. Drawable objects are moved to the new index.
+        /// @property
+        void SetSpatialIndex(SpatialIndexType type);
         /// Update and reinsert drawable objects.
         void Update(const FrameInfo& frame);
         /// Add a drawable manually.
@@ -186,19 +198,41 @@ namespace Urho3D
         /// Return drawable objects by a query.
         /// @nobind
         void GetDrawables(OctreeQuery& query) const;
+        /// Return drawable objects by a multi-frustum query.
+        /// @nobind
+        void GetDrawables(MultiFrustumOctreeQuery& query) const;
         /// Return drawable objects by a ray query.
         void Raycast(RayOctreeQuery& query) const;
         /// Return the closest drawable object by a ray query.
         void RaycastSingle(RayOctreeQuery& query) const;
+        /// Return the closest drawable object for each ray of a batched query. Coherent rays are grouped into packets that traverse the octree together. When called from the main thread, the packets are processed on the work queue.
+        void RaycastBatch(RayBatchOctreeQuery& query) const;
 
         /// Return subdivision levels.
         /// @property
         unsigned GetNumLevels() const { return numLevels_; }
 
+        /// Return spatial index.
+        /// @property
+        SpatialIndexType GetSpatialIndex() const { return spatialIndex_; }
+
+        /// Return bounding volume hierarchy. Contains the occludee drawables when the spatial index is SPATIAL_INDEX_BVH.
+        /// @nobind
+        const DrawableTree& GetTree() const { return tree_; }
+        /// Return a counter that changes whenever drawables are added, removed or moved to another octant or into the bounding volume hierarchy. Drawables that move within their octant or tree leaf do not change it. Used to check whether query results stored during the frame are still valid.
+        unsigned GetContentVersion() const { return contentVersion_; }
+        /// Return world bounding boxes of shadow casters that were moved, added or removed before the last update, at both their old and new positions. Used to invalidate cached shadow maps.
+        /// @nobind
+        const PODVector<BoundingBox>& GetChangedShadowCasters() const { return changedShadowCasters_; }
+        /// Return number of updates performed.
+        unsigned GetNumUpdates() const { return numUpdates_; }
+
         /// Mark drawable object as requiring an update and a reinsertion.
         void QueueUpdate(Drawable* drawable);
         /// Cancel drawable object's update.
         void CancelUpdate(Drawable* drawable);
+        /// Record a change of shadow casters within a world bounding box, so that cached shadow maps overlapping it are rendered again.
+        void MarkShadowCasterChanged(const BoundingBox& box);
         /// Visualize the component as debug geometry.
         void DrawDebugGeometry(bool depthTest);
 
@@ -207,6 +241,10 @@ namespace Urho3D
         void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
         /// Update octree size.
         void UpdateOctreeSize() { SetSize(worldBoundingBox_, numLevels_); }
+        /// Insert or reinsert a drawable when using the bounding volume hierarchy. Non-occludees and drawables without bounds are kept in the root octant, so that occlusion does not hide them.
+        void InsertTreeDrawable(Drawable* drawable);
+        /// Process a range of sorted rays of a batched raycast in packets, using a temporary result vector of the calling thread.
+        void ProcessRayPackets(RayBatchOctreeQuery& query, const unsigned* start, const unsigned* end, PODVector<RayQueryResult>& scratch) const;
 
         /// Drawable objects that require update.
         PODVector<Drawable*> drawableUpdates_;
@@ -218,5 +256,19 @@ namespace Urho3D
         mutable PODVector<Drawable*> rayQueryDrawables_;
         /// Subdivision level.
         uint32_t numLevels_;
+        /// Spatial index.
+        SpatialIndexType spatialIndex_;
+        /// Bounding volume hierarchy.
+        DrawableTree tree_;
+        /// Frame number of the last update.
+        unsigned frameNumber_;
+        /// Content change counter.
+        unsigned contentVersion_;
+        /// Number of updates performed.
+        unsigned numUpdates_;
+        /// Bounding boxes of shadow casters changed since the last update.
+        PODVector<BoundingBox> pendingShadowCasterChanges_;
+        /// Bounding boxes of shadow casters changed before the last update.
+        PODVector<BoundingBox> changedShadowCasters_;
     };
 }
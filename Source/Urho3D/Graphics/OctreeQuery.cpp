@@ -116,6 +116,72 @@ void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool in
     }
 }
 
+unsigned MultiFrustumOctreeQuery::AddFrustum(const Frustum& frustum, unsigned viewMask)
+{
+    if (numFrustums_ >= MAX_QUERY_FRUSTUMS)
+        return 0;
+
+    frustums_[numFrustums_] = frustum;
+    viewMasks_[numFrustums_] = viewMask;
+    return 1u << numFrustums_++;
+}
+
+void MultiFrustumOctreeQuery::TestOctant(const BoundingBox& box, unsigned& activeMask, unsigned& insideMask) const
+{
+    unsigned testMask = activeMask & ~insideMask;
+
+    for (unsigned i = 0; testMask; ++i, testMask >>= 1)
+    {
+        if (!(testMask & 1))
+            continue;
+
+        Intersection res = frustums_[i].IsInside(box);
+        if (res == OUTSIDE)
+            activeMask &= ~(1u << i);
+        else if (res == INSIDE)
+            insideMask |= 1u << i;
+    }
+}
+
+void MultiFrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, unsigned activeMask, unsigned insideMask)
+{
+    while (start != end)
+    {
+        Drawable* drawable = *start++;
+
+        if (!(drawable->GetDrawableFlags() & drawableFlags_) || (shadowCasters_ && !drawable->GetCastShadows()))
+            continue;
+
+        unsigned drawableViewMask = drawable->GetViewMask();
+        unsigned mask = 0;
+        const BoundingBox* box = nullptr;
+
+        unsigned testMask = activeMask;
+        for (unsigned i = 0; testMask; ++i, testMask >>= 1)
+        {
+            if (!(testMask & 1) || !(drawableViewMask & viewMasks_[i]))
+                continue;
+
+            unsigned bit = 1u << i;
+            if (!(insideMask & bit))
+            {
+                // Fetch the bounding box only once, as it may need to be recalculated
+                if (!box)
+                    box = &drawable->GetWorldBoundingBox();
+                if (!frustums_[i].IsInsideFast(*box))
+                    continue;
+            }
+            mask |= bit;
+        }
+
+        if (mask)
+        {
+            result_.Push(drawable);
+            resultMasks_.Push(mask);
+        }
+    }
+}
+
 
 Intersection AllContentOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
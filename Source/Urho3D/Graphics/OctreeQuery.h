@@ -157,6 +157,58 @@ namespace Urho3D
         Frustum frustum_;
     };
 
+    /// Maximum number of frustums in a multi-frustum octree query.
+    static const unsigned MAX_QUERY_FRUSTUMS = 32;
+
+    /// %Frustum octree query against several frustums at once, for example all views of a scene or all splits of a shadowed light. Each octant and drawable is visited once and tested only against the frustums that may still contain it. The result holds the drawables inside any of the frustums, with a parallel bitmask of the frustums each is inside of.
+    /// @nobind
+    class URHO3D_API MultiFrustumOctreeQuery
+    {
+    public:
+        /// Construct with result vectors and query parameters.
+        MultiFrustumOctreeQuery(PODVector<Drawable*>& result, PODVector<unsigned>& resultMasks, unsigned char drawableFlags = DRAWABLE_ANY,
+            bool shadowCasters = false) :
+            result_(result),
+            resultMasks_(resultMasks),
+            numFrustums_(0),
+            drawableFlags_(drawableFlags),
+            shadowCasters_(shadowCasters)
+        {
+        }
+
+        /// Prevent copy construction.
+        MultiFrustumOctreeQuery(const MultiFrustumOctreeQuery& rhs) = delete;
+        /// Prevent assignment.
+        MultiFrustumOctreeQuery& operator =(const MultiFrustumOctreeQuery& rhs) = delete;
+
+        /// Add a frustum with the drawable layers to include for it. Return its bit in the result masks, or 0 if the query is full.
+        unsigned AddFrustum(const Frustum& frustum, unsigned viewMask = DEFAULT_VIEWMASK);
+        /// Intersection test for an octant against the frustums in activeMask. Remove the frustums the box is outside of from activeMask and add the ones it is fully inside of to insideMask.
+        void TestOctant(const BoundingBox& box, unsigned& activeMask, unsigned& insideMask) const;
+        /// Intersection test for drawables against the frustums in activeMask. Frustums in insideMask are known to contain the drawables.
+        void TestDrawables(Drawable** start, Drawable** end, unsigned activeMask, unsigned insideMask);
+
+        /// Return number of frustums.
+        unsigned GetNumFrustums() const { return numFrustums_; }
+        /// Return bitmask of all frustums.
+        unsigned GetFrustumsMask() const { return numFrustums_ < MAX_QUERY_FRUSTUMS ? (1u << numFrustums_) - 1 : M_MAX_UNSIGNED; }
+
+        /// Result vector reference.
+        PODVector<Drawable*>& result_;
+        /// Result frustum bitmask vector reference, one per result drawable.
+        PODVector<unsigned>& resultMasks_;
+        /// Frustums.
+        Frustum frustums_[MAX_QUERY_FRUSTUMS];
+        /// Drawable layers to include for each frustum.
+        unsigned viewMasks_[MAX_QUERY_FRUSTUMS];
+        /// Number of frustums.
+        unsigned numFrustums_;
+        /// Drawable flags to include.
+        unsigned char drawableFlags_;
+        /// Include only shadow casters flag.
+        bool shadowCasters_;
+    };
+
     /// General octree query result. Used for Lua bindings only.
     struct URHO3D_API OctreeQueryResult
     {
@@ -259,6 +311,58 @@ namespace Urho3D
         RayQueryLevel level_;
     };
 
+    /// Batched closest-hit raycast octree query. Holds one result per ray in the same order as the rays. Rays that hit nothing get a result with null drawable and infinite distance.
+    /// @nobind
+    class URHO3D_API RayBatchOctreeQuery
+    {
+    public:
+        /// Construct with rays and query parameters.
+        RayBatchOctreeQuery(PODVector<RayQueryResult>& result, const Ray* rays, unsigned numRays, RayQueryLevel level = RAY_TRIANGLE,
+            float maxDistance = M_INFINITY, unsigned char drawableFlags = DRAWABLE_ANY, unsigned viewMask = DEFAULT_VIEWMASK) :
+            result_(result),
+            rays_(rays),
+            numRays_(numRays),
+            maxDistances_(nullptr),
+            drawableFlags_(drawableFlags),
+            viewMask_(viewMask),
+            maxDistance_(maxDistance),
+            level_(level)
+        {
+        }
+
+        /// Construct with a vector of rays and query parameters.
+        RayBatchOctreeQuery(PODVector<RayQueryResult>& result, const PODVector<Ray>& rays, RayQueryLevel level = RAY_TRIANGLE,
+            float maxDistance = M_INFINITY, unsigned char drawableFlags = DRAWABLE_ANY, unsigned viewMask = DEFAULT_VIEWMASK) :
+            RayBatchOctreeQuery(result, rays.Buffer(), rays.Size(), level, maxDistance, drawableFlags, viewMask)
+        {
+        }
+
+        /// Prevent copy construction.
+        RayBatchOctreeQuery(const RayBatchOctreeQuery& rhs) = delete;
+        /// Prevent assignment.
+        RayBatchOctreeQuery& operator =(const RayBatchOctreeQuery& rhs) = delete;
+
+        /// Return maximum distance of a ray.
+        float GetMaxDistance(unsigned index) const { return maxDistances_ ? Min(maxDistances_[index], maxDistance_) : maxDistance_; }
+
+        /// Result vector reference.
+        PODVector<RayQueryResult>& result_;
+        /// Rays.
+        const Ray* rays_;
+        /// Number of rays.
+        unsigned numRays_;
+        /// Optional per-ray maximum distances, for example to the targets of line of sight checks. Null to use maxDistance_ for all rays.
+        const float* maxDistances_;
+        /// Drawable flags to include.
+        unsigned char drawableFlags_;
+        /// Drawable layers to include.
+        unsigned viewMask_;
+        /// Maximum ray distance.
+        float maxDistance_;
+        /// Raycast detail level.
+        RayQueryLevel level_;
+    };
+
     /// @nobind
     class URHO3D_API AllContentOctreeQuery : public OctreeQuery
     {
@@ -40,6 +40,7 @@
 #include "../../Graphics/TextureCube.h"
 #include "../../Graphics/VertexBuffer.h"
 #include "../../IO/File.h"
+#include "../../IO/FileSystem.h"
 #include "../../IO/Log.h"
 #include "../../Resource/ResourceCache.h"
 
@@ -216,7 +217,11 @@ namespace Urho3D
         GL_FLOAT,
         GL_FLOAT,
         GL_UNSIGNED_BYTE,
-        GL_UNSIGNED_BYTE
+        GL_UNSIGNED_BYTE,
+        GL_HALF_FLOAT,
+        GL_HALF_FLOAT,
+        GL_BYTE,
+        GL_SHORT
     };
 
     static const GLenum glElementComponents[] =
@@ -227,9 +232,28 @@ namespace Urho3D
         3,
         4,
         4,
+        4,
+        2,
+        4,
+        4,
         4
     };
 
+    static const GLboolean glElementNormalized[] =
+    {
+        GL_FALSE,
+        GL_FALSE,
+        GL_FALSE,
+        GL_FALSE,
+        GL_FALSE,
+        GL_FALSE,
+        GL_TRUE,
+        GL_FALSE,
+        GL_FALSE,
+        GL_TRUE,
+        GL_TRUE
+    };
+
 #if ALIMER_OPENGLES
     static constexpr GLenum glesDepthStencilFormat = GL_DEPTH_COMPONENT16;
 #endif
@@ -243,6 +267,48 @@ namespace Urho3D
         return extensions.Contains(name);
     }
 
+    static const unsigned PROGRAM_CACHE_VERSION = 2;
+
+    /// Update a 64-bit FNV-1a hash with a string, including its terminator so that concatenations do not collide.
+    static unsigned long long HashProgramSource(const String& str, unsigned long long hash)
+    {
+        const char* chars = str.CString();
+        for (unsigned i = 0; i <= str.Length(); ++i)
+        {
+            hash ^= (unsigned char)chars[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static unsigned long long GetProgramBinaryKey(ShaderVariation* vs, ShaderVariation* ps, ShaderProgramBinary* check = nullptr)
+    {
+        // Identify the program by the source code and defines of both shaders, so that edited shaders are not loaded from the cache
+        Shader* vsOwner = vs->GetOwner();
+        Shader* psOwner = ps->GetOwner();
+        if (!vsOwner || !psOwner)
+            return 0;
+
+        const String& vsSource = vsOwner->GetSourceCode(VS);
+        const String& psSource = psOwner->GetSourceCode(PS);
+        unsigned vsHash = StringHash::Calculate(vs->GetDefines().CString(), StringHash::Calculate(vsSource.CString()));
+        unsigned psHash = StringHash::Calculate(ps->GetDefines().CString(), StringHash::Calculate(psSource.CString()));
+
+        // The key may collide, so also return an independent hash and the length of the sources to verify the entry against
+        if (check)
+        {
+            unsigned long long hash = 14695981039346656037ull;
+            hash = HashProgramSource(vs->GetDefines(), hash);
+            hash = HashProgramSource(vsSource, hash);
+            hash = HashProgramSource(ps->GetDefines(), hash);
+            hash = HashProgramSource(psSource, hash);
+            check->sourceHash_ = hash;
+            check->sourceLength_ = vs->GetDefines().Length() + vsSource.Length() + ps->GetDefines().Length() + psSource.Length();
+        }
+
+        return (unsigned long long)vsHash << 32u | psHash;
+    }
+
     static void GetGLPrimitiveType(uint32_t elementCount, PrimitiveType type, uint32_t& primitiveCount, GLenum& glPrimitiveType)
     {
         switch (type)
@@ -507,6 +573,8 @@ namespace Urho3D
         if (!IsInitialized())
             return;
 
+        SaveShaderProgramCache();
+
         // Actually close the window
         Release(true, true);
     }
@@ -890,8 +958,42 @@ namespace Urho3D
         if (vs == vertexShader_ && ps == pixelShader_)
             return;
 
+        // Check for an existing program first, then for a cached program binary. Neither needs the shaders compiled
+        std::pair<ShaderVariation*, ShaderVariation*> combination(vs, ps);
+        ShaderProgramMap::iterator i = impl_->shaderPrograms_.find(combination);
+        if (i == impl_->shaderPrograms_.end() && vs && ps && !impl_->programBinaries_.empty())
+        {
+            ShaderProgramBinary check;
+            auto binary = impl_->programBinaries_.find(GetProgramBinaryKey(vs, ps, &check));
+            if (binary != impl_->programBinaries_.end() &&
+                (binary->second.sourceHash_ != check.sourceHash_ || binary->second.sourceLength_ != check.sourceLength_))
+            {
+                // Key collision with another program, link from source and store this program instead
+                impl_->programBinaries_.erase(binary);
+                impl_->programBinariesDirty_ = true;
+            }
+            else if (binary != impl_->programBinaries_.end())
+            {
+                URHO3D_PROFILE(LoadShaderProgramBinary);
+
+                SharedPtr<ShaderProgram> newProgram(new ShaderProgram(this, vs, ps));
+                if (newProgram->LinkBinary(binary->second.format_, binary->second.data_))
+                {
+                    URHO3D_LOGDEBUG("Loaded program binary of vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName());
+                    i = impl_->shaderPrograms_.insert(std::make_pair(combination, newProgram)).first;
+                }
+                else
+                {
+                    // Stale binary, link from source instead
+                    impl_->programBinaries_.erase(binary);
+                    impl_->programBinariesDirty_ = true;
+                }
+            }
+        }
+
         // Compile the shaders now if not yet compiled. If already attempted, do not retry
-        if (vs && !vs->GetGPUObjectName())
+        bool needCompile = i == impl_->shaderPrograms_.end();
+        if (needCompile && vs && !vs->GetGPUObjectName())
         {
             if (vs->GetCompilerOutput().Empty())
             {
@@ -910,7 +1012,7 @@ namespace Urho3D
                 vs = nullptr;
         }
 
-        if (ps && !ps->GetGPUObjectName())
+        if (needCompile && ps && !ps->GetGPUObjectName())
         {
             if (ps->GetCompilerOutput().Empty())
             {
@@ -941,9 +1043,6 @@ namespace Urho3D
             vertexShader_ = vs;
             pixelShader_ = ps;
 
-            std::pair<ShaderVariation*, ShaderVariation*> combination(vs, ps);
-            ShaderProgramMap::iterator i = impl_->shaderPrograms_.find(combination);
-
             if (i != impl_->shaderPrograms_.end())
             {
                 // Use the existing linked program
@@ -970,6 +1069,24 @@ namespace Urho3D
                     // Note: Link() calls glUseProgram() to set the texture sampler uniforms,
                     // so it is not necessary to call it again
                     impl_->shaderProgram_ = newProgram;
+
+                    // Store the program binary to skip compiling and linking on later runs
+                    if (impl_->programBinarySupport_)
+                    {
+                        ShaderProgramBinary check;
+                        unsigned long long key = GetProgramBinaryKey(vs, ps, &check);
+                        ShaderProgramBinary& binary = impl_->programBinaries_[key];
+                        unsigned format;
+                        if (key && newProgram->GetBinary(format, binary.data_))
+                        {
+                            binary.format_ = format;
+                            binary.sourceHash_ = check.sourceHash_;
+                            binary.sourceLength_ = check.sourceLength_;
+                            impl_->programBinariesDirty_ = true;
+                        }
+                        else
+                            impl_->programBinaries_.erase(key);
+                    }
                 }
                 else
                 {
@@ -2206,6 +2323,126 @@ namespace Urho3D
             impl_->shaderProgram_ = nullptr;
     }
 
+    void Graphics::LoadShaderProgramCache()
+    {
+        if (!impl_->programBinarySupport_ || shaderCacheDir_.Empty())
+            return;
+
+        // Binaries are only valid for the driver that created them
+        impl_->programBinaryDriver_ = String((const char*)glGetString(GL_VENDOR)) + " " + String((const char*)glGetString(GL_RENDERER)) +
+            " " + String((const char*)glGetString(GL_VERSION));
+
+        String fileName = shaderCacheDir_ + "ShaderPrograms.bin";
+        auto* fileSystem = GetSubsystem<FileSystem>();
+        if (!IsAbsolutePath(fileName) || !fileSystem->FileExists(fileName))
+            return;
+
+        URHO3D_PROFILE(LoadShaderProgramCache);
+
+        File file(context_, fileName);
+        if (!file.IsOpen() || file.ReadFileID() != "UPRG" || file.ReadUInt() != PROGRAM_CACHE_VERSION)
+        {
+            URHO3D_LOGERROR(fileName + " is not a valid shader program cache file");
+            return;
+        }
+
+        if (file.ReadString() != impl_->programBinaryDriver_)
+        {
+            URHO3D_LOGINFO("Graphics driver changed, discarding shader program cache");
+            // Overwrite the old binaries on exit
+            impl_->programBinariesDirty_ = true;
+            return;
+        }
+
+        unsigned numPrograms = file.ReadUInt();
+        for (unsigned i = 0; i < numPrograms && !file.IsEof(); ++i)
+        {
+            unsigned long long key = file.ReadUInt();
+            key = key << 32u | file.ReadUInt();
+            ShaderProgramBinary& binary = impl_->programBinaries_[key];
+            binary.sourceHash_ = file.ReadUInt();
+            binary.sourceHash_ = binary.sourceHash_ << 32u | file.ReadUInt();
+            binary.sourceLength_ = file.ReadUInt();
+            binary.format_ = file.ReadUInt();
+
+            // Do not trust the size of a truncated or corrupt file
+            unsigned size = file.ReadUInt();
+            if (!size || size > file.GetSize() - file.GetPosition())
+            {
+                URHO3D_LOGERROR(fileName + " is corrupt, discarding shader program cache");
+                impl_->programBinaries_.clear();
+                impl_->programBinariesDirty_ = true;
+                return;
+            }
+
+            binary.data_.Resize(size);
+            if (file.Read(&binary.data_[0], size) != size)
+            {
+                impl_->programBinaries_.erase(key);
+                break;
+            }
+        }
+
+        URHO3D_LOGDEBUG("Loaded " + String((unsigned)impl_->programBinaries_.size()) + " shader program binaries");
+    }
+
+    void Graphics::SaveShaderProgramCache()
+    {
+        if (!impl_->programBinariesDirty_ || shaderCacheDir_.Empty() || !IsAbsolutePath(shaderCacheDir_))
+            return;
+
+        auto* fileSystem = GetSubsystem<FileSystem>();
+        if (!fileSystem->DirExists(shaderCacheDir_))
+            fileSystem->CreateDir(shaderCacheDir_);
+
+        // Write to a temporary file first, so that an interrupted write does not leave a truncated cache behind
+        String fileName = shaderCacheDir_ + "ShaderPrograms.bin";
+        String tempFileName = fileName + ".tmp";
+        {
+            File file(context_, tempFileName, FILE_WRITE);
+            if (!file.IsOpen())
+                return;
+
+            bool success = file.WriteFileID("UPRG");
+            success &= file.WriteUInt(PROGRAM_CACHE_VERSION);
+            success &= file.WriteString(impl_->programBinaryDriver_);
+            success &= file.WriteUInt((unsigned)impl_->programBinaries_.size());
+            for (auto i = impl_->programBinaries_.begin(); i != impl_->programBinaries_.end(); ++i)
+            {
+                success &= file.WriteUInt((unsigned)(i->first >> 32u));
+                success &= file.WriteUInt((unsigned)i->first);
+                success &= file.WriteUInt((unsigned)(i->second.sourceHash_ >> 32u));
+                success &= file.WriteUInt((unsigned)i->second.sourceHash_);
+                success &= file.WriteUInt(i->second.sourceLength_);
+                success &= file.WriteUInt(i->second.format_);
+                success &= file.WriteUInt(i->second.data_.Size());
+                success &= file.Write(&i->second.data_[0], i->second.data_.Size()) == i->second.data_.Size();
+            }
+
+            if (!success)
+            {
+                URHO3D_LOGERROR("Failed to write " + tempFileName);
+                file.Close();
+                fileSystem->Delete(tempFileName);
+                return;
+            }
+        }
+
+        // Renaming does not replace an existing file on all platforms
+        if (!fileSystem->Rename(tempFileName, fileName))
+        {
+            fileSystem->Delete(fileName);
+            if (!fileSystem->Rename(tempFileName, fileName))
+            {
+                URHO3D_LOGERROR("Failed to replace " + fileName);
+                fileSystem->Delete(tempFileName);
+                return;
+            }
+        }
+
+        impl_->programBinariesDirty_ = false;
+    }
+
     ConstantBuffer* Graphics::GetOrCreateConstantBuffer(ShaderType /*type*/, unsigned index, unsigned size)
     {
         // Note: shaderType parameter is not used on OpenGL, instead binding index should already use the PS range
@@ -2600,6 +2837,16 @@ namespace Urho3D
 
         // Consider OpenGL shadows always hardware sampled, if supported at all
         hardwareShadowSupport_ = shadowMapFormat_ != 0;
+
+        // Check for shader program binary support for the program cache
+        GLint numBinaryFormats = 0;
+#ifndef __EMSCRIPTEN__
+#if !ALIMER_OPENGLES
+        if (glGetProgramBinary && glProgramBinary && glProgramParameteri)
+#endif
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+#endif
+        impl_->programBinarySupport_ = numBinaryFormats > 0;
     }
 
     void Graphics::PrepareDraw()
@@ -2885,7 +3132,7 @@ namespace Urho3D
 
                         SetVBO(buffer->GetGPUObjectName());
                         glVertexAttribPointer(location, glElementComponents[element.type_], glElementTypes[element.type_],
-                            element.type_ == TYPE_UBYTE4_NORM ? GL_TRUE : GL_FALSE, (unsigned)buffer->GetVertexSize(),
+                            glElementNormalized[element.type_], (unsigned)buffer->GetVertexSize(),
                             (const void*)(size_t)dataStart);
                     }
                 }
@@ -3019,6 +3266,8 @@ namespace Urho3D
         textureUnits_["VolumeMap"] = TU_VOLUMEMAP;
         textureUnits_["FaceSelectCubeMap"] = TU_FACESELECT;
         textureUnits_["IndirectionCubeMap"] = TU_INDIRECTION;
+        textureUnits_["LightClusterMap"] = TU_LIGHTCLUSTERS;
+        textureUnits_["LightDataMap"] = TU_LIGHTDATA;
         textureUnits_["DepthBuffer"] = TU_DEPTHBUFFER;
         textureUnits_["LightBuffer"] = TU_LIGHTBUFFER;
         textureUnits_["ZoneCubeMap"] = TU_ZONE;
@@ -84,6 +84,21 @@ namespace Urho3D
     using ConstantBufferMap = std::unordered_map<size_t, SharedPtr<ConstantBuffer> >;
     using ShaderProgramMap = std::unordered_map<std::pair<ShaderVariation*, ShaderVariation*>, SharedPtr<ShaderProgram> >;
 
+    /// Shader program binary retrieved from the driver, for the on-disk program cache.
+    struct ShaderProgramBinary
+    {
+        /// Driver-specific binary format.
+        GLenum format_{};
+        /// Binary data.
+        PODVector<unsigned char> data_;
+        /// Hash of the defines and source code of both shaders, independent of the cache key. Guards against key collisions.
+        unsigned long long sourceHash_{};
+        /// Combined length of the defines and source code of both shaders.
+        unsigned sourceLength_{};
+    };
+
+    using ShaderProgramBinaryMap = std::unordered_map<unsigned long long, ShaderProgramBinary>;
+
     /// Cached state of a frame buffer object.
     struct FrameBufferObject
     {
@@ -121,6 +136,9 @@ namespace Urho3D
         /// Return the GL Context.
         const SDL_GLContext& GetGLContext() { return context_; }
 
+        /// Return whether shader program binaries can be retrieved and loaded for the program cache.
+        bool GetProgramBinarySupport() const { return programBinarySupport_; }
+
     private:
         /// SDL OpenGL context.
         SDL_GLContext context_{};
@@ -166,6 +184,14 @@ namespace Urho3D
         ShaderProgram* shaderProgram_{};
         /// Linked shader programs.
         ShaderProgramMap shaderPrograms_;
+        /// Shader program binaries by source hash, loaded from and saved to the shader cache directory.
+        ShaderProgramBinaryMap programBinaries_;
+        /// Driver identification the program binaries are valid for.
+        String programBinaryDriver_;
+        /// Shader program binary support flag.
+        bool programBinarySupport_{};
+        /// Program binaries changed since loading flag.
+        bool programBinariesDirty_{};
         /// Need FBO commit flag.
         bool fboDirty_{};
         /// Need vertex attribute pointer update flag.
@@ -130,6 +130,8 @@ namespace Urho3D
 
         glAttachShader(object_.name_, vertexShader_->GetGPUObjectName());
         glAttachShader(object_.name_, pixelShader_->GetGPUObjectName());
+        if (graphics_->GetImpl()->GetProgramBinarySupport())
+            glProgramParameteri(object_.name_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(object_.name_);
 
         int linked, length;
@@ -149,6 +151,63 @@ namespace Urho3D
         if (!object_.name_)
             return false;
 
+        return Reflect();
+    }
+
+    bool ShaderProgram::LinkBinary(unsigned format, const PODVector<unsigned char>& data)
+    {
+        Release();
+
+        if (!vertexShader_ || !pixelShader_ || data.Empty())
+            return false;
+
+        object_.name_ = glCreateProgram();
+        if (!object_.name_)
+        {
+            linkerOutput_ = "Could not create shader program";
+            return false;
+        }
+
+        glProgramBinary(object_.name_, format, &data[0], (GLsizei)data.Size());
+
+        // The driver may reject a binary even if it identifies itself the same way, for example after a hardware change
+        int linked;
+        glGetProgramiv(object_.name_, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            glDeleteProgram(object_.name_);
+            object_.name_ = 0;
+            return false;
+        }
+
+        linkerOutput_.Clear();
+        return Reflect();
+    }
+
+    bool ShaderProgram::GetBinary(unsigned& format, PODVector<unsigned char>& data) const
+    {
+        if (!object_.name_)
+            return false;
+
+        int length = 0;
+        glGetProgramiv(object_.name_, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return false;
+
+        data.Resize((unsigned)length);
+        GLenum binaryFormat;
+        GLsizei outLength = 0;
+        glGetProgramBinary(object_.name_, length, &outLength, &binaryFormat, &data[0]);
+        if (outLength <= 0)
+            return false;
+
+        data.Resize((unsigned)outLength);
+        format = binaryFormat;
+        return true;
+    }
+
+    bool ShaderProgram::Reflect()
+    {
         const int MAX_NAME_LENGTH = 256;
         char nameBuffer[MAX_NAME_LENGTH];
         GLint attributeCount, uniformCount, elementCount, nameLength;
@@ -50,6 +50,10 @@ public:
 
     /// Link the shaders and examine the uniforms and samplers used. Return true if successful.
     bool Link();
+    /// Create the program from a binary previously retrieved from the same driver, without compiling the shaders. Return true if successful.
+    bool LinkBinary(unsigned format, const PODVector<unsigned char>& data);
+    /// Retrieve the linked program binary. Return true if successful.
+    bool GetBinary(unsigned& format, PODVector<unsigned char>& data) const;
 
     /// Return the vertex shader.
     ShaderVariation* GetVertexShader() const;
@@ -87,6 +91,9 @@ public:
     static void ClearGlobalParameterSource(ShaderParameterGroup group);
 
 private:
+    /// Examine the vertex attributes, uniforms and samplers of the linked program. Return true if successful.
+    bool Reflect();
+
     /// Vertex shader.
     WeakPtr<ShaderVariation> vertexShader_;
     /// Pixel shader.
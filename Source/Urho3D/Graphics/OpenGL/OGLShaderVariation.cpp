@@ -58,6 +58,9 @@ namespace Urho3D
 
     void ShaderVariation::Release()
     {
+        // Discard a preparation in a worker thread, as the source code may have changed
+        ReleasePrepared();
+
         if (object_.name_)
         {
             if (!graphics_)
@@ -82,29 +85,69 @@ namespace Urho3D
             object_.name_ = 0;
             graphics_->CleanupShaderPrograms(this);
         }
+        else if (graphics_)
+        {
+            // Programs may have been loaded from program binaries without compiling the shader
+            if (!graphics_->IsDeviceLost() && (graphics_->GetVertexShader() == this || graphics_->GetPixelShader() == this))
+                graphics_->SetShaders(nullptr, nullptr);
+            graphics_->CleanupShaderPrograms(this);
+        }
 
         compilerOutput_.Clear();
     }
 
     bool ShaderVariation::Create()
     {
-        Release();
+        // Keep the programs loaded from program binaries if only compiling the shader for the first time
+        if (object_.name_)
+            Release();
+        compilerOutput_.Clear();
 
-        if (!owner_)
-        {
-            compilerOutput_ = "Owner shader has expired";
+        // Use the source code prepared in a worker thread if available, else prepare it now
+        if (!CompletePrepare() && !Prepare())
             return false;
-        }
 
         object_.name_ = glCreateShader(type_ == VS ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
         if (!object_.name_)
         {
             compilerOutput_ = "Could not create shader object";
+            preparedSourceCode_.Clear();
+            return false;
+        }
+
+        const char* shaderCStr = preparedSourceCode_.CString();
+        glShaderSource(object_.name_, 1, &shaderCStr, nullptr);
+        glCompileShader(object_.name_);
+        preparedSourceCode_.Clear();
+
+        int compiled, length;
+        glGetShaderiv(object_.name_, GL_COMPILE_STATUS, &compiled);
+        if (!compiled)
+        {
+            glGetShaderiv(object_.name_, GL_INFO_LOG_LENGTH, &length);
+            compilerOutput_.Resize((unsigned)length);
+            int outLength;
+            glGetShaderInfoLog(object_.name_, length, &outLength, &compilerOutput_[0]);
+            glDeleteShader(object_.name_);
+            object_.name_ = 0;
+        }
+        else
+            compilerOutput_.Clear();
+
+        return object_.name_ != 0;
+    }
+
+    bool ShaderVariation::Prepare()
+    {
+        if (!owner_)
+        {
+            compilerOutput_ = "Owner shader has expired";
             return false;
         }
 
         const String& originalShaderCode = owner_->GetSourceCode(type_);
-        String shaderCode;
+        String& shaderCode = preparedSourceCode_;
+        shaderCode.Clear();
 
         // Check if the shader code contains a version define
         unsigned verStart = originalShaderCode.Find('#');
@@ -170,25 +213,7 @@ namespace Urho3D
         else
             shaderCode += originalShaderCode;
 
-        const char* shaderCStr = shaderCode.CString();
-        glShaderSource(object_.name_, 1, &shaderCStr, nullptr);
-        glCompileShader(object_.name_);
-
-        int compiled, length;
-        glGetShaderiv(object_.name_, GL_COMPILE_STATUS, &compiled);
-        if (!compiled)
-        {
-            glGetShaderiv(object_.name_, GL_INFO_LOG_LENGTH, &length);
-            compilerOutput_.Resize((unsigned)length);
-            int outLength;
-            glGetShaderInfoLog(object_.name_, length, &outLength, &compilerOutput_[0]);
-            glDeleteShader(object_.name_);
-            object_.name_ = 0;
-        }
-        else
-            compilerOutput_.Clear();
-
-        return object_.name_ != 0;
+        return true;
     }
 
     void ShaderVariation::SetDefines(const String& defines)
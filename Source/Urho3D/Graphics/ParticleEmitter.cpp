@@ -24,6 +24,8 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/Geometry.h"
 #include "../Graphics/DrawableEvents.h"
 #include "../Graphics/ParticleEffect.h"
@@ -34,6 +36,12 @@
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 
+#if ALIMER_SSE2
+#include <emmintrin.h>
+#elif ALIMER_NEON
+#include <arm_neon.h>
+#endif
+
 #include "../DebugNew.h"
 
 using namespace Urho3D;
@@ -42,10 +50,318 @@ namespace Urho3D
 {
     extern const char* faceCameraModeNames[];
     static constexpr u32 MAX_PARTICLES_IN_FRAME = 100;
+    /// Number of particles updated at a time. Must be a multiple of 4.
+    static const unsigned PARTICLE_CHUNK_SIZE = 1024;
+    /// Smallest number of particles in an emitter for splitting its update across worker threads.
+    static const unsigned MIN_THREADED_PARTICLES = 4 * PARTICLE_CHUNK_SIZE;
+
+    /// Particle update parameters of an emitter for one frame.
+    struct ParticleUpdateTask
+    {
+        /// Particle states.
+        ParticleData* particles_;
+        /// Billboards of the particles.
+        Billboard* billboards_;
+        /// Particle effect.
+        const ParticleEffect* effect_;
+        /// Timestep.
+        float timeStep_;
+        /// Constant force in the space of the particle positions.
+        Vector3 constantForce_;
+        /// Velocity damping force.
+        float dampingForce_;
+        /// Scaling applied to the position update.
+        Vector3 scale_;
+        /// Size add per second.
+        float sizeAdd_;
+        /// Size multiply per second.
+        float sizeMul_;
+    };
+
+    /// Range of particles to update.
+    struct ParticleUpdateChunk
+    {
+        /// Update task.
+        const ParticleUpdateTask* task_;
+        /// First particle. Aligned to 4 particles.
+        unsigned start_;
+        /// End particle.
+        unsigned end_;
+        /// Whether had enabled billboards.
+        bool active_;
+    };
+
+    void ParticleData::Resize(unsigned num)
+    {
+        unsigned oldSize = timer_.Size();
+        unsigned size = (num + 3) & ~3u;
+
+        PODVector<float>* arrays[] = { &positionX_, &positionY_, &positionZ_, &velocityX_, &velocityY_, &velocityZ_, &sizeX_, &sizeY_,
+            &timer_, &timeToLive_, &scale_, &rotation_, &rotationSpeed_ };
+        for (PODVector<float>* array : arrays)
+        {
+            array->Resize(size);
+            for (unsigned i = oldSize; i < size; ++i)
+                (*array)[i] = 0.0f;
+        }
+
+        colorIndex_.Resize(size);
+        texIndex_.Resize(size);
+        for (unsigned i = oldSize; i < size; ++i)
+        {
+            scale_[i] = 1.0f;
+            colorIndex_[i] = 0;
+            texIndex_[i] = 0;
+        }
+    }
+
+    /// Advance the timers, velocities, positions, rotations and size scaling of particles whose lifetime has not run out. The range must start at a multiple of 4 and may extend into the padding.
+    static void IntegrateParticles(const ParticleUpdateTask& task, unsigned start, unsigned end)
+    {
+        ParticleData& particles = *task.particles_;
+        float* positionX = particles.positionX_.Buffer();
+        float* positionY = particles.positionY_.Buffer();
+        float* positionZ = particles.positionZ_.Buffer();
+        float* velocityX = particles.velocityX_.Buffer();
+        float* velocityY = particles.velocityY_.Buffer();
+        float* velocityZ = particles.velocityZ_.Buffer();
+        float* timer = particles.timer_.Buffer();
+        const float* timeToLive = particles.timeToLive_.Buffer();
+        float* scale = particles.scale_.Buffer();
+        float* rotation = particles.rotation_.Buffer();
+        const float* rotationSpeed = particles.rotationSpeed_.Buffer();
+        const bool animateSize = task.sizeAdd_ != 0.0f || task.sizeMul_ != 1.0f;
+
+#if ALIMER_SSE2
+        const __m128 timeStep = _mm_set1_ps(task.timeStep_);
+        const __m128 forceX = _mm_set1_ps(task.constantForce_.x_);
+        const __m128 forceY = _mm_set1_ps(task.constantForce_.y_);
+        const __m128 forceZ = _mm_set1_ps(task.constantForce_.z_);
+        const __m128 damping = _mm_set1_ps(-task.dampingForce_);
+        const __m128 scaleX = _mm_set1_ps(task.scale_.x_);
+        const __m128 scaleY = _mm_set1_ps(task.scale_.y_);
+        const __m128 scaleZ = _mm_set1_ps(task.scale_.z_);
+        const __m128 sizeAdd = _mm_set1_ps(task.sizeAdd_);
+        const __m128 sizeMul = _mm_set1_ps(task.sizeMul_ - 1.0f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (unsigned i = start; i < end; i += 4)
+        {
+            // Particles past their lifetime get a zero timestep
+            __m128 time = _mm_loadu_ps(timer + i);
+            __m128 alive = _mm_cmplt_ps(time, _mm_loadu_ps(timeToLive + i));
+            __m128 dt = _mm_and_ps(alive, timeStep);
+            _mm_storeu_ps(timer + i, _mm_add_ps(time, dt));
+
+            __m128 vx = _mm_loadu_ps(velocityX + i);
+            __m128 vy = _mm_loadu_ps(velocityY + i);
+            __m128 vz = _mm_loadu_ps(velocityZ + i);
+            vx = _mm_add_ps(vx, _mm_mul_ps(dt, forceX));
+            vy = _mm_add_ps(vy, _mm_mul_ps(dt, forceY));
+            vz = _mm_add_ps(vz, _mm_mul_ps(dt, forceZ));
+            vx = _mm_add_ps(vx, _mm_mul_ps(dt, _mm_mul_ps(damping, vx)));
+            vy = _mm_add_ps(vy, _mm_mul_ps(dt, _mm_mul_ps(damping, vy)));
+            vz = _mm_add_ps(vz, _mm_mul_ps(dt, _mm_mul_ps(damping, vz)));
+            _mm_storeu_ps(velocityX + i, vx);
+            _mm_storeu_ps(velocityY + i, vy);
+            _mm_storeu_ps(velocityZ + i, vz);
+
+            _mm_storeu_ps(positionX + i, _mm_add_ps(_mm_loadu_ps(positionX + i), _mm_mul_ps(_mm_mul_ps(dt, vx), scaleX)));
+            _mm_storeu_ps(positionY + i, _mm_add_ps(_mm_loadu_ps(positionY + i), _mm_mul_ps(_mm_mul_ps(dt, vy), scaleY)));
+            _mm_storeu_ps(positionZ + i, _mm_add_ps(_mm_loadu_ps(positionZ + i), _mm_mul_ps(_mm_mul_ps(dt, vz), scaleZ)));
+            _mm_storeu_ps(rotation + i, _mm_add_ps(_mm_loadu_ps(rotation + i), _mm_mul_ps(dt, _mm_loadu_ps(rotationSpeed + i))));
+
+            if (animateSize)
+            {
+                __m128 oldScale = _mm_loadu_ps(scale + i);
+                __m128 newScale = _mm_max_ps(_mm_add_ps(oldScale, _mm_mul_ps(dt, sizeAdd)), zero);
+                newScale = _mm_mul_ps(newScale, _mm_add_ps(_mm_mul_ps(dt, sizeMul), one));
+                _mm_storeu_ps(scale + i, _mm_or_ps(_mm_and_ps(alive, newScale), _mm_andnot_ps(alive, oldScale)));
+            }
+        }
+#elif ALIMER_NEON
+        const float32x4_t timeStep = vdupq_n_f32(task.timeStep_);
+        const float32x4_t forceX = vdupq_n_f32(task.constantForce_.x_);
+        const float32x4_t forceY = vdupq_n_f32(task.constantForce_.y_);
+        const float32x4_t forceZ = vdupq_n_f32(task.constantForce_.z_);
+        const float32x4_t damping = vdupq_n_f32(-task.dampingForce_);
+        const float32x4_t scaleX = vdupq_n_f32(task.scale_.x_);
+        const float32x4_t scaleY = vdupq_n_f32(task.scale_.y_);
+        const float32x4_t scaleZ = vdupq_n_f32(task.scale_.z_);
+        const float32x4_t sizeAdd = vdupq_n_f32(task.sizeAdd_);
+        const float32x4_t sizeMul = vdupq_n_f32(task.sizeMul_ - 1.0f);
+        const float32x4_t one = vdupq_n_f32(1.0f);
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+
+        for (unsigned i = start; i < end; i += 4)
+        {
+            // Particles past their lifetime get a zero timestep
+            float32x4_t time = vld1q_f32(timer + i);
+            uint32x4_t alive = vcltq_f32(time, vld1q_f32(timeToLive + i));
+            float32x4_t dt = vbslq_f32(alive, timeStep, zero);
+            vst1q_f32(timer + i, vaddq_f32(time, dt));
+
+            float32x4_t vx = vmlaq_f32(vld1q_f32(velocityX + i), dt, forceX);
+            float32x4_t vy = vmlaq_f32(vld1q_f32(velocityY + i), dt, forceY);
+            float32x4_t vz = vmlaq_f32(vld1q_f32(velocityZ + i), dt, forceZ);
+            vx = vmlaq_f32(vx, dt, vmulq_f32(damping, vx));
+            vy = vmlaq_f32(vy, dt, vmulq_f32(damping, vy));
+            vz = vmlaq_f32(vz, dt, vmulq_f32(damping, vz));
+            vst1q_f32(velocityX + i, vx);
+            vst1q_f32(velocityY + i, vy);
+            vst1q_f32(velocityZ + i, vz);
+
+            vst1q_f32(positionX + i, vmlaq_f32(vld1q_f32(positionX + i), vmulq_f32(dt, vx), scaleX));
+            vst1q_f32(positionY + i, vmlaq_f32(vld1q_f32(positionY + i), vmulq_f32(dt, vy), scaleY));
+            vst1q_f32(positionZ + i, vmlaq_f32(vld1q_f32(positionZ + i), vmulq_f32(dt, vz), scaleZ));
+            vst1q_f32(rotation + i, vmlaq_f32(vld1q_f32(rotation + i), dt, vld1q_f32(rotationSpeed + i)));
+
+            if (animateSize)
+            {
+                float32x4_t oldScale = vld1q_f32(scale + i);
+                float32x4_t newScale = vmaxq_f32(vmlaq_f32(oldScale, dt, sizeAdd), zero);
+                newScale = vmulq_f32(newScale, vmlaq_f32(one, dt, sizeMul));
+                vst1q_f32(scale + i, vbslq_f32(alive, newScale, oldScale));
+            }
+        }
+#else
+        for (unsigned i = start; i < end; ++i)
+        {
+            if (timer[i] >= timeToLive[i])
+                continue;
+
+            const float dt = task.timeStep_;
+            timer[i] += dt;
+
+            Vector3 velocity(velocityX[i], velocityY[i], velocityZ[i]);
+            velocity += dt * task.constantForce_;
+            velocity += dt * (-task.dampingForce_ * velocity);
+            velocityX[i] = velocity.x_;
+            velocityY[i] = velocity.y_;
+            velocityZ[i] = velocity.z_;
+
+            Vector3 move = dt * velocity * task.scale_;
+            positionX[i] += move.x_;
+            positionY[i] += move.y_;
+            positionZ[i] += move.z_;
+            rotation[i] += dt * rotationSpeed[i];
+
+            if (animateSize)
+            {
+                scale[i] = Max(scale[i] + dt * task.sizeAdd_, 0.0f);
+                scale[i] *= (dt * (task.sizeMul_ - 1.0f)) + 1.0f;
+            }
+        }
+#endif
+    }
+
+    /// Interpolate the color between two color frames at the time specified.
+    static void InterpolateColorFrames(const ColorFrame& frame, const ColorFrame& next, float time, Color& dest)
+    {
+        float timeInterval = next.time_ - frame.time_;
+        if (timeInterval <= 0.0f)
+        {
+            dest = next.color_;
+            return;
+        }
+
+        float t = (time - frame.time_) / timeInterval;
+#if ALIMER_SSE2
+        __m128 from = _mm_loadu_ps(&frame.color_.r_);
+        __m128 to = _mm_loadu_ps(&next.color_.r_);
+        _mm_storeu_ps(&dest.r_, _mm_add_ps(_mm_mul_ps(from, _mm_set1_ps(1.0f - t)), _mm_mul_ps(to, _mm_set1_ps(t))));
+#elif ALIMER_NEON
+        float32x4_t from = vld1q_f32(&frame.color_.r_);
+        float32x4_t to = vld1q_f32(&next.color_.r_);
+        vst1q_f32(&dest.r_, vmlaq_n_f32(vmulq_n_f32(from, 1.0f - t), to, t));
+#else
+        dest = frame.color_.Lerp(next.color_, t);
+#endif
+    }
+
+    /// Update a range of particles and write their billboards.
+    static void UpdateParticleChunk(ParticleUpdateChunk& chunk)
+    {
+        const ParticleUpdateTask& task = *chunk.task_;
+        ParticleData& particles = *task.particles_;
+        Billboard* billboards = task.billboards_;
+
+        // Disable the billboards of particles whose lifetime ran out on the previous update
+        for (unsigned i = chunk.start_; i < chunk.end_; ++i)
+        {
+            Billboard& billboard = billboards[i];
+            if (billboard.enabled_)
+            {
+                chunk.active_ = true;
+                if (particles.timer_[i] >= particles.timeToLive_[i])
+                    billboard.enabled_ = false;
+            }
+        }
+
+        if (!chunk.active_)
+            return;
+
+        IntegrateParticles(task, chunk.start_, (chunk.end_ + 3) & ~3u);
+
+        const bool animateSize = task.sizeAdd_ != 0.0f || task.sizeMul_ != 1.0f;
+        const Vector<ColorFrame>& colorFrames = task.effect_->GetColorFrames();
+        const Vector<TextureFrame>& textureFrames = task.effect_->GetTextureFrames();
+        const unsigned numColorFrames = colorFrames.Size();
+        const unsigned numTextureFrames = textureFrames.Size();
+
+        for (unsigned i = chunk.start_; i < chunk.end_; ++i)
+        {
+            Billboard& billboard = billboards[i];
+            if (!billboard.enabled_)
+                continue;
+
+            Vector3 velocity(particles.velocityX_[i], particles.velocityY_[i], particles.velocityZ_[i]);
+            billboard.position_ = Vector3(particles.positionX_[i], particles.positionY_[i], particles.positionZ_[i]);
+            billboard.direction_ = velocity.Normalized();
+            billboard.rotation_ = particles.rotation_[i];
+            if (animateSize)
+                billboard.size_ = Vector2(particles.sizeX_[i], particles.sizeY_[i]) * particles.scale_[i];
+
+            // Color interpolation
+            unsigned& index = particles.colorIndex_[i];
+            float timer = particles.timer_[i];
+            if (index < numColorFrames)
+            {
+                if (index < numColorFrames - 1)
+                {
+                    if (timer >= colorFrames[index + 1].time_)
+                        ++index;
+                }
+                if (index < numColorFrames - 1)
+                    InterpolateColorFrames(colorFrames[index], colorFrames[index + 1], timer, billboard.color_);
+                else
+                    billboard.color_ = colorFrames[index].color_;
+            }
+
+            // Texture animation
+            unsigned& texIndex = particles.texIndex_[i];
+            if (numTextureFrames && texIndex < numTextureFrames - 1)
+            {
+                if (timer >= textureFrames[texIndex + 1].time_)
+                {
+                    billboard.uv_ = textureFrames[texIndex + 1].uv_;
+                    ++texIndex;
+                }
+            }
+        }
+    }
+
+    /// Update a range of particles in a worker thread.
+    static void UpdateParticleChunkWork(const WorkItem* item, unsigned threadIndex)
+    {
+        UpdateParticleChunk(*reinterpret_cast<ParticleUpdateChunk*>(item->start_));
+    }
 }
 
 ParticleEmitter::ParticleEmitter(Context* context)
     : BillboardSet(context),
+    numParticles_(0),
     periodTimer_(0.0f),
     emissionTimer_(0.0f),
     lastTimeStep_(0.0f),
@@ -53,7 +369,9 @@ ParticleEmitter::ParticleEmitter(Context* context)
     emitting_(true),
     needUpdate_(false),
     serializeParticles_(true),
-    sendFinishedEvent_(true)
+    sendFinishedEvent_(true),
+    threadedParticleUpdate_(false),
+    particleUpdatePending_(false)
 {
     SetNumParticles(DEFAULT_NUM_PARTICLES);
 }
@@ -79,7 +397,7 @@ void ParticleEmitter::RegisterObject(Context * context)
     URHO3D_COPY_BASE_ATTRIBUTES(Drawable);
     URHO3D_MIXED_ACCESSOR_ATTRIBUTE("Particles", GetParticlesAttr, SetParticlesAttr, VariantVector, Variant::emptyVariantVector,
         AM_FILE | AM_NOEDIT);
-    URHO3D_MIXED_ACCESSOR_ATTRIBUTE("Billboards", GetParticleBillboardsAttr, SetBillboardsAttr, VariantVector, Variant::emptyVariantVector,
+    URHO3D_MIXED_ACCESSOR_ATTRIBUTE("Billboards", GetParticleBillboardsAttr, SetParticleBillboardsAttr, VariantVector, Variant::emptyVariantVector,
         AM_FILE | AM_NOEDIT);
     URHO3D_ATTRIBUTE("Serialize Particles", bool, serializeParticles_, true, AM_FILE);
 }
@@ -94,7 +412,10 @@ void ParticleEmitter::OnSetEnabled()
         if (IsEnabledEffective())
             SubscribeToEvent(scene, E_SCENEPOSTUPDATE, URHO3D_HANDLER(ParticleEmitter, HandleScenePostUpdate));
         else
+        {
             UnsubscribeFromEvent(scene, E_SCENEPOSTUPDATE);
+            SetThreadedParticleUpdate(false);
+        }
     }
 }
 
@@ -108,9 +429,9 @@ void ParticleEmitter::Update(const FrameInfo & frame)
         return;
 
     // If there is an amount mismatch between particles and billboards, correct it
-    if (particles_.Size() != billboards_.size())
+    if (numParticles_ != billboards_.size())
     {
-        SetNumBillboards(particles_.Size());
+        SetNumBillboards(numParticles_);
     }
 
     bool needCommit = false;
@@ -167,97 +488,16 @@ void ParticleEmitter::Update(const FrameInfo & frame)
         }
     }
 
-    // Update existing particles
-    Vector3 relativeConstantForce = node_->GetWorldRotation().Inverse() * effect_->GetConstantForce();
-    // If billboards are not relative, apply scaling to the position update
-    Vector3 scaleVector = Vector3::ONE;
-    if (scaled_ && !relative_)
-        scaleVector = node_->GetWorldScale();
-
-    for (unsigned i = 0; i < particles_.Size(); ++i)
+    // Large emitters update the existing particles from the main thread once the threaded drawable update has finished, where
+    // the work can be split across the worker threads
+    if (threadedParticleUpdate_)
     {
-        Particle& particle = particles_[i];
-        Billboard& billboard = billboards_[i];
-
-        if (billboard.enabled_)
-        {
-            needCommit = true;
-
-            // Time to live
-            if (particle.timer_ >= particle.timeToLive_)
-            {
-                billboard.enabled_ = false;
-                continue;
-            }
-            particle.timer_ += lastTimeStep_;
-
-            // Velocity & position
-            const Vector3& constantForce = effect_->GetConstantForce();
-            if (constantForce != Vector3::ZERO)
-            {
-                if (relative_)
-                    particle.velocity_ += lastTimeStep_ * relativeConstantForce;
-                else
-                    particle.velocity_ += lastTimeStep_ * constantForce;
-            }
-
-            float dampingForce = effect_->GetDampingForce();
-            if (dampingForce != 0.0f)
-            {
-                Vector3 force = -dampingForce * particle.velocity_;
-                particle.velocity_ += lastTimeStep_ * force;
-            }
-            billboard.position_ += lastTimeStep_ * particle.velocity_ * scaleVector;
-            billboard.direction_ = particle.velocity_.Normalized();
-
-            // Rotation
-            billboard.rotation_ += lastTimeStep_ * particle.rotationSpeed_;
-
-            // Scaling
-            float sizeAdd = effect_->GetSizeAdd();
-            float sizeMul = effect_->GetSizeMul();
-            if (sizeAdd != 0.0f || sizeMul != 1.0f)
-            {
-                particle.scale_ += lastTimeStep_ * sizeAdd;
-                if (particle.scale_ < 0.0f)
-                    particle.scale_ = 0.0f;
-                if (sizeMul != 1.0f)
-                    particle.scale_ *= (lastTimeStep_ * (sizeMul - 1.0f)) + 1.0f;
-                billboard.size_ = particle.size_ * particle.scale_;
-            }
-
-            // Color interpolation
-            unsigned& index = particle.colorIndex_;
-            const Vector<ColorFrame>& colorFrames_ = effect_->GetColorFrames();
-            if (index < colorFrames_.Size())
-            {
-                if (index < colorFrames_.Size() - 1)
-                {
-                    if (particle.timer_ >= colorFrames_[index + 1].time_)
-                        ++index;
-                }
-                if (index < colorFrames_.Size() - 1)
-                    billboard.color_ = colorFrames_[index].Interpolate(colorFrames_[index + 1], particle.timer_);
-                else
-                    billboard.color_ = colorFrames_[index].color_;
-            }
-
-            // Texture animation
-            unsigned& texIndex = particle.texIndex_;
-            const Vector<TextureFrame>& textureFrames_ = effect_->GetTextureFrames();
-            if (textureFrames_.Size() && texIndex < textureFrames_.Size() - 1)
-            {
-                if (particle.timer_ >= textureFrames_[texIndex + 1].time_)
-                {
-                    billboard.uv_ = textureFrames_[texIndex + 1].uv_;
-                    ++texIndex;
-                }
-            }
-        }
+        particleUpdatePending_ = true;
+        if (needCommit)
+            Commit();
     }
-
-    if (needCommit)
-        Commit();
+    else
+        UpdateParticles(false);
 
     needUpdate_ = false;
 }
@@ -288,6 +528,7 @@ void ParticleEmitter::SetNumParticles(unsigned num)
     if (num > M_MAX_INT)
         num = 0;
 
+    numParticles_ = num;
     particles_.Resize(num);
     SetNumBillboards(num);
 }
@@ -328,6 +569,8 @@ void ParticleEmitter::RemoveAllParticles()
     {
         i->enabled_ = false;
     }
+    for (unsigned i = 0; i < numParticles_; ++i)
+        particles_.timeToLive_[i] = 0.0f;
 
     Commit();
 }
@@ -375,16 +618,21 @@ void ParticleEmitter::SetParticlesAttr(const VariantVector & value)
     unsigned index = 0;
     SetNumParticles(index < value.size() ? value[index++].GetUInt() : 0);
 
-    for (PODVector<Particle>::Iterator i = particles_.Begin(); i != particles_.End() && index < value.size(); ++i)
+    for (unsigned i = 0; i < numParticles_ && index < value.size(); ++i)
     {
-        i->velocity_ = value[index++].GetVector3();
-        i->size_ = value[index++].GetVector2();
-        i->timer_ = value[index++].GetFloat();
-        i->timeToLive_ = value[index++].GetFloat();
-        i->scale_ = value[index++].GetFloat();
-        i->rotationSpeed_ = value[index++].GetFloat();
-        i->colorIndex_ = (unsigned)value[index++].GetInt();
-        i->texIndex_ = (unsigned)value[index++].GetInt();
+        Vector3 velocity = value[index++].GetVector3();
+        particles_.velocityX_[i] = velocity.x_;
+        particles_.velocityY_[i] = velocity.y_;
+        particles_.velocityZ_[i] = velocity.z_;
+        Vector2 size = value[index++].GetVector2();
+        particles_.sizeX_[i] = size.x_;
+        particles_.sizeY_[i] = size.y_;
+        particles_.timer_[i] = value[index++].GetFloat();
+        particles_.timeToLive_[i] = value[index++].GetFloat();
+        particles_.scale_[i] = value[index++].GetFloat();
+        particles_.rotationSpeed_[i] = value[index++].GetFloat();
+        particles_.colorIndex_[i] = (unsigned)value[index++].GetInt();
+        particles_.texIndex_[i] = (unsigned)value[index++].GetInt();
     }
 }
 
@@ -393,26 +641,41 @@ VariantVector ParticleEmitter::GetParticlesAttr() const
     VariantVector ret;
     if (!serializeParticles_)
     {
-        ret.push_back(particles_.Size());
+        ret.push_back(numParticles_);
         return ret;
     }
 
-    ret.reserve(particles_.Size() * 8 + 1);
-    ret.push_back(particles_.Size());
-    for (PODVector<Particle>::ConstIterator i = particles_.Begin(); i != particles_.End(); ++i)
+    ret.reserve(numParticles_ * 8 + 1);
+    ret.push_back(numParticles_);
+    for (unsigned i = 0; i < numParticles_; ++i)
     {
-        ret.push_back(i->velocity_);
-        ret.push_back(i->size_);
-        ret.push_back(i->timer_);
-        ret.push_back(i->timeToLive_);
-        ret.push_back(i->scale_);
-        ret.push_back(i->rotationSpeed_);
-        ret.push_back(i->colorIndex_);
-        ret.push_back(i->texIndex_);
+        ret.push_back(Vector3(particles_.velocityX_[i], particles_.velocityY_[i], particles_.velocityZ_[i]));
+        ret.push_back(Vector2(particles_.sizeX_[i], particles_.sizeY_[i]));
+        ret.push_back(particles_.timer_[i]);
+        ret.push_back(particles_.timeToLive_[i]);
+        ret.push_back(particles_.scale_[i]);
+        ret.push_back(particles_.rotationSpeed_[i]);
+        ret.push_back(particles_.colorIndex_[i]);
+        ret.push_back(particles_.texIndex_[i]);
     }
     return ret;
 }
 
+void ParticleEmitter::SetParticleBillboardsAttr(const VariantVector& value)
+{
+    SetBillboardsAttr(value);
+
+    unsigned numBillboards = Min(numParticles_, (unsigned)billboards_.size());
+    for (unsigned i = 0; i < numBillboards; ++i)
+    {
+        const Billboard& billboard = billboards_[i];
+        particles_.positionX_[i] = billboard.position_.x_;
+        particles_.positionY_[i] = billboard.position_.y_;
+        particles_.positionZ_[i] = billboard.position_.z_;
+        particles_.rotation_[i] = billboard.rotation_;
+    }
+}
+
 VariantVector ParticleEmitter::GetParticleBillboardsAttr() const
 {
     VariantVector ret;
@@ -446,7 +709,12 @@ void ParticleEmitter::OnSceneSet(Scene * scene)
     if (scene && IsEnabledEffective())
         SubscribeToEvent(scene, E_SCENEPOSTUPDATE, URHO3D_HANDLER(ParticleEmitter, HandleScenePostUpdate));
     else if (!scene)
+    {
         UnsubscribeFromEvent(E_SCENEPOSTUPDATE);
+        UnsubscribeFromEvent(E_SCENEDRAWABLEUPDATEFINISHED);
+        threadedParticleUpdate_ = false;
+        particleUpdatePending_ = false;
+    }
 }
 
 bool ParticleEmitter::EmitNewParticle()
@@ -454,8 +722,7 @@ bool ParticleEmitter::EmitNewParticle()
     unsigned index = GetFreeParticle();
     if (index == M_MAX_UNSIGNED)
         return false;
-    assert(index < particles_.Size());
-    Particle& particle = particles_[index];
+    assert(index < numParticles_);
     Billboard& billboard = billboards_[index];
 
     Vector3 startDir;
@@ -517,17 +784,19 @@ bool ParticleEmitter::EmitNewParticle()
         break;
     }
 
-    particle.size_ = effect_->GetRandomSize();
-    particle.timer_ = 0.0f;
-    particle.timeToLive_ = effect_->GetRandomTimeToLive();
-    particle.scale_ = 1.0f;
-    particle.rotationSpeed_ = effect_->GetRandomRotationSpeed();
-    particle.colorIndex_ = 0;
-    particle.texIndex_ = 0;
+    Vector2 size = effect_->GetRandomSize();
+    particles_.sizeX_[index] = size.x_;
+    particles_.sizeY_[index] = size.y_;
+    particles_.timer_[index] = 0.0f;
+    particles_.timeToLive_[index] = effect_->GetRandomTimeToLive();
+    particles_.scale_[index] = 1.0f;
+    particles_.rotationSpeed_[index] = effect_->GetRandomRotationSpeed();
+    particles_.colorIndex_[index] = 0;
+    particles_.texIndex_[index] = 0;
 
     if (faceCameraMode_ == FC_DIRECTION)
     {
-        startPos += startDir * particle.size_.y_;
+        startPos += startDir * size.y_;
     }
 
     if (!relative_)
@@ -536,13 +805,20 @@ bool ParticleEmitter::EmitNewParticle()
         startDir = node_->GetWorldRotation() * startDir;
     };
 
-    particle.velocity_ = effect_->GetRandomVelocity() * startDir;
+    Vector3 velocity = effect_->GetRandomVelocity() * startDir;
+    particles_.velocityX_[index] = velocity.x_;
+    particles_.velocityY_[index] = velocity.y_;
+    particles_.velocityZ_[index] = velocity.z_;
+    particles_.positionX_[index] = startPos.x_;
+    particles_.positionY_[index] = startPos.y_;
+    particles_.positionZ_[index] = startPos.z_;
 
     billboard.position_ = startPos;
-    billboard.size_ = particles_[index].size_;
+    billboard.size_ = size;
     const Vector<TextureFrame>& textureFrames_ = effect_->GetTextureFrames();
     billboard.uv_ = textureFrames_.Size() ? textureFrames_[0].uv_ : Rect::POSITIVE;
     billboard.rotation_ = effect_->GetRandomRotation();
+    particles_.rotation_[index] = billboard.rotation_;
     const Vector<ColorFrame>& colorFrames_ = effect_->GetColorFrames();
     billboard.color_ = colorFrames_.Size() ? colorFrames_[0].color_ : Color();
     billboard.enabled_ = true;
@@ -576,6 +852,83 @@ bool ParticleEmitter::CheckActiveParticles() const
     return false;
 }
 
+void ParticleEmitter::UpdateParticles(bool allowThreads)
+{
+    URHO3D_PROFILE(UpdateParticles);
+
+    ParticleUpdateTask task;
+    task.particles_ = &particles_;
+    task.billboards_ = billboards_.data();
+    task.effect_ = effect_;
+    task.timeStep_ = lastTimeStep_;
+    // Relative particles are simulated in the node's space
+    task.constantForce_ = relative_ ? node_->GetWorldRotation().Inverse() * effect_->GetConstantForce() : effect_->GetConstantForce();
+    task.dampingForce_ = effect_->GetDampingForce();
+    // If billboards are not relative, apply scaling to the position update
+    task.scale_ = scaled_ && !relative_ ? node_->GetWorldScale() : Vector3::ONE;
+    task.sizeAdd_ = effect_->GetSizeAdd();
+    task.sizeMul_ = effect_->GetSizeMul();
+
+    PODVector<ParticleUpdateChunk> chunks;
+    for (unsigned i = 0; i < numParticles_; i += PARTICLE_CHUNK_SIZE)
+    {
+        ParticleUpdateChunk chunk;
+        chunk.task_ = &task;
+        chunk.start_ = i;
+        chunk.end_ = Min(i + PARTICLE_CHUNK_SIZE, numParticles_);
+        chunk.active_ = false;
+        chunks.Push(chunk);
+    }
+
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (allowThreads && queue && queue->GetNumThreads() && chunks.Size() > 1 && Thread::IsMainThread())
+    {
+        for (unsigned i = 1; i < chunks.Size(); ++i)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = UpdateParticleChunkWork;
+            item->start_ = &chunks[i];
+            queue->AddWorkItem(item);
+        }
+
+        UpdateParticleChunk(chunks[0]);
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+    else
+    {
+        for (unsigned i = 0; i < chunks.Size(); ++i)
+            UpdateParticleChunk(chunks[i]);
+    }
+
+    for (unsigned i = 0; i < chunks.Size(); ++i)
+    {
+        if (chunks[i].active_)
+        {
+            Commit();
+            break;
+        }
+    }
+}
+
+void ParticleEmitter::SetThreadedParticleUpdate(bool enable)
+{
+    if (enable == threadedParticleUpdate_)
+        return;
+
+    Scene* scene = GetScene();
+    if (enable && scene)
+        SubscribeToEvent(scene, E_SCENEDRAWABLEUPDATEFINISHED, URHO3D_HANDLER(ParticleEmitter, HandleSceneDrawableUpdateFinished));
+    else
+    {
+        UnsubscribeFromEvent(E_SCENEDRAWABLEUPDATEFINISHED);
+        enable = false;
+    }
+
+    threadedParticleUpdate_ = enable;
+    particleUpdatePending_ = false;
+}
+
 void ParticleEmitter::HandleScenePostUpdate(StringHash eventType, VariantMap & eventData)
 {
     // Store scene's timestep and use it instead of global timestep, as time scale may be other than 1
@@ -589,6 +942,9 @@ void ParticleEmitter::HandleScenePostUpdate(StringHash eventType, VariantMap & e
         lastUpdateFrameNumber_ = viewFrameNumber_;
         needUpdate_ = true;
         MarkForUpdate();
+
+        auto* queue = GetSubsystem<WorkQueue>();
+        SetThreadedParticleUpdate(numParticles_ >= MIN_THREADED_PARTICLES && queue && queue->GetNumThreads());
     }
 
     // Send finished event only once all particles are gone
@@ -620,3 +976,13 @@ void ParticleEmitter::HandleEffectReloadFinished(StringHash eventType, VariantMa
     Reset();
     ApplyEffect();
 }
+
+void ParticleEmitter::HandleSceneDrawableUpdateFinished(StringHash eventType, VariantMap& eventData)
+{
+    if (particleUpdatePending_)
+    {
+        particleUpdatePending_ = false;
+        if (effect_ && numParticles_ == billboards_.size())
+            UpdateParticles(true);
+    }
+}
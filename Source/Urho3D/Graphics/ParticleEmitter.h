@@ -28,28 +28,45 @@ namespace Urho3D
 {
     class ParticleEffect;
 
-    /// One particle in the particle system.
-    struct Particle
+    /// States of the particles in a particle emitter, in structure-of-arrays layout so that several particles can be updated at a time with SIMD. Each array holds one value per particle and is padded to a multiple of 4 particles.
+    struct URHO3D_API ParticleData
     {
-        /// Velocity.
-        Vector3 velocity_;
-        /// Original billboard size.
-        Vector2 size_;
-        /// Time elapsed from creation.
-        float timer_;
-        /// Lifetime.
-        float timeToLive_;
-        /// Size scaling value.
-        float scale_;
-        /// Rotation speed.
-        float rotationSpeed_;
-        /// Current color animation index.
-        uint32_t colorIndex_;
-        /// Current texture animation index.
-        uint32_t texIndex_;
+        /// Resize for a number of particles. New particles have zero lifetime.
+        void Resize(unsigned num);
+
+        /// Position X coordinates.
+        PODVector<float> positionX_;
+        /// Position Y coordinates.
+        PODVector<float> positionY_;
+        /// Position Z coordinates.
+        PODVector<float> positionZ_;
+        /// Velocity X coordinates.
+        PODVector<float> velocityX_;
+        /// Velocity Y coordinates.
+        PODVector<float> velocityY_;
+        /// Velocity Z coordinates.
+        PODVector<float> velocityZ_;
+        /// Original billboard widths.
+        PODVector<float> sizeX_;
+        /// Original billboard heights.
+        PODVector<float> sizeY_;
+        /// Times elapsed from creation.
+        PODVector<float> timer_;
+        /// Lifetimes.
+        PODVector<float> timeToLive_;
+        /// Size scaling values.
+        PODVector<float> scale_;
+        /// Rotations.
+        PODVector<float> rotation_;
+        /// Rotation speeds.
+        PODVector<float> rotationSpeed_;
+        /// Current color animation indices.
+        PODVector<unsigned> colorIndex_;
+        /// Current texture animation indices.
+        PODVector<unsigned> texIndex_;
     };
 
-    /// %Particle emitter component.
+    /// %Particle emitter component. The particle positions and rotations are simulated in the particle data and copied to the billboards on each update, so modifying the billboards directly only has an effect until the next update.
     class URHO3D_API ParticleEmitter : public BillboardSet
     {
         URHO3D_OBJECT(ParticleEmitter, BillboardSet);
@@ -98,7 +115,7 @@ namespace Urho3D
 
         /// Return maximum number of particles.
         /// @property
-        unsigned GetNumParticles() const { return particles_.Size(); }
+        unsigned GetNumParticles() const { return numParticles_; }
 
         /// Return whether is currently emitting.
         /// @property
@@ -120,6 +137,8 @@ namespace Urho3D
         void SetParticlesAttr(const VariantVector& value);
         /// Return particles attribute. Returns particle amount only if particles are not to be serialized.
         VariantVector GetParticlesAttr() const;
+        /// Set billboards attribute. Also sets the particle positions and rotations from the billboards.
+        void SetParticleBillboardsAttr(const VariantVector& value);
         /// Return billboards attribute. Returns billboard amount only if particles are not to be serialized.
         VariantVector GetParticleBillboardsAttr() const;
 
@@ -135,15 +154,23 @@ namespace Urho3D
         bool CheckActiveParticles() const;
 
     private:
+        /// Update the existing particles and their billboards. The work is split across the worker threads for large emitters if allowed, which requires being called from the main thread outside of other work queue processing.
+        void UpdateParticles(bool allowThreads);
+        /// Subscribe to or unsubscribe from the drawable update finish event for updating the particles from the main thread.
+        void SetThreadedParticleUpdate(bool enable);
         /// Handle scene post-update event.
         void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
         /// Handle live reload of the particle effect.
         void HandleEffectReloadFinished(StringHash eventType, VariantMap& eventData);
+        /// Handle scene drawable update finish event for updating the particles of a large emitter.
+        void HandleSceneDrawableUpdateFinished(StringHash eventType, VariantMap& eventData);
 
         /// Particle effect.
         SharedPtr<ParticleEffect> effect_;
-        /// Particles.
-        PODVector<Particle> particles_;
+        /// Particle states.
+        ParticleData particles_;
+        /// Number of particles.
+        unsigned numParticles_;
         /// Active/inactive period timer.
         float periodTimer_;
         /// New particle emission timer.
@@ -160,6 +187,10 @@ namespace Urho3D
         bool serializeParticles_;
         /// Ready to send effect finish event flag.
         bool sendFinishedEvent_;
+        /// Update particles from the main thread after the threaded drawable update flag.
+        bool threadedParticleUpdate_;
+        /// Particle update pending for the main thread flag.
+        bool particleUpdatePending_;
         /// Automatic removal mode.
         AutoRemoveMode autoRemove_{ AutoRemoveMode::Disabled };
     };
@@ -0,0 +1,167 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Graphics/Drawable.h"
+#include "../Graphics/OctreeQuery.h"
+#include "../Graphics/RayPacket.h"
+
+#if ALIMER_SSE2
+#include <xmmintrin.h>
+#elif ALIMER_NEON
+#include <arm_neon.h>
+#endif
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+    /// Direction component used in place of zero when inverting a ray direction.
+    static const float MIN_DIRECTION = 1.0e-30f;
+
+    RayPacket::RayPacket(RayBatchOctreeQuery& query, const unsigned* rayIndices, unsigned numRays, PODVector<RayQueryResult>& scratch) :
+        query_(query),
+        rayIndices_(rayIndices),
+        numRays_(Min(numRays, RAY_PACKET_SIZE)),
+        directionSigns_(0),
+        scratch_(scratch)
+    {
+        for (unsigned i = 0; i < RAY_PACKET_SIZE; ++i)
+        {
+            if (i < numRays_)
+            {
+                unsigned index = rayIndices_[i];
+                const Ray& ray = query_.rays_[index];
+                for (unsigned j = 0; j < 3; ++j)
+                {
+                    float direction = ray.direction_.Data()[j];
+                    origin_[j][i] = ray.origin_.Data()[j];
+                    invDirection_[j][i] = 1.0f / (Abs(direction) > MIN_DIRECTION ? direction : MIN_DIRECTION);
+                }
+                maxDistance_[i] = query_.GetMaxDistance(index);
+            }
+            else
+            {
+                // Unused lanes never hit anything
+                for (unsigned j = 0; j < 3; ++j)
+                {
+                    origin_[j][i] = 0.0f;
+                    invDirection_[j][i] = 1.0f;
+                }
+                maxDistance_[i] = -1.0f;
+            }
+        }
+
+        if (numRays_)
+        {
+            const Vector3& direction = query_.rays_[rayIndices_[0]].direction_;
+            directionSigns_ = (direction.x_ < 0.0f ? 1u : 0u) | (direction.y_ < 0.0f ? 2u : 0u) | (direction.z_ < 0.0f ? 4u : 0u);
+        }
+    }
+
+    unsigned RayPacket::HitMask(const BoundingBox& box) const
+    {
+#if ALIMER_SSE2
+        __m128 entryDistance = _mm_setzero_ps();
+        __m128 exitDistance = _mm_set1_ps(M_INFINITY);
+        for (unsigned j = 0; j < 3; ++j)
+        {
+            __m128 origin = _mm_load_ps(origin_[j]);
+            __m128 invDirection = _mm_load_ps(invDirection_[j]);
+            __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.min_.Data()[j]), origin), invDirection);
+            __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.max_.Data()[j]), origin), invDirection);
+            entryDistance = _mm_max_ps(entryDistance, _mm_min_ps(t1, t2));
+            exitDistance = _mm_min_ps(exitDistance, _mm_max_ps(t1, t2));
+        }
+        __m128 hit = _mm_and_ps(_mm_cmple_ps(entryDistance, exitDistance), _mm_cmplt_ps(entryDistance, _mm_load_ps(maxDistance_)));
+        return (unsigned)_mm_movemask_ps(hit);
+#elif ALIMER_NEON
+        float32x4_t entryDistance = vdupq_n_f32(0.0f);
+        float32x4_t exitDistance = vdupq_n_f32(M_INFINITY);
+        for (unsigned j = 0; j < 3; ++j)
+        {
+            float32x4_t origin = vld1q_f32(origin_[j]);
+            float32x4_t invDirection = vld1q_f32(invDirection_[j]);
+            float32x4_t t1 = vmulq_f32(vsubq_f32(vdupq_n_f32(box.min_.Data()[j]), origin), invDirection);
+            float32x4_t t2 = vmulq_f32(vsubq_f32(vdupq_n_f32(box.max_.Data()[j]), origin), invDirection);
+            entryDistance = vmaxq_f32(entryDistance, vminq_f32(t1, t2));
+            exitDistance = vminq_f32(exitDistance, vmaxq_f32(t1, t2));
+        }
+        uint32x4_t hit = vandq_u32(vcleq_f32(entryDistance, exitDistance), vcltq_f32(entryDistance, vld1q_f32(maxDistance_)));
+        const uint32x4_t laneBits = { 1, 2, 4, 8 };
+        uint32x4_t bits = vandq_u32(hit, laneBits);
+        uint32x2_t sum = vadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+        return vget_lane_u32(vpadd_u32(sum, sum), 0);
+#else
+        unsigned mask = 0;
+        for (unsigned i = 0; i < RAY_PACKET_SIZE; ++i)
+        {
+            float entryDistance = 0.0f;
+            float exitDistance = M_INFINITY;
+            for (unsigned j = 0; j < 3; ++j)
+            {
+                float t1 = (box.min_.Data()[j] - origin_[j][i]) * invDirection_[j][i];
+                float t2 = (box.max_.Data()[j] - origin_[j][i]) * invDirection_[j][i];
+                entryDistance = Max(entryDistance, Min(t1, t2));
+                exitDistance = Min(exitDistance, Max(t1, t2));
+            }
+            if (entryDistance <= exitDistance && entryDistance < maxDistance_[i])
+                mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    void RayPacket::ProcessDrawables(Drawable** start, Drawable** end)
+    {
+        while (start != end)
+        {
+            Drawable* drawable = *start++;
+            if (!(drawable->GetDrawableFlags() & query_.drawableFlags_) || !(drawable->GetViewMask() & query_.viewMask_))
+                continue;
+
+            unsigned mask = HitMask(drawable->GetWorldBoundingBox());
+            for (unsigned i = 0; mask; ++i, mask >>= 1)
+            {
+                if (!(mask & 1u))
+                    continue;
+
+                unsigned index = rayIndices_[i];
+                RayOctreeQuery rayQuery(scratch_, query_.rays_[index], query_.level_, maxDistance_[i], query_.drawableFlags_,
+                    query_.viewMask_);
+                scratch_.Clear();
+                drawable->ProcessRayQuery(rayQuery, scratch_);
+
+                for (const RayQueryResult& result : scratch_)
+                {
+                    if (result.distance_ < maxDistance_[i])
+                    {
+                        maxDistance_[i] = result.distance_;
+                        query_.result_[index] = result;
+                    }
+                }
+            }
+        }
+    }
+}
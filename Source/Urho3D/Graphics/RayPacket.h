@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/Vector.h"
+#include "../Math/BoundingBox.h"
+
+namespace Urho3D
+{
+    class Drawable;
+    class RayBatchOctreeQuery;
+    struct RayQueryResult;
+
+    /// Maximum number of rays in a ray packet.
+    static const unsigned RAY_PACKET_SIZE = 4;
+
+    /// Up to four coherent rays of a batched raycast that traverse the spatial index together. Bounding boxes are tested against all rays at once, and each ray is culled by its closest hit so far.
+    /// @nobind
+    class URHO3D_API RayPacket
+    {
+    public:
+        /// Construct from rays of a batch query. The closest hits are written to the query results of the rays.
+        RayPacket(RayBatchOctreeQuery& query, const unsigned* rayIndices, unsigned numRays, PODVector<RayQueryResult>& scratch);
+
+        /// Return bitmask of the rays that hit a bounding box closer than their current maximum distance.
+        unsigned HitMask(const BoundingBox& box) const;
+        /// Process the ray queries of drawables whose bounding boxes are hit, keeping the closest hit of each ray.
+        void ProcessDrawables(Drawable** start, Drawable** end);
+
+        /// Return direction sign bits of the first ray: 1 for negative X, 2 for negative Y and 4 for negative Z. Used to visit octants front to back.
+        unsigned GetDirectionSigns() const { return directionSigns_; }
+
+    private:
+        /// Batch query.
+        RayBatchOctreeQuery& query_;
+        /// Query ray indices.
+        const unsigned* rayIndices_;
+        /// Number of rays.
+        unsigned numRays_;
+        /// Direction sign bits of the first ray.
+        unsigned directionSigns_;
+        /// Result vector for processing one drawable.
+        PODVector<RayQueryResult>& scratch_;
+        /// Ray origins by component.
+        alignas(16) float origin_[3][RAY_PACKET_SIZE];
+        /// Inverse ray directions by component.
+        alignas(16) float invDirection_[3][RAY_PACKET_SIZE];
+        /// Current maximum distances, or negative for unused lanes.
+        alignas(16) float maxDistance_[RAY_PACKET_SIZE];
+    };
+}
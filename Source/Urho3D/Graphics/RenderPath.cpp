@@ -152,6 +152,8 @@ namespace Urho3D
                     markToStencil_ = element.GetBool("marktostencil");
                 if (element.HasAttribute("vertexlights"))
                     vertexLights_ = element.GetBool("vertexlights");
+                if (element.HasAttribute("clusteredlights"))
+                    clusteredLights_ = element.GetBool("clusteredlights");
                 break;
 
             case CMD_FORWARDLIGHTS:
@@ -195,6 +195,8 @@ namespace Urho3D
         bool useLitBase_{ true };
         /// Vertex lights flag.
         bool vertexLights_{};
+        /// Clustered lights flag. Unshadowed per-pixel lights are applied to the batches in a single draw call.
+        bool clusteredLights_{};
         /// Event name.
         String eventName_;
     };
@@ -254,6 +254,8 @@ namespace Urho3D
     };
 
     static const unsigned MAX_BUFFER_AGE = 1000;
+    /// Frames a cached shadow map is kept without being used.
+    static const unsigned MAX_CACHED_SHADOW_MAP_AGE = 300;
 
     static const int MAX_EXTRA_INSTANCING_BUFFER_ELEMENTS = 4;
 
@@ -452,6 +454,7 @@ namespace Urho3D
             return;
 
         maxShadowMaps_ = shadowMaps;
+        cachedShadowMaps_.Clear();
         for (HashMap<int, Vector<SharedPtr<Texture2D> > >::Iterator i = shadowMaps_.Begin(); i != shadowMaps_.End(); ++i)
         {
             if ((int)i->second_.Size() > maxShadowMaps_)
@@ -526,6 +529,25 @@ namespace Urho3D
         }
     }
 
+    void Renderer::SetCacheShadowMaps(bool enable)
+    {
+        if (enable != cacheShadowMaps_)
+        {
+            cacheShadowMaps_ = enable;
+            cachedShadowMaps_.Clear();
+        }
+    }
+
+    void Renderer::SetTemporalOcclusion(bool enable)
+    {
+        temporalOcclusion_ = enable;
+    }
+
+    void Renderer::SetSharedCulling(bool enable)
+    {
+        sharedCulling_ = enable;
+    }
+
     void Renderer::ReloadShaders()
     {
         shadersDirty_ = true;
@@ -678,6 +700,7 @@ namespace Urho3D
 
         // Update main viewports. This may queue further views
         unsigned numMainViewports = queuedViewports_.Size();
+        PrepareSharedCulling(0, numMainViewports);
         for (unsigned i = 0; i < numMainViewports; ++i)
             UpdateQueuedViewport(i);
 
@@ -685,10 +708,12 @@ namespace Urho3D
         SendEvent(E_RENDERSURFACEUPDATE);
 
         // Update viewports that were added as result of the event above
+        PrepareSharedCulling(numMainViewports, queuedViewports_.Size());
         for (unsigned i = numMainViewports; i < queuedViewports_.Size(); ++i)
             UpdateQueuedViewport(i);
 
         queuedViewports_.Clear();
+        sharedViewCulling_.Clear();
         resetViews_ = false;
     }
 
@@ -907,88 +932,12 @@ namespace Urho3D
                     shadowMapAllocations_[searchKey].Push(light);
                     return shadowMaps_[searchKey][allocated];
                 }
-                else if ((int)allocated >= maxShadowMaps_)
+                else if ((int)(allocated + GetNumCachedShadowMaps(searchKey)) >= maxShadowMaps_)
                     return nullptr;
             }
         }
 
-        // Find format and usage of the shadow map
-        unsigned shadowMapFormat = 0;
-        TextureUsage shadowMapUsage = TEXTURE_DEPTHSTENCIL;
-        int multiSample = 1;
-
-        switch (shadowQuality_)
-        {
-            case SHADOWQUALITY_SIMPLE_16BIT:
-            case SHADOWQUALITY_PCF_16BIT:
-                shadowMapFormat = graphics_->GetShadowMapFormat();
-                break;
-
-            case SHADOWQUALITY_SIMPLE_24BIT:
-            case SHADOWQUALITY_PCF_24BIT:
-                shadowMapFormat = graphics_->GetHiresShadowMapFormat();
-                break;
-
-            case SHADOWQUALITY_VSM:
-            case SHADOWQUALITY_BLUR_VSM:
-                shadowMapFormat = graphics_->GetRGFloat32Format();
-                shadowMapUsage = TEXTURE_RENDERTARGET;
-                multiSample = vsmMultiSample_;
-                break;
-        }
-
-        if (!shadowMapFormat)
-            return nullptr;
-
-        SharedPtr<Texture2D> newShadowMap(new Texture2D(context_));
-        int retries = 3;
-        unsigned dummyColorFormat = graphics_->GetDummyColorFormat();
-
-        // Disable mipmaps from the shadow map
-        newShadowMap->SetNumLevels(1);
-
-        while (retries)
-        {
-            if (!newShadowMap->SetSize(width, height, shadowMapFormat, shadowMapUsage, multiSample))
-            {
-                width >>= 1;
-                height >>= 1;
-                --retries;
-            }
-            else
-            {
-#if !ALIMER_OPENGLES
-                // OpenGL (desktop) and D3D11: shadow compare mode needs to be specifically enabled for the shadow map
-                newShadowMap->SetFilterMode(FILTER_BILINEAR);
-                newShadowMap->SetShadowCompare(shadowMapUsage == TEXTURE_DEPTHSTENCIL);
-#endif
-#ifndef URHO3D_OPENGL
-                // Direct3D9: when shadow compare must be done manually, use nearest filtering so that the filtering of point lights
-                // and other shadowed lights matches
-                newShadowMap->SetFilterMode(graphics_->GetHardwareShadowSupport() ? FILTER_BILINEAR : FILTER_NEAREST);
-#endif
-                // Create dummy color texture for the shadow map if necessary: OpenGL when working around an OS X +
-                // Intel driver bug
-                if (shadowMapUsage == TEXTURE_DEPTHSTENCIL && dummyColorFormat)
-                {
-                    // If no dummy color rendertarget for this size exists yet, create one now
-                    if (!colorShadowMaps_.Contains(searchKey))
-                    {
-                        colorShadowMaps_[searchKey] = new Texture2D(context_);
-                        colorShadowMaps_[searchKey]->SetNumLevels(1);
-                        colorShadowMaps_[searchKey]->SetSize(width, height, dummyColorFormat, TEXTURE_RENDERTARGET);
-                    }
-                    // Link the color rendertarget to the shadow map
-                    newShadowMap->GetRenderSurface()->SetLinkedRenderTarget(colorShadowMaps_[searchKey]->GetRenderSurface());
-                }
-                break;
-            }
-        }
-
-        // If failed to set size, store a null pointer so that we will not retry
-        if (!retries)
-            newShadowMap.Reset();
-
+        SharedPtr<Texture2D> newShadowMap = CreateShadowMap(width, height, searchKey);
         shadowMaps_[searchKey].Push(newShadowMap);
         if (!reuseShadowMaps_)
             shadowMapAllocations_[searchKey].Push(light);
@@ -1123,6 +1072,146 @@ namespace Urho3D
         return buffer;
     }
 
+    /// Combine a float value into a hash.
+    static inline void CombineFloatHash(unsigned& hash, float value)
+    {
+        unsigned bits;
+        memcpy(&bits, &value, sizeof bits);
+        CombineHash(hash, bits);
+    }
+
+    /// Return a hash of the light state that affects the contents of its shadow map.
+    static unsigned GetShadowMapLightHash(Light* light, unsigned viewMask)
+    {
+        unsigned hash = viewMask;
+        CombineHash(hash, (unsigned)light->GetLightType());
+        CombineHash(hash, light->GetLightMask());
+
+        const Matrix3x4& transform = light->GetNode()->GetWorldTransform();
+        for (unsigned i = 0; i < 12; ++i)
+            CombineFloatHash(hash, transform.Data()[i]);
+
+        CombineFloatHash(hash, light->GetRange());
+        CombineFloatHash(hash, light->GetFov());
+        CombineFloatHash(hash, light->GetAspectRatio());
+        CombineFloatHash(hash, light->GetShadowNearFarRatio());
+        CombineFloatHash(hash, light->GetShadowResolution());
+
+        const BiasParameters& bias = light->GetShadowBias();
+        CombineFloatHash(hash, bias.constantBias_);
+        CombineFloatHash(hash, bias.slopeScaledBias_);
+        CombineFloatHash(hash, bias.normalOffset_);
+
+        const FocusParameters& focus = light->GetShadowFocus();
+        CombineHash(hash, (focus.focus_ ? 1u : 0u) | (focus.nonUniform_ ? 2u : 0u));
+        CombineFloatHash(hash, focus.quantize_);
+        CombineFloatHash(hash, focus.minView_);
+        return hash;
+    }
+
+    CachedShadowMap* Renderer::GetValidCachedShadowMap(Light* light, Octree* octree, unsigned viewMask)
+    {
+        HashMap<Light*, CachedShadowMap>::Iterator i = cachedShadowMaps_.Find(light);
+        if (i == cachedShadowMaps_.End() || !i->second_.valid_)
+            return nullptr;
+
+        CachedShadowMap& cached = i->second_;
+        if (cached.light_.Get() != light || cached.octree_ != octree || !cached.shadowMap_ || cached.shadowMap_->IsDataLost() ||
+            cached.lightHash_ != GetShadowMapLightHash(light, viewMask))
+        {
+            cached.valid_ = false;
+            return nullptr;
+        }
+
+        // Check the shadow casters changed since the last check. If an octree update was missed, the changes are not known
+        unsigned numUpdates = octree->GetNumUpdates();
+        if (cached.checkedUpdate_ != numUpdates)
+        {
+            if (cached.checkedUpdate_ + 1 != numUpdates)
+                cached.valid_ = false;
+            else
+            {
+                const PODVector<BoundingBox>& changes = octree->GetChangedShadowCasters();
+                for (PODVector<BoundingBox>::ConstIterator j = changes.Begin(); j != changes.End(); ++j)
+                {
+                    if (cached.lightBox_.IsInsideFast(*j) != OUTSIDE)
+                    {
+                        cached.valid_ = false;
+                        break;
+                    }
+                }
+            }
+            cached.checkedUpdate_ = numUpdates;
+        }
+
+        if (!cached.valid_)
+            return nullptr;
+
+        cached.lastUsedFrame_ = frame_.frameNumber_;
+        return &cached;
+    }
+
+    CachedShadowMap* Renderer::AllocateCachedShadowMap(Light* light, Octree* octree, unsigned viewMask, const BoundingBox& shadowCasterBox)
+    {
+        LightType type = light->GetLightType();
+        if (type == LightType::Directional)
+            return nullptr;
+
+        // The shadow map must suit any view, so it is not reduced by the distance to the camera
+        int width = NextPowerOfTwo((unsigned)((float)shadowMapSize_ * light->GetShadowResolution()));
+        int height = width;
+        if (type == LightType::Point)
+        {
+            width *= 2;
+            height *= 3;
+        }
+        int searchKey = width << 16u | height;
+
+        CachedShadowMap& cached = cachedShadowMaps_[light];
+        if (!cached.shadowMap_ || cached.shadowMap_->GetWidth() != width || cached.shadowMap_->GetHeight() != height)
+        {
+            cached.shadowMap_.Reset();
+
+            // Cached shadow maps share the budget with the shadow maps allocated per frame
+            unsigned numShadowMaps = shadowMaps_.Contains(searchKey) ? shadowMaps_[searchKey].Size() : 0;
+            if ((int)(numShadowMaps + GetNumCachedShadowMaps(searchKey)) >= maxShadowMaps_)
+            {
+                cachedShadowMaps_.Erase(light);
+                return nullptr;
+            }
+
+            cached.shadowMap_ = CreateShadowMap(width, height, searchKey);
+            if (!cached.shadowMap_)
+            {
+                cachedShadowMaps_.Erase(light);
+                return nullptr;
+            }
+        }
+
+        cached.light_ = light;
+        cached.octree_ = octree;
+        cached.lightHash_ = GetShadowMapLightHash(light, viewMask);
+        if (type == LightType::Spot)
+            cached.lightBox_ = BoundingBox(light->GetFrustum());
+        else
+        {
+            Vector3 center = light->GetNode()->GetWorldPosition();
+            Vector3 extent(light->GetRange(), light->GetRange(), light->GetRange());
+            cached.lightBox_ = BoundingBox(center - extent, center + extent);
+        }
+        cached.shadowCasterBox_ = shadowCasterBox;
+        cached.checkedUpdate_ = octree->GetNumUpdates();
+        cached.lastUsedFrame_ = frame_.frameNumber_;
+        cached.valid_ = false;
+        return &cached;
+    }
+
+    void Renderer::ResetCachedShadowMaps()
+    {
+        for (HashMap<Light*, CachedShadowMap>::Iterator i = cachedShadowMaps_.Begin(); i != cachedShadowMaps_.End(); ++i)
+            i->second_.valid_ = false;
+    }
+
     Camera* Renderer::GetShadowCamera()
     {
         lock_guard<mutex> lock(rendererMutex_);
@@ -1154,6 +1243,51 @@ namespace Urho3D
         return i != preparedViews_.End() ? i->second_ : nullptr;
     }
 
+    const SharedViewCulling* Renderer::GetSharedViewCulling(Octree* octree, Camera* camera, unsigned& frustumMask)
+    {
+        for (unsigned i = 0; i < sharedViewCulling_.Size(); ++i)
+        {
+            SharedViewCulling& culling = sharedViewCulling_[i];
+            if (culling.octree_ != octree)
+                continue;
+
+            PODVector<Camera*>::ConstIterator j = culling.cameras_.Find(camera);
+            if (j == culling.cameras_.End())
+                return nullptr;
+
+            // The camera may have been moved or changed by view update event handlers, in which case it must be culled on its own
+            unsigned index = (unsigned)(j - culling.cameras_.Begin());
+            const Frustum& frustum = camera->GetFrustum();
+            if (camera->GetViewMask() != culling.viewMasks_[index])
+                return nullptr;
+            for (unsigned k = 0; k < NUM_FRUSTUM_VERTICES; ++k)
+            {
+                if (frustum.vertices_[k] != culling.frustums_[index].vertices_[k])
+                    return nullptr;
+            }
+
+            // Cull on first use, and again if drawables have been added, removed or reinserted since. The results are only kept
+            // for one frame: a drawable that moves within its octant after the first view culls keeps the bits of its old bounds
+            if (!culling.queried_ || culling.contentVersion_ != octree->GetContentVersion())
+            {
+                URHO3D_PROFILE(SharedCulling);
+
+                MultiFrustumOctreeQuery query(culling.drawables_, culling.masks_, DRAWABLE_GEOMETRY | DRAWABLE_LIGHT | DRAWABLE_ZONE);
+                for (unsigned k = 0; k < culling.frustums_.Size(); ++k)
+                    query.AddFrustum(culling.frustums_[k], culling.viewMasks_[k]);
+                octree->GetDrawables(query);
+
+                culling.contentVersion_ = octree->GetContentVersion();
+                culling.queried_ = true;
+            }
+
+            frustumMask = 1u << index;
+            return &culling;
+        }
+
+        return nullptr;
+    }
+
     View* Renderer::GetActualView(View* view)
     {
         if (view && view->GetSourceView())
@@ -1526,6 +1660,76 @@ namespace Urho3D
         view->Update(frame_);
     }
 
+    void Renderer::PrepareSharedCulling(unsigned start, unsigned end)
+    {
+        sharedViewCulling_.Clear();
+        if (!sharedCulling_)
+            return;
+
+        for (unsigned i = start; i < end; ++i)
+        {
+            WeakPtr<RenderSurface>& renderTarget = queuedViewports_[i].first_;
+            WeakPtr<Viewport>& viewport = queuedViewports_[i].second_;
+            if ((renderTarget.NotNull() && renderTarget.Expired()) || viewport.Expired())
+                continue;
+
+            Scene* scene = viewport->GetScene();
+            Camera* camera = viewport->GetCullCamera() ? viewport->GetCullCamera() : viewport->GetCamera();
+            auto* octree = scene ? scene->GetComponent<Octree>() : nullptr;
+            if (!octree || !camera || !viewport->GetRenderPath())
+                continue;
+
+            SharedViewCulling* culling = nullptr;
+            for (unsigned j = 0; j < sharedViewCulling_.Size(); ++j)
+            {
+                if (sharedViewCulling_[j].octree_ == octree)
+                {
+                    culling = &sharedViewCulling_[j];
+                    break;
+                }
+            }
+            if (!culling)
+            {
+                sharedViewCulling_.Resize(sharedViewCulling_.Size() + 1);
+                culling = &sharedViewCulling_.Back();
+                culling->octree_ = octree;
+                culling->contentVersion_ = 0;
+                culling->queried_ = false;
+            }
+
+            // Views sharing a culling camera are prepared only once
+            if (culling->cameras_.Contains(camera) || culling->cameras_.Size() >= MAX_QUERY_FRUSTUMS)
+                continue;
+
+            // Apply the automatic aspect ratio now, as the view will before culling
+            if (camera->GetAutoAspectRatio())
+            {
+                int width = renderTarget ? renderTarget->GetWidth() : graphics_->GetWidth();
+                int height = renderTarget ? renderTarget->GetHeight() : graphics_->GetHeight();
+                const IntRect& rect = viewport->GetRect();
+                if (rect != IntRect::ZERO)
+                {
+                    int left = Clamp(rect.left_, 0, width - 1);
+                    int top = Clamp(rect.top_, 0, height - 1);
+                    width = Clamp(rect.right_, left + 1, width) - left;
+                    height = Clamp(rect.bottom_, top + 1, height) - top;
+                }
+                camera->SetAspectRatioInternal((float)width / (float)height);
+            }
+
+            culling->cameras_.Push(camera);
+            culling->frustums_.Push(camera->GetFrustum());
+            culling->viewMasks_.Push(camera->GetViewMask());
+        }
+
+        // A single view gains nothing, and would lose octant occlusion
+        for (unsigned i = sharedViewCulling_.Size() - 1; i < sharedViewCulling_.Size(); --i)
+        {
+            if (sharedViewCulling_[i].cameras_.Size() < 2)
+                sharedViewCulling_.Erase(i);
+        }
+    }
+
     void Renderer::PrepareViewRender()
     {
         ResetScreenBufferAllocations();
@@ -1535,6 +1739,13 @@ namespace Urho3D
 
     void Renderer::RemoveUnusedBuffers()
     {
+        for (HashMap<Light*, CachedShadowMap>::Iterator i = cachedShadowMaps_.Begin(); i != cachedShadowMaps_.End();)
+        {
+            HashMap<Light*, CachedShadowMap>::Iterator current = i++;
+            if (current->second_.light_.Expired() || frame_.frameNumber_ - current->second_.lastUsedFrame_ > MAX_CACHED_SHADOW_MAP_AGE)
+                cachedShadowMaps_.Erase(current);
+        }
+
         for (unsigned i = occlusionBuffers_.Size() - 1; i < occlusionBuffers_.Size(); --i)
         {
             if (occlusionBuffers_[i]->GetUseTimer() > MAX_BUFFER_AGE)
@@ -1566,6 +1777,100 @@ namespace Urho3D
         }
     }
 
+    SharedPtr<Texture2D> Renderer::CreateShadowMap(int width, int height, int searchKey)
+    {
+        // Find format and usage of the shadow map
+        unsigned shadowMapFormat = 0;
+        TextureUsage shadowMapUsage = TEXTURE_DEPTHSTENCIL;
+        int multiSample = 1;
+
+        switch (shadowQuality_)
+        {
+            case SHADOWQUALITY_SIMPLE_16BIT:
+            case SHADOWQUALITY_PCF_16BIT:
+                shadowMapFormat = graphics_->GetShadowMapFormat();
+                break;
+
+            case SHADOWQUALITY_SIMPLE_24BIT:
+            case SHADOWQUALITY_PCF_24BIT:
+                shadowMapFormat = graphics_->GetHiresShadowMapFormat();
+                break;
+
+            case SHADOWQUALITY_VSM:
+            case SHADOWQUALITY_BLUR_VSM:
+                shadowMapFormat = graphics_->GetRGFloat32Format();
+                shadowMapUsage = TEXTURE_RENDERTARGET;
+                multiSample = vsmMultiSample_;
+                break;
+        }
+
+        if (!shadowMapFormat)
+            return SharedPtr<Texture2D>();
+
+        SharedPtr<Texture2D> newShadowMap(new Texture2D(context_));
+        int retries = 3;
+        unsigned dummyColorFormat = graphics_->GetDummyColorFormat();
+
+        // Disable mipmaps from the shadow map
+        newShadowMap->SetNumLevels(1);
+
+        while (retries)
+        {
+            if (!newShadowMap->SetSize(width, height, shadowMapFormat, shadowMapUsage, multiSample))
+            {
+                width >>= 1;
+                height >>= 1;
+                --retries;
+            }
+            else
+            {
+#if !ALIMER_OPENGLES
+                // OpenGL (desktop) and D3D11: shadow compare mode needs to be specifically enabled for the shadow map
+                newShadowMap->SetFilterMode(FILTER_BILINEAR);
+                newShadowMap->SetShadowCompare(shadowMapUsage == TEXTURE_DEPTHSTENCIL);
+#endif
+#ifndef URHO3D_OPENGL
+                // Direct3D9: when shadow compare must be done manually, use nearest filtering so that the filtering of point lights
+                // and other shadowed lights matches
+                newShadowMap->SetFilterMode(graphics_->GetHardwareShadowSupport() ? FILTER_BILINEAR : FILTER_NEAREST);
+#endif
+                // Create dummy color texture for the shadow map if necessary: OpenGL when working around an OS X +
+                // Intel driver bug
+                if (shadowMapUsage == TEXTURE_DEPTHSTENCIL && dummyColorFormat)
+                {
+                    // If no dummy color rendertarget for this size exists yet, create one now
+                    if (!colorShadowMaps_.Contains(searchKey))
+                    {
+                        colorShadowMaps_[searchKey] = new Texture2D(context_);
+                        colorShadowMaps_[searchKey]->SetNumLevels(1);
+                        colorShadowMaps_[searchKey]->SetSize(width, height, dummyColorFormat, TEXTURE_RENDERTARGET);
+                    }
+                    // Link the color rendertarget to the shadow map
+                    newShadowMap->GetRenderSurface()->SetLinkedRenderTarget(colorShadowMaps_[searchKey]->GetRenderSurface());
+                }
+                break;
+            }
+        }
+
+        // If failed to set size, return a null pointer so that we will not retry
+        if (!retries)
+            newShadowMap.Reset();
+
+        return newShadowMap;
+    }
+
+    unsigned Renderer::GetNumCachedShadowMaps(int searchKey) const
+    {
+        unsigned count = 0;
+        for (HashMap<Light*, CachedShadowMap>::ConstIterator i = cachedShadowMaps_.Begin(); i != cachedShadowMaps_.End(); ++i)
+        {
+            Texture2D* shadowMap = i->second_.shadowMap_;
+            if (shadowMap && (shadowMap->GetWidth() << 16u | shadowMap->GetHeight()) == searchKey)
+                ++count;
+        }
+        return count;
+    }
+
     void Renderer::ResetShadowMapAllocations()
     {
         for (HashMap<int, PODVector<Light*> >::Iterator i = shadowMapAllocations_.Begin(); i != shadowMapAllocations_.End(); ++i)
@@ -1895,6 +2200,7 @@ namespace Urho3D
         shadowMaps_.Clear();
         shadowMapAllocations_.Clear();
         colorShadowMaps_.Clear();
+        cachedShadowMaps_.Clear();
     }
 
     void Renderer::ResetBuffers()
@@ -26,6 +26,7 @@
 #include "../Graphics/Drawable.h"
 #include "../Graphics/Viewport.h"
 #include "../Math/Color.h"
+#include "../Math/Frustum.h"
 #include <mutex>
 #include <unordered_set>
 
@@ -168,6 +169,50 @@ namespace Urho3D
         MAX_DEFERRED_LIGHT_PS_VARIATIONS
     };
 
+    /// Zones, occluders, geometries and lights culled once against the frustums of all views that show the same octree.
+    struct SharedViewCulling
+    {
+        /// Octree.
+        Octree* octree_;
+        /// Culling cameras of the views, one per frustum.
+        PODVector<Camera*> cameras_;
+        /// Culling camera frustums at the time the views were queued.
+        Vector<Frustum> frustums_;
+        /// Culling camera view masks.
+        PODVector<unsigned> viewMasks_;
+        /// Drawables inside any of the frustums, in octree traversal order.
+        PODVector<Drawable*> drawables_;
+        /// Bitmask of the frustums each drawable is inside of.
+        PODVector<unsigned> masks_;
+        /// Octree content version the drawables were queried at.
+        unsigned contentVersion_;
+        /// Queried flag.
+        bool queried_;
+    };
+
+    /// Shadow map of a spot or point light that is kept between frames while the light and its shadow casters do not change.
+    struct CachedShadowMap
+    {
+        /// Light.
+        WeakPtr<Light> light_;
+        /// Octree the shadow casters were collected from.
+        Octree* octree_{};
+        /// Shadow map texture.
+        SharedPtr<Texture2D> shadowMap_;
+        /// Hash of the light state and view mask the shadow map was rendered with.
+        unsigned lightHash_{};
+        /// World bounding box of the light volume.
+        BoundingBox lightBox_;
+        /// Combined bounding box of shadow casters in light projection space. Only used for focused spot lights.
+        BoundingBox shadowCasterBox_;
+        /// Octree update count the shadow casters were last checked for changes at.
+        unsigned checkedUpdate_{};
+        /// Frame number the shadow map was last used on.
+        unsigned lastUsedFrame_{};
+        /// Shadow map has been rendered and is still valid flag.
+        bool valid_{};
+    };
+
     /// High-level rendering subsystem. Manages drawing of 3D views.
     class URHO3D_API Renderer : public Object
     {
@@ -236,9 +281,12 @@ namespace Urho3D
         /// Set reuse of shadow maps. Default is true. If disabled, also transparent geometry can be shadowed.
         /// @property
         void SetReuseShadowMaps(bool enable);
-        /// Set maximum number of shadow maps created for one resolution. Only has effect if reuse of shadow maps is disabled.
+        /// Set maximum number of shadow maps created for one resolution. Only has effect if reuse of shadow maps is disabled, or shadow maps are cached.
         /// @property
         void SetMaxShadowMaps(int shadowMaps);
+        /// Set whether shadow maps of spot and point lights are kept between frames, and shadow casters are culled and rendered again only when the light or a shadow caster within its range has moved, been added or removed. Cached shadow maps count against the maximum number of shadow maps per resolution, which includes the shared shadow map when reuse is enabled. Their shadow casters are collected regardless of the view, so per-drawable shadow and draw distances do not apply. Default false.
+        /// @property
+        void SetCacheShadowMaps(bool enable);
         /// Set dynamic instancing on/off. When on (default), drawables using the same static-type geometry and material will be automatically combined to an instanced draw call.
         /// @property
         void SetDynamicInstancing(bool enable);
@@ -263,6 +311,12 @@ namespace Urho3D
         /// Set whether to thread occluder rendering. Default false.
         /// @property
         void SetThreadedOcclusion(bool enable);
+        /// Set whether views start occlusion from the previous frame's occlusion buffer reprojected to the current camera, and draw only occluders not drawn yet. Suits mostly static occluders. Default false.
+        /// @property
+        void SetTemporalOcclusion(bool enable);
+        /// Set whether views of the same scene are frustum culled together in one octree traversal. Applies when at least two views are updated at the same time. Default true.
+        /// @property
+        void SetSharedCulling(bool enable);
         /// Set shadow depth bias multiplier for mobile platforms to counteract possible worse shadow map precision. Default 1.0 (no effect).
         /// @property
         void SetMobileShadowBiasMul(float mul);
@@ -350,6 +404,10 @@ namespace Urho3D
         /// @property
         int GetMaxShadowMaps() const { return maxShadowMaps_; }
 
+        /// Return whether shadow maps of spot and point lights are cached.
+        /// @property
+        bool GetCacheShadowMaps() const { return cacheShadowMaps_; }
+
         /// Return whether dynamic instancing is in use.
         /// @property
         bool GetDynamicInstancing() const { return dynamicInstancing_; }
@@ -382,6 +440,14 @@ namespace Urho3D
         /// @property
         bool GetThreadedOcclusion() const { return threadedOcclusion_; }
 
+        /// Return whether temporal occlusion is used.
+        /// @property
+        bool GetTemporalOcclusion() const { return temporalOcclusion_; }
+
+        /// Return whether views of the same scene are frustum culled together.
+        /// @property
+        bool GetSharedCulling() const { return sharedCulling_; }
+
         /// Return shadow depth bias multiplier for mobile platforms.
         /// @property
         float GetMobileShadowBiasMul() const { return mobileShadowBiasMul_; }
@@ -471,12 +537,20 @@ namespace Urho3D
         RenderSurface* GetDepthStencil(int width, int height, int multiSample, bool autoResolve);
         /// Allocate an occlusion buffer.
         OcclusionBuffer* GetOcclusionBuffer(Camera* camera);
+        /// Return the cached shadow map of a light if it is still valid for the light's current state and the shadow casters in the octree, or null. Is thread-safe for different lights.
+        CachedShadowMap* GetValidCachedShadowMap(Light* light, Octree* octree, unsigned viewMask);
+        /// Allocate a cached shadow map for a light whose shadow casters have been collected regardless of the view. Return null if the shadow map budget does not allow it.
+        CachedShadowMap* AllocateCachedShadowMap(Light* light, Octree* octree, unsigned viewMask, const BoundingBox& shadowCasterBox);
+        /// Discard the contents of all cached shadow maps, so that they are rendered again. Needed for changes that are not detected automatically, such as shadow caster material changes.
+        void ResetCachedShadowMaps();
         /// Allocate a temporary shadow camera and a scene node for it. Is thread-safe.
         Camera* GetShadowCamera();
         /// Mark a view as prepared by the specified culling camera.
         void StorePreparedView(View* view, Camera* camera);
         /// Return a prepared view if exists for the specified camera. Used to avoid duplicate view preparation CPU work.
         View* GetPreparedView(Camera* camera);
+        /// Return drawables culled together for the views of an octree, and the bit of the culling camera's frustum in their masks. Null if the camera's view was not culled together with others or its frustum has changed since. Called internally by View.
+        const SharedViewCulling* GetSharedViewCulling(Octree* octree, Camera* camera, unsigned& frustumMask);
         /// Choose shaders for a forward rendering batch. The related batch queue is provided in case it has extra shader compilation defines.
         void SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows, const BatchQueue& queue);
         /// Choose shaders for a deferred light volume batch.
@@ -515,10 +589,16 @@ namespace Urho3D
         void SetIndirectionTextureData();
         /// Update a queued viewport for rendering.
         void UpdateQueuedViewport(unsigned index);
+        /// Collect the culling frustums of a range of queued viewports for shared culling.
+        void PrepareSharedCulling(unsigned start, unsigned end);
         /// Prepare for rendering of a new view.
         void PrepareViewRender();
         /// Remove unused occlusion and screen buffers.
         void RemoveUnusedBuffers();
+        /// Create a shadow map texture. The size is reduced if creation fails. Return null on failure.
+        SharedPtr<Texture2D> CreateShadowMap(int width, int height, int searchKey);
+        /// Return number of cached shadow maps with a resolution search key.
+        unsigned GetNumCachedShadowMaps(int searchKey) const;
         /// Reset shadow map allocation counts.
         void ResetShadowMapAllocations();
         /// Reset screem buffer allocation counts.
@@ -572,6 +652,8 @@ namespace Urho3D
         HashMap<int, SharedPtr<Texture2D> > colorShadowMaps_;
         /// Shadow map allocations by resolution.
         HashMap<int, PODVector<Light*> > shadowMapAllocations_;
+        /// Cached shadow maps by light.
+        HashMap<Light*, CachedShadowMap> cachedShadowMaps_;
         /// Instance of shadow map filter.
         Object* shadowMapFilterInstance_{};
         /// Function pointer of shadow map filter.
@@ -592,6 +674,8 @@ namespace Urho3D
         HashMap<Camera*, WeakPtr<View> > preparedViews_;
         /// Octrees that have been updated during the frame.
         std::unordered_set<Octree*> updatedOctrees_;
+        /// Shared culling of the views being updated, per octree.
+        Vector<SharedViewCulling> sharedViewCulling_;
         /// Techniques for which missing shader error has been displayed.
         std::unordered_set<Technique*> shaderErrorDisplayed_;
         /// Mutex for shadow camera allocation.
@@ -662,6 +746,12 @@ namespace Urho3D
         int numExtraInstancingBufferElements_{};
         /// Threaded occlusion rendering flag.
         bool threadedOcclusion_{};
+        /// Temporal occlusion flag.
+        bool temporalOcclusion_{};
+        /// Shared culling flag.
+        bool sharedCulling_{ true };
+        /// Shadow map caching flag.
+        bool cacheShadowMaps_{};
         /// Shaders need reloading flag.
         bool shadersDirty_{ true };
         /// Initialized flag.
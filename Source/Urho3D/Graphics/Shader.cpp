@@ -61,6 +61,41 @@ void CommentOutFunction(String& code, const String& signature)
     }
 }
 
+static void StripComments(String& code)
+{
+    String stripped;
+    stripped.Reserve(code.Length());
+
+    unsigned length = code.Length();
+    for (unsigned i = 0; i < length; ++i)
+    {
+        if (code[i] == '/' && i + 1 < length && code[i + 1] == '/')
+        {
+            // Line comment: skip to the end of line, but keep the line break
+            while (i + 1 < length && code[i + 1] != '\n')
+                ++i;
+        }
+        else if (code[i] == '/' && i + 1 < length && code[i + 1] == '*')
+        {
+            // Block comment: keep only the line breaks
+            for (i += 2; i < length; ++i)
+            {
+                if (code[i] == '*' && i + 1 < length && code[i + 1] == '/')
+                {
+                    ++i;
+                    break;
+                }
+                if (code[i] == '\n')
+                    stripped += '\n';
+            }
+        }
+        else
+            stripped += code[i];
+    }
+
+    code = stripped;
+}
+
 Shader::Shader(Context* context) :
     Resource(context),
     timeStamp_(0),
@@ -87,12 +122,22 @@ bool Shader::BeginLoad(Deserializer& source)
     if (!graphics)
         return false;
 
+    // Variations may be prepared in worker threads from the current source code. Finish or discard the preparations
+    // before reloading
+    for (HashMap<StringHash, SharedPtr<ShaderVariation> >::Iterator i = vsVariations_.Begin(); i != vsVariations_.End(); ++i)
+        i->second_->ReleasePrepared();
+    for (HashMap<StringHash, SharedPtr<ShaderVariation> >::Iterator i = psVariations_.Begin(); i != psVariations_.End(); ++i)
+        i->second_->ReleasePrepared();
+
     // Load the shader source code and resolve any includes
     timeStamp_ = 0;
     String shaderCode;
     if (!ProcessSource(shaderCode, source))
         return false;
 
+    // Strip comments so that they are neither searched below nor passed to the compiler for each variation
+    StripComments(shaderCode);
+
     // Comment out the unneeded shader function
     vsSourceCode_ = shaderCode;
     psSourceCode_ = shaderCode;
@@ -23,18 +23,67 @@
 
 #include "../Precompiled.h"
 
+#include "../Core/CoreEvents.h"
+#include "../Core/Timer.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/Graphics.h"
+#include "../Graphics/GraphicsEvents.h"
 #include "../Graphics/GraphicsImpl.h"
+#include "../Graphics/Shader.h"
 #include "../Graphics/ShaderPrecache.h"
 #include "../Graphics/ShaderVariation.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
+#include "../Resource/ResourceCache.h"
 
 #include "../DebugNew.h"
 
 using namespace Urho3D;
 
+namespace
+{
+    /// Work item for preparing a shader variation. Holds the variation so that it stays valid until the item has run.
+    struct ShaderPrepareWorkItem : public WorkItem
+    {
+        /// Shader variation to prepare.
+        SharedPtr<ShaderVariation> variation_;
+    };
+
+    void PrepareShaderWork(const WorkItem* item, unsigned /*threadIndex*/)
+    {
+        static_cast<const ShaderPrepareWorkItem*>(item)->variation_->PrepareQueued();
+    }
+
+    /// Queue a shader variation for preparation in a worker thread. Return false if it is already created or queued.
+    bool QueuePrepareWork(WorkQueue* queue, ShaderVariation* variation, unsigned priority)
+    {
+        if (!queue || !variation || !variation->QueuePrepare())
+            return false;
+
+        SharedPtr<ShaderPrepareWorkItem> item(new ShaderPrepareWorkItem());
+        item->variation_ = variation;
+        item->workFunction_ = PrepareShaderWork;
+        item->priority_ = priority;
+        queue->AddWorkItem(item);
+        return true;
+    }
+
+    /// Return whether a shader combination can be used. Illegal variations on OpenGL ES are skipped.
+    bool IsSupportedCombination(const String& vsDefines, const String& psDefines)
+    {
+#if ALIMER_OPENGLES
+        if (
+#ifndef __EMSCRIPTEN__
+            vsDefines.Contains("INSTANCED") ||
+#endif
+            (psDefines.Contains("POINTLIGHT") && psDefines.Contains("SHADOW")))
+            return false;
+#endif
+        return true;
+    }
+}
+
 ShaderPrecache::ShaderPrecache(Context* context, const String& fileName_)
     : Object(context)
     , fileName(fileName_)
@@ -111,32 +160,250 @@ void ShaderPrecache::LoadShaders(Graphics* graphics, Deserializer& source)
     XMLFile xmlFile(graphics->GetContext());
     xmlFile.Load(source);
 
+    std::vector<std::pair<ShaderVariation*, ShaderVariation*> > combinations;
+
     XMLElement shader = xmlFile.GetRoot().GetChild("shader");
     while (shader)
     {
         String vsDefines = shader.GetAttribute("vsdefines");
         String psDefines = shader.GetAttribute("psdefines");
 
-        // Check for illegal variations on OpenGL ES and skip them
-#if ALIMER_OPENGLES
-        if (
-#ifndef __EMSCRIPTEN__
-            vsDefines.Contains("INSTANCED") ||
-#endif
-            (psDefines.Contains("POINTLIGHT") && psDefines.Contains("SHADOW")))
+        if (IsSupportedCombination(vsDefines, psDefines))
         {
-            shader = shader.GetNext("shader");
-            continue;
+            ShaderVariation* vs = graphics->GetShader(VS, shader.GetAttribute("vs"), vsDefines);
+            ShaderVariation* ps = graphics->GetShader(PS, shader.GetAttribute("ps"), psDefines);
+            combinations.push_back(std::make_pair(vs, ps));
         }
-#endif
-
-        ShaderVariation* vs = graphics->GetShader(VS, shader.GetAttribute("vs"), vsDefines);
-        ShaderVariation* ps = graphics->GetShader(PS, shader.GetAttribute("ps"), psDefines);
-        // Set the shaders active to actually compile them
-        graphics->SetShaders(vs, ps);
 
         shader = shader.GetNext("shader");
     }
 
+    // Prepare the variations in worker threads first
+    auto* queue = graphics->GetSubsystem<WorkQueue>();
+    for (unsigned i = 0; i < combinations.size(); ++i)
+    {
+        QueuePrepareWork(queue, combinations[i].first, M_MAX_UNSIGNED);
+        QueuePrepareWork(queue, combinations[i].second, M_MAX_UNSIGNED);
+    }
+    if (queue)
+        queue->Complete(M_MAX_UNSIGNED);
+
+    // Set the shaders active to actually compile them
+    for (unsigned i = 0; i < combinations.size(); ++i)
+        graphics->SetShaders(combinations[i].first, combinations[i].second);
+
+    // Release the preparations left unused, for example when a program was loaded from a program binary on OpenGL
+    for (unsigned i = 0; i < combinations.size(); ++i)
+    {
+        if (combinations[i].first)
+            combinations[i].first->ReleasePrepared();
+        if (combinations[i].second)
+            combinations[i].second->ReleasePrepared();
+    }
+
     URHO3D_LOGDEBUG("End precaching shaders");
 }
+
+ShaderPrecacheLoader::ShaderPrecacheLoader(Context* context, Deserializer& source, const String& shaderPath, const String& shaderExtension)
+    : Object(context)
+    , numSources_(0)
+    , nextCombination_(0)
+    , maxCreateMs_(5)
+    , prepared_(false)
+    , finished_(false)
+{
+    URHO3D_LOGDEBUG("Begin precaching shaders asynchronously");
+
+    XMLFile xmlFile(context_);
+    xmlFile.Load(source);
+
+    std::unordered_set<String> sources;
+
+    XMLElement shader = xmlFile.GetRoot().GetChild("shader");
+    while (shader)
+    {
+        Combination combination;
+        combination.vsName_ = shader.GetAttribute("vs");
+        combination.vsDefines_ = shader.GetAttribute("vsdefines");
+        combination.psName_ = shader.GetAttribute("ps");
+        combination.psDefines_ = shader.GetAttribute("psdefines");
+        combination.vs_ = nullptr;
+        combination.ps_ = nullptr;
+
+        if (IsSupportedCombination(combination.vsDefines_, combination.psDefines_))
+        {
+            sources.insert(shaderPath + combination.vsName_ + shaderExtension);
+            sources.insert(shaderPath + combination.psName_ + shaderExtension);
+            combinations_.push_back(combination);
+        }
+
+        shader = shader.GetNext("shader");
+    }
+
+    // Load and preprocess the shader source files in the background
+    auto* cache = GetSubsystem<ResourceCache>();
+    for (std::unordered_set<String>::const_iterator i = sources.begin(); i != sources.end(); ++i)
+    {
+        if (!cache->GetExistingResource<Shader>(*i))
+        {
+            cache->BackgroundLoadResource<Shader>(*i);
+            pendingSources_.push_back(*i);
+        }
+    }
+    numSources_ = (unsigned)sources.size();
+
+    SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(ShaderPrecacheLoader, HandleBeginFrame));
+}
+
+ShaderPrecacheLoader::~ShaderPrecacheLoader()
+{
+    if (!finished_)
+        Finish();
+}
+
+float ShaderPrecacheLoader::GetProgress() const
+{
+    if (finished_)
+        return 1.0f;
+
+    // Before the variations are known, assume that each combination adds two
+    unsigned numCombinations = (unsigned)combinations_.size();
+    unsigned numVariations = prepared_ ? (unsigned)variations_.size() : numCombinations * 2;
+    unsigned numPrepared = 0;
+    for (unsigned i = 0; i < variations_.size(); ++i)
+    {
+        if (!variations_[i]->IsPreparing())
+            ++numPrepared;
+    }
+
+    unsigned total = numSources_ + numVariations + numCombinations;
+    unsigned done = numSources_ - (unsigned)pendingSources_.size() + numPrepared + nextCombination_;
+    return total ? (float)done / (float)total : 1.0f;
+}
+
+void ShaderPrecacheLoader::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
+{
+    auto* graphics = GetSubsystem<Graphics>();
+    if (!graphics || !graphics->IsInitialized())
+        return;
+
+    if (!prepared_)
+    {
+        if (!UpdateSources())
+        {
+            SendProgressEvent();
+            return;
+        }
+
+        PrepareVariations();
+    }
+
+    if (CreateShaders())
+        Finish();
+
+    SendProgressEvent();
+}
+
+bool ShaderPrecacheLoader::UpdateSources()
+{
+    auto* cache = GetSubsystem<ResourceCache>();
+    for (std::vector<String>::iterator i = pendingSources_.begin(); i != pendingSources_.end();)
+    {
+        if (cache->GetExistingResource<Shader>(*i))
+            i = pendingSources_.erase(i);
+        else
+            ++i;
+    }
+
+    // Source files that failed to load never appear in the cache, so stop waiting once the background loader is idle
+    return pendingSources_.empty() || !cache->GetNumBackgroundLoadResources();
+}
+
+void ShaderPrecacheLoader::PrepareVariations()
+{
+    auto* graphics = GetSubsystem<Graphics>();
+    auto* queue = GetSubsystem<WorkQueue>();
+
+    // Any sources still missing are loaded synchronously here, and fail with an error
+    pendingSources_.clear();
+
+    for (unsigned i = 0; i < combinations_.size(); ++i)
+    {
+        Combination& combination = combinations_[i];
+        combination.vs_ = graphics->GetShader(VS, combination.vsName_, combination.vsDefines_);
+        combination.ps_ = graphics->GetShader(PS, combination.psName_, combination.psDefines_);
+
+        ShaderVariation* variations[] = {combination.vs_, combination.ps_};
+        for (unsigned j = 0; j < 2; ++j)
+        {
+            ShaderVariation* variation = variations[j];
+            if (!variation)
+                continue;
+
+            // Hold the shader so that the variations do not expire before they are created
+            SharedPtr<Shader> owner(variation->GetOwner());
+            if (owner && std::find(shaders_.begin(), shaders_.end(), owner) == shaders_.end())
+                shaders_.push_back(owner);
+
+            // Use the lowest priority, so that rendering work is never held up
+            if (QueuePrepareWork(queue, variation, 0))
+                variations_.push_back(SharedPtr<ShaderVariation>(variation));
+        }
+    }
+
+    prepared_ = true;
+}
+
+bool ShaderPrecacheLoader::CreateShaders()
+{
+    auto* graphics = GetSubsystem<Graphics>();
+    HiresTimer timer;
+
+    while (nextCombination_ < combinations_.size())
+    {
+        const Combination& combination = combinations_[nextCombination_];
+
+        // Wait for the worker threads instead of preparing in the main thread
+        if ((combination.vs_ && combination.vs_->IsPreparing()) || (combination.ps_ && combination.ps_->IsPreparing()))
+            break;
+
+        // Set the shaders active to actually create them
+        if (combination.vs_ && combination.ps_)
+            graphics->SetShaders(combination.vs_, combination.ps_);
+        ++nextCombination_;
+
+        if (timer.GetUSec(false) >= maxCreateMs_ * 1000LL)
+            break;
+    }
+
+    return nextCombination_ >= combinations_.size();
+}
+
+void ShaderPrecacheLoader::SendProgressEvent()
+{
+    using namespace ShaderPrecacheProgress;
+
+    VariantMap& eventData = GetEventDataMap();
+    eventData[P_PROGRESS] = GetProgress();
+    eventData[P_NUMCREATED] = nextCombination_;
+    eventData[P_NUMCOMBINATIONS] = (unsigned)combinations_.size();
+    eventData[P_FINISHED] = finished_;
+    SendEvent(E_SHADERPRECACHEPROGRESS, eventData);
+}
+
+void ShaderPrecacheLoader::Finish()
+{
+    // Take back the variations still queued, and release the preparations left unused, for example when a program was
+    // loaded from a program binary on OpenGL. Queued work items do nothing for variations taken back
+    for (unsigned i = 0; i < variations_.size(); ++i)
+        variations_[i]->ReleasePrepared();
+
+    pendingSources_.clear();
+    variations_.clear();
+    shaders_.clear();
+    finished_ = true;
+
+    UnsubscribeFromEvent(E_BEGINFRAME);
+
+    URHO3D_LOGDEBUG("End precaching shaders asynchronously");
+}
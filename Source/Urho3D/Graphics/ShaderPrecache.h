@@ -29,6 +29,7 @@
 namespace Urho3D
 {
     class Graphics;
+    class Shader;
     class ShaderVariation;
 
     /// Utility class for collecting used shader combinations during runtime for precaching.
@@ -58,4 +59,76 @@ namespace Urho3D
         /// Already encountered shader combinations.
         std::unordered_set<String> usedCombinations;
     };
+
+    /// Utility class for precaching the shader combinations of an XML file over several frames. The shader source files are loaded and preprocessed by the resource background loader, and the shader variations are prepared in worker threads. The main thread then creates the prepared shaders within a time budget per frame, and sends the ShaderPrecacheProgress event.
+    class URHO3D_API ShaderPrecacheLoader : public Object
+    {
+        URHO3D_OBJECT(ShaderPrecacheLoader, Object);
+
+    public:
+        /// Construct and begin loading the shader source files of the combinations listed in XML.
+        ShaderPrecacheLoader(Context* context, Deserializer& source, const String& shaderPath, const String& shaderExtension);
+        /// Destruct. Take back the shader variations not yet prepared.
+        ~ShaderPrecacheLoader() override;
+
+        /// Set maximum milliseconds per frame to spend on creating shaders in the main thread.
+        void SetMaxCreateMs(int ms) { maxCreateMs_ = Max(ms, 1); }
+
+        /// Return whether all shader combinations have been created.
+        bool IsFinished() const { return finished_; }
+        /// Return approximate progress from 0 to 1.
+        float GetProgress() const;
+        /// Return maximum milliseconds per frame to spend on creating shaders in the main thread.
+        int GetMaxCreateMs() const { return maxCreateMs_; }
+
+    private:
+        /// Shader combination listed in XML.
+        struct Combination
+        {
+            /// Vertex shader name.
+            String vsName_;
+            /// Vertex shader defines.
+            String vsDefines_;
+            /// Pixel shader name.
+            String psName_;
+            /// Pixel shader defines.
+            String psDefines_;
+            /// Vertex shader variation.
+            ShaderVariation* vs_;
+            /// Pixel shader variation.
+            ShaderVariation* ps_;
+        };
+
+        /// Handle frame start event. Advance the precaching.
+        void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+        /// Return whether all shader source files have been loaded or failed.
+        bool UpdateSources();
+        /// Get the shader variations of the combinations and queue them for preparation.
+        void PrepareVariations();
+        /// Create the prepared shader combinations within the time budget. Return true when all are done.
+        bool CreateShaders();
+        /// Send the progress event.
+        void SendProgressEvent();
+        /// Take back the shader variations not yet prepared and release the data.
+        void Finish();
+
+        /// Shader combinations.
+        std::vector<Combination> combinations_;
+        /// Shader source file resource names not yet loaded.
+        std::vector<String> pendingSources_;
+        /// Loaded shader resources. Held so that they can not expire during preparation in worker threads.
+        std::vector<SharedPtr<Shader> > shaders_;
+        /// Shader variations queued for preparation.
+        std::vector<SharedPtr<ShaderVariation> > variations_;
+        /// Number of shader source files.
+        unsigned numSources_;
+        /// Index of the next combination to create.
+        unsigned nextCombination_;
+        /// Maximum milliseconds per frame to spend on creating shaders in the main thread.
+        int maxCreateMs_;
+        /// Variations queued for preparation flag.
+        bool prepared_;
+        /// Finished flag.
+        bool finished_;
+    };
 }
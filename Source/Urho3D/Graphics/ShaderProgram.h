@@ -26,6 +26,8 @@
 
 #if defined(URHO3D_OPENGL)
 #include "OpenGL/OGLShaderProgram.h"
+#elif defined(URHO3D_NULLGRAPHICS)
+#include "Null/NullShaderProgram.h"
 #else
 #include "Direct3D11/D3D11ShaderProgram.h"
 #endif
@@ -26,6 +26,8 @@
 #include "../Graphics/Shader.h"
 #include "../Graphics/ShaderVariation.h"
 
+#include <thread>
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -64,6 +66,42 @@ void ShaderVariation::SetName(const String& name)
     name_ = name;
 }
 
+bool ShaderVariation::QueuePrepare()
+{
+    if (object_.ptr_)
+        return false;
+
+    unsigned expected = PREPARE_NONE;
+    return prepareState_.compare_exchange_strong(expected, PREPARE_QUEUED);
+}
+
+void ShaderVariation::PrepareQueued()
+{
+    // The main thread may have taken the variation back in the meantime
+    unsigned expected = PREPARE_QUEUED;
+    if (prepareState_.compare_exchange_strong(expected, PREPARE_BUSY))
+        prepareState_ = Prepare() ? PREPARE_DONE : PREPARE_NONE;
+}
+
+void ShaderVariation::ReleasePrepared()
+{
+    CompletePrepare();
+    preparedSourceCode_.Clear();
+}
+
+bool ShaderVariation::CompletePrepare()
+{
+    // Take back the variation if a worker thread has not started on it yet, else wait for the worker thread to finish
+    unsigned expected = PREPARE_QUEUED;
+    if (!prepareState_.compare_exchange_strong(expected, PREPARE_NONE))
+    {
+        while (prepareState_ == PREPARE_BUSY)
+            std::this_thread::yield();
+    }
+
+    return prepareState_.exchange(PREPARE_NONE) == PREPARE_DONE;
+}
+
 Shader* ShaderVariation::GetOwner() const
 {
     return owner_;
@@ -28,6 +28,8 @@
 #include "../Graphics/GPUObject.h"
 #include "../Graphics/GraphicsDefs.h"
 
+#include <atomic>
+
 namespace Urho3D
 {
 
@@ -85,8 +87,16 @@ public:
     /// Release the shader.
     void Release() override;
 
-    /// Compile the shader. Return true if successful.
+    /// Compile the shader. Uses the result of a preparation in a worker thread if available. Return true if successful.
     bool Create();
+    /// Prepare the shader for creation without accessing the graphics device: inject the defines into the source code on OpenGL, or load or compile the bytecode on Direct3D11. May be called from a worker thread. Return true if successful.
+    bool Prepare();
+    /// Mark for preparation in a worker thread. Return false if already created or marked.
+    bool QueuePrepare();
+    /// Prepare if marked and not taken back by the main thread. Called from a worker thread.
+    void PrepareQueued();
+    /// Take back or wait for a preparation in a worker thread, and discard its result.
+    void ReleasePrepared();
     /// Set name.
     void SetName(const String& name);
     /// Set defines.
@@ -122,6 +132,9 @@ public:
     /// Return defines.
     const String& GetDefines() const { return defines_; }
 
+    /// Return whether is marked for or being prepared in a worker thread.
+    bool IsPreparing() const { return prepareState_ == PREPARE_QUEUED || prepareState_ == PREPARE_BUSY; }
+
     /// Return compile error/warning string.
     const String& GetCompilerOutput() const { return compilerOutput_; }
 
@@ -135,6 +148,17 @@ public:
     static const char* elementSemanticNames[];
 
 private:
+    /// Preparation state.
+    enum PrepareState
+    {
+        PREPARE_NONE = 0,
+        PREPARE_QUEUED,
+        PREPARE_BUSY,
+        PREPARE_DONE
+    };
+
+    /// Take back or wait for a preparation in a worker thread. Return true if the variation was prepared.
+    bool CompletePrepare();
     /// Load bytecode from a file. Return true if successful.
     bool LoadByteCode(const String& binaryShaderName);
     /// Compile from source. Return true if successful.
@@ -168,6 +192,10 @@ private:
     String definesClipPlane_;
     /// Shader compile error string.
     String compilerOutput_;
+    /// Source code with the defines injected, prepared for compiling. Used only on OpenGL.
+    String preparedSourceCode_;
+    /// Preparation state. Shared with worker threads.
+    std::atomic<unsigned> prepareState_{};
 };
 
 }
@@ -25,6 +25,7 @@
 #include "../Core/Context.h"
 #include "../Graphics/Batch.h"
 #include "../Graphics/Camera.h"
+#include "../Graphics/Model.h"
 #include "../Graphics/Skybox.h"
 #include "../Scene/Node.h"
 
@@ -62,6 +63,8 @@ namespace Urho3D
         // Add camera position to fix the skybox in space. Use effective world transform to take reflection into account
         Matrix3x4 customWorldTransform = node_->GetWorldTransform();
         customWorldTransform.SetTranslation(node_->GetWorldPosition() + frame.camera_->GetEffectiveWorldTransform().Translation());
+        if (model_ && model_->HasQuantizedPositions())
+            customWorldTransform = customWorldTransform * model_->GetPositionTransform();
         auto it = customWorldTransforms.insert(std::make_pair(frame.camera_, customWorldTransform)).first;
 
         for (unsigned i = 0; i < batches_.Size(); ++i)
@@ -0,0 +1,770 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../Graphics/Geometry.h"
+#include "../Graphics/IndexBuffer.h"
+#include "../Graphics/Material.h"
+#include "../Graphics/Model.h"
+#include "../Graphics/StaticBatcher.h"
+#include "../Graphics/StaticModel.h"
+#include "../Graphics/VertexBuffer.h"
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+#include "../Resource/ResourceCache.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneEvents.h"
+
+#include "../DebugNew.h"
+
+using namespace std;
+using namespace Urho3D;
+
+namespace
+{
+    /// Name of the merged cell nodes.
+    static const char* CELL_NODE_NAME = "StaticBatcherCell";
+    /// Default cell size.
+    static const float DEFAULT_CELL_SIZE = 64.0f;
+
+    static const StringVector sourceNodesStructureElementNames =
+    {
+        "Source Count",
+        "   NodeID"
+    };
+
+    /// Drawable settings that the static models merged together must share.
+    struct DrawableSettings
+    {
+        /// Construct from a static model.
+        explicit DrawableSettings(const StaticModel* model) :
+            drawDistance_(model->GetDrawDistance()),
+            shadowDistance_(model->GetShadowDistance()),
+            lodBias_(model->GetLodBias()),
+            viewMask_(model->GetViewMask()),
+            lightMask_(model->GetLightMask()),
+            shadowMask_(model->GetShadowMask()),
+            zoneMask_(model->GetZoneMask()),
+            maxLights_(model->GetMaxLights()),
+            castShadows_(model->GetCastShadows()),
+            occluder_(model->IsOccluder()),
+            occludee_(model->IsOccludee())
+        {
+        }
+
+        /// Test for equality with other settings.
+        bool operator ==(const DrawableSettings& rhs) const
+        {
+            return drawDistance_ == rhs.drawDistance_ && shadowDistance_ == rhs.shadowDistance_ && lodBias_ == rhs.lodBias_ &&
+                viewMask_ == rhs.viewMask_ && lightMask_ == rhs.lightMask_ && shadowMask_ == rhs.shadowMask_ &&
+                zoneMask_ == rhs.zoneMask_ && maxLights_ == rhs.maxLights_ && castShadows_ == rhs.castShadows_ &&
+                occluder_ == rhs.occluder_ && occludee_ == rhs.occludee_;
+        }
+
+        /// Apply to a static model.
+        void Apply(StaticModel* model) const
+        {
+            model->SetDrawDistance(drawDistance_);
+            model->SetShadowDistance(shadowDistance_);
+            model->SetLodBias(lodBias_);
+            model->SetViewMask(viewMask_);
+            model->SetLightMask(lightMask_);
+            model->SetShadowMask(shadowMask_);
+            model->SetZoneMask(zoneMask_);
+            model->SetMaxLights(maxLights_);
+            model->SetCastShadows(castShadows_);
+            model->SetOccluder(occluder_);
+            model->SetOccludee(occludee_);
+        }
+
+        float drawDistance_;
+        float shadowDistance_;
+        float lodBias_;
+        unsigned viewMask_;
+        unsigned lightMask_;
+        unsigned shadowMask_;
+        unsigned zoneMask_;
+        unsigned maxLights_;
+        bool castShadows_;
+        bool occluder_;
+        bool occludee_;
+    };
+
+    /// Static models of one cell with matching drawable settings.
+    struct BatchGroup
+    {
+        /// Cell coordinates.
+        IntVector3 cell_;
+        /// Shared drawable settings.
+        DrawableSettings settings_;
+        /// Static models.
+        PODVector<StaticModel*> models_;
+        /// Transforms of the static models relative to the batcher's node.
+        PODVector<Matrix3x4> transforms_;
+    };
+
+    /// Geometry merged from the geometries of a batch group that share a material and a vertex format.
+    struct MergedGeometry
+    {
+        /// Material.
+        Material* material_;
+        /// Vertex elements.
+        PODVector<VertexElement> elements_;
+        /// Vertex size.
+        unsigned vertexSize_;
+        /// Vertex data.
+        PODVector<unsigned char> vertexData_;
+        /// Indices.
+        PODVector<unsigned> indices_;
+        /// Bounding box.
+        BoundingBox boundingBox_;
+    };
+
+    /// Return whether all geometries of a static model can be merged.
+    bool IsBatchable(const StaticModel* staticModel)
+    {
+        const Model* model = staticModel->GetModel();
+        if (!model || !model->GetNumGeometries())
+            return false;
+
+        for (unsigned i = 0; i < model->GetNumGeometries(); ++i)
+        {
+            if (model->GetNumGeometryLodLevels(i) != 1)
+                return false;
+
+            const Geometry* geometry = model->GetGeometry(i, 0);
+            if (!geometry || geometry->GetNumVertexBuffers() != 1 || geometry->GetPrimitiveType() != PrimitiveType::TriangleList ||
+                !geometry->GetIndexCount())
+                return false;
+
+            const VertexBuffer* vertexBuffer = geometry->GetVertexBuffer(0);
+            const IndexBuffer* indexBuffer = geometry->GetIndexBuffer();
+            if (!vertexBuffer || !vertexBuffer->GetShadowData() || !indexBuffer || !indexBuffer->GetShadowData())
+                return false;
+
+            const PODVector<VertexElement>& elements = vertexBuffer->GetElements();
+            bool hasPosition = false;
+            for (unsigned j = 0; j < elements.Size(); ++j)
+            {
+                if (elements[j].perInstance_)
+                    return false;
+                if (elements[j].semantic_ == SEM_POSITION && elements[j].index_ == 0)
+                    hasPosition = elements[j].type_ == TYPE_VECTOR3;
+                // Quantized normals and tangents can not be transformed in place
+                if ((elements[j].semantic_ == SEM_NORMAL && elements[j].type_ != TYPE_VECTOR3) ||
+                    (elements[j].semantic_ == SEM_TANGENT && elements[j].type_ != TYPE_VECTOR4))
+                    return false;
+            }
+            if (!hasPosition)
+                return false;
+        }
+
+        return true;
+    }
+
+    /// Append a geometry transformed to the batcher's node space into a merged geometry.
+    void AppendGeometry(MergedGeometry& merged, const Geometry* geometry, const Matrix3x4& transform)
+    {
+        const VertexBuffer* vertexBuffer = geometry->GetVertexBuffer(0);
+        const IndexBuffer* indexBuffer = geometry->GetIndexBuffer();
+        const unsigned char* indexData = indexBuffer->GetShadowData();
+        const unsigned indexSize = indexBuffer->GetIndexSize();
+        const unsigned indexStart = geometry->GetIndexStart();
+        const unsigned indexCount = geometry->GetIndexCount() / 3 * 3;
+
+        // Copy only the vertex range the indices refer to
+        PODVector<unsigned> indices(indexCount);
+        unsigned minVertex = M_MAX_UNSIGNED;
+        unsigned maxVertex = 0;
+        for (unsigned i = 0; i < indexCount; ++i)
+        {
+            indices[i] = indexSize == sizeof(unsigned) ? reinterpret_cast<const unsigned*>(indexData)[indexStart + i] :
+                reinterpret_cast<const unsigned short*>(indexData)[indexStart + i];
+            minVertex = Min(minVertex, indices[i]);
+            maxVertex = Max(maxVertex, indices[i]);
+        }
+        if (maxVertex >= vertexBuffer->GetVertexCount())
+        {
+            URHO3D_LOGWARNING("Skipping geometry with out of range indices in static batching");
+            return;
+        }
+
+        const unsigned vertexSize = merged.vertexSize_;
+        const unsigned baseVertex = merged.vertexData_.Size() / vertexSize;
+        const unsigned vertexCount = maxVertex - minVertex + 1;
+        merged.vertexData_.Resize(merged.vertexData_.Size() + vertexCount * vertexSize);
+        unsigned char* dest = &merged.vertexData_[baseVertex * vertexSize];
+        memcpy(dest, vertexBuffer->GetShadowData() + minVertex * vertexSize, vertexCount * vertexSize);
+
+        const Matrix3 rotation = transform.ToMatrix3();
+        const Matrix3 normalMatrix = rotation.Inverse().Transpose();
+        const float determinant = rotation.m00_ * (rotation.m11_ * rotation.m22_ - rotation.m12_ * rotation.m21_) -
+            rotation.m01_ * (rotation.m10_ * rotation.m22_ - rotation.m12_ * rotation.m20_) +
+            rotation.m02_ * (rotation.m10_ * rotation.m21_ - rotation.m11_ * rotation.m20_);
+        // A mirroring transform reverses the triangle winding and the bitangent direction
+        const bool mirrored = determinant < 0.0f;
+
+        const PODVector<VertexElement>& elements = merged.elements_;
+        for (unsigned i = 0; i < vertexCount; ++i)
+        {
+            unsigned char* vertex = dest + i * vertexSize;
+            for (unsigned j = 0; j < elements.Size(); ++j)
+            {
+                const VertexElement& element = elements[j];
+                auto* data = reinterpret_cast<float*>(vertex + element.offset_);
+
+                if (element.semantic_ == SEM_POSITION && element.type_ == TYPE_VECTOR3)
+                {
+                    Vector3 position = transform * Vector3(data);
+                    memcpy(data, position.Data(), sizeof(Vector3));
+                    if (element.index_ == 0)
+                        merged.boundingBox_.Merge(position);
+                }
+                else if (element.semantic_ == SEM_NORMAL && element.type_ == TYPE_VECTOR3)
+                {
+                    Vector3 normal = (normalMatrix * Vector3(data)).Normalized();
+                    memcpy(data, normal.Data(), sizeof(Vector3));
+                }
+                else if (element.semantic_ == SEM_TANGENT && element.type_ == TYPE_VECTOR4)
+                {
+                    Vector3 tangent = (rotation * Vector3(data)).Normalized();
+                    memcpy(data, tangent.Data(), sizeof(Vector3));
+                    if (mirrored)
+                        data[3] = -data[3];
+                }
+            }
+        }
+
+        merged.indices_.Reserve(merged.indices_.Size() + indexCount);
+        for (unsigned i = 0; i < indexCount; i += 3)
+        {
+            merged.indices_.Push(baseVertex + indices[i] - minVertex);
+            merged.indices_.Push(baseVertex + indices[mirrored ? i + 2 : i + 1] - minVertex);
+            merged.indices_.Push(baseVertex + indices[mirrored ? i + 1 : i + 2] - minVertex);
+        }
+    }
+
+    /// Create a model from merged geometries.
+    SharedPtr<Model> CreateMergedModel(Context* context, const std::vector<MergedGeometry>& geometries)
+    {
+        SharedPtr<Model> model(new Model(context));
+        std::vector<SharedPtr<VertexBuffer> > vertexBuffers;
+        std::vector<SharedPtr<IndexBuffer> > indexBuffers;
+        BoundingBox boundingBox;
+
+        model->SetNumGeometries((unsigned)geometries.size());
+        for (unsigned i = 0; i < geometries.size(); ++i)
+        {
+            const MergedGeometry& merged = geometries[i];
+            const unsigned vertexCount = merged.vertexData_.Size() / merged.vertexSize_;
+            const bool largeIndices = vertexCount > 65535;
+
+            SharedPtr<VertexBuffer> vertexBuffer(new VertexBuffer(context));
+            vertexBuffer->SetShadowed(true);
+            vertexBuffer->SetSize(vertexCount, merged.elements_);
+            vertexBuffer->SetData(merged.vertexData_.Buffer());
+
+            SharedPtr<IndexBuffer> indexBuffer(new IndexBuffer(context));
+            indexBuffer->SetShadowed(true);
+            indexBuffer->SetSize(merged.indices_.Size(), largeIndices);
+            if (largeIndices)
+                indexBuffer->SetData(merged.indices_.Buffer());
+            else
+            {
+                PODVector<unsigned short> shortIndices(merged.indices_.Size());
+                for (unsigned j = 0; j < merged.indices_.Size(); ++j)
+                    shortIndices[j] = (unsigned short)merged.indices_[j];
+                indexBuffer->SetData(shortIndices.Buffer());
+            }
+
+            SharedPtr<Geometry> geometry(new Geometry(context));
+            geometry->SetVertexBuffer(0, vertexBuffer);
+            geometry->SetIndexBuffer(indexBuffer);
+            geometry->SetDrawRange(PrimitiveType::TriangleList, 0, merged.indices_.Size(), 0, vertexCount);
+
+            model->SetNumGeometryLodLevels(i, 1);
+            model->SetGeometry(i, 0, geometry);
+            model->SetGeometryCenter(i, merged.boundingBox_.Center());
+            vertexBuffers.push_back(vertexBuffer);
+            indexBuffers.push_back(indexBuffer);
+            boundingBox.Merge(merged.boundingBox_);
+        }
+
+        model->SetVertexBuffers(vertexBuffers, PODVector<unsigned>(), PODVector<unsigned>());
+        model->SetIndexBuffers(indexBuffers);
+        model->SetBoundingBox(boundingBox);
+        return model;
+    }
+}
+
+StaticBatcher::StaticBatcher(Context* context) :
+    Component(context),
+    cellSize_(DEFAULT_CELL_SIZE),
+    autoBuild_(false),
+    sourcesDirty_(false),
+    sourceAttrsDirty_(true)
+{
+}
+
+StaticBatcher::~StaticBatcher() = default;
+
+void StaticBatcher::RegisterObject(Context* context)
+{
+    context->RegisterFactory<StaticBatcher>(GEOMETRY_CATEGORY);
+
+    URHO3D_ACCESSOR_ATTRIBUTE("Cell Size", GetCellSize, SetCellSize, float, DEFAULT_CELL_SIZE, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Auto Build", GetAutoBuild, SetAutoBuild, bool, false, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Source Nodes", GetSourceNodesAttr, SetSourceNodesAttr,
+        VariantVector, Variant::emptyVariantVector, AM_DEFAULT | AM_NODEIDVECTOR | AM_NOEDIT)
+        .SetMetadata(AttributeMetadata::P_VECTOR_STRUCT_ELEMENTS, sourceNodesStructureElementNames);
+    URHO3D_ACCESSOR_ATTRIBUTE("Source Indices", GetSourceIndicesAttr, SetSourceIndicesAttr,
+        VariantVector, Variant::emptyVariantVector, AM_DEFAULT | AM_NOEDIT);
+}
+
+void StaticBatcher::ApplyAttributes()
+{
+    if (!sourcesDirty_)
+        return;
+
+    sources_.clear();
+
+    Scene* scene = GetScene();
+    if (scene)
+    {
+        for (unsigned i = 1; i < sourceNodesAttr_.size(); ++i)
+        {
+            Node* node = scene->GetNode(sourceNodesAttr_[i].GetUInt());
+            unsigned index = i - 1 < sourceIndicesAttr_.size() ? sourceIndicesAttr_[i - 1].GetUInt() : 0;
+            if (!node)
+                continue;
+
+            PODVector<StaticModel*> staticModels;
+            node->GetComponents<StaticModel>(staticModels);
+            if (index < staticModels.Size())
+                sources_.push_back(WeakPtr<StaticModel>(staticModels[index]));
+        }
+    }
+
+    IndexSources();
+    sourcesDirty_ = false;
+    sourceAttrsDirty_ = true;
+}
+
+void StaticBatcher::SetCellSize(float size)
+{
+    cellSize_ = Max(size, M_EPSILON);
+    MarkNetworkUpdate();
+}
+
+void StaticBatcher::SetAutoBuild(bool enable)
+{
+    autoBuild_ = enable;
+    if (autoBuild_ && !IsBuilt() && GetScene())
+        ScheduleBuild();
+    MarkNetworkUpdate();
+}
+
+bool StaticBatcher::Build()
+{
+    if (!node_)
+    {
+        URHO3D_LOGERROR("Can not build static batches without a scene node");
+        return false;
+    }
+
+    URHO3D_PROFILE(BuildStaticBatches);
+
+    Clear();
+
+    PODVector<StaticModel*> staticModels;
+    node_->GetComponents<StaticModel>(staticModels, true);
+    const Matrix3x4 inverseTransform = node_->GetWorldTransform().Inverse();
+
+    // Group the static models by cell and drawable settings
+    std::vector<BatchGroup> groups;
+    HashMap<IntVector3, PODVector<unsigned> > cellGroups;
+    for (unsigned i = 0; i < staticModels.Size(); ++i)
+    {
+        StaticModel* staticModel = staticModels[i];
+        if (!staticModel->IsEnabledEffective() || !IsBatchable(staticModel))
+            continue;
+
+        Vector3 center = staticModel->GetWorldBoundingBox().Transformed(inverseTransform).Center();
+        IntVector3 cell(FloorToInt(center.x_ / cellSize_), FloorToInt(center.y_ / cellSize_), FloorToInt(center.z_ / cellSize_));
+        DrawableSettings settings(staticModel);
+
+        PODVector<unsigned>& groupIndices = cellGroups[cell];
+        unsigned groupIndex = M_MAX_UNSIGNED;
+        for (unsigned j = 0; j < groupIndices.Size(); ++j)
+        {
+            if (groups[groupIndices[j]].settings_ == settings)
+            {
+                groupIndex = groupIndices[j];
+                break;
+            }
+        }
+        if (groupIndex == M_MAX_UNSIGNED)
+        {
+            groupIndex = (unsigned)groups.size();
+            groupIndices.Push(groupIndex);
+            groups.push_back(BatchGroup{ cell, settings, PODVector<StaticModel*>(), PODVector<Matrix3x4>() });
+        }
+
+        groups[groupIndex].models_.Push(staticModel);
+        groups[groupIndex].transforms_.Push(inverseTransform * staticModel->GetNode()->GetWorldTransform());
+    }
+
+    // Merge the groups of several models by material and vertex format
+    HashMap<IntVector3, Node*> cellNodes;
+    for (unsigned i = 0; i < groups.size(); ++i)
+    {
+        const BatchGroup& group = groups[i];
+        if (group.models_.Size() < 2)
+            continue;
+
+        std::vector<MergedGeometry> geometries;
+        for (unsigned j = 0; j < group.models_.Size(); ++j)
+        {
+            StaticModel* staticModel = group.models_[j];
+            const Model* model = staticModel->GetModel();
+
+            for (unsigned k = 0; k < model->GetNumGeometries(); ++k)
+            {
+                const Geometry* geometry = model->GetGeometry(k, 0);
+                const VertexBuffer* vertexBuffer = geometry->GetVertexBuffer(0);
+                Material* material = staticModel->GetMaterial(k);
+
+                unsigned index = 0;
+                while (index < geometries.size() && (geometries[index].material_ != material ||
+                    geometries[index].elements_ != vertexBuffer->GetElements()))
+                    ++index;
+                if (index == geometries.size())
+                {
+                    geometries.emplace_back();
+                    geometries.back().material_ = material;
+                    geometries.back().elements_ = vertexBuffer->GetElements();
+                    geometries.back().vertexSize_ = vertexBuffer->GetVertexSize();
+                }
+
+                AppendGeometry(geometries[index], geometry, group.transforms_[j]);
+            }
+
+            staticModel->SetEnabled(false);
+            sources_.push_back(WeakPtr<StaticModel>(staticModel));
+        }
+
+        HashMap<IntVector3, Node*>::Iterator cellNode = cellNodes.Find(group.cell_);
+        if (cellNode == cellNodes.End())
+        {
+            Node* node = node_->CreateChild(CELL_NODE_NAME, LOCAL, 0, true);
+            cells_.push_back(WeakPtr<Node>(node));
+            cellNode = cellNodes.Insert(MakePair(group.cell_, node));
+        }
+
+        auto* cellModel = cellNode->second_->CreateComponent<StaticModel>();
+        cellModel->SetModel(CreateMergedModel(context_, geometries));
+        for (unsigned j = 0; j < geometries.size(); ++j)
+            cellModel->SetMaterial(j, geometries[j].material_);
+        group.settings_.Apply(cellModel);
+    }
+
+    IndexSources();
+    sourceAttrsDirty_ = true;
+    MarkNetworkUpdate();
+
+    URHO3D_LOGDEBUG("Merged " + String((unsigned)sources_.size()) + " static models into " + String(GetNumMergedGeometries()) +
+        " geometries in " + String((unsigned)cells_.size()) + " cells");
+    return true;
+}
+
+void StaticBatcher::Clear()
+{
+    if (!IsBuilt())
+        FindBuild();
+
+    for (unsigned i = 0; i < cells_.size(); ++i)
+    {
+        if (cells_[i])
+            cells_[i]->Remove();
+    }
+    for (unsigned i = 0; i < sources_.size(); ++i)
+    {
+        if (sources_[i])
+            sources_[i]->SetEnabled(true);
+    }
+
+    if (!sources_.empty())
+    {
+        sourceAttrsDirty_ = true;
+        MarkNetworkUpdate();
+    }
+
+    cells_.clear();
+    sources_.clear();
+    sourceCells_.Clear();
+}
+
+bool StaticBatcher::SaveModels(const String& fileDirectory, const String& resourceDirectory)
+{
+    auto* fileSystem = GetSubsystem<FileSystem>();
+    if (!IsBuilt() || !fileSystem->CreateDir(fileDirectory))
+    {
+        URHO3D_LOGERROR("Could not save static batches to " + fileDirectory);
+        return false;
+    }
+
+    auto* cache = GetSubsystem<ResourceCache>();
+    for (unsigned i = 0; i < cells_.size(); ++i)
+    {
+        Node* cell = cells_[i];
+        if (!cell)
+            continue;
+
+        PODVector<StaticModel*> cellModels;
+        cell->GetComponents<StaticModel>(cellModels);
+        for (unsigned j = 0; j < cellModels.Size(); ++j)
+        {
+            Model* model = cellModels[j]->GetModel();
+            String fileName = "StaticBatch_" + String(node_->GetID()) + "_" + String(i) + "_" + String(j) + ".mdl";
+
+            File file(context_, AddTrailingSlash(fileDirectory) + fileName, FILE_WRITE);
+            if (!file.IsOpen() || !model->Save(file))
+            {
+                URHO3D_LOGERROR("Could not save static batch model " + file.GetName());
+                return false;
+            }
+
+            // Refer to the saved file, and let the resource cache return this model until it is reloaded
+            model->SetName(AddTrailingSlash(resourceDirectory) + fileName);
+            cache->AddManualResource(model);
+            cellModels[j]->MarkNetworkUpdate();
+        }
+
+        cell->SetTemporary(false);
+    }
+
+    return true;
+}
+
+unsigned StaticBatcher::GetNumMergedGeometries() const
+{
+    unsigned numGeometries = 0;
+    for (unsigned i = 0; i < cells_.size(); ++i)
+    {
+        if (!cells_[i])
+            continue;
+
+        PODVector<StaticModel*> cellModels;
+        cells_[i]->GetComponents<StaticModel>(cellModels);
+        for (unsigned j = 0; j < cellModels.Size(); ++j)
+            numGeometries += cellModels[j]->GetNumGeometries();
+    }
+
+    return numGeometries;
+}
+
+StaticModel* StaticBatcher::GetSourceModel(const Ray& ray, float maxDistance) const
+{
+    StaticModel* closest = nullptr;
+    float closestDistance = maxDistance;
+    if (!node_)
+        return closest;
+
+    // Test only the models of the cells hit by the ray
+    const Ray cellRay = ray.Transformed(node_->GetWorldTransform().Inverse());
+    for (HashMap<IntVector3, SourceCell>::ConstIterator i = sourceCells_.Begin(); i != sourceCells_.End(); ++i)
+    {
+        const SourceCell& cell = i->second_;
+        if (cellRay.HitDistance(cell.boundingBox_) == M_INFINITY)
+            continue;
+
+        for (unsigned j = 0; j < cell.sources_.Size(); ++j)
+        {
+            StaticModel* staticModel = sources_[cell.sources_[j]];
+            if (!staticModel || !staticModel->GetModel() || ray.HitDistance(staticModel->GetWorldBoundingBox()) >= closestDistance)
+                continue;
+
+            // Test the geometries in model space, then measure the distance in world space in case of scaling
+            const Matrix3x4& worldTransform = staticModel->GetNode()->GetWorldTransform();
+            Ray localRay = ray.Transformed(worldTransform.Inverse());
+            const Model* model = staticModel->GetModel();
+            for (unsigned k = 0; k < model->GetNumGeometries(); ++k)
+            {
+                const Geometry* geometry = model->GetGeometry(k, 0);
+                float localDistance = geometry ? geometry->GetHitDistance(localRay) : M_INFINITY;
+                if (localDistance == M_INFINITY)
+                    continue;
+
+                float distance = (worldTransform * localRay.origin_ + localDistance * (worldTransform.ToMatrix3() * localRay.direction_) -
+                    ray.origin_).Length();
+                if (distance < closestDistance)
+                {
+                    closest = staticModel;
+                    closestDistance = distance;
+                }
+            }
+        }
+    }
+
+    return closest;
+}
+
+void StaticBatcher::SetSourceNodesAttr(const VariantVector& value)
+{
+    // Just remember the node IDs. They need to go through the SceneResolver, and the models are found during ApplyAttributes()
+    sourceNodesAttr_ = value;
+    if (sourceNodesAttr_.empty())
+        sourceNodesAttr_.push_back(0u);
+    sourcesDirty_ = true;
+    sourceAttrsDirty_ = false;
+}
+
+const VariantVector& StaticBatcher::GetSourceNodesAttr() const
+{
+    if (sourceAttrsDirty_)
+        UpdateSourceAttrs();
+
+    return sourceNodesAttr_;
+}
+
+void StaticBatcher::SetSourceIndicesAttr(const VariantVector& value)
+{
+    sourceIndicesAttr_ = value;
+    sourcesDirty_ = true;
+    sourceAttrsDirty_ = false;
+}
+
+const VariantVector& StaticBatcher::GetSourceIndicesAttr() const
+{
+    if (sourceAttrsDirty_)
+        UpdateSourceAttrs();
+
+    return sourceIndicesAttr_;
+}
+
+void StaticBatcher::OnSceneSet(Scene* scene)
+{
+    if (scene)
+        ScheduleBuild();
+    else
+        UnsubscribeFromEvent(E_SCENEUPDATE);
+}
+
+void StaticBatcher::FindBuild()
+{
+    if (!node_)
+        return;
+
+    cells_.clear();
+
+    const std::vector<SharedPtr<Node> >& children = node_->GetChildren();
+    for (unsigned i = 0; i < children.size(); ++i)
+    {
+        if (children[i]->GetName() == CELL_NODE_NAME)
+            cells_.push_back(WeakPtr<Node>(children[i]));
+    }
+
+    // Temporary cells are not saved with the scene. Without them, the recorded original static models must be visible again
+    if (cells_.empty() && !sources_.empty())
+    {
+        for (unsigned i = 0; i < sources_.size(); ++i)
+        {
+            if (sources_[i])
+                sources_[i]->SetEnabled(true);
+        }
+
+        sources_.clear();
+        sourceCells_.Clear();
+        sourceAttrsDirty_ = true;
+        MarkNetworkUpdate();
+    }
+}
+
+void StaticBatcher::IndexSources()
+{
+    sourceCells_.Clear();
+    if (!node_)
+        return;
+
+    const Matrix3x4 inverseTransform = node_->GetWorldTransform().Inverse();
+    for (unsigned i = 0; i < sources_.size(); ++i)
+    {
+        StaticModel* staticModel = sources_[i];
+        if (!staticModel)
+            continue;
+
+        BoundingBox boundingBox = staticModel->GetWorldBoundingBox().Transformed(inverseTransform);
+        Vector3 center = boundingBox.Center();
+        IntVector3 cell(FloorToInt(center.x_ / cellSize_), FloorToInt(center.y_ / cellSize_), FloorToInt(center.z_ / cellSize_));
+
+        SourceCell& sourceCell = sourceCells_[cell];
+        sourceCell.boundingBox_.Merge(boundingBox);
+        sourceCell.sources_.Push(i);
+    }
+}
+
+void StaticBatcher::UpdateSourceAttrs() const
+{
+    sourceNodesAttr_.clear();
+    sourceIndicesAttr_.clear();
+    sourceNodesAttr_.push_back((unsigned)sources_.size());
+
+    for (unsigned i = 0; i < sources_.size(); ++i)
+    {
+        StaticModel* staticModel = sources_[i];
+        Node* node = staticModel ? staticModel->GetNode() : nullptr;
+        unsigned index = 0;
+        if (node)
+        {
+            PODVector<StaticModel*> staticModels;
+            node->GetComponents<StaticModel>(staticModels);
+            while (index < staticModels.Size() && staticModels[index] != staticModel)
+                ++index;
+        }
+
+        sourceNodesAttr_.push_back(node ? node->GetID() : 0);
+        sourceIndicesAttr_.push_back(index);
+    }
+
+    sourceAttrsDirty_ = false;
+}
+
+void StaticBatcher::ScheduleBuild()
+{
+    Scene* scene = GetScene();
+    if (scene)
+        SubscribeToEvent(scene, E_SCENEUPDATE, URHO3D_HANDLER(StaticBatcher, HandleSceneUpdate));
+}
+
+void StaticBatcher::HandleSceneUpdate(StringHash eventType, VariantMap& eventData)
+{
+    UnsubscribeFromEvent(E_SCENEUPDATE);
+
+    if (!IsBuilt())
+        FindBuild();
+    if (!IsBuilt() && autoBuild_)
+        Build();
+}
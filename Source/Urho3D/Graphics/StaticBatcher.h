@@ -0,0 +1,133 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Math/BoundingBox.h"
+#include "../Math/Ray.h"
+#include "../Scene/Component.h"
+
+namespace Urho3D
+{
+    class StaticModel;
+
+    /// Static geometry batcher component. Merges the static models in the scene node's subtree that share a material into combined vertex and index buffers, split into spatial cells, to reduce the number of draw calls. Each cell is rendered by static models of its own in a temporary child node and is culled separately. The original nodes are kept with their static models disabled, so that they can still be used for picking and physics. The disabled models are recorded in the component's attributes: a scene saved without the cells re-enables them when loaded, and only they are re-enabled by Clear(). Models with several LOD levels and geometries that are not indexed triangle lists in a single vertex buffer are left as is.
+    class URHO3D_API StaticBatcher : public Component
+    {
+        URHO3D_OBJECT(StaticBatcher, Component);
+
+    public:
+        /// Construct.
+        explicit StaticBatcher(Context* context);
+        /// Destruct.
+        ~StaticBatcher() override;
+        /// Register object factory.
+        /// @nobind
+        static void RegisterObject(Context* context);
+
+        /// Apply attribute changes that can not be applied immediately.
+        void ApplyAttributes() override;
+
+        /// Set size of the spatial cells in the node's local space. Takes effect on the next build.
+        void SetCellSize(float size);
+        /// Set whether to build automatically on the first scene update after being loaded or added to a scene.
+        void SetAutoBuild(bool enable);
+        /// Merge the static models in the node's subtree, replacing a previous build. Return true on success.
+        bool Build();
+        /// Remove the merged cells and re-enable the original static models.
+        void Clear();
+        /// Save the merged models of a build into a directory in the file system, and make the cell nodes persistent so that a saved scene refers to the merged models. The resource directory is the directory's name relative to a resource directory, for example "Models/Batched/". Return true on success.
+        bool SaveModels(const String& fileDirectory, const String& resourceDirectory);
+
+        /// Return cell size.
+        float GetCellSize() const { return cellSize_; }
+        /// Return whether builds automatically.
+        bool GetAutoBuild() const { return autoBuild_; }
+        /// Return whether a build exists.
+        bool IsBuilt() const { return !cells_.empty(); }
+        /// Return number of cells.
+        unsigned GetNumCells() const { return (unsigned)cells_.size(); }
+        /// Return number of original static models that were merged.
+        unsigned GetNumSourceModels() const { return (unsigned)sources_.size(); }
+        /// Return number of merged geometries, each drawn with one batch per pass.
+        unsigned GetNumMergedGeometries() const;
+        /// Return the original static model hit by a world space ray nearest to the ray origin, or null if none.
+        StaticModel* GetSourceModel(const Ray& ray, float maxDistance = M_INFINITY) const;
+
+        /// Set node IDs of the original static models attribute.
+        void SetSourceNodesAttr(const VariantVector& value);
+        /// Return node IDs of the original static models attribute.
+        const VariantVector& GetSourceNodesAttr() const;
+        /// Set indices of the original static models within their nodes attribute.
+        void SetSourceIndicesAttr(const VariantVector& value);
+        /// Return indices of the original static models within their nodes attribute.
+        const VariantVector& GetSourceIndicesAttr() const;
+
+    protected:
+        /// Handle scene being assigned.
+        void OnSceneSet(Scene* scene) override;
+
+    private:
+        /// Original static models in one cell, for picking.
+        struct SourceCell
+        {
+            /// Bounding box of the models in the node's local space.
+            BoundingBox boundingBox_;
+            /// Indices of the models.
+            PODVector<unsigned> sources_;
+        };
+
+        /// Find the cells of a build that was saved with the scene. Re-enable the original static models if the cells were not saved.
+        void FindBuild();
+        /// Group the original static models by cell for picking.
+        void IndexSources();
+        /// Update the original static model attributes.
+        void UpdateSourceAttrs() const;
+        /// Subscribe to the scene update for finding a saved build or building automatically.
+        void ScheduleBuild();
+        /// Handle the scene update for finding a saved build or building automatically.
+        void HandleSceneUpdate(StringHash eventType, VariantMap& eventData);
+
+        /// Merged cell nodes.
+        std::vector<WeakPtr<Node> > cells_;
+        /// Original static models that were merged and disabled by the build.
+        std::vector<WeakPtr<StaticModel> > sources_;
+        /// Original static models by cell.
+        HashMap<IntVector3, SourceCell> sourceCells_;
+        /// Node IDs of the original static models. The first element is the number of IDs.
+        mutable VariantVector sourceNodesAttr_;
+        /// Indices of the original static models within their nodes.
+        mutable VariantVector sourceIndicesAttr_;
+        /// Cell size.
+        float cellSize_;
+        /// Automatic build flag.
+        bool autoBuild_;
+        /// Whether the original static model attributes have been set and the models should be searched for during ApplyAttributes.
+        bool sourcesDirty_;
+        /// Whether the original static model attributes should be updated from the models.
+        mutable bool sourceAttrsDirty_;
+    };
+}
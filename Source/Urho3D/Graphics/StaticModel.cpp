@@ -45,6 +45,8 @@ namespace Urho3D
         : Drawable(context, DRAWABLE_GEOMETRY)
         , occlusionLodLevel_(M_MAX_UNSIGNED)
         , materialsAttr_(Material::GetTypeStatic())
+        , drawDistanceAttr_(0.0f)
+        , drawDistanceOverridden_(false)
     {
     }
 
@@ -61,7 +63,7 @@ namespace Urho3D
         URHO3D_ATTRIBUTE("Is Occluder", bool, occluder_, false, AM_DEFAULT);
         URHO3D_ACCESSOR_ATTRIBUTE("Can Be Occluded", IsOccludee, SetOccludee, bool, true, AM_DEFAULT);
         URHO3D_ATTRIBUTE("Cast Shadows", bool, castShadows_, false, AM_DEFAULT);
-        URHO3D_ACCESSOR_ATTRIBUTE("Draw Distance", GetDrawDistance, SetDrawDistance, float, 0.0f, AM_DEFAULT);
+        URHO3D_ACCESSOR_ATTRIBUTE("Draw Distance", GetDrawDistanceAttr, SetDrawDistanceAttr, float, 0.0f, AM_DEFAULT);
         URHO3D_ACCESSOR_ATTRIBUTE("Shadow Distance", GetShadowDistance, SetShadowDistance, float, 0.0f, AM_DEFAULT);
         URHO3D_ACCESSOR_ATTRIBUTE("LOD Bias", GetLodBias, SetLodBias, float, 1.0f, AM_DEFAULT);
         URHO3D_COPY_BASE_ATTRIBUTES(Drawable);
@@ -249,7 +251,9 @@ namespace Urho3D
             SetNumGeometries(model->GetNumGeometries());
             const std::vector<std::vector<SharedPtr<Geometry> > >& geometries = model->GetGeometries();
             const PODVector<Vector3>& geometryCenters = model->GetGeometryCenters();
-            const Matrix3x4* worldTransform = node_ ? &node_->GetWorldTransform() : nullptr;
+            // Quantized vertex positions are transformed to model space along with the world transform
+            const Matrix3x4* worldTransform = node_ ? (model->HasQuantizedPositions() ? &quantizedWorldTransform_ :
+                &node_->GetWorldTransform()) : nullptr;
             for (unsigned i = 0; i < geometries.size(); ++i)
             {
                 batches_[i].worldTransform_ = worldTransform;
@@ -296,6 +300,24 @@ namespace Urho3D
         MarkNetworkUpdate();
     }
 
+    void StaticModel::SetDrawDistanceOverride(float distance)
+    {
+        if (distance >= 0.0f)
+        {
+            if (!drawDistanceOverridden_)
+            {
+                drawDistanceAttr_ = drawDistance_;
+                drawDistanceOverridden_ = true;
+            }
+            drawDistance_ = distance;
+        }
+        else if (drawDistanceOverridden_)
+        {
+            drawDistance_ = drawDistanceAttr_;
+            drawDistanceOverridden_ = false;
+        }
+    }
+
     void StaticModel::ApplyMaterialList(const String& fileName)
     {
         String useFileName = fileName;
@@ -394,9 +416,23 @@ namespace Urho3D
         return materialsAttr_;
     }
 
+    void StaticModel::SetDrawDistanceAttr(float distance)
+    {
+        if (drawDistanceOverridden_)
+        {
+            drawDistanceAttr_ = distance;
+            MarkNetworkUpdate();
+        }
+        else
+            SetDrawDistance(distance);
+    }
+
     void StaticModel::OnWorldBoundingBoxUpdate()
     {
-        worldBoundingBox_ = boundingBox_.Transformed(node_->GetWorldTransform());
+        const Matrix3x4& worldTransform = node_->GetWorldTransform();
+        worldBoundingBox_ = boundingBox_.Transformed(worldTransform);
+        if (model_ && model_->HasQuantizedPositions())
+            quantizedWorldTransform_ = worldTransform * model_->GetPositionTransform();
     }
 
     void StaticModel::ResetLodLevels()
@@ -77,6 +77,8 @@ public:
     void SetOcclusionLodLevel(unsigned level);
     /// Apply default materials from a material list file. If filename is empty (default), the model's resource name with extension .txt will be used.
     void ApplyMaterialList(const String& fileName = String::EMPTY);
+    /// Set a draw distance that is used at runtime instead of the draw distance attribute, for example by an ImpostorSet, or a negative value to restore the attribute. Not saved or replicated.
+    void SetDrawDistanceOverride(float distance);
 
     /// Return model.
     /// @property
@@ -96,6 +98,8 @@ public:
     /// Return occlusion LOD level.
     /// @property
     unsigned GetOcclusionLodLevel() const { return occlusionLodLevel_; }
+    /// Return whether the draw distance is overridden.
+    bool IsDrawDistanceOverridden() const { return drawDistanceOverridden_; }
 
     /// Determines if the given world space point is within the model geometry.
     bool IsInside(const Vector3& point) const;
@@ -110,6 +114,10 @@ public:
     ResourceRef GetModelAttr() const;
     /// Return materials attribute.
     const ResourceRefList& GetMaterialsAttr() const;
+    /// Set draw distance attribute. Takes effect when the draw distance is not overridden.
+    void SetDrawDistanceAttr(float distance);
+    /// Return draw distance attribute.
+    float GetDrawDistanceAttr() const { return drawDistanceOverridden_ ? drawDistanceAttr_ : drawDistance_; }
 
 protected:
     /// Recalculate the world-space bounding box.
@@ -131,8 +139,14 @@ protected:
     SharedPtr<Model> model_;
     /// Occlusion LOD level.
     unsigned occlusionLodLevel_;
+    /// World transform combined with the position transform of a model with quantized vertex positions.
+    Matrix3x4 quantizedWorldTransform_;
     /// Material list attribute.
     mutable ResourceRefList materialsAttr_;
+    /// Draw distance attribute kept aside while the draw distance is overridden.
+    float drawDistanceAttr_;
+    /// Draw distance override flag.
+    bool drawDistanceOverridden_;
 
 private:
     /// Handle model reload finished.
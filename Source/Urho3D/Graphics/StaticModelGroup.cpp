@@ -27,6 +27,7 @@
 #include "../Graphics/Camera.h"
 #include "../Graphics/Geometry.h"
 #include "../Graphics/Material.h"
+#include "../Graphics/Model.h"
 #include "../Graphics/OcclusionBuffer.h"
 #include "../Graphics/OctreeQuery.h"
 #include "../Graphics/StaticModelGroup.h"
@@ -62,6 +63,7 @@ void StaticModelGroup::RegisterObject(Context* context)
     URHO3D_ACCESSOR_ATTRIBUTE("Instance Nodes", GetNodeIDsAttr, SetNodeIDsAttr,
         VariantVector, Variant::emptyVariantVector, AM_DEFAULT | AM_NODEIDVECTOR)
         .SetMetadata(AttributeMetadata::P_VECTOR_STRUCT_ELEMENTS, instanceNodesStructureElementNames);
+    URHO3D_ACCESSOR_ATTRIBUTE("Instance Draw Distance", GetInstanceDrawDistance, SetInstanceDrawDistance, float, 0.0f, AM_DEFAULT);
 }
 
 void StaticModelGroup::ApplyAttributes()
@@ -96,6 +98,7 @@ void StaticModelGroup::ApplyAttributes()
     }
 
     worldTransforms_.Resize(instanceNodes_.size());
+    quantizedWorldTransforms_.Resize(instanceNodes_.size());
     numWorldTransforms_ = 0; // Correct amount will be found during world bounding box update
     nodesDirty_ = false;
 
@@ -170,22 +173,47 @@ void StaticModelGroup::UpdateBatches(const FrameInfo& frame)
     // Getting the world bounding box ensures the transforms are updated
     const BoundingBox& worldBoundingBox = GetWorldBoundingBox();
     const Matrix3x4& worldTransform = node_->GetWorldTransform();
+    const PODVector<Matrix3x4>* transforms = model_ && model_->HasQuantizedPositions() ? &quantizedWorldTransforms_ : &worldTransforms_;
+    unsigned numTransforms = numWorldTransforms_;
     distance_ = frame.camera_->GetDistance(worldBoundingBox.Center());
 
+    // Leave out the instances beyond the instance draw distance, measured to their bounding box centers like for other drawables.
+    // The batches of each view point to the transforms gathered for its camera, which stay valid until the next frame
+    const float instanceDrawDistance = instanceDrawDistanceOverride_ >= 0.0f ? instanceDrawDistanceOverride_ : instanceDrawDistance_;
+    if (instanceDrawDistance > 0.0f)
+    {
+        if (frame.frameNumber_ != lastFrame_)
+        {
+            visibleWorldTransforms_.clear();
+            lastFrame_ = frame.frameNumber_;
+        }
+
+        PODVector<Matrix3x4>& visibleWorldTransforms = visibleWorldTransforms_[frame.camera_];
+        visibleWorldTransforms.Resize(numWorldTransforms_);
+        const Vector3 center = boundingBox_.Center();
+        numTransforms = 0;
+        for (unsigned i = 0; i < numWorldTransforms_; ++i)
+        {
+            if (frame.camera_->GetDistance(worldTransforms_[i] * center) <= instanceDrawDistance)
+                visibleWorldTransforms[numTransforms++] = (*transforms)[i];
+        }
+        transforms = &visibleWorldTransforms;
+    }
+
     if (batches_.Size() > 1)
     {
         for (unsigned i = 0; i < batches_.Size(); ++i)
         {
             batches_[i].distance_ = frame.camera_->GetDistance(worldTransform * geometryData_[i].center_);
-            batches_[i].worldTransform_ = numWorldTransforms_ ? &worldTransforms_[0] : &Matrix3x4::IDENTITY;
-            batches_[i].numWorldTransforms_ = numWorldTransforms_;
+            batches_[i].worldTransform_ = numTransforms ? &(*transforms)[0] : &Matrix3x4::IDENTITY;
+            batches_[i].numWorldTransforms_ = numTransforms;
         }
     }
     else if (batches_.Size() == 1)
     {
         batches_[0].distance_ = distance_;
-        batches_[0].worldTransform_ = numWorldTransforms_ ? &worldTransforms_[0] : &Matrix3x4::IDENTITY;
-        batches_[0].numWorldTransforms_ = numWorldTransforms_;
+        batches_[0].worldTransform_ = numTransforms ? &(*transforms)[0] : &Matrix3x4::IDENTITY;
+        batches_[0].numWorldTransforms_ = numTransforms;
     }
 
     float scale = worldBoundingBox.Size().DotProduct(DOT_SCALE);
@@ -312,6 +340,17 @@ void StaticModelGroup::RemoveAllInstanceNodes()
     UpdateNumTransforms();
 }
 
+void StaticModelGroup::SetInstanceDrawDistance(float distance)
+{
+    instanceDrawDistance_ = Max(distance, 0.0f);
+    MarkNetworkUpdate();
+}
+
+void StaticModelGroup::SetInstanceDrawDistanceOverride(float distance)
+{
+    instanceDrawDistanceOverride_ = distance;
+}
+
 Node* StaticModelGroup::GetInstanceNode(u32 index) const
 {
     return index < instanceNodes_.size() ? instanceNodes_[index] : nullptr;
@@ -368,6 +407,7 @@ void StaticModelGroup::OnWorldBoundingBoxUpdate()
 {
     // Update transforms and bounding box at the same time to have to go through the objects only once
     unsigned index = 0;
+    const bool quantized = model_ && model_->HasQuantizedPositions();
 
     BoundingBox worldBox;
 
@@ -378,6 +418,8 @@ void StaticModelGroup::OnWorldBoundingBoxUpdate()
             continue;
 
         const Matrix3x4& worldTransform = node->GetWorldTransform();
+        if (quantized)
+            quantizedWorldTransforms_[index] = worldTransform * model_->GetPositionTransform();
         worldTransforms_[index++] = worldTransform;
         worldBox.Merge(boundingBox_.Transformed(worldTransform));
     }
@@ -392,6 +434,7 @@ void StaticModelGroup::OnWorldBoundingBoxUpdate()
 void StaticModelGroup::UpdateNumTransforms()
 {
     worldTransforms_.Resize(instanceNodes_.size());
+    quantizedWorldTransforms_.Resize(instanceNodes_.size());
     numWorldTransforms_ = 0; // Correct amount will be during world bounding box update
     nodeIDsDirty_ = true;
 
@@ -55,6 +55,11 @@ namespace Urho3D
         void RemoveInstanceNode(Node* node);
         /// Remove all instance scene nodes.
         void RemoveAllInstanceNodes();
+        /// Set distance beyond which single instances are not drawn, for example because an ImpostorSet draws them instead. 0 (default) draws all instances.
+        /// @property
+        void SetInstanceDrawDistance(float distance);
+        /// Set an instance draw distance that is used at runtime instead of the instance draw distance attribute, for example by an ImpostorSet, or a negative value to restore the attribute. Not saved or replicated.
+        void SetInstanceDrawDistanceOverride(float distance);
 
         /// Return number of instance nodes.
         /// @property
@@ -64,6 +69,10 @@ namespace Urho3D
         /// @property{get_instanceNodes}
         Node* GetInstanceNode(u32 index) const;
 
+        /// Return distance beyond which single instances are not drawn.
+        /// @property
+        float GetInstanceDrawDistance() const { return instanceDrawDistance_; }
+
         /// Set node IDs attribute.
         void SetNodeIDsAttr(const VariantVector& value);
 
@@ -86,8 +95,18 @@ namespace Urho3D
         std::vector<WeakPtr<Node> > instanceNodes_;
         /// World transforms of valid (existing and visible) instances.
         PODVector<Matrix3x4> worldTransforms_;
+        /// World transforms of valid instances combined with the position transform of a model with quantized vertex positions.
+        PODVector<Matrix3x4> quantizedWorldTransforms_;
+        /// World transforms of the instances within the instance draw distance per camera.
+        std::unordered_map<Camera*, PODVector<Matrix3x4> > visibleWorldTransforms_;
+        /// Last frame counter for knowing when to erase the visible world transforms of previous frame.
+        u32 lastFrame_{ 0u };
         /// IDs of instance nodes for serialization.
         mutable VariantVector nodeIDsAttr_;
+        /// Distance beyond which single instances are not drawn.
+        float instanceDrawDistance_{};
+        /// Runtime instance draw distance override, or negative if not overridden.
+        float instanceDrawDistanceOverride_{ -1.0f };
         /// Number of valid instance node transforms.
         unsigned numWorldTransforms_{};
         /// Whether node IDs have been set and nodes should be searched for during ApplyAttributes.
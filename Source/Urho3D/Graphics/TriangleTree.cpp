@@ -0,0 +1,476 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Graphics/TriangleTree.h"
+#include "../Math/Frustum.h"
+#include "../Math/Ray.h"
+
+#include <algorithm>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+    /// Maximum number of triangles in a leaf.
+    static const unsigned MAX_LEAF_SIZE = 8;
+    /// Number of triangles below which a node is not split.
+    static const unsigned MIN_SPLIT_SIZE = 3;
+    /// Number of bins for evaluating split candidates.
+    static const unsigned NUM_BINS = 16;
+    /// Depth after which nodes are split at the median to bound the tree depth.
+    static const unsigned MAX_SAH_DEPTH = 64;
+    /// Traversal stack size.
+    static const unsigned MAX_TRAVERSAL_DEPTH = 128;
+    /// Relative padding of triangle bounds, so that hits found by the triangle test are never culled by the node test.
+    static const float BOUNDS_PADDING = 1.0e-5f;
+    /// Direction component used in place of zero when inverting a ray direction.
+    static const float MIN_DIRECTION = 1.0e-30f;
+
+    /// Traversal stack entry.
+    struct TriangleTreeRayEntry
+    {
+        /// Node index.
+        unsigned node_;
+        /// Ray entry distance of the node.
+        float distance_;
+    };
+
+    /// Return ray entry distance of a bounding box, or infinity if it is missed or further than maxDistance.
+    static inline float HitBox(const BoundingBox& box, const Vector3& origin, const Vector3& invDirection, float maxDistance)
+    {
+        float x1 = (box.min_.x_ - origin.x_) * invDirection.x_;
+        float x2 = (box.max_.x_ - origin.x_) * invDirection.x_;
+        float y1 = (box.min_.y_ - origin.y_) * invDirection.y_;
+        float y2 = (box.max_.y_ - origin.y_) * invDirection.y_;
+        float z1 = (box.min_.z_ - origin.z_) * invDirection.z_;
+        float z2 = (box.max_.z_ - origin.z_) * invDirection.z_;
+
+        float entryDistance = Max(Max(Min(x1, x2), Min(y1, y2)), Max(Min(z1, z2), 0.0f));
+        float exitDistance = Min(Min(Max(x1, x2), Max(y1, y2)), Max(z1, z2));
+        return (entryDistance <= exitDistance && entryDistance <= maxDistance) ? entryDistance : M_INFINITY;
+    }
+
+    /// Return half surface area of a bounding box, or zero if undefined.
+    static inline float HalfArea(const BoundingBox& box)
+    {
+        if (!box.Defined())
+            return 0.0f;
+        Vector3 size = box.Size();
+        return size.x_ * size.y_ + size.y_ * size.z_ + size.z_ * size.x_;
+    }
+
+    TriangleTree::TriangleTree() = default;
+
+    TriangleTree::~TriangleTree() = default;
+
+    bool TriangleTree::Build(const unsigned char* vertexData, unsigned vertexSize, const unsigned char* indexData, unsigned indexSize,
+        unsigned indexStart, unsigned indexCount)
+    {
+        Clear();
+
+        if (!vertexData || !vertexSize || !indexData || (indexSize != sizeof(unsigned short) && indexSize != sizeof(unsigned)))
+            return false;
+
+        unsigned numTriangles = indexCount / 3;
+        if (!numTriangles)
+            return false;
+
+        vertices_.resize(numTriangles * 3);
+        if (indexSize == sizeof(unsigned short))
+        {
+            const unsigned short* indices = ((const unsigned short*)indexData) + indexStart;
+            for (unsigned i = 0; i < numTriangles * 3; ++i)
+                vertices_[i] = *((const Vector3*)(&vertexData[indices[i] * vertexSize]));
+        }
+        else
+        {
+            const unsigned* indices = ((const unsigned*)indexData) + indexStart;
+            for (unsigned i = 0; i < numTriangles * 3; ++i)
+                vertices_[i] = *((const Vector3*)(&vertexData[indices[i] * vertexSize]));
+        }
+
+        BuildTree();
+        return true;
+    }
+
+    bool TriangleTree::Build(const unsigned char* vertexData, unsigned vertexSize, unsigned vertexStart, unsigned vertexCount)
+    {
+        Clear();
+
+        if (!vertexData || !vertexSize)
+            return false;
+
+        unsigned numTriangles = vertexCount / 3;
+        if (!numTriangles)
+            return false;
+
+        vertices_.resize(numTriangles * 3);
+        const unsigned char* vertices = vertexData + vertexStart * vertexSize;
+        for (unsigned i = 0; i < numTriangles * 3; ++i)
+            vertices_[i] = *((const Vector3*)(&vertices[i * vertexSize]));
+
+        BuildTree();
+        return true;
+    }
+
+    void TriangleTree::Clear()
+    {
+        nodes_.clear();
+        bounds_.clear();
+        vertices_.clear();
+        triangles_.clear();
+        boundingBox_.Clear();
+    }
+
+    float TriangleTree::HitDistance(const Ray& ray, float maxDistance, Vector3* outNormal, Vector3* outBary, unsigned* outTriangle) const
+    {
+        float nearest = M_INFINITY;
+        unsigned nearestIndex = M_MAX_UNSIGNED;
+        Vector3 normal;
+        Vector3 bary;
+
+        TraverseRay(ray, maxDistance, [&](unsigned first, unsigned count)
+        {
+            for (unsigned i = first; i < first + count; ++i)
+            {
+                const Vector3* v = &vertices_[i * 3];
+                float distance = ray.HitDistance(v[0], v[1], v[2], &normal, &bary);
+                if (distance > maxDistance)
+                    continue;
+
+                // Resolve ties towards the lowest source triangle like a linear search would
+                unsigned triangle = triangles_[i];
+                if (distance < nearest || (distance == nearest && triangle < nearestIndex))
+                {
+                    nearest = distance;
+                    nearestIndex = triangle;
+                    if (outNormal)
+                        *outNormal = normal;
+                    if (outBary)
+                        *outBary = bary;
+                }
+            }
+            return Min(nearest, maxDistance);
+        });
+
+        if (outTriangle)
+            *outTriangle = nearestIndex;
+        return nearest;
+    }
+
+    bool TriangleTree::IsInside(const Ray& ray) const
+    {
+        float currentFrontFace = M_INFINITY;
+        float currentBackFace = M_INFINITY;
+
+        TraverseRay(ray, M_INFINITY, [&](unsigned first, unsigned count)
+        {
+            for (unsigned i = first; i < first + count; ++i)
+            {
+                const Vector3* v = &vertices_[i * 3];
+                float frontFaceDistance = ray.HitDistance(v[0], v[1], v[2]);
+                float backFaceDistance = ray.HitDistance(v[2], v[1], v[0]);
+                currentFrontFace = Min(frontFaceDistance > 0.0f ? frontFaceDistance : M_INFINITY, currentFrontFace);
+                currentBackFace = Min(backFaceDistance > 0.0f ? backFaceDistance : M_INFINITY, currentBackFace);
+            }
+            // Only the nearer of the two can still change the result
+            return Min(currentFrontFace, currentBackFace);
+        });
+
+        return currentBackFace < currentFrontFace;
+    }
+
+    void TriangleTree::GetTriangles(PODVector<unsigned>& dest, const BoundingBox& box) const
+    {
+        Traverse([&box](const BoundingBox& nodeBox)
+        {
+            return box.IsInsideFast(nodeBox) != OUTSIDE;
+        },
+        [this, &dest](unsigned first, unsigned count)
+        {
+            for (unsigned i = first; i < first + count; ++i)
+                dest.Push(triangles_[i]);
+        });
+    }
+
+    void TriangleTree::GetTriangles(PODVector<unsigned>& dest, const Frustum& frustum) const
+    {
+        Traverse([&frustum](const BoundingBox& nodeBox)
+        {
+            return frustum.IsInsideFast(nodeBox) != OUTSIDE;
+        },
+        [this, &dest](unsigned first, unsigned count)
+        {
+            for (unsigned i = first; i < first + count; ++i)
+                dest.Push(triangles_[i]);
+        });
+    }
+
+    unsigned TriangleTree::GetMemoryUse() const
+    {
+        return (unsigned)(sizeof(TriangleTree) + nodes_.capacity() * sizeof(TriangleTreeNode) + bounds_.capacity() * sizeof(BoundingBox) +
+            vertices_.capacity() * sizeof(Vector3) + triangles_.capacity() * sizeof(unsigned));
+    }
+
+    void TriangleTree::BuildTree()
+    {
+        unsigned numTriangles = (unsigned)vertices_.size() / 3;
+
+        for (const Vector3& vertex : vertices_)
+            boundingBox_.Merge(vertex);
+
+        Vector3 extent = boundingBox_.Size();
+        Vector3 maxAbs = VectorMax(boundingBox_.max_.Abs(), boundingBox_.min_.Abs());
+        float padding = Max(Max(Max(maxAbs.x_, maxAbs.y_), maxAbs.z_) + Max(Max(extent.x_, extent.y_), extent.z_), 1.0f) *
+            BOUNDS_PADDING;
+        Vector3 paddingVector(padding, padding, padding);
+
+        buildBounds_.resize(numTriangles);
+        buildCenters_.resize(numTriangles);
+        triangles_.resize(numTriangles);
+        for (unsigned i = 0; i < numTriangles; ++i)
+        {
+            const Vector3* v = &vertices_[i * 3];
+            buildBounds_[i] = BoundingBox(VectorMin(VectorMin(v[0], v[1]), v[2]) - paddingVector,
+                VectorMax(VectorMax(v[0], v[1]), v[2]) + paddingVector);
+            buildCenters_[i] = buildBounds_[i].Center();
+            triangles_[i] = i;
+        }
+
+        // Leaves hold on average a few triangles, so reserve for two nodes per leaf
+        nodes_.reserve(numTriangles / 2 + 1);
+        bounds_.reserve(numTriangles / 2 + 1);
+        BuildNode(0, numTriangles, 0);
+
+        // Copy positions to leaf order
+        std::vector<Vector3> sourceVertices;
+        sourceVertices.swap(vertices_);
+        vertices_.resize(numTriangles * 3);
+        for (unsigned i = 0; i < numTriangles; ++i)
+        {
+            const Vector3* src = &sourceVertices[triangles_[i] * 3];
+            Vector3* dest = &vertices_[i * 3];
+            dest[0] = src[0];
+            dest[1] = src[1];
+            dest[2] = src[2];
+        }
+
+        nodes_.shrink_to_fit();
+        bounds_.shrink_to_fit();
+        std::vector<BoundingBox>().swap(buildBounds_);
+        std::vector<Vector3>().swap(buildCenters_);
+    }
+
+    unsigned TriangleTree::BuildNode(unsigned first, unsigned count, unsigned depth)
+    {
+        unsigned nodeIndex = (unsigned)nodes_.size();
+        nodes_.push_back({ M_MAX_UNSIGNED, first, count });
+        bounds_.emplace_back();
+
+        BoundingBox box;
+        BoundingBox centerBox;
+        for (unsigned i = first; i < first + count; ++i)
+        {
+            box.Merge(buildBounds_[triangles_[i]]);
+            centerBox.Merge(buildCenters_[triangles_[i]]);
+        }
+        bounds_[nodeIndex] = box;
+
+        if (count < MIN_SPLIT_SIZE)
+            return nodeIndex;
+
+        Vector3 centerSize = centerBox.Size();
+        unsigned axis = 0;
+        if (centerSize.y_ > centerSize.x_)
+            axis = 1;
+        if (centerSize.z_ > centerSize.Data()[axis])
+            axis = 2;
+
+        float axisMin = centerBox.min_.Data()[axis];
+        float axisSize = centerSize.Data()[axis];
+        unsigned half = 0;
+
+        if (axisSize > 0.0f && depth < MAX_SAH_DEPTH)
+        {
+            // Bin the triangle centers and evaluate the surface area heuristic at each bin boundary
+            unsigned binCounts[NUM_BINS] = {};
+            BoundingBox binBounds[NUM_BINS];
+            float scale = (float)NUM_BINS / axisSize;
+            auto binIndex = [&](unsigned triangle)
+            {
+                return Min((unsigned)((buildCenters_[triangle].Data()[axis] - axisMin) * scale), NUM_BINS - 1);
+            };
+
+            for (unsigned i = first; i < first + count; ++i)
+            {
+                unsigned bin = binIndex(triangles_[i]);
+                ++binCounts[bin];
+                binBounds[bin].Merge(buildBounds_[triangles_[i]]);
+            }
+
+            float rightAreas[NUM_BINS];
+            unsigned rightCounts[NUM_BINS];
+            BoundingBox rightBox;
+            unsigned rightCount = 0;
+            for (unsigned i = NUM_BINS - 1; i > 0; --i)
+            {
+                rightBox.Merge(binBounds[i]);
+                rightCount += binCounts[i];
+                rightAreas[i] = HalfArea(rightBox);
+                rightCounts[i] = rightCount;
+            }
+
+            float bestCost = M_INFINITY;
+            unsigned bestSplit = 0;
+            BoundingBox leftBox;
+            unsigned leftCount = 0;
+            for (unsigned i = 1; i < NUM_BINS; ++i)
+            {
+                leftBox.Merge(binBounds[i - 1]);
+                leftCount += binCounts[i - 1];
+                if (!leftCount || !rightCounts[i])
+                    continue;
+                float cost = HalfArea(leftBox) * leftCount + rightAreas[i] * rightCounts[i];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestSplit = i;
+                }
+            }
+
+            // Keep small nodes as leaves if splitting is not expected to pay off
+            if (count <= MAX_LEAF_SIZE && bestCost >= HalfArea(box) * count)
+                return nodeIndex;
+
+            if (bestSplit)
+            {
+                unsigned* start = &triangles_[first];
+                half = (unsigned)(std::partition(start, start + count, [&](unsigned triangle)
+                {
+                    return binIndex(triangle) < bestSplit;
+                }) - start);
+            }
+        }
+        else if (count <= MAX_LEAF_SIZE)
+            return nodeIndex;
+
+        // Fall back to a median split when all centers coincide or the tree is getting too deep
+        if (!half || half == count)
+        {
+            half = count / 2;
+            unsigned* start = &triangles_[first];
+            std::nth_element(start, start + half, start + count, [&](unsigned lhs, unsigned rhs)
+            {
+                return buildCenters_[lhs].Data()[axis] < buildCenters_[rhs].Data()[axis];
+            });
+        }
+
+        BuildNode(first, half, depth + 1);
+        unsigned right = BuildNode(first + half, count - half, depth + 1);
+        nodes_[nodeIndex].right_ = right;
+        nodes_[nodeIndex].count_ = 0;
+        return nodeIndex;
+    }
+
+    template <class NodeTest, class LeafVisitor> void TriangleTree::Traverse(NodeTest test, LeafVisitor visit) const
+    {
+        if (nodes_.empty())
+            return;
+
+        unsigned stack[MAX_TRAVERSAL_DEPTH];
+        unsigned stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize)
+        {
+            unsigned index = stack[--stackSize];
+            if (!test(bounds_[index]))
+                continue;
+
+            const TriangleTreeNode& node = nodes_[index];
+            if (node.right_ == M_MAX_UNSIGNED)
+                visit(node.first_, node.count_);
+            else
+            {
+                assert(stackSize + 2 <= MAX_TRAVERSAL_DEPTH);
+                stack[stackSize++] = node.right_;
+                stack[stackSize++] = index + 1;
+            }
+        }
+    }
+
+    template <class LeafVisitor> void TriangleTree::TraverseRay(const Ray& ray, float maxDistance, LeafVisitor visit) const
+    {
+        if (nodes_.empty())
+            return;
+
+        const Vector3& origin = ray.origin_;
+        const Vector3& direction = ray.direction_;
+        Vector3 invDirection(
+            1.0f / (Abs(direction.x_) > MIN_DIRECTION ? direction.x_ : MIN_DIRECTION),
+            1.0f / (Abs(direction.y_) > MIN_DIRECTION ? direction.y_ : MIN_DIRECTION),
+            1.0f / (Abs(direction.z_) > MIN_DIRECTION ? direction.z_ : MIN_DIRECTION));
+
+        float cullDistance = maxDistance;
+        float rootDistance = HitBox(bounds_[0], origin, invDirection, cullDistance);
+        if (rootDistance == M_INFINITY)
+            return;
+
+        TriangleTreeRayEntry stack[MAX_TRAVERSAL_DEPTH];
+        unsigned stackSize = 0;
+        stack[stackSize++] = { 0, rootDistance };
+
+        while (stackSize)
+        {
+            TriangleTreeRayEntry entry = stack[--stackSize];
+            if (entry.distance_ > cullDistance)
+                continue;
+
+            const TriangleTreeNode& node = nodes_[entry.node_];
+            if (node.right_ == M_MAX_UNSIGNED)
+            {
+                cullDistance = visit(node.first_, node.count_);
+                continue;
+            }
+
+            unsigned left = entry.node_ + 1;
+            unsigned right = node.right_;
+            float leftDistance = HitBox(bounds_[left], origin, invDirection, cullDistance);
+            float rightDistance = HitBox(bounds_[right], origin, invDirection, cullDistance);
+
+            // Push the farther child first so that the nearer one is visited first
+            if (leftDistance > rightDistance)
+            {
+                Swap(left, right);
+                Swap(leftDistance, rightDistance);
+            }
+            assert(stackSize + 2 <= MAX_TRAVERSAL_DEPTH);
+            if (rightDistance != M_INFINITY)
+                stack[stackSize++] = { right, rightDistance };
+            if (leftDistance != M_INFINITY)
+                stack[stackSize++] = { left, leftDistance };
+        }
+    }
+}
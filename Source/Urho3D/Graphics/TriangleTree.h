@@ -0,0 +1,109 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/Vector.h"
+#include "../Math/BoundingBox.h"
+
+#include <vector>
+
+namespace Urho3D
+{
+    class Frustum;
+    class Ray;
+
+    /// Node of a triangle tree. Children of an interior node are stored at the next index and at right_.
+    struct TriangleTreeNode
+    {
+        /// Second child node, or M_MAX_UNSIGNED for a leaf.
+        unsigned right_;
+        /// Index of the first triangle of a leaf.
+        unsigned first_;
+        /// Number of triangles in a leaf.
+        unsigned count_;
+    };
+
+    /// Bounding volume hierarchy of the triangles of a triangle list, used to accelerate CPU-side raycasts and triangle queries against large geometries. Built with binned surface area heuristic splits. Triangle positions are copied in leaf order so that traversal does not touch the source vertex data. Triangles are identified by their position in the source data: triangle i uses the indices or vertices starting at 3 * i from the start of the range.
+    /// @nobind
+    class URHO3D_API TriangleTree
+    {
+    public:
+        /// Construct empty.
+        TriangleTree();
+        /// Destruct.
+        ~TriangleTree();
+
+        /// Build from indexed vertex data. Positions must be at the start of each vertex. Return true if successful.
+        bool Build(const unsigned char* vertexData, unsigned vertexSize, const unsigned char* indexData, unsigned indexSize,
+            unsigned indexStart, unsigned indexCount);
+        /// Build from non-indexed vertex data. Positions must be at the start of each vertex. Return true if successful.
+        bool Build(const unsigned char* vertexData, unsigned vertexSize, unsigned vertexStart, unsigned vertexCount);
+        /// Remove all triangles.
+        void Clear();
+
+        /// Return distance to the nearest front-facing triangle hit by a ray, or infinity if none closer than maxDistance. Optionally return the unnormalized hit normal, barycentric coordinates and triangle index. Matches Ray::HitDistance() on the same data.
+        float HitDistance(const Ray& ray, float maxDistance = M_INFINITY, Vector3* outNormal = nullptr, Vector3* outBary = nullptr,
+            unsigned* outTriangle = nullptr) const;
+        /// Return whether the nearest triangle hit by a ray is back-facing, meaning the ray starts inside the geometry. Matches Ray::InsideGeometry() on the same data.
+        bool IsInside(const Ray& ray) const;
+        /// Return indices of triangles whose bounds intersect a bounding box, in tree order.
+        void GetTriangles(PODVector<unsigned>& dest, const BoundingBox& box) const;
+        /// Return indices of triangles whose bounds intersect a frustum, in tree order.
+        void GetTriangles(PODVector<unsigned>& dest, const Frustum& frustum) const;
+
+        /// Return bounding box of all triangles.
+        const BoundingBox& GetBoundingBox() const { return boundingBox_; }
+        /// Return number of triangles.
+        unsigned GetNumTriangles() const { return (unsigned)triangles_.size(); }
+        /// Return number of nodes.
+        unsigned GetNumNodes() const { return (unsigned)nodes_.size(); }
+        /// Return approximate memory use in bytes.
+        unsigned GetMemoryUse() const;
+
+    private:
+        /// Build the tree from the copied triangle positions.
+        void BuildTree();
+        /// Build a subtree from a range of build items. Return the node index.
+        unsigned BuildNode(unsigned first, unsigned count, unsigned depth);
+        /// Visit the leaves whose bounds pass a test.
+        template <class NodeTest, class LeafVisitor> void Traverse(NodeTest test, LeafVisitor visit) const;
+        /// Visit the leaves hit by a ray in approximately front-to-back order. The visitor returns the current culling distance.
+        template <class LeafVisitor> void TraverseRay(const Ray& ray, float maxDistance, LeafVisitor visit) const;
+
+        /// Nodes, root first.
+        std::vector<TriangleTreeNode> nodes_;
+        /// Node bounds.
+        std::vector<BoundingBox> bounds_;
+        /// Triangle positions in leaf order, three per triangle.
+        std::vector<Vector3> vertices_;
+        /// Source triangle indices in leaf order.
+        std::vector<unsigned> triangles_;
+        /// Bounding box of all triangles.
+        BoundingBox boundingBox_;
+        /// Triangle bounds used during build.
+        std::vector<BoundingBox> buildBounds_;
+        /// Triangle centers used during build.
+        std::vector<Vector3> buildCenters_;
+    };
+}
@@ -204,4 +204,137 @@ void VertexBuffer::UpdateOffsets(PODVector<VertexElement>& elements)
     }
 }
 
+Vector4 VertexBuffer::ReadElement(const void* data, VertexElementType type)
+{
+    switch (type)
+    {
+    case TYPE_INT:
+        return Vector4((float)*static_cast<const int*>(data), 0.0f, 0.0f, 1.0f);
+
+    case TYPE_FLOAT:
+        return Vector4(*static_cast<const float*>(data), 0.0f, 0.0f, 1.0f);
+
+    case TYPE_VECTOR2:
+        {
+            auto* src = static_cast<const float*>(data);
+            return Vector4(src[0], src[1], 0.0f, 1.0f);
+        }
+
+    case TYPE_VECTOR3:
+        {
+            auto* src = static_cast<const float*>(data);
+            return Vector4(src[0], src[1], src[2], 1.0f);
+        }
+
+    case TYPE_VECTOR4:
+        return Vector4(static_cast<const float*>(data));
+
+    case TYPE_UBYTE4:
+        {
+            auto* src = static_cast<const unsigned char*>(data);
+            return Vector4(src[0], src[1], src[2], src[3]);
+        }
+
+    case TYPE_UBYTE4_NORM:
+        {
+            auto* src = static_cast<const unsigned char*>(data);
+            return Vector4(src[0], src[1], src[2], src[3]) / 255.0f;
+        }
+
+    case TYPE_HALF2:
+        {
+            auto* src = static_cast<const unsigned short*>(data);
+            return Vector4(HalfToFloat(src[0]), HalfToFloat(src[1]), 0.0f, 1.0f);
+        }
+
+    case TYPE_HALF4:
+        {
+            auto* src = static_cast<const unsigned short*>(data);
+            return Vector4(HalfToFloat(src[0]), HalfToFloat(src[1]), HalfToFloat(src[2]), HalfToFloat(src[3]));
+        }
+
+    case TYPE_BYTE4_NORM:
+        {
+            auto* src = static_cast<const signed char*>(data);
+            return Vector4(Max(src[0] / 127.0f, -1.0f), Max(src[1] / 127.0f, -1.0f), Max(src[2] / 127.0f, -1.0f),
+                Max(src[3] / 127.0f, -1.0f));
+        }
+
+    case TYPE_SHORT4_NORM:
+        {
+            auto* src = static_cast<const short*>(data);
+            return Vector4(Max(src[0] / 32767.0f, -1.0f), Max(src[1] / 32767.0f, -1.0f), Max(src[2] / 32767.0f, -1.0f),
+                Max(src[3] / 32767.0f, -1.0f));
+        }
+
+    default:
+        return Vector4::ZERO;
+    }
+}
+
+void VertexBuffer::WriteElement(void* data, VertexElementType type, const Vector4& value)
+{
+    switch (type)
+    {
+    case TYPE_INT:
+        *static_cast<int*>(data) = RoundToInt(value.x_);
+        break;
+
+    case TYPE_FLOAT:
+        *static_cast<float*>(data) = value.x_;
+        break;
+
+    case TYPE_VECTOR2:
+    case TYPE_VECTOR3:
+    case TYPE_VECTOR4:
+        memcpy(data, value.Data(), ELEMENT_TYPESIZES[type]);
+        break;
+
+    case TYPE_UBYTE4:
+        {
+            auto* dest = static_cast<unsigned char*>(data);
+            for (unsigned i = 0; i < 4; ++i)
+                dest[i] = (unsigned char)Clamp(RoundToInt(value.Data()[i]), 0, 255);
+        }
+        break;
+
+    case TYPE_UBYTE4_NORM:
+        {
+            auto* dest = static_cast<unsigned char*>(data);
+            for (unsigned i = 0; i < 4; ++i)
+                dest[i] = (unsigned char)Clamp(RoundToInt(value.Data()[i] * 255.0f), 0, 255);
+        }
+        break;
+
+    case TYPE_HALF2:
+    case TYPE_HALF4:
+        {
+            auto* dest = static_cast<unsigned short*>(data);
+            const unsigned count = type == TYPE_HALF2 ? 2 : 4;
+            for (unsigned i = 0; i < count; ++i)
+                dest[i] = FloatToHalf(value.Data()[i]);
+        }
+        break;
+
+    case TYPE_BYTE4_NORM:
+        {
+            auto* dest = static_cast<signed char*>(data);
+            for (unsigned i = 0; i < 4; ++i)
+                dest[i] = (signed char)Clamp(RoundToInt(value.Data()[i] * 127.0f), -127, 127);
+        }
+        break;
+
+    case TYPE_SHORT4_NORM:
+        {
+            auto* dest = static_cast<short*>(data);
+            for (unsigned i = 0; i < 4; ++i)
+                dest[i] = (short)Clamp(RoundToInt(value.Data()[i] * 32767.0f), -32767, 32767);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
 }
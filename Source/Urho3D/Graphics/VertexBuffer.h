@@ -27,6 +27,7 @@
 #include "../Core/Object.h"
 #include "../Graphics/GPUObject.h"
 #include "../Graphics/GraphicsDefs.h"
+#include "../Math/Vector4.h"
 
 namespace Urho3D
 {
@@ -139,6 +140,12 @@ namespace Urho3D
         /// Update offsets of vertex elements.
         static void UpdateOffsets(PODVector<VertexElement>& elements);
 
+        /// Read a vertex element value converted to floating point. Normalized types are returned in their normalized range. Components missing from the element type are returned as zero, except W which is returned as one.
+        static Vector4 ReadElement(const void* data, VertexElementType type);
+
+        /// Write a vertex element value converted from floating point. Normalized types are clamped to their range.
+        static void WriteElement(void* data, VertexElementType type, const Vector4& value);
+
     private:
         /// Update offsets of vertex elements.
         void UpdateOffsets();
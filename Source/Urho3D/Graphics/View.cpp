@@ -30,6 +30,7 @@
 #include "../Graphics/Graphics.h"
 #include "../Graphics/GraphicsEvents.h"
 #include "../Graphics/GraphicsImpl.h"
+#include "../Graphics/LightClusters.h"
 #include "../Graphics/Material.h"
 #include "../Graphics/OcclusionBuffer.h"
 #include "../Graphics/Octree.h"
@@ -56,33 +57,8 @@ using namespace std;
 
 namespace Urho3D
 {
-    /// %Frustum octree query for shadowcasters.
-    class ShadowCasterOctreeQuery : public FrustumOctreeQuery
-    {
-    public:
-        /// Construct with frustum and query parameters.
-        ShadowCasterOctreeQuery(PODVector<Drawable*>& result, const Frustum& frustum, unsigned char drawableFlags = DRAWABLE_ANY,
-            unsigned viewMask = DEFAULT_VIEWMASK) :
-            FrustumOctreeQuery(result, frustum, drawableFlags, viewMask)
-        {
-        }
-
-        /// Intersection test for drawables.
-        void TestDrawables(Drawable** start, Drawable** end, bool inside) override
-        {
-            while (start != end)
-            {
-                Drawable* drawable = *start++;
-
-                if (drawable->GetCastShadows() && (drawable->GetDrawableFlags() & drawableFlags_) &&
-                    (drawable->GetViewMask() & viewMask_))
-                {
-                    if (inside || frustum_.IsInsideFast(drawable->GetWorldBoundingBox()))
-                        result_.Push(drawable);
-                }
-            }
-        }
-    };
+    /// Frames the temporal occlusion buffer is reprojected before it is rebuilt from scratch.
+    static constexpr unsigned MAX_TEMPORAL_OCCLUSION_FRAMES = 16;
 
     /// %Frustum octree query for zones and occluders.
     class ZoneOccluderOctreeQuery : public FrustumOctreeQuery
@@ -278,6 +254,27 @@ namespace Urho3D
             start->shadowSplits_[i].shadowBatches_.SortFrontToBack();
     }
 
+    /// Batch queue to be recorded into its command list, with the settings it will be drawn with.
+    struct BatchQueueRecording
+    {
+        /// Batch queue.
+        const BatchQueue* queue_;
+        /// Camera to draw with.
+        Camera* camera_;
+        /// Mark to stencil flag.
+        bool markToStencil_;
+        /// Light optimization flag.
+        bool usingLightOptimization_;
+    };
+
+    void RecordBatchQueueWork(const WorkItem* item, unsigned threadIndex)
+    {
+        auto* recording = reinterpret_cast<BatchQueueRecording*>(item->start_);
+        auto* view = reinterpret_cast<View*>(item->aux_);
+
+        recording->queue_->Record(view, recording->camera_, recording->markToStencil_, recording->usingLightOptimization_);
+    }
+
     StringHash ParseTextureTypeXml(ResourceCache* cache, const String& filename);
 
     View::View(Context* context) :
@@ -288,9 +285,13 @@ namespace Urho3D
         // Create octree query and scene results vector for each thread
         unsigned numThreads = GetSubsystem<WorkQueue>()->GetNumThreads() + 1; // Worker threads + main thread
         tempDrawables_.Resize(numThreads);
+        tempShadowCasters_.Resize(numThreads);
+        tempShadowCasterMasks_.Resize(numThreads);
         sceneResults_.Resize(numThreads);
     }
 
+    View::~View() = default;
+
     bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
     {
         sourceView_ = nullptr;
@@ -343,6 +344,7 @@ namespace Urho3D
                 deferred_ = sourceView_->deferred_;
                 deferredAmbient_ = sourceView_->deferredAmbient_;
                 useLitBase_ = sourceView_->useLitBase_;
+                useClusteredLights_ = sourceView_->useClusteredLights_;
                 hasScenePasses_ = sourceView_->hasScenePasses_;
                 noStencil_ = sourceView_->noStencil_;
                 lightVolumeCommand_ = sourceView_->lightVolumeCommand_;
@@ -368,6 +370,7 @@ namespace Urho3D
         deferred_ = false;
         deferredAmbient_ = false;
         useLitBase_ = false;
+        useClusteredLights_ = false;
         hasScenePasses_ = false;
         noStencil_ = false;
         lightVolumeCommand_ = nullptr;
@@ -414,6 +417,9 @@ namespace Urho3D
                 info.allowInstancing_ = command.sortMode_ != SORT_BACKTOFRONT;
                 info.markToStencil_ = !noStencil_ && command.markToStencil_;
                 info.vertexLights_ = command.vertexLights_;
+                info.clusteredLights_ = command.clusteredLights_;
+                if (command.clusteredLights_)
+                    useClusteredLights_ = true;
 
                 // Check scenepass metadata for defining custom passes which interact with lighting
                 if (!command.metadata_.Empty())
@@ -497,6 +503,10 @@ namespace Urho3D
             }
         }
 
+        // The lit base pass would replace the base pass batches that apply the clustered lights
+        if (useClusteredLights_)
+            useLitBase_ = false;
+
         drawShadows_ = renderer_->GetDrawShadows();
         materialQuality_ = renderer_->GetMaterialQuality();
         maxOccluderTriangles_ = renderer_->GetMaxOccluderTriangles();
@@ -615,6 +625,9 @@ namespace Urho3D
         }
 #endif
 
+        // Record the batch queues' draw commands in worker threads
+        RecordCommandLists();
+
         // Render
         ExecuteRenderPathCommands();
 
@@ -760,11 +773,31 @@ namespace Urho3D
 
         graphics_->SetShaderParameter(VSP_VIEWPROJ, projection * camera->GetView());
 
+        // Clustered lights are addressed with the culling camera's clusters
+        View* actualView = sourceView_ ? sourceView_ : this;
+        if (actualView->lightClusterTexture_ && actualView->lightDataTexture_ && graphics_->HasShaderParameter(PSP_CLUSTERMATRIX))
+        {
+            LightClusters* clusters = actualView->lightClusters_;
+            const IntVector3& gridSize = clusters->GetGridSize();
+            graphics_->SetShaderParameter(PSP_CLUSTERMATRIX, clusters->GetClusterMatrix());
+            graphics_->SetShaderParameter(PSP_CLUSTERGRID, Vector4((float)gridSize.x_, (float)gridSize.y_, (float)gridSize.z_, 0.0f));
+            graphics_->SetShaderParameter(PSP_CLUSTERDEPTH, clusters->GetDepthParams());
+            graphics_->SetShaderParameter(PSP_CLUSTERMAPSIZE, Vector4((float)CLUSTER_DATA_WIDTH, 1.0f / (float)CLUSTER_DATA_WIDTH,
+                1.0f / (float)actualView->lightClusterTexture_->GetHeight(), 1.0f / (float)actualView->lightDataTexture_->GetWidth()));
+        }
+
         // If in a scene pass and the command defines shader parameters, set them now
         if (passCommand_)
             SetCommandShaderParameters(*passCommand_);
     }
 
+    void View::SetClusteredLightTextures()
+    {
+        View* actualView = sourceView_ ? sourceView_ : this;
+        graphics_->SetTexture(TU_LIGHTCLUSTERS, actualView->lightClusterTexture_);
+        graphics_->SetTexture(TU_LIGHTDATA, actualView->lightDataTexture_);
+    }
+
     void View::SetCommandShaderParameters(const RenderPathCommand& command)
     {
         const HashMap<StringHash, Variant>& parameters = command.shaderParameters_;
@@ -804,7 +837,23 @@ namespace Urho3D
         auto* queue = GetSubsystem<WorkQueue>();
         PODVector<Drawable*>& tempDrawables = tempDrawables_[0];
 
+        // Use the drawables culled together with the other views of the scene if available
+        unsigned sharedMask = 0;
+        const SharedViewCulling* shared = renderer_->GetSharedViewCulling(octree_, cullCamera_, sharedMask);
+
         // Get zones and occluders first
+        if (shared)
+        {
+            tempDrawables.Clear();
+            for (unsigned i = 0; i < shared->drawables_.Size(); ++i)
+            {
+                Drawable* drawable = shared->drawables_[i];
+                unsigned char flags = drawable->GetDrawableFlags();
+                if ((shared->masks_[i] & sharedMask) && (flags == DRAWABLE_ZONE || (flags == DRAWABLE_GEOMETRY && drawable->IsOccluder())))
+                    tempDrawables.Push(drawable);
+            }
+        }
+        else
         {
             ZoneOccluderOctreeQuery
                 query(tempDrawables, cullCamera_->GetFrustum(), DRAWABLE_GEOMETRY | DRAWABLE_ZONE, cullCamera_->GetViewMask());
@@ -867,15 +916,25 @@ namespace Urho3D
             {
                 URHO3D_PROFILE(DrawOcclusion);
 
-                occlusionBuffer_ = renderer_->GetOcclusionBuffer(cullCamera_);
+                occlusionBuffer_ = renderer_->GetTemporalOcclusion() ? GetTemporalOcclusionBuffer() : renderer_->GetOcclusionBuffer(cullCamera_);
                 DrawOccluders(occlusionBuffer_, occluders_);
             }
         }
         else
             occluders_.Clear();
 
-        // Get lights and geometries. Coarse occlusion for octants is used at this point
-        if (occlusionBuffer_)
+        // Get lights and geometries. Coarse occlusion for octants is used at this point, except for shared culling results,
+        // which are only tested for occlusion per drawable
+        if (shared)
+        {
+            tempDrawables.Clear();
+            for (unsigned i = 0; i < shared->drawables_.Size(); ++i)
+            {
+                if ((shared->masks_[i] & sharedMask) && (shared->drawables_[i]->GetDrawableFlags() & (DRAWABLE_GEOMETRY | DRAWABLE_LIGHT)))
+                    tempDrawables.Push(shared->drawables_[i]);
+            }
+        }
+        else if (occlusionBuffer_)
         {
             OccludedFrustumOctreeQuery query
             (tempDrawables, cullCamera_->GetFrustum(), occlusionBuffer_, DRAWABLE_GEOMETRY | DRAWABLE_LIGHT, cullCamera_->GetViewMask());
@@ -976,6 +1035,8 @@ namespace Urho3D
 
         ProcessLights();
         GetLightBatches();
+        if (useClusteredLights_)
+            UpdateLightClusters();
         GetBaseBatches();
     }
 
@@ -1013,13 +1074,28 @@ namespace Urho3D
         {
             URHO3D_PROFILE(GetLightBatches);
 
-            // Preallocate light queues: per-pixel lights which have lit geometries
+            // Preallocate light queues: per-pixel lights which have lit geometries. Unshadowed lights are applied through the light
+            // clusters if in use, unless the light mask excludes visible geometries in range: the clusters can not respect the
+            // drawable and zone light masks. Clustered lights still get a light queue for the batches of passes that do not use
+            // the clusters, and in deferred rendering for their light volumes
             unsigned numLightQueues = 0;
             unsigned usedLightQueues = 0;
-            for (Vector<LightQueryResult>::ConstIterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
+            clusteredLights_.Clear();
+            for (Vector<LightQueryResult>::Iterator i = lightQueryResults_.Begin(); i != lightQueryResults_.End(); ++i)
             {
-                if (!i->light_->GetPerVertex() && i->litGeometries_.size())
-                    ++numLightQueues;
+                Light* light = i->light_;
+                i->clustered_ = false;
+                if (light->GetPerVertex() || i->litGeometries_.empty())
+                    continue;
+
+                if (useClusteredLights_ && !i->numSplits_ && !light->IsNegative() && !i->maskedGeometries_ &&
+                    clusteredLights_.Size() < MAX_CLUSTERED_LIGHTS)
+                {
+                    i->clustered_ = true;
+                    clusteredLights_.Push(light);
+                }
+
+                ++numLightQueues;
             }
 
             lightQueues_.Resize(numLightQueues);
@@ -1046,7 +1122,9 @@ namespace Urho3D
                     light->SetLightQueue(&lightQueue);
                     lightQueue.light_ = light;
                     lightQueue.negative_ = light->IsNegative();
+                    lightQueue.clustered_ = query.clustered_;
                     lightQueue.shadowMap_ = nullptr;
+                    lightQueue.cachedShadowMap_ = nullptr;
                     lightQueue.litBaseBatches_.Clear(maxSortedInstances);
                     lightQueue.litBatches_.Clear(maxSortedInstances);
                     if (forwardLightsCommand_)
@@ -1064,7 +1142,18 @@ namespace Urho3D
                     // Allocate shadow map now
                     if (shadowSplits > 0)
                     {
-                        lightQueue.shadowMap_ = renderer_->GetShadowMap(light, cullCamera_, (unsigned)viewSize_.x, (unsigned)viewSize_.y);
+                        // Use the cached shadow map if valid, or allocate one to be rendered and kept for later frames
+                        lightQueue.cachedShadowMap_ = query.cachedShadowMap_;
+                        if (query.cacheShadowMap_ && !lightQueue.cachedShadowMap_)
+                        {
+                            lightQueue.cachedShadowMap_ = renderer_->AllocateCachedShadowMap(light, octree_, cullCamera_->GetViewMask(),
+                                query.shadowCasterBox_[0]);
+                        }
+
+                        if (lightQueue.cachedShadowMap_)
+                            lightQueue.shadowMap_ = lightQueue.cachedShadowMap_->shadowMap_;
+                        else
+                            lightQueue.shadowMap_ = renderer_->GetShadowMap(light, cullCamera_, (unsigned)viewSize_.x, (unsigned)viewSize_.y);
                         // If did not manage to get a shadow map, convert the light to unshadowed
                         if (!lightQueue.shadowMap_)
                             shadowSplits = 0;
@@ -1125,7 +1214,7 @@ namespace Urho3D
                         }
                     }
 
-                    // Process lit geometries
+                    // Process lit geometries. Batches of passes that use the light clusters are skipped for clustered lights
                     for (Drawable* drawable : query.litGeometries_)
                     {
                         drawable->AddLight(light);
@@ -1192,6 +1281,53 @@ namespace Urho3D
         }
     }
 
+    void View::UpdateLightClusters()
+    {
+        if (!lightClusters_)
+            lightClusters_ = new LightClusters(context_);
+        lightClusters_->Build(cullCamera_, minZ_, maxZ_, clusteredLights_);
+
+        URHO3D_PROFILE(UpdateLightClusterTextures);
+
+        // The light data texture holds the maximum number of lights, while the cluster data texture grows as needed
+        if (!lightDataTexture_)
+        {
+            lightDataTexture_ = new Texture2D(context_);
+            lightDataTexture_->SetNumLevels(1);
+            lightDataTexture_->SetFilterMode(FILTER_NEAREST);
+            lightDataTexture_->SetAddressMode(COORD_U, ADDRESS_CLAMP);
+            lightDataTexture_->SetAddressMode(COORD_V, ADDRESS_CLAMP);
+            if (!lightDataTexture_->SetSize(MAX_CLUSTERED_LIGHTS * CLUSTERED_LIGHT_DATA_SIZE, 1, Graphics::GetRGBAFloat32Format(),
+                TEXTURE_DYNAMIC))
+            {
+                lightDataTexture_.Reset();
+                return;
+            }
+        }
+
+        const PODVector<Vector4>& clusterData = lightClusters_->GetClusterData();
+        int clusterRows = (int)(clusterData.Size() / CLUSTER_DATA_WIDTH);
+        if (!lightClusterTexture_ || lightClusterTexture_->GetHeight() < clusterRows)
+        {
+            lightClusterTexture_ = new Texture2D(context_);
+            lightClusterTexture_->SetNumLevels(1);
+            lightClusterTexture_->SetFilterMode(FILTER_NEAREST);
+            lightClusterTexture_->SetAddressMode(COORD_U, ADDRESS_CLAMP);
+            lightClusterTexture_->SetAddressMode(COORD_V, ADDRESS_CLAMP);
+            if (!lightClusterTexture_->SetSize(CLUSTER_DATA_WIDTH, NextPowerOfTwo((unsigned)clusterRows),
+                Graphics::GetRGBAFloat32Format(), TEXTURE_DYNAMIC))
+            {
+                lightClusterTexture_.Reset();
+                return;
+            }
+        }
+
+        const PODVector<Vector4>& lightData = lightClusters_->GetLightData();
+        if (!lightData.Empty())
+            lightDataTexture_->SetData(0, 0, 0, (int)lightData.Size(), 1, lightData.Buffer());
+        lightClusterTexture_->SetData(0, 0, 0, CLUSTER_DATA_WIDTH, clusterRows, clusterData.Buffer());
+    }
+
     void View::GetBaseBatches()
     {
         URHO3D_PROFILE(GetBaseBatches);
@@ -1401,6 +1537,10 @@ namespace Urho3D
             if (gBufferPassIndex_ != M_MAX_UNSIGNED && tech->HasPass(gBufferPassIndex_))
                 continue;
 
+            // A clustered light already reaches the materials drawn in a scene pass that uses the light clusters
+            if (lightQueue.clustered_ && IsLitByClusters(tech))
+                continue;
+
             Batch destBatch(srcBatch);
             bool isLitAlpha = false;
 
@@ -1450,6 +1590,17 @@ namespace Urho3D
         }
     }
 
+    bool View::IsLitByClusters(Technique* tech) const
+    {
+        for (const ScenePassInfo& info : scenePasses_)
+        {
+            if (info.clusteredLights_ && tech->GetSupportedPass(info.passIndex_))
+                return true;
+        }
+
+        return false;
+    }
+
     void View::ExecuteRenderPathCommands()
     {
         View* actualView = sourceView_ ? sourceView_ : this;
@@ -1626,6 +1777,10 @@ namespace Urho3D
 
                             for (Vector<LightBatchQueue>::Iterator i = actualView->lightQueues_.Begin(); i != actualView->lightQueues_.End(); ++i)
                             {
+                                // Clustered lights only have batches for the passes that do not use the light clusters, if any
+                                if (i->clustered_ && i->litBaseBatches_.IsEmpty() && i->litBatches_.IsEmpty())
+                                    continue;
+
                                 // If reusing shadowmaps, render each of them before the lit batches
                                 if (renderer_->GetReuseShadowMaps() && NeedRenderShadowMap(*i))
                                 {
@@ -1690,7 +1845,10 @@ namespace Urho3D
                                 for (unsigned j = 0; j < i->volumeBatches_.Size(); ++j)
                                 {
                                     SetupLightVolumeBatch(i->volumeBatches_[j]);
-                                    i->volumeBatches_[j].Draw(this, camera_, false);
+                                    volumeCommands_.Begin(camera_, false, true);
+                                    i->volumeBatches_[j].Draw(volumeCommands_, this, camera_);
+                                    volumeCommands_.End();
+                                    volumeCommands_.Execute(this, false);
                                 }
 
                                 passCommand_ = nullptr;
@@ -2229,15 +2387,41 @@ namespace Urho3D
     void View::DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& occluders)
     {
         buffer->SetMaxTriangles((unsigned)maxOccluderTriangles_);
-        buffer->Clear();
+
+        // With temporal occlusion, start from the previous frame's buffer and draw only the occluders not in it yet
+        bool temporal = buffer == temporalOcclusionBuffer_;
+        bool reprojected = false;
+        if (temporal)
+        {
+            if (IsTemporalOcclusionValid())
+                reprojected = buffer->Reproject();
+
+            if (reprojected)
+                ++temporalOcclusionFrames_;
+            else
+            {
+                buffer->Clear();
+                temporalOccluders_.clear();
+                temporalOccluderSet_.clear();
+                temporalOcclusionFrames_ = 0;
+                temporalOcclusionOctree_ = octree_;
+                temporalOcclusionCamera_ = cullCamera_;
+            }
+        }
+        else
+            buffer->Clear();
 
         if (!buffer->IsThreaded())
         {
             // If not threaded, draw occluders one by one and test the next occluder against already rasterized depth
+            bool hasDepth = reprojected;
             for (unsigned i = 0; i < occluders.Size(); ++i)
             {
                 Drawable* occluder = occluders[i];
-                if (i > 0)
+                if (temporal && temporalOccluderSet_.count(occluder))
+                    continue;
+
+                if (hasDepth)
                 {
                     // For subsequent occluders, do a test against the pixel-level occlusion buffer to see if rendering is necessary
                     if (!buffer->IsVisible(occluder->GetWorldBoundingBox()))
@@ -2249,6 +2433,12 @@ namespace Urho3D
                 bool success = occluder->DrawOcclusion(buffer);
                 // Draw triangles submitted by this occluder
                 buffer->DrawTriangles();
+                hasDepth = true;
+                if (temporal)
+                {
+                    temporalOccluders_.push_back(TemporalOccluder{ WeakPtr<Drawable>(occluder), occluder->GetWorldBoundingBox() });
+                    temporalOccluderSet_.insert(occluder);
+                }
                 if (!success)
                     break;
             }
@@ -2258,9 +2448,18 @@ namespace Urho3D
             // In threaded mode submit all triangles first, then render (cannot test in this case)
             for (unsigned i = 0; i < occluders.Size(); ++i)
             {
+                Drawable* occluder = occluders[i];
+                if (temporal)
+                {
+                    if (temporalOccluderSet_.count(occluder))
+                        continue;
+                    temporalOccluders_.push_back(TemporalOccluder{ WeakPtr<Drawable>(occluder), occluder->GetWorldBoundingBox() });
+                    temporalOccluderSet_.insert(occluder);
+                }
+
                 // Check for running out of triangles
                 ++activeOccluders_;
-                if (!occluders[i]->DrawOcclusion(buffer))
+                if (!occluder->DrawOcclusion(buffer))
                     break;
             }
 
@@ -2271,6 +2470,42 @@ namespace Urho3D
         buffer->BuildDepthHierarchy();
     }
 
+    OcclusionBuffer* View::GetTemporalOcclusionBuffer()
+    {
+        // Recreate the buffer if threading was toggled, as the contents cannot be kept anyway
+        if (!temporalOcclusionBuffer_ || temporalOcclusionBuffer_->IsThreaded() != renderer_->GetThreadedOcclusion())
+            temporalOcclusionBuffer_ = new OcclusionBuffer(context_);
+
+        int width = renderer_->GetOcclusionBufferSize();
+        auto height = RoundToInt(width / cullCamera_->GetAspectRatio());
+
+        temporalOcclusionBuffer_->SetSize(width, height, renderer_->GetThreadedOcclusion());
+        temporalOcclusionBuffer_->SetView(cullCamera_);
+        temporalOcclusionBuffer_->ResetUseTimer();
+        return temporalOcclusionBuffer_;
+    }
+
+    bool View::IsTemporalOcclusionValid() const
+    {
+        // Rebuild periodically, as repeated reprojection leaves holes where the view is magnified
+        if (temporalOcclusionFrames_ >= MAX_TEMPORAL_OCCLUSION_FRAMES)
+            return false;
+
+        // The view may be reused for another viewport, or the viewport given another scene or camera
+        if (temporalOcclusionOctree_ != octree_ || temporalOcclusionCamera_ != cullCamera_)
+            return false;
+
+        for (const TemporalOccluder& occluder : temporalOccluders_)
+        {
+            Drawable* drawable = occluder.drawable_;
+            if (!drawable || !drawable->IsEnabledEffective() || !drawable->IsOccluder() ||
+                drawable->GetWorldBoundingBox() != occluder.worldBoundingBox_)
+                return false;
+        }
+
+        return true;
+    }
+
     void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
     {
         Light* light = query.light_;
@@ -2291,6 +2526,7 @@ namespace Urho3D
         // Get lit geometries. They must match the light mask and be inside the main camera frustum to be considered
         PODVector<Drawable*>& tempDrawables = tempDrawables_[threadIndex];
         query.litGeometries_.clear();
+        query.maskedGeometries_ = false;
 
         switch (type)
         {
@@ -2301,6 +2537,8 @@ namespace Urho3D
                     {
                         query.litGeometries_.push_back(geometries_[i]);
                     }
+                    else
+                        query.maskedGeometries_ = true;
                 }
                 break;
 
@@ -2311,10 +2549,14 @@ namespace Urho3D
                 octree_->GetDrawables(octreeQuery);
                 for (unsigned i = 0; i < tempDrawables.Size(); ++i)
                 {
-                    if (tempDrawables[i]->IsInView(frame_) && (GetLightMask(tempDrawables[i]) & lightMask))
+                    if (!tempDrawables[i]->IsInView(frame_))
+                        continue;
+                    if (GetLightMask(tempDrawables[i]) & lightMask)
                     {
                         query.litGeometries_.push_back(tempDrawables[i]);
                     }
+                    else
+                        query.maskedGeometries_ = true;
                 }
             }
             break;
@@ -2326,15 +2568,24 @@ namespace Urho3D
                 octree_->GetDrawables(octreeQuery);
                 for (unsigned i = 0; i < tempDrawables.Size(); ++i)
                 {
-                    if (tempDrawables[i]->IsInView(frame_) && (GetLightMask(tempDrawables[i]) & lightMask))
+                    if (!tempDrawables[i]->IsInView(frame_))
+                        continue;
+                    if (GetLightMask(tempDrawables[i]) & lightMask)
                     {
                         query.litGeometries_.push_back(tempDrawables[i]);
                     }
+                    else
+                        query.maskedGeometries_ = true;
                 }
             }
             break;
         }
 
+        // Shadow maps of spot and point lights can be kept between frames, as they do not depend on the view
+        bool cacheShadowMap = isShadowed && type != LightType::Directional && renderer_->GetCacheShadowMaps();
+        query.cacheShadowMap_ = cacheShadowMap;
+        query.cachedShadowMap_ = nullptr;
+
         // If no lit geometries or not shadowed, no need to process shadow cameras
         if (query.litGeometries_.empty() || !isShadowed)
         {
@@ -2345,16 +2596,47 @@ namespace Urho3D
         // Determine number of shadow cameras and setup their initial positions
         SetupShadowCameras(query);
 
+        // If the cached shadow map is still valid, the shadow casters need not be queried or rendered
+        if (cacheShadowMap)
+        {
+            query.cachedShadowMap_ = renderer_->GetValidCachedShadowMap(light, octree_, cullCamera_->GetViewMask());
+            if (query.cachedShadowMap_)
+            {
+                query.shadowCasters_.clear();
+                for (unsigned i = 0; i < query.numSplits_; ++i)
+                {
+                    query.shadowCasterBegin_[i] = query.shadowCasterEnd_[i] = 0;
+                    query.shadowCasterBox_[i] = query.cachedShadowMap_->shadowCasterBox_;
+                }
+                return;
+            }
+        }
+
+        // For directional light, query the shadow casters of all splits that are inside the visible scene at once
+        PODVector<Drawable*>& splitShadowCasters = tempShadowCasters_[threadIndex];
+        PODVector<unsigned>& splitMasks = tempShadowCasterMasks_[threadIndex];
+        if (type == LightType::Directional)
+        {
+            MultiFrustumOctreeQuery octreeQuery(splitShadowCasters, splitMasks, DRAWABLE_GEOMETRY, true);
+            for (unsigned i = 0; i < query.numSplits_; ++i)
+            {
+                if (minZ_ <= query.shadowFarSplits_[i] && maxZ_ >= query.shadowNearSplits_[i])
+                    octreeQuery.AddFrustum(query.shadowCameras_[i]->GetFrustum(), cullCamera_->GetViewMask());
+            }
+            octree_->GetDrawables(octreeQuery);
+        }
+
         // Process each split for shadow casters
         query.shadowCasters_.clear();
+        unsigned splitMask = 1;
         for (unsigned i = 0; i < query.numSplits_; ++i)
         {
             Camera* shadowCamera = query.shadowCameras_[i];
             const Frustum& shadowCameraFrustum = shadowCamera->GetFrustum();
             query.shadowCasterBegin_[i] = query.shadowCasterEnd_[i] = query.shadowCasters_.size();
 
-            // For point light check that the face is visible: if not, can skip the split
-            if (type == LightType::Point && frustum.IsInsideFast(BoundingBox(shadowCameraFrustum)) == OUTSIDE)
+            // For point light check that the face is visible: if not, can skip the split. A cached shadow map needs all faces
+            if (type == LightType::Point && !cacheShadowMap && frustum.IsInsideFast(BoundingBox(shadowCameraFrustum)) == OUTSIDE)
                 continue;
 
             // For directional light check that the split is inside the visible scene: if not, can skip the split
@@ -2366,12 +2648,20 @@ namespace Urho3D
                     continue;
 
                 // Reuse lit geometry query for all except directional lights
-                ShadowCasterOctreeQuery query(tempDrawables, shadowCameraFrustum, DRAWABLE_GEOMETRY, cullCamera_->GetViewMask());
-                octree_->GetDrawables(query);
+                tempDrawables.Clear();
+                for (unsigned j = 0; j < splitShadowCasters.Size(); ++j)
+                {
+                    if (splitMasks[j] & splitMask)
+                        tempDrawables.Push(splitShadowCasters[j]);
+                }
+                splitMask <<= 1;
             }
 
             // Check which shadow casters actually contribute to the shadowing
-            ProcessShadowCasters(query, tempDrawables, i);
+            if (cacheShadowMap)
+                ProcessCachedShadowCasters(query, tempDrawables, i);
+            else
+                ProcessShadowCasters(query, tempDrawables, i);
         }
 
         // If no shadow casters, the light can be rendered unshadowed. At this point we have not allocated a shadow map yet, so the
@@ -2456,6 +2746,46 @@ namespace Urho3D
         query.shadowCasterEnd_[splitIndex] = query.shadowCasters_.size();
     }
 
+    void View::ProcessCachedShadowCasters(LightQueryResult& query, const PODVector<Drawable*>& drawables, unsigned splitIndex)
+    {
+        Light* light = query.light_;
+        unsigned lightMask = light->GetLightMask();
+
+        Camera* shadowCamera = query.shadowCameras_[splitIndex];
+        const Frustum& shadowCameraFrustum = shadowCamera->GetFrustum();
+        const Matrix3x4& lightView = shadowCamera->GetView();
+        const Matrix4& lightProj = shadowCamera->GetProjection();
+        LightType type = light->GetLightType();
+        bool focus = type == LightType::Spot && light->GetShadowFocus().focus_;
+
+        query.shadowCasterBox_[splitIndex].Clear();
+
+        // The shadow map is reused by later frames and other views, so the casters are not culled by the view frustum or
+        // by their shadow distance
+        for (PODVector<Drawable*>::ConstIterator i = drawables.Begin(); i != drawables.End(); ++i)
+        {
+            Drawable* drawable = *i;
+            if (!drawable->GetCastShadows())
+                continue;
+            if (!(GetShadowMask(drawable) & lightMask))
+                continue;
+            if (type == LightType::Point && shadowCameraFrustum.IsInsideFast(drawable->GetWorldBoundingBox()) == OUTSIDE)
+                continue;
+
+            if (!drawable->IsInView(frame_, true))
+                drawable->UpdateBatches(frame_);
+
+            if (focus)
+            {
+                BoundingBox lightProjBox(drawable->GetWorldBoundingBox().Transformed(lightView).Projected(lightProj));
+                query.shadowCasterBox_[splitIndex].Merge(lightProjBox);
+            }
+            query.shadowCasters_.push_back(drawable);
+        }
+
+        query.shadowCasterEnd_[splitIndex] = query.shadowCasters_.size();
+    }
+
     bool View::IsShadowCasterVisible(Drawable* drawable, BoundingBox lightViewBox, Camera* shadowCamera, const Matrix3x4& lightView,
         const Frustum& lightViewFrustum, const BoundingBox& lightViewFrustumBox)
     {
@@ -2886,6 +3216,11 @@ namespace Urho3D
     {
         String vsDefines = command.vertexShaderDefines_.Trimmed();
         String psDefines = command.pixelShaderDefines_.Trimmed();
+        if (command.clusteredLights_)
+        {
+            vsDefines = (vsDefines + " CLUSTERED").Trimmed();
+            psDefines = (psDefines + " CLUSTERED").Trimmed();
+        }
         if (vsDefines.Length() || psDefines.Length())
         {
             queue.hasExtraDefines_ = true;
@@ -3006,6 +3341,86 @@ namespace Urho3D
         instancingBuffer->Unlock();
     }
 
+    void View::RecordCommandLists()
+    {
+        // The queues of a source view are recorded when first drawn
+        if (sourceView_)
+            return;
+
+        URHO3D_PROFILE(RecordCommandLists);
+
+        PODVector<BatchQueueRecording> recordings;
+        bool hasForwardLights = false;
+
+        for (unsigned i = 0; i < renderPath_->commands_.Size(); ++i)
+        {
+            const RenderPathCommand& command = renderPath_->commands_[i];
+            if (!IsNecessary(command))
+                continue;
+
+            if (command.type_ == CMD_SCENEPASS)
+            {
+                const BatchQueue& queue = batchQueues_[command.passIndex_];
+                if (queue.IsEmpty())
+                    continue;
+
+                // If the same pass is drawn several times, record it only once. The other draws record their own settings
+                bool found = false;
+                for (unsigned j = 0; j < recordings.Size(); ++j)
+                {
+                    if (recordings[j].queue_ == &queue)
+                    {
+                        found = true;
+                        break;
+                    }
+                }
+
+                if (!found)
+                    recordings.Push(BatchQueueRecording{ &queue, camera_, command.markToStencil_, false });
+            }
+            else if (command.type_ == CMD_FORWARDLIGHTS)
+                hasForwardLights = true;
+        }
+
+        for (Vector<LightBatchQueue>::Iterator i = lightQueues_.Begin(); i != lightQueues_.End(); ++i)
+        {
+            if (hasForwardLights)
+            {
+                if (!i->litBaseBatches_.IsEmpty())
+                    recordings.Push(BatchQueueRecording{ &i->litBaseBatches_, camera_, false, false });
+                if (!i->litBatches_.IsEmpty())
+                    recordings.Push(BatchQueueRecording{ &i->litBatches_, camera_, false, true });
+            }
+
+            if (NeedRenderShadowMap(*i))
+            {
+                for (unsigned j = 0; j < i->shadowSplits_.Size(); ++j)
+                {
+                    const ShadowBatchQueue& shadowQueue = i->shadowSplits_[j];
+                    if (!shadowQueue.shadowBatches_.IsEmpty())
+                        recordings.Push(BatchQueueRecording{ &shadowQueue.shadowBatches_, shadowQueue.shadowCamera_, false, false });
+                }
+            }
+        }
+
+        if (recordings.Empty())
+            return;
+
+        auto* queue = GetSubsystem<WorkQueue>();
+
+        for (unsigned i = 0; i < recordings.Size(); ++i)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = RecordBatchQueueWork;
+            item->start_ = &recordings[i];
+            item->aux_ = this;
+            queue->AddWorkItem(item);
+        }
+
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+
     void View::SetupLightVolumeBatch(Batch& batch)
     {
         Light* light = batch.lightQueue_->light_;
@@ -3057,6 +3472,10 @@ namespace Urho3D
 
     bool View::NeedRenderShadowMap(const LightBatchQueue& queue)
     {
+        // A valid cached shadow map is not rendered again
+        if (queue.cachedShadowMap_ && queue.cachedShadowMap_->valid_)
+            return false;
+
         // Must have a shadow map, and either forward or deferred lit batches
         return queue.shadowMap_ && (!queue.litBatches_.IsEmpty() || !queue.litBaseBatches_.IsEmpty() ||
             !queue.volumeBatches_.Empty());
@@ -3146,6 +3565,13 @@ namespace Urho3D
         // reset some parameters
         graphics_->SetColorWrite(true);
         graphics_->SetDepthBias(0.0f, 0.0f);
+
+        // The cached shadow map can now be used by later frames and views
+        if (queue.cachedShadowMap_)
+        {
+            shadowMap->ClearDataLost();
+            queue.cachedShadowMap_->valid_ = true;
+        }
     }
 
     RenderSurface* View::GetDepthStencil(RenderSurface* renderTarget)
@@ -34,6 +34,7 @@ namespace Urho3D
     class Camera;
     class DebugRenderer;
     class Light;
+    class LightClusters;
     class Drawable;
     class Graphics;
     class OcclusionBuffer;
@@ -46,6 +47,7 @@ namespace Urho3D
     class Texture2D;
     class Viewport;
     class Zone;
+    struct CachedShadowMap;
     struct RenderPathCommand;
     struct WorkItem;
 
@@ -72,6 +74,14 @@ namespace Urho3D
         float shadowFarSplits_[MAX_LIGHT_SPLITS];
         /// Shadow map split count.
         uint32_t numSplits_;
+        /// Shadow map is cached between frames flag.
+        bool cacheShadowMap_;
+        /// Valid cached shadow map, or null if the shadow map must be rendered.
+        CachedShadowMap* cachedShadowMap_;
+        /// Light is applied through the light clusters instead of per-light batches flag.
+        bool clustered_;
+        /// Visible geometries in range that the light mask excludes flag.
+        bool maskedGeometries_;
     };
 
     /// Scene render pass info.
@@ -85,10 +95,21 @@ namespace Urho3D
         bool markToStencil_;
         /// Vertex light flag.
         bool vertexLights_;
+        /// Clustered lights flag.
+        bool clusteredLights_;
         /// Batch queue.
         BatchQueue* batchQueue_;
     };
 
+    /// Occluder drawn into a temporal occlusion buffer.
+    struct TemporalOccluder
+    {
+        /// Drawable.
+        WeakPtr<Drawable> drawable_;
+        /// World bounding box when drawn.
+        BoundingBox worldBoundingBox_;
+    };
+
     /// Per-thread geometry, light and scene range collection structure.
     struct PerThreadSceneResult
     {
@@ -116,7 +137,7 @@ namespace Urho3D
         /// Construct.
         explicit View(Context* context);
         /// Destruct.
-        ~View() override = default;
+        ~View() override;
 
         /// Define with rendertarget and viewport. Return true if successful.
         bool Define(RenderSurface* renderTarget, Viewport* viewport);
@@ -169,6 +190,9 @@ namespace Urho3D
         /// Return light batch queues.
         const Vector<LightBatchQueue>& GetLightQueues() const { return lightQueues_; }
 
+        /// Return light clusters, or null if no scene pass uses clustered lights.
+        LightClusters* GetLightClusters() const { return useClusteredLights_ ? lightClusters_.Get() : nullptr; }
+
         /// Return the last used software occlusion buffer.
         OcclusionBuffer* GetOcclusionBuffer() const { return occlusionBuffer_; }
 
@@ -182,6 +206,8 @@ namespace Urho3D
         void SetGlobalShaderParameters();
         /// Set camera-specific shader parameters. Called by Batch and internally by View.
         void SetCameraShaderParameters(Camera* camera);
+        /// Set clustered light textures. Called by Batch.
+        void SetClusteredLightTextures();
         /// Set command's shader parameters if any. Called internally by View.
         void SetCommandShaderParameters(const RenderPathCommand& command);
         /// Set G-buffer offset and inverse size shader parameters. Called by Batch and internally by View.
@@ -208,6 +234,8 @@ namespace Urho3D
         void UpdateGeometries();
         /// Get pixel lit batches for a certain light and drawable.
         void GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQueue* alphaQueue);
+        /// Return whether a technique has a pass drawn in a scene pass that uses the light clusters.
+        bool IsLitByClusters(Technique* tech) const;
         /// Execute render commands.
         void ExecuteRenderPathCommands();
         /// Set rendertargets for current render command.
@@ -232,10 +260,18 @@ namespace Urho3D
         void UpdateOccluders(PODVector<Drawable*>& occluders, Camera* camera);
         /// Draw occluders to occlusion buffer.
         void DrawOccluders(OcclusionBuffer* buffer, const PODVector<Drawable*>& occluders);
+        /// Return the persistent occlusion buffer for temporal occlusion, set up for the cull camera.
+        OcclusionBuffer* GetTemporalOcclusionBuffer();
+        /// Return whether the temporal occlusion buffer contents can be reused: no occluder drawn into it has moved or been removed.
+        bool IsTemporalOcclusionValid() const;
+        /// Assign the clustered lights to light clusters and update the cluster textures.
+        void UpdateLightClusters();
         /// Query for lit geometries and shadow casters for a light.
         void ProcessLight(LightQueryResult& query, unsigned threadIndex);
         /// Process shadow casters' visibilities and build their combined view- or projection-space bounding box.
         void ProcessShadowCasters(LightQueryResult& query, const PODVector<Drawable*>& drawables, unsigned splitIndex);
+        /// Query for shadow casters of a cached shadow map independent of the view.
+        void ProcessCachedShadowCasters(LightQueryResult& query, const PODVector<Drawable*>& drawables, unsigned splitIndex);
         /// Set up initial shadow camera view(s).
         void SetupShadowCameras(LightQueryResult& query);
         /// Set up a directional light shadow camera.
@@ -263,6 +299,8 @@ namespace Urho3D
         void AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, bool allowInstancing = true, bool allowShadows = true);
         /// Prepare instancing buffer by filling it with all instance transforms.
         void PrepareInstancingBuffer();
+        /// Record the draw commands of the batch queues in worker threads.
+        void RecordCommandLists();
         /// Set up a light volume rendering batch.
         void SetupLightVolumeBatch(Batch& batch);
         /// Check whether a light queue needs shadow rendering.
@@ -372,6 +410,8 @@ namespace Urho3D
         bool deferredAmbient_{};
         /// Forward light base pass optimization flag. If in use, combine the base pass and first light for all opaque objects.
         bool useLitBase_{};
+        /// Clustered lights flag. Inferred from the existence of a scene pass command with clustered lights in the renderpath.
+        bool useClusteredLights_{};
         /// Has scene passes flag. If no scene passes, view can be defined without a valid scene or camera to only perform quad rendering.
         bool hasScenePasses_{};
         /// Whether is using a custom readable depth texture without a stencil channel.
@@ -382,6 +422,10 @@ namespace Urho3D
         RenderPath* renderPath_{};
         /// Per-thread octree query results.
         Vector<PODVector<Drawable*> > tempDrawables_;
+        /// Per-thread shadow caster query results for all splits of a directional light.
+        Vector<PODVector<Drawable*> > tempShadowCasters_;
+        /// Per-thread split bitmasks of the shadow caster query results.
+        Vector<PODVector<unsigned> > tempShadowCasterMasks_;
         /// Per-thread geometries, lights and Z range collection results.
         Vector<PerThreadSceneResult> sceneResults_;
         /// Visible zones.
@@ -394,8 +438,28 @@ namespace Urho3D
         PODVector<Drawable*> threadedGeometries_;
         /// Occluder objects.
         PODVector<Drawable*> occluders_;
+        /// Persistent occlusion buffer for temporal occlusion.
+        SharedPtr<OcclusionBuffer> temporalOcclusionBuffer_;
+        /// Occluders drawn into the temporal occlusion buffer since it was last cleared.
+        std::vector<TemporalOccluder> temporalOccluders_;
+        /// Set of occluders drawn into the temporal occlusion buffer since it was last cleared.
+        std::unordered_set<Drawable*> temporalOccluderSet_;
+        /// Number of frames the temporal occlusion buffer has been reprojected since it was last cleared.
+        unsigned temporalOcclusionFrames_{};
+        /// Octree the temporal occlusion buffer was drawn from. The buffer is cleared when the viewport's scene changes.
+        WeakPtr<Octree> temporalOcclusionOctree_;
+        /// Culling camera the temporal occlusion buffer was drawn with. The buffer is cleared when the viewport's camera changes.
+        WeakPtr<Camera> temporalOcclusionCamera_;
         /// Lights.
         PODVector<Light*> lights_;
+        /// Lights applied through the light clusters.
+        PODVector<Light*> clusteredLights_;
+        /// Light clusters.
+        SharedPtr<LightClusters> lightClusters_;
+        /// Light cluster data texture.
+        SharedPtr<Texture2D> lightClusterTexture_;
+        /// Clustered light data texture.
+        SharedPtr<Texture2D> lightDataTexture_;
         /// Number of active occluders.
         unsigned activeOccluders_{};
 
@@ -431,6 +495,8 @@ namespace Urho3D
         const RenderPathCommand* forwardLightsCommand_{};
         /// Pointer to the current commmand if it contains shader parameters to be set for a render pass.
         const RenderPathCommand* passCommand_{};
+        /// Command list for drawing light volume batches.
+        CommandList volumeCommands_;
         /// Flag for scene being resolved from the backbuffer.
         bool usedResolve_{};
     };
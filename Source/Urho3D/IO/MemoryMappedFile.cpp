@@ -0,0 +1,228 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+// Copyright (c) 2022 Amer Koleci and Contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+#include "../IO/MemoryMappedFile.h"
+#include "../Math/MathDefs.h"
+
+#ifdef __ANDROID__
+#include <SDL/SDL_rwops.h>
+#endif
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+MemoryMappedFile::MemoryMappedFile(const String& fileName)
+{
+    Open(fileName);
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    Close();
+}
+
+bool MemoryMappedFile::Open(const String& fileName)
+{
+    Close();
+
+    if (fileName.Empty())
+    {
+        URHO3D_LOGERROR("Could not map file with empty name");
+        return false;
+    }
+
+    fileName_ = fileName;
+
+#ifdef __ANDROID__
+    if (URHO3D_IS_ASSET(fileName))
+    {
+        // Assets live inside the APK and can not be mapped; read them through SDL instead
+        SDL_RWops* rwOps = SDL_RWFromFile(URHO3D_ASSET(fileName), "rb");
+        if (!rwOps)
+        {
+            URHO3D_LOGERRORF("Could not open Android asset file %s", fileName.CString());
+            return false;
+        }
+
+        fallbackBuffer_.resize((size_t)SDL_RWsize(rwOps));
+        size_t numRead = fallbackBuffer_.empty() ? 0 : SDL_RWread(rwOps, fallbackBuffer_.data(), fallbackBuffer_.size(), 1);
+        SDL_RWclose(rwOps);
+        if (!fallbackBuffer_.empty() && numRead != 1)
+        {
+            URHO3D_LOGERRORF("Could not read Android asset file %s", fileName.CString());
+            Close();
+            return false;
+        }
+
+        data_ = fallbackBuffer_.data();
+        size_ = (unsigned)fallbackBuffer_.size();
+        return true;
+    }
+#endif
+
+#if defined(_WIN32)
+    HANDLE fileHandle = CreateFileW(GetWideNativePath(fileName).CString(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        URHO3D_LOGERRORF("Could not open file %s", fileName.CString());
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart > M_MAX_UNSIGNED)
+    {
+        URHO3D_LOGERRORF("Could not query size of file %s", fileName.CString());
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    fileHandle_ = fileHandle;
+    size_ = (unsigned)fileSize.QuadPart;
+    // Zero-size files can not be mapped
+    if (!size_)
+    {
+        URHO3D_LOGERRORF("Could not map empty file %s", fileName.CString());
+        Close();
+        return false;
+    }
+
+    mappingHandle_ = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle_)
+        data_ = reinterpret_cast<const unsigned char*>(MapViewOfFile(mappingHandle_, FILE_MAP_READ, 0, 0, 0));
+
+    if (!data_)
+    {
+        URHO3D_LOGERRORF("Could not map file %s", fileName.CString());
+        Close();
+        return false;
+    }
+
+    mapped_ = true;
+    return true;
+#elif !defined(__EMSCRIPTEN__)
+    int fd = open(GetNativePath(fileName).CString(), O_RDONLY);
+    if (fd < 0)
+    {
+        URHO3D_LOGERRORF("Could not open file %s", fileName.CString());
+        return false;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || (unsigned long long)st.st_size > M_MAX_UNSIGNED)
+    {
+        URHO3D_LOGERRORF("Could not query size of file %s", fileName.CString());
+        close(fd);
+        return false;
+    }
+
+    size_ = (unsigned)st.st_size;
+    if (!size_)
+    {
+        URHO3D_LOGERRORF("Could not map empty file %s", fileName.CString());
+        close(fd);
+        return false;
+    }
+
+    void* ptr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (ptr == MAP_FAILED)
+    {
+        URHO3D_LOGERRORF("Could not map file %s", fileName.CString());
+        size_ = 0;
+        return false;
+    }
+
+    data_ = reinterpret_cast<const unsigned char*>(ptr);
+    mapped_ = true;
+    return true;
+#else
+    FILE* handle = fopen(GetNativePath(fileName).CString(), "rb");
+    if (!handle)
+    {
+        URHO3D_LOGERRORF("Could not open file %s", fileName.CString());
+        return false;
+    }
+
+    fseek(handle, 0, SEEK_END);
+    long size = ftell(handle);
+    fseek(handle, 0, SEEK_SET);
+    fallbackBuffer_.resize(size > 0 ? (size_t)size : 0);
+    bool success = fallbackBuffer_.empty() || fread(fallbackBuffer_.data(), fallbackBuffer_.size(), 1, handle) == 1;
+    fclose(handle);
+    if (!success)
+    {
+        URHO3D_LOGERRORF("Could not read file %s", fileName.CString());
+        Close();
+        return false;
+    }
+
+    data_ = fallbackBuffer_.data();
+    size_ = (unsigned)fallbackBuffer_.size();
+    return true;
+#endif
+}
+
+void MemoryMappedFile::Close()
+{
+#if defined(_WIN32)
+    if (mapped_ && data_)
+        UnmapViewOfFile(data_);
+    if (mappingHandle_)
+        CloseHandle((HANDLE)mappingHandle_);
+    if (fileHandle_)
+        CloseHandle((HANDLE)fileHandle_);
+    mappingHandle_ = nullptr;
+    fileHandle_ = nullptr;
+#elif !defined(__EMSCRIPTEN__)
+    if (mapped_ && data_)
+        munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+
+    fallbackBuffer_.clear();
+    fallbackBuffer_.shrink_to_fit();
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+}
+
+}
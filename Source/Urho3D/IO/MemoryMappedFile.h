@@ -0,0 +1,83 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+// Copyright (c) 2022 Amer Koleci and Contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/Str.h"
+
+#include <vector>
+
+namespace Urho3D
+{
+    /// Read-only view of a whole filesystem file mapped into memory. Falls back to reading the file into a heap buffer on platforms without file mapping.
+    /// @nobind
+    class URHO3D_API MemoryMappedFile
+    {
+    public:
+        /// Construct.
+        MemoryMappedFile() = default;
+        /// Construct and open a filesystem file.
+        explicit MemoryMappedFile(const String& fileName);
+        /// Destruct. Unmap the file if open.
+        ~MemoryMappedFile();
+
+        /// Prevent copy construction.
+        MemoryMappedFile(const MemoryMappedFile& rhs) = delete;
+        /// Prevent assignment.
+        MemoryMappedFile& operator =(const MemoryMappedFile& rhs) = delete;
+
+        /// Map a filesystem file for reading. Return true if successful.
+        bool Open(const String& fileName);
+        /// Unmap the file.
+        void Close();
+
+        /// Return whether is open.
+        bool IsOpen() const { return data_ != nullptr; }
+        /// Return mapped data.
+        const unsigned char* GetData() const { return data_; }
+        /// Return size of the mapped data in bytes.
+        unsigned GetSize() const { return size_; }
+        /// Return file name.
+        const String& GetName() const { return fileName_; }
+        /// Return whether the data is actually memory mapped, as opposed to read into a heap buffer.
+        bool IsMapped() const { return mapped_; }
+
+    private:
+        /// File name.
+        String fileName_;
+        /// Start of the file data.
+        const unsigned char* data_ = nullptr;
+        /// Size of the file data.
+        unsigned size_ = 0;
+        /// Heap buffer used when file mapping is not available.
+        std::vector<unsigned char> fallbackBuffer_;
+#ifdef _WIN32
+        /// File handle.
+        void* fileHandle_ = nullptr;
+        /// File mapping object handle.
+        void* mappingHandle_ = nullptr;
+#endif
+        /// Memory mapped flag.
+        bool mapped_ = false;
+    };
+}
@@ -38,6 +38,8 @@ namespace Urho3D
         return ""
 #ifdef URHO3D_OPENGL
             "#define URHO3D_OPENGL\n"
+#elif defined(URHO3D_NULLGRAPHICS)
+            "#define URHO3D_NULLGRAPHICS\n"
 #else
             "#define URHO3D_D3D11\n"
 #endif
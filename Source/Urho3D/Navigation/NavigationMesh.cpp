@@ -22,6 +22,7 @@
 
 #include "../Precompiled.h"
 
+#include "../Container/Sort.h"
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
 #include "../Graphics/DebugRenderer.h"
@@ -30,6 +31,7 @@
 #include "../Graphics/Model.h"
 #include "../Graphics/StaticModel.h"
 #include "../Graphics/TerrainPatch.h"
+#include "../Graphics/TriangleTree.h"
 #include "../Graphics/VertexBuffer.h"
 #include "../Graphics/Material.h"
 #include "../IO/Log.h"
@@ -1132,7 +1134,7 @@ namespace Urho3D
 
                             unsigned lodLevel = shape->GetLodLevel();
                             for (unsigned j = 0; j < model->GetNumGeometries(); ++j)
-                                AddTriMeshGeometry(build, model->GetGeometry(j, lodLevel), transform);
+                                AddTriMeshGeometry(build, model->GetGeometry(j, lodLevel), transform, box);
                         }
                         break;
 
@@ -1190,13 +1192,13 @@ namespace Urho3D
                     const Vector<SourceBatch>& batches = drawable->GetBatches();
 
                     for (unsigned j = 0; j < batches.Size(); ++j)
-                        AddTriMeshGeometry(build, drawable->GetLodGeometry(j, geometryList[i].lodLevel_), transform);
+                        AddTriMeshGeometry(build, drawable->GetLodGeometry(j, geometryList[i].lodLevel_), transform, box);
                 }
             }
         }
     }
 
-    void NavigationMesh::AddTriMeshGeometry(NavBuildData* build, Geometry* geometry, const Matrix3x4& transform)
+    void NavigationMesh::AddTriMeshGeometry(NavBuildData* build, Geometry* geometry, const Matrix3x4& transform, const BoundingBox& box)
     {
         if (!geometry)
             return;
@@ -1221,6 +1223,30 @@ namespace Urho3D
 
         unsigned destVertexStart = build->vertices_.Size();
 
+        // For large geometries only copy the triangles that can overlap the tile
+        if (const TriangleTree* tree = geometry->GetTriangleTree())
+        {
+            PODVector<unsigned> triangles;
+            tree->GetTriangles(triangles, box.Transformed(transform.Inverse()));
+            if (triangles.Size() < tree->GetNumTriangles())
+            {
+                Sort(triangles.Begin(), triangles.End());
+
+                for (unsigned triangle : triangles)
+                {
+                    unsigned index = srcIndexStart + triangle * 3;
+                    for (unsigned k = index; k < index + 3; ++k)
+                    {
+                        unsigned vertexIndex = indexSize == sizeof(unsigned short) ? ((const unsigned short*)indexData)[k] :
+                            ((const unsigned*)indexData)[k];
+                        build->vertices_.Push(transform * *((const Vector3*)(&vertexData[vertexIndex * vertexSize])));
+                        build->indices_.Push(build->vertices_.Size() - 1);
+                    }
+                }
+                return;
+            }
+        }
+
         for (unsigned k = srcVertexStart; k < srcVertexStart + srcVertexCount; ++k)
         {
             Vector3 vertex = transform * *((const Vector3*)(&vertexData[k * vertexSize]));
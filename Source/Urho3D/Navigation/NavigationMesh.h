@@ -326,7 +326,7 @@ namespace Urho3D
         /// Get geometry data within a bounding box.
         void GetTileGeometry(NavBuildData* build, Vector<NavigationGeometryInfo>& geometryList, BoundingBox& box);
         /// Add a triangle mesh to the geometry data.
-        void AddTriMeshGeometry(NavBuildData* build, Geometry* geometry, const Matrix3x4& transform);
+        void AddTriMeshGeometry(NavBuildData* build, Geometry* geometry, const Matrix3x4& transform, const BoundingBox& box);
         /// Build one tile of the navigation mesh. Return true if successful.
         virtual bool BuildTile(Vector<NavigationGeometryInfo>& geometryList, int x, int z);
         /// Build tiles in the rectangular area. Return number of built tiles.
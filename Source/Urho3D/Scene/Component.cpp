@@ -180,12 +180,8 @@ void Component::PrepareNetworkUpdate()
         if (animationEnabled_ && IsAnimatedNetworkAttribute(attr))
             continue;
 
-        OnGetAttribute(attr, networkState_->currentValues_[i]);
-
-        if (networkState_->currentValues_[i] != networkState_->previousValues_[i])
+        if (UpdateNetworkAttribute(attr, i))
         {
-            networkState_->previousValues_[i] = networkState_->currentValues_[i];
-
             // Mark the attribute dirty in all replication states that are tracking this component
             for (PODVector<ReplicationState*>::Iterator j = networkState_->replicationStates_.Begin();
                 j != networkState_->replicationStates_.End(); ++j)
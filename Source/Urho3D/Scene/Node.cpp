@@ -357,6 +357,8 @@ void Node::AddTag(const String& tag)
 
     // Add tag
     impl_->tags_.push_back(tag);
+    impl_->tagHashes_.push_back(StringHash(tag));
+    impl_->tagListIndices_.push_back(M_MAX_UNSIGNED);
 
     // Cache
     if (scene_)
@@ -390,21 +392,23 @@ void Node::AddTags(const StringVector& tags)
 
 bool Node::RemoveTag(const String& tag)
 {
-    bool removed = false;
-    auto foundIt = std::find(impl_->tags_.begin(), impl_->tags_.end(), tag);
-    if (foundIt != impl_->tags_.end()) {
-        impl_->tags_.erase(foundIt);
-        removed = true;
-    }
+    auto foundIt = std::find(impl_->tagHashes_.begin(), impl_->tagHashes_.end(), StringHash(tag));
 
     // Nothing to do
-    if (!removed)
+    if (foundIt == impl_->tagHashes_.end())
         return false;
 
-    // Scene cache update
+    // Scene cache update, while the tag still exists on the node
     if (scene_)
-    {
         scene_->NodeTagRemoved(this, tag);
+
+    unsigned index = (unsigned)(foundIt - impl_->tagHashes_.begin());
+    impl_->tags_.erase(impl_->tags_.begin() + index);
+    impl_->tagHashes_.erase(foundIt);
+    impl_->tagListIndices_.erase(impl_->tagListIndices_.begin() + index);
+
+    if (scene_)
+    {
         // Send event
         using namespace NodeTagRemoved;
         VariantMap& eventData = GetEventDataMap();
@@ -439,6 +443,8 @@ void Node::RemoveAllTags()
     }
 
     impl_->tags_.clear();
+    impl_->tagHashes_.clear();
+    impl_->tagListIndices_.clear();
 
     // Sync
     MarkNetworkUpdate();
@@ -1288,9 +1294,28 @@ PODVector<Node*> Node::GetChildrenWithComponent(StringHash type, bool recursive)
 }
 
 void Node::GetChildrenWithTag(PODVector<Node*>& dest, const String& tag, bool recursive /*= true*/) const
+{
+    GetChildrenWithTag(dest, StringHash(tag), recursive);
+}
+
+void Node::GetChildrenWithTag(PODVector<Node*>& dest, const char* tag, bool recursive /*= true*/) const
+{
+    GetChildrenWithTag(dest, StringHash(tag), recursive);
+}
+
+void Node::GetChildrenWithTag(PODVector<Node*>& dest, StringHash tag, bool recursive /*= true*/) const
 {
     dest.Clear();
 
+    // The scene index covers the whole hierarchy below the scene root, plus the scene itself
+    if (recursive && scene_ == this)
+    {
+        scene_->GetNodesWithTag(dest, tag);
+        if (HasTag(tag))
+            dest.Remove(const_cast<Node*>(this));
+        return;
+    }
+
     if (!recursive)
     {
         for (std::vector<SharedPtr<Node> >::const_iterator i = children_.begin(); i != children_.end(); ++i)
@@ -1388,7 +1413,17 @@ bool Node::IsReplicated() const
 
 bool Node::HasTag(const String& tag) const
 {
-    return std::find(impl_->tags_.begin(), impl_->tags_.end(), tag) != impl_->tags_.end();
+    return HasTag(StringHash(tag));
+}
+
+bool Node::HasTag(const char* tag) const
+{
+    return HasTag(StringHash(tag));
+}
+
+bool Node::HasTag(StringHash tag) const
+{
+    return std::find(impl_->tagHashes_.begin(), impl_->tagHashes_.end(), tag) != impl_->tagHashes_.end();
 }
 
 bool Node::IsChildOf(Node* node) const
@@ -1731,12 +1766,8 @@ void Node::PrepareNetworkUpdate()
         if (animationEnabled_ && IsAnimatedNetworkAttribute(attr))
             continue;
 
-        OnGetAttribute(attr, networkState_->currentValues_[i]);
-
-        if (networkState_->currentValues_[i] != networkState_->previousValues_[i])
+        if (UpdateNetworkAttribute(attr, i))
         {
-            networkState_->previousValues_[i] = networkState_->currentValues_[i];
-
             // Mark the attribute dirty in all replication states that are tracking this node
             for (PODVector<ReplicationState*>::Iterator j = networkState_->replicationStates_.Begin();
                 j != networkState_->replicationStates_.End(); ++j)
@@ -2177,7 +2208,7 @@ void Node::GetComponentsRecursive(PODVector<Component*>& dest, StringHash type)
         (*i)->GetComponentsRecursive(dest, type);
 }
 
-void Node::GetChildrenWithTagRecursive(PODVector<Node*>& dest, const String& tag) const
+void Node::GetChildrenWithTagRecursive(PODVector<Node*>& dest, StringHash tag) const
 {
     for (std::vector<SharedPtr<Node> >::const_iterator i = children_.begin(); i != children_.end(); ++i)
     {
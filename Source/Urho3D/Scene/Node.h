@@ -65,6 +65,10 @@ namespace Urho3D
         String name_;
         /// Tag strings.
         StringVector tags_;
+        /// Tag hashes, in the same order as the tag strings.
+        std::vector<StringHash> tagHashes_;
+        /// Positions in the scene's tagged node lists, in the same order as the tag strings.
+        std::vector<unsigned> tagListIndices_;
         /// Name hash.
         StringHash nameHash_;
         /// Attribute buffer for network updates.
@@ -77,6 +81,7 @@ namespace Urho3D
         URHO3D_OBJECT(Node, Animatable);
 
         friend class Connection;
+        friend class Scene;
 
     public:
         /// Construct.
@@ -377,6 +382,10 @@ namespace Urho3D
 
         /// Return whether has a specific tag.
         bool HasTag(const String& tag) const;
+        /// Return whether has a specific tag.
+        bool HasTag(const char* tag) const;
+        /// Return whether has a specific tag by hash.
+        bool HasTag(StringHash tag) const;
 
         /// Return parent scene node.
         /// @property
@@ -571,6 +580,10 @@ namespace Urho3D
         /// Return child scene nodes with a specific tag.
         void GetChildrenWithTag(PODVector<Node*>& dest, const String& tag, bool recursive = false) const;
         /// Return child scene nodes with a specific tag.
+        void GetChildrenWithTag(PODVector<Node*>& dest, const char* tag, bool recursive = false) const;
+        /// Return child scene nodes with a specific tag hash. Recursive queries from the scene root use the scene's tag index and return the nodes in no particular order; other queries return them in depth-first order.
+        void GetChildrenWithTag(PODVector<Node*>& dest, StringHash tag, bool recursive = false) const;
+        /// Return child scene nodes with a specific tag.
         PODVector<Node*> GetChildrenWithTag(const String& tag, bool recursive = false) const;
 
         /// Return child scene node by index.
@@ -707,7 +720,7 @@ namespace Urho3D
         /// Return child nodes with a specific component recursively.
         void GetChildrenWithComponentRecursive(PODVector<Node*>& dest, StringHash type) const;
         /// Return child nodes with a specific tag recursively.
-        void GetChildrenWithTagRecursive(PODVector<Node*>& dest, const String& tag) const;
+        void GetChildrenWithTagRecursive(PODVector<Node*>& dest, StringHash tag) const;
         /// Return specific components recursively.
         void GetComponentsRecursive(PODVector<Component*>& dest, StringHash type) const;
         /// Clone node recursively.
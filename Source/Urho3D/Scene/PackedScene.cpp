@@ -0,0 +1,925 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+// Copyright (c) 2022 Amer Koleci and Contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+#include "../IO/VectorBuffer.h"
+#include "../Scene/Component.h"
+#include "../Scene/PackedScene.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneResolver.h"
+#include "../Scene/UnknownComponent.h"
+
+#include <cstring>
+#include <map>
+#include <type_traits>
+#include <unordered_map>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+static_assert(sizeof(PackedSceneHeader) == 48, "Unexpected packed scene header size");
+static_assert(sizeof(PackedSceneSchema) == 24, "Unexpected packed scene schema size");
+static_assert(sizeof(PackedSceneColumn) == 16, "Unexpected packed scene column size");
+static_assert(sizeof(PackedSceneNode) == 24, "Unexpected packed scene node size");
+static_assert(sizeof(PackedSceneComponent) == 8, "Unexpected packed scene component size");
+
+/// Size of a blob reference (offset and size) in a column.
+static const unsigned BLOB_REFERENCE_SIZE = 8;
+
+unsigned GetPackedValueSize(VariantType type)
+{
+    switch (type)
+    {
+    case VAR_BOOL:
+        return 1;
+
+    case VAR_INT:
+    case VAR_FLOAT:
+    case VAR_STRING:
+        return 4;
+
+    case VAR_VECTOR2:
+    case VAR_INTVECTOR2:
+    case VAR_DOUBLE:
+    case VAR_INT64:
+    case VAR_RESOURCEREF:
+        return 8;
+
+    case VAR_VECTOR3:
+    case VAR_INTVECTOR3:
+        return 12;
+
+    case VAR_VECTOR4:
+    case VAR_QUATERNION:
+    case VAR_COLOR:
+    case VAR_INTRECT:
+    case VAR_RECT:
+        return 16;
+
+    case VAR_MATRIX3:
+        return sizeof(Matrix3);
+
+    case VAR_MATRIX3X4:
+        return sizeof(Matrix3x4);
+
+    case VAR_MATRIX4:
+        return sizeof(Matrix4);
+
+    default:
+        return 0;
+    }
+}
+
+/// Return column stride for an attribute type.
+static unsigned GetColumnStride(VariantType type)
+{
+    unsigned size = GetPackedValueSize(type);
+    return size ? size : BLOB_REFERENCE_SIZE;
+}
+
+/// Read a POD value from possibly unaligned memory.
+template <class T> static T ReadValue(const unsigned char* src)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "ReadValue requires a trivially copyable type");
+    T ret;
+    memcpy(&ret, src, sizeof(T));
+    return ret;
+}
+
+/// Read a value that is not trivially copyable from possibly unaligned memory through its float array constructor.
+template <class T> static T ReadFloatValue(const unsigned char* src)
+{
+    float data[sizeof(T) / sizeof(float)];
+    memcpy(data, src, sizeof data);
+    return T(data);
+}
+
+/// Return whether a plain data member of an attribute type can be copied from a column with memcpy.
+static bool IsDirectCopyType(VariantType type)
+{
+    switch (type)
+    {
+    case VAR_BOOL:
+    case VAR_INT:
+    case VAR_FLOAT:
+    case VAR_VECTOR2:
+    case VAR_VECTOR3:
+    case VAR_VECTOR4:
+    case VAR_INTVECTOR2:
+    case VAR_INTVECTOR3:
+    case VAR_COLOR:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+/// Pad a buffer to a 4-byte boundary.
+static void AlignBuffer(VectorBuffer& buffer)
+{
+    while (buffer.GetPosition() & 3u)
+        buffer.WriteUByte(0);
+}
+
+/// Serializable object type and attribute layout collected for saving.
+struct PackedSchemaBuilder
+{
+    /// Object type.
+    StringHash type_;
+    /// Object type name.
+    String typeName_;
+    /// Attribute descriptions shared by all rows.
+    const std::vector<AttributeInfo>* attributes_;
+    /// Indices of the serialized attributes.
+    std::vector<unsigned> attributeIndices_;
+    /// Objects, one per row.
+    std::vector<const Serializable*> rows_;
+    /// Object IDs, one per row.
+    std::vector<unsigned> ids_;
+    /// Opaque flag: rows are stored using the object's own binary serialization.
+    bool opaque_;
+};
+
+/// Packed scene writer.
+class PackedSceneWriter
+{
+public:
+    /// Write the node hierarchy. Return true if successful.
+    bool Write(const Node* root, Serializer& dest);
+
+private:
+    /// Add a string to the string table and return its index.
+    unsigned AddString(const String& str);
+    /// Return the schema row for an object, creating the schema as necessary.
+    PackedSceneComponent AddObject(const Serializable* object, unsigned id, bool opaque);
+    /// Collect a node and its persistent components and children.
+    void CollectNode(const Node* node, unsigned parentIndex);
+    /// Append a single attribute value to a column.
+    void WriteValue(VectorBuffer& column, VariantType type, const Variant& value);
+    /// Append variable-size data to the blob and write its reference to a column.
+    void WriteBlobReference(VectorBuffer& column, const void* data, unsigned size);
+
+    /// String table.
+    std::vector<String> strings_;
+    /// String table lookup.
+    std::unordered_map<String, unsigned> stringIndices_;
+    /// Schemas.
+    std::vector<PackedSchemaBuilder> schemas_;
+    /// Schema lookup by type and attribute description pointer.
+    std::map<std::pair<unsigned, const void*>, unsigned> schemaIndices_;
+    /// Node table.
+    std::vector<PackedSceneNode> nodes_;
+    /// Component reference table.
+    std::vector<PackedSceneComponent> components_;
+    /// Variable-size value blob.
+    VectorBuffer blob_;
+};
+
+unsigned PackedSceneWriter::AddString(const String& str)
+{
+    auto i = stringIndices_.find(str);
+    if (i != stringIndices_.end())
+        return i->second;
+
+    unsigned index = (unsigned)strings_.size();
+    strings_.push_back(str);
+    stringIndices_[str] = index;
+    return index;
+}
+
+PackedSceneComponent PackedSceneWriter::AddObject(const Serializable* object, unsigned id, bool opaque)
+{
+    const std::vector<AttributeInfo>* attributes = object->GetAttributes();
+    std::pair<unsigned, const void*> key(object->GetType().Value(), attributes);
+
+    unsigned schemaIndex;
+    auto i = schemaIndices_.find(key);
+    if (i != schemaIndices_.end())
+        schemaIndex = i->second;
+    else
+    {
+        schemaIndex = (unsigned)schemas_.size();
+        schemaIndices_[key] = schemaIndex;
+
+        PackedSchemaBuilder schema;
+        schema.type_ = object->GetType();
+        schema.typeName_ = object->GetTypeName();
+        schema.attributes_ = attributes;
+        schema.opaque_ = opaque;
+        if (attributes && !opaque)
+        {
+            for (unsigned j = 0; j < attributes->size(); ++j)
+            {
+                const AttributeInfo& attr = attributes->at(j);
+                if (!(attr.mode_ & AM_FILE) || (attr.mode_ & AM_FILEREADONLY) == AM_FILEREADONLY)
+                    continue;
+                if (attr.type_ == VAR_VOIDPTR || attr.type_ == VAR_PTR)
+                    continue;
+                schema.attributeIndices_.push_back(j);
+            }
+        }
+        schemas_.push_back(schema);
+    }
+
+    PackedSchemaBuilder& schema = schemas_[schemaIndex];
+    PackedSceneComponent ret;
+    ret.schema_ = schemaIndex;
+    ret.row_ = (unsigned)schema.rows_.size();
+    schema.rows_.push_back(object);
+    schema.ids_.push_back(id);
+    return ret;
+}
+
+void PackedSceneWriter::CollectNode(const Node* node, unsigned parentIndex)
+{
+    unsigned nodeIndex = (unsigned)nodes_.size();
+    PackedSceneComponent nodeRow = AddObject(node, node->GetID(), false);
+
+    PackedSceneNode entry;
+    entry.id_ = node->GetID();
+    entry.parent_ = parentIndex;
+    entry.schema_ = nodeRow.schema_;
+    entry.row_ = nodeRow.row_;
+    entry.firstComponent_ = (unsigned)components_.size();
+    entry.numComponents_ = 0;
+
+    const std::vector<SharedPtr<Component> >& components = node->GetComponents();
+    for (unsigned i = 0; i < components.size(); ++i)
+    {
+        Component* component = components[i];
+        if (component->IsTemporary())
+            continue;
+
+        // Unknown components have per-instance attribute descriptions, so store their own binary serialization instead
+        bool opaque = dynamic_cast<const UnknownComponent*>(component) != nullptr;
+        components_.push_back(AddObject(component, component->GetID(), opaque));
+        ++entry.numComponents_;
+    }
+
+    nodes_.push_back(entry);
+
+    const std::vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (unsigned i = 0; i < children.size(); ++i)
+    {
+        if (!children[i]->IsTemporary())
+            CollectNode(children[i], nodeIndex);
+    }
+}
+
+void PackedSceneWriter::WriteBlobReference(VectorBuffer& column, const void* data, unsigned size)
+{
+    column.WriteUInt(blob_.GetPosition());
+    column.WriteUInt(size);
+    if (size)
+        blob_.Write(data, size);
+}
+
+void PackedSceneWriter::WriteValue(VectorBuffer& column, VariantType type, const Variant& value)
+{
+    switch (type)
+    {
+    case VAR_BOOL:
+        column.WriteBool(value.GetBool());
+        break;
+
+    case VAR_STRING:
+        column.WriteUInt(AddString(value.GetString()));
+        break;
+
+    case VAR_RESOURCEREF:
+        {
+            const ResourceRef& ref = value.GetResourceRef();
+            column.WriteStringHash(ref.type_);
+            column.WriteUInt(AddString(ref.name_));
+        }
+        break;
+
+    case VAR_BUFFER:
+        {
+            const PODVector<unsigned char>& buffer = value.GetBuffer();
+            WriteBlobReference(column, buffer.Empty() ? nullptr : &buffer[0], buffer.Size());
+        }
+        break;
+
+    case VAR_RESOURCEREFLIST:
+        {
+            const ResourceRefList& refList = value.GetResourceRefList();
+            VectorBuffer data;
+            data.WriteStringHash(refList.type_);
+            data.WriteUInt((unsigned)refList.names_.size());
+            for (unsigned i = 0; i < refList.names_.size(); ++i)
+                data.WriteUInt(AddString(refList.names_[i]));
+            WriteBlobReference(column, data.GetData(), data.GetSize());
+        }
+        break;
+
+    case VAR_STRINGVECTOR:
+        {
+            const StringVector& strings = value.GetStringVector();
+            VectorBuffer data;
+            data.WriteUInt((unsigned)strings.size());
+            for (unsigned i = 0; i < strings.size(); ++i)
+                data.WriteUInt(AddString(strings[i]));
+            WriteBlobReference(column, data.GetData(), data.GetSize());
+        }
+        break;
+
+    case VAR_INT: column.WriteInt(value.GetInt()); break;
+    case VAR_FLOAT: column.WriteFloat(value.GetFloat()); break;
+    case VAR_VECTOR2: column.WriteVector2(value.GetVector2()); break;
+    case VAR_INTVECTOR2: column.WriteIntVector2(value.GetIntVector2()); break;
+    case VAR_DOUBLE: column.WriteDouble(value.GetDouble()); break;
+    case VAR_INT64: column.WriteInt64(value.GetInt64()); break;
+    case VAR_VECTOR3: column.WriteVector3(value.GetVector3()); break;
+    case VAR_INTVECTOR3: column.WriteIntVector3(value.GetIntVector3()); break;
+    case VAR_VECTOR4: column.WriteVector4(value.GetVector4()); break;
+    case VAR_QUATERNION: column.WriteQuaternion(value.GetQuaternion()); break;
+    case VAR_COLOR: column.WriteColor(value.GetColor()); break;
+    case VAR_INTRECT: column.WriteIntRect(value.GetIntRect()); break;
+    case VAR_RECT: column.WriteRect(value.GetRect()); break;
+    case VAR_MATRIX3: column.WriteMatrix3(value.GetMatrix3()); break;
+    case VAR_MATRIX3X4: column.WriteMatrix3x4(value.GetMatrix3x4()); break;
+    case VAR_MATRIX4: column.WriteMatrix4(value.GetMatrix4()); break;
+
+    default:
+        {
+            // Any other variable-size type uses the regular binary variant serialization
+            VectorBuffer data;
+            data.WriteVariantData(value);
+            WriteBlobReference(column, data.GetData(), data.GetSize());
+        }
+        break;
+    }
+}
+
+bool PackedSceneWriter::Write(const Node* root, Serializer& dest)
+{
+    CollectNode(root, PACKED_SCENE_NONE);
+
+    // Encode the attribute columns of every schema. This also fills the string table and the blob
+    std::vector<std::vector<VectorBuffer> > columnData(schemas_.size());
+    std::vector<VectorBuffer> opaqueData(schemas_.size());
+    Variant value;
+
+    for (unsigned i = 0; i < schemas_.size(); ++i)
+    {
+        const PackedSchemaBuilder& schema = schemas_[i];
+        AddString(schema.typeName_);
+
+        if (schema.opaque_)
+        {
+            for (unsigned j = 0; j < schema.rows_.size(); ++j)
+            {
+                VectorBuffer objectData;
+                if (!schema.rows_[j]->Save(objectData))
+                    return false;
+                // Skip the type hash and ID written by Component::Save, as they are in the schema already
+                unsigned size = objectData.GetSize() > 8 ? objectData.GetSize() - 8 : 0;
+                WriteBlobReference(opaqueData[i], size ? objectData.GetData() + 8 : nullptr, size);
+            }
+            continue;
+        }
+
+        columnData[i].resize(schema.attributeIndices_.size());
+        for (unsigned k = 0; k < schema.attributeIndices_.size(); ++k)
+        {
+            const AttributeInfo& attr = schema.attributes_->at(schema.attributeIndices_[k]);
+            AddString(attr.name_);
+
+            VectorBuffer& column = columnData[i][k];
+
+            // Plain data members of trivially copyable types are written as they are, like the reader copies them back
+            unsigned stride = GetColumnStride(attr.type_);
+            if (attr.memberSize_ == stride && IsDirectCopyType(attr.type_))
+            {
+                for (unsigned j = 0; j < schema.rows_.size(); ++j)
+                {
+                    const void* src = attr.accessor_->GetMemberAddress(schema.rows_[j]);
+                    if (attr.type_ == VAR_BOOL)
+                        column.WriteBool(*static_cast<const bool*>(src));
+                    else
+                        column.Write(src, stride);
+                }
+                continue;
+            }
+
+            for (unsigned j = 0; j < schema.rows_.size(); ++j)
+            {
+                schema.rows_[j]->OnGetAttribute(attr, value);
+                WriteValue(column, attr.type_, value);
+            }
+        }
+    }
+
+    VectorBuffer out;
+    PackedSceneHeader header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.id_, PACKED_SCENE_ID, 4);
+    header.version_ = PACKED_SCENE_VERSION;
+    header.numStrings_ = (unsigned)strings_.size();
+    header.numSchemas_ = (unsigned)schemas_.size();
+    header.numNodes_ = (unsigned)nodes_.size();
+    header.numComponents_ = (unsigned)components_.size();
+    out.Write(&header, sizeof header);
+
+    // String table: offsets relative to the character data, one extra entry for the end
+    header.stringsOffset_ = out.GetPosition();
+    unsigned charOffset = 0;
+    for (unsigned i = 0; i < strings_.size(); ++i)
+    {
+        out.WriteUInt(charOffset);
+        charOffset += strings_[i].Length() + 1;
+    }
+    out.WriteUInt(charOffset);
+    for (unsigned i = 0; i < strings_.size(); ++i)
+        out.Write(strings_[i].CString(), strings_[i].Length() + 1);
+    AlignBuffer(out);
+
+    // Schema table is patched after the per-schema data has been placed
+    header.schemasOffset_ = out.GetPosition();
+    std::vector<PackedSceneSchema> schemaEntries(schemas_.size());
+    if (!schemaEntries.empty())
+        out.Write(&schemaEntries[0], (unsigned)(schemaEntries.size() * sizeof(PackedSceneSchema)));
+
+    for (unsigned i = 0; i < schemas_.size(); ++i)
+    {
+        const PackedSchemaBuilder& schema = schemas_[i];
+        PackedSceneSchema& entry = schemaEntries[i];
+        entry.type_ = schema.type_.Value();
+        entry.typeName_ = AddString(schema.typeName_);
+        entry.numRows_ = (unsigned)schema.rows_.size();
+
+        entry.idsOffset_ = out.GetPosition();
+        if (!schema.ids_.empty())
+            out.Write(&schema.ids_[0], (unsigned)(schema.ids_.size() * sizeof(unsigned)));
+
+        if (schema.opaque_)
+        {
+            entry.numColumns_ = PACKED_SCENE_NONE;
+            entry.columnsOffset_ = out.GetPosition();
+            out.Write(opaqueData[i].GetData(), opaqueData[i].GetSize());
+            continue;
+        }
+
+        entry.numColumns_ = (unsigned)schema.attributeIndices_.size();
+        entry.columnsOffset_ = out.GetPosition();
+
+        // Column descriptors first, then the tightly packed column data
+        unsigned dataOffset = entry.columnsOffset_ + entry.numColumns_ * (unsigned)sizeof(PackedSceneColumn);
+        for (unsigned k = 0; k < schema.attributeIndices_.size(); ++k)
+        {
+            const AttributeInfo& attr = schema.attributes_->at(schema.attributeIndices_[k]);
+            PackedSceneColumn column;
+            column.name_ = AddString(attr.name_);
+            column.type_ = attr.type_;
+            column.dataOffset_ = dataOffset;
+            column.stride_ = GetColumnStride(attr.type_);
+            out.Write(&column, sizeof column);
+
+            dataOffset += (columnData[i][k].GetSize() + 3u) & ~3u;
+        }
+        for (unsigned k = 0; k < columnData[i].size(); ++k)
+        {
+            out.Write(columnData[i][k].GetData(), columnData[i][k].GetSize());
+            AlignBuffer(out);
+        }
+    }
+
+    header.nodesOffset_ = out.GetPosition();
+    if (!nodes_.empty())
+        out.Write(&nodes_[0], (unsigned)(nodes_.size() * sizeof(PackedSceneNode)));
+
+    header.componentsOffset_ = out.GetPosition();
+    if (!components_.empty())
+        out.Write(&components_[0], (unsigned)(components_.size() * sizeof(PackedSceneComponent)));
+
+    header.blobOffset_ = out.GetPosition();
+    header.blobSize_ = blob_.GetSize();
+    out.Write(blob_.GetData(), blob_.GetSize());
+
+    // Patch the header and the schema table
+    out.Seek(0);
+    out.Write(&header, sizeof header);
+    out.Seek(header.schemasOffset_);
+    if (!schemaEntries.empty())
+        out.Write(&schemaEntries[0], (unsigned)(schemaEntries.size() * sizeof(PackedSceneSchema)));
+
+    return dest.Write(out.GetData(), out.GetSize()) == out.GetSize();
+}
+
+/// Packed scene reader operating directly on the (typically memory mapped) file data.
+class PackedSceneReader
+{
+public:
+    /// Construct with data.
+    PackedSceneReader(const unsigned char* data, unsigned size) :
+        data_(data),
+        size_(size)
+    {
+    }
+
+    /// Read into a root node. Return true if successful.
+    bool Read(Node* root, SceneResolver& resolver);
+
+private:
+    /// Return whether a byte range is within the data.
+    bool CheckRange(unsigned offset, unsigned long long size) const { return (unsigned long long)offset + size <= size_; }
+    /// Return a POD structure at offset. The range must have been checked.
+    template <class T> T ReadAt(unsigned offset) const { return ReadValue<T>(data_ + offset); }
+    /// Return string by index, or empty if out of range.
+    const String& GetString(unsigned index) const { return index < strings_.size() ? strings_[index] : String::EMPTY; }
+    /// Decode one value of a column.
+    void DecodeValue(VariantType type, const unsigned char* src, Variant& dest) const;
+    /// Apply the attribute columns of a schema to its already created objects.
+    void ApplySchema(unsigned schemaIndex);
+
+    /// Data.
+    const unsigned char* data_;
+    /// Data size.
+    unsigned size_;
+    /// Header.
+    PackedSceneHeader header_;
+    /// Decoded string table.
+    std::vector<String> strings_;
+    /// Schemas.
+    std::vector<PackedSceneSchema> schemas_;
+    /// Created objects per schema row.
+    std::vector<std::vector<Serializable*> > objects_;
+};
+
+void PackedSceneReader::DecodeValue(VariantType type, const unsigned char* src, Variant& dest) const
+{
+    switch (type)
+    {
+    case VAR_BOOL: dest = *src != 0; break;
+    case VAR_INT: dest = ReadValue<int>(src); break;
+    case VAR_FLOAT: dest = ReadValue<float>(src); break;
+    case VAR_VECTOR2: dest = ReadValue<Vector2>(src); break;
+    case VAR_INTVECTOR2: dest = ReadValue<IntVector2>(src); break;
+    case VAR_DOUBLE: dest = ReadValue<double>(src); break;
+    case VAR_INT64: dest = ReadValue<long long>(src); break;
+    case VAR_VECTOR3: dest = ReadValue<Vector3>(src); break;
+    case VAR_INTVECTOR3: dest = ReadValue<IntVector3>(src); break;
+    case VAR_VECTOR4: dest = ReadValue<Vector4>(src); break;
+    case VAR_QUATERNION: dest = ReadFloatValue<Quaternion>(src); break;
+    case VAR_COLOR: dest = ReadValue<Color>(src); break;
+    case VAR_INTRECT: dest = ReadValue<IntRect>(src); break;
+    case VAR_RECT: dest = ReadValue<Rect>(src); break;
+    case VAR_MATRIX3: dest = ReadValue<Matrix3>(src); break;
+    case VAR_MATRIX3X4: dest = ReadValue<Matrix3x4>(src); break;
+    case VAR_MATRIX4: dest = ReadFloatValue<Matrix4>(src); break;
+    case VAR_STRING: dest = GetString(ReadValue<unsigned>(src)); break;
+
+    case VAR_RESOURCEREF:
+        dest = ResourceRef(StringHash(ReadValue<unsigned>(src)), GetString(ReadValue<unsigned>(src + 4)));
+        break;
+
+    default:
+        {
+            unsigned offset = ReadValue<unsigned>(src);
+            unsigned size = ReadValue<unsigned>(src + 4);
+            if ((unsigned long long)offset + size > header_.blobSize_)
+            {
+                URHO3D_LOGERROR("Packed scene value out of range");
+                dest = Variant(type, String::EMPTY);
+                return;
+            }
+
+            MemoryBuffer blob(data_ + header_.blobOffset_ + offset, size);
+            if (type == VAR_BUFFER)
+            {
+                PODVector<unsigned char> buffer(size);
+                if (size)
+                    blob.Read(&buffer[0], size);
+                dest = buffer;
+            }
+            else if (type == VAR_RESOURCEREFLIST)
+            {
+                ResourceRefList refList(blob.ReadStringHash());
+                unsigned count = blob.ReadUInt();
+                refList.names_.resize(Min(count, size / 4));
+                for (unsigned i = 0; i < refList.names_.size(); ++i)
+                    refList.names_[i] = GetString(blob.ReadUInt());
+                dest = refList;
+            }
+            else if (type == VAR_STRINGVECTOR)
+            {
+                unsigned count = blob.ReadUInt();
+                StringVector strings(Min(count, size / 4));
+                for (unsigned i = 0; i < strings.size(); ++i)
+                    strings[i] = GetString(blob.ReadUInt());
+                dest = strings;
+            }
+            else
+                dest = blob.ReadVariant(type);
+        }
+        break;
+    }
+}
+
+void PackedSceneReader::ApplySchema(unsigned schemaIndex)
+{
+    const PackedSceneSchema& schema = schemas_[schemaIndex];
+    const std::vector<Serializable*>& objects = objects_[schemaIndex];
+    if (!schema.numColumns_ || schema.numColumns_ == PACKED_SCENE_NONE || objects.empty())
+        return;
+
+    // All rows of a schema share the attribute descriptions, so resolve the columns only once
+    const Serializable* first = nullptr;
+    for (unsigned i = 0; i < objects.size() && !first; ++i)
+        first = objects[i];
+    if (!first)
+        return;
+    const std::vector<AttributeInfo>* attributes = first->GetAttributes();
+    if (!attributes)
+        return;
+
+    for (unsigned i = 0; i < objects.size(); ++i)
+    {
+        if (objects[i])
+            objects[i]->OnBeginBulkLoad();
+    }
+
+    Variant value;
+    unsigned attrStart = 0;
+    for (unsigned k = 0; k < schema.numColumns_; ++k)
+    {
+        auto column = ReadAt<PackedSceneColumn>(schema.columnsOffset_ + k * (unsigned)sizeof(PackedSceneColumn));
+        const String& name = GetString(column.name_);
+        auto type = (VariantType)column.type_;
+
+        // Attributes are normally in the same order as when saved, so start the search after the previous match
+        const AttributeInfo* attr = nullptr;
+        for (unsigned j = 0; j < attributes->size(); ++j)
+        {
+            unsigned index = (attrStart + j) % attributes->size();
+            const AttributeInfo& candidate = attributes->at(index);
+            if ((candidate.mode_ & AM_FILE) && candidate.name_ == name)
+            {
+                attr = &candidate;
+                attrStart = index + 1;
+                break;
+            }
+        }
+
+        if (!attr)
+        {
+            URHO3D_LOGWARNING("Unknown attribute " + name + " in packed scene data");
+            continue;
+        }
+        if (attr->type_ != type || column.stride_ != GetColumnStride(type) ||
+            !CheckRange(column.dataOffset_, (unsigned long long)column.stride_ * schema.numRows_))
+        {
+            URHO3D_LOGWARNING("Mismatching or corrupt attribute " + name + " in packed scene data, skipping");
+            continue;
+        }
+
+        const unsigned char* src = data_ + column.dataOffset_;
+
+        // Plain data members of trivially copyable types use the same layout as the column, so copy the packed values
+        // straight into the objects. Other attributes go through a Variant
+        if (attr->memberSize_ == column.stride_ && IsDirectCopyType(type))
+        {
+            for (unsigned i = 0; i < objects.size(); ++i, src += column.stride_)
+            {
+                if (!objects[i])
+                    continue;
+                void* dest = const_cast<void*>(attr->accessor_->GetMemberAddress(objects[i]));
+                if (type == VAR_BOOL)
+                    *static_cast<bool*>(dest) = *src != 0;
+                else
+                    memcpy(dest, src, column.stride_);
+            }
+            continue;
+        }
+
+        for (unsigned i = 0; i < objects.size(); ++i, src += column.stride_)
+        {
+            if (!objects[i])
+                continue;
+            DecodeValue(type, src, value);
+            objects[i]->OnSetAttribute(*attr, value);
+        }
+    }
+
+    for (unsigned i = 0; i < objects.size(); ++i)
+    {
+        if (objects[i])
+            objects[i]->OnEndBulkLoad();
+    }
+}
+
+bool PackedSceneReader::Read(Node* root, SceneResolver& resolver)
+{
+    if (!CheckRange(0, sizeof(PackedSceneHeader)))
+    {
+        URHO3D_LOGERROR("Packed scene data is truncated");
+        return false;
+    }
+
+    header_ = ReadAt<PackedSceneHeader>(0);
+    if (memcmp(header_.id_, PACKED_SCENE_ID, 4) != 0)
+    {
+        URHO3D_LOGERROR("Not a packed scene file");
+        return false;
+    }
+    if (header_.version_ > PACKED_SCENE_VERSION)
+    {
+        URHO3D_LOGERROR("Unsupported packed scene version " + String(header_.version_));
+        return false;
+    }
+    if (!header_.numNodes_ ||
+        !CheckRange(header_.stringsOffset_, (header_.numStrings_ + 1ull) * 4) ||
+        !CheckRange(header_.schemasOffset_, (unsigned long long)header_.numSchemas_ * sizeof(PackedSceneSchema)) ||
+        !CheckRange(header_.nodesOffset_, (unsigned long long)header_.numNodes_ * sizeof(PackedSceneNode)) ||
+        !CheckRange(header_.componentsOffset_, (unsigned long long)header_.numComponents_ * sizeof(PackedSceneComponent)) ||
+        !CheckRange(header_.blobOffset_, header_.blobSize_))
+    {
+        URHO3D_LOGERROR("Packed scene data is corrupt");
+        return false;
+    }
+
+    // Decode the string table
+    {
+        unsigned charsOffset = header_.stringsOffset_ + (header_.numStrings_ + 1) * 4;
+        strings_.resize(header_.numStrings_);
+        for (unsigned i = 0; i < header_.numStrings_; ++i)
+        {
+            unsigned start = ReadAt<unsigned>(header_.stringsOffset_ + i * 4);
+            unsigned end = ReadAt<unsigned>(header_.stringsOffset_ + (i + 1) * 4);
+            if (end <= start || !CheckRange(charsOffset + start, end - start))
+            {
+                URHO3D_LOGERROR("Packed scene string table is corrupt");
+                return false;
+            }
+            strings_[i] = String(reinterpret_cast<const char*>(data_ + charsOffset + start), end - start - 1);
+        }
+    }
+
+    schemas_.resize(header_.numSchemas_);
+    objects_.resize(header_.numSchemas_);
+    for (unsigned i = 0; i < header_.numSchemas_; ++i)
+    {
+        PackedSceneSchema& schema = schemas_[i];
+        schema = ReadAt<PackedSceneSchema>(header_.schemasOffset_ + i * (unsigned)sizeof(PackedSceneSchema));
+        unsigned long long columnsSize = schema.numColumns_ != PACKED_SCENE_NONE ?
+            (unsigned long long)schema.numColumns_ * sizeof(PackedSceneColumn) : (unsigned long long)schema.numRows_ * BLOB_REFERENCE_SIZE;
+        if (!CheckRange(schema.idsOffset_, (unsigned long long)schema.numRows_ * 4) || !CheckRange(schema.columnsOffset_, columnsSize))
+        {
+            URHO3D_LOGERROR("Packed scene schema table is corrupt");
+            return false;
+        }
+        objects_[i].resize(schema.numRows_, nullptr);
+    }
+
+    Context* context = root->GetContext();
+    std::vector<Node*> nodes(header_.numNodes_, nullptr);
+    std::vector<bool> nodeSchemas(header_.numSchemas_, false);
+
+    // Create the node hierarchy first. Parents always precede their children
+    for (unsigned i = 0; i < header_.numNodes_; ++i)
+    {
+        auto entry = ReadAt<PackedSceneNode>(header_.nodesOffset_ + i * (unsigned)sizeof(PackedSceneNode));
+        if (entry.schema_ >= header_.numSchemas_ || entry.row_ >= schemas_[entry.schema_].numRows_ ||
+            (unsigned long long)entry.firstComponent_ + entry.numComponents_ > header_.numComponents_ ||
+            (i && entry.parent_ >= i))
+        {
+            URHO3D_LOGERROR("Packed scene node table is corrupt");
+            return false;
+        }
+
+        Node* node;
+        if (!i)
+            node = root;
+        else
+            node = nodes[entry.parent_]->CreateChild(entry.id_, Scene::IsReplicatedID(entry.id_) ? REPLICATED : LOCAL);
+
+        nodes[i] = node;
+        objects_[entry.schema_][entry.row_] = node;
+        nodeSchemas[entry.schema_] = true;
+        resolver.AddNode(entry.id_, node);
+    }
+
+    // Apply node attributes before components exist, as in regular scene loading
+    for (unsigned i = 0; i < header_.numSchemas_; ++i)
+    {
+        if (nodeSchemas[i])
+            ApplySchema(i);
+    }
+
+    // Create components in node order, as component order within a node is significant
+    for (unsigned i = 0; i < header_.numNodes_; ++i)
+    {
+        auto entry = ReadAt<PackedSceneNode>(header_.nodesOffset_ + i * (unsigned)sizeof(PackedSceneNode));
+        Node* node = nodes[i];
+
+        for (unsigned j = 0; j < entry.numComponents_; ++j)
+        {
+            auto ref = ReadAt<PackedSceneComponent>(header_.componentsOffset_ + (entry.firstComponent_ + j) *
+                (unsigned)sizeof(PackedSceneComponent));
+            if (ref.schema_ >= header_.numSchemas_ || ref.row_ >= schemas_[ref.schema_].numRows_ || nodeSchemas[ref.schema_])
+            {
+                URHO3D_LOGERROR("Packed scene component table is corrupt");
+                return false;
+            }
+
+            const PackedSceneSchema& schema = schemas_[ref.schema_];
+            unsigned compID = ReadAt<unsigned>(schema.idsOffset_ + ref.row_ * 4);
+            CreateMode mode = Scene::IsReplicatedID(compID) && node->IsReplicated() ? REPLICATED : LOCAL;
+            StringHash compType(schema.type_);
+
+            Component* component;
+            bool placeholder = false;
+            if (!context->GetTypeName(compType).Empty())
+                component = node->CreateComponent(compType, mode, compID);
+            else
+            {
+                URHO3D_LOGWARNING("Component type " + GetString(schema.typeName_) + " not known, creating UnknownComponent as placeholder");
+                SharedPtr<UnknownComponent> unknown(new UnknownComponent(context));
+                const String& typeName = GetString(schema.typeName_);
+                if (typeName.Empty() || typeName.StartsWith("Unknown", false))
+                    unknown->SetType(compType);
+                else
+                    unknown->SetTypeName(typeName);
+                node->AddComponent(unknown, compID, mode);
+                component = unknown;
+                placeholder = true;
+            }
+
+            if (!component)
+                continue;
+
+            resolver.AddComponent(compID, component);
+
+            if (schema.numColumns_ == PACKED_SCENE_NONE)
+            {
+                // Opaque row: the component's own binary serialization is stored in the blob
+                unsigned offset = ReadAt<unsigned>(schema.columnsOffset_ + ref.row_ * BLOB_REFERENCE_SIZE);
+                unsigned size = ReadAt<unsigned>(schema.columnsOffset_ + ref.row_ * BLOB_REFERENCE_SIZE + 4);
+                if ((unsigned long long)offset + size <= header_.blobSize_)
+                {
+                    MemoryBuffer buffer(data_ + header_.blobOffset_ + offset, size);
+                    component->Load(buffer);
+                }
+            }
+            else if (!placeholder)
+                objects_[ref.schema_][ref.row_] = component;
+        }
+    }
+
+    // Then set component attributes column by column, one component type at a time
+    for (unsigned i = 0; i < header_.numSchemas_; ++i)
+    {
+        if (!nodeSchemas[i])
+            ApplySchema(i);
+    }
+
+    return true;
+}
+
+bool SavePackedScene(const Node* root, Serializer& dest)
+{
+    if (!root)
+        return false;
+
+    PackedSceneWriter writer;
+    return writer.Write(root, dest);
+}
+
+bool LoadPackedScene(Node* root, const unsigned char* data, unsigned size, SceneResolver& resolver)
+{
+    if (!root || !data)
+        return false;
+
+    PackedSceneReader reader(data, size);
+    return reader.Read(root, resolver);
+}
+
+}
@@ -0,0 +1,133 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+// Copyright (c) 2022 Amer Koleci and Contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Core/Variant.h"
+
+namespace Urho3D
+{
+    class Node;
+    class SceneResolver;
+    class Serializer;
+
+    /// Packed binary scene file identifier.
+    static const char* PACKED_SCENE_ID = "UPSC";
+    /// Current packed binary scene format version.
+    static constexpr unsigned PACKED_SCENE_VERSION = 1;
+    /// Index value used for "no node" or "no string" in packed scene tables.
+    static constexpr unsigned PACKED_SCENE_NONE = 0xffffffff;
+
+    /// Packed scene file header. All offsets are from the start of the file. The file is little-endian and every section starts on a 4-byte boundary.
+    struct PackedSceneHeader
+    {
+        /// File identifier, "UPSC".
+        char id_[4];
+        /// Format version.
+        unsigned version_;
+        /// Number of strings in the string table.
+        unsigned numStrings_;
+        /// Number of attribute schemas.
+        unsigned numSchemas_;
+        /// Number of nodes, including the root.
+        unsigned numNodes_;
+        /// Number of component references.
+        unsigned numComponents_;
+        /// Offset of the string offset table, followed by the null-terminated string characters.
+        unsigned stringsOffset_;
+        /// Offset of the schema table.
+        unsigned schemasOffset_;
+        /// Offset of the node table.
+        unsigned nodesOffset_;
+        /// Offset of the component reference table.
+        unsigned componentsOffset_;
+        /// Offset of the variable-size value blob.
+        unsigned blobOffset_;
+        /// Size of the variable-size value blob.
+        unsigned blobSize_;
+    };
+
+    /// Packed scene attribute schema: one per serialized object type, holding one row per object instance.
+    struct PackedSceneSchema
+    {
+        /// Object type hash.
+        unsigned type_;
+        /// Object type name string index.
+        unsigned typeName_;
+        /// Number of object rows.
+        unsigned numRows_;
+        /// Offset of the per-row object ID array.
+        unsigned idsOffset_;
+        /// Number of attribute columns, or PACKED_SCENE_NONE for opaque schemas.
+        unsigned numColumns_;
+        /// Offset of the column descriptor array. For opaque schemas, offset of a per-row (blob offset, size) array holding the object's own binary serialization.
+        unsigned columnsOffset_;
+    };
+
+    /// Packed scene attribute column: the values of one attribute for all rows of a schema, tightly packed.
+    struct PackedSceneColumn
+    {
+        /// Attribute name string index.
+        unsigned name_;
+        /// Attribute variant type.
+        unsigned type_;
+        /// Offset of the value data.
+        unsigned dataOffset_;
+        /// Size of one value in bytes.
+        unsigned stride_;
+    };
+
+    /// Packed scene node entry. Nodes are stored in depth-first order so that parents precede their children; the first node is the root.
+    struct PackedSceneNode
+    {
+        /// Node ID.
+        unsigned id_;
+        /// Parent node index, or PACKED_SCENE_NONE for the root.
+        unsigned parent_;
+        /// Schema index of the node attributes.
+        unsigned schema_;
+        /// Row within the schema.
+        unsigned row_;
+        /// Index of the first component reference.
+        unsigned firstComponent_;
+        /// Number of component references.
+        unsigned numComponents_;
+    };
+
+    /// Packed scene component reference, in node component order.
+    struct PackedSceneComponent
+    {
+        /// Schema index.
+        unsigned schema_;
+        /// Row within the schema.
+        unsigned row_;
+    };
+
+    /// Return packed size of a fixed-size attribute value type, or zero if the type is stored in the variable-size blob. Strings and resource references are stored as string table indices.
+    URHO3D_API unsigned GetPackedValueSize(VariantType type);
+
+    /// Write a node hierarchy in the packed binary scene format. Return true if successful.
+    URHO3D_API bool SavePackedScene(const Node* root, Serializer& dest);
+    /// Load a node hierarchy from packed binary scene data into an existing root node. The data must stay valid during the call only. Return true if successful.
+    URHO3D_API bool LoadPackedScene(Node* root, const unsigned char* data, unsigned size, SceneResolver& resolver);
+}
@@ -0,0 +1,386 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+// Copyright (c) 2022 Amer Koleci and Contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Core/Profiler.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+#include "../Resource/JSONFile.h"
+#include "../Resource/ResourceCache.h"
+#include "../Resource/XMLFile.h"
+#include "../Scene/ObjectAnimation.h"
+#include "../Scene/Prefab.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneResolver.h"
+#include "../Scene/UnknownComponent.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+    Prefab::Prefab(Context* context) :
+        Resource(context)
+    {
+    }
+
+    Prefab::~Prefab() = default;
+
+    void Prefab::RegisterObject(Context* context)
+    {
+        context->RegisterFactory<Prefab>();
+    }
+
+    bool Prefab::BeginLoad(Deserializer& source)
+    {
+        ResetTemplate();
+
+        String extension = GetExtension(source.GetName());
+        if (extension == ".xml")
+        {
+            loadXMLFile_ = new XMLFile(context_);
+            if (loadXMLFile_->Load(source))
+                return true;
+            loadXMLFile_.Reset();
+        }
+        else if (extension == ".json")
+        {
+            loadJSONFile_ = new JSONFile(context_);
+            if (loadJSONFile_->Load(source))
+                return true;
+            loadJSONFile_.Reset();
+        }
+        else
+        {
+            // Binary object files are parsed on the main thread, as parsing requires creating the objects
+            loadBuffer_.SetData(source, source.GetSize() - source.GetPosition());
+            if (loadBuffer_.GetSize())
+                return true;
+        }
+
+        URHO3D_LOGERROR("Could not load prefab " + source.GetName());
+        return false;
+    }
+
+    bool Prefab::EndLoad()
+    {
+        // Parse once into a private scene, so that ID attributes are resolved and resources loaded as in a regular instantiate
+        SharedPtr<Scene> scene(new Scene(context_));
+        Node* node = nullptr;
+        if (loadXMLFile_)
+            node = scene->InstantiateXML(loadXMLFile_->GetRoot(), Vector3::ZERO, Quaternion::IDENTITY);
+        else if (loadJSONFile_)
+            node = scene->InstantiateJSON(loadJSONFile_->GetRoot(), Vector3::ZERO, Quaternion::IDENTITY);
+        else if (loadBuffer_.GetSize())
+        {
+            loadBuffer_.Seek(0);
+            node = scene->Instantiate(loadBuffer_, Vector3::ZERO, Quaternion::IDENTITY);
+        }
+
+        loadXMLFile_.Reset();
+        loadJSONFile_.Reset();
+        loadBuffer_.Clear();
+
+        return node && CreateFromNode(node);
+    }
+
+    bool Prefab::CreateFromNode(Node* node)
+    {
+        ResetTemplate();
+
+        if (!node)
+        {
+            URHO3D_LOGERROR("Null node for prefab");
+            return false;
+        }
+
+        AddNode(node, M_MAX_UNSIGNED);
+
+        SetMemoryUse(sizeof(Prefab) + nodes_.size() * sizeof(PrefabNode) + components_.size() * sizeof(PrefabComponent) +
+            attributes_.size() * sizeof(PrefabAttribute));
+        return true;
+    }
+
+    Node* Prefab::Instantiate(Node* parent, const Vector3& position, const Quaternion& rotation, CreateMode mode) const
+    {
+        URHO3D_PROFILE(InstantiatePrefab);
+
+        if (!parent || nodes_.empty())
+            return nullptr;
+
+        SceneResolver resolver;
+        std::vector<Node*> createdNodes;
+        return InstantiateInternal(parent, position, rotation, mode, resolver, createdNodes);
+    }
+
+    unsigned Prefab::InstantiateBatch(Node* parent, const std::vector<Vector3>& positions, const std::vector<Quaternion>& rotations,
+        std::vector<Node*>& dest, CreateMode mode) const
+    {
+        URHO3D_PROFILE(InstantiatePrefabBatch);
+
+        if (!parent || nodes_.empty())
+            return 0;
+
+        if (!rotations.empty() && rotations.size() != positions.size())
+        {
+            URHO3D_LOGERROR("Mismatching position and rotation count for prefab batch instantiate");
+            return 0;
+        }
+
+        // Reuse the resolver and node scratch space between copies
+        SceneResolver resolver;
+        std::vector<Node*> createdNodes;
+        createdNodes.reserve(nodes_.size());
+        dest.reserve(dest.size() + positions.size());
+
+        unsigned count = 0;
+        for (unsigned i = 0; i < positions.size(); ++i)
+        {
+            Node* node = InstantiateInternal(parent, positions[i], rotations.empty() ? Quaternion::IDENTITY : rotations[i], mode,
+                resolver, createdNodes);
+            if (node)
+            {
+                dest.push_back(node);
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+    void Prefab::ResetTemplate()
+    {
+        nodes_.clear();
+        components_.clear();
+        attributes_.clear();
+        resources_.clear();
+    }
+
+    void Prefab::AddNode(Node* node, unsigned parentIndex)
+    {
+        unsigned nodeIndex = (unsigned)nodes_.size();
+        nodes_.emplace_back();
+        {
+            PrefabNode& entry = nodes_.back();
+            entry.id_ = node->GetID();
+            entry.parent_ = parentIndex;
+            entry.replicated_ = Scene::IsReplicatedID(node->GetID());
+            entry.firstAttribute_ = (unsigned)attributes_.size();
+            entry.numAttributes_ = AddAttributes(node);
+            entry.firstComponent_ = (unsigned)components_.size();
+            entry.numComponents_ = 0;
+            AddObjectAnimation(node, entry.objectAnimation_);
+        }
+
+        const std::vector<SharedPtr<Component> >& components = node->GetComponents();
+        for (unsigned i = 0; i < components.size(); ++i)
+        {
+            Component* component = components[i];
+            if (component->IsTemporary())
+                continue;
+
+            PrefabComponent compEntry;
+            compEntry.type_ = component->GetType();
+            compEntry.typeName_ = component->GetTypeName();
+            compEntry.id_ = component->GetID();
+            compEntry.replicated_ = Scene::IsReplicatedID(component->GetID());
+            compEntry.firstAttribute_ = (unsigned)attributes_.size();
+            compEntry.numAttributes_ = 0;
+            compEntry.unknownUseXML_ = false;
+
+            // Unknown components have per-instance attribute descriptions, so copy their raw data instead
+            auto* unknown = dynamic_cast<UnknownComponent*>(component);
+            if (unknown)
+            {
+                compEntry.unknownUseXML_ = unknown->GetUseXML();
+                if (compEntry.unknownUseXML_)
+                    unknown->SaveJSON(compEntry.unknownAttributes_);
+                else
+                    compEntry.unknownData_ = unknown->GetBinaryAttributes();
+            }
+            else
+                compEntry.numAttributes_ = AddAttributes(component);
+
+            AddObjectAnimation(component, compEntry.objectAnimation_);
+
+            components_.push_back(compEntry);
+            ++nodes_[nodeIndex].numComponents_;
+        }
+
+        // Components of a node must be contiguous, so children are added only after them
+        const std::vector<SharedPtr<Node> >& children = node->GetChildren();
+        for (unsigned i = 0; i < children.size(); ++i)
+        {
+            if (!children[i]->IsTemporary())
+                AddNode(children[i], nodeIndex);
+        }
+    }
+
+    unsigned Prefab::AddAttributes(Serializable* object)
+    {
+        const std::vector<AttributeInfo>* attributes = object->GetAttributes();
+        if (!attributes)
+            return 0;
+
+        auto* cache = GetSubsystem<ResourceCache>();
+        unsigned count = 0;
+
+        for (unsigned i = 0; i < attributes->size(); ++i)
+        {
+            const AttributeInfo& attr = attributes->at(i);
+            if (!(attr.mode_ & AM_FILE) || (attr.mode_ & AM_FILEREADONLY) == AM_FILEREADONLY)
+                continue;
+
+            PrefabAttribute value;
+            value.index_ = i;
+            object->OnGetAttribute(attr, value.value_);
+
+            // Keep referenced resources loaded, so that instantiating only needs a cache lookup
+            if (cache)
+            {
+                if (value.value_.GetType() == VAR_RESOURCEREF)
+                {
+                    const ResourceRef& ref = value.value_.GetResourceRef();
+                    if (!ref.name_.Empty())
+                    {
+                        Resource* resource = cache->GetExistingResource(ref.type_, ref.name_);
+                        if (resource)
+                            resources_.push_back(SharedPtr<Resource>(resource));
+                    }
+                }
+                else if (value.value_.GetType() == VAR_RESOURCEREFLIST)
+                {
+                    const ResourceRefList& refList = value.value_.GetResourceRefList();
+                    for (unsigned j = 0; j < refList.names_.size(); ++j)
+                    {
+                        Resource* resource = refList.names_[j].Empty() ? nullptr :
+                            cache->GetExistingResource(refList.type_, refList.names_[j]);
+                        if (resource)
+                            resources_.push_back(SharedPtr<Resource>(resource));
+                    }
+                }
+            }
+
+            attributes_.push_back(value);
+            ++count;
+        }
+
+        return count;
+    }
+
+    void Prefab::ApplyAttributes(Serializable* object, unsigned first, unsigned count) const
+    {
+        const std::vector<AttributeInfo>* attributes = object->GetAttributes();
+        if (!attributes)
+            return;
+
+        for (unsigned i = first; i < first + count; ++i)
+        {
+            const PrefabAttribute& value = attributes_[i];
+            if (value.index_ < attributes->size())
+                object->OnSetAttribute(attributes->at(value.index_), value.value_);
+        }
+    }
+
+    void Prefab::AddObjectAnimation(Animatable* object, JSONValue& dest)
+    {
+        ObjectAnimation* objectAnimation = object->GetObjectAnimation();
+        if (objectAnimation && objectAnimation->GetName().Empty())
+            objectAnimation->SaveJSON(dest);
+    }
+
+    void Prefab::ApplyObjectAnimation(Animatable* object, const JSONValue& source) const
+    {
+        if (source.IsNull())
+            return;
+
+        // Like scene load, each object owns its animation, so that changing it does not affect the other instances
+        SharedPtr<ObjectAnimation> objectAnimation(new ObjectAnimation(context_));
+        if (objectAnimation->LoadJSON(source))
+            object->SetObjectAnimation(objectAnimation);
+    }
+
+    Node* Prefab::InstantiateInternal(Node* parent, const Vector3& position, const Quaternion& rotation, CreateMode mode,
+        SceneResolver& resolver, std::vector<Node*>& createdNodes) const
+    {
+        createdNodes.resize(nodes_.size());
+
+        for (unsigned i = 0; i < nodes_.size(); ++i)
+        {
+            const PrefabNode& entry = nodes_[i];
+
+            // The root node uses the requested mode, children follow the template like Node::Load() does
+            Node* node;
+            if (!i)
+                node = parent->CreateChild(0, mode);
+            else
+                node = createdNodes[entry.parent_]->CreateChild(0, (mode == REPLICATED && entry.replicated_) ? REPLICATED : LOCAL);
+
+            createdNodes[i] = node;
+            resolver.AddNode(entry.id_, node);
+            ApplyAttributes(node, entry.firstAttribute_, entry.numAttributes_);
+            ApplyObjectAnimation(node, entry.objectAnimation_);
+
+            for (unsigned j = entry.firstComponent_; j < entry.firstComponent_ + entry.numComponents_; ++j)
+            {
+                const PrefabComponent& compEntry = components_[j];
+                CreateMode compMode = (mode == REPLICATED && compEntry.replicated_) ? REPLICATED : LOCAL;
+
+                Component* component;
+                if (context_->GetTypeName(compEntry.type_).Empty())
+                {
+                    SharedPtr<UnknownComponent> unknown(new UnknownComponent(context_));
+                    unknown->SetTypeName(compEntry.typeName_);
+                    node->AddComponent(unknown, 0, compMode);
+                    if (compEntry.unknownUseXML_)
+                        unknown->LoadJSON(compEntry.unknownAttributes_);
+                    else if (compEntry.unknownData_.Size())
+                    {
+                        MemoryBuffer buffer(&compEntry.unknownData_[0], compEntry.unknownData_.Size());
+                        unknown->Load(buffer);
+                    }
+                    component = unknown;
+                }
+                else
+                    component = node->CreateComponent(compEntry.type_, compMode);
+
+                if (!component)
+                    continue;
+
+                resolver.AddComponent(compEntry.id_, component);
+                component->OnBeginBulkLoad();
+                ApplyAttributes(component, compEntry.firstAttribute_, compEntry.numAttributes_);
+                component->OnEndBulkLoad();
+                ApplyObjectAnimation(component, compEntry.objectAnimation_);
+            }
+        }
+
+        Node* root = createdNodes[0];
+        resolver.Resolve();
+        root->SetTransform(position, rotation);
+        root->ApplyAttributes();
+        return root;
+    }
+}
@@ -0,0 +1,160 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+// Copyright (c) 2022 Amer Koleci and Contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../IO/VectorBuffer.h"
+#include "../Math/Quaternion.h"
+#include "../Resource/JSONValue.h"
+#include "../Resource/Resource.h"
+#include "../Scene/Node.h"
+
+namespace Urho3D
+{
+    class Animatable;
+    class JSONFile;
+    class SceneResolver;
+    class XMLFile;
+
+    /// Pre-decoded attribute value of a prefab template object.
+    struct PrefabAttribute
+    {
+        /// Index into the object's attribute descriptions.
+        unsigned index_;
+        /// Value.
+        Variant value_;
+    };
+
+    /// Prefab template component.
+    struct PrefabComponent
+    {
+        /// Component type.
+        StringHash type_;
+        /// Component type name, used if the type is not registered.
+        String typeName_;
+        /// Component ID in the template, used to resolve ID attributes.
+        unsigned id_;
+        /// Whether the component is replicated when instantiated in replicated mode.
+        bool replicated_;
+        /// Index of the first attribute value.
+        unsigned firstAttribute_;
+        /// Number of attribute values.
+        unsigned numAttributes_;
+        /// Binary serialization of an unknown component, excluding type and ID.
+        PODVector<unsigned char> unknownData_;
+        /// Whether an unknown component was loaded from XML or JSON, and is restored from its attribute strings.
+        bool unknownUseXML_;
+        /// Attribute names and values of an unknown component loaded from XML or JSON.
+        JSONValue unknownAttributes_;
+        /// Serialized object animation not stored as a resource, or null if none. Loaded into a new object animation for each instance.
+        JSONValue objectAnimation_;
+    };
+
+    /// Prefab template node. Nodes are stored in depth-first order so that parents precede their children.
+    struct PrefabNode
+    {
+        /// Node ID in the template, used to resolve ID attributes.
+        unsigned id_;
+        /// Parent node index, or M_MAX_UNSIGNED for the root.
+        unsigned parent_;
+        /// Whether the node is replicated when instantiated in replicated mode.
+        bool replicated_;
+        /// Index of the first attribute value.
+        unsigned firstAttribute_;
+        /// Number of attribute values.
+        unsigned numAttributes_;
+        /// Index of the first component.
+        unsigned firstComponent_;
+        /// Number of components.
+        unsigned numComponents_;
+        /// Serialized object animation not stored as a resource, or null if none. Loaded into a new object animation for each instance.
+        JSONValue objectAnimation_;
+    };
+
+    /// %Node hierarchy template resource loaded from a binary, XML or JSON object file. The file is parsed once into pre-decoded attribute values, so that instantiating does not deserialize it again.
+    class URHO3D_API Prefab : public Resource
+    {
+        URHO3D_OBJECT(Prefab, Resource);
+
+    public:
+        /// Construct.
+        explicit Prefab(Context* context);
+        /// Destruct.
+        ~Prefab() override;
+        /// Register object factory.
+        /// @nobind
+        static void RegisterObject(Context* context);
+
+        /// Load resource from stream. May be called from a worker thread. Return true if successful.
+        bool BeginLoad(Deserializer& source) override;
+        /// Finish resource loading. Always called from the main thread. Return true if successful.
+        bool EndLoad() override;
+
+        /// Build the template from an existing node hierarchy. Its root position and rotation are replaced when instantiating. Return true if successful.
+        bool CreateFromNode(Node* node);
+        /// Instantiate as a child of a node. Return the root node if successful.
+        Node* Instantiate(Node* parent, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED) const;
+        /// Instantiate several copies as children of a node, one per position and rotation. Rotations may be empty for identity. Return number of copies instantiated; their root nodes are appended to dest.
+        unsigned InstantiateBatch(Node* parent, const std::vector<Vector3>& positions, const std::vector<Quaternion>& rotations,
+            std::vector<Node*>& dest, CreateMode mode = REPLICATED) const;
+
+        /// Return template nodes.
+        const std::vector<PrefabNode>& GetNodes() const { return nodes_; }
+        /// Return template components.
+        const std::vector<PrefabComponent>& GetComponents() const { return components_; }
+        /// Return number of template nodes.
+        unsigned GetNumNodes() const { return (unsigned)nodes_.size(); }
+
+    private:
+        /// Clear the template.
+        void ResetTemplate();
+        /// Add a node and its children to the template.
+        void AddNode(Node* node, unsigned parentIndex);
+        /// Store the file-serialized attributes of an object and pin its resources. Return number of values stored.
+        unsigned AddAttributes(Serializable* object);
+        /// Set stored attribute values to an object.
+        void ApplyAttributes(Serializable* object, unsigned first, unsigned count) const;
+        /// Serialize the object animation of an object if it is not stored as a resource.
+        static void AddObjectAnimation(Animatable* object, JSONValue& dest);
+        /// Give an object its own copy of a serialized object animation.
+        void ApplyObjectAnimation(Animatable* object, const JSONValue& source) const;
+        /// Create one instance. Return the root node.
+        Node* InstantiateInternal(Node* parent, const Vector3& position, const Quaternion& rotation, CreateMode mode,
+            SceneResolver& resolver, std::vector<Node*>& createdNodes) const;
+
+        /// Template nodes.
+        std::vector<PrefabNode> nodes_;
+        /// Template components.
+        std::vector<PrefabComponent> components_;
+        /// Pre-decoded attribute values of all nodes and components.
+        std::vector<PrefabAttribute> attributes_;
+        /// Resources referenced by attributes, kept loaded for the lifetime of the template.
+        std::vector<SharedPtr<Resource> > resources_;
+        /// Binary file data used between BeginLoad() and EndLoad().
+        VectorBuffer loadBuffer_;
+        /// XML file used between BeginLoad() and EndLoad().
+        SharedPtr<XMLFile> loadXMLFile_;
+        /// JSON file used between BeginLoad() and EndLoad().
+        SharedPtr<JSONFile> loadJSONFile_;
+    };
+}
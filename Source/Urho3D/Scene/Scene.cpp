@@ -28,6 +28,8 @@
 #include "../Core/WorkQueue.h"
 #include "../IO/File.h"
 #include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+#include "../IO/MemoryMappedFile.h"
 #include "../IO/PackageFile.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/ResourceEvents.h"
@@ -35,7 +37,10 @@
 #include "../Resource/JSONFile.h"
 #include "../Scene/Component.h"
 #include "../Scene/ObjectAnimation.h"
+#include "../Scene/PackedScene.h"
+#include "../Scene/Prefab.h"
 #include "../Scene/ReplicationState.h"
+#include "../Scene/SceneResolver.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 #include "../Scene/SmoothedTransform.h"
@@ -121,7 +126,29 @@ bool Scene::Load(Deserializer& source)
     StopAsyncLoading();
 
     // Check ID
-    if (source.ReadFileID() != "USCN")
+    String fileID = source.ReadFileID();
+    if (fileID == PACKED_SCENE_ID)
+    {
+        URHO3D_LOGINFO("Loading packed scene from " + source.GetName());
+
+        // Packed scenes are read as one block; prefer LoadPacked(fileName) to memory map them instead
+        unsigned dataSize = source.GetSize() - source.GetPosition() + 4;
+        std::vector<unsigned char> data(dataSize);
+        memcpy(data.data(), PACKED_SCENE_ID, 4);
+        if (source.Read(data.data() + 4, dataSize - 4) != dataSize - 4)
+        {
+            URHO3D_LOGERROR("Could not read packed scene " + source.GetName());
+            return false;
+        }
+
+        if (!LoadPacked(data.data(), dataSize))
+            return false;
+
+        FinishLoading(&source);
+        return true;
+    }
+
+    if (fileID != "USCN")
     {
         URHO3D_LOGERROR(source.GetName() + " is not a valid scene file");
         return false;
@@ -165,6 +192,58 @@ bool Scene::Save(Serializer& dest) const
         return false;
 }
 
+bool Scene::LoadPacked(const unsigned char* data, unsigned size)
+{
+    URHO3D_PROFILE(LoadScenePacked);
+
+    StopAsyncLoading();
+    Clear();
+
+    SceneResolver resolver;
+    if (!LoadPackedScene(this, data, size, resolver))
+        return false;
+
+    resolver.Resolve();
+    ApplyAttributes();
+    return true;
+}
+
+bool Scene::LoadPacked(const String& fileName)
+{
+    MemoryMappedFile file;
+    if (!file.Open(fileName))
+        return false;
+
+    URHO3D_LOGINFO("Loading scene from " + fileName);
+
+    if (!LoadPacked(file.GetData(), file.GetSize()))
+        return false;
+
+    fileName_ = fileName;
+    checksum_ = 0;
+    const unsigned char* data = file.GetData();
+    for (unsigned i = 0; i < file.GetSize(); ++i)
+        checksum_ = SDBMHash(checksum_, data[i]);
+    return true;
+}
+
+bool Scene::SavePacked(Serializer& dest) const
+{
+    URHO3D_PROFILE(SaveScenePacked);
+
+    auto* ptr = dynamic_cast<Deserializer*>(&dest);
+    if (ptr)
+        URHO3D_LOGINFO("Saving scene to " + ptr->GetName());
+
+    if (SavePackedScene(this, dest))
+    {
+        FinishSaving(&dest);
+        return true;
+    }
+    else
+        return false;
+}
+
 bool Scene::LoadXML(const XMLElement& source)
 {
     URHO3D_PROFILE(LoadSceneXML);
@@ -551,6 +630,29 @@ Node* Scene::Instantiate(Deserializer& source, const Vector3& position, const Qu
     }
 }
 
+Node* Scene::Instantiate(Prefab* prefab, const Vector3& position, const Quaternion& rotation, CreateMode mode)
+{
+    if (!prefab)
+    {
+        URHO3D_LOGERROR("Null prefab to instantiate");
+        return nullptr;
+    }
+
+    return prefab->Instantiate(this, position, rotation, mode);
+}
+
+unsigned Scene::InstantiateBatch(Prefab* prefab, const std::vector<Vector3>& positions, const std::vector<Quaternion>& rotations,
+    std::vector<Node*>& dest, CreateMode mode)
+{
+    if (!prefab)
+    {
+        URHO3D_LOGERROR("Null prefab to instantiate");
+        return 0;
+    }
+
+    return prefab->InstantiateBatch(this, positions, rotations, dest, mode);
+}
+
 Node* Scene::InstantiateXML(const XMLElement& source, const Vector3& position, const Quaternion& rotation, CreateMode mode)
 {
     URHO3D_PROFILE(InstantiateXML);
@@ -721,10 +823,20 @@ Node* Scene::GetNode(unsigned id) const
 }
 
 bool Scene::GetNodesWithTag(PODVector<Node*>& dest, const String& tag) const
+{
+    return GetNodesWithTag(dest, StringHash(tag));
+}
+
+bool Scene::GetNodesWithTag(PODVector<Node*>& dest, const char* tag) const
+{
+    return GetNodesWithTag(dest, StringHash(tag));
+}
+
+bool Scene::GetNodesWithTag(PODVector<Node*>& dest, StringHash tag) const
 {
     dest.Clear();
     HashMap<StringHash, PODVector<Node*> >::ConstIterator it = taggedNodes_.Find(tag);
-    if (it != taggedNodes_.End())
+    if (it != taggedNodes_.End() && !it->second_.Empty())
     {
         dest = it->second_;
         return true;
@@ -733,6 +845,49 @@ bool Scene::GetNodesWithTag(PODVector<Node*>& dest, const String& tag) const
         return false;
 }
 
+bool Scene::GetNodesWithTags(PODVector<Node*>& dest, const std::vector<StringHash>& tags) const
+{
+    dest.Clear();
+    if (tags.empty())
+        return false;
+
+    // Iterate the smallest tagged node list and check the other tags on each node
+    const PODVector<Node*>* smallest = nullptr;
+    unsigned smallestIndex = 0;
+    for (unsigned i = 0; i < tags.size(); ++i)
+    {
+        HashMap<StringHash, PODVector<Node*> >::ConstIterator it = taggedNodes_.Find(tags[i]);
+        if (it == taggedNodes_.End() || it->second_.Empty())
+            return false;
+        if (!smallest || it->second_.Size() < smallest->Size())
+        {
+            smallest = &it->second_;
+            smallestIndex = i;
+        }
+    }
+
+    for (PODVector<Node*>::ConstIterator i = smallest->Begin(); i != smallest->End(); ++i)
+    {
+        Node* node = *i;
+        bool hasAll = true;
+        for (unsigned j = 0; j < tags.size() && hasAll; ++j)
+        {
+            if (j != smallestIndex && !node->HasTag(tags[j]))
+                hasAll = false;
+        }
+        if (hasAll)
+            dest.Push(node);
+    }
+
+    return !dest.Empty();
+}
+
+unsigned Scene::GetNumNodesWithTag(StringHash tag) const
+{
+    HashMap<StringHash, PODVector<Node*> >::ConstIterator it = taggedNodes_.Find(tag);
+    return it != taggedNodes_.End() ? it->second_.Size() : 0;
+}
+
 Component* Scene::GetComponent(unsigned id) const
 {
     if (IsReplicatedID(id))
@@ -953,12 +1108,8 @@ void Scene::NodeAdded(Node* node)
     }
 
     // Cache tag if already tagged.
-    if (!node->GetTags().empty())
-    {
-        const StringVector& tags = node->GetTags();
-        for (unsigned i = 0; i < tags.size(); ++i)
-            taggedNodes_[tags[i]].Push(node);
-    }
+    for (unsigned i = 0; i < node->impl_->tagHashes_.size(); ++i)
+        AddTaggedNode(node, i);
 
     // Add already created components and child nodes now
     const std::vector<SharedPtr<Component> >& components = node->GetComponents();
@@ -971,12 +1122,52 @@ void Scene::NodeAdded(Node* node)
 
 void Scene::NodeTagAdded(Node* node, const String& tag)
 {
-    taggedNodes_[tag].Push(node);
+    const std::vector<StringHash>& tagHashes = node->impl_->tagHashes_;
+    auto it = std::find(tagHashes.begin(), tagHashes.end(), StringHash(tag));
+    if (it != tagHashes.end())
+        AddTaggedNode(node, (unsigned)(it - tagHashes.begin()));
 }
 
 void Scene::NodeTagRemoved(Node* node, const String& tag)
 {
-    taggedNodes_[tag].Remove(node);
+    const std::vector<StringHash>& tagHashes = node->impl_->tagHashes_;
+    auto it = std::find(tagHashes.begin(), tagHashes.end(), StringHash(tag));
+    if (it != tagHashes.end())
+        RemoveTaggedNode(node, (unsigned)(it - tagHashes.begin()));
+}
+
+void Scene::AddTaggedNode(Node* node, unsigned tagIndex)
+{
+    PODVector<Node*>& nodes = taggedNodes_[node->impl_->tagHashes_[tagIndex]];
+    node->impl_->tagListIndices_[tagIndex] = nodes.Size();
+    nodes.Push(node);
+}
+
+void Scene::RemoveTaggedNode(Node* node, unsigned tagIndex)
+{
+    StringHash tag = node->impl_->tagHashes_[tagIndex];
+    unsigned index = node->impl_->tagListIndices_[tagIndex];
+    node->impl_->tagListIndices_[tagIndex] = M_MAX_UNSIGNED;
+
+    HashMap<StringHash, PODVector<Node*> >::Iterator it = taggedNodes_.Find(tag);
+    if (it == taggedNodes_.End())
+        return;
+
+    PODVector<Node*>& nodes = it->second_;
+    if (index >= nodes.Size() || nodes[index] != node)
+        return;
+
+    // Move the last node into the vacated position and update its remembered position
+    Node* last = nodes.Back();
+    if (last != node)
+    {
+        nodes[index] = last;
+        const std::vector<StringHash>& lastTags = last->impl_->tagHashes_;
+        auto lastIt = std::find(lastTags.begin(), lastTags.end(), tag);
+        if (lastIt != lastTags.end())
+            last->impl_->tagListIndices_[lastIt - lastTags.begin()] = index;
+    }
+    nodes.Pop();
 }
 
 void Scene::NodeRemoved(Node* node)
@@ -996,12 +1187,8 @@ void Scene::NodeRemoved(Node* node)
     node->ResetScene();
 
     // Remove node from tag cache
-    if (!node->GetTags().empty())
-    {
-        const StringVector& tags = node->GetTags();
-        for (unsigned i = 0; i < tags.size(); ++i)
-            taggedNodes_[tags[i]].Remove(node);
-    }
+    for (unsigned i = 0; i < node->impl_->tagHashes_.size(); ++i)
+        RemoveTaggedNode(node, i);
 
     // Remove components and child nodes as well
     const std::vector<SharedPtr<Component> >& components = node->GetComponents();
@@ -1538,6 +1725,7 @@ void Urho3D::RegisterSceneLibrary(Context* context)
 {
     ValueAnimation::RegisterObject(context);
     ObjectAnimation::RegisterObject(context);
+    Prefab::RegisterObject(context);
     Node::RegisterObject(context);
     Scene::RegisterObject(context);
     SmoothedTransform::RegisterObject(context);
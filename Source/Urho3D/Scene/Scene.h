@@ -33,6 +33,7 @@ namespace Urho3D
 {
     class File;
     class PackageFile;
+    class Prefab;
 
     static constexpr uint32_t FIRST_REPLICATED_ID = 0x1;
     static constexpr uint32_t LAST_REPLICATED_ID = 0xffffff;
@@ -122,6 +123,12 @@ namespace Urho3D
         bool SaveXML(Serializer& dest, const String& indentation = "\t") const;
         /// Save to a JSON file. Return true if successful.
         bool SaveJSON(Serializer& dest, const String& indentation = "\t") const;
+        /// Load from packed binary scene data. The data is only accessed during the call. Return true if successful.
+        bool LoadPacked(const unsigned char* data, unsigned size);
+        /// Load from a packed binary scene file, which is memory mapped for the duration of the load. Return true if successful.
+        bool LoadPacked(const String& fileName);
+        /// Save to the packed binary scene format. Return true if successful.
+        bool SavePacked(Serializer& dest) const;
         /// Load from a binary file asynchronously. Return true if started successfully. The LOAD_RESOURCES_ONLY mode can also be used to preload resources from object prefab files.
         bool LoadAsync(File* file, LoadMode mode = LOAD_SCENE_AND_RESOURCES);
         /// Load from an XML file asynchronously. Return true if started successfully. The LOAD_RESOURCES_ONLY mode can also be used to preload resources from object prefab files.
@@ -132,6 +139,11 @@ namespace Urho3D
         void StopAsyncLoading();
         /// Instantiate scene content from binary data. Return root node if successful.
         Node* Instantiate(Deserializer& source, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
+        /// Instantiate a prefab template. Faster than instantiating from file data, as the prefab is pre-parsed. Return root node if successful.
+        Node* Instantiate(Prefab* prefab, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
+        /// Instantiate several copies of a prefab template, one per position and rotation. Rotations may be empty for identity. Return number of copies instantiated; their root nodes are appended to dest.
+        unsigned InstantiateBatch(Prefab* prefab, const std::vector<Vector3>& positions, const std::vector<Quaternion>& rotations,
+            std::vector<Node*>& dest, CreateMode mode = REPLICATED);
         /// Instantiate scene content from XML data. Return root node if successful.
         Node* InstantiateXML
         (const XMLElement& source, const Vector3& position, const Quaternion& rotation, CreateMode mode = REPLICATED);
@@ -179,7 +191,15 @@ namespace Urho3D
         /// Return component from the whole scene by ID, or null if not found.
         Component* GetComponent(unsigned id) const;
         /// Get nodes with specific tag from the whole scene, return false if empty.
-        bool GetNodesWithTag(PODVector<Node*>& dest, const String& tag)  const;
+        bool GetNodesWithTag(PODVector<Node*>& dest, const String& tag) const;
+        /// Get nodes with specific tag from the whole scene, return false if empty.
+        bool GetNodesWithTag(PODVector<Node*>& dest, const char* tag) const;
+        /// Get nodes with specific tag hash from the whole scene, return false if empty.
+        bool GetNodesWithTag(PODVector<Node*>& dest, StringHash tag) const;
+        /// Get nodes that have all of the specified tags from the whole scene, return false if empty.
+        bool GetNodesWithTags(PODVector<Node*>& dest, const std::vector<StringHash>& tags) const;
+        /// Return number of nodes with specific tag hash in the whole scene.
+        unsigned GetNumNodesWithTag(StringHash tag) const;
 
         /// Return whether updates are enabled.
         /// @property
@@ -251,9 +271,9 @@ namespace Urho3D
         /// Return whether the specified id is a replicated id.
         static bool IsReplicatedID(unsigned id) { return id < FIRST_LOCAL_ID; }
 
-        /// Cache node by tag if tag not zero, no checking if already added. Used internaly in Node::AddTag.
+        /// Cache node by tag, no checking if already added. Used internally in Node::AddTag.
         void NodeTagAdded(Node* node, const String& tag);
-        /// Cache node by tag if tag not zero.
+        /// Remove node from the tag cache. Used internally in Node::RemoveTag before the tag is erased.
         void NodeTagRemoved(Node* node, const String& tag);
 
         /// Node added. Assign scene pointer and add to ID map.
@@ -291,6 +311,10 @@ namespace Urho3D
         void FinishAsyncLoading();
         /// Finish loading. Sets the scene filename and checksum.
         void FinishLoading(Deserializer* source);
+        /// Add a node to the tagged node list of its tag by index.
+        void AddTaggedNode(Node* node, unsigned tagIndex);
+        /// Remove a node from the tagged node list of its tag by index.
+        void RemoveTaggedNode(Node* node, unsigned tagIndex);
         /// Finish saving. Sets the scene filename and checksum.
         void FinishSaving(Serializer* dest) const;
         /// Preload resources from a binary scene or object prefab file.
@@ -308,7 +332,7 @@ namespace Urho3D
         HashMap<unsigned, Component*> replicatedComponents_;
         /// Local components by ID.
         HashMap<unsigned, Component*> localComponents_;
-        /// Cached tagged nodes by tag.
+        /// Cached tagged nodes by tag hash. Each node remembers its position in the lists for constant time removal.
         HashMap<StringHash, PODVector<Node*> > taggedNodes_;
         /// Asynchronous loading progress.
         AsyncProgress asyncProgress_;
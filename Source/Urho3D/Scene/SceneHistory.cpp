@@ -0,0 +1,571 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+// Copyright (c) 2022 Amer Koleci and Contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/Profiler.h"
+#include "../IO/Log.h"
+#include "../Scene/Component.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneEvents.h"
+#include "../Scene/SceneHistory.h"
+
+#include <cstring>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+    static constexpr unsigned DEFAULT_HISTORY_CAPACITY = 64;
+
+    /// Node transform as stored in the plain data mirror.
+    struct SceneHistoryTransform
+    {
+        /// Position.
+        Vector3 position_;
+        /// Rotation.
+        Quaternion rotation_;
+        /// Scale.
+        Vector3 scale_;
+    };
+
+    /// Return whether the object of a slot has been destroyed or removed from a scene.
+    static bool IsSlotRemoved(const SceneHistorySlot& slot, const Scene* scene)
+    {
+        Serializable* object = slot.object_.Get();
+        if (!object)
+            return true;
+
+        // Node slots hold the transform, component slots hold attributes
+        if (slot.attributeIndex_ == M_MAX_UNSIGNED)
+            return static_cast<Node*>(object)->GetScene() != scene;
+        else
+            return static_cast<Component*>(object)->GetScene() != scene;
+    }
+
+    SceneHistory::SceneHistory(Context* context) :
+        Object(context),
+        firstFrame_(0),
+        numFrames_(0),
+        capacity_(DEFAULT_HISTORY_CAPACITY),
+        attributeMode_(AM_NET),
+        includeLocal_(false),
+        slotsDirty_(true)
+    {
+    }
+
+    SceneHistory::~SceneHistory() = default;
+
+    void SceneHistory::SetScene(Scene* scene)
+    {
+        if (scene == scene_)
+            return;
+
+        if (scene_)
+        {
+            UnsubscribeFromEvent(scene_, E_NODEADDED);
+            UnsubscribeFromEvent(scene_, E_NODEREMOVED);
+            UnsubscribeFromEvent(scene_, E_COMPONENTADDED);
+            UnsubscribeFromEvent(scene_, E_COMPONENTREMOVED);
+        }
+
+        scene_ = scene;
+
+        if (scene_)
+        {
+            SubscribeToEvent(scene_, E_NODEADDED, URHO3D_HANDLER(SceneHistory, HandleSceneChanged));
+            SubscribeToEvent(scene_, E_NODEREMOVED, URHO3D_HANDLER(SceneHistory, HandleSceneChanged));
+            SubscribeToEvent(scene_, E_COMPONENTADDED, URHO3D_HANDLER(SceneHistory, HandleSceneChanged));
+            SubscribeToEvent(scene_, E_COMPONENTREMOVED, URHO3D_HANDLER(SceneHistory, HandleSceneChanged));
+        }
+
+        Clear();
+    }
+
+    void SceneHistory::SetCapacity(unsigned frames)
+    {
+        capacity_ = Max(frames, 1U);
+        Clear();
+    }
+
+    void SceneHistory::SetIncludeLocal(bool enable)
+    {
+        includeLocal_ = enable;
+        Clear();
+    }
+
+    void SceneHistory::SetAttributeMode(AttributeModeFlags mode)
+    {
+        attributeMode_ = mode;
+        Clear();
+    }
+
+    bool SceneHistory::Capture(unsigned frame)
+    {
+        if (!scene_)
+        {
+            URHO3D_LOGERROR("No scene to capture");
+            return false;
+        }
+        if (numFrames_ && frame <= GetNewestFrame())
+        {
+            URHO3D_LOGERROR("Captured frame number " + String(frame) + " is not newer than " + String(GetNewestFrame()));
+            return false;
+        }
+
+        URHO3D_PROFILE(CaptureSceneHistory);
+
+        if (frames_.size() != capacity_)
+            frames_.resize(capacity_);
+
+        // The mirror holds the previous capture even when evicting it below leaves no frames, as with a capacity of 1
+        bool hasPrevious = numFrames_ != 0;
+
+        // Overwrite the oldest frame when full. Its changes are not needed, as it can no longer be restored
+        if (numFrames_ == capacity_)
+        {
+            firstFrame_ = (firstFrame_ + 1) % capacity_;
+            --numFrames_;
+        }
+
+        // Reuse the vectors of the frame being overwritten to avoid allocating
+        SceneHistoryFrame& record = frames_[(firstFrame_ + numFrames_) % capacity_];
+        record.frame_ = frame;
+        record.slots_.clear();
+        record.data_.clear();
+        record.variants_.clear();
+
+        // The first frame has nothing to compare against: the slots are initialized below
+        if (hasPrevious)
+        {
+            for (unsigned i = 0; i < slots_.size(); ++i)
+            {
+                const SceneHistorySlot& slot = slots_[i];
+                Serializable* object = slot.object_.Get();
+                if (!object)
+                    continue;
+
+                if (slot.offset_ != M_MAX_UNSIGNED)
+                {
+                    unsigned char* stored = &mirror_[slot.offset_];
+                    const void* current;
+                    SceneHistoryTransform transform;
+
+                    if (slot.attributeIndex_ == M_MAX_UNSIGNED)
+                    {
+                        Node* node = static_cast<Node*>(object);
+                        transform.position_ = node->GetPosition();
+                        transform.rotation_ = node->GetRotation();
+                        transform.scale_ = node->GetScale();
+                        current = &transform;
+                    }
+                    else
+                        current = object->GetAttributes()->at(slot.attributeIndex_).accessor_->GetMemberAddress(object);
+
+                    if (memcmp(stored, current, slot.sizeOrIndex_) != 0)
+                    {
+                        record.slots_.push_back(i);
+                        record.data_.insert(record.data_.end(), stored, stored + slot.sizeOrIndex_);
+                        memcpy(stored, current, slot.sizeOrIndex_);
+                    }
+                }
+                else
+                {
+                    Variant& stored = mirrorVariants_[slot.sizeOrIndex_];
+                    object->OnGetAttribute(object->GetAttributes()->at(slot.attributeIndex_), tempValue_);
+                    if (tempValue_ != stored)
+                    {
+                        record.slots_.push_back(i);
+                        record.variants_.push_back(stored);
+                        stored = tempValue_;
+                    }
+                }
+            }
+        }
+
+        ++numFrames_;
+
+        // Nodes and components created since the previous capture start being tracked from this frame
+        if (slotsDirty_)
+            UpdateSlots();
+
+        return true;
+    }
+
+    bool SceneHistory::Restore(unsigned frame)
+    {
+        if (!scene_)
+        {
+            URHO3D_LOGERROR("No scene to restore");
+            return false;
+        }
+
+        unsigned index = GetFrameIndex(frame);
+        if (index == M_MAX_UNSIGNED)
+        {
+            URHO3D_LOGERROR("Frame " + String(frame) + " is not in the scene history");
+            return false;
+        }
+
+        URHO3D_PROFILE(RestoreSceneHistory);
+
+        // Rewind the mirror by undoing the newer frames, newest first
+        while (numFrames_ > index + 1)
+        {
+            const SceneHistoryFrame& record = frames_[(firstFrame_ + numFrames_ - 1) % capacity_];
+            const unsigned char* data = record.data_.data();
+            const Variant* variants = record.variants_.data();
+
+            for (unsigned slotIndex : record.slots_)
+            {
+                const SceneHistorySlot& slot = slots_[slotIndex];
+                if (slot.offset_ != M_MAX_UNSIGNED)
+                {
+                    memcpy(&mirror_[slot.offset_], data, slot.sizeOrIndex_);
+                    data += slot.sizeOrIndex_;
+                }
+                else
+                    mirrorVariants_[slot.sizeOrIndex_] = *variants++;
+            }
+
+            --numFrames_;
+        }
+
+        // Write back every value that differs from the mirror, as the scene may also have changed after the newest capture
+        restoredObjects_.clear();
+
+        for (const SceneHistorySlot& slot : slots_)
+        {
+            Serializable* object = slot.object_.Get();
+            if (!object)
+                continue;
+
+            if (slot.attributeIndex_ == M_MAX_UNSIGNED)
+            {
+                Node* node = static_cast<Node*>(object);
+                const SceneHistoryTransform& stored = *reinterpret_cast<const SceneHistoryTransform*>(&mirror_[slot.offset_]);
+                if (stored.position_ != node->GetPosition() || stored.rotation_ != node->GetRotation() || stored.scale_ != node->GetScale())
+                    node->SetTransform(stored.position_, stored.rotation_, stored.scale_);
+                continue;
+            }
+
+            const AttributeInfo& attr = object->GetAttributes()->at(slot.attributeIndex_);
+            bool changed = false;
+
+            if (slot.offset_ != M_MAX_UNSIGNED)
+            {
+                // Writing the member directly is what its accessor would do
+                void* current = const_cast<void*>(attr.accessor_->GetMemberAddress(object));
+                if (memcmp(current, &mirror_[slot.offset_], slot.sizeOrIndex_) != 0)
+                {
+                    memcpy(current, &mirror_[slot.offset_], slot.sizeOrIndex_);
+                    changed = true;
+                }
+            }
+            else
+            {
+                const Variant& stored = mirrorVariants_[slot.sizeOrIndex_];
+                object->OnGetAttribute(attr, tempValue_);
+                if (tempValue_ != stored)
+                {
+                    object->OnSetAttribute(attr, stored);
+                    changed = true;
+                }
+            }
+
+            // Slots of the same object are consecutive
+            if (changed && (restoredObjects_.empty() || restoredObjects_.back() != object))
+                restoredObjects_.push_back(object);
+        }
+
+        for (Serializable* object : restoredObjects_)
+            object->ApplyAttributes();
+        restoredObjects_.clear();
+
+        return true;
+    }
+
+    void SceneHistory::Clear()
+    {
+        slots_.clear();
+        nodeSlots_.Clear();
+        componentSlots_.Clear();
+        mirror_.clear();
+        mirrorVariants_.clear();
+        firstFrame_ = 0;
+        numFrames_ = 0;
+        slotsDirty_ = true;
+    }
+
+    Scene* SceneHistory::GetScene() const
+    {
+        return scene_;
+    }
+
+    unsigned SceneHistory::GetOldestFrame() const
+    {
+        return numFrames_ ? frames_[firstFrame_].frame_ : 0;
+    }
+
+    unsigned SceneHistory::GetNewestFrame() const
+    {
+        return numFrames_ ? frames_[(firstFrame_ + numFrames_ - 1) % capacity_].frame_ : 0;
+    }
+
+    bool SceneHistory::HasFrame(unsigned frame) const
+    {
+        return GetFrameIndex(frame) != M_MAX_UNSIGNED;
+    }
+
+    void SceneHistory::HandleSceneChanged(StringHash eventType, VariantMap& eventData)
+    {
+        slotsDirty_ = true;
+    }
+
+    void SceneHistory::UpdateSlots()
+    {
+        // Spawning and despawning would otherwise grow the slots and the per-frame cost without limit
+        for (const SceneHistorySlot& slot : slots_)
+        {
+            if (IsSlotRemoved(slot, scene_))
+            {
+                RemoveExpiredSlots();
+                break;
+            }
+        }
+
+        // Do not capture the scene root transform
+        for (Component* component : scene_->GetComponents())
+        {
+            if (includeLocal_ || component->IsReplicated())
+                AddObjectSlots(component, false, componentSlots_);
+        }
+        for (Node* child : scene_->GetChildren())
+            AddSlots(child);
+
+        slotsDirty_ = false;
+    }
+
+    void SceneHistory::RemoveExpiredSlots()
+    {
+        slotRemap_.resize(slots_.size());
+        unsigned numSlots = 0;
+        for (unsigned i = 0; i < slots_.size(); ++i)
+            slotRemap_[i] = IsSlotRemoved(slots_[i], scene_) ? M_MAX_UNSIGNED : numSlots++;
+
+        // Drop the changes of the removed slots from the captured frames. The remaining slots keep their order
+        for (unsigned i = 0; i < numFrames_; ++i)
+        {
+            SceneHistoryFrame& record = frames_[(firstFrame_ + i) % capacity_];
+            unsigned numChanged = 0;
+            unsigned dataRead = 0;
+            unsigned dataWrite = 0;
+            unsigned variantRead = 0;
+            unsigned variantWrite = 0;
+
+            for (unsigned oldIndex : record.slots_)
+            {
+                const SceneHistorySlot& slot = slots_[oldIndex];
+                const bool keep = slotRemap_[oldIndex] != M_MAX_UNSIGNED;
+
+                if (slot.offset_ != M_MAX_UNSIGNED)
+                {
+                    if (keep)
+                    {
+                        if (dataWrite != dataRead)
+                            memmove(&record.data_[dataWrite], &record.data_[dataRead], slot.sizeOrIndex_);
+                        dataWrite += slot.sizeOrIndex_;
+                    }
+                    dataRead += slot.sizeOrIndex_;
+                }
+                else
+                {
+                    if (keep)
+                    {
+                        if (variantWrite != variantRead)
+                            record.variants_[variantWrite] = std::move(record.variants_[variantRead]);
+                        ++variantWrite;
+                    }
+                    ++variantRead;
+                }
+
+                if (keep)
+                    record.slots_[numChanged++] = slotRemap_[oldIndex];
+            }
+
+            record.slots_.resize(numChanged);
+            record.data_.resize(dataWrite);
+            record.variants_.resize(variantWrite);
+        }
+
+        // Compact the slots and the mirror in place. Removing only moves values towards the front, so offsets never increase
+        unsigned mirrorSize = 0;
+        unsigned numVariants = 0;
+        for (unsigned i = 0; i < slots_.size(); ++i)
+        {
+            if (slotRemap_[i] == M_MAX_UNSIGNED)
+                continue;
+
+            SceneHistorySlot& slot = slots_[i];
+            if (slot.offset_ != M_MAX_UNSIGNED)
+            {
+                unsigned offset = (mirrorSize + 3) & ~3U;
+                if (offset != slot.offset_)
+                    memmove(&mirror_[offset], &mirror_[slot.offset_], slot.sizeOrIndex_);
+                slot.offset_ = offset;
+                mirrorSize = offset + slot.sizeOrIndex_;
+            }
+            else
+            {
+                if (numVariants != slot.sizeOrIndex_)
+                    mirrorVariants_[numVariants] = std::move(mirrorVariants_[slot.sizeOrIndex_]);
+                slot.sizeOrIndex_ = numVariants++;
+            }
+
+            if (slotRemap_[i] != i)
+                slots_[slotRemap_[i]] = std::move(slot);
+        }
+
+        slots_.resize(numSlots);
+        mirror_.resize(mirrorSize);
+        mirrorVariants_.resize(numVariants);
+
+        // Forget the removed objects and point the others to their new first slots
+        for (HashMap<unsigned, unsigned>* objectSlots : { &nodeSlots_, &componentSlots_ })
+        {
+            for (HashMap<unsigned, unsigned>::Iterator i = objectSlots->Begin(); i != objectSlots->End();)
+            {
+                unsigned newIndex = i->second_ < slotRemap_.size() ? slotRemap_[i->second_] : M_MAX_UNSIGNED;
+                if (newIndex == M_MAX_UNSIGNED)
+                    i = objectSlots->Erase(i);
+                else
+                {
+                    i->second_ = newIndex;
+                    ++i;
+                }
+            }
+        }
+    }
+
+    void SceneHistory::AddSlots(Node* node)
+    {
+        if (!includeLocal_ && !node->IsReplicated())
+            return;
+
+        AddObjectSlots(node, true, nodeSlots_);
+
+        for (Component* component : node->GetComponents())
+        {
+            if (includeLocal_ || component->IsReplicated())
+                AddObjectSlots(component, false, componentSlots_);
+        }
+        for (Node* child : node->GetChildren())
+            AddSlots(child);
+    }
+
+    bool SceneHistory::AddObjectSlots(Serializable* object, bool isNode, HashMap<unsigned, unsigned>& objectSlots)
+    {
+        unsigned id = isNode ? static_cast<Node*>(object)->GetID() : static_cast<Component*>(object)->GetID();
+
+        // IDs may be reused after removal, so check that the slot still refers to the same object
+        HashMap<unsigned, unsigned>::Iterator i = objectSlots.Find(id);
+        if (i != objectSlots.End() && i->second_ < slots_.size() && slots_[i->second_].object_ == object)
+            return false;
+
+        objectSlots[id] = (unsigned)slots_.size();
+
+        if (isNode)
+            AddSlot(object, M_MAX_UNSIGNED);
+        else if (const std::vector<AttributeInfo>* attributes = object->GetAttributes())
+        {
+            for (unsigned j = 0; j < attributes->size(); ++j)
+            {
+                if (attributes->at(j).mode_ & attributeMode_)
+                    AddSlot(object, j);
+            }
+        }
+
+        return true;
+    }
+
+    void SceneHistory::AddSlot(Serializable* object, unsigned attributeIndex)
+    {
+        SceneHistorySlot slot;
+        slot.object_ = object;
+        slot.attributeIndex_ = attributeIndex;
+
+        const void* src = nullptr;
+        SceneHistoryTransform transform;
+
+        if (attributeIndex == M_MAX_UNSIGNED)
+        {
+            Node* node = static_cast<Node*>(object);
+            transform.position_ = node->GetPosition();
+            transform.rotation_ = node->GetRotation();
+            transform.scale_ = node->GetScale();
+            src = &transform;
+            slot.sizeOrIndex_ = sizeof(SceneHistoryTransform);
+        }
+        else
+        {
+            const AttributeInfo& attr = object->GetAttributes()->at(attributeIndex);
+            if (attr.memberSize_)
+            {
+                src = attr.accessor_->GetMemberAddress(object);
+                slot.sizeOrIndex_ = attr.memberSize_;
+            }
+        }
+
+        if (src)
+        {
+            // Keep plain values aligned so that the transform can be read back in place
+            slot.offset_ = (unsigned)((mirror_.size() + 3) & ~3U);
+            mirror_.resize(slot.offset_ + slot.sizeOrIndex_);
+            memcpy(&mirror_[slot.offset_], src, slot.sizeOrIndex_);
+        }
+        else
+        {
+            slot.offset_ = M_MAX_UNSIGNED;
+            slot.sizeOrIndex_ = (unsigned)mirrorVariants_.size();
+            mirrorVariants_.emplace_back();
+            object->OnGetAttribute(object->GetAttributes()->at(attributeIndex), mirrorVariants_.back());
+        }
+
+        slots_.push_back(slot);
+    }
+
+    unsigned SceneHistory::GetFrameIndex(unsigned frame) const
+    {
+        if (!numFrames_ || frame < GetOldestFrame() || frame > GetNewestFrame())
+            return M_MAX_UNSIGNED;
+
+        // Frame numbers increase but may have gaps, so search from the newest, which is the common rollback case
+        for (unsigned i = numFrames_; i-- > 0;)
+        {
+            if (frames_[(firstFrame_ + i) % capacity_].frame_ == frame)
+                return i;
+        }
+
+        return M_MAX_UNSIGNED;
+    }
+}
@@ -0,0 +1,156 @@
+//
+// Copyright (c) 2008-2022 the Urho3D project.
+// Copyright (c) 2022 Amer Koleci and Contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Core/Attribute.h"
+#include "../Core/Object.h"
+
+namespace Urho3D
+{
+    class Node;
+    class Scene;
+    class Serializable;
+
+    /// Captured value of one node transform or object attribute.
+    struct SceneHistorySlot
+    {
+        /// Node or component.
+        WeakPtr<Serializable> object_;
+        /// Index into the object's attributes, or M_MAX_UNSIGNED for the node transform.
+        unsigned attributeIndex_;
+        /// Offset of the value in the plain data mirror, or M_MAX_UNSIGNED if stored as a variant.
+        unsigned offset_;
+        /// Size of the plain data value, or variant index if stored as a variant.
+        unsigned sizeOrIndex_;
+    };
+
+    /// Changes recorded for one captured frame: the values the changed slots had in the previous frame.
+    struct SceneHistoryFrame
+    {
+        /// Frame number.
+        unsigned frame_;
+        /// Indices of changed slots.
+        std::vector<unsigned> slots_;
+        /// Previous plain data values of the changed slots, in slot order.
+        std::vector<unsigned char> data_;
+        /// Previous variant values of the changed slots, in slot order.
+        std::vector<Variant> variants_;
+    };
+
+    /// %Scene state history for rollback. Captures node transforms and replicated attributes (including rigid body velocities) of a scene once per frame into a ring buffer, and restores an earlier frame in bulk. Only values that changed since the previous capture are copied.
+    class URHO3D_API SceneHistory : public Object
+    {
+        URHO3D_OBJECT(SceneHistory, Object);
+
+    public:
+        /// Construct.
+        explicit SceneHistory(Context* context);
+        /// Destruct.
+        ~SceneHistory() override;
+
+        /// Set scene to capture. Clears the history.
+        void SetScene(Scene* scene);
+        /// Set maximum number of frames kept. Clears the history.
+        void SetCapacity(unsigned frames);
+        /// Set whether local nodes and components are captured in addition to replicated ones. Clears the history.
+        void SetIncludeLocal(bool enable);
+        /// Set attribute mode bits of captured component attributes. Default is AM_NET. Clears the history.
+        void SetAttributeMode(AttributeModeFlags mode);
+        /// Capture the current scene state as a frame. Frame numbers must increase. Return true if successful.
+        bool Capture(unsigned frame);
+        /// Restore the scene state of a captured frame and discard the frames after it. Return true if successful.
+        bool Restore(unsigned frame);
+        /// Discard all captured frames.
+        void Clear();
+
+        /// Return scene.
+        Scene* GetScene() const;
+        /// Return maximum number of frames kept.
+        unsigned GetCapacity() const { return capacity_; }
+        /// Return whether local nodes and components are captured.
+        bool GetIncludeLocal() const { return includeLocal_; }
+        /// Return attribute mode bits of captured component attributes.
+        AttributeModeFlags GetAttributeMode() const { return attributeMode_; }
+        /// Return number of captured frames.
+        unsigned GetNumFrames() const { return numFrames_; }
+        /// Return oldest captured frame number. Only valid if there are captured frames.
+        unsigned GetOldestFrame() const;
+        /// Return newest captured frame number. Only valid if there are captured frames.
+        unsigned GetNewestFrame() const;
+        /// Return whether a frame can be restored.
+        bool HasFrame(unsigned frame) const;
+        /// Return number of tracked values.
+        unsigned GetNumSlots() const { return (unsigned)slots_.size(); }
+
+    private:
+        /// Handle a node or component being added to or removed from the scene.
+        void HandleSceneChanged(StringHash eventType, VariantMap& eventData);
+        /// Remove the slots of removed nodes and components, and add slots for nodes and components that are not tracked yet.
+        void UpdateSlots();
+        /// Remove the slots of destroyed or removed objects along with their mirror values and their changes in the captured frames.
+        void RemoveExpiredSlots();
+        /// Add slots for a node, its components and its children.
+        void AddSlots(Node* node);
+        /// Add slots for an object if it is not tracked yet. Return true if it was added.
+        bool AddObjectSlots(Serializable* object, bool isNode, HashMap<unsigned, unsigned>& objectSlots);
+        /// Append a slot and initialize its mirror value from the object.
+        void AddSlot(Serializable* object, unsigned attributeIndex);
+        /// Return position of a frame counted from the oldest, or M_MAX_UNSIGNED if not captured.
+        unsigned GetFrameIndex(unsigned frame) const;
+
+        /// Scene.
+        WeakPtr<Scene> scene_;
+        /// Tracked values.
+        std::vector<SceneHistorySlot> slots_;
+        /// First slot of each tracked node by ID.
+        HashMap<unsigned, unsigned> nodeSlots_;
+        /// First slot of each tracked component by ID.
+        HashMap<unsigned, unsigned> componentSlots_;
+        /// Plain data values of the newest captured frame.
+        std::vector<unsigned char> mirror_;
+        /// Variant values of the newest captured frame.
+        std::vector<Variant> mirrorVariants_;
+        /// Ring buffer of captured frames.
+        std::vector<SceneHistoryFrame> frames_;
+        /// Ring buffer index of the oldest frame.
+        unsigned firstFrame_;
+        /// Number of captured frames.
+        unsigned numFrames_;
+        /// Maximum number of frames kept.
+        unsigned capacity_;
+        /// Attribute mode bits of captured component attributes.
+        AttributeModeFlags attributeMode_;
+        /// Capture local nodes and components flag.
+        bool includeLocal_;
+        /// Scene structure changed since the last capture flag.
+        bool slotsDirty_;
+        /// Attribute value used when comparing.
+        Variant tempValue_;
+        /// Objects whose attributes were set during restore.
+        std::vector<Serializable*> restoredObjects_;
+        /// New slot indices when removing expired slots.
+        std::vector<unsigned> slotRemap_;
+    };
+}
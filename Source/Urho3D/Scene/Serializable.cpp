@@ -53,6 +53,63 @@ static unsigned RemapAttributeIndex(const std::vector<AttributeInfo>* attributes
     return netAttrIndex; // Could not remap
 }
 
+/// Copy a plain data member into a Variant if the values differ. Return true if changed.
+template <class T> static bool UpdatePlainValue(const void* src, Variant& dest)
+{
+    const T& value = *static_cast<const T*>(src);
+    if (dest == value)
+        return false;
+
+    dest = value;
+    return true;
+}
+
+/// Copy a plain data attribute member into a Variant if the values differ. Return true if changed.
+static bool UpdatePlainAttribute(const AttributeInfo& attr, const void* src, Variant& dest)
+{
+    switch (attr.type_)
+    {
+    case VAR_BOOL: return UpdatePlainValue<bool>(src, dest);
+    // Unsigned members have the same representation
+    case VAR_INT: return UpdatePlainValue<int>(src, dest);
+    case VAR_INT64: return UpdatePlainValue<long long>(src, dest);
+    case VAR_FLOAT: return UpdatePlainValue<float>(src, dest);
+    case VAR_DOUBLE: return UpdatePlainValue<double>(src, dest);
+    case VAR_VECTOR2: return UpdatePlainValue<Vector2>(src, dest);
+    case VAR_VECTOR3: return UpdatePlainValue<Vector3>(src, dest);
+    case VAR_VECTOR4: return UpdatePlainValue<Vector4>(src, dest);
+    case VAR_INTVECTOR2: return UpdatePlainValue<IntVector2>(src, dest);
+    case VAR_INTVECTOR3: return UpdatePlainValue<IntVector3>(src, dest);
+    case VAR_QUATERNION: return UpdatePlainValue<Quaternion>(src, dest);
+    case VAR_COLOR: return UpdatePlainValue<Color>(src, dest);
+    case VAR_INTRECT: return UpdatePlainValue<IntRect>(src, dest);
+    case VAR_RECT: return UpdatePlainValue<Rect>(src, dest);
+    case VAR_MATRIX3: return UpdatePlainValue<Matrix3>(src, dest);
+    case VAR_MATRIX3X4: return UpdatePlainValue<Matrix3x4>(src, dest);
+    case VAR_MATRIX4: return UpdatePlainValue<Matrix4>(src, dest);
+    default: return false;
+    }
+}
+
+/// Read a plain data attribute member directly from binary data.
+static void ReadPlainAttribute(Deserializer& source, const AttributeInfo& attr, void* dest)
+{
+    // Bools are stored as a byte that may have any nonzero value
+    if (attr.type_ == VAR_BOOL)
+        *static_cast<bool*>(dest) = source.ReadBool();
+    else
+        source.Read(dest, attr.memberSize_);
+}
+
+/// Write a network attribute value. A plain data member holds the value the network state was updated from, so it is written directly.
+static void WriteNetworkValue(Serializer& dest, const Serializable* object, const AttributeInfo& attr, const Variant& current)
+{
+    if (attr.memberSize_)
+        dest.Write(attr.accessor_->GetMemberAddress(object), attr.memberSize_);
+    else
+        dest.WriteVariantData(current);
+}
+
 Serializable::Serializable(Context* context) :
     Object(context),
     setInstanceDefault_(false),
@@ -308,6 +365,13 @@ bool Serializable::Load(Deserializer& source)
             return false;
         }
 
+        // Plain data members use the same binary layout as the Variant, so read them in place
+        if (attr.memberSize_ && !setInstanceDefault_)
+        {
+            ReadPlainAttribute(source, attr, const_cast<void*>(attr.accessor_->GetMemberAddress(this)));
+            continue;
+        }
+
         Variant varValue = source.ReadVariant(attr.type_);
         OnSetAttribute(attr, varValue);
     }
@@ -329,9 +393,19 @@ bool Serializable::Save(Serializer& dest) const
         if (!(attr.mode_ & AM_FILE) || (attr.mode_ & AM_FILEREADONLY) == AM_FILEREADONLY)
             continue;
 
-        OnGetAttribute(attr, value);
+        bool success;
+        if (attr.memberSize_)
+        {
+            const void* src = attr.accessor_->GetMemberAddress(this);
+            success = dest.Write(src, attr.memberSize_) == attr.memberSize_;
+        }
+        else
+        {
+            OnGetAttribute(attr, value);
+            success = dest.WriteVariantData(value);
+        }
 
-        if (!dest.WriteVariantData(value))
+        if (!success)
         {
             URHO3D_LOGERROR("Could not save " + GetTypeName() + ", writing to stream failed");
             return false;
@@ -764,7 +838,7 @@ void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeS
     for (unsigned i = 0; i < numAttributes; ++i)
     {
         if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+            WriteNetworkValue(dest, this, attributes->at(i), networkState_->currentValues_[i]);
     }
 }
 
@@ -790,7 +864,7 @@ void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attribute
     for (unsigned i = 0; i < numAttributes; ++i)
     {
         if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+            WriteNetworkValue(dest, this, attributes->at(i), networkState_->currentValues_[i]);
     }
 }
 
@@ -812,11 +886,36 @@ void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeSta
 
     for (unsigned i = 0; i < numAttributes; ++i)
     {
-        if (attributes->at(i).mode_ & AM_LATESTDATA)
-            dest.WriteVariantData(networkState_->currentValues_[i]);
+        const AttributeInfo& attr = attributes->at(i);
+        if (attr.mode_ & AM_LATESTDATA)
+            WriteNetworkValue(dest, this, attr, networkState_->currentValues_[i]);
     }
 }
 
+bool Serializable::UpdateNetworkAttribute(const AttributeInfo& attr, unsigned index)
+{
+    Variant& current = networkState_->currentValues_[index];
+    Variant& previous = networkState_->previousValues_[index];
+
+    if (attr.memberSize_)
+    {
+        // Current and previous values are kept equal, so compare the member against the previous value without a temporary
+        bool changed = UpdatePlainAttribute(attr, attr.accessor_->GetMemberAddress(this), previous);
+        if (changed || current.GetType() == VAR_NONE)
+            current = previous;
+        return changed;
+    }
+
+    OnGetAttribute(attr, current);
+    if (current != previous)
+    {
+        previous = current;
+        return true;
+    }
+    else
+        return false;
+}
+
 bool Serializable::ReadDeltaUpdate(Deserializer& source)
 {
     const std::vector<AttributeInfo>* attributes = GetNetworkAttributes();
@@ -838,7 +937,10 @@ bool Serializable::ReadDeltaUpdate(Deserializer& source)
             const AttributeInfo& attr = attributes->at(i);
             if (!(interceptMask & (1ULL << i)))
             {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
+                if (attr.memberSize_ && !setInstanceDefault_)
+                    ReadPlainAttribute(source, attr, const_cast<void*>(attr.accessor_->GetMemberAddress(this)));
+                else
+                    OnSetAttribute(attr, source.ReadVariant(attr.type_));
                 changed = true;
             }
             else
@@ -878,7 +980,10 @@ bool Serializable::ReadLatestDataUpdate(Deserializer& source)
         {
             if (!(interceptMask & (1ULL << i)))
             {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
+                if (attr.memberSize_ && !setInstanceDefault_)
+                    ReadPlainAttribute(source, attr, const_cast<void*>(attr.accessor_->GetMemberAddress(this)));
+                else
+                    OnSetAttribute(attr, source.ReadVariant(attr.type_));
                 changed = true;
             }
             else
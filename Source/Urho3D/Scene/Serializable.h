@@ -26,6 +26,7 @@
 #include "../Core/Object.h"
 
 #include <cstddef>
+#include <type_traits>
 
 namespace Urho3D
 {
@@ -74,6 +75,10 @@ public:
 
     /// Apply attribute changes that can not be applied immediately. Called after scene load or a network update.
     virtual void ApplyAttributes() { }
+    /// Handle start of a bulk attribute load that bypasses Load(), for example from a packed scene file.
+    virtual void OnBeginBulkLoad() { }
+    /// Handle end of a bulk attribute load.
+    virtual void OnEndBulkLoad() { }
 
     /// Return whether should save default-valued attributes into XML. Default false.
     virtual bool SaveDefaultAttributes() const { return false; }
@@ -137,6 +142,9 @@ public:
     NetworkState* GetNetworkState() const { return networkState_.Get(); }
 
 protected:
+    /// Refresh the current network value of an attribute and copy it to the previous value if changed. Plain data members are compared without a Variant temporary. Return true if changed.
+    bool UpdateNetworkAttribute(const AttributeInfo& attr, unsigned index);
+
     /// Network attribute state.
     UniquePtr<NetworkState> networkState_;
 
@@ -185,6 +193,80 @@ private:
     TSetFunction setFunction_;
 };
 
+/// Attribute member types that can be copied, compared and serialized as plain data, using the same binary layout as the corresponding Variant type.
+template <class T> struct IsPlainAttributeType : std::false_type { };
+template <> struct IsPlainAttributeType<bool> : std::true_type { };
+template <> struct IsPlainAttributeType<int> : std::true_type { };
+template <> struct IsPlainAttributeType<unsigned> : std::true_type { };
+template <> struct IsPlainAttributeType<long long> : std::true_type { };
+template <> struct IsPlainAttributeType<unsigned long long> : std::true_type { };
+template <> struct IsPlainAttributeType<float> : std::true_type { };
+template <> struct IsPlainAttributeType<double> : std::true_type { };
+template <> struct IsPlainAttributeType<Vector2> : std::true_type { };
+template <> struct IsPlainAttributeType<Vector3> : std::true_type { };
+template <> struct IsPlainAttributeType<Vector4> : std::true_type { };
+template <> struct IsPlainAttributeType<IntVector2> : std::true_type { };
+template <> struct IsPlainAttributeType<IntVector3> : std::true_type { };
+template <> struct IsPlainAttributeType<Quaternion> : std::true_type { };
+template <> struct IsPlainAttributeType<Color> : std::true_type { };
+template <> struct IsPlainAttributeType<IntRect> : std::true_type { };
+template <> struct IsPlainAttributeType<Rect> : std::true_type { };
+template <> struct IsPlainAttributeType<Matrix3> : std::true_type { };
+template <> struct IsPlainAttributeType<Matrix3x4> : std::true_type { };
+template <> struct IsPlainAttributeType<Matrix4> : std::true_type { };
+
+/// Template implementation of the member attribute accessor. The member can be accessed directly if it is of a plain attribute type.
+template <class TClassType, class TAttributeType, class TAddressFunction>
+class MemberAttributeAccessorImpl : public AttributeAccessor
+{
+public:
+    /// Member variable type.
+    using MemberType = std::remove_const_t<std::remove_pointer_t<decltype(std::declval<TAddressFunction>()(std::declval<const TClassType&>()))>>;
+
+    /// Construct.
+    explicit MemberAttributeAccessorImpl(TAddressFunction addressFunction) : addressFunction_(addressFunction) { }
+
+    /// Read the member.
+    void Get(const Serializable* ptr, Variant& value) const override
+    {
+        assert(ptr);
+        value = *addressFunction_(*static_cast<const TClassType*>(ptr));
+    }
+
+    /// Write the member.
+    void Set(Serializable* ptr, const Variant& value) override
+    {
+        assert(ptr);
+        *const_cast<MemberType*>(addressFunction_(*static_cast<const TClassType*>(ptr))) = value.Get<TAttributeType>();
+    }
+
+    /// Return address of the member if it is plain data.
+    const void* GetMemberAddress(const Serializable* ptr) const override
+    {
+        return IsPlainMember() ? addressFunction_(*static_cast<const TClassType*>(ptr)) : nullptr;
+    }
+
+    /// Return size of the member if it is plain data.
+    unsigned GetMemberSize() const override { return IsPlainMember() ? sizeof(MemberType) : 0; }
+
+private:
+    /// Return whether the member is plain data of exactly the registered type.
+    static constexpr bool IsPlainMember() { return std::is_same<MemberType, TAttributeType>::value && IsPlainAttributeType<MemberType>::value; }
+
+    /// Member address functor.
+    TAddressFunction addressFunction_;
+};
+
+/// Make member attribute accessor implementation.
+/// \tparam TClassType Serializable class type.
+/// \tparam TAttributeType Registered attribute type.
+/// \param addressFunction Functor that returns the const address of the member variable.
+template <class TClassType, class TAttributeType, class TAddressFunction>
+SharedPtr<AttributeAccessor> MakeMemberAttributeAccessor(TAddressFunction addressFunction)
+{
+    return SharedPtr<AttributeAccessor>(new MemberAttributeAccessorImpl<TClassType, TAttributeType, TAddressFunction>(addressFunction));
+}
+
 /// Make variant attribute accessor implementation.
 /// \tparam TClassType Serializable class type.
 /// \tparam TGetFunction Functional object with call signature `void getFunction(const TClassType& self, Variant& value)`
@@ -196,9 +278,8 @@ SharedPtr<AttributeAccessor> MakeVariantAttributeAccessor(TGetFunction getFuncti
 }
 
 /// Make member attribute accessor.
-#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR(typeName, variable) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
-    [](const ClassName& self, Urho3D::Variant& value) { value = self.variable; }, \
-    [](ClassName& self, const Urho3D::Variant& value) { self.variable = value.Get<typeName>(); })
+#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR(typeName, variable) Urho3D::MakeMemberAttributeAccessor<ClassName, typeName>( \
+    [](const ClassName& self) { return &self.variable; })
 
 /// Make member attribute accessor with custom post-set callback.
 #define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR_EX(typeName, variable, postSetCallback) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
@@ -174,6 +174,66 @@ float GetIntensity(vec3 color)
     return dot(color, vec3(0.299, 0.587, 0.114));
 }
 
+#ifdef CLUSTERED
+vec4 GetClusterTexel(float index)
+{
+    float row = floor(index * cClusterMapSize.y);
+    return texture2D(sLightClusterMap, vec2((index - row * cClusterMapSize.x + 0.5) * cClusterMapSize.y, (row + 0.5) * cClusterMapSize.z));
+}
+
+vec3 GetClusteredLight(float lightIndex, vec3 normal, vec3 worldPos, vec3 eyeVec, vec3 diffColor, vec3 specColor, float specPower)
+{
+    // Light data is 4 texels per light: color and inverse range, direction and cutoff, position and inverse cutoff, specular intensity
+    float u = (lightIndex * 4.0 + 0.5) * cClusterMapSize.w;
+    vec4 colorInvRange = texture2D(sLightDataMap, vec2(u, 0.5));
+    vec4 dirCutoff = texture2D(sLightDataMap, vec2(u + cClusterMapSize.w, 0.5));
+    vec4 posInvCutoff = texture2D(sLightDataMap, vec2(u + 2.0 * cClusterMapSize.w, 0.5));
+    float specIntensity = texture2D(sLightDataMap, vec2(u + 3.0 * cClusterMapSize.w, 0.5)).r;
+
+    vec3 lightDir = dirCutoff.xyz;
+    float atten = 1.0;
+    if (colorInvRange.a > 0.0)
+    {
+        vec3 lightVec = (posInvCutoff.xyz - worldPos) * colorInvRange.a;
+        float lightDist = length(lightVec);
+        lightDir = lightVec / max(lightDist, 0.0001);
+        atten = clamp(1.0 - lightDist * lightDist, 0.0, 1.0) * clamp((dot(lightDir, dirCutoff.xyz) - dirCutoff.w) * posInvCutoff.w, 0.0, 1.0);
+    }
+
+    #ifdef TRANSLUCENT
+        float diff = abs(dot(normal, lightDir)) * atten;
+    #else
+        float diff = max(dot(normal, lightDir), 0.0) * atten;
+    #endif
+    float spec = GetSpecular(normal, eyeVec, lightDir, specPower);
+    return diff * colorInvRange.rgb * (diffColor + spec * specColor * specIntensity);
+}
+
+vec3 GetClusteredLighting(vec3 normal, vec3 worldPos, vec3 eyeVec, vec3 diffColor, vec3 specColor, float specPower)
+{
+    // Find the cluster from the screen tile and the exponential depth slice
+    vec4 clusterPos = vec4(worldPos, 1.0) * cClusterMatrix;
+    vec2 tile = clamp(floor(clusterPos.xy / clusterPos.w), vec2(0.0, 0.0), cClusterGrid.xy - 1.0);
+    float slice = clamp(floor(log2(max(clusterPos.z, 0.0001)) * cClusterDepth.x + cClusterDepth.y), 0.0, cClusterGrid.z - 1.0);
+    vec4 cluster = GetClusterTexel((slice * cClusterGrid.y + tile.y) * cClusterGrid.x + tile.x);
+
+    vec3 result = vec3(0.0, 0.0, 0.0);
+    for (float i = 0.0; i < cluster.y; i += 4.0)
+    {
+        // Light indices are packed 4 per texel
+        vec4 indices = GetClusterTexel(cluster.x + i * 0.25);
+        result += GetClusteredLight(indices.x, normal, worldPos, eyeVec, diffColor, specColor, specPower);
+        if (i + 1.0 < cluster.y)
+            result += GetClusteredLight(indices.y, normal, worldPos, eyeVec, diffColor, specColor, specPower);
+        if (i + 2.0 < cluster.y)
+            result += GetClusteredLight(indices.z, normal, worldPos, eyeVec, diffColor, specColor, specPower);
+        if (i + 3.0 < cluster.y)
+            result += GetClusteredLight(indices.w, normal, worldPos, eyeVec, diffColor, specColor, specPower);
+    }
+    return result;
+}
+#endif
+
 #ifdef SHADOW
 
 #if defined(DIRLIGHT) && (!defined(GL_ES) || defined(WEBGL))
@@ -219,6 +219,11 @@ void PS()
             finalColor += texture2D(sEmissiveMap, vTexCoord2).rgb * cAmbientColor.rgb * diffColor.rgb;
         #endif
         
+        #ifdef CLUSTERED
+            // Add lights assigned to the pixel's cluster
+            finalColor += GetClusteredLighting(normal, vWorldPos.xyz, cCameraPosPS - vWorldPos.xyz, diffColor.rgb, specColor, cMatSpecColor.a);
+        #endif
+
         #ifdef MATERIAL
             // Add light pre-pass accumulation result
             // Lights are accumulated at half intensity. Bring back to full intensity now
@@ -24,6 +24,10 @@ uniform samplerCube sLightCubeMap;
     uniform samplerCube sIndirectionCubeMap;
     uniform samplerCube sZoneCubeMap;
     uniform sampler3D sZoneVolumeMap;
+    #ifdef CLUSTERED
+        uniform sampler2D sLightClusterMap;
+        uniform sampler2D sLightDataMap;
+    #endif
 #else
     uniform highp sampler2D sShadowMap;
 #endif
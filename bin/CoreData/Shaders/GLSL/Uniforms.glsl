@@ -87,6 +87,12 @@ uniform mat4 cLightMatricesPS[4];
 #ifdef VSM_SHADOW
 uniform vec2 cVSMShadowParams;
 #endif
+#ifdef CLUSTERED
+uniform mat4 cClusterMatrix;
+uniform vec4 cClusterGrid;
+uniform vec2 cClusterDepth;
+uniform vec4 cClusterMapSize;
+#endif
 #endif
 
 #else
@@ -171,6 +177,12 @@ uniform CameraPS
     vec2 cGBufferInvSize;
     float cNearClipPS;
     float cFarClipPS;
+#ifdef CLUSTERED
+    mat4 cClusterMatrix;
+    vec4 cClusterGrid;
+    vec2 cClusterDepth;
+    vec4 cClusterMapSize;
+#endif
 };
 
 uniform ZonePS
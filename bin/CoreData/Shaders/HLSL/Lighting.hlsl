@@ -187,6 +187,66 @@ float GetIntensity(float3 color)
     return dot(color, float3(0.299, 0.587, 0.114));
 }
 
+#ifdef CLUSTERED
+float4 GetClusterTexel(float index)
+{
+    float row = floor(index * cClusterMapSize.y);
+    return Sample2DLod0(LightClusterMap, float2((index - row * cClusterMapSize.x + 0.5) * cClusterMapSize.y, (row + 0.5) * cClusterMapSize.z));
+}
+
+float3 GetClusteredLight(float lightIndex, float3 normal, float3 worldPos, float3 eyeVec, float3 diffColor, float3 specColor, float specPower)
+{
+    // Light data is 4 texels per light: color and inverse range, direction and cutoff, position and inverse cutoff, specular intensity
+    float u = (lightIndex * 4.0 + 0.5) * cClusterMapSize.w;
+    float4 colorInvRange = Sample2DLod0(LightDataMap, float2(u, 0.5));
+    float4 dirCutoff = Sample2DLod0(LightDataMap, float2(u + cClusterMapSize.w, 0.5));
+    float4 posInvCutoff = Sample2DLod0(LightDataMap, float2(u + 2.0 * cClusterMapSize.w, 0.5));
+    float specIntensity = Sample2DLod0(LightDataMap, float2(u + 3.0 * cClusterMapSize.w, 0.5)).r;
+
+    float3 lightDir = dirCutoff.xyz;
+    float atten = 1.0;
+    if (colorInvRange.a > 0.0)
+    {
+        float3 lightVec = (posInvCutoff.xyz - worldPos) * colorInvRange.a;
+        float lightDist = length(lightVec);
+        lightDir = lightVec / max(lightDist, 0.0001);
+        atten = saturate(1.0 - lightDist * lightDist) * saturate((dot(lightDir, dirCutoff.xyz) - dirCutoff.w) * posInvCutoff.w);
+    }
+
+    #ifdef TRANSLUCENT
+        float diff = abs(dot(normal, lightDir)) * atten;
+    #else
+        float diff = saturate(dot(normal, lightDir)) * atten;
+    #endif
+    float spec = GetSpecular(normal, eyeVec, lightDir, specPower);
+    return diff * colorInvRange.rgb * (diffColor + spec * specColor * specIntensity);
+}
+
+float3 GetClusteredLighting(float3 normal, float3 worldPos, float3 eyeVec, float3 diffColor, float3 specColor, float specPower)
+{
+    // Find the cluster from the screen tile and the exponential depth slice
+    float4 clusterPos = mul(float4(worldPos, 1.0), cClusterMatrix);
+    float2 tile = clamp(floor(clusterPos.xy / clusterPos.w), float2(0.0, 0.0), cClusterGrid.xy - 1.0);
+    float slice = clamp(floor(log2(max(clusterPos.z, 0.0001)) * cClusterDepth.x + cClusterDepth.y), 0.0, cClusterGrid.z - 1.0);
+    float4 cluster = GetClusterTexel((slice * cClusterGrid.y + tile.y) * cClusterGrid.x + tile.x);
+
+    float3 result = float3(0.0, 0.0, 0.0);
+    for (float i = 0.0; i < cluster.y; i += 4.0)
+    {
+        // Light indices are packed 4 per texel
+        float4 indices = GetClusterTexel(cluster.x + i * 0.25);
+        result += GetClusteredLight(indices.x, normal, worldPos, eyeVec, diffColor, specColor, specPower);
+        if (i + 1.0 < cluster.y)
+            result += GetClusteredLight(indices.y, normal, worldPos, eyeVec, diffColor, specColor, specPower);
+        if (i + 2.0 < cluster.y)
+            result += GetClusteredLight(indices.z, normal, worldPos, eyeVec, diffColor, specColor, specPower);
+        if (i + 3.0 < cluster.y)
+            result += GetClusteredLight(indices.w, normal, worldPos, eyeVec, diffColor, specColor, specPower);
+    }
+    return result;
+}
+#endif
+
 #ifdef SHADOW
 
 #ifdef DIRLIGHT
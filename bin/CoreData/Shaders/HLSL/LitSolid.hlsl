@@ -293,6 +293,11 @@ void PS(
             finalColor += Sample2D(EmissiveMap, iTexCoord2).rgb * cAmbientColor.rgb * diffColor.rgb;
         #endif
 
+        #ifdef CLUSTERED
+            // Add lights assigned to the pixel's cluster
+            finalColor += GetClusteredLighting(normal, iWorldPos.xyz, cCameraPosPS - iWorldPos.xyz, diffColor.rgb, specColor, cMatSpecColor.a);
+        #endif
+
         #ifdef MATERIAL
             // Add light pre-pass accumulation result
             // Lights are accumulated at half intensity. Bring back to full intensity now
@@ -67,6 +67,10 @@ Texture2D tDepthBuffer : register(t13);
 Texture2D tLightBuffer : register(t14);
 TextureCube tZoneCubeMap : register(t15);
 Texture3D tZoneVolumeMap : register(t15);
+#ifdef CLUSTERED
+    Texture2D tLightClusterMap : register(t11);
+    Texture2D tLightDataMap : register(t12);
+#endif
 
 SamplerState sDiffMap : register(s0);
 SamplerState sDiffCubeMap : register(s0);
@@ -93,6 +97,10 @@ SamplerState sDepthBuffer : register(s13);
 SamplerState sLightBuffer : register(s14);
 SamplerState sZoneCubeMap : register(s15);
 SamplerState sZoneVolumeMap : register(s15);
+#ifdef CLUSTERED
+    SamplerState sLightClusterMap : register(s11);
+    SamplerState sLightDataMap : register(s12);
+#endif
 
 #endif
 
@@ -76,6 +76,12 @@ uniform float4x4 cLightMatricesPS[4];
 #ifdef VSM_SHADOW
 uniform float2 cVSMShadowParams;
 #endif
+#ifdef CLUSTERED
+uniform float4x4 cClusterMatrix;
+uniform float4 cClusterGrid;
+uniform float2 cClusterDepth;
+uniform float4 cClusterMapSize;
+#endif
 #endif
 
 #else
@@ -160,6 +166,12 @@ cbuffer CameraPS : register(b1)
     float2 cGBufferInvSize;
     float cNearClipPS;
     float cFarClipPS;
+#ifdef CLUSTERED
+    float4x4 cClusterMatrix;
+    float4 cClusterGrid;
+    float2 cClusterDepth;
+    float4 cClusterMapSize;
+#endif
 }
 
 cbuffer ZonePS : register(b2)
@@ -234,6 +234,8 @@ if (CMAKE_PROJECT_NAME STREQUAL Urho3D)
     # On Windows platform Direct3D11 can be optionally chosen
     # Using Direct3D11 on non-MSVC compiler may require copying and renaming Microsoft official libraries (.lib to .a), else link failures or non-functioning graphics may result
     cmake_dependent_option (URHO3D_D3D11 "Use Direct3D11 (Windows platform only); overrides URHO3D_OPENGL option" FALSE "WIN32" FALSE)
+    # The null graphics backend renders nothing and needs no GPU, for headless CPU benchmarks of the renderer; overrides URHO3D_OPENGL and URHO3D_D3D11 options
+    option (URHO3D_NULLGRAPHICS "Use the null graphics backend for headless benchmarking; overrides URHO3D_OPENGL and URHO3D_D3D11 options" FALSE)
     if (X86 OR E2K OR WEB)
         # TODO: Rename URHO3D_SSE to URHO3D_SIMD
         if (MINGW AND CMAKE_CXX_COMPILER_VERSION VERSION_LESS 4.9.1)
@@ -351,7 +353,12 @@ if (NOT CMAKE_CONFIGURATION_TYPES)
 endif ()
 
 # Handle mutually exclusive options and implied options
-if (URHO3D_D3D11)
+if (URHO3D_NULLGRAPHICS)
+    set (URHO3D_OPENGL 0)
+    unset (URHO3D_OPENGL CACHE)
+    set (URHO3D_D3D11 0)
+    unset (URHO3D_D3D11 CACHE)
+elseif (URHO3D_D3D11)
     set (URHO3D_OPENGL 0)
     unset (URHO3D_OPENGL CACHE)
 endif ()